@@ -15,6 +15,9 @@
 #if !defined(LF_SINGLE_THREADED)
 #include "scheduler.h"
 #endif
+#ifdef LF_ENCLAVES
+#include "enclave_channel.h"
+#endif
 
 //////////////////
 // Local functions, not intended for use outside this file.
@@ -134,6 +137,20 @@ static void environment_init_federated(environment_t* env, int num_is_present_fi
 #endif
 }
 
+/**
+ * @brief Initialize the enclave-specific part of the environment struct.
+ */
+static void environment_init_enclaves(environment_t* env) {
+#ifdef LF_ENCLAVES
+  env->inbound_channels = NULL;
+  env->inbound_channels_size = 0;
+  env->outbound_channels = NULL;
+  env->outbound_channels_size = 0;
+#else
+  (void)env;
+#endif
+}
+
 static void environment_free_threaded(environment_t* env) {
 #if !defined(LF_SINGLE_THREADED)
   free(env->thread_ids);
@@ -163,6 +180,14 @@ static void environment_free_modes(environment_t* env) {
 #endif
 }
 
+static void environment_free_enclaves(environment_t* env) {
+#ifdef LF_ENCLAVES
+  _lf_enclave_channels_free(env);
+#else
+  (void)env;
+#endif
+}
+
 static void environment_free_federated(environment_t* env) {
 #ifdef FEDERATED_DECENTRALIZED
   free(env->_lf_intended_tag_fields);
@@ -195,6 +220,7 @@ void environment_free(environment_t* env) {
   environment_free_single_threaded(env);
   environment_free_modes(env);
   environment_free_federated(env);
+  environment_free_enclaves(env);
 }
 
 void environment_init_tags(environment_t* env, instant_t start_time, interval_t duration) {
@@ -294,6 +320,7 @@ int environment_init(environment_t* env, const char* name, int id, int num_worke
   environment_init_single_threaded(env);
   environment_init_modes(env, num_modes, num_state_resets);
   environment_init_federated(env, num_is_present_fields);
+  environment_init_enclaves(env);
 
   env->initialized = true;
   return 0;
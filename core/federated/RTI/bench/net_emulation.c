@@ -0,0 +1,325 @@
+/**
+ * @file net_emulation.c
+ * @brief Emulation of network delay, jitter, and loss on the connections of a process.
+ *
+ * A program linked with this file and with `--wrap` for each of the functions it defines below
+ * (@see net_emulation.cmake) has the writes of the network abstraction API in @ref net_abstraction.h
+ * go through a queue per connection. A thread per connection performs each queued write when it is
+ * due, so that, as on a real link, the delay does not hold up the writer. These environment variables,
+ * read when the process first writes, determine when a write is due:
+ * - `LF_NET_DELAY`: the delay in nanoseconds;
+ * - `LF_NET_JITTER`: the maximum of an additional delay in nanoseconds, drawn uniformly for each write;
+ * - `LF_NET_LOSS`: the probability that a write is lost. Since the connections are reliable streams,
+ *   a lost write is delivered, as TCP would deliver it, after a retransmission timeout, which is
+ *   `LF_NET_RTO` nanoseconds (200 ms by default).
+ *
+ * The writes on a connection stay in order, so a write is never due before the one that precedes it.
+ * Closing a connection first waits for the writes queued on it. A write that fails once it is performed
+ * makes the next write on the connection fail. Without any of these variables, the functions call those
+ * they wrap directly.
+ *
+ * When both ends of a connection emulate the network, as with synthetic federates and the RTI
+ * program built with this file, the delay applies once in each direction.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "clock.h"
+#include "low_level_platform.h"
+#include "net_abstraction.h"
+#include "util.h"
+
+int __real_write_to_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer);
+int __real_write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer);
+int __real_write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count);
+int __real_write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count);
+int __real_close_net(net_abstraction_t net_abs, bool read_before_closing);
+int __real_shutdown_net(net_abstraction_t net_abs, bool read_before_closing);
+void __real_free_net(net_abstraction_t net_abs);
+
+/** A write that has yet to be performed. */
+typedef struct pending_write_t {
+  struct pending_write_t* next;
+  instant_t due;
+  size_t length;
+  unsigned char bytes[];
+} pending_write_t;
+
+/** The queue of writes of a connection and the thread that performs them. */
+typedef struct emulated_link_t {
+  struct emulated_link_t* next;
+  net_abstraction_t net;
+  lf_mutex_t mutex;
+  /** Signaled when a write is queued or performed, or when the thread should stop. */
+  lf_cond_t changed;
+  pending_write_t* head;
+  pending_write_t* tail;
+  /** The time at which the last queued write is due. */
+  instant_t last_due;
+  /** Whether the thread is performing a write that it has taken off the queue. */
+  bool writing;
+  bool failed;
+  bool stopping;
+  unsigned int seed;
+  lf_thread_t thread;
+} emulated_link_t;
+
+static interval_t delay = 0;
+static interval_t jitter = 0;
+static double loss = 0.0;
+static interval_t retransmission_timeout = MSEC(200);
+static bool emulating = false;
+
+static pthread_once_t settings_once = PTHREAD_ONCE_INIT;
+
+/** The links of the connections that have been written to, guarded by links_mutex. */
+static emulated_link_t* links = NULL;
+static lf_mutex_t links_mutex;
+
+static void read_settings(void) {
+  const char* value;
+  if ((value = getenv("LF_NET_DELAY")) != NULL) {
+    delay = (interval_t)strtoll(value, NULL, 10);
+  }
+  if ((value = getenv("LF_NET_JITTER")) != NULL) {
+    jitter = (interval_t)strtoll(value, NULL, 10);
+  }
+  if ((value = getenv("LF_NET_LOSS")) != NULL) {
+    loss = strtod(value, NULL);
+  }
+  if ((value = getenv("LF_NET_RTO")) != NULL) {
+    retransmission_timeout = (interval_t)strtoll(value, NULL, 10);
+  }
+  emulating = delay > 0 || jitter > 0 || loss > 0.0;
+  LF_MUTEX_INIT(&links_mutex);
+}
+
+/** Return whether the network is emulated. */
+static bool emulated(void) {
+  pthread_once(&settings_once, read_settings);
+  return emulating;
+}
+
+/** Perform the writes of a link as they become due until the link is stopped and its queue is empty. */
+static void* perform_writes(void* arg) {
+  emulated_link_t* link = (emulated_link_t*)arg;
+  LF_MUTEX_LOCK(&link->mutex);
+  while (link->head != NULL || !link->stopping) {
+    pending_write_t* write = link->head;
+    if (write == NULL) {
+      lf_cond_wait(&link->changed);
+      continue;
+    }
+    if (lf_time_physical() < write->due) {
+      lf_clock_cond_timedwait(&link->changed, write->due);
+      continue;
+    }
+    link->head = write->next;
+    if (link->head == NULL) {
+      link->tail = NULL;
+    }
+    link->writing = true;
+    bool failed = link->failed;
+    LF_MUTEX_UNLOCK(&link->mutex);
+    if (!failed) {
+      failed = __real_write_to_net(link->net, write->length, write->bytes) != 0;
+    }
+    free(write);
+    LF_MUTEX_LOCK(&link->mutex);
+    link->writing = false;
+    link->failed = failed;
+    lf_cond_broadcast(&link->changed);
+  }
+  LF_MUTEX_UNLOCK(&link->mutex);
+  return NULL;
+}
+
+/** Return the link of a connection, creating it if `create` is true, or NULL if there is none. */
+static emulated_link_t* link_of(net_abstraction_t net, bool create) {
+  LF_MUTEX_LOCK(&links_mutex);
+  emulated_link_t* link = links;
+  while (link != NULL && link->net != net) {
+    link = link->next;
+  }
+  if (link == NULL && create) {
+    link = (emulated_link_t*)calloc(1, sizeof(emulated_link_t));
+    LF_ASSERT_NON_NULL(link);
+    link->net = net;
+    link->seed = (unsigned int)(uintptr_t)net ^ (unsigned int)lf_time_physical();
+    LF_MUTEX_INIT(&link->mutex);
+    LF_COND_INIT(&link->changed, &link->mutex);
+    if (lf_thread_create(&link->thread, perform_writes, link) != 0) {
+      lf_print_error_and_exit("Failed to create the thread emulating a network connection.");
+    }
+    link->next = links;
+    links = link;
+  }
+  LF_MUTEX_UNLOCK(&links_mutex);
+  return link;
+}
+
+/** Wait until the writes queued on a link, if there is one, have been performed. */
+static void drain(net_abstraction_t net) {
+  emulated_link_t* link = link_of(net, false);
+  if (link == NULL) {
+    return;
+  }
+  LF_MUTEX_LOCK(&link->mutex);
+  while (link->head != NULL || link->writing) {
+    lf_cond_wait(&link->changed);
+  }
+  LF_MUTEX_UNLOCK(&link->mutex);
+}
+
+/** Perform the writes queued on the link of a connection, if there is one, and remove the link. */
+static void remove_link(net_abstraction_t net) {
+  LF_MUTEX_LOCK(&links_mutex);
+  emulated_link_t** previous = &links;
+  while (*previous != NULL && (*previous)->net != net) {
+    previous = &(*previous)->next;
+  }
+  emulated_link_t* link = *previous;
+  if (link != NULL) {
+    *previous = link->next;
+  }
+  LF_MUTEX_UNLOCK(&links_mutex);
+  if (link == NULL) {
+    return;
+  }
+  LF_MUTEX_LOCK(&link->mutex);
+  link->stopping = true;
+  lf_cond_broadcast(&link->changed);
+  LF_MUTEX_UNLOCK(&link->mutex);
+  lf_thread_join(link->thread, NULL);
+  free(link);
+}
+
+/** Return a uniformly distributed number between 0 and 1. */
+static double draw(emulated_link_t* link) { return (double)rand_r(&link->seed) / RAND_MAX; }
+
+/** Queue the concatenation of the given buffers on the link of a connection. */
+static int queue_write(net_abstraction_t net, const struct iovec* vectors, int count) {
+  size_t length = 0;
+  for (int i = 0; i < count; i++) {
+    length += vectors[i].iov_len;
+  }
+  pending_write_t* write = (pending_write_t*)malloc(sizeof(pending_write_t) + length);
+  LF_ASSERT_NON_NULL(write);
+  write->next = NULL;
+  write->length = length;
+  size_t offset = 0;
+  for (int i = 0; i < count; i++) {
+    memcpy(&write->bytes[offset], vectors[i].iov_base, vectors[i].iov_len);
+    offset += vectors[i].iov_len;
+  }
+
+  emulated_link_t* link = link_of(net, true);
+  LF_MUTEX_LOCK(&link->mutex);
+  if (link->failed) {
+    LF_MUTEX_UNLOCK(&link->mutex);
+    free(write);
+    return -1;
+  }
+  instant_t due = lf_time_physical() + delay;
+  if (jitter > 0) {
+    due += (interval_t)(draw(link) * (double)jitter);
+  }
+  if (loss > 0.0 && draw(link) < loss) {
+    due += retransmission_timeout;
+  }
+  write->due = due > link->last_due ? due : link->last_due;
+  link->last_due = write->due;
+  if (link->tail == NULL) {
+    link->head = write;
+  } else {
+    link->tail->next = write;
+  }
+  link->tail = write;
+  lf_cond_broadcast(&link->changed);
+  LF_MUTEX_UNLOCK(&link->mutex);
+  return 0;
+}
+
+int __wrap_write_to_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  if (!emulated()) {
+    return __real_write_to_net(net_abs, num_bytes, buffer);
+  }
+  struct iovec vector = {.iov_base = buffer, .iov_len = num_bytes};
+  return queue_write(net_abs, &vector, 1);
+}
+
+int __wrap_write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  if (!emulated()) {
+    return __real_write_to_net_v(net_abs, vectors, count);
+  }
+  return queue_write(net_abs, vectors, count);
+}
+
+int __wrap_close_net(net_abstraction_t net_abs, bool read_before_closing) {
+  if (emulated() && net_abs != NULL) {
+    drain(net_abs);
+  }
+  return __real_close_net(net_abs, read_before_closing);
+}
+
+int __wrap_shutdown_net(net_abstraction_t net_abs, bool read_before_closing) {
+  if (emulated() && net_abs != NULL) {
+    remove_link(net_abs);
+  }
+  return __real_shutdown_net(net_abs, read_before_closing);
+}
+
+void __wrap_free_net(net_abstraction_t net_abs) {
+  if (emulated() && net_abs != NULL) {
+    remove_link(net_abs);
+  }
+  __real_free_net(net_abs);
+}
+
+int __wrap_write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  if (!emulated()) {
+    return __real_write_to_net_close_on_error(net_abs, num_bytes, buffer);
+  }
+  int result = __wrap_write_to_net(net_abs, num_bytes, buffer);
+  if (result) {
+    __wrap_close_net(net_abs, false);
+  }
+  return result;
+}
+
+int __wrap_write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  if (!emulated()) {
+    return __real_write_to_net_v_close_on_error(net_abs, vectors, count);
+  }
+  int result = __wrap_write_to_net_v(net_abs, vectors, count);
+  if (result) {
+    __wrap_close_net(net_abs, false);
+  }
+  return result;
+}
+
+void __wrap_write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer,
+                                       lf_mutex_t* mutex, char* format, ...) {
+  if (__wrap_write_to_net_close_on_error(net_abs, num_bytes, buffer) == 0) {
+    return;
+  }
+  if (mutex != NULL) {
+    LF_MUTEX_UNLOCK(mutex);
+  }
+  if (format == NULL) {
+    lf_print_error_and_exit("Failed to write to the network. Shutting down.");
+  }
+  char message[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  lf_print_error_and_exit("%s", message);
+}
@@ -0,0 +1,20 @@
+# Emulation of network delay, jitter, and loss for benchmarks (@see net_emulation.c).
+set(NET_EMULATION_SRC ${CMAKE_CURRENT_LIST_DIR}/net_emulation.c)
+set(NET_EMULATION_WRAPPED_FUNCTIONS
+    write_to_net
+    write_to_net_close_on_error
+    write_to_net_v
+    write_to_net_v_close_on_error
+    write_to_net_fail_on_error
+    close_net
+    shutdown_net
+    free_net
+)
+
+# Build the target with net_emulation.c in front of the functions of the network abstraction that it wraps.
+function(lf_enable_net_emulation target)
+    target_sources(${target} PRIVATE ${NET_EMULATION_SRC})
+    foreach(FUNCTION ${NET_EMULATION_WRAPPED_FUNCTIONS})
+        target_link_libraries(${target} PRIVATE "-Wl,--wrap=${FUNCTION}")
+    endforeach()
+endfunction()
@@ -0,0 +1,129 @@
+/**
+ * @file net_throughput_bench.c
+ * @brief Benchmark of the rate at which tagged messages are read from a network abstraction.
+ *
+ * A writer thread sends tagged messages over a loopback connection, writing the header and payload
+ * of each with one call to write_to_net_v() as lf_send_tagged_message() does, and the main thread parses
+ * them the same way the federate and RTI listener threads do: one read for the message type,
+ * one for the header, and one for the payload. With `-u`, the reads go straight to the socket,
+ * which is how messages were read before reads were buffered per connection.
+ *
+ * Usage: net_throughput_bench [-n <messages>] [-s <payload size>] [-u]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+/** Length of the header of a tagged message, following its type byte. */
+#define HEADER_LENGTH (sizeof(uint16_t) + sizeof(uint16_t) + sizeof(int32_t) + sizeof(instant_t) + sizeof(microstep_t))
+
+static size_t num_messages = 1000000;
+static size_t payload_size = 8;
+static bool unbuffered = false;
+static uint16_t server_port;
+
+static void* writer(void* ignored) {
+  (void)ignored;
+  socket_connection_params_t params = {.type = TCP, .port = server_port, .server_hostname = "127.0.0.1"};
+  net_abstraction_t net = connect_to_net((net_params_t)&params);
+  if (net == NULL) {
+    lf_print_error_and_exit("Failed to connect to the benchmark server.");
+  }
+  // Send the header and the payload the way lf_send_tagged_message() does.
+  unsigned char header[1 + HEADER_LENGTH];
+  unsigned char* payload = (unsigned char*)calloc(1, payload_size > 0 ? payload_size : 1);
+  struct iovec vectors[] = {{.iov_base = header, .iov_len = sizeof(header)},
+                            {.iov_base = payload, .iov_len = payload_size}};
+  header[0] = MSG_TYPE_TAGGED_MESSAGE;
+  for (size_t i = 0; i < num_messages; i++) {
+    encode_uint16(1, &header[1]);
+    encode_uint16(0, &header[1 + sizeof(uint16_t)]);
+    encode_int32((int32_t)payload_size, &header[1 + 2 * sizeof(uint16_t)]);
+    encode_tag(&header[1 + 2 * sizeof(uint16_t) + sizeof(int32_t)], (tag_t){.time = (instant_t)i, .microstep = 0});
+    if (payload_size > 0) {
+      payload[payload_size - 1] = (unsigned char)i;
+    }
+    if (write_to_net_v(net, vectors, 2)) {
+      lf_print_error_and_exit("Failed to send message %zu.", i);
+    }
+  }
+  free(payload);
+  // Data already sent is still delivered after this.
+  shutdown_net(net, false);
+  return NULL;
+}
+
+int main(int argc, const char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      num_messages = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      payload_size = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-u") == 0) {
+      unbuffered = true;
+    } else {
+      fprintf(stderr, "Usage: %s [-n <messages>] [-s <payload size>] [-u]\n", argv[0]);
+      return 1;
+    }
+  }
+  initialize_lf_thread_id();
+
+  net_abstraction_t server = initialize_net();
+  set_my_port(server, 0);
+  if (create_server(server) != 0) {
+    lf_print_error_and_exit("Failed to create the benchmark server.");
+  }
+  server_port = (uint16_t)get_my_port(server);
+
+  lf_thread_t writer_thread;
+  lf_thread_create(&writer_thread, writer, NULL);
+  net_abstraction_t net = accept_net(server);
+  if (net == NULL) {
+    lf_print_error_and_exit("Failed to accept the benchmark connection.");
+  }
+  int socket = ((socket_priv_t*)net)->socket_descriptor;
+
+  unsigned char* payload = (unsigned char*)malloc(payload_size > 0 ? payload_size : 1);
+  unsigned char header[HEADER_LENGTH];
+  instant_t start = lf_time_physical();
+  for (size_t i = 0; i < num_messages; i++) {
+    unsigned char type;
+    int read_failed;
+    if (unbuffered) {
+      read_failed = read_from_socket(socket, 1, &type) || read_from_socket(socket, HEADER_LENGTH, header);
+    } else {
+      read_failed = read_from_net(net, 1, &type) || read_from_net(net, HEADER_LENGTH, header);
+    }
+    if (read_failed || type != MSG_TYPE_TAGGED_MESSAGE) {
+      lf_print_error_and_exit("Failed to read the header of message %zu.", i);
+    }
+    size_t length = (size_t)extract_int32(&header[2 * sizeof(uint16_t)]);
+    tag_t tag = extract_tag(&header[2 * sizeof(uint16_t) + sizeof(int32_t)]);
+    if (length != payload_size || tag.time != (instant_t)i) {
+      lf_print_error_and_exit("Message %zu is corrupted.", i);
+    }
+    read_failed = unbuffered ? read_from_socket(socket, length, payload) : read_from_net(net, length, payload);
+    if (read_failed || (length > 0 && payload[length - 1] != (unsigned char)i)) {
+      lf_print_error_and_exit("Failed to read the payload of message %zu.", i);
+    }
+  }
+  interval_t elapsed = lf_time_physical() - start;
+
+  void* result;
+  lf_thread_join(writer_thread, &result);
+  free(payload);
+  shutdown_net(net, false);
+  shutdown_net(server, false);
+
+  double seconds = (double)elapsed / BILLION;
+  printf("%s reads: %zu messages of %zu bytes in %.3f s: %.0f messages/s\n", unbuffered ? "Unbuffered" : "Buffered",
+         num_messages, payload_size, seconds, (double)num_messages / seconds);
+  return 0;
+}
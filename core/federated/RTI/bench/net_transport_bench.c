@@ -0,0 +1,178 @@
+/**
+ * @file net_transport_bench.c
+ * @brief Benchmark of the latency and throughput of the network abstraction between two processes.
+ *
+ * The process forks, and the child connects to a server created by the parent through the network
+ * abstraction of the build, so that building with `-DCOMM_TYPE=TCP`, `SHM`, `UDS` and `URING`
+ * compares loopback TCP with shared memory, Unix domain sockets and io_uring receives. First, the parent sends tagged messages one at a time
+ * and the child echoes each back, which gives the round-trip time. Then the child sends tagged
+ * messages as fast as it can and the parent reads them as the federate and RTI listener threads do,
+ * which gives the throughput.
+ *
+ * Usage: net_transport_bench [-n <messages>] [-s <payload size>] [-r <round trips>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+/** Length of the header of a tagged message, following its type byte. */
+#define HEADER_LENGTH (sizeof(uint16_t) + sizeof(uint16_t) + sizeof(int32_t) + sizeof(instant_t) + sizeof(microstep_t))
+
+/** Size of the messages exchanged to measure round trips, including the header. */
+#define ROUND_TRIP_MESSAGE_SIZE 64
+
+static size_t num_messages = 200000;
+static size_t payload_size = 1024;
+static size_t num_round_trips = 20000;
+
+/** Send a tagged message with the given payload the way lf_send_tagged_message() does. */
+static void send_message(net_abstraction_t net, size_t index, unsigned char* payload) {
+  unsigned char header[1 + HEADER_LENGTH];
+  header[0] = MSG_TYPE_TAGGED_MESSAGE;
+  encode_uint16(1, &header[1]);
+  encode_uint16(0, &header[1 + sizeof(uint16_t)]);
+  encode_int32((int32_t)payload_size, &header[1 + 2 * sizeof(uint16_t)]);
+  encode_tag(&header[1 + 2 * sizeof(uint16_t) + sizeof(int32_t)], (tag_t){.time = (instant_t)index, .microstep = 0});
+  payload[payload_size - 1] = (unsigned char)index;
+  struct iovec vectors[] = {{.iov_base = header, .iov_len = sizeof(header)},
+                            {.iov_base = payload, .iov_len = payload_size}};
+  if (write_to_net_v(net, vectors, 2)) {
+    lf_print_error_and_exit("Failed to send message %zu.", index);
+  }
+}
+
+/** Read a tagged message with one read for the type, one for the header and one for the payload. */
+static void receive_message(net_abstraction_t net, size_t index, unsigned char* payload) {
+  unsigned char type;
+  unsigned char header[HEADER_LENGTH];
+  if (read_from_net(net, 1, &type) || read_from_net(net, HEADER_LENGTH, header) || type != MSG_TYPE_TAGGED_MESSAGE) {
+    lf_print_error_and_exit("Failed to read the header of message %zu.", index);
+  }
+  size_t length = (size_t)extract_int32(&header[2 * sizeof(uint16_t)]);
+  tag_t tag = extract_tag(&header[2 * sizeof(uint16_t) + sizeof(int32_t)]);
+  if (length != payload_size || tag.time != (instant_t)index) {
+    lf_print_error_and_exit("Message %zu is corrupted.", index);
+  }
+  if (read_from_net(net, length, payload) || payload[length - 1] != (unsigned char)index) {
+    lf_print_error_and_exit("Failed to read the payload of message %zu.", index);
+  }
+}
+
+/** The child process: echo the round trips, then stream the messages. */
+static void run_client(uint16_t port) {
+#ifdef COMM_TYPE_SHM
+  shm_connection_params_t params = {.socket_params = {.type = TCP, .port = port, .server_hostname = "127.0.0.1"}};
+#else
+  socket_connection_params_t params = {.type = TCP, .port = port, .server_hostname = "127.0.0.1"};
+#endif
+  net_abstraction_t net = connect_to_net((net_params_t)&params);
+  if (net == NULL) {
+    lf_print_error_and_exit("Failed to connect to the benchmark server.");
+  }
+  unsigned char* payload = (unsigned char*)calloc(1, payload_size);
+  LF_ASSERT_NON_NULL(payload);
+  size_t streamed_payload_size = payload_size;
+  payload_size = ROUND_TRIP_MESSAGE_SIZE - 1 - HEADER_LENGTH;
+  for (size_t i = 0; i < num_round_trips; i++) {
+    receive_message(net, i, payload);
+    send_message(net, i, payload);
+  }
+  payload_size = streamed_payload_size;
+  for (size_t i = 0; i < num_messages; i++) {
+    send_message(net, i, payload);
+  }
+  free(payload);
+  // Wait for the parent to have read everything before closing.
+  shutdown_net(net, true);
+}
+
+static const char* comm_type() {
+#if defined(COMM_TYPE_SHM)
+  return "SHM";
+#elif defined(COMM_TYPE_UDS)
+  return "UDS";
+#elif defined(COMM_TYPE_URING)
+  return "URING";
+#else
+  return "TCP";
+#endif
+}
+
+int main(int argc, const char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      num_messages = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      payload_size = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      num_round_trips = (size_t)atoll(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [-n <messages>] [-s <payload size>] [-r <round trips>]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (num_messages == 0 || payload_size == 0 || num_round_trips == 0) {
+    fprintf(stderr, "The numbers of messages and round trips and the payload size must be positive.\n");
+    return 1;
+  }
+  initialize_lf_thread_id();
+
+  net_abstraction_t server = initialize_net();
+  set_my_port(server, 0);
+  if (create_server(server) != 0) {
+    lf_print_error_and_exit("Failed to create the benchmark server.");
+  }
+  uint16_t port = (uint16_t)get_my_port(server);
+  pid_t child = fork();
+  if (child < 0) {
+    lf_print_error_system_failure("Failed to fork.");
+  } else if (child == 0) {
+    run_client(port);
+    exit(0);
+  }
+  net_abstraction_t net = accept_net(server);
+  if (net == NULL) {
+    lf_print_error_and_exit("Failed to accept the benchmark connection.");
+  }
+  unsigned char* payload = (unsigned char*)calloc(1, payload_size);
+  LF_ASSERT_NON_NULL(payload);
+
+  size_t streamed_payload_size = payload_size;
+  payload_size = ROUND_TRIP_MESSAGE_SIZE - 1 - HEADER_LENGTH;
+  instant_t start = lf_time_physical();
+  for (size_t i = 0; i < num_round_trips; i++) {
+    send_message(net, i, payload);
+    receive_message(net, i, payload);
+  }
+  interval_t round_trips = lf_time_physical() - start;
+
+  payload_size = streamed_payload_size;
+  start = lf_time_physical();
+  for (size_t i = 0; i < num_messages; i++) {
+    receive_message(net, i, payload);
+  }
+  interval_t streaming = lf_time_physical() - start;
+
+  shutdown_net(net, false);
+  shutdown_net(server, false);
+  int status;
+  waitpid(child, &status, 0);
+  free(payload);
+
+  double seconds = (double)streaming / BILLION;
+  printf("%s: round trip of %d-byte messages: %.2f us (%zu round trips)\n", comm_type(), ROUND_TRIP_MESSAGE_SIZE,
+         (double)round_trips / (double)num_round_trips / 1e3, num_round_trips);
+  printf("%s: %zu messages of %zu bytes in %.3f s: %.0f messages/s, %.1f MB/s\n", comm_type(), num_messages,
+         payload_size, seconds, (double)num_messages / seconds,
+         (double)(num_messages * (1 + HEADER_LENGTH + payload_size)) / seconds / 1e6);
+  return 0;
+}
@@ -0,0 +1,266 @@
+/**
+ * @file rti_forward_bench.c
+ * @brief Benchmark of how forwarding large tagged messages through the RTI affects other federates.
+ *
+ * Four synthetic federates join an RTI running in the same process. Federate 0 sends tagged messages
+ * to federate 1 through the RTI as fast as it can. Meanwhile, federate 2 repeatedly sends a next event
+ * tag (NET), after which its only upstream, federate 3, confirms that tag as completed (LTC), and
+ * federate 2 waits for the tag advance grant (TAG) that the RTI can then issue. The benchmark reports
+ * the forwarding throughput and the LTC to TAG round trip times, which grow if forwarding holds up
+ * the handling of other federates' messages.
+ *
+ * With `-d`, federate 0 sends the messages to federate 2 instead, at a tag far in the future, so the
+ * grants to federate 2 queue up behind them. With `-c`, every federate opens a control lane
+ * (@see MSG_TYPE_CONTROL_LANE), over which the tags and grants then bypass the messages.
+ *
+ * Usage: rti_forward_bench [-n <messages>] [-s <payload size>] [-d] [-c]
+ *
+ * For example, to measure the head-of-line blocking of grants and how the control lane avoids it:
+ *
+ *     rti_forward_bench -d; rti_forward_bench -d -c
+ */
+
+#include <stdio.h>
+
+#include "synthetic_federate.h"
+
+static size_t num_messages = 200;
+static size_t payload_size = 1024 * 1024;
+static uint16_t rti_port;
+static net_abstraction_t nets[4];
+static net_abstraction_t control_nets[4];
+static bool control_lanes = false;
+static instant_t start_time_of_federation;
+
+/** The federate to which federate 0 sends the messages. */
+static uint16_t destination = 1;
+
+/** The tag of the messages that federate 0 sends. */
+static tag_t message_tag;
+
+static lf_mutex_t mutex;
+static lf_cond_t progress;
+
+/** The latest tag granted to federate 2, when a thread other than the main thread reads the grants. */
+static tag_t granted_to_prober = {.time = NEVER, .microstep = 0};
+
+static bool sink_done = false;
+
+/** Send a tag to the RTI on the control lane of the federate, if it has one. */
+static void send_tag(int id, unsigned char type, tag_t tag) {
+  if (control_lanes) {
+    // No federate sends a tag after sending tagged messages, so no tag waits for any.
+    synthetic_federate_send_control_tag(control_nets[id], type, tag, 0);
+  } else {
+    synthetic_federate_send_tag(nets[id], type, tag);
+  }
+}
+
+/** Record a grant to federate 2. */
+static void record_grant(tag_t tag) {
+  LF_MUTEX_LOCK(&mutex);
+  if (lf_tag_compare(tag, granted_to_prober) > 0) {
+    granted_to_prober = tag;
+    lf_cond_broadcast(&progress);
+  }
+  LF_MUTEX_UNLOCK(&mutex);
+}
+
+static void* sender(void* ignored) {
+  (void)ignored;
+  unsigned char* payload = (unsigned char*)calloc(1, payload_size);
+  LF_ASSERT_NON_NULL(payload);
+  for (size_t i = 0; i < num_messages; i++) {
+    payload[payload_size - 1] = (unsigned char)i;
+    synthetic_federate_send_message(nets[0], 0, destination, message_tag, payload_size, payload);
+  }
+  free(payload);
+  return NULL;
+}
+
+static void* sink(void* elapsed) {
+  unsigned char* payload = (unsigned char*)malloc(payload_size);
+  LF_ASSERT_NON_NULL(payload);
+  instant_t start = 0;
+  size_t received = 0;
+  while (received < num_messages) {
+    tag_t tag;
+    size_t length = 0;
+    unsigned char type = synthetic_federate_receive(nets[destination], &tag, payload, payload_size, &length);
+    if (type == MSG_TYPE_TAG_ADVANCE_GRANT && destination == 2) {
+      record_grant(tag);
+    }
+    if (type != MSG_TYPE_TAGGED_MESSAGE) {
+      continue;
+    }
+    if (received == 0) {
+      start = lf_time_physical();
+    }
+    if (length != payload_size || payload[payload_size - 1] != (unsigned char)received) {
+      lf_print_error_and_exit("Message %zu is corrupted.", received);
+    }
+    received++;
+  }
+  *(interval_t*)elapsed = lf_time_physical() - start;
+  LF_MUTEX_LOCK(&mutex);
+  sink_done = true;
+  lf_cond_broadcast(&progress);
+  LF_MUTEX_UNLOCK(&mutex);
+  free(payload);
+  return NULL;
+}
+
+/** Read the grants to federate 2 from its control lane until the RTI closes it. */
+static void* grant_reader(void* ignored) {
+  (void)ignored;
+  tag_t tag;
+  int64_t fence;
+  int type;
+  while ((type = synthetic_federate_receive_control(control_nets[2], &tag, &fence)) >= 0) {
+    if (type != MSG_TYPE_TAG_ADVANCE_GRANT) {
+      continue;
+    }
+    // All messages to federate 2 have tags later than its grants, so no grant waits for them.
+    if (fence != 0) {
+      lf_print_error_and_exit("Grant " PRINTF_TAG " waits for %" PRId64 " messages at later tags.",
+                              tag.time - start_time_of_federation, tag.microstep, fence);
+    }
+    record_grant(tag);
+  }
+  return NULL;
+}
+
+/** Wait for a grant to federate 2 of at least the given tag. Return false if the messages have all arrived first. */
+static bool wait_for_grant(tag_t tag) {
+  if (!control_lanes && destination != 2) {
+    // Nothing else reads from federate 2.
+    tag_t granted;
+    size_t length;
+    while (synthetic_federate_receive(nets[2], &granted, NULL, 0, &length) != MSG_TYPE_TAG_ADVANCE_GRANT ||
+           lf_tag_compare(granted, tag) < 0) {
+    }
+    return true;
+  }
+  LF_MUTEX_LOCK(&mutex);
+  while (lf_tag_compare(granted_to_prober, tag) < 0 && !sink_done) {
+    lf_cond_wait(&progress);
+  }
+  bool granted = lf_tag_compare(granted_to_prober, tag) >= 0;
+  LF_MUTEX_UNLOCK(&mutex);
+  return granted;
+}
+
+int main(int argc, const char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      num_messages = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      payload_size = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-d") == 0) {
+      destination = 2;
+    } else if (strcmp(argv[i], "-c") == 0) {
+      control_lanes = true;
+    } else {
+      fprintf(stderr, "Usage: %s [-n <messages>] [-s <payload size>] [-d] [-c]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (num_messages == 0 || payload_size == 0) {
+    fprintf(stderr, "The number of messages and the payload size must be positive.\n");
+    return 1;
+  }
+  initialize_lf_thread_id();
+  LF_MUTEX_INIT(&mutex);
+  LF_COND_INIT(&progress, &mutex);
+
+  rti_port = start_synthetic_rti(4, 0);
+  // Federates 0, 1 and 3 never read from the RTI, so do not send them downstream next event tags.
+  synthetic_rti.base.dnet_disabled = true;
+  if (control_lanes) {
+    for (uint16_t i = 0; i < 4; i++) {
+      control_nets[i] = synthetic_federate_connect_control_lane(rti_port, i);
+    }
+  }
+  uint16_t zero = 0;
+  uint16_t two = 2;
+  uint16_t three = 3;
+  uint16_t upstreams_of_two[] = {3, 0};
+  nets[0] = synthetic_federate_connect(rti_port, 0, 0, NULL, 1, &destination);
+  nets[1] = synthetic_federate_connect(rti_port, 1, destination == 1 ? 1 : 0, &zero, 0, NULL);
+  nets[2] = synthetic_federate_connect(rti_port, 2, destination == 2 ? 2 : 1, upstreams_of_two, 0, NULL);
+  nets[3] = synthetic_federate_connect(rti_port, 3, 0, NULL, 1, &two);
+  for (int i = 0; i < 4; i++) {
+    synthetic_federate_send_timestamp(nets[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    start_time_of_federation = synthetic_federate_receive_start_time(nets[i]);
+  }
+  message_tag = (tag_t){.time = start_time_of_federation, .microstep = 0};
+  if (destination == 2) {
+    // Send the messages an hour ahead, with every earlier tag completed, so that federate 0 does not
+    // hold up the grants to federate 2.
+    message_tag.time += HOURS(1);
+    send_tag(0, MSG_TYPE_LATEST_TAG_CONFIRMED, (tag_t){.time = message_tag.time - 1, .microstep = 0});
+    send_tag(0, MSG_TYPE_NEXT_EVENT_TAG, message_tag);
+  }
+
+  interval_t forwarding_time = 0;
+  lf_thread_t sender_thread;
+  lf_thread_t sink_thread;
+  lf_thread_t grant_reader_thread;
+  lf_thread_create(&sink_thread, sink, &forwarding_time);
+  if (control_lanes) {
+    lf_thread_create(&grant_reader_thread, grant_reader, NULL);
+  }
+  lf_thread_create(&sender_thread, sender, NULL);
+
+  // Measure LTC to TAG round trips of federate 2 until all messages have been forwarded.
+  size_t probes = 0;
+  interval_t total_round_trip = 0;
+  interval_t max_round_trip = 0;
+  while (true) {
+    LF_MUTEX_LOCK(&mutex);
+    bool done = sink_done;
+    LF_MUTEX_UNLOCK(&mutex);
+    if (done) {
+      break;
+    }
+    tag_t next = {.time = start_time_of_federation + (instant_t)probes + 1, .microstep = 0};
+    send_tag(2, MSG_TYPE_NEXT_EVENT_TAG, next);
+    instant_t sent = lf_time_physical();
+    send_tag(3, MSG_TYPE_LATEST_TAG_CONFIRMED, next);
+    if (!wait_for_grant(next)) {
+      break;
+    }
+    interval_t round_trip = lf_time_physical() - sent;
+    total_round_trip += round_trip;
+    if (round_trip > max_round_trip) {
+      max_round_trip = round_trip;
+    }
+    probes++;
+    send_tag(2, MSG_TYPE_LATEST_TAG_CONFIRMED, next);
+  }
+
+  void* result;
+  lf_thread_join(sender_thread, &result);
+  lf_thread_join(sink_thread, &result);
+  for (int i = 0; i < 4; i++) {
+    synthetic_federate_resign(nets[i]);
+  }
+  stop_synthetic_rti();
+  if (control_lanes) {
+    // The RTI has closed the control lanes.
+    lf_thread_join(grant_reader_thread, &result);
+    for (int i = 0; i < 4; i++) {
+      shutdown_net(control_nets[i], false);
+    }
+  }
+
+  double seconds = (double)forwarding_time / BILLION;
+  printf("Forwarded %zu messages of %zu bytes to federate %u in %.3f s: %.1f MB/s\n", num_messages, payload_size,
+         destination, seconds, (double)(num_messages * payload_size) / seconds / 1e6);
+  printf("LTC to TAG round trips during forwarding, %s: %zu, mean %.1f us, max %.1f us\n",
+         control_lanes ? "control lanes" : "single connections", probes,
+         probes > 0 ? (double)total_round_trip / (double)probes / 1e3 : 0.0, (double)max_round_trip / 1e3);
+  return 0;
+}
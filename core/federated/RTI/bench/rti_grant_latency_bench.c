@@ -0,0 +1,170 @@
+/**
+ * @file rti_grant_latency_bench.c
+ * @brief Benchmark of the latency of tag advance grants as the number of federates grows.
+ *
+ * Synthetic federates join an RTI running in the same process. Federate 0 is the only upstream
+ * of all others. In each round, every other federate sends a next event tag (NET) for the next
+ * tag and, once all have done so, federate 0 confirms that tag as completed (LTC). The RTI can
+ * then grant the tag to every other federate. The benchmark reports the time from the LTC to the
+ * arrival of each tag advance grant (TAG). With `-e`, the RTI serves the federates from an
+ * event loop run by the given number of threads instead of one thread per federate.
+ *
+ * Downstream next event tags are disabled because federate 0 does not read from the RTI.
+ *
+ * Usage: rti_grant_latency_bench [-f <federates>] [-r <rounds>] [-e <event loop threads>]
+ *
+ * For example, to compare both modes of the RTI at 10, 100 and 1000 federates:
+ *
+ *     for f in 10 100 1000; do
+ *       rti_grant_latency_bench -f $f; rti_grant_latency_bench -f $f -e 4
+ *     done
+ */
+
+#include <stdio.h>
+
+#include "synthetic_federate.h"
+
+static int num_federates = 10;
+static int num_rounds = 100;
+static net_abstraction_t* nets;
+static instant_t start_time_of_federation;
+
+/** Physical time at which federate 0 confirmed the tag of each round. */
+static volatile instant_t* confirmed_at;
+
+/** Grant latencies, indexed by federate minus one and then by round. */
+static interval_t* latencies;
+
+static lf_mutex_t mutex;
+static lf_cond_t net_sent;
+
+/** Number of NETs sent by all federates other than federate 0 so far. */
+static int nets_sent = 0;
+
+static tag_t tag_of_round(int round) { return (tag_t){.time = start_time_of_federation + round + 1, .microstep = 0}; }
+
+static void* follower(void* arg) {
+  int id = (int)(intptr_t)arg;
+  for (int round = 0; round < num_rounds; round++) {
+    tag_t next = tag_of_round(round);
+    synthetic_federate_send_tag(nets[id], MSG_TYPE_NEXT_EVENT_TAG, next);
+    LF_MUTEX_LOCK(&mutex);
+    nets_sent++;
+    lf_cond_signal(&net_sent);
+    LF_MUTEX_UNLOCK(&mutex);
+
+    tag_t granted;
+    size_t length;
+    while (synthetic_federate_receive(nets[id], &granted, NULL, 0, &length) != MSG_TYPE_TAG_ADVANCE_GRANT ||
+           lf_tag_compare(granted, next) < 0) {
+    }
+    latencies[(size_t)(id - 1) * num_rounds + round] = lf_time_physical() - confirmed_at[round];
+    synthetic_federate_send_tag(nets[id], MSG_TYPE_LATEST_TAG_CONFIRMED, next);
+  }
+  return NULL;
+}
+
+static int compare_intervals(const void* a, const void* b) {
+  interval_t x = *(const interval_t*)a;
+  interval_t y = *(const interval_t*)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, const char* argv[]) {
+  int event_loop_threads = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      num_federates = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      num_rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      event_loop_threads = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [-f <federates>] [-r <rounds>] [-e <event loop threads>]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (num_federates < 2 || num_federates > UINT16_MAX || num_rounds <= 0 || event_loop_threads < 0) {
+    fprintf(stderr, "There must be at least two federates, at least one round, and no negative thread count.\n");
+    return 1;
+  }
+  initialize_lf_thread_id();
+  LF_MUTEX_INIT(&mutex);
+  LF_COND_INIT(&net_sent, &mutex);
+
+  nets = (net_abstraction_t*)calloc(num_federates, sizeof(net_abstraction_t));
+  confirmed_at = (instant_t*)calloc(num_rounds, sizeof(instant_t));
+  latencies = (interval_t*)calloc((size_t)(num_federates - 1) * num_rounds, sizeof(interval_t));
+  uint16_t* followers = (uint16_t*)calloc(num_federates - 1, sizeof(uint16_t));
+  LF_ASSERT_NON_NULL(nets);
+  LF_ASSERT_NON_NULL(confirmed_at);
+  LF_ASSERT_NON_NULL(latencies);
+  LF_ASSERT_NON_NULL(followers);
+  for (int i = 1; i < num_federates; i++) {
+    followers[i - 1] = (uint16_t)i;
+  }
+
+  uint16_t rti_port = start_synthetic_rti(num_federates, event_loop_threads);
+  synthetic_rti.base.dnet_disabled = true;
+  uint16_t leader = 0;
+  nets[0] = synthetic_federate_connect(rti_port, 0, 0, NULL, num_federates - 1, followers);
+  for (int i = 1; i < num_federates; i++) {
+    nets[i] = synthetic_federate_connect(rti_port, (uint16_t)i, 1, &leader, 0, NULL);
+  }
+  for (int i = 0; i < num_federates; i++) {
+    synthetic_federate_send_timestamp(nets[i]);
+  }
+  for (int i = 0; i < num_federates; i++) {
+    start_time_of_federation = synthetic_federate_receive_start_time(nets[i]);
+  }
+
+  lf_thread_t* threads = (lf_thread_t*)calloc(num_federates, sizeof(lf_thread_t));
+  LF_ASSERT_NON_NULL(threads);
+  for (int i = 1; i < num_federates; i++) {
+    lf_thread_create(&threads[i], follower, (void*)(intptr_t)i);
+  }
+  instant_t start = lf_time_physical();
+  for (int round = 0; round < num_rounds; round++) {
+    LF_MUTEX_LOCK(&mutex);
+    while (nets_sent < (num_federates - 1) * (round + 1)) {
+      lf_cond_wait(&net_sent);
+    }
+    LF_MUTEX_UNLOCK(&mutex);
+    confirmed_at[round] = lf_time_physical();
+    synthetic_federate_send_tag(nets[0], MSG_TYPE_LATEST_TAG_CONFIRMED, tag_of_round(round));
+  }
+  void* result;
+  for (int i = 1; i < num_federates; i++) {
+    lf_thread_join(threads[i], &result);
+  }
+  interval_t elapsed = lf_time_physical() - start;
+  for (int i = 0; i < num_federates; i++) {
+    synthetic_federate_resign(nets[i]);
+  }
+  stop_synthetic_rti();
+
+  size_t count = (size_t)(num_federates - 1) * num_rounds;
+  qsort(latencies, count, sizeof(interval_t), compare_intervals);
+  double total = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    total += (double)latencies[i];
+  }
+  char mode[64];
+  if (event_loop_threads > 0) {
+    snprintf(mode, sizeof(mode), "event loop with %d threads", event_loop_threads);
+  } else {
+    snprintf(mode, sizeof(mode), "thread per federate");
+  }
+  printf("%d federates, %s: %d rounds in %.3f s, %.0f grants/s\n", num_federates, mode, num_rounds,
+         (double)elapsed / BILLION, (double)count / ((double)elapsed / BILLION));
+  printf("LTC to TAG latency: mean %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n", total / (double)count / 1e3,
+         (double)latencies[count / 2] / 1e3, (double)latencies[count * 99 / 100] / 1e3,
+         (double)latencies[count - 1] / 1e3);
+
+  free(threads);
+  free(followers);
+  free(latencies);
+  free((void*)confirmed_at);
+  free(nets);
+  return 0;
+}
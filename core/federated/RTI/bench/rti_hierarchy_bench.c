@@ -0,0 +1,317 @@
+/**
+ * @file rti_hierarchy_bench.c
+ * @brief Benchmark of a hierarchical federation, with an RTI per cluster, against a flat one.
+ *
+ * The RTIs run as separate processes of the RTI program, and synthetic federates in this process
+ * join them. First, one RTI coordinates all federates. Then a root RTI coordinates one cluster RTI
+ * per cluster of federates, and each federate joins the RTI of its cluster. In both cases, the
+ * federates run rounds as in rti_grant_latency_bench: every follower sends a next event tag (NET)
+ * for the next tag and, once all have done so, the leaders confirm that tag as completed (LTC),
+ * after which the followers can be granted the tag. The benchmark reports the time from the LTC to
+ * the arrival of each tag advance grant (TAG) and the CPU time used by the RTI processes.
+ *
+ * By default, the first federate of each cluster leads the others in the cluster, so that the
+ * clusters are independent. With `-g`, federate 0 leads all others, so that most grants depend on
+ * a cluster other than the follower's own, and go through the root RTI.
+ *
+ * Usage: rti_hierarchy_bench [-f <federates>] [-c <cluster size>] [-r <rounds>] [-g] [-P <base port>]
+ *                            [-b <RTI program>]
+ *
+ * The RTIs listen on consecutive ports from the base port.
+ */
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "synthetic_federate.h"
+
+extern char** environ;
+
+static int num_federates = 16;
+static int cluster_size = 4;
+static int num_rounds = 100;
+static bool global_leader = false;
+static int base_port = 15100;
+static const char* rti_program = RTI_BINARY;
+
+static net_abstraction_t* nets;
+static lf_thread_t* threads;
+static instant_t start_time_of_federation;
+
+/** The leader of each federate, or -1 for a leader. */
+static int* leader_of;
+
+/** The number of federates that are not leaders. */
+static int num_followers;
+
+/** Physical time at which the leaders confirmed the tag of each round. */
+static volatile instant_t* confirmed_at;
+
+/** Grant latencies, indexed by federate and then by round. Those of leaders are unused. */
+static interval_t* latencies;
+
+static lf_mutex_t mutex;
+static lf_cond_t net_sent;
+
+/** Number of NETs sent by all followers so far. */
+static int nets_sent = 0;
+
+static tag_t tag_of_round(int round) { return (tag_t){.time = start_time_of_federation + round + 1, .microstep = 0}; }
+
+static void* follower(void* arg) {
+  int id = (int)(intptr_t)arg;
+  for (int round = 0; round < num_rounds; round++) {
+    tag_t next = tag_of_round(round);
+    synthetic_federate_send_tag(nets[id], MSG_TYPE_NEXT_EVENT_TAG, next);
+    LF_MUTEX_LOCK(&mutex);
+    nets_sent++;
+    lf_cond_signal(&net_sent);
+    LF_MUTEX_UNLOCK(&mutex);
+
+    tag_t granted;
+    size_t length;
+    while (synthetic_federate_receive(nets[id], &granted, NULL, 0, &length) != MSG_TYPE_TAG_ADVANCE_GRANT ||
+           lf_tag_compare(granted, next) < 0) {
+    }
+    latencies[(size_t)id * num_rounds + round] = lf_time_physical() - confirmed_at[round];
+    synthetic_federate_send_tag(nets[id], MSG_TYPE_LATEST_TAG_CONFIRMED, next);
+  }
+  return NULL;
+}
+
+static int compare_intervals(const void* a, const void* b) {
+  interval_t x = *(const interval_t*)a;
+  interval_t y = *(const interval_t*)b;
+  return (x > y) - (x < y);
+}
+
+/** Start the RTI program with the given arguments, discarding its standard output. */
+static pid_t spawn_rti(const char* arguments[]) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  pid_t pid;
+  int result = posix_spawn(&pid, rti_program, &actions, NULL, (char* const*)arguments, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (result != 0) {
+    lf_print_error_and_exit("Failed to start the RTI program %s: %s.", rti_program, strerror(result));
+  }
+  return pid;
+}
+
+/** Wait for an RTI process to exit and return the CPU time it used. */
+static interval_t wait_for_rti(pid_t pid) {
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    lf_print_error_and_exit("An RTI process failed.");
+  }
+  return SEC(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + USEC(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * Run the rounds with all federates joining the RTI at the given port, or, if `hierarchical`,
+ * the RTI of their cluster, and report the results.
+ */
+static void run(bool hierarchical) {
+  int num_clusters = num_federates / cluster_size;
+  int num_rtis = hierarchical ? num_clusters + 1 : 1;
+  pid_t* pids = (pid_t*)calloc(num_rtis, sizeof(pid_t));
+  LF_ASSERT_NON_NULL(pids);
+  char federates_argument[16];
+  char cluster_size_argument[16];
+  char cluster_argument[16];
+  char port_argument[16];
+  char parent_port_argument[16];
+  snprintf(cluster_size_argument, sizeof(cluster_size_argument), "%d", cluster_size);
+  if (!hierarchical) {
+    snprintf(federates_argument, sizeof(federates_argument), "%d", num_federates);
+    snprintf(port_argument, sizeof(port_argument), "%d", base_port);
+    const char* arguments[] = {rti_program, "-n", federates_argument, "-p", port_argument, "-c", "off", "-d", NULL};
+    pids[0] = spawn_rti(arguments);
+  } else {
+    snprintf(federates_argument, sizeof(federates_argument), "%d", num_clusters);
+    snprintf(parent_port_argument, sizeof(parent_port_argument), "%d", base_port + 1);
+    const char* root_arguments[] = {
+        rti_program, "-n", federates_argument, "--cluster_size", cluster_size_argument, "-p", parent_port_argument,
+        NULL};
+    pids[0] = spawn_rti(root_arguments);
+    for (int c = 0; c < num_clusters; c++) {
+      snprintf(cluster_argument, sizeof(cluster_argument), "%d", c);
+      snprintf(port_argument, sizeof(port_argument), "%d", base_port + 2 + c);
+      const char* arguments[] = {rti_program,
+                                 "-n",
+                                 cluster_size_argument,
+                                 "--cluster_size",
+                                 cluster_size_argument,
+                                 "--cluster",
+                                 cluster_argument,
+                                 "127.0.0.1",
+                                 parent_port_argument,
+                                 "-p",
+                                 port_argument,
+                                 "-c",
+                                 "off",
+                                 NULL};
+      pids[c + 1] = spawn_rti(arguments);
+    }
+  }
+
+  // Declare the topology. Each leader is upstream of its followers.
+  uint16_t* followers = (uint16_t*)calloc(num_federates, sizeof(uint16_t));
+  LF_ASSERT_NON_NULL(followers);
+  for (int i = 0; i < num_federates; i++) {
+    int port = hierarchical ? base_port + 2 + i / cluster_size : base_port;
+    if (leader_of[i] < 0) {
+      int count = 0;
+      for (int j = 0; j < num_federates; j++) {
+        if (leader_of[j] == i) {
+          followers[count++] = (uint16_t)j;
+        }
+      }
+      nets[i] = synthetic_federate_connect((uint16_t)port, (uint16_t)i, 0, NULL, count, followers);
+    } else {
+      uint16_t leader = (uint16_t)leader_of[i];
+      nets[i] = synthetic_federate_connect((uint16_t)port, (uint16_t)i, 1, &leader, 0, NULL);
+    }
+  }
+  free(followers);
+  for (int i = 0; i < num_federates; i++) {
+    synthetic_federate_send_timestamp(nets[i]);
+  }
+  for (int i = 0; i < num_federates; i++) {
+    start_time_of_federation = synthetic_federate_receive_start_time(nets[i]);
+  }
+
+  nets_sent = 0;
+  for (int i = 0; i < num_federates; i++) {
+    if (leader_of[i] >= 0) {
+      lf_thread_create(&threads[i], follower, (void*)(intptr_t)i);
+    }
+  }
+  instant_t start = lf_time_physical();
+  for (int round = 0; round < num_rounds; round++) {
+    LF_MUTEX_LOCK(&mutex);
+    while (nets_sent < num_followers * (round + 1)) {
+      lf_cond_wait(&net_sent);
+    }
+    LF_MUTEX_UNLOCK(&mutex);
+    confirmed_at[round] = lf_time_physical();
+    for (int i = 0; i < num_federates; i++) {
+      if (leader_of[i] < 0) {
+        synthetic_federate_send_tag(nets[i], MSG_TYPE_LATEST_TAG_CONFIRMED, tag_of_round(round));
+      }
+    }
+  }
+  void* result;
+  for (int i = 0; i < num_federates; i++) {
+    if (leader_of[i] >= 0) {
+      lf_thread_join(threads[i], &result);
+    }
+  }
+  interval_t elapsed = lf_time_physical() - start;
+  for (int i = 0; i < num_federates; i++) {
+    synthetic_federate_resign(nets[i]);
+  }
+  interval_t total_cpu = 0;
+  interval_t max_cpu = 0;
+  for (int i = 0; i < num_rtis; i++) {
+    interval_t cpu = wait_for_rti(pids[i]);
+    total_cpu += cpu;
+    if (cpu > max_cpu) {
+      max_cpu = cpu;
+    }
+  }
+
+  // Collect the latencies of the followers.
+  size_t count = 0;
+  for (int i = 0; i < num_federates; i++) {
+    if (leader_of[i] >= 0) {
+      memmove(&latencies[count], &latencies[(size_t)i * num_rounds], num_rounds * sizeof(interval_t));
+      count += num_rounds;
+    }
+  }
+  qsort(latencies, count, sizeof(interval_t), compare_intervals);
+  double total = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    total += (double)latencies[i];
+  }
+  if (hierarchical) {
+    printf("Hierarchical, %d clusters of %d federates: %d rounds in %.3f s\n", num_clusters, cluster_size, num_rounds,
+           (double)elapsed / BILLION);
+  } else {
+    printf("Flat, %d federates: %d rounds in %.3f s\n", num_federates, num_rounds, (double)elapsed / BILLION);
+  }
+  printf("  LTC to TAG latency: mean %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n",
+         total / (double)count / 1e3, (double)latencies[count / 2] / 1e3, (double)latencies[count * 99 / 100] / 1e3,
+         (double)latencies[count - 1] / 1e3);
+  printf("  RTI CPU time: total %.1f ms in %d processes, at most %.1f ms in one\n", (double)total_cpu / MSEC(1),
+         num_rtis, (double)max_cpu / MSEC(1));
+
+  free(pids);
+}
+
+int main(int argc, const char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      num_federates = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      cluster_size = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      num_rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-g") == 0) {
+      global_leader = true;
+    } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+      base_port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      rti_program = argv[++i];
+    } else {
+      fprintf(stderr,
+              "Usage: %s [-f <federates>] [-c <cluster size>] [-r <rounds>] [-g] [-P <base port>] [-b <RTI program>]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (cluster_size < 2 || num_federates < cluster_size || num_federates % cluster_size != 0 || num_rounds <= 0 ||
+      base_port <= 0 || base_port + 2 + num_federates / cluster_size >= UINT16_MAX) {
+    fprintf(stderr, "The federates must form clusters of at least two, with at least one round and valid ports.\n");
+    return 1;
+  }
+  initialize_lf_thread_id();
+  LF_MUTEX_INIT(&mutex);
+  LF_COND_INIT(&net_sent, &mutex);
+  // The federation ID of the RTI program by default.
+  synthetic_rti.federation_id = "Unidentified Federation";
+
+  nets = (net_abstraction_t*)calloc(num_federates, sizeof(net_abstraction_t));
+  threads = (lf_thread_t*)calloc(num_federates, sizeof(lf_thread_t));
+  leader_of = (int*)calloc(num_federates, sizeof(int));
+  confirmed_at = (instant_t*)calloc(num_rounds, sizeof(instant_t));
+  latencies = (interval_t*)calloc((size_t)num_federates * num_rounds, sizeof(interval_t));
+  LF_ASSERT_NON_NULL(nets);
+  LF_ASSERT_NON_NULL(threads);
+  LF_ASSERT_NON_NULL(leader_of);
+  LF_ASSERT_NON_NULL(confirmed_at);
+  LF_ASSERT_NON_NULL(latencies);
+  num_followers = 0;
+  for (int i = 0; i < num_federates; i++) {
+    int leader = global_leader ? 0 : i - i % cluster_size;
+    leader_of[i] = leader == i ? -1 : leader;
+    if (leader_of[i] >= 0) {
+      num_followers++;
+    }
+  }
+
+  run(false);
+  run(true);
+
+  free(latencies);
+  free((void*)confirmed_at);
+  free(leader_of);
+  free(threads);
+  free(nets);
+  return 0;
+}
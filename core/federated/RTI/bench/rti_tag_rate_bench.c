@@ -0,0 +1,133 @@
+/**
+ * @file rti_tag_rate_bench.c
+ * @brief Benchmark of the rate at which federates advance tags through the RTI.
+ *
+ * Synthetic federates join an RTI running in the same process. They form a chain, each one
+ * upstream of the next with no delay, and each advances through the given number of tags as
+ * fast as the RTI lets it. At each tag, a federate other than the first waits for the tag advance
+ * grant (TAG) of that tag. It then confirms the tag as completed (LTC) and sends the next tag
+ * as its next event tag (NET), which is what a federate under centralized coordination does
+ * after executing a tag. By default, the LTC and the NET are sent as two messages, as federates
+ * used to. With `-m`, they are merged into one next message request (NMR). The benchmark
+ * reports the number of tags that all federates together complete per second. With `-e`, the
+ * RTI serves the federates from an event loop run by the given number of threads.
+ *
+ * Downstream next event tags are disabled because the first federate does not read from the RTI.
+ *
+ * Usage: rti_tag_rate_bench [-f <federates>] [-t <tags>] [-e <event loop threads>] [-m]
+ *
+ * For example, to compare both ways of sending the tags:
+ *
+ *     rti_tag_rate_bench -f 10; rti_tag_rate_bench -f 10 -m
+ */
+
+#include <stdio.h>
+
+#include "synthetic_federate.h"
+
+static int num_federates = 10;
+static int num_tags = 10000;
+static bool merged = false;
+static net_abstraction_t* nets;
+static instant_t start_time_of_federation;
+
+static tag_t tag_at(int index) { return (tag_t){.time = start_time_of_federation + index, .microstep = 0}; }
+
+/** Confirm a tag and send the next one as the next event tag. */
+static void send_tags(net_abstraction_t net, tag_t completed, tag_t next) {
+  if (!merged) {
+    synthetic_federate_send_tag(net, MSG_TYPE_LATEST_TAG_CONFIRMED, completed);
+    synthetic_federate_send_tag(net, MSG_TYPE_NEXT_EVENT_TAG, next);
+    return;
+  }
+  unsigned char buffer[MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH];
+  buffer[0] = MSG_TYPE_NEXT_MESSAGE_REQUEST;
+  encode_tag(&buffer[1], completed);
+  encode_tag(&buffer[1 + SYNTHETIC_TAG_LENGTH], next);
+  synthetic_write(net, sizeof(buffer), buffer);
+}
+
+static void* federate(void* arg) {
+  int id = (int)(intptr_t)arg;
+  synthetic_federate_send_tag(nets[id], MSG_TYPE_NEXT_EVENT_TAG, tag_at(1));
+  // The first federate has no upstream and needs no grant.
+  tag_t granted = id > 0 ? NEVER_TAG : FOREVER_TAG;
+  for (int index = 1; index <= num_tags; index++) {
+    tag_t tag = tag_at(index);
+    // A grant can arrive before the federate sends the NET for its tag, so it may already have one.
+    while (lf_tag_compare(granted, tag) < 0) {
+      tag_t received;
+      size_t length;
+      if (synthetic_federate_receive(nets[id], &received, NULL, 0, &length) == MSG_TYPE_TAG_ADVANCE_GRANT) {
+        granted = received;
+      }
+    }
+    send_tags(nets[id], tag, tag_at(index + 1));
+  }
+  return NULL;
+}
+
+int main(int argc, const char* argv[]) {
+  int event_loop_threads = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      num_federates = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      num_tags = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      event_loop_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-m") == 0) {
+      merged = true;
+    } else {
+      fprintf(stderr, "Usage: %s [-f <federates>] [-t <tags>] [-e <event loop threads>] [-m]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (num_federates < 2 || num_federates > UINT16_MAX || num_tags <= 0 || event_loop_threads < 0) {
+    fprintf(stderr, "There must be at least two federates, at least one tag, and no negative thread count.\n");
+    return 1;
+  }
+  initialize_lf_thread_id();
+
+  nets = (net_abstraction_t*)calloc(num_federates, sizeof(net_abstraction_t));
+  LF_ASSERT_NON_NULL(nets);
+  uint16_t rti_port = start_synthetic_rti(num_federates, event_loop_threads);
+  synthetic_rti.base.dnet_disabled = true;
+  for (int i = 0; i < num_federates; i++) {
+    uint16_t upstream = (uint16_t)(i - 1);
+    uint16_t downstream = (uint16_t)(i + 1);
+    nets[i] = synthetic_federate_connect(rti_port, (uint16_t)i, i > 0 ? 1 : 0, &upstream,
+                                         i < num_federates - 1 ? 1 : 0, &downstream);
+  }
+  for (int i = 0; i < num_federates; i++) {
+    synthetic_federate_send_timestamp(nets[i]);
+  }
+  for (int i = 0; i < num_federates; i++) {
+    start_time_of_federation = synthetic_federate_receive_start_time(nets[i]);
+  }
+
+  lf_thread_t* threads = (lf_thread_t*)calloc(num_federates, sizeof(lf_thread_t));
+  LF_ASSERT_NON_NULL(threads);
+  instant_t start = lf_time_physical();
+  for (int i = 0; i < num_federates; i++) {
+    lf_thread_create(&threads[i], federate, (void*)(intptr_t)i);
+  }
+  void* result;
+  for (int i = 0; i < num_federates; i++) {
+    lf_thread_join(threads[i], &result);
+  }
+  interval_t elapsed = lf_time_physical() - start;
+  for (int i = 0; i < num_federates; i++) {
+    synthetic_federate_resign(nets[i]);
+  }
+  stop_synthetic_rti();
+
+  double seconds = (double)elapsed / BILLION;
+  size_t tags = (size_t)num_federates * (size_t)num_tags;
+  printf("%d federates, %s, %s: %d tags in %.3f s, %.0f tags/s\n", num_federates, merged ? "NMR" : "LTC and NET",
+         event_loop_threads > 0 ? "event loop" : "thread per federate", num_tags, seconds, (double)tags / seconds);
+
+  free(threads);
+  free(nets);
+  return 0;
+}
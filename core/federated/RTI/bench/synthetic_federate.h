@@ -0,0 +1,325 @@
+/**
+ * @file synthetic_federate.h
+ * @brief Synthetic federates and an in-process RTI for benchmarking and testing the RTI.
+ *
+ * A synthetic federate speaks just enough of the federate side of the protocol in @ref net_common.h
+ * to join a federation, exchange tags and tagged messages with the RTI, and resign. It does not
+ * authenticate and does not take part in clock synchronization. The RTI runs in the same process,
+ * listening on an ephemeral port, so that a benchmark needs no launcher.
+ *
+ * This header is included by exactly one benchmark or test source file.
+ */
+
+#ifndef SYNTHETIC_FEDERATE_H
+#define SYNTHETIC_FEDERATE_H
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "rti_remote.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+/** Length of the header of a tagged message, following its type byte. */
+#define SYNTHETIC_TAGGED_HEADER_LENGTH                                                                                 \
+  (sizeof(uint16_t) + sizeof(uint16_t) + sizeof(int32_t) + sizeof(instant_t) + sizeof(microstep_t))
+
+/** Length of a message carrying a tag, following its type byte. */
+#define SYNTHETIC_TAG_LENGTH (sizeof(instant_t) + sizeof(microstep_t))
+
+/** The RTI running in this process. */
+static rti_remote_t synthetic_rti;
+
+/** Thread running wait_for_federates() for the RTI in this process. */
+static lf_thread_t synthetic_rti_thread;
+
+static void* synthetic_rti_main(void* ignored) {
+  (void)ignored;
+  initialize_lf_thread_id();
+  wait_for_federates();
+  return NULL;
+}
+
+/**
+ * Start an RTI for the given number of federates in this process.
+ * @param num_federates The number of federates.
+ * @param event_loop_threads The number of threads of the RTI's event loop, or 0 for one thread per federate.
+ * @return The port on which the RTI listens.
+ */
+static uint16_t start_synthetic_rti(int num_federates, int event_loop_threads) {
+  // As in the RTI program, a write to a federate that has closed its connection must fail rather than
+  // terminate the process, which can happen when the RTI grants a tag to a federate that has resigned.
+  signal(SIGPIPE, SIG_IGN);
+  initialize_RTI(&synthetic_rti);
+  synthetic_rti.user_specified_port = 0;
+  synthetic_rti.event_loop_threads = event_loop_threads;
+  synthetic_rti.base.number_of_scheduling_nodes = (uint16_t)num_federates;
+  synthetic_rti.base.scheduling_nodes = (scheduling_node_t**)calloc(num_federates, sizeof(scheduling_node_t*));
+  LF_ASSERT_NON_NULL(synthetic_rti.base.scheduling_nodes);
+  for (uint16_t i = 0; i < num_federates; i++) {
+    federate_info_t* fed_info = (federate_info_t*)calloc(1, sizeof(federate_info_t));
+    LF_ASSERT_NON_NULL(fed_info);
+    initialize_federate(fed_info, i);
+    synthetic_rti.base.scheduling_nodes[i] = (scheduling_node_t*)fed_info;
+  }
+  if (start_rti_server() != 0) {
+    lf_print_error_and_exit("Failed to start the RTI.");
+  }
+  uint16_t port = (uint16_t)get_my_port(synthetic_rti.rti_net);
+  lf_thread_create(&synthetic_rti_thread, synthetic_rti_main, NULL);
+  return port;
+}
+
+/** Wait for all federates to resign from the RTI in this process. */
+static void stop_synthetic_rti(void) {
+  void* result;
+  lf_thread_join(synthetic_rti_thread, &result);
+}
+
+/** Write to a synthetic federate's connection, exiting on failure. */
+static void synthetic_write(net_abstraction_t net, size_t length, unsigned char* buffer) {
+  if (write_to_net(net, length, buffer)) {
+    lf_print_error_and_exit("Synthetic federate failed to write to the RTI.");
+  }
+}
+
+/** Read from a synthetic federate's connection, exiting on failure. */
+static void synthetic_read(net_abstraction_t net, size_t length, unsigned char* buffer) {
+  if (read_from_net(net, length, buffer)) {
+    lf_print_error_and_exit("Synthetic federate failed to read from the RTI.");
+  }
+}
+
+/**
+ * Open a connection of a synthetic federate to the RTI and identify the federate on it.
+ * @param type MSG_TYPE_FED_IDS_NMR for the main connection or MSG_TYPE_CONTROL_LANE for the control lane.
+ */
+static net_abstraction_t synthetic_federate_open(uint16_t rti_port, uint16_t id, unsigned char type) {
+#ifdef COMM_TYPE_SHM
+  shm_connection_params_t params = {.socket_params = {.type = TCP, .port = rti_port, .server_hostname = "127.0.0.1"}};
+#else
+  socket_connection_params_t params = {.type = TCP, .port = rti_port, .server_hostname = "127.0.0.1"};
+#endif
+  net_abstraction_t net = connect_to_net((net_params_t)&params);
+  if (net == NULL) {
+    lf_print_error_and_exit("Synthetic federate %u failed to connect to the RTI.", id);
+  }
+  const char* federation_id = synthetic_rti.federation_id;
+  size_t federation_id_length = strlen(federation_id);
+  unsigned char ids[1 + sizeof(uint16_t) + 1 + 255];
+  ids[0] = type;
+  encode_uint16(id, &ids[1]);
+  ids[1 + sizeof(uint16_t)] = (unsigned char)federation_id_length;
+  memcpy(&ids[2 + sizeof(uint16_t)], federation_id, federation_id_length);
+  synthetic_write(net, 2 + sizeof(uint16_t) + federation_id_length, ids);
+  unsigned char ack;
+  synthetic_read(net, 1, &ack);
+  if (ack != MSG_TYPE_ACK) {
+    lf_print_error_and_exit("The RTI rejected synthetic federate %u.", id);
+  }
+  return net;
+}
+
+/**
+ * Open the control lane of a synthetic federate (@see MSG_TYPE_CONTROL_LANE).
+ * This must precede synthetic_federate_connect() for the same federate.
+ * @return The control lane.
+ */
+static net_abstraction_t synthetic_federate_connect_control_lane(uint16_t rti_port, uint16_t id) {
+  return synthetic_federate_open(rti_port, id, MSG_TYPE_CONTROL_LANE);
+}
+
+/**
+ * Declare the neighbors of a synthetic federate, all with zero delay, completing its handshake.
+ * @param net A connection opened with synthetic_federate_open().
+ */
+static void synthetic_federate_declare_neighbors(net_abstraction_t net, int num_upstreams, const uint16_t* upstreams,
+                                                 int num_downstreams, const uint16_t* downstreams) {
+  size_t length = MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE +
+                  num_upstreams * (sizeof(uint16_t) + sizeof(int64_t)) + num_downstreams * sizeof(uint16_t);
+  unsigned char* neighbors = (unsigned char*)malloc(length);
+  LF_ASSERT_NON_NULL(neighbors);
+  neighbors[0] = MSG_TYPE_NEIGHBOR_STRUCTURE;
+  encode_int32(num_upstreams, &neighbors[1]);
+  encode_int32(num_downstreams, &neighbors[1 + sizeof(int32_t)]);
+  size_t head = MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE;
+  for (int i = 0; i < num_upstreams; i++) {
+    encode_uint16(upstreams[i], &neighbors[head]);
+    head += sizeof(uint16_t);
+    encode_int64(0, &neighbors[head]);
+    head += sizeof(int64_t);
+  }
+  for (int i = 0; i < num_downstreams; i++) {
+    encode_uint16(downstreams[i], &neighbors[head]);
+    head += sizeof(uint16_t);
+  }
+  synthetic_write(net, length, neighbors);
+  free(neighbors);
+
+  // Opt out of clock synchronization.
+  unsigned char udp_port[1 + sizeof(uint16_t)];
+  udp_port[0] = MSG_TYPE_UDP_PORT;
+  encode_uint16(UINT16_MAX, &udp_port[1]);
+  synthetic_write(net, sizeof(udp_port), udp_port);
+}
+
+/**
+ * Connect a synthetic federate to the RTI and declare its neighbors, all with zero delay.
+ * @return The connection to the RTI.
+ */
+static net_abstraction_t synthetic_federate_connect(uint16_t rti_port, uint16_t id, int num_upstreams,
+                                                    const uint16_t* upstreams, int num_downstreams,
+                                                    const uint16_t* downstreams) {
+  // Synthetic federates may send next message requests.
+  net_abstraction_t net = synthetic_federate_open(rti_port, id, MSG_TYPE_FED_IDS_NMR);
+  synthetic_federate_declare_neighbors(net, num_upstreams, upstreams, num_downstreams, downstreams);
+  return net;
+}
+
+/** Propose a start time to the RTI. */
+static void synthetic_federate_send_timestamp(net_abstraction_t net) {
+  unsigned char buffer[MSG_TYPE_TIMESTAMP_LENGTH];
+  buffer[0] = MSG_TYPE_TIMESTAMP;
+  encode_int64(lf_time_physical(), &buffer[1]);
+  synthetic_write(net, sizeof(buffer), buffer);
+}
+
+/** Wait for the start time from the RTI. */
+static instant_t synthetic_federate_receive_start_time(net_abstraction_t net) {
+  unsigned char buffer[MSG_TYPE_TIMESTAMP_LENGTH];
+  synthetic_read(net, sizeof(buffer), buffer);
+  if (buffer[0] != MSG_TYPE_TIMESTAMP) {
+    lf_print_error_and_exit("Synthetic federate expected a start time. Got message type %u.", buffer[0]);
+  }
+  return extract_int64(&buffer[1]);
+}
+
+/** Send a message carrying only a tag, such as a NET or an LTC. */
+static void synthetic_federate_send_tag(net_abstraction_t net, unsigned char type, tag_t tag) {
+  unsigned char buffer[1 + SYNTHETIC_TAG_LENGTH];
+  buffer[0] = type;
+  encode_tag(&buffer[1], tag);
+  synthetic_write(net, sizeof(buffer), buffer);
+}
+
+/**
+ * Send a message carrying only a tag, such as a NET or an LTC, on a control lane.
+ * @param fence The number of tagged messages that the federate has sent to the RTI so far.
+ */
+static void synthetic_federate_send_control_tag(net_abstraction_t net, unsigned char type, tag_t tag, int64_t fence) {
+  unsigned char buffer[1 + SYNTHETIC_TAG_LENGTH + CONTROL_LANE_FENCE_LENGTH];
+  buffer[0] = type;
+  encode_tag(&buffer[1], tag);
+  encode_int64(fence, &buffer[1 + SYNTHETIC_TAG_LENGTH]);
+  synthetic_write(net, sizeof(buffer), buffer);
+}
+
+/** Send a tagged message to a port of another federate through the RTI. */
+static void synthetic_federate_send_message(net_abstraction_t net, uint16_t port, uint16_t federate, tag_t tag,
+                                            size_t length, unsigned char* payload) {
+  unsigned char header[1 + SYNTHETIC_TAGGED_HEADER_LENGTH];
+  header[0] = MSG_TYPE_TAGGED_MESSAGE;
+  encode_uint16(port, &header[1]);
+  encode_uint16(federate, &header[1 + sizeof(uint16_t)]);
+  encode_int32((int32_t)length, &header[1 + 2 * sizeof(uint16_t)]);
+  encode_tag(&header[1 + 2 * sizeof(uint16_t) + sizeof(int32_t)], tag);
+  struct iovec vectors[] = {{.iov_base = header, .iov_len = sizeof(header)}, {.iov_base = payload, .iov_len = length}};
+  if (write_to_net_v(net, vectors, 2)) {
+    lf_print_error_and_exit("Synthetic federate failed to send a tagged message.");
+  }
+}
+
+/**
+ * Receive the next message from the RTI.
+ * @param net The connection to the RTI.
+ * @param tag Where to put the tag of the message, if it has one.
+ * @param payload Where to put the payload of a tagged message.
+ * @param capacity The size of the payload buffer.
+ * @param length Where to put the length of the payload of a tagged message.
+ * @return The type of the message.
+ */
+static unsigned char synthetic_federate_receive(net_abstraction_t net, tag_t* tag, unsigned char* payload,
+                                                size_t capacity, size_t* length) {
+  unsigned char type;
+  unsigned char buffer[SYNTHETIC_TAGGED_HEADER_LENGTH];
+  synthetic_read(net, 1, &type);
+  switch (type) {
+  case MSG_TYPE_TAG_ADVANCE_GRANT:
+  case MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT:
+  case MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG:
+  case MSG_TYPE_STOP_REQUEST:
+  case MSG_TYPE_STOP_GRANTED:
+    synthetic_read(net, SYNTHETIC_TAG_LENGTH, buffer);
+    *tag = extract_tag(buffer);
+    break;
+  case MSG_TYPE_PORT_ABSENT:
+    synthetic_read(net, 2 * sizeof(uint16_t) + SYNTHETIC_TAG_LENGTH, buffer);
+    *tag = extract_tag(&buffer[2 * sizeof(uint16_t)]);
+    break;
+  case MSG_TYPE_TAGGED_MESSAGE:
+    synthetic_read(net, SYNTHETIC_TAGGED_HEADER_LENGTH, buffer);
+    *length = (uint32_t)extract_int32(&buffer[2 * sizeof(uint16_t)]);
+    *tag = extract_tag(&buffer[2 * sizeof(uint16_t) + sizeof(int32_t)]);
+    if (*length > capacity) {
+      lf_print_error_and_exit("Synthetic federate received a payload of %zu bytes, more than %zu.", *length, capacity);
+    }
+    synthetic_read(net, *length, payload);
+    break;
+  default:
+    lf_print_error_and_exit("Synthetic federate received unexpected message type %u.", type);
+  }
+  return type;
+}
+
+/**
+ * Receive the next message from the RTI on a control lane.
+ * @param net The control lane.
+ * @param tag Where to put the tag of the message.
+ * @param fence Where to put the data fence of a grant, or 0 for other messages.
+ * @return The type of the message, or -1 if the RTI has closed the control lane.
+ */
+static int synthetic_federate_receive_control(net_abstraction_t net, tag_t* tag, int64_t* fence) {
+  unsigned char type;
+  unsigned char buffer[SYNTHETIC_TAG_LENGTH + CONTROL_LANE_FENCE_LENGTH];
+  if (read_from_net(net, 1, &type)) {
+    return -1;
+  }
+  bool is_grant = type == MSG_TYPE_TAG_ADVANCE_GRANT || type == MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT;
+  if (!is_grant && type != MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG) {
+    lf_print_error_and_exit("Synthetic federate received unexpected message type %u on its control lane.", type);
+  }
+  synthetic_read(net, SYNTHETIC_TAG_LENGTH + (is_grant ? CONTROL_LANE_FENCE_LENGTH : 0), buffer);
+  *tag = extract_tag(buffer);
+  *fence = is_grant ? extract_int64(&buffer[SYNTHETIC_TAG_LENGTH]) : 0;
+  return type;
+}
+
+/**
+ * Resign from the federation and close the connection. Messages that the RTI still sends are read
+ * and dropped until it closes its end, because closing a socket with unread messages resets the
+ * connection, which can make the RTI lose the messages it has not yet read, such as the
+ * resignation. The socket is shut down directly rather than with shutdown_net(), which waits for
+ * the RTI while holding a mutex that the RTI, running in the same process, needs to close its end.
+ */
+static void synthetic_federate_resign(net_abstraction_t net) {
+  unsigned char resign = MSG_TYPE_RESIGN;
+  synthetic_write(net, 1, &resign);
+#ifdef COMM_TYPE_URING
+  // The descriptor of the connection is that of its io_uring instance.
+  int socket = ((uring_priv_t*)net)->socket_priv->socket_descriptor;
+#else
+  int socket = get_net_descriptor(net);
+#endif
+  shutdown(socket, SHUT_WR);
+  unsigned char dropped[256];
+  while (recv(socket, dropped, sizeof(dropped), 0) > 0) {
+  }
+  shutdown(socket, SHUT_RD);
+}
+
+#endif // SYNTHETIC_FEDERATE_H
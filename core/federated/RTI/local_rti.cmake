@@ -11,3 +11,6 @@ list(APPEND INFO_SOURCES ${LOCAL_RTI_SOURCES})
 list(TRANSFORM LOCAL_RTI_SOURCES PREPEND federated/RTI/)
 list(APPEND REACTORC_SOURCES ${LOCAL_RTI_SOURCES})
 
+if(DEFINED LF_ENCLAVES_LOCK_FREE AND NOT CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    message(FATAL_ERROR "LF_ENCLAVES_LOCK_FREE relies on futexes and is only supported on Linux.")
+endif()
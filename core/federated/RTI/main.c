@@ -118,6 +118,16 @@ void usage(int argc, const char* argv[]) {
   lf_print("  -a, --auth Turn on HMAC authentication options.\n");
   lf_print("  -t, --tracing Turn on tracing.\n");
   lf_print("  -d, --disable_dnet Turn off the use of DNET signals.\n");
+  lf_print("  -e, --event_loop <n>");
+  lf_print("   Serve all federates from an event loop run by n threads instead of one thread per federate.");
+  lf_print("   Only available on Linux, and not with the SHM communication type.\n");
+  lf_print("  --cluster_size <n>");
+  lf_print("   Coordinate a hierarchical federation in which federates k*n to k*n+n-1 form cluster k, which");
+  lf_print("   is coordinated by an RTI of its own. Without --cluster, this is the root RTI, and");
+  lf_print("   --number_of_federates is the number of clusters.\n");
+  lf_print("  --cluster <k> <parent_host> <parent_port>");
+  lf_print("   Coordinate cluster k of a hierarchical federation, joining the root RTI at the given host");
+  lf_print("   and port. --number_of_federates is the number of federates in the cluster.\n");
   lf_print("  -sst, --sst SST config path for RTI.\n");
   lf_print("  -tls, --tls <cert_path> <key_path>   TLS certificate and private key paths.\n");
 
@@ -225,7 +235,8 @@ int process_args(int argc, const char* argv[]) {
       rti.base.number_of_scheduling_nodes = (int32_t)num_federates; // FIXME: Loses numbers on 64-bit machines
       lf_print_info("RTI: Number of federates: %d", rti.base.number_of_scheduling_nodes);
     } else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--port") == 0) {
-#if defined(COMM_TYPE_TCP) || defined(COMM_TYPE_SST) || defined(COMM_TYPE_TLS)
+#if defined(COMM_TYPE_TCP) || defined(COMM_TYPE_SST) || defined(COMM_TYPE_TLS) || defined(COMM_TYPE_SHM) ||        \
+    defined(COMM_TYPE_UDS) || defined(COMM_TYPE_URING)
       if (argc < i + 2) {
         lf_print_error("--port needs a short unsigned integer argument ( > 0 and < %d).", UINT16_MAX);
         usage(argc, argv);
@@ -323,6 +334,62 @@ int process_args(int argc, const char* argv[]) {
       rti.base.tracing_enabled = true;
     } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--dnet_disabled") == 0) {
       rti.base.dnet_disabled = true;
+    } else if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--event_loop") == 0) {
+#ifndef PLATFORM_Linux
+      lf_print_error("--event_loop is only available on Linux.");
+      usage(argc, argv);
+      return 0;
+#elif defined(COMM_TYPE_SHM)
+      // Bytes arriving in shared memory do not make the descriptor of the connection readable.
+      lf_print_error("--event_loop is not available with the SHM communication type.");
+      usage(argc, argv);
+      return 0;
+#else
+      if (argc < i + 2) {
+        lf_print_error("--event_loop needs a positive integer argument.");
+        usage(argc, argv);
+        return 0;
+      }
+      i++;
+      long threads = strtol(argv[i], NULL, 10);
+      if (threads <= 0L || threads > INT_MAX) {
+        lf_print_error("--event_loop needs a positive integer argument.");
+        usage(argc, argv);
+        return 0;
+      }
+      rti.event_loop_threads = (int)threads;
+#endif
+    } else if (strcmp(argv[i], "--cluster_size") == 0) {
+      if (argc < i + 2) {
+        lf_print_error("--cluster_size needs a positive integer argument.");
+        usage(argc, argv);
+        return 0;
+      }
+      i++;
+      long cluster_size = strtol(argv[i], NULL, 10);
+      if (cluster_size <= 0L || cluster_size >= UINT16_MAX) {
+        lf_print_error("--cluster_size needs a positive integer argument smaller than %d.", UINT16_MAX);
+        usage(argc, argv);
+        return 0;
+      }
+      rti.cluster_size = (uint16_t)cluster_size;
+    } else if (strcmp(argv[i], "--cluster") == 0) {
+      if (argc < i + 4) {
+        lf_print_error("--cluster needs three arguments: <cluster> <parent_host> <parent_port>.");
+        usage(argc, argv);
+        return 0;
+      }
+      long cluster = strtol(argv[i + 1], NULL, 10);
+      uint32_t parent_port = (uint32_t)strtoul(argv[i + 3], NULL, 10);
+      if (cluster < 0L || cluster >= UINT16_MAX || parent_port <= 0 || parent_port >= UINT16_MAX) {
+        lf_print_error("--cluster needs a non-negative cluster and a parent port ( > 0 and < %d).", UINT16_MAX);
+        usage(argc, argv);
+        return 0;
+      }
+      rti.cluster = (int32_t)cluster;
+      rti.parent_host = argv[i + 2];
+      rti.parent_port = (uint16_t)parent_port;
+      i += 3;
     } else if (strcmp(argv[i], " ") == 0) {
       // Tolerate spaces
       continue;
@@ -332,6 +399,18 @@ int process_args(int argc, const char* argv[]) {
       return 0;
     }
   }
+  if (rti.cluster >= 0) {
+    if (rti.cluster_size == 0 || rti.base.number_of_scheduling_nodes > rti.cluster_size) {
+      lf_print_error("--cluster needs --cluster_size no smaller than --number_of_federates.");
+      usage(argc, argv);
+      return 0;
+    }
+    // The members of the cluster are not told about federates outside the cluster.
+    rti.base.dnet_disabled = true;
+  } else if (rti.cluster_size > 0) {
+    // The clusters synchronize their clocks with their own RTIs, if at all.
+    rti.clock_sync_global_status = clock_sync_off;
+  }
   return 1;
 }
 int main(int argc, const char* argv[]) {
@@ -377,12 +456,20 @@ int main(int argc, const char* argv[]) {
 
   // Allocate memory for the federates
   int n = rti.base.number_of_scheduling_nodes;
+  if (rti.cluster >= 0) {
+    // The parent is represented by one more scheduling node.
+    n++;
+    rti.base.number_of_scheduling_nodes = n;
+  }
   rti.base.scheduling_nodes = (scheduling_node_t**)calloc(n, sizeof(scheduling_node_t*));
   for (uint16_t i = 0; i < n; i++) {
     federate_info_t* fed_info = (federate_info_t*)calloc(1, sizeof(federate_info_t));
     initialize_federate(fed_info, i);
     rti.base.scheduling_nodes[i] = (scheduling_node_t*)fed_info;
   }
+  if (rti.cluster >= 0) {
+    rti.parent = (federate_info_t*)rti.base.scheduling_nodes[n - 1];
+  }
 
   if (!start_rti_server()) {
     wait_for_federates();
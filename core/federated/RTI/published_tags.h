@@ -0,0 +1,103 @@
+/**
+ * @file published_tags.h
+ * @brief The tags that an enclave publishes for the enclaves downstream of it in the lock-free local RTI.
+ * @ingroup RTI
+ *
+ * The tags are guarded by a sequence lock: a writer makes `sequence` odd while it changes them,
+ * and a reader that sees it odd, or changed after reading the tags, reads them again. The
+ * sequence number also lets a reader tell whether the tags changed since it last read them.
+ * Several threads may write the tags of the same enclave, as an enclave lowers the NET of
+ * another when it sends it an event, so writers also exclude each other through the sequence.
+ *
+ * All functions are static inline so that the sequence lock can be tested on its own.
+ */
+
+#ifndef PUBLISHED_TAGS_H
+#define PUBLISHED_TAGS_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tag.h"
+
+/**
+ * @brief The tags that an enclave publishes for the enclaves downstream of it.
+ * @ingroup RTI
+ */
+typedef struct published_tags_t {
+  /** @brief Number of changes started or completed, odd while a change is in progress. */
+  uint32_t sequence;
+  /** @brief The next event tag (NET) of the enclave. */
+  instant_t next_event_time;
+  microstep_t next_event_microstep;
+  /** @brief The latest tag confirmed (LTC) by the enclave. */
+  instant_t completed_time;
+  microstep_t completed_microstep;
+  /** @brief The earliest tag of an event sent to the enclave since it last sent a NET. */
+  instant_t message_time;
+  microstep_t message_microstep;
+} published_tags_t;
+
+/**
+ * @brief Acquire the sequence lock of published tags, which other writers of the same enclave may hold.
+ * @return The sequence number to pass to end_publishing().
+ */
+static inline uint32_t begin_publishing(published_tags_t* published) {
+  uint32_t sequence = __atomic_load_n(&published->sequence, __ATOMIC_RELAXED);
+  while (true) {
+    if (sequence & 1u) {
+      // Another writer is storing its tags, which takes a few instructions unless it was preempted.
+      sched_yield();
+      sequence = __atomic_load_n(&published->sequence, __ATOMIC_RELAXED);
+    } else if (__atomic_compare_exchange_n(&published->sequence, &sequence, sequence + 1, true, __ATOMIC_ACQUIRE,
+                                           __ATOMIC_RELAXED)) {
+      return sequence + 1;
+    }
+  }
+}
+
+/** @brief Release the sequence lock of published tags, making the stored tags visible to readers. */
+static inline void end_publishing(published_tags_t* published, uint32_t sequence) {
+  __atomic_store_n(&published->sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+/** @brief Store a tag into a pair of published fields. This must be called with the sequence lock held. */
+static inline void store_tag(instant_t* time, microstep_t* microstep, tag_t tag) {
+  __atomic_store_n(time, tag.time, __ATOMIC_RELAXED);
+  __atomic_store_n(microstep, tag.microstep, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Load a tag from a pair of published fields.
+ *
+ * The tag is consistent if the caller holds the sequence lock, or if the sequence number did
+ * not change while the caller read it, as in read_published().
+ */
+static inline tag_t load_tag(instant_t* time, microstep_t* microstep) {
+  return (tag_t){.time = __atomic_load_n(time, __ATOMIC_RELAXED),
+                 .microstep = __atomic_load_n(microstep, __ATOMIC_RELAXED)};
+}
+
+/**
+ * @brief Read the NET and LTC of an enclave without taking its sequence lock.
+ * @return The sequence number at which the tags were read.
+ */
+static inline uint32_t read_published(published_tags_t* published, tag_t* next_event, tag_t* completed) {
+  while (true) {
+    uint32_t sequence = __atomic_load_n(&published->sequence, __ATOMIC_ACQUIRE);
+    if (sequence & 1u) {
+      sched_yield();
+      continue;
+    }
+    *next_event = load_tag(&published->next_event_time, &published->next_event_microstep);
+    *completed = load_tag(&published->completed_time, &published->completed_microstep);
+    // Order the reads of the tags before the check of the sequence number.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&published->sequence, __ATOMIC_RELAXED) == sequence) {
+      return sequence;
+    }
+  }
+}
+
+#endif // PUBLISHED_TAGS_H
@@ -8,6 +8,9 @@
  * @brief Common code for the RTI.
  */
 #if defined STANDALONE_RTI || defined LF_ENCLAVES
+#include <stdlib.h>
+#include <string.h>
+
 #include "rti_common.h"
 
 /**
@@ -20,7 +23,8 @@ extern instant_t start_time;
 
 void initialize_rti_common(rti_common_t* _rti_common) {
   rti_common = _rti_common;
-  rti_common->min_delays = NULL;
+  rti_common->min_delays_valid = false;
+  rti_common->min_delays_downstream = NULL;
   rti_common->max_stop_tag = NEVER_TAG;
   rti_common->number_of_scheduling_nodes = 0;
   rti_common->num_scheduling_nodes_handling_stop = 0;
@@ -33,16 +37,153 @@ void initialize_rti_common(rti_common_t* _rti_common) {
 
 #define IS_IN_ZERO_DELAY_CYCLE 1
 #define IS_IN_CYCLE 2
+#define MIN_DELAYS_UP_TO_DATE 4
+
+/** Position in the heap of scratch_t of a node whose minimum delay is final. */
+#define SETTLED SIZE_MAX
+
+/**
+ * A node on the stack of a depth-first traversal of the scheduling nodes.
+ */
+typedef struct traversal_frame_t {
+  /** ID of the node. */
+  uint16_t id;
+  /** Index of the next immediate downstream node to visit. */
+  uint16_t next;
+} traversal_frame_t;
+
+/**
+ * Memory reused by the searches for minimum delays and by traversals of the scheduling nodes,
+ * with room for all nodes. A node is marked by setting its mark to the current generation, so
+ * that unmarking all nodes only takes incrementing the generation.
+ */
+typedef struct scratch_t {
+  /** Number of nodes for which there is room. */
+  size_t capacity;
+  /** Generation of the current traversal. */
+  uint32_t traversal;
+  /** Marks of the nodes visited by the current traversal. */
+  uint32_t* traversal_marks;
+  /** Stack of the current traversal. */
+  traversal_frame_t* stack;
+  /** Generation of the current search. */
+  uint32_t search;
+  /** Marks of the nodes reached by the current search. */
+  uint32_t* search_marks;
+  /** Minimum delay found so far from each node reached by the current search. */
+  tag_t* delays;
+  /** Binary min-heap, ordered by delay, of the IDs of the nodes reached but not yet settled. */
+  uint16_t* heap;
+  /** Number of nodes in the heap. */
+  size_t heap_size;
+  /** Position in the heap of each node reached by the current search, or SETTLED. */
+  size_t* heap_positions;
+  /** Minimum delays found by the current search. */
+  minimum_delay_t* found;
+} scratch_t;
+
+static scratch_t scratch;
+
+/** Make sure that the scratch memory has room for all nodes. */
+static void reserve_scratch() {
+  size_t n = rti_common->number_of_scheduling_nodes;
+  if (scratch.capacity >= n) {
+    return;
+  }
+  free(scratch.traversal_marks);
+  free(scratch.stack);
+  free(scratch.search_marks);
+  free(scratch.delays);
+  free(scratch.heap);
+  free(scratch.heap_positions);
+  free(scratch.found);
+  scratch.traversal_marks = (uint32_t*)calloc(n, sizeof(uint32_t));
+  scratch.stack = (traversal_frame_t*)calloc(n, sizeof(traversal_frame_t));
+  scratch.search_marks = (uint32_t*)calloc(n, sizeof(uint32_t));
+  scratch.delays = (tag_t*)calloc(n, sizeof(tag_t));
+  scratch.heap = (uint16_t*)calloc(n, sizeof(uint16_t));
+  scratch.heap_positions = (size_t*)calloc(n, sizeof(size_t));
+  scratch.found = (minimum_delay_t*)calloc(n, sizeof(minimum_delay_t));
+  LF_ASSERT_NON_NULL(scratch.traversal_marks);
+  LF_ASSERT_NON_NULL(scratch.stack);
+  LF_ASSERT_NON_NULL(scratch.search_marks);
+  LF_ASSERT_NON_NULL(scratch.delays);
+  LF_ASSERT_NON_NULL(scratch.heap);
+  LF_ASSERT_NON_NULL(scratch.heap_positions);
+  LF_ASSERT_NON_NULL(scratch.found);
+  scratch.capacity = n;
+  scratch.traversal = 0;
+  scratch.search = 0;
+}
+
+/** Free the scratch memory. */
+static void free_scratch() {
+  free(scratch.traversal_marks);
+  free(scratch.stack);
+  free(scratch.search_marks);
+  free(scratch.delays);
+  free(scratch.heap);
+  free(scratch.heap_positions);
+  free(scratch.found);
+  memset(&scratch, 0, sizeof(scratch));
+}
+
+/**
+ * Start a new generation of marks, so that no node is marked.
+ * @param generation The current generation, which is advanced.
+ * @param marks The marks of the nodes.
+ * @return The new generation.
+ */
+static uint32_t next_generation(uint32_t* generation, uint32_t* marks) {
+  if (++*generation == 0) {
+    // The generation has wrapped around, so old marks could be mistaken for new ones.
+    memset(marks, 0, scratch.capacity * sizeof(uint32_t));
+    *generation = 1;
+  }
+  return *generation;
+}
+
+/** Forget the minimum delays of the specified node. */
+static void clear_min_delays(scheduling_node_t* node) {
+  free(node->min_delays);
+  node->min_delays = NULL;
+  node->num_min_delays = 0;
+  node->flags = 0; // All flags cleared because they get set lazily.
+}
 
 void invalidate_min_delays() {
-  if (rti_common->min_delays != NULL) {
-    uint16_t n = rti_common->number_of_scheduling_nodes;
-    for (uint16_t i = 0; i < n; i++) {
-      scheduling_node_t* node = rti_common->scheduling_nodes[i];
-      node->flags = 0; // All flags cleared because they get set lazily.
+  uint16_t n = rti_common->number_of_scheduling_nodes;
+  for (uint16_t i = 0; i < n; i++) {
+    scheduling_node_t* node = rti_common->scheduling_nodes[i];
+    clear_min_delays(node);
+    node->min_delays_downstream = NULL;
+    node->num_min_delays_downstream = 0;
+  }
+  free(rti_common->min_delays_downstream);
+  rti_common->min_delays_downstream = NULL;
+  rti_common->min_delays_valid = false;
+  free_scratch();
+}
+
+void invalidate_min_delays_through(scheduling_node_t* node) {
+  reserve_scratch();
+  uint32_t generation = next_generation(&scratch.traversal, scratch.traversal_marks);
+  // The order does not matter, so the stack is used to hold the nodes still to be visited.
+  size_t depth = 0;
+  scratch.traversal_marks[node->id] = generation;
+  scratch.stack[depth++].id = node->id;
+  while (depth > 0) {
+    scheduling_node_t* visited = rti_common->scheduling_nodes[scratch.stack[--depth].id];
+    clear_min_delays(visited);
+    for (int i = 0; i < visited->num_immediate_downstreams; i++) {
+      uint16_t downstream = visited->immediate_downstreams[i];
+      if (scratch.traversal_marks[downstream] != generation) {
+        scratch.traversal_marks[downstream] = generation;
+        scratch.stack[depth++].id = downstream;
+      }
     }
-    free(rti_common->min_delays);
   }
+  rti_common->min_delays_valid = false;
 }
 
 void initialize_scheduling_node(scheduling_node_t* e, uint16_t id) {
@@ -59,12 +200,16 @@ void initialize_scheduling_node(scheduling_node_t* e, uint16_t id) {
   e->immediate_downstreams = NULL;
   e->num_immediate_downstreams = 0;
   e->mode = REALTIME;
+  e->min_delays = NULL;
+  e->num_min_delays = 0;
+  e->min_delays_downstream = NULL;
+  e->num_min_delays_downstream = 0;
   e->flags = 0;
 }
 
 void _logical_tag_complete(scheduling_node_t* enclave, tag_t completed) {
-  // FIXME: Consolidate this message with NET to get NMR (Next Message Request).
-  // Careful with handling startup and shutdown.
+  // A federate that also has a NET to send combines both into a next message request (NMR),
+  // which handle_next_message_request() handles without calling this.
   LF_MUTEX_LOCK(rti_common->mutex);
 
   enclave->completed = completed;
@@ -77,10 +222,8 @@ void _logical_tag_complete(scheduling_node_t* enclave, tag_t completed) {
     scheduling_node_t* downstream = rti_common->scheduling_nodes[enclave->immediate_downstreams[i]];
     // Notify downstream enclave if appropriate.
     notify_advance_grant_if_safe(downstream);
-    bool* visited = (bool*)calloc(rti_common->number_of_scheduling_nodes, sizeof(bool)); // Initializes to 0.
     // Notify scheduling_nodes downstream of downstream if appropriate.
-    notify_downstream_advance_grant_if_safe(downstream, visited);
-    free(visited);
+    notify_downstream_advance_grant_if_safe(downstream);
   }
 
   LF_MUTEX_UNLOCK(rti_common->mutex);
@@ -96,32 +239,29 @@ tag_t earliest_future_incoming_message_tag(scheduling_node_t* e) {
   // federates, which will be the smallest upstream NET plus the least delay.
   // This could be NEVER_TAG if the RTI has not seen a NET from some upstream node.
   tag_t t_d = FOREVER_TAG;
-  int n = rti_common->number_of_scheduling_nodes;
-  for (int i = 0; i < n; i++) {
-    if (lf_tag_compare(rti_common->min_delays[i * n + e->id], FOREVER_TAG) != 0) {
-      // Node i is upstream of e with min delay rti_common->min_delays[i * n + e->id]
-      scheduling_node_t* upstream = rti_common->scheduling_nodes[i];
-      // If we haven't heard from the upstream node, then assume it can send an event at the start time.
-      if (lf_tag_compare(upstream->next_event, NEVER_TAG) == 0) {
-        tag_t start_tag = {.time = start_time, .microstep = 0};
-        upstream->next_event = start_tag;
-      }
-      // The min_delay here is a tag_t, not an interval_t because it may account for more than
-      // one connection. No delay at all is represented by (0,0). A delay of 0 is represented
-      // by (0,1). If the time part of the delay is greater than 0, then we want to ignore
-      // the microstep in upstream->next_event because that microstep will have been lost.
-      // Otherwise, we want preserve it and add to it. This is handled by lf_tag_add().
-      tag_t earliest_tag_from_upstream = lf_tag_add(upstream->next_event, rti_common->min_delays[i * n + e->id]);
-
-      /* Following debug message is too verbose for normal use:
-      LF_PRINT_DEBUG("RTI: Earliest next event upstream of fed/encl %d at fed/encl %d has tag " PRINTF_TAG ".",
-              e->id,
-              upstream->id,
-              earliest_tag_from_upstream.time - start_time, earliest_tag_from_upstream.microstep);
-      */
-      if (lf_tag_compare(earliest_tag_from_upstream, t_d) < 0) {
-        t_d = earliest_tag_from_upstream;
-      }
+  for (size_t i = 0; i < e->num_min_delays; i++) {
+    // Node e->min_delays[i].id is upstream of e with min delay e->min_delays[i].min_delay.
+    scheduling_node_t* upstream = rti_common->scheduling_nodes[e->min_delays[i].id];
+    // If we haven't heard from the upstream node, then assume it can send an event at the start time.
+    if (lf_tag_compare(upstream->next_event, NEVER_TAG) == 0) {
+      tag_t start_tag = {.time = start_time, .microstep = 0};
+      upstream->next_event = start_tag;
+    }
+    // The min_delay here is a tag_t, not an interval_t because it may account for more than
+    // one connection. No delay at all is represented by (0,0). A delay of 0 is represented
+    // by (0,1). If the time part of the delay is greater than 0, then we want to ignore
+    // the microstep in upstream->next_event because that microstep will have been lost.
+    // Otherwise, we want preserve it and add to it. This is handled by lf_tag_add().
+    tag_t earliest_tag_from_upstream = lf_tag_add(upstream->next_event, e->min_delays[i].min_delay);
+
+    /* Following debug message is too verbose for normal use:
+    LF_PRINT_DEBUG("RTI: Earliest next event upstream of fed/encl %d at fed/encl %d has tag " PRINTF_TAG ".",
+            e->id,
+            upstream->id,
+            earliest_tag_from_upstream.time - start_time, earliest_tag_from_upstream.microstep);
+    */
+    if (lf_tag_compare(earliest_tag_from_upstream, t_d) < 0) {
+      t_d = earliest_tag_from_upstream;
     }
   }
   return t_d;
@@ -245,14 +385,26 @@ tag_advance_grant_t tag_advance_grant_if_safe(scheduling_node_t* e) {
   return result;
 }
 
-void notify_downstream_advance_grant_if_safe(scheduling_node_t* e, bool visited[]) {
-  visited[e->id] = true;
-  for (int i = 0; i < e->num_immediate_downstreams; i++) {
-    scheduling_node_t* downstream = rti_common->scheduling_nodes[e->immediate_downstreams[i]];
-    if (visited[downstream->id])
+void notify_downstream_advance_grant_if_safe(scheduling_node_t* e) {
+  reserve_scratch();
+  uint32_t generation = next_generation(&scratch.traversal, scratch.traversal_marks);
+  // Visit the nodes depth first, notifying each before those downstream of it.
+  size_t depth = 0;
+  scratch.traversal_marks[e->id] = generation;
+  scratch.stack[depth++] = (traversal_frame_t){.id = e->id, .next = 0};
+  while (depth > 0) {
+    traversal_frame_t* frame = &scratch.stack[depth - 1];
+    scheduling_node_t* node = rti_common->scheduling_nodes[frame->id];
+    if (frame->next == node->num_immediate_downstreams) {
+      depth--;
+      continue;
+    }
+    scheduling_node_t* downstream = rti_common->scheduling_nodes[node->immediate_downstreams[frame->next++]];
+    if (scratch.traversal_marks[downstream->id] == generation)
       continue;
     notify_advance_grant_if_safe(downstream);
-    notify_downstream_advance_grant_if_safe(downstream, visited);
+    scratch.traversal_marks[downstream->id] = generation;
+    scratch.stack[depth++] = (traversal_frame_t){.id = downstream->id, .next = 0};
   }
 }
 
@@ -274,21 +426,16 @@ void update_scheduling_node_next_event_tag_locked(scheduling_node_t* e, tag_t ne
 
   update_min_delays();
   // Check downstream scheduling_nodes to see whether they should now be granted a TAG.
-  int n = rti_common->number_of_scheduling_nodes;
-  for (int j = 0; j < n; j++) {
-    if (lf_tag_compare(rti_common->min_delays[e->id * n + j], FOREVER_TAG) != 0) {
-      // The node j is a downstream node of e.
-      scheduling_node_t* downstream = rti_common->scheduling_nodes[j];
-      notify_advance_grant_if_safe(downstream);
-    }
+  for (size_t j = 0; j < e->num_min_delays_downstream; j++) {
+    scheduling_node_t* downstream = rti_common->scheduling_nodes[e->min_delays_downstream[j].id];
+    notify_advance_grant_if_safe(downstream);
   }
 
   if (!rti_common->dnet_disabled) {
     // Send DNET to the node e's upstream federates if needed
-    for (int i = 0; i < n; i++) {
-      if (lf_tag_compare(rti_common->min_delays[i * n + e->id], FOREVER_TAG) != 0 && i != e->id) {
-        // The node i is an upstream node of e.
-        scheduling_node_t* upstream = rti_common->scheduling_nodes[i];
+    for (size_t i = 0; i < e->num_min_delays; i++) {
+      if (e->min_delays[i].id != e->id) {
+        scheduling_node_t* upstream = rti_common->scheduling_nodes[e->min_delays[i].id];
         tag_t dnet = downstream_next_event_tag(upstream, e->id);
         if (lf_tag_compare(upstream->last_DNET, dnet) != 0 && lf_tag_compare(upstream->next_event, dnet) <= 0) {
           notify_downstream_next_event_tag(upstream, dnet);
@@ -309,103 +456,219 @@ void notify_advance_grant_if_safe(scheduling_node_t* e) {
   }
 }
 
-// Local function used recursively to find minimum delays upstream.
-// Return in count the number of non-FOREVER_TAG entries in path_delays[].
-static void _update_min_delays_upstream(scheduling_node_t* end, scheduling_node_t* intermediate, tag_t path_delays[],
-                                        size_t* count) {
-  // On first call, intermediate will be NULL, so the path delay is initialized to zero.
-  tag_t delay_from_intermediate_so_far = ZERO_TAG;
-  if (intermediate == NULL) {
-    intermediate = end;
-  } else {
-    // Not the first call, so intermediate is upstream of end.
-    delay_from_intermediate_so_far = path_delays[intermediate->id];
+/** Return whether the node at position a of the heap has a smaller delay than the node at position b. */
+static bool heap_less(size_t a, size_t b) {
+  return lf_tag_compare(scratch.delays[scratch.heap[a]], scratch.delays[scratch.heap[b]]) < 0;
+}
+
+/** Swap the nodes at two positions of the heap. */
+static void heap_swap(size_t a, size_t b) {
+  uint16_t id = scratch.heap[a];
+  scratch.heap[a] = scratch.heap[b];
+  scratch.heap[b] = id;
+  scratch.heap_positions[scratch.heap[a]] = a;
+  scratch.heap_positions[scratch.heap[b]] = b;
+}
+
+/** Move the node at the specified position of the heap up until its parent has no larger delay. */
+static void heap_sift_up(size_t position) {
+  while (position > 0 && heap_less(position, (position - 1) / 2)) {
+    heap_swap(position, (position - 1) / 2);
+    position = (position - 1) / 2;
   }
-  if (intermediate->state == NOT_CONNECTED) {
+}
+
+/** Remove and return the ID of the node with the smallest delay from the heap. */
+static uint16_t heap_pop() {
+  uint16_t id = scratch.heap[0];
+  scratch.heap_size--;
+  if (scratch.heap_size > 0) {
+    heap_swap(0, scratch.heap_size);
+    size_t position = 0;
+    while (true) {
+      size_t smallest = position;
+      size_t left = 2 * position + 1;
+      if (left < scratch.heap_size && heap_less(left, smallest)) {
+        smallest = left;
+      }
+      if (left + 1 < scratch.heap_size && heap_less(left + 1, smallest)) {
+        smallest = left + 1;
+      }
+      if (smallest == position) {
+        break;
+      }
+      heap_swap(position, smallest);
+      position = smallest;
+    }
+  }
+  scratch.heap_positions[id] = SETTLED;
+  return id;
+}
+
+static int compare_minimum_delay_ids(const void* a, const void* b) {
+  return ((const minimum_delay_t*)a)->id - ((const minimum_delay_t*)b)->id;
+}
+
+// Find the minimum delays from all nodes upstream of end with Dijkstra's algorithm, which
+// applies because adding a connection delay to a path delay never yields a smaller tag.
+// Paths are extended upstream from end, so the nodes are settled in order of their delays.
+static void _update_min_delays_upstream(scheduling_node_t* end) {
+  clear_min_delays(end);
+  end->flags = MIN_DELAYS_UP_TO_DATE;
+  if (end->state == NOT_CONNECTED) {
     // Enclave or federate is not connected.
     // No point in checking upstream scheduling_nodes.
     return;
   }
-  // Check nodes upstream of intermediate (or end on first call).
-  // NOTE: It would be better to iterate through these sorted by minimum delay,
-  // but for most programs, the gain might be negligible since there are relatively few
-  // upstream nodes.
-  for (int i = 0; i < intermediate->num_immediate_upstreams; i++) {
-    // Add connection delay to path delay so far. Because tag addition is not commutative,
-    // the calculation order should be carefully handled. Specifically, we should calculate
-    // intermediate->upstream_delay[i] + delay_from_intermediate_so_far,
-    // NOT delay_from_intermediate_so_far + intermediate->upstream_delay[i].
-    // Before calculating path delay, convert intermediate->upstream_delay[i] to a tag
-    // cause there is no function that adds a tag to an interval.
-    tag_t connection_delay = lf_delay_tag(ZERO_TAG, intermediate->immediate_upstream_delays[i]);
-    tag_t path_delay = lf_tag_add(connection_delay, delay_from_intermediate_so_far);
-    // If the path delay is less than the so-far recorded path delay from upstream, update upstream.
-    if (lf_tag_compare(path_delay, path_delays[intermediate->immediate_upstreams[i]]) < 0) {
-      if (path_delays[intermediate->immediate_upstreams[i]].time == FOREVER) {
-        // Found a finite path.
-        *count = *count + 1;
-      }
-      path_delays[intermediate->immediate_upstreams[i]] = path_delay;
-      // Since the path delay to upstream has changed, recursively update those upstream of it.
-      // Do not do this, however, if the upstream node is the end node because this means we have
-      // completed a cycle.
-      if (end->id != intermediate->immediate_upstreams[i]) {
-        _update_min_delays_upstream(end, rti_common->scheduling_nodes[intermediate->immediate_upstreams[i]],
-                                    path_delays, count);
-      } else {
+  uint32_t generation = next_generation(&scratch.search, scratch.search_marks);
+  size_t count = 0;
+  tag_t cycle_delay = FOREVER_TAG;
+  scheduling_node_t* intermediate = end;
+  tag_t delay_from_intermediate_so_far = ZERO_TAG;
+  while (true) {
+    // Check nodes upstream of intermediate, unless it is not connected.
+    for (int i = 0; i < intermediate->num_immediate_upstreams && intermediate->state != NOT_CONNECTED; i++) {
+      // Add connection delay to path delay so far. Because tag addition is not commutative,
+      // the calculation order should be carefully handled. Specifically, we should calculate
+      // intermediate->upstream_delay[i] + delay_from_intermediate_so_far,
+      // NOT delay_from_intermediate_so_far + intermediate->upstream_delay[i].
+      // Before calculating path delay, convert intermediate->upstream_delay[i] to a tag
+      // cause there is no function that adds a tag to an interval.
+      tag_t connection_delay = lf_delay_tag(ZERO_TAG, intermediate->immediate_upstream_delays[i]);
+      tag_t path_delay = lf_tag_add(connection_delay, delay_from_intermediate_so_far);
+      uint16_t upstream = intermediate->immediate_upstreams[i];
+      if (upstream == end->id) {
         // Found a cycle.
-        end->flags = end->flags | IS_IN_CYCLE;
-        // Is it a zero-delay cycle?
-        if (lf_tag_compare(path_delay, ZERO_TAG) == 0 && intermediate->immediate_upstream_delays[i] < 0) {
-          end->flags = end->flags | IS_IN_ZERO_DELAY_CYCLE;
-        } else {
-          // Clear the flag.
-          end->flags = end->flags & ~IS_IN_ZERO_DELAY_CYCLE;
+        if (lf_tag_compare(path_delay, cycle_delay) < 0) {
+          cycle_delay = path_delay;
+        }
+      } else if (scratch.search_marks[upstream] != generation) {
+        if (lf_tag_compare(path_delay, FOREVER_TAG) < 0) {
+          // Found a finite path.
+          scratch.search_marks[upstream] = generation;
+          scratch.delays[upstream] = path_delay;
+          scratch.heap[scratch.heap_size] = upstream;
+          scratch.heap_positions[upstream] = scratch.heap_size;
+          heap_sift_up(scratch.heap_size++);
         }
+      } else if (scratch.heap_positions[upstream] != SETTLED &&
+                 lf_tag_compare(path_delay, scratch.delays[upstream]) < 0) {
+        scratch.delays[upstream] = path_delay;
+        heap_sift_up(scratch.heap_positions[upstream]);
       }
     }
+    if (scratch.heap_size == 0) {
+      break;
+    }
+    uint16_t closest = heap_pop();
+    scratch.found[count++] = (minimum_delay_t){.id = closest, .min_delay = scratch.delays[closest]};
+    intermediate = rti_common->scheduling_nodes[closest];
+    delay_from_intermediate_so_far = scratch.delays[closest];
+  }
+  if (lf_tag_compare(cycle_delay, FOREVER_TAG) < 0) {
+    end->flags |= IS_IN_CYCLE;
+    // Is it a zero-delay cycle?
+    if (lf_tag_compare(cycle_delay, ZERO_TAG) == 0) {
+      end->flags |= IS_IN_ZERO_DELAY_CYCLE;
+    }
+    scratch.found[count++] = (minimum_delay_t){.id = end->id, .min_delay = cycle_delay};
+  }
+  if (count > 0) {
+    qsort(scratch.found, count, sizeof(minimum_delay_t), compare_minimum_delay_ids);
+    end->min_delays = (minimum_delay_t*)malloc(count * sizeof(minimum_delay_t));
+    LF_ASSERT_NON_NULL(end->min_delays);
+    memcpy(end->min_delays, scratch.found, count * sizeof(minimum_delay_t));
+    end->num_min_delays = count;
+  }
+}
+
+// Rebuild the min_delays_downstream of all nodes from the min_delays of all nodes.
+static void _update_min_delays_downstream() {
+  uint16_t n = rti_common->number_of_scheduling_nodes;
+  size_t total = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    rti_common->scheduling_nodes[i]->num_min_delays_downstream = 0;
+  }
+  for (uint16_t j = 0; j < n; j++) {
+    scheduling_node_t* node = rti_common->scheduling_nodes[j];
+    for (size_t k = 0; k < node->num_min_delays; k++) {
+      rti_common->scheduling_nodes[node->min_delays[k].id]->num_min_delays_downstream++;
+    }
+    total += node->num_min_delays;
+  }
+  free(rti_common->min_delays_downstream);
+  rti_common->min_delays_downstream = NULL;
+  if (total > 0) {
+    rti_common->min_delays_downstream = (minimum_delay_t*)malloc(total * sizeof(minimum_delay_t));
+    LF_ASSERT_NON_NULL(rti_common->min_delays_downstream);
+  }
+  // Carve the storage up among the nodes, then fill it in order of downstream ID.
+  size_t offset = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    scheduling_node_t* node = rti_common->scheduling_nodes[i];
+    node->min_delays_downstream = rti_common->min_delays_downstream + offset;
+    offset += node->num_min_delays_downstream;
+    node->num_min_delays_downstream = 0;
+  }
+  for (uint16_t j = 0; j < n; j++) {
+    scheduling_node_t* node = rti_common->scheduling_nodes[j];
+    for (size_t k = 0; k < node->num_min_delays; k++) {
+      scheduling_node_t* upstream = rti_common->scheduling_nodes[node->min_delays[k].id];
+      upstream->min_delays_downstream[upstream->num_min_delays_downstream++] =
+          (minimum_delay_t){.id = j, .min_delay = node->min_delays[k].min_delay};
+    }
   }
 }
 
 void update_min_delays() {
-  int n = rti_common->number_of_scheduling_nodes;
   // Check whether cached result is valid.
-  if (rti_common->min_delays == NULL) {
-    // Allocate memory for the array of min_delays.
-    rti_common->min_delays = (tag_t*)calloc((n * n), sizeof(tag_t));
-
-    for (int j = 0; j < n; j++) {
-      // This is not Dijkstra's algorithm, but rather one optimized for sparse upstream nodes.
-      // There must be a name for this algorithm.
-
-      scheduling_node_t* node = rti_common->scheduling_nodes[j];
-      // Array of results on the stack:
-      tag_t* path_delays = (tag_t*)calloc(n, sizeof(tag_t));
-      // This will be the number of non-FOREVER entries put into path_delays.
-      size_t count = 0;
-
-      for (int i = 0; i < n; i++) {
-        path_delays[i] = FOREVER_TAG;
-      }
-      _update_min_delays_upstream(node, NULL, path_delays, &count);
-
-      // Put the results onto the matrix.
-      LF_PRINT_DEBUG("++++ Node %hu is in ZDC: %d", node->id, is_in_zero_delay_cycle(node));
-      for (int i = 0; i < n; i++) {
-        rti_common->min_delays[i * n + j] = path_delays[i];
-        // The following might be useful for debugging, but N^2 debug statements are a problem with large benchmarks, so
-        // this is commented out.
-        /*
-        if (lf_tag_compare(path_delays[i], FOREVER_TAG) < 0) {
-          // Node i is upstream.
-          LF_PRINT_DEBUG("++++    Node %hu is upstream with delay " PRINTF_TAG, i, path_delays[i].time,
-                         path_delays[i].microstep);
-        }
-        */
-      }
-      free(path_delays);
+  if (rti_common->min_delays_valid) {
+    return;
+  }
+  reserve_scratch();
+  uint16_t n = rti_common->number_of_scheduling_nodes;
+  for (uint16_t j = 0; j < n; j++) {
+    scheduling_node_t* node = rti_common->scheduling_nodes[j];
+    if (node->flags & MIN_DELAYS_UP_TO_DATE) {
+      continue;
     }
+    _update_min_delays_upstream(node);
+    LF_PRINT_DEBUG("++++ Node %hu is in ZDC: %d", node->id, (node->flags & IS_IN_ZERO_DELAY_CYCLE) != 0);
+    // The following might be useful for debugging, but N^2 debug statements are a problem with large benchmarks, so
+    // this is commented out.
+    /*
+    for (size_t i = 0; i < node->num_min_delays; i++) {
+      LF_PRINT_DEBUG("++++    Node %d is upstream with delay " PRINTF_TAG, node->min_delays[i].id,
+                     node->min_delays[i].min_delay.time, node->min_delays[i].min_delay.microstep);
+    }
+    */
+  }
+  _update_min_delays_downstream();
+  rti_common->min_delays_valid = true;
+}
+
+// Return the minimum delay from upstream to downstream, or FOREVER_TAG if there is no path,
+// assuming that the minimum delays are up to date.
+static tag_t _find_min_delay(uint16_t upstream, scheduling_node_t* downstream) {
+  size_t low = 0;
+  size_t high = downstream->num_min_delays;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (downstream->min_delays[middle].id < upstream) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low < downstream->num_min_delays && downstream->min_delays[low].id == upstream) {
+    return downstream->min_delays[low].min_delay;
   }
+  return FOREVER_TAG;
+}
+
+tag_t get_min_delay(uint16_t upstream, uint16_t downstream) {
+  update_min_delays();
+  return _find_min_delay(upstream, rti_common->scheduling_nodes[downstream]);
 }
 
 tag_t get_dnet_candidate(tag_t next_event_tag, tag_t minimum_delay) {
@@ -451,9 +714,8 @@ tag_t downstream_next_event_tag(scheduling_node_t* target_node, uint16_t node_se
     return NEVER_TAG;
   }
 
-  int n = rti_common->number_of_scheduling_nodes;
-  int index = target_node->id * n + node_sending_new_NET_id;
-  tag_t candidate = get_dnet_candidate(node_sending_new_NET->next_event, rti_common->min_delays[index]);
+  tag_t candidate =
+      get_dnet_candidate(node_sending_new_NET->next_event, _find_min_delay(target_node->id, node_sending_new_NET));
 
   if (lf_tag_compare(target_node->last_DNET, candidate) >= 0) {
     // This function is called because a downstream node of target_node sent a new NET.
@@ -463,17 +725,17 @@ tag_t downstream_next_event_tag(scheduling_node_t* target_node, uint16_t node_se
     // to compute the DNET value.
     result = candidate;
   } else {
-    for (int j = 0; j < n; j++) {
-      if (target_node->id != j && (lf_tag_compare(rti_common->min_delays[target_node->id * n + j], FOREVER_TAG) != 0)) {
-        // The node j is a downstream node and not the target node itself.
-        scheduling_node_t* target_dowstream = rti_common->scheduling_nodes[j];
+    for (size_t j = 0; j < target_node->num_min_delays_downstream; j++) {
+      if (target_node->id != target_node->min_delays_downstream[j].id) {
+        // The node is a downstream node and not the target node itself.
+        scheduling_node_t* target_dowstream = rti_common->scheduling_nodes[target_node->min_delays_downstream[j].id];
         // if (is_in_zero_delay_cycle(target_dowstream)) {
         //   // The target node is an upstream of ZDC. Do not send DNET to this node.
         //   return NEVER_TAG;
         // }
 
         // Minimum tag increment between the node and its downstream node.
-        tag_t delay = rti_common->min_delays[target_node->id * n + j];
+        tag_t delay = target_node->min_delays_downstream[j].min_delay;
         candidate = get_dnet_candidate(target_dowstream->next_event, delay);
 
         if (lf_tag_compare(result, candidate) > 0) {
@@ -39,13 +39,13 @@ typedef enum scheduling_node_state_t {
 } scheduling_node_state_t;
 
 /**
- * @brief Struct for minimum delays from upstream nodes.
+ * @brief Struct for the minimum delay on paths between a node and another node upstream or downstream of it.
  * @ingroup RTI
  */
 typedef struct minimum_delay_t {
-  /** @brief ID of the upstream node. */
+  /** @brief ID of the upstream or downstream node. */
   int id;
-  /** @brief Minimum delay from upstream. */
+  /** @brief Minimum delay on paths between the two nodes. ZERO_TAG means there is no delay. */
   tag_t min_delay;
 } minimum_delay_t;
 
@@ -89,7 +89,17 @@ typedef struct scheduling_node_t {
   uint16_t num_immediate_downstreams;
   /** @brief FAST or REALTIME. */
   execution_mode_t mode;
-  /** @brief One of IS_IN_ZERO_DELAY_CYCLE, IS_IN_CYCLE. */
+  /** @brief Minimum delays from all nodes upstream of this one, sorted by ID. This node itself is included if it is
+   * in a cycle. Nodes with no path to this one are absent. Valid only after update_min_delays(). */
+  minimum_delay_t* min_delays;
+  /** @brief Size of the array of minimum delays from upstream nodes. */
+  size_t num_min_delays;
+  /** @brief Minimum delays to all nodes downstream of this one, sorted by ID. This is the transpose of the
+   * `min_delays` of all nodes. Valid only after update_min_delays(). */
+  minimum_delay_t* min_delays_downstream;
+  /** @brief Size of the array of minimum delays to downstream nodes. */
+  size_t num_min_delays_downstream;
+  /** @brief A combination of IS_IN_ZERO_DELAY_CYCLE, IS_IN_CYCLE, and MIN_DELAYS_UP_TO_DATE. */
   int flags;
 } scheduling_node_t;
 
@@ -105,10 +115,10 @@ typedef struct rti_common_t {
   scheduling_node_t** scheduling_nodes;
   /** @brief Number of scheduling nodes. */
   uint16_t number_of_scheduling_nodes;
-  /** @brief Matrix of minimum delays between pairs of nodes. Rows represent upstream nodes and columns represent
-   * downstream nodes. FOREVER_TAG means there is no path, and ZERO_TAG means there is no delay. This could be NULL if
-   * the matrix is not being used, so accesses should test for NULL first. */
-  tag_t* min_delays;
+  /** @brief Whether the minimum delays of all scheduling nodes are up to date. */
+  bool min_delays_valid;
+  /** @brief Storage for the `min_delays_downstream` of all scheduling nodes. */
+  minimum_delay_t* min_delays_downstream;
   /** @brief RTI's decided stop tag for the scheduling nodes. */
   tag_t max_stop_tag;
   /** @brief Number of scheduling nodes handling stop. */
@@ -167,13 +177,13 @@ void initialize_scheduling_node(scheduling_node_t* e, uint16_t id);
  * whether they should be notified of a TAG or PTAG and notify them if so.
  * @ingroup RTI
  *
+ * Each downstream node is considered once, even if the nodes form cycles.
+ *
  * This assumes the caller holds the RTI mutex.
  *
  * @param e The upstream node.
- * @param visited An array of booleans used to determine whether a node has
- *  been visited (initially all false).
  */
-void notify_downstream_advance_grant_if_safe(scheduling_node_t* e, bool visited[]);
+void notify_downstream_advance_grant_if_safe(scheduling_node_t* e);
 
 /**
  * @brief Notify a tag advance grant (TAG) message to the specified scheduling node.
@@ -300,11 +310,26 @@ tag_t eimt_strict(scheduling_node_t* e);
  * @brief If necessary, update the `min_delays` and the fields that indicate cycles.
  * @ingroup RTI
  *
- * These fields will be updated only if they have not been previously updated or if invalidate_min_delays
- * has been called since they were last updated.
+ * Only the nodes whose fields have not been previously updated, or have been invalidated by
+ * invalidate_min_delays() or invalidate_min_delays_through() since, are updated. If none are,
+ * this returns immediately.
+ *
+ * This assumes the caller holds the RTI mutex.
  */
 void update_min_delays();
 
+/**
+ * @brief Return the minimum delay on paths from one node to another.
+ * @ingroup RTI
+ *
+ * This updates the minimum delays if necessary and assumes the caller holds the RTI mutex.
+ *
+ * @param upstream The ID of the upstream node.
+ * @param downstream The ID of the downstream node.
+ * @return The minimum delay, ZERO_TAG if there is no delay, or FOREVER_TAG if there is no path.
+ */
+tag_t get_min_delay(uint16_t upstream, uint16_t downstream);
+
 /**
  * @brief Find the tag g that is the latest tag that satisfies lf_tag_add(g, minimum_delay) < next_event_tag.
  * @ingroup RTI
@@ -367,10 +392,25 @@ bool is_in_cycle(scheduling_node_t* node);
  * of all nodes.
  * @ingroup RTI
  *
- * This should be called whenever the structure of the connections have changed.
+ * This also frees the memory used for them.
  */
 void invalidate_min_delays();
 
+/**
+ * @brief Invalidate the `min_delays`, `num_min_delays`, and the fields that indicate cycles
+ * of the specified node and all nodes downstream of it.
+ * @ingroup RTI
+ *
+ * Only paths through the node can change when it connects or disconnects, so this should be
+ * called whenever a node connects, with its connections known, or disconnects. The minimum
+ * delays of the invalidated nodes are recomputed by the next call to update_min_delays().
+ *
+ * This assumes the caller holds the RTI mutex.
+ *
+ * @param node The node that has connected or disconnected.
+ */
+void invalidate_min_delays_through(scheduling_node_t* node);
+
 /**
  * @brief Free dynamically allocated memory on the scheduling nodes and the scheduling node array itself.
  * @ingroup RTI
@@ -17,6 +17,12 @@
  * 3) If the coordination logic might block. We unlock the enclave mutex while
  *  blocking, using a condition variable to unblock.
  * 4) When blocking on the coordination logic, never hold the RTI mutex.
+ *
+ * With LF_ENCLAVES_LOCK_FREE, the RTI mutex is not used to compute grants. Each enclave
+ * publishes its NET and LTC in its enclave_info_t and wakes those downstream of it, and an
+ * enclave waiting for a grant computes it from a consistent snapshot of the published tags.
+ * The only lock is the sequence lock of the published tags of each enclave, which is held by
+ * a writer for the time it takes to store two tags.
  */
 
 #ifdef LF_ENCLAVES
@@ -28,12 +34,26 @@
 #include "tracepoint.h"
 #include "reactor.h"
 
+#ifdef LF_ENCLAVES_LOCK_FREE
+#ifndef PLATFORM_Linux
+#error "LF_ENCLAVES_LOCK_FREE relies on futexes and is only supported on Linux."
+#endif
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 // Static global pointer to the RTI object.
 static rti_local_t* rti_local;
 
 // The RTI mutex. A pointer to this mutex will be put on the rti_local struct
 lf_mutex_t rti_mutex;
 
+#ifdef LF_ENCLAVES_LOCK_FREE
+static void initialize_snapshot(enclave_info_t* e);
+static void free_snapshot(enclave_info_t* e);
+#endif
+
 void initialize_local_rti(environment_t* envs, int num_envs) {
   rti_local = (rti_local_t*)calloc(1, sizeof(rti_local_t));
   LF_ASSERT_NON_NULL(rti_local);
@@ -62,9 +82,22 @@ void initialize_local_rti(environment_t* envs, int num_envs) {
 
     enclave_info->base.state = GRANTED;
   }
+#ifdef LF_ENCLAVES_LOCK_FREE
+  // The topology does not change, so the minimum delays are computed once, before any enclave
+  // reads them without holding the RTI mutex.
+  update_min_delays();
+  for (int i = 0; i < num_envs; i++) {
+    initialize_snapshot((enclave_info_t*)rti_local->base.scheduling_nodes[i]);
+  }
+#endif
 }
 
 void free_local_rti() {
+#ifdef LF_ENCLAVES_LOCK_FREE
+  for (int i = 0; i < rti_local->base.number_of_scheduling_nodes; i++) {
+    free_snapshot((enclave_info_t*)rti_local->base.scheduling_nodes[i]);
+  }
+#endif
   free_scheduling_nodes(rti_local->base.scheduling_nodes, rti_local->base.number_of_scheduling_nodes);
   free(rti_local);
 }
@@ -77,8 +110,271 @@ void initialize_enclave_info(enclave_info_t* enclave, int idx, environment_t* en
 
   // Initialize the next event condition variable.
   LF_COND_INIT(&enclave->next_event_condition, &rti_mutex);
+#ifdef LF_ENCLAVES_LOCK_FREE
+  enclave->published = (published_tags_t){.sequence = 0,
+                                          .next_event_time = NEVER_TAG.time,
+                                          .next_event_microstep = NEVER_TAG.microstep,
+                                          .completed_time = NEVER_TAG.time,
+                                          .completed_microstep = NEVER_TAG.microstep,
+                                          .message_time = FOREVER_TAG.time,
+                                          .message_microstep = FOREVER_TAG.microstep};
+  enclave->wake_futex = 0;
+  enclave->waiting = 0;
+  enclave->snapshot = NULL;
+#else
+  enclave->message = FOREVER_TAG;
+#endif
+}
+
+#ifdef LF_ENCLAVES_LOCK_FREE
+///////////////////////////////////////////////////////////////////////////////
+// Lock-free coordination
+///////////////////////////////////////////////////////////////////////////////
+
+struct tag_snapshot_t {
+  /** The number of enclaves read: the owner, first, then those upstream of it. */
+  size_t size;
+  /** The enclaves read. */
+  enclave_info_t** enclaves;
+  /** The sequence numbers of their published tags when read. */
+  uint32_t* sequences;
+  /** Their NETs and LTCs when read. */
+  tag_t* next_events;
+  tag_t* completed;
+  /** For each immediate upstream of the owner, the position of its tags. */
+  size_t* upstream_positions;
+  /** For each entry of the min_delays of the owner, the position of its tags. */
+  size_t* min_delay_positions;
+};
+
+/** Return the position of an enclave in a snapshot, adding it if it is not there yet. */
+static size_t snapshot_position(tag_snapshot_t* snapshot, uint16_t id) {
+  enclave_info_t* enclave = (enclave_info_t*)rti_local->base.scheduling_nodes[id];
+  for (size_t i = 0; i < snapshot->size; i++) {
+    if (snapshot->enclaves[i] == enclave) {
+      return i;
+    }
+  }
+  snapshot->enclaves[snapshot->size] = enclave;
+  return snapshot->size++;
+}
+
+static void initialize_snapshot(enclave_info_t* e) {
+  tag_snapshot_t* snapshot = (tag_snapshot_t*)calloc(1, sizeof(tag_snapshot_t));
+  LF_ASSERT_NON_NULL(snapshot);
+  size_t capacity = 1 + (size_t)e->base.num_immediate_upstreams + e->base.num_min_delays;
+  snapshot->enclaves = (enclave_info_t**)calloc(capacity, sizeof(enclave_info_t*));
+  snapshot->sequences = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+  snapshot->next_events = (tag_t*)calloc(capacity, sizeof(tag_t));
+  snapshot->completed = (tag_t*)calloc(capacity, sizeof(tag_t));
+  snapshot->upstream_positions = (size_t*)calloc(e->base.num_immediate_upstreams + 1, sizeof(size_t));
+  snapshot->min_delay_positions = (size_t*)calloc(e->base.num_min_delays + 1, sizeof(size_t));
+  LF_ASSERT_NON_NULL(snapshot->enclaves);
+  LF_ASSERT_NON_NULL(snapshot->sequences);
+  LF_ASSERT_NON_NULL(snapshot->next_events);
+  LF_ASSERT_NON_NULL(snapshot->completed);
+  LF_ASSERT_NON_NULL(snapshot->upstream_positions);
+  LF_ASSERT_NON_NULL(snapshot->min_delay_positions);
+  snapshot_position(snapshot, e->base.id);
+  for (int i = 0; i < e->base.num_immediate_upstreams; i++) {
+    snapshot->upstream_positions[i] = snapshot_position(snapshot, e->base.immediate_upstreams[i]);
+  }
+  for (size_t i = 0; i < e->base.num_min_delays; i++) {
+    snapshot->min_delay_positions[i] = snapshot_position(snapshot, e->base.min_delays[i].id);
+  }
+  e->snapshot = snapshot;
+}
+
+static void free_snapshot(enclave_info_t* e) {
+  tag_snapshot_t* snapshot = e->snapshot;
+  if (snapshot == NULL) {
+    return;
+  }
+  free(snapshot->enclaves);
+  free(snapshot->sequences);
+  free(snapshot->next_events);
+  free(snapshot->completed);
+  free(snapshot->upstream_positions);
+  free(snapshot->min_delay_positions);
+  free(snapshot);
+  e->snapshot = NULL;
+}
+
+/**
+ * Read the published tags of all enclaves in the snapshot, and repeat until none of them changed
+ * while they were read. The tags were then all current at the same instant, as they would be if
+ * they had been read under the RTI mutex.
+ */
+static void take_snapshot(tag_snapshot_t* snapshot) {
+  bool consistent;
+  do {
+    for (size_t i = 0; i < snapshot->size; i++) {
+      snapshot->sequences[i] =
+          read_published(&snapshot->enclaves[i]->published, &snapshot->next_events[i], &snapshot->completed[i]);
+    }
+    consistent = true;
+    for (size_t i = 0; i < snapshot->size && consistent; i++) {
+      consistent = __atomic_load_n(&snapshot->enclaves[i]->published.sequence, __ATOMIC_ACQUIRE) ==
+                   snapshot->sequences[i];
+    }
+  } while (!consistent);
+}
+
+/**
+ * Compute the TAG that enclave e can be given from a snapshot of the tags upstream of it, as
+ * tag_advance_grant_if_safe() does from the tags recorded by the RTI. PTAGs are never needed, as
+ * zero-delay cycles between enclaves are not allowed.
+ * @return The tag to grant, or NEVER_TAG if none can be granted yet.
+ */
+static tag_t grant_from_snapshot(enclave_info_t* e) {
+  tag_snapshot_t* snapshot = e->snapshot;
+  take_snapshot(snapshot);
+  tag_t next_event = snapshot->next_events[0];
+
+  tag_t min_upstream_completed = FOREVER_TAG;
+  for (int j = 0; j < e->base.num_immediate_upstreams; j++) {
+    tag_t completed = snapshot->completed[snapshot->upstream_positions[j]];
+    tag_t candidate = lf_delay_strict(completed, e->base.immediate_upstream_delays[j]);
+    if (lf_tag_compare(candidate, min_upstream_completed) < 0) {
+      min_upstream_completed = candidate;
+    }
+  }
+  if (lf_tag_compare(min_upstream_completed, e->base.last_granted) > 0 &&
+      lf_tag_compare(min_upstream_completed, next_event) >= 0) {
+    return min_upstream_completed;
+  }
+
+  tag_t t_d = FOREVER_TAG;
+  for (size_t i = 0; i < e->base.num_min_delays; i++) {
+    tag_t upstream_next_event = snapshot->next_events[snapshot->min_delay_positions[i]];
+    // If the upstream enclave has not sent a NET yet, assume it can send an event at the start time.
+    if (lf_tag_compare(upstream_next_event, NEVER_TAG) == 0) {
+      upstream_next_event = (tag_t){.time = lf_time_start(), .microstep = 0};
+    }
+    tag_t earliest_tag_from_upstream = lf_tag_add(upstream_next_event, e->base.min_delays[i].min_delay);
+    if (lf_tag_compare(earliest_tag_from_upstream, t_d) < 0) {
+      t_d = earliest_tag_from_upstream;
+    }
+  }
+  if (lf_tag_compare(t_d, next_event) > 0 && lf_tag_compare(next_event, NEVER_TAG) > 0 &&
+      lf_tag_compare(t_d, e->base.last_granted) > 0) {
+    return lf_tag_latest_earlier(t_d);
+  }
+  return NEVER_TAG;
+}
+
+/** Wake enclave e if it is waiting for a grant, so that it computes its grant again. */
+static void wake_enclave(enclave_info_t* e) {
+  // Pairs with the store of the waiting flag in wait_for_grant(): either this side sees the flag,
+  // or the futex wait of the other side sees the changed futex word and returns.
+  __atomic_add_fetch(&e->wake_futex, 1u, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&e->waiting, __ATOMIC_SEQ_CST)) {
+    syscall(SYS_futex, &e->wake_futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
 }
 
+/** Block until a TAG can be given to enclave e, and return it. */
+static tag_t wait_for_grant(enclave_info_t* e) {
+  while (true) {
+    uint32_t wake_futex = __atomic_load_n(&e->wake_futex, __ATOMIC_SEQ_CST);
+    tag_t grant = grant_from_snapshot(e);
+    if (lf_tag_compare(grant, NEVER_TAG) != 0) {
+      return grant;
+    }
+    LF_PRINT_LOG("RTI: enclave %u sleeps waiting for TAG to " PRINTF_TAG " ", e->base.id,
+                 e->snapshot->next_events[0].time - lf_time_start(), e->snapshot->next_events[0].microstep);
+    __atomic_store_n(&e->waiting, 1u, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, &e->wake_futex, FUTEX_WAIT_PRIVATE, wake_futex, NULL, NULL, 0);
+    __atomic_store_n(&e->waiting, 0u, __ATOMIC_RELAXED);
+  }
+}
+
+tag_t rti_next_event_tag_locked(enclave_info_t* e, tag_t next_event_tag) {
+  LF_PRINT_LOG("RTI: enclave %u sends NET of " PRINTF_TAG " ", e->base.id, next_event_tag.time - lf_time_start(),
+               next_event_tag.microstep);
+
+  // Return early if there are only a single enclave in the program.
+  if (rti_local->base.number_of_scheduling_nodes == 1) {
+    return next_event_tag;
+  }
+  tracepoint_federate_to_rti(send_NET, e->base.id, &next_event_tag);
+  // Publish the NET before leaving the critical section of the source enclave. Otherwise, an enclave
+  // could schedule an earlier event onto it and lower its NET in between, and the NET published
+  // here would then hide that event from the enclaves downstream.
+  uint32_t sequence = begin_publishing(&e->published);
+  // An event sent to this enclave after it computed its NET may not be on its event queue yet.
+  tag_t message = load_tag(&e->published.message_time, &e->published.message_microstep);
+  if (lf_tag_compare(message, next_event_tag) < 0) {
+    next_event_tag = message;
+  }
+  store_tag(&e->published.message_time, &e->published.message_microstep, FOREVER_TAG);
+  store_tag(&e->published.next_event_time, &e->published.next_event_microstep, next_event_tag);
+  end_publishing(&e->published, sequence);
+  // Leave the critical section, so that other enclaves can schedule events onto this one while it waits.
+  LF_MUTEX_UNLOCK(&e->env->mutex);
+  // The grants of the enclaves downstream depend on the NETs of all the enclaves upstream of them.
+  for (size_t j = 0; j < e->base.num_min_delays_downstream; j++) {
+    if (e->base.min_delays_downstream[j].id != e->base.id) {
+      wake_enclave((enclave_info_t*)rti_local->base.scheduling_nodes[e->base.min_delays_downstream[j].id]);
+    }
+  }
+
+  // If this enclave has no upstream, then we give a TAG until forever straight away.
+  if (e->base.num_immediate_upstreams == 0) {
+    LF_PRINT_LOG("RTI: enclave %u has no upstream. Giving it a TAG to FOREVER", e->base.id);
+    e->base.last_granted = FOREVER_TAG;
+  }
+  if (lf_tag_compare(e->base.last_granted, next_event_tag) < 0) {
+    tag_t grant = wait_for_grant(e);
+    if (rti_local->base.tracing_enabled) {
+      tracepoint_rti_to_federate(send_TAG, e->base.id, &grant);
+    }
+    e->base.last_granted = grant;
+  }
+  LF_PRINT_LOG("RTI: enclave %u returns with TAG to " PRINTF_TAG " ", e->base.id,
+               e->base.last_granted.time - lf_time_start(), e->base.last_granted.microstep);
+  tracepoint_federate_from_rti(receive_TAG, e->base.id, &e->base.last_granted);
+  LF_MUTEX_LOCK(&e->env->mutex);
+  return e->base.last_granted;
+}
+
+void rti_logical_tag_complete_locked(enclave_info_t* enclave, tag_t completed) {
+  if (rti_local->base.number_of_scheduling_nodes == 1) {
+    return;
+  }
+  tracepoint_federate_to_rti(send_LTC, enclave->base.id, &completed);
+  uint32_t sequence = begin_publishing(&enclave->published);
+  store_tag(&enclave->published.completed_time, &enclave->published.completed_microstep, completed);
+  end_publishing(&enclave->published, sequence);
+  LF_PRINT_LOG("RTI received from enclave %d the latest tag confirmed (LTC) " PRINTF_TAG ".", enclave->base.id,
+               completed.time - lf_time_start(), completed.microstep);
+  // LTCs only enter the grants of the immediately downstream enclaves.
+  for (int i = 0; i < enclave->base.num_immediate_downstreams; i++) {
+    wake_enclave((enclave_info_t*)rti_local->base.scheduling_nodes[enclave->base.immediate_downstreams[i]]);
+  }
+}
+
+void rti_update_other_net_locked(enclave_info_t* src, enclave_info_t* target, tag_t net) {
+  tracepoint_federate_to_federate(send_TAGGED_MSG, src->base.id, target->base.id, &net);
+  // If our proposed NET is less than the current NET, update it.
+  uint32_t sequence = begin_publishing(&target->published);
+  tag_t current = load_tag(&target->published.next_event_time, &target->published.next_event_microstep);
+  bool lowered = lf_tag_compare(net, current) < 0;
+  if (lowered) {
+    store_tag(&target->published.next_event_time, &target->published.next_event_microstep, net);
+  }
+  if (lf_tag_compare(net, load_tag(&target->published.message_time, &target->published.message_microstep)) < 0) {
+    store_tag(&target->published.message_time, &target->published.message_microstep, net);
+  }
+  end_publishing(&target->published, sequence);
+  if (lowered) {
+    // The target may be waiting for a grant that it can now get for the earlier tag.
+    wake_enclave(target);
+  }
+}
+
+#else // LF_ENCLAVES_LOCK_FREE
+
 tag_t rti_next_event_tag_locked(enclave_info_t* e, tag_t next_event_tag) {
   LF_PRINT_LOG("RTI: enclave %u sends NET of " PRINTF_TAG " ", e->base.id, next_event_tag.time - lf_time_start(),
                next_event_tag.microstep);
@@ -98,6 +394,11 @@ tag_t rti_next_event_tag_locked(enclave_info_t* e, tag_t next_event_tag) {
 
   tag_t previous_tag = e->base.last_granted;
 
+  // An event sent to this enclave after it computed its NET may not be on its event queue yet.
+  if (lf_tag_compare(e->message, next_event_tag) < 0) {
+    next_event_tag = e->message;
+  }
+  e->message = FOREVER_TAG;
   update_scheduling_node_next_event_tag_locked(&e->base, next_event_tag);
 
   // If this enclave has no upstream, then we give a TAG until forever straight away.
@@ -166,9 +467,14 @@ void rti_update_other_net_locked(enclave_info_t* src, enclave_info_t* target, ta
   if (lf_tag_compare(net, target->base.next_event) < 0) {
     target->base.next_event = net;
   }
+  if (lf_tag_compare(net, target->message) < 0) {
+    target->message = net;
+  }
   LF_MUTEX_UNLOCK(rti_local->base.mutex);
 }
 
+#endif // LF_ENCLAVES_LOCK_FREE
+
 ///////////////////////////////////////////////////////////////////////////////
 // The local RTIs implementation of the notify functions
 ///////////////////////////////////////////////////////////////////////////////
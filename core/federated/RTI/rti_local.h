@@ -11,6 +11,12 @@
  * A scheduling enclave is portion of the runtime system that maintains its own event
  * and reaction queues and has its own scheduler. It uses a local runtime infrastructure (RTI)
  * to coordinate the advancement of tags across enclaves.
+ *
+ * By default, the local RTI computes grants under a single mutex, like the RTI for federates.
+ * If LF_ENCLAVES_LOCK_FREE is defined (Linux only), each enclave instead publishes its NET and LTC
+ * without taking any lock shared with other enclaves, and an enclave that waits for a grant
+ * computes it itself from the tags published upstream of it, sleeping on a futex until one of
+ * them changes.
  */
 
 #ifndef RTI_LOCAL_H
@@ -21,6 +27,16 @@
 #include "lf_types.h"
 #include "rti_common.h"
 
+#ifdef LF_ENCLAVES_LOCK_FREE
+#include "published_tags.h"
+
+/**
+ * @brief Tags of the enclaves that the grants of an enclave depend on, as last read by that enclave.
+ * @ingroup RTI
+ */
+typedef struct tag_snapshot_t tag_snapshot_t;
+#endif // LF_ENCLAVES_LOCK_FREE
+
 /**
  * @brief Structure holding information about each enclave in the program.
  * @ingroup RTI
@@ -35,6 +51,22 @@ typedef struct enclave_info_t {
   /** @brief Condition variable used by scheduling_nodes to notify an enclave that its call to next_event_tag() should
    * unblock. */
   lf_cond_t next_event_condition;
+#ifdef LF_ENCLAVES_LOCK_FREE
+  /** @brief The NET and LTC of this enclave, written by it and, to lower the NET, by enclaves sending to it. */
+  published_tags_t published;
+  unsigned char published_padding[64 - sizeof(published_tags_t) % 64];
+  /** @brief Futex word that enclaves upstream of this one change to wake it after publishing tags. */
+  uint32_t wake_futex;
+  /** @brief Whether this enclave is, or is about to start, sleeping on wake_futex. */
+  uint32_t waiting;
+  unsigned char wake_padding[64 - 2 * sizeof(uint32_t)];
+  /** @brief The tags this enclave computes its grants from. Only used by the thread of this enclave. */
+  tag_snapshot_t* snapshot;
+#else
+  /** @brief The earliest tag of an event sent to this enclave since it last sent a NET, which its NET must not exceed.
+   */
+  tag_t message;
+#endif // LF_ENCLAVES_LOCK_FREE
 } enclave_info_t;
 
 /**
@@ -8,9 +8,9 @@
  * @brief Runtime infrastructure (RTI) for distributed Lingua Franca programs.
  *
  * This implementation creates one thread per federate so as to be able
- * to take advantage of multiple cores. It may be more efficient, however,
- * to use select() instead to read from the multiple socket connections
- * to each federate.
+ * to take advantage of multiple cores. On Linux, it can instead serve all
+ * federates from a few threads waiting on an epoll instance, which scales
+ * better to large federations (@see rti_remote_t.event_loop_threads).
  *
  * This implementation sends messages in little endian order
  * because Intel, RISC V, and Arm processors are little endian.
@@ -28,6 +28,12 @@
 #include "net_util.h"
 #include <string.h>
 
+#ifdef PLATFORM_Linux
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 // Global variables defined in tag.c:
 extern instant_t start_time;
 
@@ -50,9 +56,465 @@ extern int lf_critical_section_enter(environment_t* env) { return lf_mutex_lock(
 
 extern int lf_critical_section_exit(environment_t* env) { return lf_mutex_unlock(&rti_mutex); }
 
+/////////////////// Send queues ////////////////////
+
+/** Maximum number of queued messages written to a federate with one call to write_to_net_v(). */
+#define MAX_MESSAGES_PER_WRITE 64
+
+/**
+ * Allocate a message to be put on a send queue.
+ * @param length The length of the message.
+ */
+static rti_outbound_message_t* new_outbound_message(size_t length) {
+  rti_outbound_message_t* message = (rti_outbound_message_t*)malloc(sizeof(rti_outbound_message_t) + length);
+  LF_ASSERT_NON_NULL(message);
+  message->next = NULL;
+  message->length = length;
+  return message;
+}
+
+/** Free a list of messages. */
+static void free_outbound_messages(rti_outbound_message_t* message) {
+  while (message != NULL) {
+    rti_outbound_message_t* next = message->next;
+    free(message);
+    message = next;
+  }
+}
+
+/**
+ * Put a message on a send queue, which takes ownership of it.
+ * This can be called with or without holding rti_mutex.
+ * @param queue The send queue.
+ * @param message The message.
+ * @return 0 on success or -1, after freeing the message, if the queue has been closed because
+ * the federate has disconnected or writing to it has failed.
+ */
+static int enqueue_message(rti_send_queue_t* queue, rti_outbound_message_t* message) {
+  LF_MUTEX_LOCK(&queue->mutex);
+  if (queue->closed) {
+    LF_MUTEX_UNLOCK(&queue->mutex);
+    free(message);
+    return -1;
+  }
+  if (queue->tail == NULL) {
+    queue->head = message;
+  } else {
+    queue->tail->next = message;
+  }
+  queue->tail = message;
+  queue->bytes += message->length;
+  lf_cond_broadcast(&queue->changed);
+  LF_MUTEX_UNLOCK(&queue->mutex);
+  return 0;
+}
+
+/**
+ * Put a message on the send queue of a federate, which takes ownership of it.
+ * This can be called with or without holding rti_mutex.
+ * @param fed The destination federate.
+ * @param message The message.
+ * @return 0 on success or -1, after freeing the message, if the queue has been closed.
+ */
+static int enqueue_to_federate(federate_info_t* fed, rti_outbound_message_t* message) {
+  return enqueue_message(&fed->send_queue, message);
+}
+
+/**
+ * Put a copy of a message on the send queue of a federate.
+ * @param fed The destination federate.
+ * @param length The length of the message.
+ * @param buffer The message.
+ * @return 0 on success or -1 if the queue has been closed.
+ */
+static int send_to_federate(federate_info_t* fed, size_t length, const unsigned char* buffer) {
+  rti_outbound_message_t* message = new_outbound_message(length);
+  memcpy(message->data, buffer, length);
+  return enqueue_to_federate(fed, message);
+}
+
+/**
+ * Wait until the send queue of a federate has room for a message of the given length, it is
+ * closed, or it is empty. This must be called without holding rti_mutex.
+ * @param fed The destination federate.
+ * @param length The length of the message.
+ */
+static void wait_for_send_queue_space(federate_info_t* fed, size_t length) {
+  rti_send_queue_t* queue = &fed->send_queue;
+  LF_MUTEX_LOCK(&queue->mutex);
+  while (!queue->closed && queue->bytes > 0 && queue->bytes + length > RTI_SEND_QUEUE_CAPACITY) {
+    lf_cond_wait(&queue->changed);
+  }
+  LF_MUTEX_UNLOCK(&queue->mutex);
+}
+
+#ifdef PLATFORM_Linux
+/**
+ * Return whether wait_for_send_queue_space() would return without waiting.
+ * This must be called without holding rti_mutex.
+ * @param fed The destination federate.
+ * @param length The length of the message.
+ */
+static bool has_send_queue_space(federate_info_t* fed, size_t length) {
+  rti_send_queue_t* queue = &fed->send_queue;
+  LF_MUTEX_LOCK(&queue->mutex);
+  bool result = queue->closed || queue->bytes == 0 || queue->bytes + length <= RTI_SEND_QUEUE_CAPACITY;
+  LF_MUTEX_UNLOCK(&queue->mutex);
+  return result;
+}
+#endif
+
+/**
+ * Thread writing the messages on a send queue to its network abstraction, several at a time,
+ * until the queue is closed and empty or writing fails.
+ * @param queue_arg The send queue.
+ */
+static void* writer_thread(void* queue_arg) {
+  initialize_lf_thread_id();
+  rti_send_queue_t* queue = (rti_send_queue_t*)queue_arg;
+  struct iovec vectors[MAX_MESSAGES_PER_WRITE];
+  while (true) {
+    LF_MUTEX_LOCK(&queue->mutex);
+    while (queue->head == NULL && !queue->closed) {
+      lf_cond_wait(&queue->changed);
+    }
+    // Take all queued messages at once so that the queue is not locked while writing.
+    rti_outbound_message_t* messages = queue->head;
+    queue->head = NULL;
+    queue->tail = NULL;
+    LF_MUTEX_UNLOCK(&queue->mutex);
+    if (messages == NULL) {
+      // The queue is closed and empty.
+      return NULL;
+    }
+
+    while (messages != NULL) {
+      int count = 0;
+      size_t bytes = 0;
+      rti_outbound_message_t* message = messages;
+      while (message != NULL && count < MAX_MESSAGES_PER_WRITE) {
+        vectors[count].iov_base = message->data;
+        vectors[count].iov_len = message->length;
+        bytes += message->length;
+        count++;
+        message = message->next;
+      }
+      if (write_to_net_v(queue->net, vectors, count)) {
+        lf_print_error("RTI failed to send messages to federate %d. Dropping messages to it.", queue->federate_id);
+        free_outbound_messages(messages);
+        LF_MUTEX_LOCK(&queue->mutex);
+        queue->closed = true;
+        free_outbound_messages(queue->head);
+        queue->head = NULL;
+        queue->tail = NULL;
+        queue->bytes = 0;
+        lf_cond_broadcast(&queue->changed);
+        LF_MUTEX_UNLOCK(&queue->mutex);
+        return NULL;
+      }
+      // Free the messages that were written.
+      while (messages != message) {
+        rti_outbound_message_t* next = messages->next;
+        free(messages);
+        messages = next;
+      }
+      LF_MUTEX_LOCK(&queue->mutex);
+      queue->bytes -= bytes;
+      lf_cond_broadcast(&queue->changed);
+      LF_MUTEX_UNLOCK(&queue->mutex);
+    }
+  }
+}
+
+/**
+ * Initialize a send queue, which accepts no messages until its writer is started.
+ * @param queue The send queue.
+ * @param federate_id The ID of the federate to which the messages are written.
+ */
+static void initialize_send_queue(rti_send_queue_t* queue, uint16_t federate_id) {
+  LF_MUTEX_INIT(&queue->mutex);
+  LF_COND_INIT(&queue->changed, &queue->mutex);
+  queue->head = NULL;
+  queue->tail = NULL;
+  queue->bytes = 0;
+  queue->closed = true;
+  queue->writer_running = false;
+  queue->net = NULL;
+  queue->federate_id = federate_id;
+}
+
+/**
+ * Start the thread writing a send queue to a network abstraction.
+ * @param queue The send queue.
+ * @param net The network abstraction.
+ */
+static void start_writer(rti_send_queue_t* queue, net_abstraction_t net) {
+  LF_MUTEX_LOCK(&queue->mutex);
+  queue->net = net;
+  queue->closed = false;
+  queue->writer_running = true;
+  LF_MUTEX_UNLOCK(&queue->mutex);
+  lf_thread_create(&queue->writer_thread_id, writer_thread, queue);
+}
+
+/**
+ * Close a send queue and wait for the messages already on it to be written. This must be called
+ * before the network abstraction is shut down, and it does nothing if the writer thread is not running.
+ * @param queue The send queue.
+ */
+static void stop_writer(rti_send_queue_t* queue) {
+  LF_MUTEX_LOCK(&queue->mutex);
+  bool running = queue->writer_running;
+  queue->writer_running = false;
+  queue->closed = true;
+  lf_cond_broadcast(&queue->changed);
+  LF_MUTEX_UNLOCK(&queue->mutex);
+  if (running) {
+    void* result;
+    lf_thread_join(queue->writer_thread_id, &result);
+  }
+}
+
+/**
+ * Start the threads writing the send queues of a federate, after which all messages to the
+ * federate must go through its send queues.
+ * @param fed The federate.
+ */
+static void start_federate_writer(federate_info_t* fed) {
+  start_writer(&fed->send_queue, fed->net);
+  if (fed->control.net != NULL) {
+    start_writer(&fed->control.send_queue, fed->control.net);
+  }
+}
+
+/**
+ * Close the send queues of a federate and wait for the messages already on them to be written.
+ * This must be called before the network abstractions of the federate are shut down, and it does
+ * nothing for a queue whose writer thread is not running.
+ * @param fed The federate.
+ */
+static void stop_federate_writer(federate_info_t* fed) {
+  stop_writer(&fed->control.send_queue);
+  stop_writer(&fed->send_queue);
+}
+
+/////////////////// Control lanes ////////////////////
+
+/**
+ * Record that a fenced message, which a later grant on the control lane must not overtake, has been
+ * put on the send queue of a federate. This assumes the caller holds rti_mutex.
+ * @param fed The destination federate.
+ * @param tag The tag of the message, or NEVER_TAG for a message that every later grant waits for.
+ */
+static void count_fenced_message_sent_locked(federate_info_t* fed, tag_t tag) {
+  if (fed->control.net == NULL) {
+    return;
+  }
+  if (lf_tag_compare(tag, fed->control.fence_tag) <= 0) {
+    fed->control.fenced_messages_sent++;
+  } else {
+    pqueue_tag_insert_tag(fed->control.later_message_tags, tag);
+  }
+}
+
+/**
+ * Return the data fence of a grant of the given tag to a federate, which is the number of fenced
+ * messages no later than the greatest tag granted so far that have been put on its send queue.
+ * This assumes the caller holds rti_mutex.
+ * @param fed The destination federate, which must have a control lane.
+ * @param tag The granted tag.
+ */
+static int64_t grant_fence_locked(federate_info_t* fed, tag_t tag) {
+  if (lf_tag_compare(tag, fed->control.fence_tag) > 0) {
+    fed->control.fence_tag = tag;
+    while (pqueue_tag_size(fed->control.later_message_tags) > 0 &&
+           lf_tag_compare(pqueue_tag_peek_tag(fed->control.later_message_tags), tag) <= 0) {
+      pqueue_tag_pop_tag(fed->control.later_message_tags);
+      fed->control.fenced_messages_sent++;
+    }
+  }
+  return fed->control.fenced_messages_sent;
+}
+
+/**
+ * Put a copy of a tag coordination message on the control lane of a federate, followed by its data
+ * fence, or on the send queue of the federate if it has no control lane.
+ * This assumes the caller holds rti_mutex.
+ * @param fed The destination federate.
+ * @param length The length of the message.
+ * @param buffer The message.
+ * @param is_grant Whether the message is a TAG or PTAG, which waits for the fenced messages up to
+ * its tag, rather than a DNET, which carries no fence.
+ * @param tag The tag of the message.
+ * @return 0 on success or -1 if the queue has been closed.
+ */
+static int send_control_to_federate_locked(federate_info_t* fed, size_t length, const unsigned char* buffer,
+                                           bool is_grant, tag_t tag) {
+  if (fed->control.net == NULL) {
+    return send_to_federate(fed, length, buffer);
+  }
+  size_t fence_length = is_grant ? CONTROL_LANE_FENCE_LENGTH : 0;
+  rti_outbound_message_t* message = new_outbound_message(length + fence_length);
+  memcpy(message->data, buffer, length);
+  if (is_grant) {
+    encode_int64(grant_fence_locked(fed, tag), &message->data[length]);
+  }
+  return enqueue_message(&fed->control.send_queue, message);
+}
+
+/////////////////// Clusters ////////////////////
+
+/** In a cluster RTI, the next event tag of the cluster most recently sent to the parent. */
+static tag_t NET_sent_to_parent = {.time = NEVER, .microstep = 0u};
+
+/** In a cluster RTI, the latest tag confirmed of the cluster most recently sent to the parent. */
+static tag_t LTC_sent_to_parent = {.time = NEVER, .microstep = 0u};
+
+/** In a cluster RTI, whether the parent accepted next message requests (@see MSG_TYPE_FED_IDS_NMR). */
+static bool parent_accepts_NMR = false;
+
+/** In a cluster RTI, whether the parent has asked the cluster to stop. */
+static bool stop_requested_by_parent = false;
+
+/** In a cluster RTI, whether the stop tag of the cluster has been sent to the parent. */
+static bool stop_sent_to_parent = false;
+
+/** Return whether this RTI coordinates a cluster of a hierarchical federation for a parent RTI. */
+static bool is_cluster_rti() { return rti_remote->parent != NULL; }
+
+/** Return the number of federates connected to this RTI, which, in a cluster RTI, excludes the parent. */
+static uint16_t number_of_federates() {
+  return rti_remote->base.number_of_scheduling_nodes - (is_cluster_rti() ? 1 : 0);
+}
+
+/**
+ * Return the scheduling node of the federate with the given ID. In a cluster RTI, the members of
+ * the cluster are numbered from 0 and every other federate is represented by the parent.
+ * @param federate_id The ID of the federate in the federation.
+ */
+static uint16_t cluster_node(uint16_t federate_id) {
+  if (!is_cluster_rti()) {
+    return federate_id;
+  }
+  int32_t member = (int32_t)federate_id - rti_remote->cluster * (int32_t)rti_remote->cluster_size;
+  if (member >= 0 && member < number_of_federates()) {
+    return (uint16_t)member;
+  }
+  return rti_remote->parent->enclave.id;
+}
+
+/**
+ * Return the scheduling node to which to forward a message to the federate with the given ID.
+ * In a root RTI, this is the cluster of the federate.
+ * @param federate_id The ID of the destination federate in the federation.
+ */
+static uint16_t destination_node(uint16_t federate_id) {
+  if (rti_remote->cluster_size > 0 && !is_cluster_rti()) {
+    return federate_id / rti_remote->cluster_size;
+  }
+  return cluster_node(federate_id);
+}
+
+/**
+ * Send a message carrying only a tag to the parent of a cluster RTI.
+ * This function assumes the caller holds the mutex.
+ * @return 0 on success, -1 if the connection to the parent has failed.
+ */
+static int send_tag_to_parent(unsigned char type, tag_t tag) {
+  unsigned char buffer[1 + sizeof(int64_t) + sizeof(uint32_t)];
+  buffer[0] = type;
+  encode_tag(&buffer[1], tag);
+  if (send_to_federate(rti_remote->parent, sizeof(buffer), buffer)) {
+    lf_print_error("RTI of cluster %d failed to send message type %u to its parent.", rti_remote->cluster, type);
+    rti_remote->parent->enclave.state = NOT_CONNECTED;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * In a cluster RTI, send the parent the latest tag confirmed and the next event tag of the cluster
+ * if they have changed, as if the cluster were one federate. These are the earliest completed tag
+ * and the earliest next event tag, which accounts for in-transit messages, of the connected members.
+ * This function assumes the caller holds the mutex.
+ */
+static void notify_parent_locked() {
+  if (!is_cluster_rti() || rti_remote->parent->enclave.state == NOT_CONNECTED) {
+    return;
+  }
+  tag_t completed = FOREVER_TAG;
+  tag_t next_event = FOREVER_TAG;
+  for (uint16_t i = 0; i < number_of_federates(); i++) {
+    scheduling_node_t* member = rti_remote->base.scheduling_nodes[i];
+    if (member->state == NOT_CONNECTED) {
+      continue;
+    }
+    if (lf_tag_compare(member->completed, completed) < 0) {
+      completed = member->completed;
+    }
+    if (lf_tag_compare(member->next_event, next_event) < 0) {
+      next_event = member->next_event;
+    }
+  }
+  // Confirm completed tags first, as a federate does, so that the parent never sees a next event
+  // tag earlier than a tag already confirmed.
+  bool send_completed = lf_tag_compare(completed, NEVER_TAG) > 0 && lf_tag_compare(completed, LTC_sent_to_parent) > 0;
+  bool send_next_event =
+      lf_tag_compare(next_event, NEVER_TAG) > 0 && lf_tag_compare(next_event, NET_sent_to_parent) != 0;
+  if (send_completed && send_next_event && parent_accepts_NMR) {
+    unsigned char buffer[MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH];
+    buffer[0] = MSG_TYPE_NEXT_MESSAGE_REQUEST;
+    encode_tag(&buffer[1], completed);
+    encode_tag(&buffer[1 + sizeof(int64_t) + sizeof(uint32_t)], next_event);
+    if (send_to_federate(rti_remote->parent, sizeof(buffer), buffer)) {
+      lf_print_error("RTI of cluster %d failed to send message type %u to its parent.", rti_remote->cluster,
+                     buffer[0]);
+      rti_remote->parent->enclave.state = NOT_CONNECTED;
+    } else {
+      LTC_sent_to_parent = completed;
+      NET_sent_to_parent = next_event;
+    }
+    return;
+  }
+  if (send_completed && send_tag_to_parent(MSG_TYPE_LATEST_TAG_CONFIRMED, completed) == 0) {
+    LTC_sent_to_parent = completed;
+  }
+  if (send_next_event && send_tag_to_parent(MSG_TYPE_NEXT_EVENT_TAG, next_event) == 0) {
+    NET_sent_to_parent = next_event;
+  }
+}
+
+/**
+ * In a cluster RTI in which all members have handled a stop request, send the parent the stop tag
+ * of the cluster, either as a reply to the parent's request or as a request of the cluster. The
+ * members are sent the stop tag that the parent grants.
+ * This function assumes the caller holds the mutex.
+ */
+static void send_stop_tag_to_parent_locked() {
+  if (stop_sent_to_parent) {
+    return;
+  }
+  stop_sent_to_parent = true;
+  unsigned char buffer[MSG_TYPE_STOP_REQUEST_LENGTH];
+  if (stop_requested_by_parent) {
+    ENCODE_STOP_REQUEST_REPLY(buffer, rti_remote->base.max_stop_tag.time, rti_remote->base.max_stop_tag.microstep);
+  } else {
+    ENCODE_STOP_REQUEST(buffer, rti_remote->base.max_stop_tag.time, rti_remote->base.max_stop_tag.microstep);
+  }
+  if (send_to_federate(rti_remote->parent, MSG_TYPE_STOP_REQUEST_LENGTH, buffer)) {
+    lf_print_error("RTI of cluster %d failed to send its stop tag to its parent.", rti_remote->cluster);
+    rti_remote->parent->enclave.state = NOT_CONNECTED;
+  }
+  LF_PRINT_LOG("RTI of cluster %d sent its parent the stop tag " PRINTF_TAG ".", rti_remote->cluster,
+               rti_remote->base.max_stop_tag.time - start_time, rti_remote->base.max_stop_tag.microstep);
+}
+
+/////////////////// Tag advance ////////////////////
+
 void notify_tag_advance_grant(scheduling_node_t* e, tag_t tag) {
-  if (e->state == NOT_CONNECTED || lf_tag_compare(tag, e->last_granted) <= 0 ||
-      lf_tag_compare(tag, e->last_provisionally_granted) < 0) {
+  // The parent of a cluster RTI is granted tags by its own RTI.
+  if ((federate_info_t*)e == rti_remote->parent || e->state == NOT_CONNECTED ||
+      lf_tag_compare(tag, e->last_granted) <= 0 || lf_tag_compare(tag, e->last_provisionally_granted) < 0) {
     return;
   }
   // Need to make sure that the destination federate's thread has already
@@ -71,9 +533,9 @@ void notify_tag_advance_grant(scheduling_node_t* e, tag_t tag) {
     tracepoint_rti_to_federate(send_TAG, e->id, &tag);
   }
   // This function is called in notify_advance_grant_if_safe(), which is a long
-  // function. During this call, the network abstraction might close, causing the following write_to_net
+  // function. During this call, the network abstraction might close, causing the following send
   // to fail. Consider a failure here a soft failure and update the federate's status.
-  if (write_to_net(((federate_info_t*)e)->net, message_length, buffer)) {
+  if (send_control_to_federate_locked((federate_info_t*)e, message_length, buffer, true, tag)) {
     lf_print_error("RTI failed to send tag advance grant to federate %d.", e->id);
     e->state = NOT_CONNECTED;
   } else {
@@ -84,8 +546,9 @@ void notify_tag_advance_grant(scheduling_node_t* e, tag_t tag) {
 }
 
 void notify_provisional_tag_advance_grant(scheduling_node_t* e, tag_t tag) {
-  if (e->state == NOT_CONNECTED || lf_tag_compare(tag, e->last_granted) <= 0 ||
-      lf_tag_compare(tag, e->last_provisionally_granted) <= 0) {
+  // The parent of a cluster RTI is granted tags by its own RTI.
+  if ((federate_info_t*)e == rti_remote->parent || e->state == NOT_CONNECTED ||
+      lf_tag_compare(tag, e->last_granted) <= 0 || lf_tag_compare(tag, e->last_provisionally_granted) <= 0) {
     return;
   }
   // Need to make sure that the destination federate's thread has already
@@ -104,9 +567,9 @@ void notify_provisional_tag_advance_grant(scheduling_node_t* e, tag_t tag) {
     tracepoint_rti_to_federate(send_PTAG, e->id, &tag);
   }
   // This function is called in notify_advance_grant_if_safe(), which is a long
-  // function. During this call, the network abstraction might close, causing the following write_to_net
+  // function. During this call, the network abstraction might close, causing the following send
   // to fail. Consider a failure here a soft failure and update the federate's status.
-  if (write_to_net(((federate_info_t*)e)->net, message_length, buffer)) {
+  if (send_control_to_federate_locked((federate_info_t*)e, message_length, buffer, true, tag)) {
     lf_print_error("RTI failed to send tag advance grant to federate %d.", e->id);
     e->state = NOT_CONNECTED;
   } else {
@@ -145,7 +608,7 @@ void notify_provisional_tag_advance_grant(scheduling_node_t* e, tag_t tag) {
 }
 
 void notify_downstream_next_event_tag(scheduling_node_t* e, tag_t tag) {
-  if (e->state == NOT_CONNECTED) {
+  if ((federate_info_t*)e == rti_remote->parent || e->state == NOT_CONNECTED) {
     return;
   }
   // Need to make sure that the destination federate's thread has already
@@ -163,7 +626,7 @@ void notify_downstream_next_event_tag(scheduling_node_t* e, tag_t tag) {
   if (rti_remote->base.tracing_enabled) {
     tracepoint_rti_to_federate(send_DNET, e->id, &tag);
   }
-  if (write_to_net(((federate_info_t*)e)->net, message_length, buffer)) {
+  if (send_control_to_federate_locked((federate_info_t*)e, message_length, buffer, false, tag)) {
     lf_print_error("RTI failed to send downstream next event tag to federate %d.", e->id);
     e->state = NOT_CONNECTED;
   } else {
@@ -204,7 +667,7 @@ void handle_port_absent_message(federate_info_t* sending_federate, unsigned char
 
   // If the destination federate is no longer connected, issue a warning
   // and return.
-  federate_info_t* fed = GET_FED_INFO(federate_id);
+  federate_info_t* fed = GET_FED_INFO(destination_node(federate_id));
   if (fed->enclave.state == NOT_CONNECTED) {
     LF_MUTEX_UNLOCK(&rti_mutex);
     lf_print_warning("RTI: Destination federate %d is no longer connected. Dropping message.", federate_id);
@@ -230,53 +693,56 @@ void handle_port_absent_message(federate_info_t* sending_federate, unsigned char
   }
 
   if (rti_remote->base.tracing_enabled) {
-    tracepoint_rti_to_federate(send_PORT_ABS, federate_id, &tag);
+    tracepoint_rti_to_federate(send_PORT_ABS, fed->enclave.id, &tag);
   }
 
   // Forward the message.
-  write_to_net_fail_on_error(fed->net, message_size + 1, buffer, &rti_mutex,
-                             "RTI failed to forward message to federate %d.", federate_id);
+  if (send_to_federate(fed, message_size + 1, buffer)) {
+    lf_print_error("RTI failed to forward message to federate %d.", federate_id);
+    fed->enclave.state = NOT_CONNECTED;
+  } else {
+    count_fenced_message_sent_locked(fed, tag);
+  }
 
   LF_MUTEX_UNLOCK(&rti_mutex);
 }
 
-void handle_timed_message(federate_info_t* sending_federate, unsigned char* buffer) {
-  size_t header_size = 1 + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint32_t);
-  // Read the header, minus the first byte which has already been read.
-  read_from_net_fail_on_error(sending_federate->net, header_size - 1, &(buffer[1]),
-                              "RTI failed to read the timed message header from remote federate.");
-  // Extract the header information. of the sender
+/** Length of the header of a timed message, including its type byte. */
+#define TIMED_MESSAGE_HEADER_SIZE                                                                                      \
+  (1 + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint32_t))
+
+#ifdef PLATFORM_Linux
+static void read_payload_off_event_loop(federate_info_t* sending_federate, federate_info_t* fed,
+                                        unsigned char* header);
+#endif
+
+/**
+ * Read the payload of a timed message whose header has been read and forward the message to its
+ * destination.
+ * This function assumes the caller does not hold the mutex.
+ * @param sending_federate The sending federate.
+ * @param fed The destination of the message, which has been checked against the header.
+ * @param header The header of the message.
+ */
+static void forward_timed_message(federate_info_t* sending_federate, federate_info_t* fed, unsigned char* header) {
+  size_t header_size = TIMED_MESSAGE_HEADER_SIZE;
   uint16_t reactor_port_id;
   uint16_t federate_id;
   size_t length;
   tag_t intended_tag;
-  // Extract information from the header.
-  extract_timed_header(&(buffer[1]), &reactor_port_id, &federate_id, &length, &intended_tag);
-
-  size_t total_bytes_to_read = length + header_size;
-  size_t bytes_to_read = length;
-
-  if (FED_COM_BUFFER_SIZE < header_size + 1) {
-    lf_print_error_and_exit("Buffer size (%d) is not large enough to "
-                            "read the header plus one byte.",
-                            FED_COM_BUFFER_SIZE);
-  }
-
-  // Cut up the payload in chunks.
-  if (bytes_to_read > FED_COM_BUFFER_SIZE - header_size) {
-    bytes_to_read = FED_COM_BUFFER_SIZE - header_size;
-  }
-
-  LF_PRINT_LOG("RTI received message from federate %d for federate %u port %u with intended tag " PRINTF_TAG
-               ". Forwarding.",
-               sending_federate->enclave.id, federate_id, reactor_port_id, intended_tag.time - lf_time_start(),
-               intended_tag.microstep);
-
-  read_from_net_fail_on_error(sending_federate->net, bytes_to_read, &(buffer[header_size]),
+  extract_timed_header(&(header[1]), &reactor_port_id, &federate_id, &length, &intended_tag);
+
+  // Read the whole message into a message for the send queue of the destination before acquiring
+  // the mutex, so that a large message does not hold up the handling of messages from other federates.
+  // If the destination is not keeping up, wait for its queue to drain first, which pushes back on this
+  // sender only.
+  wait_for_send_queue_space(fed, header_size + length);
+  rti_outbound_message_t* message = new_outbound_message(header_size + length);
+  memcpy(message->data, header, header_size);
+  read_from_net_fail_on_error(sending_federate->net, length, &(message->data[header_size]),
                               "RTI failed to read timed message from federate %d.", federate_id);
-  size_t bytes_read = bytes_to_read + header_size;
   // Following only works for string messages.
-  // LF_PRINT_DEBUG("Message received by RTI: %s.", buffer + header_size);
+  // LF_PRINT_DEBUG("Message received by RTI: %s.", message->data + header_size);
 
   if (rti_remote->base.tracing_enabled) {
     tracepoint_rti_from_federate(receive_TAGGED_MSG, sending_federate->enclave.id, &intended_tag);
@@ -284,12 +750,11 @@ void handle_timed_message(federate_info_t* sending_federate, unsigned char* buff
 
   // Need to acquire the mutex lock to ensure that the thread handling
   // messages coming from the network abstraction connected to the destination does not
-  // issue a TAG before this message has been forwarded.
+  // issue a TAG before this message has been queued for forwarding.
   LF_MUTEX_LOCK(&rti_mutex);
 
   // If the destination federate is no longer connected, issue a warning,
-  // remove the message from the network abstraction and return.
-  federate_info_t* fed = GET_FED_INFO(federate_id);
+  // drop the message and return.
   if (fed->enclave.state == NOT_CONNECTED) {
     lf_print_warning("RTI: Destination federate %d is no longer connected. Dropping message.", federate_id);
     LF_PRINT_LOG("Fed status: next_event " PRINTF_TAG ", "
@@ -301,17 +766,8 @@ void handle_timed_message(federate_info_t* sending_federate, unsigned char* buff
                  fed->enclave.last_granted.time - start_time, fed->enclave.last_granted.microstep,
                  fed->enclave.last_provisionally_granted.time - start_time,
                  fed->enclave.last_provisionally_granted.microstep);
-    // If the message was larger than the buffer, we must empty out the remainder also.
-    size_t total_bytes_read = bytes_read;
-    while (total_bytes_read < total_bytes_to_read) {
-      bytes_to_read = total_bytes_to_read - total_bytes_read;
-      if (bytes_to_read > FED_COM_BUFFER_SIZE) {
-        bytes_to_read = FED_COM_BUFFER_SIZE;
-      }
-      read_from_net_fail_on_error(sending_federate->net, bytes_to_read, buffer, "RTI failed to clear message chunks.");
-      total_bytes_read += bytes_to_read;
-    }
     LF_MUTEX_UNLOCK(&rti_mutex);
+    free(message);
     return;
   }
 
@@ -326,29 +782,23 @@ void handle_timed_message(federate_info_t* sending_federate, unsigned char* buff
   }
 
   if (rti_remote->base.tracing_enabled) {
-    tracepoint_rti_to_federate(send_TAGGED_MSG, federate_id, &intended_tag);
+    tracepoint_rti_to_federate(send_TAGGED_MSG, fed->enclave.id, &intended_tag);
   }
 
-  write_to_net_fail_on_error(fed->net, bytes_read, buffer, &rti_mutex, "RTI failed to forward message to federate %d.",
-                             federate_id);
-
-  // The message length may be longer than the buffer,
-  // in which case we have to handle it in chunks.
-  size_t total_bytes_read = bytes_read;
-  while (total_bytes_read < total_bytes_to_read) {
-    LF_PRINT_DEBUG("Forwarding message in chunks.");
-    bytes_to_read = total_bytes_to_read - total_bytes_read;
-    if (bytes_to_read > FED_COM_BUFFER_SIZE) {
-      bytes_to_read = FED_COM_BUFFER_SIZE;
-    }
-    read_from_net_fail_on_error(sending_federate->net, bytes_to_read, buffer, "RTI failed to read message chunks.");
-    total_bytes_read += bytes_to_read;
+  // Any TAG or PTAG that is later sent to the destination is queued after this message or,
+  // on a control lane, waits for it.
+  if (enqueue_to_federate(fed, message)) {
+    lf_print_error("RTI failed to forward message to federate %d.", federate_id);
+    fed->enclave.state = NOT_CONNECTED;
+    LF_MUTEX_UNLOCK(&rti_mutex);
+    return;
+  }
+  count_fenced_message_sent_locked(fed, intended_tag);
 
-    // FIXME: a mutex needs to be held for this so that other threads
-    // do not write to destination_socket and cause interleaving. However,
-    // holding the rti_mutex might be very expensive. Instead, each outgoing
-    // network abstraction should probably have its own mutex.
-    write_to_net_fail_on_error(fed->net, bytes_to_read, buffer, &rti_mutex, "RTI failed to send message chunks.");
+  // The parent of a cluster RTI keeps track of the messages in transit to the rest of the federation.
+  if (fed == rti_remote->parent) {
+    LF_MUTEX_UNLOCK(&rti_mutex);
+    return;
   }
 
   // Record this in-transit message in federate's in-transit message queue.
@@ -369,18 +819,59 @@ void handle_timed_message(federate_info_t* sending_federate, unsigned char* buff
   // If the message tag is less than the most recently received NET from the federate,
   // then update the federate's next event tag to match the message tag.
   if (lf_tag_compare(intended_tag, fed->enclave.next_event) < 0) {
-    update_federate_next_event_tag_locked(federate_id, intended_tag);
+    update_federate_next_event_tag_locked(fed->enclave.id, intended_tag);
+    notify_parent_locked();
   }
 
   LF_MUTEX_UNLOCK(&rti_mutex);
 }
 
-void handle_latest_tag_confirmed(federate_info_t* fed) {
-  unsigned char buffer[sizeof(int64_t) + sizeof(uint32_t)];
-  read_from_net_fail_on_error(fed->net, sizeof(int64_t) + sizeof(uint32_t), buffer,
-                              "RTI failed to read the content of the logical tag complete from federate %d.",
-                              fed->enclave.id);
-  tag_t completed = extract_tag(buffer);
+int handle_timed_message(federate_info_t* sending_federate, unsigned char* buffer) {
+  size_t header_size = TIMED_MESSAGE_HEADER_SIZE;
+  // Read the header, minus the first byte which has already been read.
+  read_from_net_fail_on_error(sending_federate->net, header_size - 1, &(buffer[1]),
+                              "RTI failed to read the timed message header from remote federate.");
+  // Extract the header information. of the sender
+  uint16_t reactor_port_id;
+  uint16_t federate_id;
+  size_t length;
+  tag_t intended_tag;
+  // Extract information from the header.
+  extract_timed_header(&(buffer[1]), &reactor_port_id, &federate_id, &length, &intended_tag);
+
+  LF_PRINT_LOG("RTI received message from federate %d for federate %u port %u with intended tag " PRINTF_TAG
+               ". Forwarding.",
+               sending_federate->enclave.id, federate_id, reactor_port_id, intended_tag.time - lf_time_start(),
+               intended_tag.microstep);
+
+  // The memory for the message is allocated before its payload is read, so the header is checked first.
+  if (length > RTI_MAX_MESSAGE_LENGTH || destination_node(federate_id) >= rti_remote->base.number_of_scheduling_nodes) {
+    lf_print_error("RTI received from federate %d a message of %zu bytes for federate %u, which it cannot forward.",
+                   sending_federate->enclave.id, length, federate_id);
+    return -1;
+  }
+  federate_info_t* fed = GET_FED_INFO(destination_node(federate_id));
+
+#ifdef PLATFORM_Linux
+  // A thread of the event loop must not wait for a sender that trickles a payload or for a destination
+  // that does not keep up, as other federates would wait for their messages to be handled meanwhile.
+  if (rti_remote->event_loop_threads > 0 && sending_federate != rti_remote->parent &&
+      (get_available_input(sending_federate->net) < length || !has_send_queue_space(fed, header_size + length))) {
+    read_payload_off_event_loop(sending_federate, fed, buffer);
+    return 1;
+  }
+#endif
+  forward_timed_message(sending_federate, fed, buffer);
+  return 0;
+}
+
+/**
+ * Apply a latest tag confirmed (LTC) from a federate.
+ * This can be called with or without holding rti_mutex.
+ * @param fed The federate.
+ * @param completed The tag that the federate has completed.
+ */
+static void apply_latest_tag_confirmed(federate_info_t* fed, tag_t completed) {
   if (rti_remote->base.tracing_enabled) {
     tracepoint_rti_from_federate(receive_LTC, fed->enclave.id, &completed);
   }
@@ -390,28 +881,200 @@ void handle_latest_tag_confirmed(federate_info_t* fed) {
   LF_MUTEX_LOCK(&rti_mutex);
   // See if we can remove any of the recorded in-transit messages for this.
   pqueue_tag_remove_up_to(fed->in_transit_message_tags, completed);
+  notify_parent_locked();
   LF_MUTEX_UNLOCK(&rti_mutex);
 }
 
-void handle_next_event_tag(federate_info_t* fed) {
-  unsigned char buffer[sizeof(int64_t) + sizeof(uint32_t)];
-  read_from_net_fail_on_error(fed->net, sizeof(int64_t) + sizeof(uint32_t), buffer,
-                              "RTI failed to read the content of the next event tag from federate %d.",
-                              fed->enclave.id);
-
+/**
+ * Apply a next event tag (NET) from a federate.
+ * This can be called with or without holding rti_mutex.
+ * @param fed The federate.
+ * @param intended_tag The next event tag of the federate.
+ */
+static void apply_next_event_tag(federate_info_t* fed, tag_t intended_tag) {
   // Acquire a mutex lock to ensure that this state does not change while a
   // message is in transport or being used to determine a TAG.
   LF_MUTEX_LOCK(&rti_mutex); // FIXME: Instead of using a mutex, it might be more efficient to use a
                              // select() mechanism to read and process federates' buffers in an orderly fashion.
 
-  tag_t intended_tag = extract_tag(buffer);
   if (rti_remote->base.tracing_enabled) {
     tracepoint_rti_from_federate(receive_NET, fed->enclave.id, &intended_tag);
   }
   LF_PRINT_LOG("RTI received from federate %d the Next Event Tag (NET) " PRINTF_TAG, fed->enclave.id,
                intended_tag.time - start_time, intended_tag.microstep);
   update_federate_next_event_tag_locked(fed->enclave.id, intended_tag);
+  notify_parent_locked();
+  LF_MUTEX_UNLOCK(&rti_mutex);
+}
+
+/**
+ * Apply a next message request (NMR) from a federate.
+ * This can be called with or without holding rti_mutex.
+ * @param fed The federate.
+ * @param completed The tag that the federate has completed.
+ * @param intended_tag The next event tag of the federate.
+ */
+static void apply_next_message_request(federate_info_t* fed, tag_t completed, tag_t intended_tag) {
+  if (rti_remote->base.tracing_enabled) {
+    tracepoint_rti_from_federate(receive_LTC, fed->enclave.id, &completed);
+    tracepoint_rti_from_federate(receive_NET, fed->enclave.id, &intended_tag);
+  }
+  LF_PRINT_LOG("RTI received from federate %d the latest tag confirmed (LTC) " PRINTF_TAG
+               " and the Next Event Tag (NET) " PRINTF_TAG,
+               fed->enclave.id, completed.time - start_time, completed.microstep, intended_tag.time - start_time,
+               intended_tag.microstep);
+
+  LF_MUTEX_LOCK(&rti_mutex);
+  fed->enclave.completed = completed;
+  pqueue_tag_remove_up_to(fed->in_transit_message_tags, completed);
+  // This checks the grants of all nodes downstream of the federate, which covers those that the
+  // completed tag, as well as the next event tag, can unblock.
+  update_federate_next_event_tag_locked(fed->enclave.id, intended_tag);
+  notify_parent_locked();
+  LF_MUTEX_UNLOCK(&rti_mutex);
+}
+
+void handle_latest_tag_confirmed(federate_info_t* fed) {
+  unsigned char buffer[sizeof(int64_t) + sizeof(uint32_t)];
+  read_from_net_fail_on_error(fed->net, sizeof(int64_t) + sizeof(uint32_t), buffer,
+                              "RTI failed to read the content of the logical tag complete from federate %d.",
+                              fed->enclave.id);
+  apply_latest_tag_confirmed(fed, extract_tag(buffer));
+}
+
+void handle_next_event_tag(federate_info_t* fed) {
+  unsigned char buffer[sizeof(int64_t) + sizeof(uint32_t)];
+  read_from_net_fail_on_error(fed->net, sizeof(int64_t) + sizeof(uint32_t), buffer,
+                              "RTI failed to read the content of the next event tag from federate %d.",
+                              fed->enclave.id);
+  apply_next_event_tag(fed, extract_tag(buffer));
+}
+
+void handle_next_message_request(federate_info_t* fed) {
+  unsigned char buffer[MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH - 1];
+  read_from_net_fail_on_error(fed->net, sizeof(buffer), buffer,
+                              "RTI failed to read the content of the next message request from federate %d.",
+                              fed->enclave.id);
+  apply_next_message_request(fed, extract_tag(buffer), extract_tag(&buffer[sizeof(int64_t) + sizeof(uint32_t)]));
+}
+
+/**
+ * Apply a tag coordination message from the control lane of a federate.
+ * This can be called with or without holding rti_mutex.
+ * @param fed The federate.
+ * @param type The message type.
+ * @param tags The tags carried by the message.
+ */
+static void apply_control_message(federate_info_t* fed, unsigned char type, const tag_t* tags) {
+  switch (type) {
+  case MSG_TYPE_NEXT_EVENT_TAG:
+    apply_next_event_tag(fed, tags[0]);
+    break;
+  case MSG_TYPE_LATEST_TAG_CONFIRMED:
+    apply_latest_tag_confirmed(fed, tags[0]);
+    break;
+  default:
+    apply_next_message_request(fed, tags[0], tags[1]);
+  }
+}
+
+/**
+ * Record that a fenced message from a federate, which later messages on its control lane must not
+ * overtake, has been handled, and apply the control messages that were waiting for it.
+ * This function assumes the caller does not hold the mutex.
+ * @param fed The federate.
+ */
+static void count_fenced_message_received(federate_info_t* fed) {
+  if (fed->control.net == NULL) {
+    return;
+  }
+  LF_MUTEX_LOCK(&rti_mutex);
+  fed->control.fenced_messages_received++;
+  while (fed->control.deferred_head != NULL &&
+         fed->control.deferred_head->fence <= fed->control.fenced_messages_received) {
+    rti_deferred_control_message_t* deferred = fed->control.deferred_head;
+    fed->control.deferred_head = deferred->next;
+    if (fed->control.deferred_head == NULL) {
+      fed->control.deferred_tail = NULL;
+    }
+    if (fed->enclave.state != NOT_CONNECTED) {
+      apply_control_message(fed, deferred->type, deferred->tags);
+    }
+    free(deferred);
+  }
+  LF_MUTEX_UNLOCK(&rti_mutex);
+}
+
+/**
+ * Read one message from the control lane of a federate and apply it once the fenced messages that
+ * the federate sent before it have been handled.
+ * This function assumes the caller does not hold the mutex.
+ * @param fed The federate.
+ * @return false if the control lane is closed or the message is not a tag coordination message,
+ * true otherwise.
+ */
+static bool handle_control_message(federate_info_t* fed) {
+  unsigned char buffer[MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH + CONTROL_LANE_FENCE_LENGTH];
+  if (read_from_net(fed->control.net, 1, buffer)) {
+    LF_PRINT_LOG("RTI: Control lane of federate %d is closed.", fed->enclave.id);
+    return false;
+  }
+  unsigned char type = buffer[0];
+  size_t tag_length = sizeof(int64_t) + sizeof(uint32_t);
+  size_t length = tag_length;
+  if (type == MSG_TYPE_NEXT_MESSAGE_REQUEST) {
+    length = 2 * tag_length;
+  } else if (type != MSG_TYPE_NEXT_EVENT_TAG && type != MSG_TYPE_LATEST_TAG_CONFIRMED) {
+    lf_print_error("RTI received on the control lane of federate %d an unexpected message type: %u.",
+                   fed->enclave.id, type);
+    return false;
+  }
+  if (read_from_net(fed->control.net, length + CONTROL_LANE_FENCE_LENGTH, &buffer[1])) {
+    lf_print_error("RTI failed to read a message from the control lane of federate %d.", fed->enclave.id);
+    return false;
+  }
+  tag_t tags[2] = {extract_tag(&buffer[1]), NEVER_TAG};
+  if (type == MSG_TYPE_NEXT_MESSAGE_REQUEST) {
+    tags[1] = extract_tag(&buffer[1 + tag_length]);
+  }
+  int64_t fence = extract_int64(&buffer[1 + length]);
+
+  LF_MUTEX_LOCK(&rti_mutex);
+  if (fed->enclave.state == NOT_CONNECTED) {
+    // Messages that arrive after the federate has disconnected from the RTI are irrelevant.
+  } else if (fed->control.deferred_head == NULL && fence <= fed->control.fenced_messages_received) {
+    apply_control_message(fed, type, tags);
+  } else {
+    rti_deferred_control_message_t* deferred =
+        (rti_deferred_control_message_t*)malloc(sizeof(rti_deferred_control_message_t));
+    LF_ASSERT_NON_NULL(deferred);
+    deferred->next = NULL;
+    deferred->type = type;
+    deferred->fence = fence;
+    deferred->tags[0] = tags[0];
+    deferred->tags[1] = tags[1];
+    if (fed->control.deferred_tail == NULL) {
+      fed->control.deferred_head = deferred;
+    } else {
+      fed->control.deferred_tail->next = deferred;
+    }
+    fed->control.deferred_tail = deferred;
+  }
   LF_MUTEX_UNLOCK(&rti_mutex);
+  return true;
+}
+
+/**
+ * Thread handling the messages on the control lane of a federate until it is closed.
+ * @param fed The federate.
+ * @return NULL.
+ */
+static void* control_lane_thread(void* fed) {
+  initialize_lf_thread_id();
+  federate_info_t* my_fed = (federate_info_t*)fed;
+  while (handle_control_message(my_fed)) {
+  }
+  return NULL;
 }
 
 /////////////////// STOP functions ////////////////////
@@ -441,7 +1104,7 @@ static void broadcast_stop_time_to_federates_locked() {
   ENCODE_STOP_GRANTED(outgoing_buffer, rti_remote->base.max_stop_tag.time, rti_remote->base.max_stop_tag.microstep);
 
   // Iterate over federates and send each the message.
-  for (int i = 0; i < rti_remote->base.number_of_scheduling_nodes; i++) {
+  for (int i = 0; i < number_of_federates(); i++) {
     federate_info_t* fed = GET_FED_INFO(i);
     if (fed->enclave.state == NOT_CONNECTED) {
       continue;
@@ -453,8 +1116,12 @@ static void broadcast_stop_time_to_federates_locked() {
     if (rti_remote->base.tracing_enabled) {
       tracepoint_rti_to_federate(send_STOP_GRN, fed->enclave.id, &rti_remote->base.max_stop_tag);
     }
-    write_to_net_fail_on_error(fed->net, MSG_TYPE_STOP_GRANTED_LENGTH, outgoing_buffer, &rti_mutex,
-                               "RTI failed to send MSG_TYPE_STOP_GRANTED message to federate %d.", fed->enclave.id);
+    if (send_to_federate(fed, MSG_TYPE_STOP_GRANTED_LENGTH, outgoing_buffer)) {
+      lf_print_error("RTI failed to send MSG_TYPE_STOP_GRANTED message to federate %d.", fed->enclave.id);
+      fed->enclave.state = NOT_CONNECTED;
+    } else {
+      count_fenced_message_sent_locked(fed, NEVER_TAG);
+    }
   }
 
   LF_PRINT_LOG("RTI sent to federates MSG_TYPE_STOP_GRANTED with tag " PRINTF_TAG,
@@ -463,7 +1130,9 @@ static void broadcast_stop_time_to_federates_locked() {
 
 /**
  * Mark a federate requesting stop. If the number of federates handling stop reaches the
- * NUM_OF_FEDERATES, broadcast MSG_TYPE_STOP_GRANTED to every federate.
+ * NUM_OF_FEDERATES, broadcast MSG_TYPE_STOP_GRANTED to every federate. In a cluster RTI, the
+ * parent is marked only once it grants the stop tag, so once all members are marked, the stop tag
+ * of the cluster is sent to the parent instead.
  * This function assumes the _RTI.mutex is already locked.
  * @param fed The federate that has requested a stop.
  * @return 1 if stop time has been sent to all federates and 0 otherwise.
@@ -479,6 +1148,9 @@ static int mark_federate_requesting_stop(federate_info_t* fed) {
     broadcast_stop_time_to_federates_locked();
     return 1;
   }
+  if (is_cluster_rti() && rti_remote->base.num_scheduling_nodes_handling_stop == number_of_federates()) {
+    send_stop_tag_to_parent_locked();
+  }
   return 0;
 }
 
@@ -540,9 +1212,11 @@ void handle_stop_request_message(federate_info_t* fed) {
     rti_remote->base.max_stop_tag = proposed_stop_tag;
   }
 
-  // If all federates have replied, send stop request granted.
-  if (mark_federate_requesting_stop(fed)) {
-    // Have send stop request granted to all federates. Nothing more to do.
+  if (fed == rti_remote->parent) {
+    // The parent of a cluster RTI is asking the members, which it will then grant the stop tag.
+    stop_requested_by_parent = true;
+  } else if (mark_federate_requesting_stop(fed)) {
+    // All federates have replied, so stop granted has been sent to all of them. Nothing more to do.
     LF_MUTEX_UNLOCK(&rti_mutex);
     return;
   }
@@ -563,7 +1237,7 @@ void handle_stop_request_message(federate_info_t* fed) {
   lf_thread_t timeout_thread;
   lf_thread_create(&timeout_thread, wait_for_stop_request_reply, NULL);
 
-  for (int i = 0; i < rti_remote->base.number_of_scheduling_nodes; i++) {
+  for (int i = 0; i < number_of_federates(); i++) {
     federate_info_t* f = GET_FED_INFO(i);
     if (f->enclave.id != fed->enclave.id && f->requested_stop == false) {
       if (f->enclave.state == NOT_CONNECTED) {
@@ -573,8 +1247,12 @@ void handle_stop_request_message(federate_info_t* fed) {
       if (rti_remote->base.tracing_enabled) {
         tracepoint_rti_to_federate(send_STOP_REQ, f->enclave.id, &rti_remote->base.max_stop_tag);
       }
-      write_to_net_fail_on_error(f->net, MSG_TYPE_STOP_REQUEST_LENGTH, stop_request_buffer, &rti_mutex,
-                                 "RTI failed to forward MSG_TYPE_STOP_REQUEST message to federate %d.", f->enclave.id);
+      if (send_to_federate(f, MSG_TYPE_STOP_REQUEST_LENGTH, stop_request_buffer)) {
+        lf_print_error("RTI failed to forward MSG_TYPE_STOP_REQUEST message to federate %d.", f->enclave.id);
+        f->enclave.state = NOT_CONNECTED;
+      } else {
+        count_fenced_message_sent_locked(f, NEVER_TAG);
+      }
     }
   }
   LF_PRINT_LOG("RTI forwarded to federates MSG_TYPE_STOP_REQUEST with tag (" PRINTF_TIME ", %u).",
@@ -610,11 +1288,100 @@ void handle_stop_request_reply(federate_info_t* fed) {
 
 //////////////////////////////////////////////////
 
+/**
+ * Return whether a federate of this RTI is another RTI, which knows the addresses of the federates
+ * that it coordinates: the parent of a cluster RTI or a cluster of a root RTI.
+ * @param fed The federate.
+ */
+static bool is_rti(federate_info_t* fed) {
+  return fed == rti_remote->parent || (rti_remote->cluster_size > 0 && !is_cluster_rti());
+}
+
+/**
+ * Send a federate the reply to its address query.
+ * This function assumes the caller holds the mutex.
+ * @param fed The federate that sent the query.
+ * @param server_port The port of the queried federate, or -1 if it is not known.
+ * @param ip_address The IP address of the queried federate.
+ */
+static void send_address_query_reply_locked(federate_info_t* fed, int32_t server_port, const void* ip_address) {
+  unsigned char buffer[1 + sizeof(int32_t) + sizeof(uint32_t)];
+  buffer[0] = MSG_TYPE_ADDRESS_QUERY_REPLY;
+  encode_int32(server_port, &buffer[1]);
+  memcpy(&buffer[1 + sizeof(int32_t)], ip_address, sizeof(uint32_t));
+
+  // Send the port number (which could be -1) and the server IP address to federate.
+  if (send_to_federate(fed, sizeof(buffer), buffer)) {
+    lf_print_error("Failed to send the address query reply to federate %d.", fed->enclave.id);
+    fed->enclave.state = NOT_CONNECTED;
+  }
+  if (rti_remote->base.tracing_enabled) {
+    tracepoint_rti_to_federate(send_ADR_QR_REP, fed->enclave.id, NULL);
+  }
+  LF_PRINT_DEBUG("Replied to address query from federate %d", fed->enclave.id);
+}
+
+/**
+ * Forward an address query to another RTI, which knows the address of the queried federate.
+ * This function assumes the caller holds the mutex.
+ * @param fed The federate that sent the query.
+ * @param rti The other RTI.
+ * @param remote_fed_id The ID of the queried federate in the federation.
+ * @return 0 on success, -1 if the connection to the other RTI has failed.
+ */
+static int forward_address_query_locked(federate_info_t* fed, federate_info_t* rti, uint16_t remote_fed_id) {
+  unsigned char buffer[1 + sizeof(uint16_t)];
+  buffer[0] = MSG_TYPE_ADDRESS_QUERY;
+  encode_uint16(remote_fed_id, &buffer[1]);
+  if (send_to_federate(rti, sizeof(buffer), buffer)) {
+    lf_print_error("Failed to forward the address query of federate %d to RTI %d.", fed->enclave.id, rti->enclave.id);
+    rti->enclave.state = NOT_CONNECTED;
+    return -1;
+  }
+  // The other RTI replies to queries in the order in which it receives them.
+  rti->forwarded_address_queries = (uint16_t*)realloc(rti->forwarded_address_queries,
+                                                      (rti->num_forwarded_address_queries + 1) * sizeof(uint16_t));
+  LF_ASSERT_NON_NULL(rti->forwarded_address_queries);
+  rti->forwarded_address_queries[rti->num_forwarded_address_queries++] = fed->enclave.id;
+  LF_PRINT_DEBUG("RTI forwarded address query from %d for %d to RTI %d.", fed->enclave.id, remote_fed_id,
+                 rti->enclave.id);
+  return 0;
+}
+
+/**
+ * Pass the reply of another RTI to the oldest address query forwarded to it on to the federate
+ * that sent the query.
+ * This function assumes the caller holds the mutex.
+ * @param rti The other RTI.
+ * @param server_port The port in the reply.
+ * @param ip_address The IP address in the reply.
+ */
+static void reply_to_forwarded_address_query_locked(federate_info_t* rti, int32_t server_port, const void* ip_address) {
+  federate_info_t* fed = GET_FED_INFO(rti->forwarded_address_queries[0]);
+  rti->num_forwarded_address_queries--;
+  memmove(rti->forwarded_address_queries, &rti->forwarded_address_queries[1],
+          rti->num_forwarded_address_queries * sizeof(uint16_t));
+  if (fed->enclave.state != NOT_CONNECTED) {
+    send_address_query_reply_locked(fed, server_port, ip_address);
+  }
+}
+
+/**
+ * Reply that the address is not known to the address queries forwarded to an RTI that is no longer
+ * connected, so that the federates that sent them ask again rather than wait for a reply forever.
+ * This function assumes the caller holds the mutex.
+ * @param rti The other RTI.
+ */
+static void fail_forwarded_address_queries_locked(federate_info_t* rti) {
+  uint32_t no_address = 0;
+  while (rti->num_forwarded_address_queries > 0) {
+    reply_to_forwarded_address_query_locked(rti, -1, &no_address);
+  }
+}
+
 void handle_address_query(uint16_t fed_id) {
   federate_info_t* fed = GET_FED_INFO(fed_id);
-  // Use buffer both for reading and constructing the reply.
-  // The length is what is needed for the reply.
-  unsigned char buffer[1 + sizeof(int32_t)];
+  unsigned char buffer[sizeof(uint16_t)];
   read_from_net_fail_on_error(fed->net, sizeof(uint16_t), (unsigned char*)buffer, "Failed to read address query.");
   uint16_t remote_fed_id = extract_uint16(buffer);
 
@@ -627,46 +1394,50 @@ void handle_address_query(uint16_t fed_id) {
   // NOTE: server_port initializes to -1, which means the RTI does not know
   // the port number because it has not yet received an MSG_TYPE_ADDRESS_ADVERTISEMENT message
   // from this federate. In that case, it will respond by sending -1.
-
-  // Response message is MSG_TYPE_ADDRESS_QUERY_REPLY.
-  buffer[0] = MSG_TYPE_ADDRESS_QUERY_REPLY;
-
-  // Encode the port number.
-  federate_info_t* remote_fed = GET_FED_INFO(remote_fed_id);
-
-  int32_t server_port;
-  uint32_t* ip_address;
+  int32_t server_port = -1;
   uint32_t temp = 0;
+  const void* ip_address = &temp;
 
+  uint16_t node = destination_node(remote_fed_id);
   LF_MUTEX_LOCK(&rti_mutex);
-  // Check if the RTI has initialized the remote federate's network abstraction.
-  if (remote_fed->net == NULL) {
-    // RTI has not set up the remote federate. Respond with -1 to indicate an unknown port number.
-    server_port = -1;
-    ip_address = &temp;
-  } else {
-    // The network abstraction is initialized, but the RTI might still not know the port number. This can happen if the
-    // RTI has not yet received a MSG_TYPE_ADDRESS_ADVERTISEMENT message from the remote federate. In such cases, the
-    // returned port number might still be -1.
-    server_port = get_server_port(remote_fed->net);
-    ip_address = (uint32_t*)get_ip_addr(remote_fed->net);
+  if (node < rti_remote->base.number_of_scheduling_nodes) {
+    federate_info_t* remote_fed = GET_FED_INFO(node);
+    if (is_rti(remote_fed)) {
+      // The remote federate is in another cluster, whose RTI knows its address. A query that such
+      // an RTI forwarded here for a federate that is not in this cluster gets -1.
+      if (remote_fed != fed && remote_fed->net != NULL && remote_fed->enclave.state != NOT_CONNECTED &&
+          forward_address_query_locked(fed, remote_fed, remote_fed_id) == 0) {
+        LF_MUTEX_UNLOCK(&rti_mutex);
+        return;
+      }
+    } else if (remote_fed->net != NULL) {
+      // The network abstraction is initialized, but the RTI might still not know the port number. This can happen if
+      // the RTI has not yet received a MSG_TYPE_ADDRESS_ADVERTISEMENT message from the remote federate. In such cases,
+      // the returned port number might still be -1.
+      server_port = get_server_port(remote_fed->net);
+      ip_address = get_ip_addr(remote_fed->net);
+    }
   }
-
-  encode_int32(server_port, (unsigned char*)&buffer[1]);
-
-  // Send the port number (which could be -1) and the server IP address to federate.
-  write_to_net_fail_on_error(fed->net, 1 + sizeof(int32_t), (unsigned char*)buffer, &rti_mutex,
-                             "Failed to write port number to network abstraction of federate %d.", fed_id);
-
-  write_to_net_fail_on_error(fed->net, sizeof(uint32_t), (unsigned char*)ip_address, &rti_mutex,
-                             "Failed to write ip address to network abstraction of federate %d.", fed_id);
+  send_address_query_reply_locked(fed, server_port, ip_address);
   LF_MUTEX_UNLOCK(&rti_mutex);
+}
 
-  if (rti_remote->base.tracing_enabled) {
-    tracepoint_rti_to_federate(send_ADR_QR_REP, fed_id, NULL);
+/**
+ * Handle the reply of another RTI to an address query that this RTI forwarded to it.
+ * This function assumes the caller does not hold the mutex.
+ * @param rti The other RTI.
+ */
+static void handle_address_query_reply(federate_info_t* rti) {
+  unsigned char buffer[sizeof(int32_t) + sizeof(uint32_t)];
+  read_from_net_fail_on_error(rti->net, sizeof(buffer), buffer, "RTI failed to read an address query reply from %d.",
+                              rti->enclave.id);
+  LF_MUTEX_LOCK(&rti_mutex);
+  if (rti->num_forwarded_address_queries == 0) {
+    lf_print_error("RTI received an address query reply from %d, to which it forwarded no query.", rti->enclave.id);
+  } else {
+    reply_to_forwarded_address_query_locked(rti, extract_int32(buffer), &buffer[sizeof(int32_t)]);
   }
-
-  LF_PRINT_DEBUG("Replied to address query from federate %d", fed_id);
+  LF_MUTEX_UNLOCK(&rti_mutex);
 }
 
 void handle_address_ad(uint16_t federate_id) {
@@ -692,6 +1463,106 @@ void handle_address_ad(uint16_t federate_id) {
   }
 }
 
+/**
+ * Handle the codec announced by a federate (@see MSG_TYPE_COMPRESSION).
+ * This function assumes the caller does not hold the mutex.
+ * @param fed The federate.
+ */
+static void handle_compression(federate_info_t* fed) {
+  unsigned char codec;
+  read_from_net_fail_on_error(fed->net, 1, &codec, "RTI failed to read the codec of federate %d.", fed->enclave.id);
+  LF_MUTEX_LOCK(&rti_mutex);
+  fed->compression_codec = codec;
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  LF_PRINT_LOG("RTI received codec %u from federate %d.", codec, fed->enclave.id);
+}
+
+/**
+ * Send to a federate the codecs of all federates that announced one, so that it knows to which of
+ * them it can send compressed payloads (@see MSG_TYPE_COMPRESSION).
+ * This function assumes the caller holds the mutex.
+ * @param fed The federate.
+ */
+static void send_compression_codecs_locked(federate_info_t* fed) {
+  uint16_t count = 0;
+  for (int i = 0; i < number_of_federates(); i++) {
+    federate_info_t* other = GET_FED_INFO(i);
+    if (other->compression_codec != COMPRESSION_CODEC_NONE) {
+      count++;
+    }
+  }
+  size_t entry_length = sizeof(uint16_t) + 1;
+  rti_outbound_message_t* message = new_outbound_message(1 + sizeof(uint16_t) + count * entry_length);
+  message->data[0] = MSG_TYPE_COMPRESSION;
+  encode_uint16(count, &message->data[1]);
+  unsigned char* entry = &message->data[1 + sizeof(uint16_t)];
+  for (int i = 0; i < number_of_federates(); i++) {
+    federate_info_t* other = GET_FED_INFO(i);
+    if (other->compression_codec != COMPRESSION_CODEC_NONE) {
+      // Federates outside a cluster are not listed, so payloads to them are not compressed.
+      int id = is_cluster_rti() ? rti_remote->cluster * rti_remote->cluster_size + i : i;
+      encode_uint16((uint16_t)id, entry);
+      entry[sizeof(uint16_t)] = other->compression_codec;
+      entry += entry_length;
+    }
+  }
+  if (enqueue_to_federate(fed, message)) {
+    lf_print_error("Failed to send the codecs of the federation to federate %d.", fed->enclave.id);
+  }
+}
+
+/**
+ * Send the start time of the federation to a federate, which grants it time advance to the start time.
+ * This function assumes the caller holds the mutex.
+ * @param fed The federate.
+ */
+static void send_start_time(federate_info_t* fed) {
+  if (fed->enclave.state == NOT_CONNECTED) {
+    return;
+  }
+  unsigned char start_time_buffer[MSG_TYPE_TIMESTAMP_LENGTH];
+  start_time_buffer[0] = MSG_TYPE_TIMESTAMP;
+  encode_int64(swap_bytes_if_big_endian_int64(start_time), &start_time_buffer[1]);
+
+  if (rti_remote->base.tracing_enabled) {
+    tag_t tag = {.time = start_time, .microstep = 0};
+    tracepoint_rti_to_federate(send_TIMESTAMP, fed->enclave.id, &tag);
+  }
+  if (send_to_federate(fed, MSG_TYPE_TIMESTAMP_LENGTH, start_time_buffer)) {
+    lf_print_error("Failed to send the starting time to federate %d.", fed->enclave.id);
+  }
+
+  if (fed->compression_codec != COMPRESSION_CODEC_NONE) {
+    send_compression_codecs_locked(fed);
+  }
+
+  // Update state for the federate to indicate that the MSG_TYPE_TIMESTAMP
+  // message has been sent. That MSG_TYPE_TIMESTAMP message grants time advance to
+  // the federate to the start time.
+  fed->enclave.state = GRANTED;
+  LF_PRINT_LOG("RTI sent start time " PRINTF_TIME " to federate %d.", start_time, fed->enclave.id);
+}
+
+/**
+ * Set the start time of the federation and send it to all federates at once, so that none of them
+ * is left PENDING once any of them can start sending messages.
+ * This function assumes the caller holds the mutex.
+ * @param start The start time.
+ */
+static void start_federation_locked(instant_t start) {
+  start_time = start;
+  lf_tracing_set_start_time(start_time);
+  for (int i = 0; i < number_of_federates(); i++) {
+    send_start_time(GET_FED_INFO(i));
+  }
+  if (is_cluster_rti()) {
+    // The start time grants the cluster time advance to the start time.
+    rti_remote->parent->enclave.state = GRANTED;
+  }
+  lf_cond_broadcast(&received_start_times);
+  lf_cond_broadcast(&sent_start_time);
+}
+
 void handle_timestamp(federate_info_t* my_fed) {
   unsigned char buffer[sizeof(int64_t)];
   // Read bytes from the network abstraction. We need 8 bytes.
@@ -710,52 +1581,30 @@ void handle_timestamp(federate_info_t* my_fed) {
   if (timestamp > rti_remote->max_start_time) {
     rti_remote->max_start_time = timestamp;
   }
-  if (rti_remote->num_feds_proposed_start == rti_remote->base.number_of_scheduling_nodes) {
+  if (rti_remote->num_feds_proposed_start == number_of_federates()) {
     // All federates have proposed a start time.
-    lf_cond_broadcast(&received_start_times);
-  } else {
-    // Some federates have not yet proposed a start time.
-    // wait for a notification.
-    while (rti_remote->num_feds_proposed_start < rti_remote->base.number_of_scheduling_nodes) {
-      // FIXME: Should have a timeout here?
-      lf_cond_wait(&received_start_times);
-    }
-  }
-
-  LF_MUTEX_UNLOCK(&rti_mutex);
-
-  // Send back to the federate the maximum time plus an offset on a TIMESTAMP
-  // message.
-  unsigned char start_time_buffer[MSG_TYPE_TIMESTAMP_LENGTH];
-  start_time_buffer[0] = MSG_TYPE_TIMESTAMP;
-  // Add an offset to this start time to get everyone starting together.
-  start_time = rti_remote->max_start_time + DELAY_START;
-  // If requested via the -m/--start-time-multiple command-line option, delay the
-  // start so that the starting logical time is a multiple of the given value.
-  if (rti_remote->start_time_multiple > 0LL) {
-    int64_t remainder = start_time % rti_remote->start_time_multiple;
-    if (remainder != 0LL) {
-      start_time += rti_remote->start_time_multiple - remainder;
+    if (is_cluster_rti()) {
+      // Propose the latest start time to the parent, which sends the start time of the federation.
+      unsigned char proposal[MSG_TYPE_TIMESTAMP_LENGTH];
+      proposal[0] = MSG_TYPE_TIMESTAMP;
+      encode_int64(swap_bytes_if_big_endian_int64(rti_remote->max_start_time), &proposal[1]);
+      if (send_to_federate(rti_remote->parent, MSG_TYPE_TIMESTAMP_LENGTH, proposal)) {
+        lf_print_error_and_exit("RTI of cluster %d failed to propose a start time to its parent.", rti_remote->cluster);
+      }
+    } else {
+      // Add an offset to the maximum proposal to get everyone starting together.
+      instant_t start = rti_remote->max_start_time + DELAY_START;
+      // If requested via the -m/--start-time-multiple command-line option, delay the
+      // start so that the starting logical time is a multiple of the given value.
+      if (rti_remote->start_time_multiple > 0LL) {
+        int64_t remainder = start % rti_remote->start_time_multiple;
+        if (remainder != 0LL) {
+          start += rti_remote->start_time_multiple - remainder;
+        }
+      }
+      start_federation_locked(start);
     }
   }
-  lf_tracing_set_start_time(start_time);
-  encode_int64(swap_bytes_if_big_endian_int64(start_time), &start_time_buffer[1]);
-
-  if (rti_remote->base.tracing_enabled) {
-    tag_t tag = {.time = start_time, .microstep = 0};
-    tracepoint_rti_to_federate(send_TIMESTAMP, my_fed->enclave.id, &tag);
-  }
-  if (write_to_net(my_fed->net, MSG_TYPE_TIMESTAMP_LENGTH, start_time_buffer)) {
-    lf_print_error("Failed to send the starting time to federate %d.", my_fed->enclave.id);
-  }
-
-  LF_MUTEX_LOCK(&rti_mutex);
-  // Update state for the federate to indicate that the MSG_TYPE_TIMESTAMP
-  // message has been sent. That MSG_TYPE_TIMESTAMP message grants time advance to
-  // the federate to the start time.
-  my_fed->enclave.state = GRANTED;
-  lf_cond_broadcast(&sent_start_time);
-  LF_PRINT_LOG("RTI sent start time " PRINTF_TIME " to federate %d.", start_time, my_fed->enclave.id);
   LF_MUTEX_UNLOCK(&rti_mutex);
 }
 
@@ -814,7 +1663,7 @@ void* clock_synchronization_thread(void* noargs) {
   // Wait until all federates have been notified of the start time.
   // FIXME: Use lf_ version of this when merged with master.
   LF_MUTEX_LOCK(&rti_mutex);
-  while (rti_remote->num_feds_proposed_start < rti_remote->base.number_of_scheduling_nodes) {
+  while (start_time == NEVER) {
     lf_cond_wait(&received_start_times);
   }
   LF_MUTEX_UNLOCK(&rti_mutex);
@@ -833,7 +1682,7 @@ void* clock_synchronization_thread(void* noargs) {
     // Sleep
     lf_sleep(rti_remote->clock_sync_period_ns); // Can be interrupted
     any_federates_connected = false;
-    for (int fed_id = 0; fed_id < rti_remote->base.number_of_scheduling_nodes; fed_id++) {
+    for (int fed_id = 0; fed_id < number_of_federates(); fed_id++) {
       federate_info_t* fed = GET_FED_INFO(fed_id);
       if (fed->enclave.state == NOT_CONNECTED) {
         // FIXME: We need better error handling here, but clock sync failure
@@ -894,159 +1743,844 @@ void* clock_synchronization_thread(void* noargs) {
       }
     }
   }
-  return NULL;
+  return NULL;
+}
+
+/**
+ * Close the connections to a federate after writing the messages already queued for it.
+ * The control lane, if any, is only closed, so that a thread reading from it returns. It is
+ * freed once no thread can be reading from it.
+ * @param fed The federate.
+ * @param read_before_closing Whether to read from the main connection until EOF before closing it.
+ */
+static void disconnect_federate(federate_info_t* fed, bool read_before_closing) {
+  stop_federate_writer(fed);
+  if (fed->control.net != NULL) {
+    close_net(fed->control.net, false);
+  }
+  shutdown_net(fed->net, read_before_closing);
+  fed->net = NULL;
+}
+
+/**
+ * Handle MSG_TYPE_FAILED sent by a federate. This message is sent by a federate
+ * that is exiting in failure.  In this case, the RTI will
+ * also terminate abnormally, returning a non-zero exit code when it exits.
+ *
+ * This function assumes the caller does not hold the mutex.
+ *
+ * @param my_fed The federate sending a MSG_TYPE_FAILED message.
+ */
+static void handle_federate_failed(federate_info_t* my_fed) {
+  // Nothing more to do. Close the network abstraction and exit.
+  LF_MUTEX_LOCK(&rti_mutex);
+
+  if (rti_remote->base.tracing_enabled) {
+    tracepoint_rti_from_federate(receive_FAILED, my_fed->enclave.id, NULL);
+  }
+
+  // Set the flag telling the RTI to exit with an error code when it exits.
+  _lf_federate_reports_error = true;
+  lf_print_error("RTI: Federate %d reports an error and has exited.", my_fed->enclave.id);
+
+  my_fed->enclave.state = NOT_CONNECTED;
+  // Paths through this federate no longer constrain those downstream of it.
+  invalidate_min_delays_through(&my_fed->enclave);
+
+  // Indicate that there will no further events from this federate.
+  my_fed->enclave.next_event = FOREVER_TAG;
+  fail_forwarded_address_queries_locked(my_fed);
+
+  disconnect_federate(my_fed, false);
+
+  // Check downstream federates to see whether they should now be granted a TAG.
+  notify_downstream_advance_grant_if_safe(&(my_fed->enclave));
+  notify_parent_locked();
+
+  LF_MUTEX_UNLOCK(&rti_mutex);
+}
+
+/**
+ * Handle MSG_TYPE_RESIGN sent by a federate. This message is sent at the time of termination
+ * after all shutdown events are processed on the federate.
+ *
+ * This function assumes the caller does not hold the mutex.
+ *
+ * @note At this point, the RTI might have outgoing messages to the federate. This
+ * function thus first performs a shutdown on the network abstraction, which sends an EOF. It then
+ * waits for the remote network abstraction to be closed before closing the network abstraction itself.
+ *
+ * @param my_fed The federate sending a MSG_TYPE_RESIGN message.
+ */
+static void handle_federate_resign(federate_info_t* my_fed) {
+  // Nothing more to do. Close the network abstraction and exit.
+  LF_MUTEX_LOCK(&rti_mutex);
+
+  if (rti_remote->base.tracing_enabled) {
+    tracepoint_rti_from_federate(receive_RESIGN, my_fed->enclave.id, NULL);
+  }
+
+  lf_print_info("RTI: Federate %d has resigned.", my_fed->enclave.id);
+
+  my_fed->enclave.state = NOT_CONNECTED;
+  // Paths through this federate no longer constrain those downstream of it.
+  invalidate_min_delays_through(&my_fed->enclave);
+
+  // Indicate that there will no further events from this federate.
+  my_fed->enclave.next_event = FOREVER_TAG;
+  fail_forwarded_address_queries_locked(my_fed);
+
+  // Write the messages that are already queued for the federate before closing.
+  disconnect_federate(my_fed, true);
+
+  // Check downstream federates to see whether they should now be granted a TAG.
+  notify_downstream_advance_grant_if_safe(&(my_fed->enclave));
+  notify_parent_locked();
+
+  LF_MUTEX_UNLOCK(&rti_mutex);
+}
+
+/**
+ * Close the connection to a federate whose connection is lost or that has sent a malformed message.
+ *
+ * This function assumes the caller does not hold the mutex.
+ *
+ * @param my_fed The federate.
+ */
+static void close_federate_connection(federate_info_t* my_fed) {
+  LF_MUTEX_LOCK(&rti_mutex);
+  my_fed->enclave.state = NOT_CONNECTED;
+  invalidate_min_delays_through(&my_fed->enclave);
+  fail_forwarded_address_queries_locked(my_fed);
+  notify_parent_locked();
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  // Nothing more to do. Close the network abstraction and exit.
+  // Prevent multiple threads from closing the same network abstraction at the same time.
+  disconnect_federate(my_fed, false);
+  // FIXME: We need better error handling here, but do not stop execution here.
+}
+
+/** What the thread that has handled a message from a federate is to do next. */
+typedef enum {
+  /** Keep reading messages from the federate. */
+  KEEP_SERVING,
+  /** Stop, as the federate has resigned or failed or its connection is closed. */
+  STOP_SERVING,
+  /** Stop reading from the federate until a payload reader of the event loop has read the rest of the message. */
+  HANDED_OFF
+} serving_t;
+
+/**
+ * Read one message from a federate and handle it.
+ *
+ * This function assumes the caller does not hold the mutex.
+ *
+ * @param my_fed The federate.
+ * @param buffer A buffer of FED_COM_BUFFER_SIZE bytes for the handlers to use.
+ * @return What to do next. Only threads of the event loop are handed off.
+ */
+static serving_t handle_federate_message(federate_info_t* my_fed, unsigned char* buffer) {
+  // Read no more than one byte to get the message type.
+  int read_failed = read_from_net(my_fed->net, 1, buffer);
+  if (read_failed) {
+    // network abstraction is closed
+    lf_print_info("RTI: Connection to federate %d is closed. Exiting the thread.", my_fed->enclave.id);
+    close_federate_connection(my_fed);
+    return STOP_SERVING;
+  }
+  LF_PRINT_DEBUG("RTI: Received message type %u from federate %d.", buffer[0], my_fed->enclave.id);
+  switch (buffer[0]) {
+  case MSG_TYPE_TIMESTAMP:
+    handle_timestamp(my_fed);
+    break;
+  case MSG_TYPE_COMPRESSION:
+    handle_compression(my_fed);
+    break;
+  case MSG_TYPE_ADDRESS_QUERY:
+    handle_address_query(my_fed->enclave.id);
+    break;
+  case MSG_TYPE_ADDRESS_QUERY_REPLY:
+    handle_address_query_reply(my_fed);
+    break;
+  case MSG_TYPE_ADDRESS_ADVERTISEMENT:
+    handle_address_ad(my_fed->enclave.id);
+    break;
+  case MSG_TYPE_TAGGED_MESSAGE:
+    switch (handle_timed_message(my_fed, buffer)) {
+    case 0:
+      count_fenced_message_received(my_fed);
+      break;
+    case 1:
+      return HANDED_OFF;
+    default:
+      close_federate_connection(my_fed);
+      return STOP_SERVING;
+    }
+    break;
+  case MSG_TYPE_RESIGN:
+    handle_federate_resign(my_fed);
+    return STOP_SERVING;
+  case MSG_TYPE_NEXT_EVENT_TAG:
+    handle_next_event_tag(my_fed);
+    break;
+  case MSG_TYPE_LATEST_TAG_CONFIRMED:
+    handle_latest_tag_confirmed(my_fed);
+    break;
+  case MSG_TYPE_NEXT_MESSAGE_REQUEST:
+    handle_next_message_request(my_fed);
+    break;
+  case MSG_TYPE_STOP_REQUEST:
+    handle_stop_request_message(my_fed); // FIXME: Reviewed until here.
+                                         // Need to also look at
+                                         // notify_advance_grant_if_safe()
+                                         // and notify_downstream_advance_grant_if_safe()
+    count_fenced_message_received(my_fed);
+    break;
+  case MSG_TYPE_STOP_REQUEST_REPLY:
+    handle_stop_request_reply(my_fed);
+    count_fenced_message_received(my_fed);
+    break;
+  case MSG_TYPE_PORT_ABSENT:
+    handle_port_absent_message(my_fed, buffer);
+    count_fenced_message_received(my_fed);
+    break;
+  case MSG_TYPE_FAILED:
+    handle_federate_failed(my_fed);
+    return STOP_SERVING;
+  default:
+    lf_print_error("RTI received from federate %d an unrecognized TCP message type: %u.", my_fed->enclave.id,
+                   buffer[0]);
+    if (rti_remote->base.tracing_enabled) {
+      tracepoint_rti_from_federate(receive_UNIDENTIFIED, my_fed->enclave.id, NULL);
+    }
+  }
+  return KEEP_SERVING;
+}
+
+void* federate_info_thread_TCP(void* fed) {
+  initialize_lf_thread_id();
+  federate_info_t* my_fed = (federate_info_t*)fed;
+
+  // Buffer for incoming messages.
+  // This does not constrain the message size because the payloads
+  // of tagged messages are read into messages for the send queues.
+  unsigned char buffer[FED_COM_BUFFER_SIZE];
+
+  // Listen for messages from the federate.
+  while (my_fed->enclave.state != NOT_CONNECTED) {
+    if (handle_federate_message(my_fed, buffer) != KEEP_SERVING) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+#ifdef PLATFORM_Linux
+/////////////////// Event loop ////////////////////
+
+/** Maximum number of readiness events taken by one call to epoll_wait(). */
+#define EVENT_LOOP_MAX_EVENTS 64
+
+/** The key of the event that stops the event loop. Other keys are EVENT_LOOP_KEY(fed_id, is_control_lane). */
+#define EVENT_LOOP_STOP_KEY UINT64_MAX
+
+/** The key of the events of the main connection or the control lane of a federate. */
+#define EVENT_LOOP_KEY(fed_id, is_control_lane) (((uint64_t)(fed_id) << 1) | ((is_control_lane) ? 1u : 0u))
+
+/**
+ * Have the event loop report the next input from a federate to one of its threads.
+ * Readiness is reported once, so that only one thread at a time reads from the federate.
+ * @param fed The federate.
+ * @param is_control_lane Whether to watch the control lane of the federate rather than its main connection.
+ * @param operation EPOLL_CTL_ADD for a federate that has just connected, EPOLL_CTL_MOD otherwise.
+ * @return 0 on success, -1 on failure.
+ */
+static int watch_federate(federate_info_t* fed, bool is_control_lane, int operation) {
+  net_abstraction_t net = is_control_lane ? fed->control.net : fed->net;
+  struct epoll_event event = {.events = EPOLLIN | EPOLLONESHOT,
+                              .data.u64 = EVENT_LOOP_KEY(fed->enclave.id, is_control_lane)};
+  if (has_buffered_input(net)) {
+    // Messages that arrived together with the end of the handshake have already been read into the
+    // receive buffer, so the descriptor may never become readable for them. A new connection is
+    // writable, though, so also waiting for that has the loop handle them right away.
+    event.events |= EPOLLOUT;
+  }
+  return epoll_ctl(rti_remote->epoll_descriptor, operation, get_net_descriptor(net), &event);
+}
+
+/**
+ * Record that the event loop no longer serves a federate and, after the last one, stop the loop.
+ * @param fed The federate.
+ */
+static void stop_serving_federate(federate_info_t* fed) {
+  LF_MUTEX_LOCK(&rti_mutex);
+  LF_PRINT_LOG("RTI: The event loop stopped serving federate %d.", fed->enclave.id);
+  if (--rti_remote->num_feds_served == 0) {
+    uint64_t one = 1;
+    if (write(rti_remote->event_loop_stop_descriptor, &one, sizeof(one)) < 0) {
+      lf_print_error_system_failure("RTI failed to stop the event loop.");
+    }
+  }
+  LF_MUTEX_UNLOCK(&rti_mutex);
+}
+
+/**
+ * Have the event loop report the next input from a federate that one of its threads has served,
+ * or, if the federate is no longer connected, stop serving it.
+ * @param fed The federate.
+ */
+static void resume_serving_federate(federate_info_t* fed) {
+  if (fed->enclave.state == NOT_CONNECTED || watch_federate(fed, false, EPOLL_CTL_MOD) != 0) {
+    stop_serving_federate(fed);
+  }
 }
 
 /**
- * Handle MSG_TYPE_FAILED sent by a federate. This message is sent by a federate
- * that is exiting in failure.  In this case, the RTI will
- * also terminate abnormally, returning a non-zero exit code when it exits.
- *
- * This function assumes the caller does not hold the mutex.
- *
- * @param my_fed The federate sending a MSG_TYPE_FAILED message.
+ * A timed message whose payload a payload reader reads, rather than a thread of the event loop.
  */
-static void handle_federate_failed(federate_info_t* my_fed) {
-  // Nothing more to do. Close the network abstraction and exit.
-  LF_MUTEX_LOCK(&rti_mutex);
+typedef struct payload_read_t {
+  /** The sending federate, which the event loop does not serve until the payload has been read. */
+  federate_info_t* sending_federate;
+  /** The destination of the message. */
+  federate_info_t* fed;
+  /** The header of the message, which the event loop has read. */
+  unsigned char header[TIMED_MESSAGE_HEADER_SIZE];
+  struct payload_read_t* next;
+} payload_read_t;
 
-  if (rti_remote->base.tracing_enabled) {
-    tracepoint_rti_from_federate(receive_FAILED, my_fed->enclave.id, NULL);
-  }
+/** Mutex guarding the queue of payload reads and payload_readers_stopped. */
+static lf_mutex_t payload_read_mutex;
 
-  // Set the flag telling the RTI to exit with an error code when it exits.
-  _lf_federate_reports_error = true;
-  lf_print_error("RTI: Federate %d reports an error and has exited.", my_fed->enclave.id);
+/** Condition signaled when a payload read is queued or the payload readers are to stop. */
+static lf_cond_t payload_read_queued;
 
-  my_fed->enclave.state = NOT_CONNECTED;
+/** The payload reads that no payload reader has taken yet, oldest first. */
+static payload_read_t* payload_reads_head = NULL;
+static payload_read_t* payload_reads_tail = NULL;
 
-  // Indicate that there will no further events from this federate.
-  my_fed->enclave.next_event = FOREVER_TAG;
+/** Whether the payload readers are to exit once the queue is empty. */
+static bool payload_readers_stopped = false;
 
-  shutdown_net(my_fed->net, false);
-  my_fed->net = NULL;
+/** The threads reading payloads for the event loop. */
+static lf_thread_t* payload_reader_ids = NULL;
 
-  // Check downstream federates to see whether they should now be granted a TAG.
-  // To handle cycles, need to create a boolean array to keep
-  // track of which upstream federates have been visited.
-  bool* visited = (bool*)calloc(rti_remote->base.number_of_scheduling_nodes, sizeof(bool)); // Initializes to 0.
-  notify_downstream_advance_grant_if_safe(&(my_fed->enclave), visited);
-  free(visited);
+/**
+ * Have a payload reader read the payload of a timed message and forward the message, after which
+ * the event loop serves the sending federate again.
+ * This function assumes the caller does not hold the mutex.
+ * @param sending_federate The sending federate.
+ * @param fed The destination of the message.
+ * @param header The header of the message.
+ */
+static void read_payload_off_event_loop(federate_info_t* sending_federate, federate_info_t* fed,
+                                        unsigned char* header) {
+  payload_read_t* read = (payload_read_t*)malloc(sizeof(payload_read_t));
+  LF_ASSERT_NON_NULL(read);
+  read->sending_federate = sending_federate;
+  read->fed = fed;
+  memcpy(read->header, header, TIMED_MESSAGE_HEADER_SIZE);
+  read->next = NULL;
+  LF_PRINT_DEBUG("RTI: Reading the payload of a message from federate %d off the event loop.",
+                 sending_federate->enclave.id);
+  LF_MUTEX_LOCK(&payload_read_mutex);
+  if (payload_reads_tail == NULL) {
+    payload_reads_head = read;
+  } else {
+    payload_reads_tail->next = read;
+  }
+  payload_reads_tail = read;
+  lf_cond_signal(&payload_read_queued);
+  LF_MUTEX_UNLOCK(&payload_read_mutex);
+}
 
-  LF_MUTEX_UNLOCK(&rti_mutex);
+/**
+ * Thread reading the payloads of timed messages for the event loop, so that a federate that sends a
+ * payload slowly, or whose destination does not keep up, holds up only its own messages.
+ * @param ignored Ignored.
+ * @return NULL.
+ */
+static void* payload_reader_thread(void* ignored) {
+  (void)ignored;
+  initialize_lf_thread_id();
+  LF_MUTEX_LOCK(&payload_read_mutex);
+  while (true) {
+    while (payload_reads_head == NULL && !payload_readers_stopped) {
+      lf_cond_wait(&payload_read_queued);
+    }
+    payload_read_t* read = payload_reads_head;
+    if (read == NULL) {
+      break;
+    }
+    payload_reads_head = read->next;
+    if (payload_reads_head == NULL) {
+      payload_reads_tail = NULL;
+    }
+    LF_MUTEX_UNLOCK(&payload_read_mutex);
+    forward_timed_message(read->sending_federate, read->fed, read->header);
+    count_fenced_message_received(read->sending_federate);
+    resume_serving_federate(read->sending_federate);
+    free(read);
+    LF_MUTEX_LOCK(&payload_read_mutex);
+  }
+  LF_MUTEX_UNLOCK(&payload_read_mutex);
+  return NULL;
 }
 
 /**
- * Handle MSG_TYPE_RESIGN sent by a federate. This message is sent at the time of termination
- * after all shutdown events are processed on the federate.
- *
- * This function assumes the caller does not hold the mutex.
- *
- * @note At this point, the RTI might have outgoing messages to the federate. This
- * function thus first performs a shutdown on the network abstraction, which sends an EOF. It then
- * waits for the remote network abstraction to be closed before closing the network abstraction itself.
- *
- * @param my_fed The federate sending a MSG_TYPE_RESIGN message.
+ * Thread of the event loop. It handles all messages that have arrived from a federate whose
+ * connection has become readable, including those already buffered, and then waits again.
+ * @param ignored Ignored.
+ * @return NULL.
  */
-static void handle_federate_resign(federate_info_t* my_fed) {
-  // Nothing more to do. Close the network abstraction and exit.
-  LF_MUTEX_LOCK(&rti_mutex);
+static void* event_loop_thread(void* ignored) {
+  (void)ignored;
+  initialize_lf_thread_id();
 
-  if (rti_remote->base.tracing_enabled) {
-    tracepoint_rti_from_federate(receive_RESIGN, my_fed->enclave.id, NULL);
+  // Buffer for incoming messages. See federate_info_thread_TCP().
+  unsigned char buffer[FED_COM_BUFFER_SIZE];
+  struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+
+  while (true) {
+    int count = epoll_wait(rti_remote->epoll_descriptor, events, EVENT_LOOP_MAX_EVENTS, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      lf_print_error_system_failure("RTI failed to wait for messages from federates.");
+    }
+    for (int i = 0; i < count; i++) {
+      uint64_t key = events[i].data.u64;
+      if (key == EVENT_LOOP_STOP_KEY) {
+        // No federate is left. The stop event stays signaled, so it wakes every thread of the loop.
+        return NULL;
+      }
+      federate_info_t* fed = GET_FED_INFO(key >> 1);
+      bool serving;
+      if (key & 1u) {
+        // The control lane is closed together with the main connection, which the loop stops serving.
+        do {
+          serving = handle_control_message(fed);
+        } while (serving && has_buffered_input(fed->control.net));
+        if (serving) {
+          watch_federate(fed, true, EPOLL_CTL_MOD);
+        }
+        continue;
+      }
+      serving_t next;
+      do {
+        next = fed->enclave.state != NOT_CONNECTED ? handle_federate_message(fed, buffer) : STOP_SERVING;
+      } while (next == KEEP_SERVING && has_buffered_input(fed->net));
+      if (next == KEEP_SERVING) {
+        resume_serving_federate(fed);
+      } else if (next == STOP_SERVING) {
+        stop_serving_federate(fed);
+      }
+    }
   }
+}
 
-  lf_print_info("RTI: Federate %d has resigned.", my_fed->enclave.id);
+/**
+ * Create the epoll instance of the event loop and start its threads.
+ */
+static void start_event_loop() {
+  rti_remote->epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+  rti_remote->event_loop_stop_descriptor = eventfd(0, EFD_CLOEXEC);
+  if (rti_remote->epoll_descriptor < 0 || rti_remote->event_loop_stop_descriptor < 0) {
+    lf_print_error_system_failure("RTI failed to create the event loop.");
+  }
+  struct epoll_event stop_event = {.events = EPOLLIN, .data.u64 = EVENT_LOOP_STOP_KEY};
+  if (epoll_ctl(rti_remote->epoll_descriptor, EPOLL_CTL_ADD, rti_remote->event_loop_stop_descriptor, &stop_event)) {
+    lf_print_error_system_failure("RTI failed to create the event loop.");
+  }
+  rti_remote->num_feds_served = number_of_federates();
+  LF_MUTEX_INIT(&payload_read_mutex);
+  LF_COND_INIT(&payload_read_queued, &payload_read_mutex);
+  // As many payload readers as threads of the event loop read payloads that have not fully arrived.
+  payload_reader_ids = (lf_thread_t*)calloc(rti_remote->event_loop_threads, sizeof(lf_thread_t));
+  LF_ASSERT_NON_NULL(payload_reader_ids);
+  for (int i = 0; i < rti_remote->event_loop_threads; i++) {
+    lf_thread_create(&payload_reader_ids[i], payload_reader_thread, NULL);
+  }
+  rti_remote->event_loop_thread_ids = (lf_thread_t*)calloc(rti_remote->event_loop_threads, sizeof(lf_thread_t));
+  LF_ASSERT_NON_NULL(rti_remote->event_loop_thread_ids);
+  for (int i = 0; i < rti_remote->event_loop_threads; i++) {
+    lf_thread_create(&rti_remote->event_loop_thread_ids[i], event_loop_thread, NULL);
+  }
+  lf_print_info("RTI: Serving federates from an event loop with %d threads.", rti_remote->event_loop_threads);
+}
 
-  my_fed->enclave.state = NOT_CONNECTED;
+/**
+ * Wait for the threads of the event loop to exit, which they do once no federate is left
+ * to serve, and release the event loop.
+ */
+static void stop_event_loop() {
+  void* thread_exit_status;
+  for (int i = 0; i < rti_remote->event_loop_threads; i++) {
+    lf_thread_join(rti_remote->event_loop_thread_ids[i], &thread_exit_status);
+  }
+  free(rti_remote->event_loop_thread_ids);
+  rti_remote->event_loop_thread_ids = NULL;
+  // No payload read is in progress, as the federate that it is for would still be served.
+  LF_MUTEX_LOCK(&payload_read_mutex);
+  payload_readers_stopped = true;
+  lf_cond_broadcast(&payload_read_queued);
+  LF_MUTEX_UNLOCK(&payload_read_mutex);
+  for (int i = 0; i < rti_remote->event_loop_threads; i++) {
+    lf_thread_join(payload_reader_ids[i], &thread_exit_status);
+  }
+  free(payload_reader_ids);
+  payload_reader_ids = NULL;
+  close(rti_remote->event_loop_stop_descriptor);
+  rti_remote->event_loop_stop_descriptor = -1;
+  close(rti_remote->epoll_descriptor);
+  rti_remote->epoll_descriptor = -1;
+}
+#endif // PLATFORM_Linux
 
-  // Indicate that there will no further events from this federate.
-  my_fed->enclave.next_event = FOREVER_TAG;
+/**
+ * Start handling the messages from a federate that has connected, either in a thread of its own
+ * or in the event loop.
+ * @param fed The federate.
+ */
+static void serve_federate(federate_info_t* fed) {
+#ifdef PLATFORM_Linux
+  if (rti_remote->event_loop_threads > 0) {
+    if (watch_federate(fed, false, EPOLL_CTL_ADD) ||
+        (fed->control.net != NULL && watch_federate(fed, true, EPOLL_CTL_ADD))) {
+      lf_print_error_system_failure("RTI failed to add federate %d to the event loop.", fed->enclave.id);
+    }
+    return;
+  }
+#endif
+  lf_thread_create(&(fed->thread_id), federate_info_thread_TCP, fed);
+  if (fed->control.net != NULL) {
+    lf_thread_create(&(fed->control.thread_id), control_lane_thread, fed);
+  }
+}
 
-  shutdown_net(my_fed->net, true);
-  my_fed->net = NULL;
+/////////////////// Parent RTI ////////////////////
 
-  // Check downstream federates to see whether they should now be granted a TAG.
-  // To handle cycles, need to create a boolean array to keep
-  // track of which upstream federates have been visited.
-  bool* visited = (bool*)calloc(rti_remote->base.number_of_scheduling_nodes, sizeof(bool)); // Initializes to 0.
-  notify_downstream_advance_grant_if_safe(&(my_fed->enclave), visited);
-  free(visited);
+/** In a cluster RTI, the clusters with a connection to this cluster, as federate IDs of the parent. */
+static uint16_t* upstream_clusters = NULL;
+
+/** The least delay on a connection from each cluster in upstream_clusters. */
+static interval_t* upstream_cluster_delays = NULL;
+
+/** The number of clusters in upstream_clusters. */
+static int num_upstream_clusters = 0;
+
+/** In a cluster RTI, the clusters with a connection from this cluster, as federate IDs of the parent. */
+static uint16_t* downstream_clusters = NULL;
+
+/** The number of clusters in downstream_clusters. */
+static int num_downstream_clusters = 0;
+
+/** Indicates that a cluster RTI has resigned from its parent, after which the parent closes the connection. */
+static volatile bool resigned_from_parent = false;
+
+/**
+ * Record a connection between a member of the cluster of a cluster RTI and a federate of another
+ * cluster, which the cluster declares to the parent as a connection between the clusters.
+ * @param cluster The other cluster.
+ * @param delay The delay of the connection.
+ * @param upstream Whether the connection is from the other cluster.
+ */
+static void add_cluster_connection(uint16_t cluster, interval_t delay, bool upstream) {
+  if (upstream) {
+    for (int i = 0; i < num_upstream_clusters; i++) {
+      if (upstream_clusters[i] == cluster) {
+        // No delay is encoded as NEVER, which is less than any delay.
+        if (delay < upstream_cluster_delays[i]) {
+          upstream_cluster_delays[i] = delay;
+        }
+        return;
+      }
+    }
+    upstream_clusters = (uint16_t*)realloc(upstream_clusters, (num_upstream_clusters + 1) * sizeof(uint16_t));
+    upstream_cluster_delays =
+        (interval_t*)realloc(upstream_cluster_delays, (num_upstream_clusters + 1) * sizeof(interval_t));
+    LF_ASSERT_NON_NULL(upstream_clusters);
+    LF_ASSERT_NON_NULL(upstream_cluster_delays);
+    upstream_clusters[num_upstream_clusters] = cluster;
+    upstream_cluster_delays[num_upstream_clusters] = delay;
+    num_upstream_clusters++;
+  } else {
+    for (int i = 0; i < num_downstream_clusters; i++) {
+      if (downstream_clusters[i] == cluster) {
+        return;
+      }
+    }
+    downstream_clusters = (uint16_t*)realloc(downstream_clusters, (num_downstream_clusters + 1) * sizeof(uint16_t));
+    LF_ASSERT_NON_NULL(downstream_clusters);
+    downstream_clusters[num_downstream_clusters++] = cluster;
+  }
+}
+
+/**
+ * Record that the parent of a cluster RTI is upstream of a member of the cluster.
+ * @param member The member.
+ */
+static void add_parent_downstream(uint16_t member) {
+  scheduling_node_t* parent = &rti_remote->parent->enclave;
+  parent->immediate_downstreams =
+      (uint16_t*)realloc(parent->immediate_downstreams, (parent->num_immediate_downstreams + 1) * sizeof(uint16_t));
+  LF_ASSERT_NON_NULL(parent->immediate_downstreams);
+  parent->immediate_downstreams[parent->num_immediate_downstreams++] = member;
+}
 
+/**
+ * Handle a tag advance grant (TAG) or a provisional one (PTAG) from the parent of a cluster RTI,
+ * which tells which messages may still arrive from outside the cluster.
+ * This function assumes the caller does not hold the mutex.
+ * @param tag The granted tag.
+ * @param provisional Whether the grant is provisional.
+ */
+static void handle_grant_from_parent(tag_t tag, bool provisional) {
+  LF_MUTEX_LOCK(&rti_mutex);
+  scheduling_node_t* parent = &rti_remote->parent->enclave;
+  if (!provisional) {
+    // All messages from outside the cluster with tags up to the granted tag have been forwarded
+    // before the grant, and any later one has a later tag.
+    parent->completed = tag;
+    tag_t next = lf_delay_tag(tag, 0);
+    if (lf_tag_compare(parent->next_event, next) < 0) {
+      parent->next_event = next;
+    }
+    notify_downstream_advance_grant_if_safe(parent);
+  } else {
+    if (lf_tag_compare(parent->next_event, tag) < 0) {
+      parent->next_event = tag;
+    }
+    notify_downstream_advance_grant_if_safe(parent);
+    // The parent grants a PTAG to a cluster in a zero-delay cycle through other clusters, which is not
+    // visible within the cluster. Pass it on to the members that depend on the rest of the federation
+    // and have their next event at the granted tag, which, because the next event tag of the cluster
+    // is the earliest of its members, is the earliest next event tag in the cluster.
+    for (uint16_t i = 0; i < number_of_federates(); i++) {
+      scheduling_node_t* member = rti_remote->base.scheduling_nodes[i];
+      if (member->state != NOT_CONNECTED && lf_tag_compare(member->next_event, tag) == 0 &&
+          lf_tag_compare(get_min_delay(parent->id, i), FOREVER_TAG) < 0) {
+        notify_provisional_tag_advance_grant(member, tag);
+      }
+    }
+  }
   LF_MUTEX_UNLOCK(&rti_mutex);
 }
 
-void* federate_info_thread_TCP(void* fed) {
+/**
+ * Thread handling the messages from the parent of a cluster RTI. To the parent, the cluster RTI is a
+ * federate, so these are the messages that an RTI sends to a federate. Tagged messages and port absent
+ * messages are forwarded to the members of the cluster to which they are destined.
+ * @param ignored Ignored.
+ * @return NULL.
+ */
+static void* parent_thread(void* ignored) {
+  (void)ignored;
   initialize_lf_thread_id();
-  federate_info_t* my_fed = (federate_info_t*)fed;
-
-  // Buffer for incoming messages.
-  // This does not constrain the message size because messages
-  // are forwarded piece by piece.
+  federate_info_t* parent = rti_remote->parent;
+  // Buffer for incoming messages. See federate_info_thread_TCP().
   unsigned char buffer[FED_COM_BUFFER_SIZE];
-
-  // Listen for messages from the federate.
-  while (my_fed->enclave.state != NOT_CONNECTED) {
-    // Read no more than one byte to get the message type.
-    int read_failed = read_from_net(my_fed->net, 1, buffer);
-    if (read_failed) {
-      // network abstraction is closed
-      lf_print_info("RTI: Connection to federate %d is closed. Exiting the thread.", my_fed->enclave.id);
-      my_fed->enclave.state = NOT_CONNECTED;
-      // Nothing more to do. Close the network abstraction and exit.
-      // Prevent multiple threads from closing the same network abstraction at the same time.
-      shutdown_net(my_fed->net, false);
-      my_fed->net = NULL;
-      // FIXME: We need better error handling here, but do not stop execution here.
-      break;
+  while (true) {
+    if (read_from_net(parent->net, 1, buffer)) {
+      if (resigned_from_parent) {
+        return NULL;
+      }
+      lf_print_error_and_exit("RTI of cluster %d lost the connection to its parent.", rti_remote->cluster);
     }
-    LF_PRINT_DEBUG("RTI: Received message type %u from federate %d.", buffer[0], my_fed->enclave.id);
+    LF_PRINT_DEBUG("RTI of cluster %d received message type %u from its parent.", rti_remote->cluster, buffer[0]);
     switch (buffer[0]) {
     case MSG_TYPE_TIMESTAMP:
-      handle_timestamp(my_fed);
-      break;
-    case MSG_TYPE_ADDRESS_QUERY:
-      handle_address_query(my_fed->enclave.id);
+      read_from_net_fail_on_error(parent->net, sizeof(int64_t), &buffer[1],
+                                  "RTI of cluster %d failed to read the start time from its parent.",
+                                  rti_remote->cluster);
+      LF_MUTEX_LOCK(&rti_mutex);
+      start_federation_locked(swap_bytes_if_big_endian_int64(extract_int64(&buffer[1])));
+      LF_MUTEX_UNLOCK(&rti_mutex);
       break;
-    case MSG_TYPE_ADDRESS_ADVERTISEMENT:
-      handle_address_ad(my_fed->enclave.id);
+    case MSG_TYPE_TAG_ADVANCE_GRANT:
+    case MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT:
+    case MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG:
+    case MSG_TYPE_STOP_GRANTED:
+      read_from_net_fail_on_error(parent->net, sizeof(int64_t) + sizeof(uint32_t), &buffer[1],
+                                  "RTI of cluster %d failed to read a tag from its parent.", rti_remote->cluster);
+      tag_t tag = extract_tag(&buffer[1]);
+      if (buffer[0] == MSG_TYPE_STOP_GRANTED) {
+        LF_MUTEX_LOCK(&rti_mutex);
+        rti_remote->base.max_stop_tag = tag;
+        broadcast_stop_time_to_federates_locked();
+        LF_MUTEX_UNLOCK(&rti_mutex);
+      } else if (buffer[0] != MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG) {
+        // Downstream next event tags are ignored because the members are not told about the
+        // federates downstream of them outside the cluster.
+        handle_grant_from_parent(tag, buffer[0] == MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT);
+      }
       break;
     case MSG_TYPE_TAGGED_MESSAGE:
-      handle_timed_message(my_fed, buffer);
-      break;
-    case MSG_TYPE_RESIGN:
-      handle_federate_resign(my_fed);
-      return NULL;
-    case MSG_TYPE_NEXT_EVENT_TAG:
-      handle_next_event_tag(my_fed);
+      if (handle_timed_message(parent, buffer)) {
+        lf_print_error_and_exit("RTI of cluster %d received a malformed message from its parent.", rti_remote->cluster);
+      }
       break;
-    case MSG_TYPE_LATEST_TAG_CONFIRMED:
-      handle_latest_tag_confirmed(my_fed);
+    case MSG_TYPE_PORT_ABSENT:
+      handle_port_absent_message(parent, buffer);
       break;
     case MSG_TYPE_STOP_REQUEST:
-      handle_stop_request_message(my_fed); // FIXME: Reviewed until here.
-                                           // Need to also look at
-                                           // notify_advance_grant_if_safe()
-                                           // and notify_downstream_advance_grant_if_safe()
+      handle_stop_request_message(parent);
       break;
-    case MSG_TYPE_STOP_REQUEST_REPLY:
-      handle_stop_request_reply(my_fed);
+    case MSG_TYPE_ADDRESS_QUERY:
+      handle_address_query(parent->enclave.id);
       break;
-    case MSG_TYPE_PORT_ABSENT:
-      handle_port_absent_message(my_fed, buffer);
+    case MSG_TYPE_ADDRESS_QUERY_REPLY:
+      handle_address_query_reply(parent);
       break;
     case MSG_TYPE_FAILED:
-      handle_federate_failed(my_fed);
-      return NULL;
+      lf_print_error_and_exit("The parent of the RTI of cluster %d has failed.", rti_remote->cluster);
+      break;
     default:
-      lf_print_error("RTI received from federate %d an unrecognized TCP message type: %u.", my_fed->enclave.id,
-                     buffer[0]);
-      if (rti_remote->base.tracing_enabled) {
-        tracepoint_rti_from_federate(receive_UNIDENTIFIED, my_fed->enclave.id, NULL);
+      lf_print_error_and_exit("RTI of cluster %d received an unexpected message type %u from its parent.",
+                              rti_remote->cluster, buffer[0]);
+    }
+  }
+}
+
+/**
+ * Connect a cluster RTI to its parent and join the federation of the parent as the federate whose ID
+ * is the cluster, with the connections to and from other clusters that the members have declared.
+ * This is done once all members have connected, and the members are served only afterwards, so that
+ * all messages that they cause to be sent to the parent can be put on its send queue.
+ */
+static void connect_to_parent() {
+#if defined(COMM_TYPE_TCP) || defined(COMM_TYPE_UDS) || defined(COMM_TYPE_URING)
+  socket_connection_params_t params = {0};
+  params.type = TCP;
+  params.port = rti_remote->parent_port;
+  params.server_hostname = rti_remote->parent_host;
+#elif defined(COMM_TYPE_SST)
+  sst_connection_params_t params = {0};
+  params.socket_params.type = TCP;
+  params.socket_params.port = rti_remote->parent_port;
+  params.socket_params.server_hostname = rti_remote->parent_host;
+  params.target = SST_RTI;
+#elif defined(COMM_TYPE_TLS)
+  tls_connection_params_t params = {0};
+  params.socket_params.type = TCP;
+  params.socket_params.port = rti_remote->parent_port;
+  params.socket_params.server_hostname = rti_remote->parent_host;
+#elif defined(COMM_TYPE_SHM)
+  shm_connection_params_t params = {0};
+  params.socket_params.type = TCP;
+  params.socket_params.port = rti_remote->parent_port;
+  params.socket_params.server_hostname = rti_remote->parent_host;
+#endif
+  // Identify as the federate whose ID is the cluster, offering to send next message requests unless
+  // the parent rejects the offer (@see MSG_TYPE_FED_IDS_NMR).
+  size_t federation_id_length = strnlen(rti_remote->federation_id, 255);
+  unsigned char ids[1 + sizeof(uint16_t) + 1 + 255];
+  encode_uint16((uint16_t)rti_remote->cluster, &ids[1]);
+  ids[1 + sizeof(uint16_t)] = (unsigned char)federation_id_length;
+  memcpy(&ids[2 + sizeof(uint16_t)], rti_remote->federation_id, federation_id_length);
+  net_abstraction_t net = NULL;
+  parent_accepts_NMR = true;
+  while (net == NULL) {
+    net = connect_to_net((net_params_t)&params);
+    if (net == NULL) {
+      lf_print_error_and_exit("RTI of cluster %d failed to connect to its parent at %s:%u.", rti_remote->cluster,
+                              rti_remote->parent_host, rti_remote->parent_port);
+    }
+    ids[0] = parent_accepts_NMR ? MSG_TYPE_FED_IDS_NMR : MSG_TYPE_FED_IDS;
+    write_to_net_fail_on_error(net, 2 + sizeof(uint16_t) + federation_id_length, ids, NULL,
+                               "RTI of cluster %d failed to send its ID to its parent.", rti_remote->cluster);
+    unsigned char response[2];
+    read_from_net_fail_on_error(net, 1, response, "RTI of cluster %d failed to read the response of its parent.",
+                                rti_remote->cluster);
+    if (response[0] == MSG_TYPE_ACK) {
+      break;
+    }
+    if (response[0] == MSG_TYPE_REJECT) {
+      read_from_net_fail_on_error(net, 1, &response[1], "RTI of cluster %d failed to read the rejection cause.",
+                                  rti_remote->cluster);
+      if (parent_accepts_NMR && response[1] == UNEXPECTED_MESSAGE) {
+        // The parent predates next message requests and has closed the connection.
+        shutdown_net(net, false);
+        net = NULL;
+        parent_accepts_NMR = false;
+        continue;
       }
+      lf_print_error_and_exit("The parent rejected the RTI of cluster %d with cause %u.", rti_remote->cluster,
+                              response[1]);
     }
+    lf_print_error_and_exit("RTI of cluster %d expected an ACK from its parent. Got %u.", rti_remote->cluster,
+                            response[0]);
+  }
+
+  // Declare the connections between clusters.
+  size_t length = MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE +
+                  num_upstream_clusters * (sizeof(uint16_t) + sizeof(int64_t)) +
+                  num_downstream_clusters * sizeof(uint16_t);
+  unsigned char* neighbors = (unsigned char*)malloc(length);
+  LF_ASSERT_NON_NULL(neighbors);
+  neighbors[0] = MSG_TYPE_NEIGHBOR_STRUCTURE;
+  encode_int32(num_upstream_clusters, &neighbors[1]);
+  encode_int32(num_downstream_clusters, &neighbors[1 + sizeof(int32_t)]);
+  size_t head = MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE;
+  for (int i = 0; i < num_upstream_clusters; i++) {
+    encode_uint16(upstream_clusters[i], &neighbors[head]);
+    head += sizeof(uint16_t);
+    encode_int64(upstream_cluster_delays[i], &neighbors[head]);
+    head += sizeof(int64_t);
+  }
+  for (int i = 0; i < num_downstream_clusters; i++) {
+    encode_uint16(downstream_clusters[i], &neighbors[head]);
+    head += sizeof(uint16_t);
+  }
+  write_to_net_fail_on_error(net, length, neighbors, NULL,
+                             "RTI of cluster %d failed to send its connections to its parent.", rti_remote->cluster);
+  free(neighbors);
+
+  // Opt out of clock synchronization with the parent.
+  unsigned char udp_port[1 + sizeof(uint16_t)];
+  udp_port[0] = MSG_TYPE_UDP_PORT;
+  encode_uint16(UINT16_MAX, &udp_port[1]);
+  write_to_net_fail_on_error(net, sizeof(udp_port), udp_port, NULL,
+                             "RTI of cluster %d failed to send its UDP port to its parent.", rti_remote->cluster);
+
+  federate_info_t* parent = rti_remote->parent;
+  LF_MUTEX_LOCK(&rti_mutex);
+  parent->net = net;
+  parent->enclave.state = PENDING;
+  invalidate_min_delays_through(&parent->enclave);
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  start_federate_writer(parent);
+  lf_thread_create(&rti_remote->parent_thread_id, parent_thread, NULL);
+  lf_print_info("RTI of cluster %d: Connected to the parent at %s:%u with %d upstream and %d downstream clusters.",
+                rti_remote->cluster, rti_remote->parent_host, rti_remote->parent_port, num_upstream_clusters,
+                num_downstream_clusters);
+}
+
+/**
+ * Once all members of the cluster of a cluster RTI have exited, resign from the parent, or report a
+ * failure if a member has, and close the connection to the parent once the parent has closed it.
+ */
+static void disconnect_from_parent() {
+  federate_info_t* parent = rti_remote->parent;
+  LF_MUTEX_LOCK(&rti_mutex);
+  resigned_from_parent = true;
+  unsigned char message = _lf_federate_reports_error ? MSG_TYPE_FAILED : MSG_TYPE_RESIGN;
+  if (send_to_federate(parent, 1, &message)) {
+    lf_print_warning("RTI of cluster %d failed to resign from its parent.", rti_remote->cluster);
   }
-  return NULL;
+  parent->enclave.state = NOT_CONNECTED;
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  stop_federate_writer(parent);
+  void* thread_exit_status;
+  lf_thread_join(rti_remote->parent_thread_id, &thread_exit_status);
+  shutdown_net(parent->net, false);
+  parent->net = NULL;
+  pqueue_tag_free(parent->in_transit_message_tags);
+  free(parent->forwarded_address_queries);
+  free(upstream_clusters);
+  free(upstream_cluster_delays);
+  free(downstream_clusters);
+  LF_PRINT_LOG("RTI of cluster %d resigned from its parent.", rti_remote->cluster);
 }
 
 void send_reject(net_abstraction_t net_abs, unsigned char error_code) {
@@ -1065,14 +2599,16 @@ void send_reject(net_abstraction_t net_abs, unsigned char error_code) {
 }
 
 /**
- * Listen for a MSG_TYPE_FED_IDS message, which includes as a payload
- * a federate ID and a federation ID. If the federation ID
+ * Listen for a MSG_TYPE_FED_IDS, MSG_TYPE_FED_IDS_NMR or MSG_TYPE_CONTROL_LANE message, which
+ * includes as a payload a federate ID and a federation ID. The RTI handles next message requests
+ * from any federate, so it treats MSG_TYPE_FED_IDS_NMR as MSG_TYPE_FED_IDS. If the federation ID
  * matches this federation, send an MSG_TYPE_ACK and otherwise send
  * a MSG_TYPE_REJECT message.
  * @param fed_net Pointer to the network abstraction on which to listen.
+ * @param is_control_lane Pointer to where to record whether the connection is the control lane of the federate.
  * @return The federate ID for success or -1 for failure.
  */
-static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
+static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net, bool* is_control_lane) {
   // Buffer for message ID, federate ID, and federation ID length.
   size_t length = 1 + sizeof(uint16_t) + 1; // Message ID, federate ID, length of fedration ID.
   unsigned char buffer[length];
@@ -1086,7 +2622,8 @@ static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
   uint16_t fed_id = rti_remote->base.number_of_scheduling_nodes; // Initialize to an invalid value.
 
   // First byte received is the message type.
-  if (buffer[0] != MSG_TYPE_FED_IDS) {
+  *is_control_lane = buffer[0] == MSG_TYPE_CONTROL_LANE;
+  if (buffer[0] != MSG_TYPE_FED_IDS && buffer[0] != MSG_TYPE_FED_IDS_NMR && !*is_control_lane) {
     if (rti_remote->base.tracing_enabled) {
       tracepoint_rti_to_federate(send_REJECT, fed_id, NULL);
     }
@@ -1108,8 +2645,8 @@ static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
     lf_print_error("RTI expected a MSG_TYPE_FED_IDS message. Got %u (see net_common.h).", buffer[0]);
     return -1;
   } else {
-    // Received federate ID.
-    fed_id = extract_uint16(buffer + 1);
+    // Received federate ID. A cluster RTI numbers its members from 0 and rejects other federates.
+    fed_id = cluster_node(extract_uint16(buffer + 1));
     LF_PRINT_DEBUG("RTI received federate ID: %d.", fed_id);
 
     // Read the federation ID.  First read the length, which is one byte.
@@ -1140,7 +2677,7 @@ static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
       send_reject(fed_net, FEDERATION_ID_DOES_NOT_MATCH);
       return -1;
     } else {
-      if (fed_id >= rti_remote->base.number_of_scheduling_nodes) {
+      if (fed_id >= number_of_federates()) {
         // Federate ID is out of range.
         lf_print_error("RTI received federate ID %d, which is out of range.", fed_id);
         if (rti_remote->base.tracing_enabled) {
@@ -1149,7 +2686,11 @@ static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
         send_reject(fed_net, FEDERATE_ID_OUT_OF_RANGE);
         return -1;
       } else {
+        // Other federates may be connecting concurrently, so the ID is checked and claimed atomically,
+        // holding the mutex until the ACK is sent. A federate opens its control lane before its main connection.
+        LF_MUTEX_LOCK(&rti_mutex);
         if ((rti_remote->base.scheduling_nodes[fed_id])->state != NOT_CONNECTED) {
+          LF_MUTEX_UNLOCK(&rti_mutex);
           lf_print_error("RTI received duplicate federate ID: %d.", fed_id);
           if (rti_remote->base.tracing_enabled) {
             tracepoint_rti_to_federate(send_REJECT, fed_id, NULL);
@@ -1163,12 +2704,20 @@ static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
   federate_info_t* fed = GET_FED_INFO(fed_id);
   // The MSG_TYPE_FED_IDS message has the right federation ID.
 
-  fed->net = fed_net;
+  if (*is_control_lane) {
+    if (fed->control.net != NULL) {
+      // The federate is trying to connect again, so its earlier control lane is no longer used.
+      shutdown_net(fed->control.net, false);
+    }
+    fed->control.net = fed_net;
+  } else {
+    fed->net = fed_net;
 
-  // Set the federate's state as pending
-  // because it is waiting for the start time to be
-  // sent by the RTI before beginning its execution.
-  fed->enclave.state = PENDING;
+    // Set the federate's state as pending
+    // because it is waiting for the start time to be
+    // sent by the RTI before beginning its execution.
+    fed->enclave.state = PENDING;
+  }
 
   LF_PRINT_DEBUG("RTI responding with MSG_TYPE_ACK to federate %d.", fed_id);
   // Send an MSG_TYPE_ACK message.
@@ -1176,8 +2725,7 @@ static int32_t receive_and_check_fed_id_message(net_abstraction_t fed_net) {
   if (rti_remote->base.tracing_enabled) {
     tracepoint_rti_to_federate(send_ACK, fed_id, NULL);
   }
-  LF_MUTEX_LOCK(&rti_mutex);
-  if (write_to_net_close_on_error(fed->net, 1, &ack_message)) {
+  if (write_to_net_close_on_error(fed_net, 1, &ack_message)) {
     LF_MUTEX_UNLOCK(&rti_mutex);
     lf_print_error("RTI failed to write MSG_TYPE_ACK message to federate %d.", fed_id);
     return -1;
@@ -1210,10 +2758,26 @@ static int receive_connection_information(net_abstraction_t fed_net, uint16_t fe
   } else {
     federate_info_t* fed = GET_FED_INFO(fed_id);
     // Read the number of upstream and downstream connections
-    fed->enclave.num_immediate_upstreams = extract_int32(&(connection_info_header[1]));
-    fed->enclave.num_immediate_downstreams = extract_int32(&(connection_info_header[1 + sizeof(int32_t)]));
-    LF_PRINT_DEBUG("RTI got %d upstreams and %d downstreams from federate %d.", fed->enclave.num_immediate_upstreams,
-                   fed->enclave.num_immediate_downstreams, fed_id);
+    int num_immediate_upstreams = extract_int32(&(connection_info_header[1]));
+    int num_immediate_downstreams = extract_int32(&(connection_info_header[1 + sizeof(int32_t)]));
+    LF_PRINT_DEBUG("RTI got %d upstreams and %d downstreams from federate %d.", num_immediate_upstreams,
+                   num_immediate_downstreams, fed_id);
+
+    size_t connections_info_body_size = ((sizeof(uint16_t) + sizeof(int64_t)) * num_immediate_upstreams) +
+                                        (sizeof(uint16_t) * num_immediate_downstreams);
+    unsigned char* connections_info_body = NULL;
+    if (connections_info_body_size > 0) {
+      connections_info_body = (unsigned char*)malloc(connections_info_body_size);
+      LF_ASSERT_NON_NULL(connections_info_body);
+      read_from_net_fail_on_error(fed_net, connections_info_body_size, connections_info_body,
+                                  "RTI failed to read MSG_TYPE_NEIGHBOR_STRUCTURE message body from federate %d.",
+                                  fed_id);
+    }
+
+    // Other federates may be connecting concurrently and traversing the connections of this one.
+    LF_MUTEX_LOCK(&rti_mutex);
+    fed->enclave.num_immediate_upstreams = num_immediate_upstreams;
+    fed->enclave.num_immediate_downstreams = num_immediate_downstreams;
 
     // Allocate memory for the upstream and downstream pointers
     if (fed->enclave.num_immediate_upstreams > 0) {
@@ -1231,33 +2795,51 @@ static int receive_connection_information(net_abstraction_t fed_net, uint16_t fe
       fed->enclave.immediate_downstreams = (uint16_t*)NULL;
     }
 
-    size_t connections_info_body_size = ((sizeof(uint16_t) + sizeof(int64_t)) * fed->enclave.num_immediate_upstreams) +
-                                        (sizeof(uint16_t) * fed->enclave.num_immediate_downstreams);
-    unsigned char* connections_info_body = NULL;
-    if (connections_info_body_size > 0) {
-      connections_info_body = (unsigned char*)malloc(connections_info_body_size);
-      LF_ASSERT_NON_NULL(connections_info_body);
-      read_from_net_fail_on_error(fed_net, connections_info_body_size, connections_info_body,
-                                  "RTI failed to read MSG_TYPE_NEIGHBOR_STRUCTURE message body from federate %d.",
-                                  fed_id);
+    if (connections_info_body != NULL) {
       // Keep track of where we are in the buffer
       size_t message_head = 0;
-      // First, read the info about upstream federates
+      // First, read the info about upstream federates. In a cluster RTI, the connections from
+      // outside the cluster are replaced by one connection from the parent.
+      int num_upstreams = 0;
+      bool parent_is_upstream = false;
       for (int i = 0; i < fed->enclave.num_immediate_upstreams; i++) {
-        fed->enclave.immediate_upstreams[i] = extract_uint16(&(connections_info_body[message_head]));
+        uint16_t upstream_id = extract_uint16(&(connections_info_body[message_head]));
         message_head += sizeof(uint16_t);
-        fed->enclave.immediate_upstream_delays[i] = extract_int64(&(connections_info_body[message_head]));
+        interval_t delay = extract_int64(&(connections_info_body[message_head]));
         message_head += sizeof(int64_t);
+        uint16_t upstream = cluster_node(upstream_id);
+        if (is_cluster_rti() && upstream == rti_remote->parent->enclave.id) {
+          add_cluster_connection(upstream_id / rti_remote->cluster_size, delay, true);
+          if (parent_is_upstream) {
+            continue;
+          }
+          parent_is_upstream = true;
+          add_parent_downstream(fed_id);
+          delay = NEVER;
+        }
+        fed->enclave.immediate_upstreams[num_upstreams] = upstream;
+        fed->enclave.immediate_upstream_delays[num_upstreams] = delay;
+        num_upstreams++;
       }
+      fed->enclave.num_immediate_upstreams = num_upstreams;
 
-      // Next, read the info about downstream federates
+      // Next, read the info about downstream federates, leaving out those outside the cluster of a cluster RTI.
+      int num_downstreams = 0;
       for (int i = 0; i < fed->enclave.num_immediate_downstreams; i++) {
-        fed->enclave.immediate_downstreams[i] = extract_uint16(&(connections_info_body[message_head]));
+        uint16_t downstream_id = extract_uint16(&(connections_info_body[message_head]));
         message_head += sizeof(uint16_t);
+        uint16_t downstream = cluster_node(downstream_id);
+        if (is_cluster_rti() && downstream == rti_remote->parent->enclave.id) {
+          add_cluster_connection(downstream_id / rti_remote->cluster_size, NEVER, false);
+          continue;
+        }
+        fed->enclave.immediate_downstreams[num_downstreams++] = downstream;
       }
+      fed->enclave.num_immediate_downstreams = num_downstreams;
 
       free(connections_info_body);
     }
+    LF_MUTEX_UNLOCK(&rti_mutex);
   }
   LF_PRINT_DEBUG("RTI received neighbor structure from federate %d.", fed_id);
   return 1;
@@ -1416,52 +2998,164 @@ static bool authenticate_federate(net_abstraction_t fed_net) {
 }
 #endif
 
-void lf_connect_to_federates(net_abstraction_t rti_net) {
-  for (int i = 0; i < rti_remote->base.number_of_scheduling_nodes; i++) {
-    net_abstraction_t fed_net = accept_net(rti_net);
-    if (fed_net == NULL) {
-      lf_print_warning("RTI failed to accept the federate.");
-      return;
-    }
+/** A handshake with an accepted connection, performed by a thread of its own. */
+typedef struct rti_handshake_t {
+  struct rti_handshake_t* next;
+  net_abstraction_t net;
+  /** The physical time at which the connection was accepted. */
+  instant_t accepted;
+  lf_thread_t thread;
+} rti_handshake_t;
+
+/** Counts of the handshakes, guarded by rti_mutex. */
+static int handshakes_in_progress = 0;
+static int federates_connected = 0;
+
+/** Condition signaled when a handshake finishes. */
+static lf_cond_t handshake_finished;
+
+/**
+ * Perform the handshake with an accepted connection and, if it is the main connection of a federate,
+ * start serving the federate.
+ * @param handshake The handshake.
+ * @return True if a federate has connected and false otherwise.
+ */
+static bool perform_handshake(rti_handshake_t* handshake) {
+  net_abstraction_t fed_net = handshake->net;
 // Wait for the first message from the federate when RTI -a option is on.
 #ifdef __RTI_AUTH__
-    if (rti_remote->authentication_enabled) {
-      if (!authenticate_federate(fed_net)) {
-        lf_print_warning("RTI failed to authenticate the incoming federate.");
-        // Close the network abstraction without reading until EOF.
-        shutdown_net(fed_net, false);
-        // Ignore the federate that failed authentication.
-        i--;
-        continue;
-      }
+  if (rti_remote->authentication_enabled) {
+    if (!authenticate_federate(fed_net)) {
+      lf_print_warning("RTI failed to authenticate the incoming federate.");
+      // Close the network abstraction without reading until EOF.
+      shutdown_net(fed_net, false);
+      // Ignore the federate that failed authentication.
+      return false;
     }
+  }
 #endif
 
-    // The first message from the federate should contain its ID and the federation ID.
-    int32_t fed_id = receive_and_check_fed_id_message(fed_net);
-    if (fed_id >= 0 && receive_connection_information(fed_net, (uint16_t)fed_id) &&
-        receive_udp_message_and_set_up_clock_sync(fed_net, (uint16_t)fed_id)) {
+  // The first message from the federate should contain its ID and the federation ID.
+  bool is_control_lane = false;
+  int32_t fed_id = receive_and_check_fed_id_message(fed_net, &is_control_lane);
+  if (fed_id >= 0 && is_control_lane) {
+    // The federate connects again for the rest of its messages.
+    LF_PRINT_LOG("RTI accepted the control lane of federate %d.", fed_id);
+    return false;
+  } else if (fed_id < 0 || !receive_connection_information(fed_net, (uint16_t)fed_id) ||
+             !receive_udp_message_and_set_up_clock_sync(fed_net, (uint16_t)fed_id)) {
+    // Received message was rejected.
+    return false;
+  }
+
+  // Create a thread to communicate with the federate.
+  // This has to be done after clock synchronization is finished
+  // or that thread may end up attempting to handle incoming clock
+  // synchronization messages.
+  federate_info_t* fed = GET_FED_INFO(fed_id);
+  // Now that its connections are known, paths through the federate constrain those downstream of it.
+  LF_MUTEX_LOCK(&rti_mutex);
+  invalidate_min_delays_through(&fed->enclave);
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  // From now on, all messages to the federate go through its send queue.
+  start_federate_writer(fed);
+  if (!is_cluster_rti()) {
+    serve_federate(fed);
+  }
+  if (rti_remote->base.tracing_enabled) {
+    tracepoint_startup_phase(startup_federate_handshake, -1, fed_id, handshake->accepted);
+  }
+  return true;
+}
 
-      // Create a thread to communicate with the federate.
-      // This has to be done after clock synchronization is finished
-      // or that thread may end up attempting to handle incoming clock
-      // synchronization messages.
-      federate_info_t* fed = GET_FED_INFO(fed_id);
-      lf_thread_create(&(fed->thread_id), federate_info_thread_TCP, fed);
-    } else {
-      // Received message was rejected. Try again.
-      i--;
+/**
+ * Thread performing a handshake and counting it as finished.
+ * @param handshake The handshake.
+ * @return NULL.
+ */
+static void* handshake_thread(void* handshake) {
+  bool connected = perform_handshake((rti_handshake_t*)handshake);
+  LF_MUTEX_LOCK(&rti_mutex);
+  handshakes_in_progress--;
+  if (connected) {
+    federates_connected++;
+  }
+  lf_cond_broadcast(&handshake_finished);
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  return NULL;
+}
+
+void lf_connect_to_federates(net_abstraction_t rti_net) {
+#ifdef PLATFORM_Linux
+  if (rti_remote->event_loop_threads > 0) {
+    start_event_loop();
+  }
+#endif
+  // Handshakes, including the initial clock synchronization, take several round trips, so each
+  // accepted connection gets a thread of its own. Connections that are rejected or that are
+  // control lanes do not count, so connections are accepted until all federates have connected,
+  // but never more at once than there are federates still to connect.
+  instant_t accept_start = lf_time_physical();
+  rti_handshake_t* handshakes = NULL;
+  bool failed = false;
+  LF_COND_INIT(&handshake_finished, &rti_mutex);
+  LF_MUTEX_LOCK(&rti_mutex);
+  while (federates_connected < number_of_federates()) {
+    if (handshakes_in_progress + federates_connected >= number_of_federates()) {
+      lf_cond_wait(&handshake_finished);
+      continue;
     }
+    handshakes_in_progress++;
+    LF_MUTEX_UNLOCK(&rti_mutex);
+    net_abstraction_t fed_net = accept_net(rti_net);
+    if (fed_net == NULL) {
+      lf_print_warning("RTI failed to accept the federate.");
+      failed = true;
+      LF_MUTEX_LOCK(&rti_mutex);
+      handshakes_in_progress--;
+      break;
+    }
+    rti_handshake_t* handshake = (rti_handshake_t*)calloc(1, sizeof(rti_handshake_t));
+    LF_ASSERT_NON_NULL(handshake);
+    handshake->net = fed_net;
+    handshake->accepted = lf_time_physical();
+    handshake->next = handshakes;
+    handshakes = handshake;
+    if (lf_thread_create(&handshake->thread, handshake_thread, handshake) != 0) {
+      lf_print_error_system_failure("RTI failed to create a thread for the handshake with a federate.");
+    }
+    LF_MUTEX_LOCK(&rti_mutex);
+  }
+  LF_MUTEX_UNLOCK(&rti_mutex);
+  while (handshakes != NULL) {
+    rti_handshake_t* handshake = handshakes;
+    handshakes = handshake->next;
+    lf_thread_join(handshake->thread, NULL);
+    free(handshake);
+  }
+  if (failed) {
+    return;
+  }
+  if (rti_remote->base.tracing_enabled) {
+    tracepoint_startup_phase(startup_accept_federates, -1, -1, accept_start);
   }
   // All federates have connected.
   LF_PRINT_DEBUG("All federates have connected to RTI.");
 
+  if (is_cluster_rti()) {
+    // The connections of the cluster to other clusters are now known.
+    connect_to_parent();
+    for (int i = 0; i < number_of_federates(); i++) {
+      serve_federate(GET_FED_INFO(i));
+    }
+  }
+
   if (rti_remote->clock_sync_global_status >= clock_sync_on) {
     // Create the thread that performs periodic PTP clock synchronization sessions
     // over the UDP channel, but only if the UDP channel is open and at least one
     // federate is performing runtime clock synchronization.
     bool clock_sync_enabled = false;
-    for (int i = 0; i < rti_remote->base.number_of_scheduling_nodes; i++) {
+    for (int i = 0; i < number_of_federates(); i++) {
       federate_info_t* fed_info = GET_FED_INFO(i);
       if (fed_info->clock_synchronization_enabled) {
         clock_sync_enabled = true;
@@ -1507,6 +3201,18 @@ void initialize_federate(federate_info_t* fed, uint16_t id) {
   fed->requested_stop = false;
   fed->clock_synchronization_enabled = true;
   fed->in_transit_message_tags = pqueue_tag_init(10);
+  initialize_send_queue(&fed->send_queue, id);
+  fed->control.net = NULL;
+  initialize_send_queue(&fed->control.send_queue, id);
+  fed->control.fenced_messages_received = 0;
+  fed->control.deferred_head = NULL;
+  fed->control.deferred_tail = NULL;
+  fed->control.fence_tag = NEVER_TAG;
+  fed->control.fenced_messages_sent = 0;
+  fed->control.later_message_tags = pqueue_tag_init(10);
+  fed->compression_codec = COMPRESSION_CODEC_NONE;
+  fed->forwarded_address_queries = NULL;
+  fed->num_forwarded_address_queries = 0;
 }
 
 int start_rti_server() {
@@ -1547,13 +3253,43 @@ void wait_for_federates() {
 
   // Wait for federate threads to exit.
   void* thread_exit_status;
-  for (int i = 0; i < rti_remote->base.number_of_scheduling_nodes; i++) {
+#ifdef PLATFORM_Linux
+  if (rti_remote->event_loop_threads > 0) {
+    LF_PRINT_LOG("RTI: Waiting for the event loop.");
+    stop_event_loop();
+  }
+#endif
+  for (int i = 0; i < number_of_federates(); i++) {
     federate_info_t* fed = GET_FED_INFO(i);
-    LF_PRINT_LOG("RTI: Waiting for thread handling federate %d.", fed->enclave.id);
-    lf_thread_join(fed->thread_id, &thread_exit_status);
+    if (rti_remote->event_loop_threads == 0) {
+      LF_PRINT_LOG("RTI: Waiting for thread handling federate %d.", fed->enclave.id);
+      lf_thread_join(fed->thread_id, &thread_exit_status);
+    }
+    // The thread may have exited without closing the send queue if the federate was marked as
+    // no longer connected by another thread.
+    stop_federate_writer(fed);
+    if (fed->control.net != NULL) {
+      // No thread reads from the control lane once it is closed and the event loop has stopped.
+      close_net(fed->control.net, false);
+      if (rti_remote->event_loop_threads == 0) {
+        lf_thread_join(fed->control.thread_id, &thread_exit_status);
+      }
+      free_net(fed->control.net);
+      fed->control.net = NULL;
+    }
+    while (fed->control.deferred_head != NULL) {
+      rti_deferred_control_message_t* deferred = fed->control.deferred_head;
+      fed->control.deferred_head = deferred->next;
+      free(deferred);
+    }
+    pqueue_tag_free(fed->control.later_message_tags);
     pqueue_tag_free(fed->in_transit_message_tags);
+    free(fed->forwarded_address_queries);
     LF_PRINT_LOG("RTI: Federate %d thread exited.", fed->enclave.id);
   }
+  if (is_cluster_rti()) {
+    disconnect_from_parent();
+  }
 
   rti_remote->all_federates_exited = true;
 
@@ -1597,6 +3333,16 @@ void initialize_RTI(rti_remote_t* rti) {
   rti_remote->base.tracing_enabled = false;
   rti_remote->base.dnet_disabled = false;
   rti_remote->stop_in_progress = false;
+  rti_remote->event_loop_threads = 0;
+  rti_remote->epoll_descriptor = -1;
+  rti_remote->event_loop_stop_descriptor = -1;
+  rti_remote->event_loop_thread_ids = NULL;
+  rti_remote->num_feds_served = 0;
+  rti_remote->cluster_size = 0;
+  rti_remote->cluster = -1;
+  rti_remote->parent_host = NULL;
+  rti_remote->parent_port = 0;
+  rti_remote->parent = NULL;
 }
 
 // The RTI includes clock.c, which requires the following functions that are defined
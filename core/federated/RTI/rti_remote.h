@@ -32,9 +32,119 @@
  */
 #define MAX_TIME_FOR_REPLY_TO_STOP_REQUEST SEC(30)
 
+/**
+ * @brief Number of bytes of tagged messages that may wait in the send queue of a federate.
+ * @ingroup RTI
+ *
+ * When the queue of a federate holds this many bytes, the RTI stops reading tagged messages destined
+ * to that federate until its queue drains, which pushes back on the senders without holding up
+ * any other federate. A larger message is accepted once the queue is empty.
+ */
+#define RTI_SEND_QUEUE_CAPACITY (16u * 1024u * 1024u)
+
+#ifndef RTI_MAX_MESSAGE_LENGTH
+/**
+ * @brief Largest payload in bytes of a tagged message that the RTI forwards.
+ * @ingroup RTI
+ *
+ * The RTI allocates the memory for a tagged message as soon as it has read its header, so a federate
+ * announcing a longer payload is disconnected instead.
+ */
+#define RTI_MAX_MESSAGE_LENGTH (1024u * 1024u * 1024u)
+#endif
+
 /////////////////////////////////////////////
 //// Data structures
 
+/**
+ * @brief A message waiting in the send queue of a federate.
+ * @ingroup RTI
+ */
+typedef struct rti_outbound_message_t {
+  /** @brief The next message in the queue. */
+  struct rti_outbound_message_t* next;
+  /** @brief The length of the message. */
+  size_t length;
+  /** @brief The message, starting with its type byte. */
+  unsigned char data[];
+} rti_outbound_message_t;
+
+/**
+ * @brief A queue of messages to a federate, written to its connection by a thread of its own.
+ * @ingroup RTI
+ *
+ * Once the federate has connected, every message from the RTI to the federate goes through a send
+ * queue, so the RTI never blocks on the federate's connection while holding the RTI mutex, and
+ * messages reach the federate in the order in which they were queued.
+ */
+typedef struct rti_send_queue_t {
+  /** @brief Mutex protecting the queue. */
+  lf_mutex_t mutex;
+  /** @brief Condition signaled when messages are added to or removed from the queue or when it is closed. */
+  lf_cond_t changed;
+  /** @brief Messages waiting to be written, oldest first. */
+  rti_outbound_message_t* head;
+  /** @brief The most recently queued message. */
+  rti_outbound_message_t* tail;
+  /** @brief The number of bytes of the messages in the queue. */
+  size_t bytes;
+  /** @brief Indicates that the queue accepts no more messages, either because it was closed or writing failed. */
+  bool closed;
+  /** @brief Indicates that the writer thread is running. */
+  bool writer_running;
+  /** @brief The ID of the thread writing the messages in the queue. */
+  lf_thread_t writer_thread_id;
+  /** @brief The network abstraction to which the messages are written. */
+  net_abstraction_t net;
+  /** @brief The ID of the federate to which the messages are written. */
+  uint16_t federate_id;
+} rti_send_queue_t;
+
+/**
+ * @brief A message from a federate on its control lane that waits for earlier messages on its
+ * main connection to be handled.
+ * @ingroup RTI
+ */
+typedef struct rti_deferred_control_message_t {
+  /** @brief The next deferred message. */
+  struct rti_deferred_control_message_t* next;
+  /** @brief The message type. */
+  unsigned char type;
+  /** @brief The number of fenced messages from the federate to handle before this one. */
+  int64_t fence;
+  /** @brief The tags carried by the message. A next message request carries two. */
+  tag_t tags[2];
+} rti_deferred_control_message_t;
+
+/**
+ * @brief The state of the control lane of a federate, which carries its tag coordination messages
+ * separately from its other messages (@see MSG_TYPE_CONTROL_LANE).
+ * @ingroup RTI
+ *
+ * The fields other than the network abstraction, the send queue, and the thread ID are protected
+ * by the RTI mutex.
+ */
+typedef struct rti_control_lane_t {
+  /** @brief The network abstraction of the control lane, or NULL if the federate has none. */
+  net_abstraction_t net;
+  /** @brief The queue of grants to the federate. */
+  rti_send_queue_t send_queue;
+  /** @brief The ID of the thread handling messages on the control lane, unless the event loop serves it. */
+  lf_thread_t thread_id;
+  /** @brief The number of fenced messages from the federate that have been handled. */
+  int64_t fenced_messages_received;
+  /** @brief The messages waiting for more fenced messages to be handled, oldest first. */
+  rti_deferred_control_message_t* deferred_head;
+  /** @brief The most recently deferred message. */
+  rti_deferred_control_message_t* deferred_tail;
+  /** @brief The greatest tag granted to the federate on the control lane. */
+  tag_t fence_tag;
+  /** @brief The number of fenced messages sent to the federate with a tag no later than fence_tag. */
+  int64_t fenced_messages_sent;
+  /** @brief The tags of the fenced messages sent to the federate with a tag later than fence_tag. */
+  pqueue_tag_t* later_message_tags;
+} rti_control_lane_t;
+
 /**
  * @brief Information about a federate known to the RTI, including its runtime state,
  * mode of execution, and connectivity with other federates.
@@ -51,7 +161,7 @@ typedef struct federate_info_t {
   /** @brief Indicates that the federate has requested stop or has replied to a request for stop from the RTI. Used to
    * prevent double-counting a federate when handling lf_request_stop(). */
   bool requested_stop;
-  /** @brief The ID of the thread handling communication with this federate. */
+  /** @brief The ID of the thread handling communication with this federate, unless the event loop serves it. */
   lf_thread_t thread_id;
   /** @brief The network abstraction for communicating with this federate. */
   net_abstraction_t net;
@@ -62,6 +172,19 @@ typedef struct federate_info_t {
   /** @brief Record of in-transit messages to this federate that are not yet processed. This record is ordered based on
    * the time value of each message for a more efficient access. */
   pqueue_tag_t* in_transit_message_tags;
+  /** @brief The queue of messages to this federate on its network abstraction. */
+  rti_send_queue_t send_queue;
+  /** @brief The control lane of this federate. */
+  rti_control_lane_t control;
+  /** @brief The codec with which this federate compresses payloads (@see MSG_TYPE_COMPRESSION). */
+  unsigned char compression_codec;
+  /**
+   * @brief If this federate is another RTI, the IDs of the federates whose address queries were
+   * forwarded to it and await its replies, oldest first (@see handle_address_query()).
+   */
+  uint16_t* forwarded_address_queries;
+  /** @brief The number of forwarded address queries awaiting a reply. */
+  size_t num_forwarded_address_queries;
 } federate_info_t;
 
 /**
@@ -159,6 +282,60 @@ typedef struct rti_remote_t {
 
   /** @brief Boolean indicating that a stop request is already in progress. */
   bool stop_in_progress;
+
+  /**
+   * @brief Number of threads serving all federates from an epoll event loop.
+   *
+   * The default of 0 means that each federate is served by a thread of its own. This is set by the
+   * `-e` or `--event_loop` command-line option, which is only available on Linux. As many threads
+   * read the payloads of tagged messages that have not fully arrived when the loop reads their headers.
+   */
+  int event_loop_threads;
+
+  /** @brief The epoll instance of the event loop, or -1. */
+  int epoll_descriptor;
+
+  /** @brief Event that is signaled when the event loop has no federate left to serve, or -1. */
+  int event_loop_stop_descriptor;
+
+  /** @brief The threads running the event loop. */
+  lf_thread_t* event_loop_thread_ids;
+
+  /** @brief Number of federates that the event loop still serves. */
+  int num_feds_served;
+
+  /**
+   * @brief Number of consecutive federate IDs in each cluster of a hierarchical federation.
+   *
+   * The default of 0 means that the federation is flat. Otherwise, the federates with IDs from
+   * `k * cluster_size` to `(k + 1) * cluster_size - 1` form cluster k. A cluster RTI coordinates the
+   * federates of one cluster and joins a root RTI as if the cluster were a single federate with ID k,
+   * so that the root RTI only coordinates the clusters. This is set by the `--cluster_size`
+   * command-line option of both the root RTI and the cluster RTIs.
+   */
+  uint16_t cluster_size;
+
+  /** @brief The cluster that this RTI coordinates, or -1 if this is not a cluster RTI. */
+  int32_t cluster;
+
+  /** @brief Host name of the parent RTI of a cluster RTI. */
+  const char* parent_host;
+
+  /** @brief Port of the parent RTI of a cluster RTI. */
+  uint16_t parent_port;
+
+  /**
+   * @brief In a cluster RTI, the scheduling node standing for the rest of the federation, or NULL.
+   *
+   * This is the last scheduling node. Its network abstraction is the connection to the parent RTI and
+   * its send queue holds the messages to the parent. It is upstream, with no delay, of every member of
+   * the cluster that has a connection from outside the cluster, and it completes the tags that the
+   * parent grants to the cluster, which already account for the delays of those connections.
+   */
+  federate_info_t* parent;
+
+  /** @brief The ID of the thread handling the messages from the parent RTI. */
+  lf_thread_t parent_thread_id;
 } rti_remote_t;
 
 extern int lf_critical_section_enter(environment_t* env);
@@ -202,12 +379,22 @@ void handle_port_absent_message(federate_info_t* sending_federate, unsigned char
  * @brief Handle a timed message being received from a federate by the RTI to relay to another federate.
  * @ingroup RTI
  *
+ * The whole message is read before the mutex is acquired, and it is then put on the send queue of
+ * the destination federate, so the mutex is held only to record the message as in transit.
+ * In a thread of the event loop, if the payload has not fully arrived or the send queue of the
+ * destination is full, the payload is instead read by a payload reader, which then has the event
+ * loop serve the sending federate again.
+ *
  * This function assumes the caller does not hold the mutex.
  *
  * @param sending_federate The sending federate.
  * @param buffer The buffer to read into (the first byte is already there).
+ * @return 0 on success, 1 if a payload reader handles the rest of the message, in which case the
+ * caller must not read from the sending federate, or -1 if the header is invalid, for a payload
+ * longer than RTI_MAX_MESSAGE_LENGTH or an unknown destination, in which case the caller should
+ * close the connection.
  */
-void handle_timed_message(federate_info_t* sending_federate, unsigned char* buffer);
+int handle_timed_message(federate_info_t* sending_federate, unsigned char* buffer);
 
 /**
  * @brief Handle a latest tag confirmed (LTC) message.
@@ -233,6 +420,18 @@ void handle_latest_tag_confirmed(federate_info_t* fed);
  */
 void handle_next_event_tag(federate_info_t* fed);
 
+/**
+ * @brief Handle a next message request (NMR), which carries both a latest tag confirmed and a next event tag.
+ * @ingroup RTI
+ *
+ * This function assumes the caller does not hold the mutex.
+ *
+ * @see MSG_TYPE_NEXT_MESSAGE_REQUEST in @ref net_common.h.
+ *
+ * @param fed The federate sending the NMR message.
+ */
+void handle_next_message_request(federate_info_t* fed);
+
 /////////////////// STOP functions ////////////////////
 
 /**
@@ -269,6 +468,11 @@ void handle_stop_request_reply(federate_info_t* fed);
  * The sending federate is responsible for checking back with the RTI after a
  * period of time.
  *
+ * In a hierarchical federation, the address of a federate is known only to the RTI of its
+ * cluster. A cluster RTI forwards a query for a federate outside its cluster to the root RTI,
+ * which forwards it to the RTI of the cluster of that federate, and each RTI passes the reply
+ * back to the sender of the query.
+ *
  * @param fed_id The federate sending a MSG_TYPE_ADDRESS_QUERY message.
  */
 void handle_address_query(uint16_t fed_id);
@@ -295,6 +499,11 @@ void handle_address_ad(uint16_t federate_id);
  * @brief A function to handle timestamp messages.
  * @ingroup RTI
  *
+ * The federate proposing the last start time sends the start time of the federation to all
+ * federates, so that no thread ever waits here for the other federates' proposals. In a cluster
+ * RTI, the latest proposal is instead proposed to the parent, and the start time is sent to the
+ * federates once the parent replies with it.
+ *
  * This function assumes the caller does not hold the mutex.
  */
 void handle_timestamp(federate_info_t* my_fed);
@@ -350,6 +559,8 @@ void* clock_synchronization_thread(void* noargs);
  * @brief Thread handling TCP communication with a federate.
  * @ingroup RTI
  *
+ * This is not used if the federates are served by the event loop (@see rti_remote_t.event_loop_threads).
+ *
  * @param fed A pointer to the federate's struct that has the socket descriptor for the federate.
  * @return NULL.
  */
@@ -369,6 +580,9 @@ void send_reject(net_abstraction_t net_abs, unsigned char error_code);
  * and, upon receiving it, create a thread to communicate with that federate.
  * @ingroup RTI
  *
+ * If the event loop is enabled, its threads are started first and each federate is
+ * handed to it instead of getting a thread of its own.
+ *
  * Return when all federates have connected.
  *
  * @param rti_net The rti's network abstraction on which to accept connections.
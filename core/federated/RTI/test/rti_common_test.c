@@ -96,8 +96,6 @@ void set_common_RTI(uint16_t num_nodes) {
   test_RTI.scheduling_nodes =
       (scheduling_node_t**)calloc(test_RTI.number_of_scheduling_nodes, sizeof(scheduling_node_t*));
 
-  test_RTI.min_delays = NULL;
-
   for (uint16_t i = 0; i < test_RTI.number_of_scheduling_nodes; i++) {
     scheduling_node_t* scheduling_node = (scheduling_node_t*)malloc(sizeof(scheduling_node_t));
     initialize_scheduling_node(scheduling_node, i);
@@ -120,7 +118,6 @@ void set_state_of_nodes(scheduling_node_state_t state) {
 
 void valid_cache() {
   set_common_RTI(2);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --> node[1]
@@ -129,12 +126,16 @@ void valid_cache() {
 
   set_state_of_nodes(GRANTED);
 
-  test_RTI.min_delays = (tag_t*)calloc((n * n), sizeof(tag_t));
-  test_RTI.min_delays[0] = (tag_t){.time = NSEC(1), .microstep = 0};
-
-  // If min_delays is not null (the cached data is valid), nothing should be changed.
   update_min_delays();
-  assert(lf_tag_compare(test_RTI.min_delays[0], (tag_t){.time = NSEC(1), .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), ZERO_TAG) == 0);
+
+  // If the cached data is valid, nothing should be changed.
+  test_RTI.scheduling_nodes[1]->immediate_upstream_delays[0] = NSEC(1);
+  assert(lf_tag_compare(get_min_delay(0, 1), ZERO_TAG) == 0);
+
+  // Once invalidated, the new delay should be taken into account.
+  invalidate_min_delays_through(test_RTI.scheduling_nodes[1]);
+  assert(lf_tag_compare(get_min_delay(0, 1), (tag_t){.time = NSEC(1), .microstep = 0}) == 0);
 
   reset_common_RTI();
 }
@@ -154,7 +155,7 @@ void not_connected() {
   update_min_delays();
   for (uint16_t i = 0; i < n; i++) {
     for (uint16_t j = 0; j < n; j++) {
-      assert(lf_tag_compare(test_RTI.min_delays[i * n + j], FOREVER_TAG) == 0);
+      assert(lf_tag_compare(get_min_delay(i, j), FOREVER_TAG) == 0);
     }
   }
 
@@ -163,7 +164,6 @@ void not_connected() {
 
 static void two_nodes_no_delay() {
   set_common_RTI(2);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --> node[1]
@@ -174,20 +174,19 @@ static void two_nodes_no_delay() {
 
   update_min_delays();
   // The min_delay from 0 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 0), FOREVER_TAG) == 0);
   // The min_delay from 0 to 1 should be ZERO_TAG which means no delay.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 1], ZERO_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), ZERO_TAG) == 0);
   // The min_delay from 1 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 0), FOREVER_TAG) == 0);
   // The min_delay from 1 to 1 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 1], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 1), FOREVER_TAG) == 0);
 
   reset_common_RTI();
 }
 
 static void two_nodes_zero_delay() {
   set_common_RTI(2);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --/0/--> node[1]
@@ -198,20 +197,19 @@ static void two_nodes_zero_delay() {
 
   update_min_delays();
   // The min_delay from 0 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 0), FOREVER_TAG) == 0);
   // The min_delay from 0 to 1 should be (0, 1).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 1], (tag_t){.time = 0, .microstep = 1}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), (tag_t){.time = 0, .microstep = 1}) == 0);
   // The min_delay from 1 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 0), FOREVER_TAG) == 0);
   // The min_delay from 1 to 1 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 1], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 1), FOREVER_TAG) == 0);
 
   reset_common_RTI();
 }
 
 static void two_nodes_normal_delay() {
   set_common_RTI(2);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --/1 nsec/--> node[1]
@@ -222,20 +220,19 @@ static void two_nodes_normal_delay() {
 
   update_min_delays();
   // The min_delay from 0 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 0), FOREVER_TAG) == 0);
   // The min_delay from 0 to 1 should be (1, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 1], (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), (tag_t){.time = 1, .microstep = 0}) == 0);
   // The min_delay from 1 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 0), FOREVER_TAG) == 0);
   // The min_delay from 1 to 1 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 1], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 1), FOREVER_TAG) == 0);
 
   reset_common_RTI();
 }
 
 static void two_nodes_cycle() {
   set_common_RTI(2);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --/1 nsec/--> node[1] --> node[0]
@@ -246,13 +243,13 @@ static void two_nodes_cycle() {
 
   update_min_delays();
   // The min_delay from 0 to 0 should be (1, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 0], (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 0), (tag_t){.time = 1, .microstep = 0}) == 0);
   // The min_delay from 0 to 1 should be (1, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 1], (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), (tag_t){.time = 1, .microstep = 0}) == 0);
   // The min_delay from 1 to 0 should be ZERO_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 0], ZERO_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 0), ZERO_TAG) == 0);
   // The min_delay from 1 to 1 should be (1, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 1], (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 1), (tag_t){.time = 1, .microstep = 0}) == 0);
 
   // Both of them are in a cycle.
   assert(is_in_cycle(test_RTI.scheduling_nodes[0]) == 1);
@@ -266,7 +263,6 @@ static void two_nodes_cycle() {
 
 static void two_nodes_ZDC() {
   set_common_RTI(2);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --> node[1] --> node[0]
@@ -277,13 +273,13 @@ static void two_nodes_ZDC() {
 
   update_min_delays();
   // The min_delay from 0 to 0 should be ZERO_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 0], ZERO_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 0), ZERO_TAG) == 0);
   // The min_delay from 0 to 1 should be ZERO_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 1], ZERO_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), ZERO_TAG) == 0);
   // The min_delay from 1 to 0 should be ZERO_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 0], ZERO_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 0), ZERO_TAG) == 0);
   // The min_delay from 1 to 1 should be ZERO_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 1], ZERO_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 1), ZERO_TAG) == 0);
 
   // Both of them are in a zero delay cycle.
   assert(is_in_zero_delay_cycle(test_RTI.scheduling_nodes[0]) == 1);
@@ -294,7 +290,6 @@ static void two_nodes_ZDC() {
 
 static void multiple_nodes() {
   set_common_RTI(4);
-  uint16_t n = test_RTI.number_of_scheduling_nodes;
 
   // Construct the structure illustrated below.
   // node[0] --/1 nsec/--> node[1] --/0/--> node[2] --/2 nsec/--> node[3]
@@ -307,40 +302,76 @@ static void multiple_nodes() {
 
   update_min_delays();
   // The min_delay from 0 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 0), FOREVER_TAG) == 0);
   // The min_delay from 0 to 1 should be (1, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 1], (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 1), (tag_t){.time = 1, .microstep = 0}) == 0);
   // The min_delay from 0 to 2 should be (1, 1).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 2], (tag_t){.time = 1, .microstep = 1}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 2), (tag_t){.time = 1, .microstep = 1}) == 0);
   // The min_delay from 0 to 3 should be (3, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[0 * n + 3], (tag_t){.time = 3, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(0, 3), (tag_t){.time = 3, .microstep = 0}) == 0);
 
   // The min_delay from 1 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 0), FOREVER_TAG) == 0);
   // The min_delay from 1 to 1 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 1], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 1), FOREVER_TAG) == 0);
   // The min_delay from 1 to 2 should be (0, 1).
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 2], (tag_t){.time = 0, .microstep = 1}) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 2), (tag_t){.time = 0, .microstep = 1}) == 0);
   // The min_delay from 1 to 3 should be (2, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[1 * n + 3], (tag_t){.time = 2, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 3), (tag_t){.time = 2, .microstep = 0}) == 0);
 
   // The min_delay from 2 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[2 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(2, 0), FOREVER_TAG) == 0);
   // The min_delay from 2 to 1 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[2 * n + 1], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(2, 1), FOREVER_TAG) == 0);
   // The min_delay from 2 to 2 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[2 * n + 2], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(2, 2), FOREVER_TAG) == 0);
   // The min_delay from 2 to 3 should be (2, 0).
-  assert(lf_tag_compare(test_RTI.min_delays[2 * n + 3], (tag_t){.time = 2, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(2, 3), (tag_t){.time = 2, .microstep = 0}) == 0);
 
   // The min_delay from 3 to 0 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[3 * n + 0], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 0), FOREVER_TAG) == 0);
   // The min_delay from 3 to 1 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[3 * n + 1], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 1), FOREVER_TAG) == 0);
   // The min_delay from 3 to 2 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[3 * n + 2], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 2), FOREVER_TAG) == 0);
   // The min_delay from 3 to 3 should be FOREVER_TAG.
-  assert(lf_tag_compare(test_RTI.min_delays[3 * n + 3], FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 3), FOREVER_TAG) == 0);
+
+  reset_common_RTI();
+}
+
+static void disconnect() {
+  set_common_RTI(4);
+
+  // Construct the structure illustrated below.
+  // node[0] --/1 nsec/--> node[1] --> node[2]
+  //    |                                 ^
+  //    +-------------/3 nsec/------------+
+  // node[3] --> node[1]
+  set_scheduling_node(0, 0, 2, NULL, NULL, (int[]){1, 2});
+  set_scheduling_node(1, 2, 1, (int[]){0, 3}, (interval_t[]){NSEC(1), NEVER}, (int[]){2});
+  set_scheduling_node(2, 2, 0, (int[]){1, 0}, (interval_t[]){NEVER, NSEC(3)}, NULL);
+  set_scheduling_node(3, 0, 1, NULL, NULL, (int[]){1});
+
+  set_state_of_nodes(GRANTED);
+
+  assert(lf_tag_compare(get_min_delay(0, 2), (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 2), ZERO_TAG) == 0);
+
+  // Once node[1] disconnects, paths through it are gone, but node[1] itself is still upstream of node[2].
+  test_RTI.scheduling_nodes[1]->state = NOT_CONNECTED;
+  invalidate_min_delays_through(test_RTI.scheduling_nodes[1]);
+  assert(lf_tag_compare(get_min_delay(0, 2), (tag_t){.time = 3, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 2), FOREVER_TAG) == 0);
+  assert(lf_tag_compare(get_min_delay(1, 2), ZERO_TAG) == 0);
+  // A node that is not connected has no upstream nodes.
+  assert(lf_tag_compare(get_min_delay(0, 1), FOREVER_TAG) == 0);
+
+  // Once it reconnects, the paths through it are back.
+  test_RTI.scheduling_nodes[1]->state = GRANTED;
+  invalidate_min_delays_through(test_RTI.scheduling_nodes[1]);
+  assert(lf_tag_compare(get_min_delay(0, 2), (tag_t){.time = 1, .microstep = 0}) == 0);
+  assert(lf_tag_compare(get_min_delay(3, 2), ZERO_TAG) == 0);
 
   reset_common_RTI();
 }
@@ -357,4 +388,5 @@ int main() {
   two_nodes_cycle();
   two_nodes_ZDC();
   multiple_nodes();
+  disconnect();
 }
@@ -0,0 +1,132 @@
+/**
+ * @file rti_event_loop_test.c
+ * @brief Test that a federate sending a payload slowly does not hold up the event loop of the RTI.
+ *
+ * Synthetic federates join an RTI running in the same process, served by an event loop with one
+ * thread. Federate 0 sends a large tagged message to federate 1, but writes only the header and
+ * half of the payload and then waits for federate 2 to be granted a tag, which takes a next event
+ * tag from federate 2 and a latest tag confirmed from federate 3, its only upstream federate. Only
+ * then does federate 0 write the rest. If the thread of the event loop were reading the payload,
+ * it could not handle these messages, so federate 0 would give up waiting and the test would fail.
+ */
+
+#include <stdio.h>
+
+#include "bench/synthetic_federate.h"
+
+/** Length of the payload that federate 0 sends, more than a socket buffers. */
+#define PAYLOAD_LENGTH (4 * 1024 * 1024)
+
+/** How long federate 0 waits for federate 2 to be granted a tag. */
+#define GRANT_TIMEOUT SEC(10)
+
+static net_abstraction_t nets[4];
+static instant_t start_time_of_federation;
+static unsigned char* payload;
+
+static lf_mutex_t mutex;
+static lf_cond_t changed;
+
+/** Whether federate 0 has written the first half of the payload. */
+static bool half_sent = false;
+
+/** Whether federate 2 has been granted a tag. */
+static bool granted = false;
+
+/** Send the tagged message of federate 0, pausing halfway until federate 2 has been granted a tag. */
+static void* trickle(void* ignored) {
+  (void)ignored;
+  unsigned char header[1 + SYNTHETIC_TAGGED_HEADER_LENGTH];
+  header[0] = MSG_TYPE_TAGGED_MESSAGE;
+  encode_uint16(0, &header[1]);
+  encode_uint16(1, &header[1 + sizeof(uint16_t)]);
+  encode_int32(PAYLOAD_LENGTH, &header[1 + 2 * sizeof(uint16_t)]);
+  encode_tag(&header[1 + 2 * sizeof(uint16_t) + sizeof(int32_t)],
+             (tag_t){.time = start_time_of_federation + 1, .microstep = 0});
+  synthetic_write(nets[0], sizeof(header), header);
+  synthetic_write(nets[0], PAYLOAD_LENGTH / 2, payload);
+
+  LF_MUTEX_LOCK(&mutex);
+  half_sent = true;
+  lf_cond_broadcast(&changed);
+  instant_t give_up = lf_time_physical() + GRANT_TIMEOUT;
+  while (!granted && lf_time_physical() < give_up) {
+    _lf_cond_timedwait(&changed, give_up);
+  }
+  bool was_granted = granted;
+  LF_MUTEX_UNLOCK(&mutex);
+  if (!was_granted) {
+    lf_print_error("Federate 2 was not granted a tag while federate 0 was sending a payload.");
+  }
+
+  synthetic_write(nets[0], PAYLOAD_LENGTH - PAYLOAD_LENGTH / 2, &payload[PAYLOAD_LENGTH / 2]);
+  return (void*)(intptr_t)was_granted;
+}
+
+int main() {
+  initialize_lf_thread_id();
+  LF_MUTEX_INIT(&mutex);
+  LF_COND_INIT(&changed, &mutex);
+  payload = (unsigned char*)malloc(PAYLOAD_LENGTH);
+  unsigned char* received = (unsigned char*)malloc(PAYLOAD_LENGTH);
+  LF_ASSERT_NON_NULL(payload);
+  LF_ASSERT_NON_NULL(received);
+  for (size_t i = 0; i < PAYLOAD_LENGTH; i++) {
+    payload[i] = (unsigned char)(i * 31 + i / 4099);
+  }
+
+  uint16_t rti_port = start_synthetic_rti(4, 1);
+  uint16_t ids[] = {0, 1, 2, 3};
+  nets[0] = synthetic_federate_connect(rti_port, 0, 0, NULL, 1, &ids[1]);
+  nets[1] = synthetic_federate_connect(rti_port, 1, 1, &ids[0], 0, NULL);
+  nets[2] = synthetic_federate_connect(rti_port, 2, 1, &ids[3], 0, NULL);
+  nets[3] = synthetic_federate_connect(rti_port, 3, 0, NULL, 1, &ids[2]);
+  for (int i = 0; i < 4; i++) {
+    synthetic_federate_send_timestamp(nets[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    start_time_of_federation = synthetic_federate_receive_start_time(nets[i]);
+  }
+
+  lf_thread_t trickler;
+  lf_thread_create(&trickler, trickle, NULL);
+  LF_MUTEX_LOCK(&mutex);
+  while (!half_sent) {
+    lf_cond_wait(&changed);
+  }
+  LF_MUTEX_UNLOCK(&mutex);
+  // Give the event loop time to read the header of the message.
+  lf_sleep(MSEC(50));
+
+  tag_t next = {.time = start_time_of_federation + 1, .microstep = 0};
+  synthetic_federate_send_tag(nets[2], MSG_TYPE_NEXT_EVENT_TAG, next);
+  synthetic_federate_send_tag(nets[3], MSG_TYPE_LATEST_TAG_CONFIRMED, next);
+  tag_t tag;
+  size_t length;
+  while (synthetic_federate_receive(nets[2], &tag, NULL, 0, &length) != MSG_TYPE_TAG_ADVANCE_GRANT ||
+         lf_tag_compare(tag, next) < 0) {
+  }
+  LF_MUTEX_LOCK(&mutex);
+  granted = true;
+  lf_cond_broadcast(&changed);
+  LF_MUTEX_UNLOCK(&mutex);
+
+  while (synthetic_federate_receive(nets[1], &tag, received, PAYLOAD_LENGTH, &length) != MSG_TYPE_TAGGED_MESSAGE) {
+  }
+  if (length != PAYLOAD_LENGTH || memcmp(payload, received, PAYLOAD_LENGTH) != 0) {
+    lf_print_error_and_exit("Federate 1 received a payload of %zu bytes that differs from the one sent.", length);
+  }
+  void* was_granted;
+  lf_thread_join(trickler, &was_granted);
+  if (!(intptr_t)was_granted) {
+    lf_print_error_and_exit("The event loop waited for the payload of federate 0.");
+  }
+
+  for (int i = 0; i < 4; i++) {
+    synthetic_federate_resign(nets[i]);
+  }
+  stop_synthetic_rti();
+  free(received);
+  free(payload);
+  return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file rti_handshake_test.c
+ * @brief Test that the RTI performs the handshakes of federates concurrently.
+ *
+ * Synthetic federates join an RTI running in the same process. Federate 0 identifies itself and
+ * then stalls before declaring its neighbors. While its handshake is in progress, a connection
+ * claiming the ID of federate 0 must be rejected, and federates 1 and 2 must be acknowledged and
+ * go on with their handshakes. If the RTI performed one handshake at a time, it would not read
+ * from these connections until federate 0 continued, so the test would give up waiting for them. Federate 0
+ * then completes its handshake, and the federation starts.
+ */
+
+#include <stdio.h>
+
+#include "bench/synthetic_federate.h"
+
+/** How long to wait for the other connections to be handled while federate 0 stalls. */
+#define HANDSHAKE_TIMEOUT SEC(10)
+
+static uint16_t rti_port;
+static net_abstraction_t nets[3];
+
+static lf_mutex_t mutex;
+static lf_cond_t changed;
+
+/** Whether the second federate 0 has been rejected and federates 1 and 2 have declared their neighbors. */
+static bool connected = false;
+
+/** Check that a connection claiming the ID of a federate whose handshake is in progress is rejected. */
+static void test_duplicate_id(void) {
+#ifdef COMM_TYPE_SHM
+  shm_connection_params_t params = {.socket_params = {.type = TCP, .port = rti_port, .server_hostname = "127.0.0.1"}};
+#else
+  socket_connection_params_t params = {.type = TCP, .port = rti_port, .server_hostname = "127.0.0.1"};
+#endif
+  net_abstraction_t net = connect_to_net((net_params_t)&params);
+  LF_ASSERT_NON_NULL(net);
+  size_t federation_id_length = strlen(synthetic_rti.federation_id);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  buffer[0] = MSG_TYPE_FED_IDS_NMR;
+  encode_uint16(0, &buffer[1]);
+  buffer[1 + sizeof(uint16_t)] = (unsigned char)federation_id_length;
+  memcpy(&buffer[2 + sizeof(uint16_t)], synthetic_rti.federation_id, federation_id_length);
+  synthetic_write(net, 2 + sizeof(uint16_t) + federation_id_length, buffer);
+  synthetic_read(net, 2, buffer);
+  if (buffer[0] != MSG_TYPE_REJECT || buffer[1] != FEDERATE_ID_IN_USE) {
+    lf_print_error_and_exit("The RTI accepted a second federate 0. Got message type %u.", buffer[0]);
+  }
+  shutdown_net(net, false);
+}
+
+/** Connect a second federate 0, which is rejected, and then federates 1 and 2, which have no neighbors. */
+static void* connect_others(void* ignored) {
+  (void)ignored;
+  test_duplicate_id();
+  nets[1] = synthetic_federate_connect(rti_port, 1, 0, NULL, 0, NULL);
+  nets[2] = synthetic_federate_connect(rti_port, 2, 0, NULL, 0, NULL);
+  LF_MUTEX_LOCK(&mutex);
+  connected = true;
+  lf_cond_broadcast(&changed);
+  LF_MUTEX_UNLOCK(&mutex);
+  return NULL;
+}
+
+int main() {
+  initialize_lf_thread_id();
+  LF_MUTEX_INIT(&mutex);
+  LF_COND_INIT(&changed, &mutex);
+  rti_port = start_synthetic_rti(3, 0);
+
+  // Federate 0 identifies itself but does not yet declare its neighbors.
+  nets[0] = synthetic_federate_open(rti_port, 0, MSG_TYPE_FED_IDS_NMR);
+
+  lf_thread_t connector;
+  lf_thread_create(&connector, connect_others, NULL);
+  LF_MUTEX_LOCK(&mutex);
+  instant_t give_up = lf_time_physical() + HANDSHAKE_TIMEOUT;
+  while (!connected && lf_time_physical() < give_up) {
+    _lf_cond_timedwait(&changed, give_up);
+  }
+  bool others_connected = connected;
+  LF_MUTEX_UNLOCK(&mutex);
+  if (!others_connected) {
+    lf_print_error_and_exit("Other connections were not handled while the handshake of federate 0 was in progress.");
+  }
+  lf_thread_join(connector, NULL);
+
+  synthetic_federate_declare_neighbors(nets[0], 0, NULL, 0, NULL);
+  for (int i = 0; i < 3; i++) {
+    synthetic_federate_send_timestamp(nets[i]);
+  }
+  instant_t start_times[3];
+  for (int i = 0; i < 3; i++) {
+    start_times[i] = synthetic_federate_receive_start_time(nets[i]);
+  }
+  if (start_times[0] != start_times[1] || start_times[0] != start_times[2]) {
+    lf_print_error_and_exit("The federates received different start times.");
+  }
+
+  for (int i = 0; i < 3; i++) {
+    synthetic_federate_resign(nets[i]);
+  }
+  stop_synthetic_rti();
+  return 0;
+}
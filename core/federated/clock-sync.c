@@ -14,15 +14,31 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+#ifdef SO_TIMESTAMPING
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <poll.h>
+#endif
+
 #include "low_level_platform.h"
 #include "clock-sync.h"
 #include "net_common.h"
 #include "net_util.h"
 #include "socket_common.h"
+#include "tracepoint.h"
 #include "util.h"
 
-/** Offset calculated by the clock synchronization algorithm. */
+/**
+ * Offset calculated by the clock synchronization algorithm at the time of the local clock
+ * given by offset_reference_time. The offset changes from there at the rate offset_drift.
+ */
 interval_t _lf_clock_sync_offset = NSEC(0);
+/** Time of the local clock, without offset, at which the offset was _lf_clock_sync_offset. */
+static instant_t offset_reference_time = 0LL;
+/** Rate of change of the offset relative to the local clock, which compensates the drift of the local clock. */
+static double offset_drift = 0.0;
+/** Sequence number of the offset model, which is odd while the model is being updated. */
+static int64_t offset_sequence = 0LL;
 /** Offset used to test clock synchronization (clock sync should largely remove this offset). */
 interval_t _lf_clock_sync_constant_bias = NSEC(0);
 
@@ -54,11 +70,248 @@ instant_t _lf_last_clock_sync_instant = 0LL;
 int _lf_rti_socket_UDP = -1;
 
 /**
- * Atomically add an adjustment to the clock sync offset.
- * This needs to be atomic to be thread safe, particularly on 32-bit platforms.
+ * How long to wait, in milliseconds, for the kernel to timestamp a datagram that was sent.
  */
-static void adjust_lf_clock_sync_offset(interval_t adjustment) {
-  lf_atomic_fetch_add64(&_lf_clock_sync_offset, adjustment);
+#define CLOCK_SYNC_TX_TIMESTAMP_TIMEOUT_MS 1
+
+/**
+ * Whether the kernel timestamps the datagrams received and sent on _lf_rti_socket_UDP.
+ */
+static bool kernel_timestamps = false;
+
+/** The most recent offset samples, from which the drift of the local clock is estimated. */
+static offset_sample_t offset_samples[_LF_CLOCK_SYNC_DRIFT_WINDOW];
+
+/** Number of valid entries in offset_samples. */
+static int num_offset_samples = 0;
+
+/** Index in offset_samples of the next sample. */
+static int next_offset_sample = 0;
+
+/** Time of the local clock, without offset, at which T1 of the first exchange of the current sync window arrived. */
+static instant_t sync_window_start = 0LL;
+
+/** Partially computed average of the times at which T1 arrived in the current sync window, relative to its start. */
+static interval_t sync_window_elapsed_history = 0LL;
+
+/** Time of the local clock, without offset, at which the offset model was last updated, or NEVER. */
+static instant_t last_offset_model_update = NEVER;
+
+interval_t clock_sync_offset_at(instant_t local_time) {
+  int64_t sequence;
+  interval_t offset;
+  instant_t reference_time;
+  double drift;
+  do {
+    sequence = __atomic_load_n(&offset_sequence, __ATOMIC_ACQUIRE);
+    offset = __atomic_load_n(&_lf_clock_sync_offset, __ATOMIC_RELAXED);
+    reference_time = __atomic_load_n(&offset_reference_time, __ATOMIC_RELAXED);
+    __atomic_load(&offset_drift, &drift, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((sequence & 1) != 0 || sequence != __atomic_load_n(&offset_sequence, __ATOMIC_RELAXED));
+  if (drift == 0.0) {
+    return offset;
+  }
+  return offset + (interval_t)(drift * (double)(local_time - reference_time));
+}
+
+void clock_sync_set_offset_model(interval_t offset, instant_t reference_time, double drift) {
+  int64_t sequence = __atomic_load_n(&offset_sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&offset_sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&_lf_clock_sync_offset, offset, __ATOMIC_RELAXED);
+  __atomic_store_n(&offset_reference_time, reference_time, __ATOMIC_RELAXED);
+  __atomic_store(&offset_drift, &drift, __ATOMIC_RELAXED);
+  __atomic_store_n(&offset_sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Record the offset that the local clock should have had when T1 arrived in the current exchange.
+ * The offsets of a sync window are averaged in socket_stat->history.
+ * @param socket_stat The statistics of the connection to the RTI.
+ * @param estimated_clock_error The clock error estimated in the current exchange.
+ */
+static void record_offset_measurement(socket_stat_t* socket_stat, interval_t estimated_clock_error) {
+  instant_t local_time = socket_stat->local_physical_clock_snapshot_T2;
+  clock_sync_subtract_offset(&local_time);
+  if (socket_stat->received_T4_messages_in_current_sync_window == 1) {
+    sync_window_start = local_time;
+    sync_window_elapsed_history = 0LL;
+  }
+  socket_stat->history +=
+      (clock_sync_offset_at(local_time) + estimated_clock_error) / _LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL;
+  sync_window_elapsed_history += (local_time - sync_window_start) / _LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL;
+}
+
+/** Return the given drift limited to CLOCK_SYNC_MAX_DRIFT_PPM. */
+static double clamp_drift(double drift) {
+  double max_drift = CLOCK_SYNC_MAX_DRIFT_PPM / 1e6;
+  return LF_MIN(LF_MAX(drift, -max_drift), max_drift);
+}
+
+double clock_sync_estimate_drift(const offset_sample_t* samples, int count) {
+  if (count < 2) {
+    return 0.0;
+  }
+  // Compute relative to one sample to preserve precision.
+  offset_sample_t origin = samples[0];
+  double mean_time = 0.0, mean_offset = 0.0;
+  for (int i = 0; i < count; i++) {
+    mean_time += (double)(samples[i].local_time - origin.local_time) / count;
+    mean_offset += (double)(samples[i].offset - origin.offset) / count;
+  }
+  double covariance = 0.0, variance = 0.0;
+  for (int i = 0; i < count; i++) {
+    double time = (double)(samples[i].local_time - origin.local_time) - mean_time;
+    covariance += time * ((double)(samples[i].offset - origin.offset) - mean_offset);
+    variance += time * time;
+  }
+  if (variance <= 0.0) {
+    return 0.0;
+  }
+  return clamp_drift(covariance / variance);
+}
+
+/**
+ * Add the average offset of a completed sync window to the offset samples and update the model of the offset.
+ *
+ * The model follows the line fitted to the offset samples. A difference between the model and the
+ * line is corrected in full if `slew` is false. Otherwise, only the part of it given by
+ * _LF_CLOCK_SYNC_ATTENUATION is corrected, gradually over the duration of the previous sync window.
+ * @param socket_stat The statistics of the connection to the RTI.
+ * @param slew Whether to correct the offset gradually.
+ * @return The correction of the offset.
+ */
+static interval_t update_offset_model(socket_stat_t* socket_stat, bool slew) {
+  offset_sample_t sample = {.local_time = sync_window_start + sync_window_elapsed_history,
+                            .offset = socket_stat->history};
+  offset_samples[next_offset_sample] = sample;
+  next_offset_sample = (next_offset_sample + 1) % _LF_CLOCK_SYNC_DRIFT_WINDOW;
+  if (num_offset_samples < _LF_CLOCK_SYNC_DRIFT_WINDOW) {
+    num_offset_samples++;
+  }
+  double drift = clock_sync_estimate_drift(offset_samples, num_offset_samples);
+
+  instant_t now;
+  if (_lf_clock_gettime(&now) != 0) {
+    now = sample.local_time;
+  }
+  interval_t offset = clock_sync_offset_at(now);
+  interval_t correction = sample.offset + (interval_t)(drift * (double)(now - sample.local_time)) - offset;
+  if (!slew) {
+    clock_sync_set_offset_model(offset + correction, now, drift);
+  } else if (last_offset_model_update == NEVER || now <= last_offset_model_update) {
+    correction /= _LF_CLOCK_SYNC_ATTENUATION;
+    clock_sync_set_offset_model(offset + correction, now, drift);
+  } else {
+    // Slew by changing the drift for the duration of the previous sync window, within the bound on the drift.
+    interval_t elapsed = now - last_offset_model_update;
+    double slewed_drift = clamp_drift(drift + (double)(correction / _LF_CLOCK_SYNC_ATTENUATION) / (double)elapsed);
+    correction = (interval_t)((slewed_drift - drift) * (double)elapsed);
+    clock_sync_set_offset_model(offset, now, slewed_drift);
+  }
+  last_offset_model_update = now;
+  return correction;
+}
+
+#ifdef SO_TIMESTAMPING
+/**
+ * Return the physical time given by a kernel timestamp in a message received with recvmsg(), or NEVER if there is none.
+ * @param message The message.
+ */
+static instant_t kernel_timestamp(struct msghdr* message) {
+  for (struct cmsghdr* control = CMSG_FIRSTHDR(message); control != NULL; control = CMSG_NXTHDR(message, control)) {
+    if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPING) {
+      struct scm_timestamping timestamps;
+      memcpy(&timestamps, CMSG_DATA(control), sizeof(timestamps));
+      // The software timestamp is the first. It is taken from the same clock as lf_time_physical().
+      if (timestamps.ts[0].tv_sec == 0 && timestamps.ts[0].tv_nsec == 0) {
+        return NEVER;
+      }
+      instant_t result = (instant_t)timestamps.ts[0].tv_sec * BILLION + timestamps.ts[0].tv_nsec;
+      clock_sync_add_offset(&result);
+      return result;
+    }
+  }
+  return NEVER;
+}
+#endif // SO_TIMESTAMPING
+
+/**
+ * Read a datagram from a UDP socket, retrying if the read times out, and record when it arrived.
+ * If the kernel timestamps the datagrams, the time of arrival is that of the kernel timestamp.
+ * Otherwise, it is the physical time when the read returns.
+ * @param socket The UDP socket.
+ * @param buffer The buffer to read into.
+ * @param length The length of the datagram.
+ * @param address Where to record the address of the sender, or NULL.
+ * @param address_length The length of address, which is updated to the length of the address of the sender.
+ * @param receive_time Where to record the physical time of arrival of the datagram.
+ * @return The number of bytes read, which is less than `length` if reading failed.
+ */
+static ssize_t read_datagram(int socket, unsigned char* buffer, size_t length, struct sockaddr_in* address,
+                             socklen_t* address_length, instant_t* receive_time) {
+  struct iovec vector = {.iov_base = buffer, .iov_len = length};
+#ifdef SO_TIMESTAMPING
+  char control[CMSG_SPACE(sizeof(struct scm_timestamping))];
+#else
+  char control[1];
+#endif
+  struct msghdr message = {.msg_name = address, .msg_iov = &vector, .msg_iovlen = 1, .msg_control = control};
+  ssize_t bytes_read;
+  do {
+    message.msg_namelen = address != NULL ? *address_length : 0;
+    message.msg_controllen = kernel_timestamps ? sizeof(control) : 0;
+    bytes_read = recvmsg(socket, &message, MSG_WAITALL);
+    // Try reading again if errno indicates the need to try again.
+  } while (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+  *receive_time = lf_time_physical();
+#ifdef SO_TIMESTAMPING
+  if (kernel_timestamps && bytes_read > 0) {
+    instant_t timestamp = kernel_timestamp(&message);
+    if (timestamp != NEVER) {
+      *receive_time = timestamp;
+    }
+  }
+#endif // SO_TIMESTAMPING
+  if (address != NULL) {
+    *address_length = message.msg_namelen;
+  }
+  return bytes_read;
+}
+
+/**
+ * Return the physical time at which the last datagram sent on a UDP socket left, if the kernel
+ * timestamped it after a given time, or NEVER otherwise.
+ * @param socket The UDP socket.
+ * @param not_before The time before which a timestamp belongs to an earlier datagram.
+ */
+static instant_t transmit_time(int socket, instant_t not_before) {
+  instant_t result = NEVER;
+#ifdef SO_TIMESTAMPING
+  if (!kernel_timestamps) {
+    return NEVER;
+  }
+  // The timestamp is queued on the error queue of the socket, usually before the send returns.
+  struct pollfd descriptor = {.fd = socket, .events = 0};
+  if (poll(&descriptor, 1, CLOCK_SYNC_TX_TIMESTAMP_TIMEOUT_MS) <= 0) {
+    return NEVER;
+  }
+  // Drain the error queue, keeping the timestamp of the datagram sent last.
+  char control[CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(struct sock_extended_err))];
+  struct msghdr message = {.msg_control = control, .msg_controllen = sizeof(control)};
+  while (recvmsg(socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0) {
+    instant_t timestamp = kernel_timestamp(&message);
+    if (timestamp >= not_before) {
+      result = timestamp;
+    }
+    message.msg_controllen = sizeof(control);
+  }
+#else
+  (void)socket;
+  (void)not_before;
+#endif // SO_TIMESTAMPING
+  return result;
 }
 
 #ifdef _LF_CLOCK_SYNC_COLLECT_STATS
@@ -164,6 +417,17 @@ uint16_t setup_clock_synchronization_with_rti() {
   if (setsockopt(_lf_rti_socket_UDP, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout_time, sizeof(timeout_time)) < 0) {
     lf_print_error("Failed to set SO_SNDTIMEO option on the socket: %s.", strerror(errno));
   }
+#ifdef SO_TIMESTAMPING
+  // Have the kernel timestamp the clock sync messages, so that scheduling delays do not affect the estimated offset.
+  int timestamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                     SOF_TIMESTAMPING_OPT_TSONLY;
+  if (setsockopt(_lf_rti_socket_UDP, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping)) < 0) {
+    LF_PRINT_LOG("Clock sync: Kernel timestamps are not available: %s. Using user-space timestamps.",
+                 strerror(errno));
+  } else {
+    kernel_timestamps = true;
+  }
+#endif // SO_TIMESTAMPING
 #elif (LF_CLOCK_SYNC == LF_CLOCK_SYNC_INIT)
   port_to_return = 0u;
 #endif // (LF_CLOCK_SYNC >= LF_CLOCK_SYNC_ON)
@@ -172,6 +436,7 @@ uint16_t setup_clock_synchronization_with_rti() {
 
 void synchronize_initial_physical_clock_with_rti(net_abstraction_t rti_net) {
   LF_PRINT_DEBUG("Waiting for initial clock synchronization messages from the RTI.");
+  instant_t sync_start = lf_time_physical();
 
   size_t message_size = 1 + sizeof(instant_t);
   unsigned char buffer[message_size];
@@ -210,6 +475,7 @@ void synchronize_initial_physical_clock_with_rti(net_abstraction_t rti_net) {
     handle_T4_clock_sync_message(buffer, (void*)rti_net, receive_time, TCP);
   }
 
+  tracepoint_startup_phase(startup_clock_sync, _lf_my_fed_id, -1, sync_start);
   LF_PRINT_LOG("Finished initial clock synchronization with the RTI.");
 }
 
@@ -245,7 +511,16 @@ int handle_T1_clock_sync_message(unsigned char* buffer, void* socket_or_net, ins
   // Measure the time _after_ the write on the assumption that the read
   // from the socket, which occurs before this function is called, takes
   // about the same amount of time as the write of the reply.
-  _lf_rti_socket_stat.local_delay = lf_time_physical() - t2;
+  // If the kernel timestamps datagrams, t2 is the time of arrival of T1 and
+  // the time at which the reply left is available as well.
+  instant_t t3 = lf_time_physical();
+  if (socket_type == UDP) {
+    instant_t sent = transmit_time(*(int*)socket_or_net, t2);
+    if (sent != NEVER) {
+      t3 = sent;
+    }
+  }
+  _lf_rti_socket_stat.local_delay = t3 - t2;
   return 0;
 }
 
@@ -276,19 +551,16 @@ void handle_T4_clock_sync_message(unsigned char* buffer, void* socket_or_net, in
       (_lf_rti_socket_stat.local_physical_clock_snapshot_T2 - _lf_rti_socket_stat.remote_physical_clock_snapshot_T1);
   LF_PRINT_DEBUG("Clock sync: Estimated clock error: " PRINTF_TIME ".", estimated_clock_error);
 
-  // The adjustment to the clock offset (to be calculated)
-  interval_t adjustment = 0;
   // If the socket is _lf_rti_socket_UDP, then
   // after sending T4, the RTI sends a "coded probe" message,
   // which can be used to filter out noise.
   if (socket_type == UDP) {
     // Read the coded probe message.
     // We can reuse the same buffer.
-    int read_failed = read_from_socket(*(int*)socket_or_net, 1 + sizeof(instant_t), buffer);
+    instant_t r5;
+    ssize_t bytes_read = read_datagram(*(int*)socket_or_net, buffer, 1 + sizeof(instant_t), NULL, NULL, &r5);
 
-    instant_t r5 = lf_time_physical();
-
-    if (read_failed || buffer[0] != MSG_TYPE_CLOCK_SYNC_CODED_PROBE) {
+    if (bytes_read < (ssize_t)(1 + sizeof(instant_t)) || buffer[0] != MSG_TYPE_CLOCK_SYNC_CODED_PROBE) {
       lf_print_warning("Clock sync: Did not get the expected coded probe message from the RTI. "
                        "Skipping clock synchronization round.");
       return;
@@ -316,25 +588,14 @@ void handle_T4_clock_sync_message(unsigned char* buffer, void* socket_or_net, in
       return;
     }
   }
-  // If use UDP, apply a jitter attenuator to the estimated clock error to prevent
-  // large jumps in the underlying clock.
-  // Note that estimated_clock_error is calculated using lf_time_physical() which includes
-  // the clock sync adjustment.
-  // Use of TCP socket means we are in the startup phase, so
-  // rather than adjust the clock offset, we simply set it to the
-  // estimated error.
-  adjustment = (socket_type == UDP) ? estimated_clock_error / _LF_CLOCK_SYNC_ATTENUATION : estimated_clock_error;
-
 #ifdef _LF_CLOCK_SYNC_COLLECT_STATS // Enabled by default
   // Update RTI's socket stats
   update_socket_stat(&_lf_rti_socket_stat, network_round_trip_delay, estimated_clock_error);
 #endif // _LF_CLOCK_SYNC_COLLECT_STATS
 
-  // FIXME: Enable alternative regression mechanism here.
-  LF_PRINT_DEBUG("Clock sync: Adjusting clock offset running average by " PRINTF_TIME ".",
-                 adjustment / _LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL);
-  // Calculate the running average
-  _lf_rti_socket_stat.history += adjustment / _LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL;
+  // Note that estimated_clock_error is calculated using lf_time_physical() which includes
+  // the clock sync offset, so add the offset to get the offset the local clock should have had.
+  record_offset_measurement(&_lf_rti_socket_stat, estimated_clock_error);
 
   if (_lf_rti_socket_stat.received_T4_messages_in_current_sync_window >= _LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL) {
 
@@ -354,18 +615,22 @@ void handle_T4_clock_sync_message(unsigned char* buffer, void* socket_or_net, in
 #endif // _LF_CLOCK_SYNC_COLLECT_STATS
     // The number of received T4 messages has reached _LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL
     // which means we can now adjust the clock offset.
-    // For the AVG algorithm, history is a running average and can be directly
-    // applied.
-    adjust_lf_clock_sync_offset(_lf_rti_socket_stat.history);
+    // If use UDP, attenuate the correction and apply it gradually to prevent
+    // jumps in the underlying clock.
+    // Use of TCP socket means we are in the startup phase, so
+    // rather than adjust the clock offset gradually, we simply correct it in full.
+    interval_t adjustment = update_offset_model(&_lf_rti_socket_stat, socket_type == UDP);
     // @note AVG and SD will be zero if _LF_CLOCK_SYNC_COLLECT_STATS is set to false
     LF_PRINT_LOG("Clock sync:"
                  " New offset: " PRINTF_TIME "."
+                 " Adjustment: " PRINTF_TIME "."
+                 " Drift: %.3f ppm."
                  " Round trip delay to RTI (now): " PRINTF_TIME "."
                  " (AVG): " PRINTF_TIME "."
                  " (SD): " PRINTF_TIME "."
                  " Local round trip delay: " PRINTF_TIME ".",
-                 _lf_clock_sync_offset, network_round_trip_delay, stats.average, stats.standard_deviation,
-                 _lf_rti_socket_stat.local_delay);
+                 _lf_clock_sync_offset, adjustment, offset_drift * 1e6, network_round_trip_delay, stats.average,
+                 stats.standard_deviation, _lf_rti_socket_stat.local_delay);
     // Reset the stats
     reset_socket_stat(&_lf_rti_socket_stat);
     // Set the last instant at which the clocks were synchronized
@@ -395,24 +660,10 @@ static void* listen_to_rti_UDP_thread(void* args) {
   while (1) {
     struct sockaddr_in RTI_UDP_addr;
     socklen_t RTI_UDP_addr_length = sizeof(RTI_UDP_addr);
-    ssize_t bytes_read = 0;
-    // Read from the UDP socket
-    do {
-      ssize_t bytes = recvfrom(_lf_rti_socket_UDP,                // The UDP socket
-                               &buffer[bytes_read],               // The buffer to read into
-                               message_size - (size_t)bytes_read, // Number of bytes to read
-                               MSG_WAITALL,                       // Read the entire datagram
-                               (struct sockaddr*)&RTI_UDP_addr,   // Record the RTI's address
-                               &RTI_UDP_addr_length);             // The RTI's address length
-      // Try reading again if errno indicates the need to try again and there are more
-      // bytes to read.
-      if (bytes > 0) {
-        bytes_read += bytes;
-      }
-    } while ((errno == EAGAIN || errno == EWOULDBLOCK) && bytes_read < (ssize_t)message_size);
-
-    // Get local physical time before doing anything else.
-    instant_t receive_time = lf_time_physical();
+    // Read from the UDP socket, recording the RTI's address and the local physical time of arrival.
+    instant_t receive_time;
+    ssize_t bytes_read =
+        read_datagram(_lf_rti_socket_UDP, buffer, message_size, &RTI_UDP_addr, &RTI_UDP_addr_length, &receive_time);
 
     if (bytes_read < (ssize_t)message_size) {
       // Either the socket has closed or the RTI has sent EOF.
@@ -470,11 +721,11 @@ static void* listen_to_rti_UDP_thread(void* args) {
 // just empty implementations that should be optimized away.
 #if (LF_CLOCK_SYNC >= LF_CLOCK_SYNC_INIT)
 void clock_sync_add_offset(instant_t* t) {
-  *t = lf_time_add(*t, (_lf_clock_sync_offset + _lf_clock_sync_constant_bias));
+  *t = lf_time_add(*t, (clock_sync_offset_at(*t) + _lf_clock_sync_constant_bias));
 }
 
 void clock_sync_subtract_offset(instant_t* t) {
-  *t = lf_time_add(*t, -(_lf_clock_sync_offset + _lf_clock_sync_constant_bias));
+  *t = lf_time_add(*t, -(clock_sync_offset_at(*t) + _lf_clock_sync_constant_bias));
 }
 
 void clock_sync_set_constant_bias(interval_t offset) { _lf_clock_sync_constant_bias = offset; }
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Compression of the payloads of tagged messages.
+ *
+ * See @ref compression.h for docs.
+ */
+
+#if defined(FEDERATED) && defined(FEDERATED_COMPRESSION)
+#include <limits.h>
+#include <stdbool.h>
+#include <time.h>
+
+#if defined(FEDERATED_COMPRESSION_LZ4)
+#include <lz4.h>
+#elif defined(FEDERATED_COMPRESSION_ZSTD)
+#include <zstd.h>
+#elif defined(FEDERATED_COMPRESSION_ZLIB)
+#include <zlib.h>
+#else
+#error "FEDERATED_COMPRESSION must be LZ4, ZSTD, or ZLIB."
+#endif
+
+#include "compression.h"
+#include "metrics.h"
+
+#ifdef LF_METRICS
+/** Return the CPU time consumed by the calling thread. */
+static interval_t thread_cpu_time(void) {
+  struct timespec now;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+    return 0;
+  }
+  return (interval_t)now.tv_sec * BILLION + now.tv_nsec;
+}
+#endif // LF_METRICS
+
+size_t lf_compression_bound(size_t length) {
+#if defined(FEDERATED_COMPRESSION_LZ4)
+  return length <= LZ4_MAX_INPUT_SIZE ? (size_t)LZ4_compressBound((int)length) : 0;
+#elif defined(FEDERATED_COMPRESSION_ZSTD)
+  return ZSTD_compressBound(length);
+#else
+  return (size_t)compressBound((uLong)length);
+#endif
+}
+
+int lf_compress_payload(const unsigned char* payload, size_t length, unsigned char* compressed,
+                        size_t* compressed_length) {
+#ifdef LF_METRICS
+  interval_t cpu_start = thread_cpu_time();
+#endif
+  size_t capacity = lf_compression_bound(length);
+  size_t result = 0;
+#if defined(FEDERATED_COMPRESSION_LZ4)
+  if (capacity > 0) {
+    int written = LZ4_compress_default((const char*)payload, (char*)compressed, (int)length, (int)capacity);
+    result = written > 0 ? (size_t)written : 0;
+  }
+#elif defined(FEDERATED_COMPRESSION_ZSTD)
+  result = ZSTD_compress(compressed, capacity, payload, length, 1);
+  if (ZSTD_isError(result)) {
+    result = 0;
+  }
+#else
+  uLongf written = (uLongf)capacity;
+  if (compress2(compressed, &written, payload, (uLong)length, 1) == Z_OK) {
+    result = (size_t)written;
+  }
+#endif
+  bool smaller = result > 0 && result < length && lf_compression_ratio_allowed(length, result);
+#ifdef LF_METRICS
+  // A payload that does not get smaller is sent as is, so it counts as not compressed at all.
+  _lf_metrics_message_compressed(length, smaller ? result : length, thread_cpu_time() - cpu_start);
+#endif
+  if (!smaller) {
+    return -1;
+  }
+  *compressed_length = result;
+  return 0;
+}
+
+int lf_decompress_payload(const unsigned char* compressed, size_t compressed_length, unsigned char* payload,
+                          size_t length) {
+#ifdef LF_METRICS
+  interval_t cpu_start = thread_cpu_time();
+#endif
+  size_t result = 0;
+#if defined(FEDERATED_COMPRESSION_LZ4)
+  if (compressed_length <= INT_MAX && length <= INT_MAX) {
+    int written = LZ4_decompress_safe((const char*)compressed, (char*)payload, (int)compressed_length, (int)length);
+    result = written >= 0 ? (size_t)written : SIZE_MAX;
+  }
+#elif defined(FEDERATED_COMPRESSION_ZSTD)
+  result = ZSTD_decompress(payload, length, compressed, compressed_length);
+  if (ZSTD_isError(result)) {
+    result = SIZE_MAX;
+  }
+#else
+  uLongf written = (uLongf)length;
+  result = uncompress(payload, &written, compressed, (uLong)compressed_length) == Z_OK ? (size_t)written : SIZE_MAX;
+#endif
+  if (result != length) {
+    return -1;
+  }
+#ifdef LF_METRICS
+  _lf_metrics_message_decompressed(thread_cpu_time() - cpu_start);
+#endif
+  return 0;
+}
+
+#endif // FEDERATED && FEDERATED_COMPRESSION
@@ -21,10 +21,14 @@
 #include <strings.h> // Defines bzero().
 
 #include "clock-sync.h"
+#include "arrival_lag.h"
+#include "compression.h"
 #include "federate.h"
+#include "metrics.h"
 #include "net_common.h"
 #include "net_util.h"
 #include "net_abstraction.h"
+#include "payload_pool.h"
 #include "reactor.h"
 #include "reactor_common.h"
 #include "reactor_threaded.h"
@@ -46,6 +50,12 @@ extern bool _lf_termination_executed;
 // Global variables references in federate.h
 lf_mutex_t lf_outbound_net_mutex;
 
+/**
+ * Mutex held while querying the RTI for the address of a remote federate, which
+ * lf_connect_to_federate_async() may do from several threads at once.
+ */
+static lf_mutex_t address_query_mutex;
+
 lf_cond_t lf_port_status_changed;
 
 /**
@@ -83,6 +93,8 @@ federate_instance_t _fed = {.number_of_inbound_p2p_connections = 0,
                             .last_DNET = {.time = NEVER, .microstep = 0u},
                             .received_stop_request_from_rti = false,
                             .last_sent_LTC = {.time = NEVER, .microstep = 0u},
+                            .pending_LTC = {.time = NEVER, .microstep = 0u},
+                            .RTI_accepts_NMR = false,
                             .last_sent_NET = {.time = NEVER, .microstep = 0u},
                             .last_skipped_NET = {.time = NEVER, .microstep = 0u},
                             .min_delay_from_physical_action_to_federate_output = NEVER};
@@ -116,6 +128,23 @@ static void send_time(unsigned char type, instant_t time) {
   LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
 }
 
+/**
+ * Return the network abstraction on which to send a tag coordination message to the RTI. If this
+ * is the control lane, append to the message its data fence, the number of fenced messages sent to
+ * the RTI so far (@see MSG_TYPE_CONTROL_LANE).
+ * This assumes the caller holds the lf_outbound_net_mutex.
+ * @param buffer The message, with room for the fence after it.
+ * @param length Pointer to the length of the message, which is updated to include the fence.
+ */
+static net_abstraction_t net_for_control_message_locked(unsigned char* buffer, size_t* length) {
+  if (_fed.net_control_to_RTI == NULL) {
+    return _fed.net_to_RTI;
+  }
+  encode_int64(_fed.fenced_messages_to_RTI, &buffer[*length]);
+  *length += CONTROL_LANE_FENCE_LENGTH;
+  return _fed.net_control_to_RTI;
+}
+
 /**
  * Send a tag to the RTI.
  * This function acquires the lf_outbound_net_mutex.
@@ -125,7 +154,7 @@ static void send_time(unsigned char type, instant_t time) {
 static void send_tag(unsigned char type, tag_t tag) {
   LF_PRINT_DEBUG("Sending tag " PRINTF_TAG " to the RTI.", tag.time - start_time, tag.microstep);
   size_t bytes_to_write = 1 + sizeof(instant_t) + sizeof(microstep_t);
-  unsigned char buffer[bytes_to_write];
+  unsigned char buffer[bytes_to_write + CONTROL_LANE_FENCE_LENGTH];
   buffer[0] = type;
   encode_tag(&(buffer[1]), tag);
 
@@ -133,11 +162,143 @@ static void send_tag(unsigned char type, tag_t tag) {
   // Trace the event when tracing is enabled
   tracepoint_federate_to_rti(event_type, _lf_my_fed_id, &tag);
   LF_MUTEX_LOCK(&lf_outbound_net_mutex);
-  write_to_net_fail_on_error(_fed.net_to_RTI, bytes_to_write, buffer, &lf_outbound_net_mutex,
+  net_abstraction_t net = net_for_control_message_locked(buffer, &bytes_to_write);
+  write_to_net_fail_on_error(net, bytes_to_write, buffer, &lf_outbound_net_mutex,
                              "Failed to send tag " PRINTF_TAG " to the RTI.", tag.time - start_time, tag.microstep);
   LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
 }
 
+/**
+ * Send a next event tag (NET) to the RTI. If lf_latest_tag_confirmed() has left an LTC pending,
+ * send both in one next message request (NMR).
+ * This function acquires the lf_outbound_net_mutex.
+ * @param tag The next event tag.
+ */
+static void send_next_event_tag_to_RTI(tag_t tag) {
+  LF_PRINT_DEBUG("Sending next event tag " PRINTF_TAG " to the RTI.", tag.time - start_time, tag.microstep);
+  unsigned char buffer[MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH + CONTROL_LANE_FENCE_LENGTH];
+  size_t bytes_to_write = 1 + sizeof(instant_t) + sizeof(microstep_t);
+  buffer[0] = MSG_TYPE_NEXT_EVENT_TAG;
+  LF_MUTEX_LOCK(&lf_outbound_net_mutex);
+  tag_t completed = _fed.pending_LTC;
+  if (lf_tag_compare(completed, NEVER_TAG) != 0) {
+    _fed.pending_LTC = NEVER_TAG;
+    bytes_to_write = MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH;
+    buffer[0] = MSG_TYPE_NEXT_MESSAGE_REQUEST;
+    encode_tag(&(buffer[1]), completed);
+    encode_tag(&(buffer[1 + sizeof(instant_t) + sizeof(microstep_t)]), tag);
+    tracepoint_federate_to_rti(send_LTC, _lf_my_fed_id, &completed);
+  } else {
+    encode_tag(&(buffer[1]), tag);
+  }
+  tracepoint_federate_to_rti(send_NET, _lf_my_fed_id, &tag);
+  net_abstraction_t net = net_for_control_message_locked(buffer, &bytes_to_write);
+  write_to_net_fail_on_error(net, bytes_to_write, buffer, &lf_outbound_net_mutex,
+                             "Failed to send next event tag " PRINTF_TAG " to the RTI.", tag.time - start_time,
+                             tag.microstep);
+  LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+}
+
+/**
+ * Send the LTC that lf_latest_tag_confirmed() has left pending, if any, without waiting for a NET.
+ * This function acquires the lf_outbound_net_mutex.
+ */
+static void send_pending_LTC() {
+  LF_MUTEX_LOCK(&lf_outbound_net_mutex);
+  tag_t completed = _fed.pending_LTC;
+  if (lf_tag_compare(completed, NEVER_TAG) != 0) {
+    _fed.pending_LTC = NEVER_TAG;
+    size_t bytes_to_write = 1 + sizeof(instant_t) + sizeof(microstep_t);
+    unsigned char buffer[bytes_to_write + CONTROL_LANE_FENCE_LENGTH];
+    buffer[0] = MSG_TYPE_LATEST_TAG_CONFIRMED;
+    encode_tag(&(buffer[1]), completed);
+    tracepoint_federate_to_rti(send_LTC, _lf_my_fed_id, &completed);
+    net_abstraction_t net = net_for_control_message_locked(buffer, &bytes_to_write);
+    write_to_net_fail_on_error(net, bytes_to_write, buffer, &lf_outbound_net_mutex,
+                               "Failed to send tag " PRINTF_TAG " to the RTI.", completed.time - start_time,
+                               completed.microstep);
+  }
+  LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+}
+
+/**
+ * The fenced messages received from the RTI, which the grants on the control lane wait for.
+ * @see MSG_TYPE_CONTROL_LANE
+ */
+static struct {
+  /** Mutex protecting the other fields. */
+  lf_mutex_t mutex;
+  /** Condition signaled when a fenced message is received or the connection to the RTI is closed. */
+  lf_cond_t changed;
+  /** The greatest tag granted on the control lane so far. */
+  tag_t fence_tag;
+  /** The number of fenced messages received that are stop messages or have a tag no later than fence_tag. */
+  int64_t received;
+  /** The tags of the fenced messages received with a tag later than fence_tag. */
+  pqueue_tag_t* later_tags;
+  /** Whether the connection to the RTI is closed, so no more fenced messages will be received. */
+  bool closed;
+} fenced_messages_from_RTI;
+
+/**
+ * Record that a fenced message has been received from the RTI, if there is a control lane.
+ * @param tag The tag of the message, or NEVER_TAG for a stop message.
+ */
+static void count_fenced_message_from_RTI(tag_t tag) {
+  if (_fed.net_control_to_RTI == NULL) {
+    return;
+  }
+  LF_MUTEX_LOCK(&fenced_messages_from_RTI.mutex);
+  if (lf_tag_compare(tag, fenced_messages_from_RTI.fence_tag) <= 0) {
+    fenced_messages_from_RTI.received++;
+    lf_cond_broadcast(&fenced_messages_from_RTI.changed);
+  } else {
+    pqueue_tag_insert_tag(fenced_messages_from_RTI.later_tags, tag);
+  }
+  LF_MUTEX_UNLOCK(&fenced_messages_from_RTI.mutex);
+}
+
+/**
+ * Record that no more fenced messages will be received from the RTI, releasing any grant waiting for them.
+ */
+static void close_fenced_messages_from_RTI() {
+  if (_fed.net_control_to_RTI == NULL) {
+    return;
+  }
+  LF_MUTEX_LOCK(&fenced_messages_from_RTI.mutex);
+  fenced_messages_from_RTI.closed = true;
+  lf_cond_broadcast(&fenced_messages_from_RTI.changed);
+  LF_MUTEX_UNLOCK(&fenced_messages_from_RTI.mutex);
+}
+
+/**
+ * If a grant of the given tag has been read from the control lane, read its data fence and wait
+ * until the fenced messages that the RTI sent before it have been received.
+ * @param net The network abstraction from which the grant has been read.
+ * @param tag The granted tag.
+ */
+static void wait_for_data_fence(net_abstraction_t net, tag_t tag) {
+  if (net != _fed.net_control_to_RTI) {
+    return;
+  }
+  unsigned char buffer[CONTROL_LANE_FENCE_LENGTH];
+  read_from_net_fail_on_error(net, CONTROL_LANE_FENCE_LENGTH, buffer, "Failed to read the data fence of a grant.");
+  int64_t fence = extract_int64(buffer);
+  LF_MUTEX_LOCK(&fenced_messages_from_RTI.mutex);
+  if (lf_tag_compare(tag, fenced_messages_from_RTI.fence_tag) > 0) {
+    fenced_messages_from_RTI.fence_tag = tag;
+    while (pqueue_tag_size(fenced_messages_from_RTI.later_tags) > 0 &&
+           lf_tag_compare(pqueue_tag_peek_tag(fenced_messages_from_RTI.later_tags), tag) <= 0) {
+      pqueue_tag_pop_tag(fenced_messages_from_RTI.later_tags);
+      fenced_messages_from_RTI.received++;
+    }
+  }
+  while (fenced_messages_from_RTI.received < fence && !fenced_messages_from_RTI.closed) {
+    lf_cond_wait(&fenced_messages_from_RTI.changed);
+  }
+  LF_MUTEX_UNLOCK(&fenced_messages_from_RTI.mutex);
+}
+
 /**
  * Return true if either the network abstraction to the RTI is broken or the network abstraction is
  * alive and the first unread byte on the network abstraction's queue is MSG_TYPE_FAILED.
@@ -174,6 +335,35 @@ static lf_action_base_t* action_for_port(int port_id) {
   return NULL;
 }
 
+/**
+ * A payload pool registered for a network input port together with the token type of payloads
+ * taken from it, which is that of the port's action except that its destructor returns the payload
+ * to the pool.
+ */
+typedef struct port_payload_pool_t {
+  lf_payload_pool_t* pool;
+  token_type_t type;
+} port_payload_pool_t;
+
+/**
+ * Payload pools registered for network input ports, indexed by port ID. This is allocated in
+ * lf_connect_to_rti(). The pool of each entry is published with release semantics after its type
+ * is set because the threads listening to the RTI and to other federates read it without a lock.
+ */
+static port_payload_pool_t* payload_pools = NULL;
+
+/**
+ * Return the payload pool registered for the specified port or NULL if there is none.
+ * @param port_id The port ID.
+ */
+static port_payload_pool_t* payload_pool_for_port(int port_id) {
+  if (payload_pools == NULL || port_id < 0 || ((size_t)port_id) >= _lf_action_table_size ||
+      __atomic_load_n(&payload_pools[port_id].pool, __ATOMIC_ACQUIRE) == NULL) {
+    return NULL;
+  }
+  return &payload_pools[port_id];
+}
+
 /**
  * Update the last known status tag of all network input ports
  * to the value of `tag`, unless that the provided `tag` is less
@@ -233,9 +423,8 @@ static void update_last_known_status_on_input_ports(tag_t tag, environment_t* en
  * once during an execution of a logical tag.
  *
  * This function is called when a message or absent message arrives. For decentralized
- * coordination, it is also called by the background thread update_ports_from_staa_offsets
- * which uses physical time to determine when an input port can be assumed to be absent
- * if a message has not been received.
+ * coordination, it is also called by a worker waiting for the port, which uses physical time
+ * to determine when an input port can be assumed to be absent if a message has not been received.
  *
  * This function assumes the caller holds the mutex on the top-level environment,
  * and, if the tag actually increases, it broadcasts on `lf_port_status_changed`.
@@ -479,11 +668,122 @@ static int handle_message(net_abstraction_t net, int fed_id) {
   return 0;
 }
 
+#ifdef FEDERATED_DECENTRALIZED
 /**
- * Handle a tagged message being received from a remote federate via the RTI
- * or directly from other federates.
- * This will read the tag encoded in the header
- * and calculate an offset to pass to the schedule function.
+ * @brief Return the port ID of the port associated with the given action.
+ * @return The port ID or -1 if there is no match.
+ */
+static int id_of_action(lf_action_base_t* input_port_action) {
+  for (size_t i = 0; i < _lf_action_table_size; i++) {
+    if (_lf_action_table[i] == input_port_action)
+      return i;
+  }
+  return -1;
+}
+#endif // FEDERATED_DECENTRALIZED
+
+#if defined(FEDERATED_DECENTRALIZED) && defined(FEDERATED_ADAPTIVE_STAA)
+#ifndef FEDERATED_ADAPTIVE_STAA_MIN
+#define FEDERATED_ADAPTIVE_STAA_MIN 0
+#endif
+#ifndef FEDERATED_ADAPTIVE_STAA_MAX
+#define FEDERATED_ADAPTIVE_STAA_MAX SEC(1)
+#endif
+
+/** Whether the estimates of the arrival lag have been initialized. */
+static bool adaptive_staa_initialized = false;
+
+/** Estimates of the arrival lag over all ports and over the ports of each element of staa_lst. */
+static arrival_lag_t arrival_lag;
+
+/** For each port ID, the index of the element of staa_lst that holds the port or -1 if there is none. */
+static int* staa_index_of_port = NULL;
+
+/** For each element of staa_lst, the IDs of its ports, in the order of its actions, or -1 for an unknown action. */
+static int** staa_port_ids = NULL;
+
+/**
+ * @brief Initialize the estimates of the arrival lag from the STA and STAA offsets the federate was given.
+ *
+ * This must be called with the top-level environment mutex held.
+ */
+static void initialize_adaptive_staa_locked(void) {
+  if (!(FEDERATED_ADAPTIVE_STAA > 0.0 && FEDERATED_ADAPTIVE_STAA < 1.0)) {
+    lf_print_error_and_exit("FEDERATED_ADAPTIVE_STAA must be a fraction between 0 and 1, not %f.",
+                            (double)FEDERATED_ADAPTIVE_STAA);
+  }
+  arrival_lag.late_fraction = FEDERATED_ADAPTIVE_STAA;
+  arrival_lag.min = FEDERATED_ADAPTIVE_STAA_MIN;
+  arrival_lag.max = FEDERATED_ADAPTIVE_STAA_MAX;
+  arrival_lag.all_ports = arrival_lag_clamp(&arrival_lag, lf_fed_STA_offset);
+  arrival_lag.num_groups = staa_lst_size;
+  arrival_lag.groups = (interval_t*)calloc(LF_MAX(staa_lst_size, 1), sizeof(interval_t));
+  staa_index_of_port = (int*)malloc(LF_MAX(_lf_action_table_size, 1) * sizeof(int));
+  staa_port_ids = (int**)calloc(LF_MAX(staa_lst_size, 1), sizeof(int*));
+  LF_ASSERT_NON_NULL(arrival_lag.groups);
+  LF_ASSERT_NON_NULL(staa_index_of_port);
+  LF_ASSERT_NON_NULL(staa_port_ids);
+  for (size_t i = 0; i < _lf_action_table_size; i++) {
+    staa_index_of_port[i] = -1;
+  }
+  metrics_network_inputs_init(_lf_action_table_size);
+  for (size_t i = 0; i < staa_lst_size; i++) {
+    arrival_lag.groups[i] =
+        arrival_lag_clamp(&arrival_lag, lf_time_add(lf_fed_STA_offset, (interval_t)staa_lst[i]->STAA));
+    staa_port_ids[i] = (int*)malloc(LF_MAX(staa_lst[i]->num_actions, 1) * sizeof(int));
+    LF_ASSERT_NON_NULL(staa_port_ids[i]);
+    for (size_t j = 0; j < staa_lst[i]->num_actions; j++) {
+      int port_id = id_of_action(staa_lst[i]->actions[j]);
+      staa_port_ids[i][j] = port_id;
+      if (port_id >= 0) {
+        staa_index_of_port[port_id] = (int)i;
+        metrics_staa_set(port_id, (interval_t)staa_lst[i]->STAA);
+      }
+    }
+  }
+  adaptive_staa_initialized = true;
+}
+
+/**
+ * @brief Adapt the STA and the STAA offsets to the arrival of a message.
+ *
+ * The STA becomes the estimate for all ports and the STAA of each element of staa_lst becomes
+ * the estimate for its ports minus the STA, or zero if the STA is larger. The STAA offsets are
+ * adjusted in place, so staa_lst may no longer be sorted by them.
+ * This must be called with the top-level environment mutex held.
+ * @param port_id The port on which the message arrived.
+ * @param sample The physical time of arrival of the message minus its intended time.
+ */
+static void adapt_offsets_to_arrival_locked(int port_id, interval_t sample) {
+  if (!adaptive_staa_initialized) {
+    initialize_adaptive_staa_locked();
+  }
+  int index = (port_id >= 0 && (size_t)port_id < _lf_action_table_size) ? staa_index_of_port[port_id] : -1;
+  interval_t threshold = lf_fed_STA_offset;
+  if (index >= 0) {
+    threshold = lf_time_add(threshold, (interval_t)staa_lst[index]->STAA);
+  }
+  metrics_network_input_message(port_id, sample, sample > threshold);
+
+  arrival_lag_record(&arrival_lag, index, sample);
+  lf_fed_STA_offset = arrival_lag.all_ports;
+  metrics_sta_set(arrival_lag.all_ports);
+  for (size_t i = 0; i < staa_lst_size; i++) {
+    size_t staa = arrival_lag_staa(&arrival_lag, i);
+    if (staa != staa_lst[i]->STAA) {
+      staa_lst[i]->STAA = staa;
+      for (size_t j = 0; j < staa_lst[i]->num_actions; j++) {
+        metrics_staa_set(staa_port_ids[i][j], (interval_t)staa);
+      }
+    }
+  }
+}
+#endif // FEDERATED_DECENTRALIZED && FEDERATED_ADAPTIVE_STAA
+
+/**
+ * Receive the payload of a tagged message whose header has been read and
+ * schedule the message.
+ * This calculates an offset to pass to the schedule function.
  * This function assumes the caller does not hold the mutex lock.
  * Instead of holding the mutex lock, this function calls
  * _lf_increment_tag_barrier with the tag carried in
@@ -491,37 +791,30 @@ static int handle_message(net_abstraction_t net, int fed_id) {
  * will not advance to the tag of the message if it is in the future, or
  * the tag will not advance at all if the tag of the message is
  * now or in the past.
- * @param net Pointer to the network abstraction to read the message from.
+ * @param net Pointer to the network abstraction to read the payload from.
  * @param fed_id The sending federate ID or -1 if the centralized coordination.
+ * @param port_id The ID of the destination port.
+ * @param length The length of the payload.
+ * @param intended_tag The tag of the message.
  * @return 0 on successfully reading the message, -1 on failure (e.g. due to network abstraction closed).
  */
-static int handle_tagged_message(net_abstraction_t net, int fed_id) {
+static int receive_tagged_message(net_abstraction_t net, int fed_id, unsigned short port_id, size_t length,
+                                  tag_t intended_tag) {
   // Environment is always the one corresponding to the top-level scheduling enclave.
   environment_t* env;
   _lf_get_environments(&env);
 
-  // Read the header which contains the timestamp.
-  size_t bytes_to_read =
-      sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(instant_t) + sizeof(microstep_t);
-  unsigned char buffer[bytes_to_read];
-  if (read_from_net_close_on_error(net, bytes_to_read, buffer)) {
-    return -1; // Read failed.
-  }
+#ifdef FEDERATED_COMPRESSION
+  bool compressed = (port_id & COMPRESSED_PAYLOAD_PORT_FLAG) != 0;
+  port_id = (unsigned short)(port_id & ~COMPRESSED_PAYLOAD_PORT_FLAG);
+#endif
 
-  // Extract the header information.
-  unsigned short port_id;
-  unsigned short federate_id;
-  size_t length;
-  tag_t intended_tag;
-  extract_timed_header(buffer, &port_id, &federate_id, &length, &intended_tag);
   // Trace the event when tracing is enabled
   if (fed_id == -1) {
     tracepoint_federate_from_rti(receive_TAGGED_MSG, _lf_my_fed_id, &intended_tag);
   } else {
     tracepoint_federate_from_federate(receive_P2P_TAGGED_MSG, _lf_my_fed_id, fed_id, &intended_tag);
   }
-  // Check if the message is intended for this federate
-  assert(_lf_my_fed_id == federate_id);
   LF_PRINT_DEBUG("Receiving message to port %d of length %zu.", port_id, length);
 
   // Get the triggering action for the corresponding port
@@ -550,14 +843,70 @@ static int handle_tagged_message(net_abstraction_t net, int fed_id) {
                intended_tag.time - start_time, intended_tag.microstep, lf_time_logical_elapsed(env),
                env->current_tag.microstep);
 
+#ifdef FEDERATED_COMPRESSION
+  // A compressed payload is read in full and then decompressed into the buffer of the token.
+  unsigned char* compressed_payload = NULL;
+  size_t compressed_length = 0;
+  if (compressed) {
+    unsigned char uncompressed_length[COMPRESSED_PAYLOAD_HEADER_SIZE];
+    if (length <= COMPRESSED_PAYLOAD_HEADER_SIZE ||
+        read_from_net_close_on_error(net, COMPRESSED_PAYLOAD_HEADER_SIZE, uncompressed_length)) {
+#ifdef FEDERATED_DECENTRALIZED
+      _lf_decrement_tag_barrier_locked(env);
+#endif
+      return -1;
+    }
+    compressed_length = length - COMPRESSED_PAYLOAD_HEADER_SIZE;
+    length = (uint32_t)extract_int32(uncompressed_length);
+    if (!lf_compression_ratio_allowed(length, compressed_length)) {
+      lf_print_error("Received a compressed payload of %zu bytes for port %d claiming to expand to %zu bytes.",
+                     compressed_length, port_id, length);
+      close_net(net, false);
+#ifdef FEDERATED_DECENTRALIZED
+      _lf_decrement_tag_barrier_locked(env);
+#endif
+      return -1;
+    }
+    compressed_payload = (unsigned char*)malloc(compressed_length);
+    LF_ASSERT_NON_NULL(compressed_payload);
+    if (read_from_net_close_on_error(net, compressed_length, compressed_payload)) {
+      free(compressed_payload);
+#ifdef FEDERATED_DECENTRALIZED
+      _lf_decrement_tag_barrier_locked(env);
+#endif
+      return -1;
+    }
+  }
+#endif // FEDERATED_COMPRESSION
+
   // Read the payload.
-  // Allocate memory for the message contents.
-  unsigned char* message_contents = (unsigned char*)malloc(length);
-  if (read_from_net_close_on_error(net, length, message_contents)) {
+  // If the port has a payload pool, read directly into a buffer from the pool.
+  // Otherwise, or if the pool has no suitable buffer, allocate memory for the message contents.
+  token_type_t* token_type;
+  unsigned char* message_contents = (unsigned char*)lf_allocate_payload(port_id, length, &token_type);
+  int read_failed;
+#ifdef FEDERATED_COMPRESSION
+  if (compressed_payload != NULL) {
+    read_failed = lf_decompress_payload(compressed_payload, compressed_length, message_contents, length);
+    free(compressed_payload);
+    if (read_failed) {
+      lf_print_error("Received a malformed compressed payload for port %d.", port_id);
+    }
+  } else {
+    read_failed = read_from_net_close_on_error(net, length, message_contents);
+  }
+#else
+  read_failed = read_from_net_close_on_error(net, length, message_contents);
+#endif
+  if (read_failed) {
 #ifdef FEDERATED_DECENTRALIZED
     _lf_decrement_tag_barrier_locked(env);
 #endif
-    free(message_contents);
+    if (token_type == (token_type_t*)action) {
+      free(message_contents);
+    } else {
+      lf_payload_pool_release(message_contents);
+    }
     return -1; // Read failed.
   }
 
@@ -567,6 +916,9 @@ static int handle_tagged_message(net_abstraction_t net, int fed_id) {
   LF_MUTEX_LOCK(&env->mutex);
 
   action->trigger->physical_time_of_arrival = time_of_arrival;
+#if defined(FEDERATED_DECENTRALIZED) && defined(FEDERATED_ADAPTIVE_STAA)
+  adapt_offsets_to_arrival_locked(port_id, time_of_arrival - intended_tag.time);
+#endif
 
   // Create a token for the message
   size_t element_size = ((token_type_t*)action)->element_size;
@@ -585,7 +937,7 @@ static int handle_tagged_message(net_abstraction_t net, int fed_id) {
                        port_id, (size_t)length, element_size, element_count);
     }
   }
-  lf_token_t* message_token = _lf_new_token((token_type_t*)action, message_contents, element_count);
+  lf_token_t* message_token = _lf_new_token(token_type, message_contents, element_count);
 
   if (handle_message_now(env, action->trigger, intended_tag)) {
     // Since the message is intended for the current tag and a port absent reaction
@@ -678,27 +1030,49 @@ static int handle_tagged_message(net_abstraction_t net, int fed_id) {
 }
 
 /**
- * Handle a port absent message received from a remote federate.
- * This just sets the last known status tag of the port specified
- * in the message.
- *
- * @param net Pointer to the network abstraction to read the message from
+ * Handle a tagged message being received from a remote federate via the RTI
+ * or directly from other federates.
+ * This will read the tag encoded in the header and then the payload.
+ * This function assumes the caller does not hold the mutex lock.
+ * @param net Pointer to the network abstraction to read the message from.
  * @param fed_id The sending federate ID or -1 if the centralized coordination.
- * @return 0 for success, -1 for failure to complete the read.
+ * @return 0 on successfully reading the message, -1 on failure (e.g. due to network abstraction closed).
  */
-static int handle_port_absent_message(net_abstraction_t net, int fed_id) {
-  size_t bytes_to_read = sizeof(uint16_t) + sizeof(uint16_t) + sizeof(instant_t) + sizeof(microstep_t);
+static int handle_tagged_message(net_abstraction_t net, int fed_id) {
+  // Read the header which contains the timestamp.
+  size_t bytes_to_read =
+      sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(instant_t) + sizeof(microstep_t);
   unsigned char buffer[bytes_to_read];
   if (read_from_net_close_on_error(net, bytes_to_read, buffer)) {
-    return -1;
+    return -1; // Read failed.
   }
 
   // Extract the header information.
-  unsigned short port_id = extract_uint16(buffer);
-  // The next part of the message is the federate_id, but we don't need it.
-  // unsigned short federate_id = extract_uint16(&(buffer[sizeof(uint16_t)]));
-  tag_t intended_tag = extract_tag(&(buffer[sizeof(uint16_t) + sizeof(uint16_t)]));
+  unsigned short port_id;
+  unsigned short federate_id;
+  size_t length;
+  tag_t intended_tag;
+  extract_timed_header(buffer, &port_id, &federate_id, &length, &intended_tag);
+  // Check if the message is intended for this federate
+  assert(_lf_my_fed_id == federate_id);
+  if (receive_tagged_message(net, fed_id, port_id, length, intended_tag)) {
+    return -1;
+  }
+  if (fed_id == -1) {
+    count_fenced_message_from_RTI(intended_tag);
+  }
+  return 0;
+}
 
+/**
+ * Record that a port of this federate is absent at a tag.
+ * This just sets the last known status tag of the port.
+ *
+ * @param fed_id The sending federate ID or -1 if the centralized coordination.
+ * @param port_id The ID of the port.
+ * @param intended_tag The tag at which the port is absent.
+ */
+static void receive_port_absent(int fed_id, unsigned short port_id, tag_t intended_tag) {
   // Trace the event when tracing is enabled
   if (fed_id == -1) {
     tracepoint_federate_from_rti(receive_PORT_ABS, _lf_my_fed_id, &intended_tag);
@@ -715,7 +1089,106 @@ static int handle_port_absent_message(net_abstraction_t net, int fed_id) {
   LF_MUTEX_LOCK(&env->mutex);
   update_last_known_status_on_input_port(env, intended_tag, port_id, true);
   LF_MUTEX_UNLOCK(&env->mutex);
+}
+
+/**
+ * Handle a port absent message received from a remote federate.
+ * This just sets the last known status tag of the port specified
+ * in the message.
+ *
+ * @param net Pointer to the network abstraction to read the message from
+ * @param fed_id The sending federate ID or -1 if the centralized coordination.
+ * @return 0 for success, -1 for failure to complete the read.
+ */
+static int handle_port_absent_message(net_abstraction_t net, int fed_id) {
+  size_t bytes_to_read = sizeof(uint16_t) + sizeof(uint16_t) + sizeof(instant_t) + sizeof(microstep_t);
+  unsigned char buffer[bytes_to_read];
+  if (read_from_net_close_on_error(net, bytes_to_read, buffer)) {
+    return -1;
+  }
+
+  // Extract the header information.
+  unsigned short port_id = extract_uint16(buffer);
+  // The next part of the message is the federate_id, but we don't need it.
+  // unsigned short federate_id = extract_uint16(&(buffer[sizeof(uint16_t)]));
+  tag_t intended_tag = extract_tag(&(buffer[sizeof(uint16_t) + sizeof(uint16_t)]));
+
+  receive_port_absent(fed_id, port_id, intended_tag);
+  if (fed_id == -1) {
+    count_fenced_message_from_RTI(intended_tag);
+  }
+  return 0;
+}
+
+/**
+ * Reject a malformed batch of tagged messages. The rest of the stream cannot be parsed, so this
+ * closes the network abstraction, which tells the sending federate that its messages are no longer read.
+ * @param net The network abstraction from which the batch is being read.
+ * @param problem A description of what is malformed in the batch.
+ * @return -1.
+ */
+static int reject_tagged_message_batch(net_abstraction_t net, const char* problem) {
+  lf_print_error("Received a batch of tagged messages with %s. Closing the network abstraction.", problem);
+  close_net(net, false);
+  return -1;
+}
 
+/**
+ * Handle a batch of tagged messages and port absent messages with the same tag
+ * received directly from another federate (@see MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH).
+ * Each entry of the batch is handled in order, as if it had arrived as a message of its own.
+ *
+ * @param net Pointer to the network abstraction to read the batch from.
+ * @param fed_id The sending federate ID.
+ * @return 0 for success, -1 for failure to complete the read or a malformed batch, which
+ *  closes the network abstraction.
+ */
+static int handle_tagged_message_batch(net_abstraction_t net, int fed_id) {
+  unsigned char buffer[MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE - 1];
+  if (read_from_net_close_on_error(net, sizeof(buffer), buffer)) {
+    return -1;
+  }
+  unsigned short federate_id = extract_uint16(buffer);
+  size_t remaining = (uint32_t)extract_int32(&buffer[sizeof(uint16_t)]);
+  tag_t intended_tag = extract_tag(&buffer[sizeof(uint16_t) + sizeof(uint32_t)]);
+  // Check if the batch is intended for this federate
+  assert(_lf_my_fed_id == federate_id);
+  (void)federate_id;
+  LF_PRINT_DEBUG("Receiving a batch of %zu bytes with tag " PRINTF_TAG ".", remaining,
+                 intended_tag.time - start_time, intended_tag.microstep);
+
+  unsigned char entry[1 + sizeof(uint16_t) + sizeof(uint32_t)];
+  while (remaining > 0) {
+    if (remaining < 1 + sizeof(uint16_t)) {
+      return reject_tagged_message_batch(net, "an entry longer than the batch");
+    }
+    if (read_from_net_close_on_error(net, 1 + sizeof(uint16_t), entry)) {
+      return -1;
+    }
+    remaining -= 1 + sizeof(uint16_t);
+    unsigned short port_id = extract_uint16(&entry[1]);
+    if (entry[0] == MSG_TYPE_PORT_ABSENT) {
+      receive_port_absent(fed_id, port_id, intended_tag);
+    } else if (entry[0] == MSG_TYPE_P2P_TAGGED_MESSAGE) {
+      if (remaining < sizeof(uint32_t)) {
+        return reject_tagged_message_batch(net, "an entry longer than the batch");
+      }
+      if (read_from_net_close_on_error(net, sizeof(uint32_t), &entry[1 + sizeof(uint16_t)])) {
+        return -1;
+      }
+      remaining -= sizeof(uint32_t);
+      size_t length = (uint32_t)extract_int32(&entry[1 + sizeof(uint16_t)]);
+      if (remaining < length) {
+        return reject_tagged_message_batch(net, "a message longer than the batch");
+      }
+      if (receive_tagged_message(net, fed_id, port_id, length, intended_tag)) {
+        return -1;
+      }
+      remaining -= length;
+    } else {
+      return reject_tagged_message_batch(net, "an entry of erroneous type");
+    }
+  }
   return 0;
 }
 
@@ -786,6 +1259,28 @@ static void* listen_to_federates(void* _args) {
           net_closed = true;
         }
         break;
+      case MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH:
+        LF_PRINT_LOG("Received a batch of tagged messages from federate %d.", fed_id);
+        if (handle_tagged_message_batch(net, fed_id)) {
+          // As for single tagged messages, this is not a fatal error, but this thread should exit.
+          lf_print_warning("Failed to complete reading of a batch of tagged messages.");
+          net_closed = true;
+        }
+        break;
+      case MSG_TYPE_COMPRESSION:
+        // Accept the codec of the federate if it is the codec of this federate.
+        if (read_from_net_close_on_error(net, 1, &buffer[1])) {
+          net_closed = true;
+          break;
+        }
+        LF_PRINT_LOG("Received codec %u from federate %d.", buffer[1], fed_id);
+        if (buffer[1] != LF_COMPRESSION_CODEC) {
+          buffer[1] = COMPRESSION_CODEC_NONE;
+        }
+        if (write_to_net_close_on_error(net, 2, buffer)) {
+          net_closed = true;
+        }
+        break;
       default:
         bad_message = true;
       }
@@ -808,9 +1303,110 @@ static void* listen_to_federates(void* _args) {
   return NULL;
 }
 
+#ifdef FEDERATED_P2P_BATCH_SIZE
+/**
+ * Tagged messages and port absent messages for one federate that are waiting to be sent
+ * together. The buffer holds complete MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH messages, the last of which
+ * is still being filled. An element of p2p_batches is only accessed while holding the
+ * corresponding lock in _fed.outbound_p2p_mutexes.
+ */
+typedef struct p2p_batch_t {
+  unsigned char* buffer;
+  size_t length;
+  size_t capacity;
+  /** Position in buffer of the header of the batch being filled. */
+  size_t batch_start;
+  /** The tag shared by the entries of the batch being filled. */
+  tag_t batch_tag;
+} p2p_batch_t;
+
+static p2p_batch_t p2p_batches[NUMBER_OF_FEDERATES];
+
+/**
+ * Send the messages waiting in the batches for the specified federate.
+ * This must be called while holding the lock on the outbound connection to the federate.
+ * @param fed_id The ID of the destination federate.
+ * @return 0 for success, -1 if the messages could not be sent and have been dropped.
+ */
+static int flush_p2p_batch_locked(uint16_t fed_id) {
+  p2p_batch_t* batch = &p2p_batches[fed_id];
+  if (batch->length == 0) {
+    return 0;
+  }
+  net_abstraction_t net = _fed.net_for_outbound_p2p_connections[fed_id];
+  int result = -1;
+  if (net != NULL) {
+    result = write_to_net_close_on_error(net, batch->length, batch->buffer);
+  }
+  if (result != 0) {
+    // As for single P2P messages, this is not a critical error.
+    lf_print_warning("Failed to send messages to federate %hu. Dropping the messages.", fed_id);
+  }
+  batch->length = 0;
+  return result;
+}
+
+/**
+ * Add an entry to the batches for the specified federate, starting a new batch if the
+ * tag of the entry differs from that of the batch being filled, and send the batches if
+ * they exceed FEDERATED_P2P_BATCH_SIZE bytes.
+ * This must be called while holding the lock on the outbound connection to the federate.
+ * @param fed_id The ID of the destination federate.
+ * @param type MSG_TYPE_P2P_TAGGED_MESSAGE or MSG_TYPE_PORT_ABSENT.
+ * @param port_id The ID of the destination port.
+ * @param tag The intended tag of the entry.
+ * @param length The length of the message, which is ignored for a port absent message.
+ * @param message The message or NULL for a port absent message.
+ * @return 0 for success, -1 if messages could not be sent and have been dropped.
+ */
+static int add_to_p2p_batch_locked(uint16_t fed_id, unsigned char type, uint16_t port_id, tag_t tag, size_t length,
+                                   unsigned char* message) {
+  p2p_batch_t* batch = &p2p_batches[fed_id];
+  bool new_batch = batch->length == 0 || lf_tag_compare(batch->batch_tag, tag) != 0;
+  size_t entry_length = 1 + sizeof(uint16_t) + (type == MSG_TYPE_P2P_TAGGED_MESSAGE ? sizeof(uint32_t) + length : 0);
+  size_t needed = batch->length + entry_length + (new_batch ? MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE : 0);
+  if (needed > batch->capacity) {
+    size_t capacity = batch->capacity > 0 ? batch->capacity : 256;
+    while (capacity < needed) {
+      capacity *= 2;
+    }
+    unsigned char* buffer = (unsigned char*)realloc(batch->buffer, capacity);
+    LF_ASSERT_NON_NULL(buffer);
+    batch->buffer = buffer;
+    batch->capacity = capacity;
+  }
+  if (new_batch) {
+    batch->batch_start = batch->length;
+    batch->batch_tag = tag;
+    unsigned char* header = &batch->buffer[batch->batch_start];
+    header[0] = MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH;
+    encode_uint16(fed_id, &header[1]);
+    encode_uint32(0, &header[1 + sizeof(uint16_t)]);
+    encode_tag(&header[1 + sizeof(uint16_t) + sizeof(uint32_t)], tag);
+    batch->length += MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE;
+  }
+  unsigned char* entry = &batch->buffer[batch->length];
+  entry[0] = type;
+  encode_uint16(port_id, &entry[1]);
+  if (type == MSG_TYPE_P2P_TAGGED_MESSAGE) {
+    encode_uint32((uint32_t)length, &entry[1 + sizeof(uint16_t)]);
+    memcpy(&entry[1 + sizeof(uint16_t) + sizeof(uint32_t)], message, length);
+  }
+  batch->length += entry_length;
+  // Update the length of the entries in the header of the batch.
+  unsigned char* header = &batch->buffer[batch->batch_start];
+  encode_uint32((uint32_t)(batch->length - batch->batch_start - MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE),
+                &header[1 + sizeof(uint16_t)]);
+  if (batch->length >= FEDERATED_P2P_BATCH_SIZE) {
+    return flush_p2p_batch_locked(fed_id);
+  }
+  return 0;
+}
+#endif // FEDERATED_P2P_BATCH_SIZE
+
 /**
  * Close the network abstraction that sends outgoing messages to the
- * specified federate ID. This function acquires the lf_outbound_net_mutex mutex lock
+ * specified federate ID. This function acquires the lock on that connection
  * if _lf_normal_termination is true and otherwise proceeds without the lock.
  * @param fed_id The ID of the peer federate receiving messages from this
  *  federate, or -1 if the RTI (centralized coordination).
@@ -821,12 +1417,17 @@ static void close_outbound_net(int fed_id) {
   // This will result in EOF being sent to the remote federate, except for
   // abnormal termination, in which case it will just close the network abstraction.
   if (_lf_normal_termination) {
+    LF_MUTEX_LOCK(&_fed.outbound_p2p_mutexes[fed_id]);
+#ifdef FEDERATED_P2P_BATCH_SIZE
+    flush_p2p_batch_locked(fed_id);
+#endif
     if (_fed.net_for_outbound_p2p_connections[fed_id] != NULL) {
       // Close the network abstraction by sending a FIN packet indicating that no further writes
       // are expected.  Then read until we get an EOF indication.
       shutdown_net(_fed.net_for_outbound_p2p_connections[fed_id], true);
       _fed.net_for_outbound_p2p_connections[fed_id] = NULL;
     }
+    LF_MUTEX_UNLOCK(&_fed.outbound_p2p_mutexes[fed_id]);
   } else {
     shutdown_net(_fed.net_for_outbound_p2p_connections[fed_id], false);
     _fed.net_for_outbound_p2p_connections[fed_id] = NULL;
@@ -837,9 +1438,10 @@ static void close_outbound_net(int fed_id) {
 /**
  * Perform HMAC-based authentication with the RTI, using the federation ID
  * as an HMAC key.
+ * @param net The network abstraction connected to the RTI.
  * @return 0 for success, -1 for failure.
  */
-static int perform_hmac_authentication() {
+static int perform_hmac_authentication(net_abstraction_t net) {
 
   // Send buffer including message type, federate ID, federate's nonce.
   size_t fed_id_length = sizeof(uint16_t);
@@ -852,14 +1454,14 @@ static int perform_hmac_authentication() {
   memcpy(&fed_hello_buf[1 + fed_id_length], fed_nonce, NONCE_LENGTH);
 
   // No mutex needed during startup, hence the NULL argument.
-  write_to_net_fail_on_error(_fed.net_to_RTI, message_length, fed_hello_buf, NULL, "Failed to write nonce.");
+  write_to_net_fail_on_error(net, message_length, fed_hello_buf, NULL, "Failed to write nonce.");
 
   // Check HMAC of received FED_RESPONSE message.
   unsigned int hmac_length = SHA256_HMAC_LENGTH;
   size_t federation_id_length = strnlen(federation_metadata.federation_id, 255);
 
   unsigned char received[1 + NONCE_LENGTH + hmac_length];
-  if (read_from_net_close_on_error(_fed.net_to_RTI, 1 + NONCE_LENGTH + hmac_length, received)) {
+  if (read_from_net_close_on_error(net, 1 + NONCE_LENGTH + hmac_length, received)) {
     lf_print_warning("Failed to read RTI response.");
     return -1;
   }
@@ -893,7 +1495,7 @@ static int perform_hmac_authentication() {
     response[1] = HMAC_DOES_NOT_MATCH;
 
     // Ignore errors on writing back.
-    write_to_net(_fed.net_to_RTI, 2, response);
+    write_to_net(net, 2, response);
     return -1;
   } else {
     LF_PRINT_LOG("HMAC verified.");
@@ -907,12 +1509,37 @@ static int perform_hmac_authentication() {
     HMAC(EVP_sha256(), federation_metadata.federation_id, federation_id_length, mac_buf, 1 + NONCE_LENGTH, &sender[1],
          &hmac_length);
 
-    write_to_net_fail_on_error(_fed.net_to_RTI, 1 + hmac_length, sender, NULL, "Failed to write fed response.");
+    write_to_net_fail_on_error(net, 1 + hmac_length, sender, NULL, "Failed to write fed response.");
   }
   return 0;
 }
 #endif
 
+#if defined(FEDERATED_COMPRESSION) && defined(FEDERATED_CENTRALIZED)
+/**
+ * Read the codecs of the federates from the RTI, which it sends right after the start time, and
+ * record to which federates payloads can be sent compressed (@see MSG_TYPE_COMPRESSION).
+ */
+static void receive_compression_codecs_from_rti(void) {
+  unsigned char buffer[1 + sizeof(uint16_t) + 1];
+  read_from_net_fail_on_error(_fed.net_to_RTI, 1 + sizeof(uint16_t), buffer,
+                              "Failed to read the codecs of the federation from the RTI.");
+  if (buffer[0] != MSG_TYPE_COMPRESSION) {
+    lf_print_error_and_exit("Expected a MSG_TYPE_COMPRESSION message from the RTI. Got %u (see net_common.h).",
+                            buffer[0]);
+  }
+  uint16_t count = extract_uint16(&buffer[1]);
+  for (uint16_t i = 0; i < count; i++) {
+    read_from_net_fail_on_error(_fed.net_to_RTI, sizeof(uint16_t) + 1, buffer,
+                                "Failed to read the codecs of the federation from the RTI.");
+    uint16_t federate = extract_uint16(buffer);
+    if (federate < NUMBER_OF_FEDERATES && federate != _lf_my_fed_id) {
+      _fed.compress_payloads_to[federate] = buffer[sizeof(uint16_t)] == LF_COMPRESSION_CODEC;
+    }
+  }
+}
+#endif // FEDERATED_COMPRESSION && FEDERATED_CENTRALIZED
+
 /**
  * Send the specified timestamp to the RTI and wait for a response.
  * The specified timestamp should be current physical time of the
@@ -923,6 +1550,12 @@ static int perform_hmac_authentication() {
  * @return The designated start time for the federate.
  */
 static instant_t get_start_time_from_rti(instant_t my_physical_time) {
+#if defined(FEDERATED_COMPRESSION) && defined(FEDERATED_CENTRALIZED)
+  // Announce the codec first, so that the RTI knows it when it sends the start time.
+  unsigned char codec_message[2] = {MSG_TYPE_COMPRESSION, LF_COMPRESSION_CODEC};
+  write_to_net_fail_on_error(_fed.net_to_RTI, sizeof(codec_message), codec_message, NULL,
+                             "Failed to send the codec to the RTI.");
+#endif
   // Send the timestamp marker first.
   send_time(MSG_TYPE_TIMESTAMP, my_physical_time);
 
@@ -945,6 +1578,9 @@ static instant_t get_start_time_from_rti(instant_t my_physical_time) {
   }
 
   instant_t timestamp = extract_int64(&(buffer[1]));
+#if defined(FEDERATED_COMPRESSION) && defined(FEDERATED_CENTRALIZED)
+  receive_compression_codecs_from_rti();
+#endif
 
   tag_t tag = {.time = timestamp, .microstep = 0};
   // Trace the event when tracing is enabled
@@ -967,16 +1603,19 @@ static instant_t get_start_time_from_rti(instant_t my_physical_time) {
  *
  * @note This function is very similar to handle_provisinal_tag_advance_grant() except that
  *  it sets last_TAG_was_provisional to false.
+ *
+ * @param net The network abstraction from which to read the grant, the connection to the RTI or its control lane.
  */
-static void handle_tag_advance_grant(void) {
+static void handle_tag_advance_grant(net_abstraction_t net) {
   // Environment is always the one corresponding to the top-level scheduling enclave.
   environment_t* env;
   _lf_get_environments(&env);
 
   size_t bytes_to_read = sizeof(instant_t) + sizeof(microstep_t);
   unsigned char buffer[bytes_to_read];
-  read_from_net_fail_on_error(_fed.net_to_RTI, bytes_to_read, buffer, "Failed to read tag advance grant from RTI.");
+  read_from_net_fail_on_error(net, bytes_to_read, buffer, "Failed to read tag advance grant from RTI.");
   tag_t TAG = extract_tag(buffer);
+  wait_for_data_fence(net, TAG);
 
   // Trace the event when tracing is enabled
   tracepoint_federate_from_rti(receive_TAG, _lf_my_fed_id, &TAG);
@@ -1027,18 +1666,6 @@ static bool a_port_is_unknown(staa_t* staa_elem) {
   return do_wait;
 }
 
-/**
- * @brief Return the port ID of the port associated with the given action.
- * @return The port ID or -1 if there is no match.
- */
-static int id_of_action(lf_action_base_t* input_port_action) {
-  for (size_t i = 0; i < _lf_action_table_size; i++) {
-    if (_lf_action_table[i] == input_port_action)
-      return i;
-  }
-  return -1;
-}
-
 #endif
 
 #ifdef FEDERATED_DECENTRALIZED
@@ -1059,143 +1686,49 @@ static bool inputs_known_to(tag_t tag) {
 }
 #endif // FEDERATED_DECENTRALIZED
 
+#ifdef FEDERATED_DECENTRALIZED
 /**
- * @brief Thread handling setting the known absent status of input ports.
+ * @brief Assume absent the unknown input ports whose STAA has expired at the current tag.
+ *
+ * For each element of the code-generated array `staa_lst`, the ports of the element can be
+ * assumed absent at the current tag once physical time reaches the current time plus the STA
+ * plus the STAA of the element. This marks absent the unknown ports of each element whose
+ * deadline is not later than `now` and returns the earliest deadline of the others.
+ * This assumes the caller holds the mutex on the top-level environment.
  *
- * For the code-generated array of STAA offsets `staa_lst`, which is sorted by STAA offset,
- * wait for physical time to advance to the current time plus the STAA offset,
- * then set the absent status of the input ports associated with the STAA.
- * Then wait for current time to advance and start over.
+ * @param env The top-level environment.
+ * @param now The physical time up to which deadlines have expired.
+ * @return The earliest deadline of an element that still has unknown ports or FOREVER if there is none.
  */
-#ifdef FEDERATED_DECENTRALIZED
-static void* update_ports_from_staa_offsets(void* args) {
-  (void)args;
-  initialize_lf_thread_id();
-  if (staa_lst_size == 0)
-    return NULL; // Nothing to do.
-  // NOTE: Using only the top-level environment, which is the one that deals with network
-  // input ports.
-  environment_t* env;
-  _lf_get_environments(&env);
-  LF_MUTEX_LOCK(&env->mutex);
-  while (!_lf_termination_executed) {
-    LF_PRINT_DEBUG("**** (update thread) starting");
-    tag_t tag_when_started_waiting = lf_tag(env);
-    for (size_t i = 0; i < staa_lst_size; ++i) {
-      staa_t* staa_elem = staa_lst[i];
-      // The staa_elem is adjusted in the code generator to have subtracted the delay on the connection.
-      // The list is sorted in increasing order of adjusted STAA offsets.
-      // We need to add the lf_fed_STA_offset to the wait time and guard against overflow.
-      // Skip this if the current tag is the dynamically determined stop time
-      // (due to a call to lf_request_stop()).  This is indicated by a stop_tag with microstep greater than 0.
-      interval_t wait_time = 0;
-      if (lf_tag_compare(env->current_tag, env->stop_tag) != 0 || env->stop_tag.microstep == 0) {
-        wait_time = lf_time_add(staa_elem->STAA, lf_fed_STA_offset);
-      }
-      instant_t wait_until_time = lf_time_add(env->current_tag.time, wait_time);
-      LF_PRINT_DEBUG("**** (update thread) wait_until_time: " PRINTF_TIME, wait_until_time - lf_time_start());
-
-      // The wait_until call will release the env->mutex while it is waiting.
-      // However, it will not release the env->mutex if the wait time is too small.
-      // At the cost of a small additional delay in deciding a port is absent,
-      // we require a minimum wait time here.  Note that zero-valued STAAs are
-      // included, and STA might be zero or very small.
-      // In this case, this thread will fail to ever release the environment mutex.
-      // This causes chaos.  The MIN_SLEEP_DURATION is the smallest amount of time
-      // that wait_until will actually wait. Note that this strategy does not
-      // block progress of any execution that is actually processing events.
-      // It only slightly delays the decision that an event is absent, and only
-      // if the STAA and STA are extremely small.
-      if (wait_time < 5 * MIN_SLEEP_DURATION) {
-        wait_until_time += 5 * MIN_SLEEP_DURATION;
-      }
-      while (!_lf_termination_executed && a_port_is_unknown(staa_elem)) {
-        LF_PRINT_DEBUG("**** (update thread) waiting until: " PRINTF_TIME, wait_until_time - lf_time_start());
-        if (wait_until(wait_until_time, &lf_port_status_changed)) {
-          // Specified timeout time was reached.
-          // If the current tag has changed, start over.
-          if (lf_tag_compare(lf_tag(env), tag_when_started_waiting) != 0) {
-            break;
-          }
-          /* Possibly useful for debugging:
-          tag_t current_tag = lf_tag(env);
-          LF_PRINT_DEBUG("**** (update thread) Assuming absent! " PRINTF_TAG, current_tag.time - lf_time_start(),
-          current_tag.microstep); LF_PRINT_DEBUG("**** (update thread) Lag is " PRINTF_TIME, current_tag.time -
-          lf_time_physical()); LF_PRINT_DEBUG("**** (update thread) Wait until time is " PRINTF_TIME,
-          wait_until_time - lf_time_start());
-          */
-
-          // Mark input ports absent.
-          for (size_t j = 0; j < staa_elem->num_actions; ++j) {
-            lf_action_base_t* input_port_action = staa_elem->actions[j];
-            if (input_port_action->trigger->status == unknown) {
-              input_port_action->trigger->status = absent;
-              LF_PRINT_DEBUG("**** (update thread) Assuming port absent at tag " PRINTF_TAG,
-                             lf_tag(env).time - start_time, lf_tag(env).microstep);
-              update_last_known_status_on_input_port(env, lf_tag(env), id_of_action(input_port_action), false);
-              lf_cond_broadcast(&lf_port_status_changed);
-            }
-          }
-        }
-        // If the tag has advanced, start over.
-        if (lf_tag_compare(lf_tag(env), tag_when_started_waiting) != 0)
-          break;
-      }
-      // If the tag has advanced, start over.
-      if (_lf_termination_executed || lf_tag_compare(lf_tag(env), tag_when_started_waiting) != 0)
-        break;
-    }
-    // If the tag has advanced, start over.
-    if (_lf_termination_executed || lf_tag_compare(lf_tag(env), tag_when_started_waiting) != 0)
+static instant_t assume_absent_past_staa_locked(environment_t* env, instant_t now) {
+  instant_t next_deadline = FOREVER;
+  for (size_t i = 0; i < staa_lst_size; ++i) {
+    staa_t* staa_elem = staa_lst[i];
+    if (!a_port_is_unknown(staa_elem)) {
       continue;
-
-    // At this point, the current tag is the same as when we started waiting
-    // and all ports should be known, and hence max_level_allowed_to_advance
-    // should be INT_MAX.  Check this to prevent an infinite wait.
-    if (max_level_allowed_to_advance != INT_MAX) {
-      // If this occurs, then the current tag advanced during a wait.
-      // Some ports may have been reset to uknown during that wait, in which case,
-      // it would be huge mistake to enter the wait for a new tag below because the
-      // program will freeze.  First, check whether any ports are unknown:
-      bool port_unknown = false;
-      for (size_t i = 0; i < staa_lst_size; ++i) {
-        staa_t* staa_elem = staa_lst[i];
-        if (a_port_is_unknown(staa_elem)) {
-          port_unknown = true;
-          break;
-        }
-      }
-      if (!port_unknown) {
-        // If this occurs, then there is a race condition that can lead to deadlocks.
-        lf_print_error_and_exit("**** (update thread) Inconsistency: All ports are known, but MLAA is blocking.");
-      }
-
-      // Since max_level_allowed_to_advance will block advancement of time, we cannot follow
-      // through to the next step without deadlocking.  Wait some time, then continue.
-      // The wait is necessary to prevent a busy wait, which will only occur if port
-      // status are always known inside the while loop
-      // Be sure to use wait_until() instead of sleep() because sleep() will not release the mutex.
-      instant_t wait_until_time = lf_time_add(env->current_tag.time, 2 * MIN_SLEEP_DURATION);
-      wait_until(wait_until_time, &lf_port_status_changed);
-
+    }
+    // The STAA is adjusted in the code generator to have subtracted the delay on the connection.
+    // Do not wait if the current tag is the dynamically determined stop time
+    // (due to a call to lf_request_stop()).  This is indicated by a stop_tag with microstep greater than 0.
+    instant_t deadline = env->current_tag.time;
+    if (lf_tag_compare(env->current_tag, env->stop_tag) != 0 || env->stop_tag.microstep == 0) {
+      deadline = lf_time_add(deadline, lf_time_add((interval_t)staa_elem->STAA, lf_fed_STA_offset));
+    }
+    if (deadline > now) {
+      next_deadline = LF_MIN(next_deadline, deadline);
       continue;
     }
-
-    // Wait until we progress to a new tag.
-    while (lf_tag_compare(lf_tag(env), tag_when_started_waiting) == 0) {
-      // The following will release the env->mutex while waiting.
-      LF_PRINT_DEBUG("**** (update thread) Waiting for tags to not match: " PRINTF_TAG ", " PRINTF_TAG,
-                     lf_tag(env).time - lf_time_start(), lf_tag(env).microstep,
-                     tag_when_started_waiting.time - lf_time_start(), tag_when_started_waiting.microstep);
-      // Ports are reset to unknown at the start of new tag, so that will wake this up.
-      lf_cond_wait(&lf_port_status_changed);
+    for (size_t j = 0; j < staa_elem->num_actions; ++j) {
+      lf_action_base_t* input_port_action = staa_elem->actions[j];
+      if (input_port_action->trigger->status == unknown) {
+        input_port_action->trigger->status = absent;
+        LF_PRINT_DEBUG("Assuming port absent at tag " PRINTF_TAG ".", lf_tag(env).time - start_time,
+                       lf_tag(env).microstep);
+        update_last_known_status_on_input_port(env, lf_tag(env), id_of_action(input_port_action), false);
+      }
     }
-    LF_PRINT_DEBUG("**** (update thread) Tags after wait: " PRINTF_TAG ", and before: " PRINTF_TAG,
-                   lf_tag(env).time - lf_time_start(), lf_tag(env).microstep,
-                   tag_when_started_waiting.time - lf_time_start(), tag_when_started_waiting.microstep);
   }
-  LF_MUTEX_UNLOCK(&env->mutex);
-  return NULL;
+  return next_deadline;
 }
 #endif // FEDERATED_DECENTRALIZED
 
@@ -1213,17 +1746,19 @@ static void* update_ports_from_staa_offsets(void* args) {
  * @note This function is similar to handle_tag_advance_grant() except that
  *  it sets last_TAG_was_provisional to true and also it does not update the
  *  last known tag for input ports.
+ *
+ * @param net The network abstraction from which to read the grant, the connection to the RTI or its control lane.
  */
-static void handle_provisional_tag_advance_grant() {
+static void handle_provisional_tag_advance_grant(net_abstraction_t net) {
   // Environment is always the one corresponding to the top-level scheduling enclave.
   environment_t* env;
   _lf_get_environments(&env);
 
   size_t bytes_to_read = sizeof(instant_t) + sizeof(microstep_t);
   unsigned char buffer[bytes_to_read];
-  read_from_net_fail_on_error(_fed.net_to_RTI, bytes_to_read, buffer,
-                              "Failed to read provisional tag advance grant from RTI.");
+  read_from_net_fail_on_error(net, bytes_to_read, buffer, "Failed to read provisional tag advance grant from RTI.");
   tag_t PTAG = extract_tag(buffer);
+  wait_for_data_fence(net, PTAG);
 
   // Trace the event when tracing is enabled
   tracepoint_federate_from_rti(receive_PTAG, _lf_my_fed_id, &PTAG);
@@ -1280,6 +1815,8 @@ static void handle_provisional_tag_advance_grant() {
     // have either been sent or are absent, so we can send an LTC.
     // Send an LTC to indicate absent outputs.
     lf_latest_tag_confirmed(PTAG);
+    // No NET follows to carry the LTC.
+    send_pending_LTC();
     // Nothing more to do.
     LF_MUTEX_UNLOCK(&env->mutex);
     return;
@@ -1428,6 +1965,7 @@ static void handle_stop_request_message() {
   LF_MUTEX_LOCK(&lf_outbound_net_mutex);
   write_to_net_fail_on_error(_fed.net_to_RTI, MSG_TYPE_STOP_REQUEST_REPLY_LENGTH, outgoing_buffer,
                              &lf_outbound_net_mutex, "Failed to send the answer to MSG_TYPE_STOP_REQUEST to RTI.");
+  _fed.fenced_messages_to_RTI++;
   LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
 
   LF_PRINT_DEBUG("Sent MSG_TYPE_STOP_REQUEST_REPLY to RTI with tag " PRINTF_TAG, tag_to_stop.time,
@@ -1436,12 +1974,12 @@ static void handle_stop_request_message() {
 
 /**
  * Handle a downstream next event tag (DNET) message from the RTI.
+ * @param net The network abstraction from which to read the message, the connection to the RTI or its control lane.
  */
-static void handle_downstream_next_event_tag() {
+static void handle_downstream_next_event_tag(net_abstraction_t net) {
   size_t bytes_to_read = sizeof(instant_t) + sizeof(microstep_t);
   unsigned char buffer[bytes_to_read];
-  read_from_net_fail_on_error(_fed.net_to_RTI, bytes_to_read, buffer,
-                              "Failed to read downstream next event tag from RTI.");
+  read_from_net_fail_on_error(net, bytes_to_read, buffer, "Failed to read downstream next event tag from RTI.");
   tag_t DNET = extract_tag(buffer);
 
   // Trace the event when tracing is enabled
@@ -1456,7 +1994,7 @@ static void handle_downstream_next_event_tag() {
     LF_PRINT_LOG("The incoming DNET " PRINTF_TAG " is earlier than the last skipped NET " PRINTF_TAG
                  ". Send the skipped NET",
                  DNET.time - start_time, DNET.microstep, _fed.last_skipped_NET.time, _fed.last_skipped_NET.microstep);
-    send_tag(MSG_TYPE_NEXT_EVENT_TAG, _fed.last_skipped_NET);
+    send_next_event_tag_to_RTI(_fed.last_skipped_NET);
     _fed.last_sent_NET = _fed.last_skipped_NET;
     _fed.last_skipped_NET = NEVER_TAG;
   }
@@ -1468,6 +2006,7 @@ static void handle_downstream_next_event_tag() {
  * Send a resign signal to the RTI.
  */
 static void send_resign_signal() {
+  send_pending_LTC();
   size_t bytes_to_write = 1;
   unsigned char buffer[bytes_to_write];
   buffer[0] = MSG_TYPE_RESIGN;
@@ -1518,6 +2057,7 @@ static void* listen_to_rti_net(void* args) {
     // Check whether the RTI network abstraction is still valid.
     if (_fed.net_to_RTI == NULL || !is_net_open(_fed.net_to_RTI)) {
       lf_print_warning("network connection to the RTI unexpectedly closed.");
+      close_fenced_messages_from_RTI();
       return NULL;
     }
     // Read one byte to get the message type.
@@ -1526,11 +2066,13 @@ static void* listen_to_rti_net(void* args) {
     if (read_failed < 0) {
       lf_print_error("Connection to the RTI was closed by the RTI with an error. Considering this a soft error.");
       close_net(_fed.net_to_RTI, false);
+      close_fenced_messages_from_RTI();
       return NULL;
     } else if (read_failed > 0) {
       // EOF received.
       lf_print_info("Connection to the RTI closed with an EOF.");
       close_net(_fed.net_to_RTI, false);
+      close_fenced_messages_from_RTI();
       return NULL;
     }
     switch (buffer[0]) {
@@ -1541,16 +2083,18 @@ static void* listen_to_rti_net(void* args) {
       }
       break;
     case MSG_TYPE_TAG_ADVANCE_GRANT:
-      handle_tag_advance_grant();
+      handle_tag_advance_grant(_fed.net_to_RTI);
       break;
     case MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT:
-      handle_provisional_tag_advance_grant();
+      handle_provisional_tag_advance_grant(_fed.net_to_RTI);
       break;
     case MSG_TYPE_STOP_REQUEST:
       handle_stop_request_message();
+      count_fenced_message_from_RTI(NEVER_TAG);
       break;
     case MSG_TYPE_STOP_GRANTED:
       handle_stop_granted_message();
+      count_fenced_message_from_RTI(NEVER_TAG);
       break;
     case MSG_TYPE_PORT_ABSENT:
       if (handle_port_absent_message(_fed.net_to_RTI, -1)) {
@@ -1559,7 +2103,7 @@ static void* listen_to_rti_net(void* args) {
       }
       break;
     case MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG:
-      handle_downstream_next_event_tag();
+      handle_downstream_next_event_tag(_fed.net_to_RTI);
       break;
     case MSG_TYPE_FAILED:
       handle_rti_failed_message();
@@ -1574,6 +2118,41 @@ static void* listen_to_rti_net(void* args) {
       tracepoint_federate_from_rti(receive_UNIDENTIFIED, _lf_my_fed_id, NULL);
     }
   }
+  close_fenced_messages_from_RTI();
+  return NULL;
+}
+
+/**
+ * Thread that listens for tag coordination messages from the RTI on the control lane
+ * (@see MSG_TYPE_CONTROL_LANE) and calls the appropriate handler. It returns when the
+ * control lane is closed.
+ * @param args Ignored
+ */
+static void* listen_to_rti_control_lane(void* args) {
+  (void)args;
+  initialize_lf_thread_id();
+  unsigned char type;
+  while (!_lf_termination_executed) {
+    int read_failed = read_from_net(_fed.net_control_to_RTI, 1, &type);
+    if (read_failed != 0) {
+      LF_PRINT_LOG("Control lane to the RTI closed.");
+      close_net(_fed.net_control_to_RTI, false);
+      return NULL;
+    }
+    switch (type) {
+    case MSG_TYPE_TAG_ADVANCE_GRANT:
+      handle_tag_advance_grant(_fed.net_control_to_RTI);
+      break;
+    case MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT:
+      handle_provisional_tag_advance_grant(_fed.net_control_to_RTI);
+      break;
+    case MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG:
+      handle_downstream_next_event_tag(_fed.net_control_to_RTI);
+      break;
+    default:
+      lf_print_error_and_exit("Received from RTI on the control lane an unexpected message type: %hhx.", type);
+    }
+  }
   return NULL;
 }
 
@@ -1681,6 +2260,11 @@ void lf_terminate_execution(environment_t* env) {
   LF_PRINT_DEBUG("Waiting for RTI's network abstraction listener threads.");
   // Wait for the thread listening for messages from the RTI to close.
   lf_thread_join(_fed.RTI_net_listener, NULL);
+  if (_fed.net_control_to_RTI != NULL) {
+    // The RTI normally closes the control lane when the federate resigns, but it may have failed.
+    close_net(_fed.net_control_to_RTI, false);
+    lf_thread_join(_fed.RTI_control_listener, NULL);
+  }
 
   // All listener threads have now exited. Safe to free network abstraction memory.
   for (int i = 0; i < NUMBER_OF_FEDERATES; i++) {
@@ -1689,6 +2273,10 @@ void lf_terminate_execution(environment_t* env) {
   }
   free_net(_fed.net_to_RTI);
   _fed.net_to_RTI = NULL;
+  if (_fed.net_control_to_RTI != NULL) {
+    free_net(_fed.net_control_to_RTI);
+    _fed.net_control_to_RTI = NULL;
+  }
 
   // For abnormal termination, there is no need to free memory.
   if (_lf_normal_termination) {
@@ -1703,7 +2291,25 @@ void lf_terminate_execution(environment_t* env) {
 //////////////////////////////////////////////////////////////////////////////////
 // Public functions (declared in federate.h, in alphabetical order)
 
-void lf_connect_to_federate(uint16_t remote_federate_id) {
+void* lf_allocate_payload(unsigned short port_id, size_t length, token_type_t** type) {
+  lf_action_base_t* action = action_for_port(port_id);
+  port_payload_pool_t* port_pool = payload_pool_for_port(port_id);
+  if (port_pool != NULL && length > 0) {
+    void* payload = lf_payload_pool_acquire(port_pool->pool, length);
+    if (payload != NULL) {
+      *type = &port_pool->type;
+      return payload;
+    }
+  }
+  *type = (token_type_t*)action;
+  return malloc(length);
+}
+
+/**
+ * Connect to the federate with the specified ID, as described for lf_connect_to_federate().
+ * @param remote_federate_id The ID of the remote federate.
+ */
+static void connect_to_federate(uint16_t remote_federate_id) {
   int result = -1;
 
   // Ask the RTI for port number of the remote federate.
@@ -1713,6 +2319,7 @@ void lf_connect_to_federate(uint16_t remote_federate_id) {
   int port = -1;
   struct in_addr host_ip_addr;
   instant_t start_connect = lf_time_physical();
+  instant_t phase_start = start_connect;
   while (port == -1 && !_lf_termination_executed) {
     buffer[0] = MSG_TYPE_ADDRESS_QUERY;
     // NOTE: Sending messages in little endian.
@@ -1722,6 +2329,8 @@ void lf_connect_to_federate(uint16_t remote_federate_id) {
     // Trace the event when tracing is enabled
     tracepoint_federate_to_rti(send_ADR_QR, _lf_my_fed_id, NULL);
 
+    // Other threads may be connecting to other federates, so the query and its reply are kept together.
+    LF_MUTEX_LOCK(&address_query_mutex);
     LF_MUTEX_LOCK(&lf_outbound_net_mutex);
     write_to_net_fail_on_error(_fed.net_to_RTI, sizeof(uint16_t) + 1, buffer, &lf_outbound_net_mutex,
                                "Failed to send address query for federate %d to RTI.", remote_federate_id);
@@ -1744,6 +2353,7 @@ void lf_connect_to_federate(uint16_t remote_federate_id) {
 
     read_from_net_fail_on_error(_fed.net_to_RTI, sizeof(host_ip_addr), (unsigned char*)&host_ip_addr,
                                 "Failed to read the IP address for federate %d from RTI.", remote_federate_id);
+    LF_MUTEX_UNLOCK(&address_query_mutex);
     tracepoint_federate_from_rti(receive_ADR_QR_REP, _lf_my_fed_id, NULL);
 
     // A reply of -1 for the port means that the RTI does not know
@@ -1762,7 +2372,7 @@ void lf_connect_to_federate(uint16_t remote_federate_id) {
   assert(port > 0);
   uint16_t uport = (uint16_t)port;
 
-#ifdef COMM_TYPE_TCP
+#if defined(COMM_TYPE_TCP) || defined(COMM_TYPE_UDS) || defined(COMM_TYPE_URING)
   socket_connection_params_t params = {0};
   params.type = TCP;
   params.port = uport;
@@ -1778,6 +2388,11 @@ void lf_connect_to_federate(uint16_t remote_federate_id) {
   params.socket_params.type = TCP;
   params.socket_params.port = uport;
   params.socket_params.server_ip_addr = &host_ip_addr;
+#elif defined(COMM_TYPE_SHM)
+  shm_connection_params_t params = {0};
+  params.socket_params.type = TCP;
+  params.socket_params.port = uport;
+  params.socket_params.server_ip_addr = &host_ip_addr;
 #endif
 
   net_abstraction_t net = connect_to_net((net_params_t)&params);
@@ -1842,22 +2457,111 @@ void lf_connect_to_federate(uint16_t remote_federate_id) {
       lf_print_info("Connected to federate %d, port %hu.", remote_federate_id, uport);
       // Trace the event when tracing is enabled
       tracepoint_federate_to_federate(receive_ACK, _lf_my_fed_id, remote_federate_id, NULL);
+      result = 0;
       break;
     }
   }
+#if defined(FEDERATED_COMPRESSION) && defined(FEDERATED_DECENTRALIZED)
+  if (result == 0) {
+    // Offer the codec of this federate, which the remote federate accepts by replying with the same codec.
+    buffer[0] = MSG_TYPE_COMPRESSION;
+    buffer[1] = LF_COMPRESSION_CODEC;
+    write_to_net_fail_on_error(net, 2, buffer, NULL, "Failed to offer a codec to federate %d.", remote_federate_id);
+    read_from_net_fail_on_error(net, 2, buffer, "Failed to read the codec of federate %d.", remote_federate_id);
+    _fed.compress_payloads_to[remote_federate_id] =
+        buffer[0] == MSG_TYPE_COMPRESSION && buffer[1] == LF_COMPRESSION_CODEC;
+    LF_PRINT_LOG("Compressing payloads to federate %d: %s.", remote_federate_id,
+                 _fed.compress_payloads_to[remote_federate_id] ? "yes" : "no");
+  }
+#endif
   // Once we set this variable, then all future calls to close() on this
   // network abstraction should reset it to NULL within a critical section.
+  LF_MUTEX_LOCK(&_fed.outbound_p2p_mutexes[remote_federate_id]);
   _fed.net_for_outbound_p2p_connections[remote_federate_id] = net;
+  LF_MUTEX_UNLOCK(&_fed.outbound_p2p_mutexes[remote_federate_id]);
+  tracepoint_startup_phase(startup_connect_to_federate, _lf_my_fed_id, remote_federate_id, phase_start);
+}
+
+/**
+ * Thread that connects to a remote federate.
+ * @param remote_federate_id The ID of the remote federate, cast to a pointer.
+ */
+static void* connect_to_federate_thread(void* remote_federate_id) {
+  connect_to_federate((uint16_t)(uintptr_t)remote_federate_id);
+  return NULL;
+}
+
+void lf_connect_to_federate(uint16_t remote_federate_id) { connect_to_federate(remote_federate_id); }
+
+void lf_connect_to_federate_async(uint16_t remote_federate_id) {
+  if (_fed.number_of_outbound_p2p_connection_threads >= NUMBER_OF_FEDERATES) {
+    lf_print_error_and_exit("Too many outbound connections to federates.");
+  }
+  lf_thread_create(&_fed.outbound_p2p_connection_threads[_fed.number_of_outbound_p2p_connection_threads++],
+                   connect_to_federate_thread, (void*)(uintptr_t)remote_federate_id);
+}
+
+#if defined(FEDERATED_CONTROL_LANE) && defined(FEDERATED_CENTRALIZED)
+/**
+ * Open the control lane to the RTI (@see MSG_TYPE_CONTROL_LANE). If the RTI does not
+ * accept it, e.g. because it predates control lanes, this leaves _fed.net_control_to_RTI
+ * NULL so that all messages go over the main connection to the RTI.
+ * @param params The parameters with which to connect to the RTI.
+ */
+static void connect_control_lane_to_rti(net_params_t params) {
+  net_abstraction_t net = connect_to_net(params);
+  if (net == NULL) {
+    lf_print_warning("Failed to open a control lane to the RTI. Using a single connection.");
+    return;
+  }
+#ifdef FEDERATED_AUTHENTICATED
+  if (perform_hmac_authentication(net)) {
+    lf_print_warning("Failed to authenticate the control lane to the RTI. Using a single connection.");
+    shutdown_net(net, false);
+    return;
+  }
+#endif
+  size_t federation_id_length = strnlen(federation_metadata.federation_id, 255);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  buffer[0] = MSG_TYPE_CONTROL_LANE;
+  encode_uint16((uint16_t)_lf_my_fed_id, &buffer[1]);
+  buffer[1 + sizeof(uint16_t)] = (unsigned char)(federation_id_length & 0xff);
+  memcpy(&buffer[2 + sizeof(uint16_t)], federation_metadata.federation_id, federation_id_length);
+  unsigned char response;
+  if (write_to_net(net, 2 + sizeof(uint16_t) + federation_id_length, buffer) || read_from_net(net, 1, &response) ||
+      response != MSG_TYPE_ACK) {
+    lf_print_info("The RTI does not accept a control lane. Using a single connection.");
+    shutdown_net(net, false);
+    return;
+  }
+  LF_MUTEX_INIT(&fenced_messages_from_RTI.mutex);
+  LF_COND_INIT(&fenced_messages_from_RTI.changed, &fenced_messages_from_RTI.mutex);
+  fenced_messages_from_RTI.fence_tag = NEVER_TAG;
+  fenced_messages_from_RTI.later_tags = pqueue_tag_init(10);
+  _fed.net_control_to_RTI = net;
+  LF_PRINT_LOG("Opened a control lane to the RTI.");
 }
+#endif // FEDERATED_CONTROL_LANE && FEDERATED_CENTRALIZED
 
 void lf_connect_to_rti(const char* hostname, int port) {
   LF_PRINT_LOG("Connecting to the RTI.");
+  instant_t connect_start = lf_time_physical();
+
+  // Every federate connects to the RTI before connecting to or sending to other federates.
+  for (int i = 0; i < NUMBER_OF_FEDERATES; i++) {
+    LF_MUTEX_INIT(&_fed.outbound_p2p_mutexes[i]);
+  }
+  LF_MUTEX_INIT(&address_query_mutex);
+  if (_lf_action_table_size > 0) {
+    payload_pools = (port_payload_pool_t*)calloc(_lf_action_table_size, sizeof(port_payload_pool_t));
+    LF_ASSERT_NON_NULL(payload_pools);
+  }
 
   // Override passed hostname and port if passed as runtime arguments.
   hostname = federation_metadata.rti_host ? federation_metadata.rti_host : hostname;
   port = federation_metadata.rti_port >= 0 ? federation_metadata.rti_port : port;
 
-#ifdef COMM_TYPE_TCP
+#if defined(COMM_TYPE_TCP) || defined(COMM_TYPE_UDS) || defined(COMM_TYPE_URING)
   socket_connection_params_t params = {0};
   params.type = TCP;
   params.port = port;
@@ -1873,14 +2577,29 @@ void lf_connect_to_rti(const char* hostname, int port) {
   params.socket_params.type = TCP;
   params.socket_params.port = port;
   params.socket_params.server_hostname = hostname;
+#elif defined(COMM_TYPE_SHM)
+  shm_connection_params_t params = {0};
+  params.socket_params.type = TCP;
+  params.socket_params.port = port;
+  params.socket_params.server_hostname = hostname;
 #endif
 
+#if defined(FEDERATED_CONTROL_LANE) && defined(FEDERATED_CENTRALIZED)
+  // The RTI expects the control lane before the main connection.
+  connect_control_lane_to_rti((net_params_t)&params);
+#endif
   net_abstraction_t net = connect_to_net((net_params_t)&params);
   if (net == NULL) {
     lf_print_error_and_exit("Failed to connect to RTI.");
   }
   _fed.net_to_RTI = net;
 
+#ifdef FEDERATED_CENTRALIZED
+  // Offer to send next message requests until the RTI rejects the offer (@see MSG_TYPE_FED_IDS_NMR).
+  bool offer_NMR = true;
+#else
+  bool offer_NMR = false;
+#endif
   instant_t start_connect = lf_time_physical();
   while (!CHECK_TIMEOUT(start_connect, CONNECT_TIMEOUT) && !_lf_termination_executed) {
 
@@ -1890,7 +2609,7 @@ void lf_connect_to_rti(const char* hostname, int port) {
 
 #ifdef FEDERATED_AUTHENTICATED
     LF_PRINT_LOG("Connected to an RTI. Performing HMAC-based authentication using federation ID.");
-    if (perform_hmac_authentication()) {
+    if (perform_hmac_authentication(_fed.net_to_RTI)) {
       if (port == 0) {
         continue; // Try again with a new port.
       } else {
@@ -1904,7 +2623,7 @@ void lf_connect_to_rti(const char* hostname, int port) {
 
     // Send the message type first.
     unsigned char buffer[4];
-    buffer[0] = MSG_TYPE_FED_IDS;
+    buffer[0] = offer_NMR ? MSG_TYPE_FED_IDS_NMR : MSG_TYPE_FED_IDS;
     // Next send the federate ID.
     if (_lf_my_fed_id == UINT16_MAX) {
       lf_print_error_and_exit("Too many federates! More than %d.", UINT16_MAX - 1);
@@ -1949,10 +2668,22 @@ void lf_connect_to_rti(const char* hostname, int port) {
         lf_print_warning("Connected to the wrong RTI. Will try again");
         continue;
       }
+      if (offer_NMR && cause == UNEXPECTED_MESSAGE) {
+        // The RTI predates next message requests and has closed the connection.
+        lf_print_info("The RTI does not accept next message requests. Sending LTC and NET separately.");
+        offer_NMR = false;
+        shutdown_net(_fed.net_to_RTI, false);
+        _fed.net_to_RTI = connect_to_net((net_params_t)&params);
+        if (_fed.net_to_RTI == NULL) {
+          lf_print_error_and_exit("Failed to connect to RTI.");
+        }
+        continue;
+      }
     } else if (response == MSG_TYPE_ACK) {
       // Trace the event when tracing is enabled
       tracepoint_federate_from_rti(receive_ACK, _lf_my_fed_id, NULL);
       LF_PRINT_LOG("Received acknowledgment from the RTI.");
+      _fed.RTI_accepts_NMR = offer_NMR;
       break;
     } else if (response == MSG_TYPE_RESIGN) {
       lf_print_warning("RTI resigned. Will try again");
@@ -1962,6 +2693,7 @@ void lf_connect_to_rti(const char* hostname, int port) {
       continue;
     }
   }
+  tracepoint_startup_phase(startup_connect_to_rti, _lf_my_fed_id, -1, connect_start);
 
   // Call a generated (external) function that sends information
   // about connections between this federate and other federates
@@ -2150,6 +2882,21 @@ void lf_latest_tag_confirmed(tag_t tag_to_send) {
   }
   LF_PRINT_LOG("Sending Latest Tag Confirmed (LTC) " PRINTF_TAG " to the RTI.", tag_to_send.time - start_time,
                tag_to_send.microstep);
+#if defined(FEDERATED_CENTRALIZED) && !defined(LF_ENCLAVES)
+  if (_fed.RTI_accepts_NMR && lf_tag_compare(tag_to_send, env->stop_tag) < 0) {
+    // Unless execution is stopping, _lf_next_locked() is about to send a NET, which will carry this LTC.
+    // lf_send_next_event_tag() sends the LTC by itself if it does not send a NET.
+    LF_MUTEX_LOCK(&lf_outbound_net_mutex);
+    _fed.pending_LTC = tag_to_send;
+    LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+    _fed.last_sent_LTC = tag_to_send;
+    return;
+  }
+  // This LTC confirms any earlier one still pending, which must not follow it.
+  LF_MUTEX_LOCK(&lf_outbound_net_mutex);
+  _fed.pending_LTC = NEVER_TAG;
+  LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+#endif
   send_tag(MSG_TYPE_LATEST_TAG_CONFIRMED, tag_to_send);
   _fed.last_sent_LTC = tag_to_send;
 }
@@ -2188,6 +2935,26 @@ parse_rti_code_t lf_parse_rti_addr(const char* rti_addr) {
   return SUCCESS;
 }
 
+int lf_register_payload_pool(unsigned short port_id, lf_payload_pool_t* pool) {
+  if (payload_pools == NULL || port_id >= _lf_action_table_size) {
+    lf_print_error("Cannot register a payload pool for port %hu.", port_id);
+    return -1;
+  }
+  token_type_t* type = (token_type_t*)action_for_port(port_id);
+  if (type->destructor != NULL || type->copy_constructor != NULL) {
+    lf_print_error("Cannot register a payload pool for port %hu, whose type has a destructor or copy constructor.",
+                   port_id);
+    return -1;
+  }
+  if (pool != NULL) {
+    payload_pools[port_id].type.element_size = type->element_size;
+    payload_pools[port_id].type.destructor = lf_payload_pool_release;
+    payload_pools[port_id].type.copy_constructor = NULL;
+  }
+  __atomic_store_n(&payload_pools[port_id].pool, pool, __ATOMIC_RELEASE);
+  return 0;
+}
+
 void lf_reset_status_fields_on_input_port_triggers() {
   environment_t* env;
   _lf_get_environments(&env);
@@ -2228,29 +2995,28 @@ int lf_send_message(int message_type, unsigned short port, unsigned short federa
   // Header:  message_type + port_id + federate_id + length of message + timestamp + microstep
   const int header_length = 1 + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t);
 
-  // Use a mutex lock to prevent multiple threads from simultaneously sending.
-  LF_MUTEX_LOCK(&lf_outbound_net_mutex);
+  // Use a mutex lock to prevent multiple threads from simultaneously sending to this federate.
+  lf_mutex_t* mutex = &_fed.outbound_p2p_mutexes[federate];
+  LF_MUTEX_LOCK(mutex);
 
   net_abstraction_t net = _fed.net_for_outbound_p2p_connections[federate];
 
   if (net == NULL) {
     lf_print_warning("Network connection to %s is closed. Dropping the message.", next_destination_str);
-    LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+    LF_MUTEX_UNLOCK(mutex);
     return -1;
   }
   // Trace the event when tracing is enabled
   tracepoint_federate_to_federate(send_P2P_MSG, _lf_my_fed_id, federate, NULL);
 
-  int result = write_to_net_close_on_error(net, header_length, header_buffer);
-  if (result == 0) {
-    // Header sent successfully. Send the body.
-    result = write_to_net_close_on_error(net, length, message);
-  }
+  struct iovec vectors[] = {{.iov_base = header_buffer, .iov_len = header_length},
+                            {.iov_base = message, .iov_len = length}};
+  int result = write_to_net_v_close_on_error(net, vectors, 2);
   if (result != 0) {
     // Message did not send. Since this is used for physical connections, this is not critical.
     lf_print_warning("Failed to send message to %s. Dropping the message.", next_destination_str);
   }
-  LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+  LF_MUTEX_UNLOCK(mutex);
   return result;
 }
 
@@ -2273,6 +3039,7 @@ tag_t lf_send_next_event_tag(environment_t* env, tag_t tag, bool wait_for_reply)
       LF_PRINT_DEBUG("Granted tag " PRINTF_TAG " because the federate has neither "
                      "upstream nor downstream federates.",
                      tag.time - start_time, tag.microstep);
+      send_pending_LTC();
       return tag;
     }
 
@@ -2285,12 +3052,13 @@ tag_t lf_send_next_event_tag(environment_t* env, tag_t tag, bool wait_for_reply)
       // In case a downstream federate needs the NET of this tag or has not received any DNET, send NET.
       if (!_fed.received_any_DNET ||
           (lf_tag_compare(_fed.last_DNET, tag) < 0 && lf_tag_compare(_fed.last_DNET, _fed.last_sent_NET) >= 0)) {
-        send_tag(MSG_TYPE_NEXT_EVENT_TAG, tag);
+        send_next_event_tag_to_RTI(tag);
         _fed.last_sent_NET = tag;
         _fed.last_skipped_NET = NEVER_TAG;
         LF_PRINT_LOG("Sent a next event tag (NET) " PRINTF_TAG " to RTI based on the last DNET " PRINTF_TAG ".",
                      tag.time - start_time, tag.microstep, _fed.last_DNET.time - start_time, _fed.last_DNET.microstep);
       } else {
+        send_pending_LTC();
         _fed.last_skipped_NET = tag;
         LF_PRINT_LOG("Skip sending a next event tag (NET) " PRINTF_TAG " to RTI based on the last DNET " PRINTF_TAG
                      " and the last sent NET" PRINTF_TAG ".",
@@ -2319,11 +3087,12 @@ tag_t lf_send_next_event_tag(environment_t* env, tag_t tag, bool wait_for_reply)
       // NET is not bounded by physical time or has no downstream federates.
       // Normal case.
       if (lf_tag_compare(_fed.last_DNET, tag) < 0 || (_fed.has_upstream && lf_tag_compare(_fed.last_TAG, tag) < 0)) {
-        send_tag(MSG_TYPE_NEXT_EVENT_TAG, tag);
+        send_next_event_tag_to_RTI(tag);
         _fed.last_sent_NET = tag;
         _fed.last_skipped_NET = NEVER_TAG;
         LF_PRINT_LOG("Sent next event tag (NET) " PRINTF_TAG " to RTI.", tag.time - start_time, tag.microstep);
       } else {
+        send_pending_LTC();
         _fed.last_skipped_NET = tag;
         LF_PRINT_LOG("Skip sending next event tag (NET) " PRINTF_TAG " to RTI.", tag.time - start_time, tag.microstep);
       }
@@ -2360,7 +3129,7 @@ tag_t lf_send_next_event_tag(environment_t* env, tag_t tag, bool wait_for_reply)
           return _fed.last_TAG;
         }
         if (lf_tag_compare(next_tag, tag) != 0) {
-          send_tag(MSG_TYPE_NEXT_EVENT_TAG, next_tag);
+          send_next_event_tag_to_RTI(next_tag);
           _fed.last_sent_NET = next_tag;
           _fed.last_skipped_NET = NEVER_TAG;
           LF_PRINT_LOG("Sent next event tag (NET) " PRINTF_TAG " to RTI from loop.", next_tag.time - lf_time_start(),
@@ -2369,6 +3138,9 @@ tag_t lf_send_next_event_tag(environment_t* env, tag_t tag, bool wait_for_reply)
       }
     }
 
+    // No NET is sent until physical time advances, so the LTC cannot wait for it.
+    send_pending_LTC();
+
     if (tag.time != FOREVER) {
       // Create a dummy event that will force this federate to advance time and subsequently
       // enable progress for downstream federates. Increment the time by ADVANCE_MESSAGE_INTERVAL
@@ -2434,30 +3206,39 @@ void lf_send_port_absent_to_federate(environment_t* env, interval_t additional_d
   encode_uint16(fed_ID, &(buffer[1 + sizeof(port_ID)]));
   encode_tag(&(buffer[1 + sizeof(port_ID) + sizeof(fed_ID)]), current_message_intended_tag);
 
-  LF_MUTEX_LOCK(&lf_outbound_net_mutex);
-
 #ifdef FEDERATED_CENTRALIZED
   // Send the absent message through the RTI
+  lf_mutex_t* mutex = &lf_outbound_net_mutex;
+  LF_MUTEX_LOCK(mutex);
   net_abstraction_t net = _fed.net_to_RTI;
   if (net == NULL) {
     lf_print_warning("Network connection to federate %hu is closed. Dropping the message.", fed_ID);
-    LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+    LF_MUTEX_UNLOCK(mutex);
     return;
   }
   tracepoint_federate_to_rti(send_PORT_ABS, _lf_my_fed_id, &current_message_intended_tag);
 #else
   // Send the absent message directly to the federate
+  lf_mutex_t* mutex = &_fed.outbound_p2p_mutexes[fed_ID];
+  LF_MUTEX_LOCK(mutex);
   net_abstraction_t net = _fed.net_for_outbound_p2p_connections[fed_ID];
   if (net == NULL) {
     lf_print_warning("Network connection to federate %hu is closed. Dropping the message.", fed_ID);
-    LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+    LF_MUTEX_UNLOCK(mutex);
     return;
   }
   tracepoint_federate_to_federate(send_PORT_ABS, _lf_my_fed_id, fed_ID, &current_message_intended_tag);
 #endif
 
+#if defined(FEDERATED_P2P_BATCH_SIZE) && !defined(FEDERATED_CENTRALIZED)
+  int result = add_to_p2p_batch_locked(fed_ID, MSG_TYPE_PORT_ABSENT, port_ID, current_message_intended_tag, 0, NULL);
+#else
   int result = write_to_net_close_on_error(net, message_length, buffer);
-  LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+#endif
+  if (result == 0 && net == _fed.net_to_RTI) {
+    _fed.fenced_messages_to_RTI++;
+  }
+  LF_MUTEX_UNLOCK(mutex);
 
   if (result != 0) {
     // Write failed. Response depends on whether coordination is centralized.
@@ -2496,6 +3277,7 @@ int lf_send_stop_request_to_rti(tag_t stop_tag) {
 
     write_to_net_fail_on_error(_fed.net_to_RTI, MSG_TYPE_STOP_REQUEST_LENGTH, buffer, &lf_outbound_net_mutex,
                                "Failed to send stop time " PRINTF_TIME " to the RTI.", stop_tag.time - start_time);
+    _fed.fenced_messages_to_RTI++;
 
     // Treat this sending  as equivalent to having received a stop request from the RTI.
     _fed.received_stop_request_from_rti = true;
@@ -2507,10 +3289,13 @@ int lf_send_stop_request_to_rti(tag_t stop_tag) {
   }
 }
 
-int lf_send_tagged_message(environment_t* env, interval_t additional_delay, int message_type, unsigned short port,
-                           unsigned short federate, const char* next_destination_str, size_t length,
-                           unsigned char* message) {
-  assert(env != GLOBAL_ENVIRONMENT);
+/**
+ * Send a tagged message whose payload has been compressed if it is to be.
+ * @see lf_send_tagged_message() for the parameters.
+ */
+static int send_tagged_message(environment_t* env, interval_t additional_delay, int message_type, unsigned short port,
+                               unsigned short federate, const char* next_destination_str, size_t length,
+                               unsigned char* message) {
 
   size_t header_length =
       1 + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(instant_t) + sizeof(microstep_t);
@@ -2555,10 +3340,19 @@ int lf_send_tagged_message(environment_t* env, interval_t additional_delay, int
                current_message_intended_tag.microstep, next_destination_str);
 
   // Use a mutex lock to prevent multiple threads from simultaneously sending.
-  LF_MUTEX_LOCK(&lf_outbound_net_mutex);
+  lf_mutex_t* mutex = &lf_outbound_net_mutex;
+  LF_MUTEX_LOCK(mutex);
+
+  if (lf_tag_compare(_fed.last_DNET, current_message_intended_tag) > 0) {
+    _fed.last_DNET = current_message_intended_tag;
+  }
 
   net_abstraction_t net;
   if (message_type == MSG_TYPE_P2P_TAGGED_MESSAGE) {
+    // Sends to other federates are serialized per connection, so they do not wait for each other.
+    LF_MUTEX_UNLOCK(mutex);
+    mutex = &_fed.outbound_p2p_mutexes[federate];
+    LF_MUTEX_LOCK(mutex);
     net = _fed.net_for_outbound_p2p_connections[federate];
     tracepoint_federate_to_federate(send_P2P_TAGGED_MSG, _lf_my_fed_id, federate, &current_message_intended_tag);
   } else {
@@ -2566,15 +3360,21 @@ int lf_send_tagged_message(environment_t* env, interval_t additional_delay, int
     tracepoint_federate_to_rti(send_TAGGED_MSG, _lf_my_fed_id, &current_message_intended_tag);
   }
 
-  if (lf_tag_compare(_fed.last_DNET, current_message_intended_tag) > 0) {
-    _fed.last_DNET = current_message_intended_tag;
-  }
-
-  int result = write_to_net_close_on_error(net, header_length, header_buffer);
-  if (result == 0) {
-    // Header sent successfully. Send the body.
-    result = write_to_net_close_on_error(net, length, message);
+  int result;
+#ifdef FEDERATED_P2P_BATCH_SIZE
+  if (message_type == MSG_TYPE_P2P_TAGGED_MESSAGE && length < FEDERATED_P2P_BATCH_SIZE) {
+    result = add_to_p2p_batch_locked(federate, MSG_TYPE_P2P_TAGGED_MESSAGE, port, current_message_intended_tag, length,
+                                     message);
+    LF_MUTEX_UNLOCK(mutex);
+    return result;
+  } else if (message_type == MSG_TYPE_P2P_TAGGED_MESSAGE) {
+    // Preserve the order of messages to the federate.
+    flush_p2p_batch_locked(federate);
   }
+#endif
+  struct iovec vectors[] = {{.iov_base = header_buffer, .iov_len = header_length},
+                            {.iov_base = message, .iov_len = length}};
+  result = write_to_net_v_close_on_error(net, vectors, 2);
   if (result != 0) {
     // Message did not send. Handling depends on message type.
     if (message_type == MSG_TYPE_P2P_TAGGED_MESSAGE) {
@@ -2583,22 +3383,93 @@ int lf_send_tagged_message(environment_t* env, interval_t additional_delay, int
       lf_print_error_system_failure("Failed to send message to %s with error code %d (%s). Connection lost to the RTI.",
                                     next_destination_str, errno, strerror(errno));
     }
+  } else if (message_type == MSG_TYPE_TAGGED_MESSAGE) {
+    _fed.fenced_messages_to_RTI++;
   }
-  LF_MUTEX_UNLOCK(&lf_outbound_net_mutex);
+  LF_MUTEX_UNLOCK(mutex);
   return result;
 }
 
+int lf_send_tagged_message(environment_t* env, interval_t additional_delay, int message_type, unsigned short port,
+                           unsigned short federate, const char* next_destination_str, size_t length,
+                           unsigned char* message) {
+  assert(env != GLOBAL_ENVIRONMENT);
+#ifdef FEDERATED_COMPRESSION
+  // Compress a large payload before taking any lock, so that sends from other threads do not wait for the codec.
+  if (length >= FEDERATED_COMPRESSION_THRESHOLD && length <= UINT32_MAX && federate < NUMBER_OF_FEDERATES &&
+      _fed.compress_payloads_to[federate]) {
+    unsigned char* compressed = (unsigned char*)malloc(COMPRESSED_PAYLOAD_HEADER_SIZE + lf_compression_bound(length));
+    LF_ASSERT_NON_NULL(compressed);
+    size_t compressed_length;
+    if (lf_compress_payload(message, length, &compressed[COMPRESSED_PAYLOAD_HEADER_SIZE], &compressed_length) == 0) {
+      encode_uint32((uint32_t)length, compressed);
+      int result = send_tagged_message(env, additional_delay, message_type,
+                                       (unsigned short)(port | COMPRESSED_PAYLOAD_PORT_FLAG), federate,
+                                       next_destination_str, COMPRESSED_PAYLOAD_HEADER_SIZE + compressed_length,
+                                       compressed);
+      free(compressed);
+      return result;
+    }
+    // The payload did not get smaller, so send it as is.
+    free(compressed);
+  }
+#endif // FEDERATED_COMPRESSION
+  return send_tagged_message(env, additional_delay, message_type, port, federate, next_destination_str, length,
+                             message);
+}
+
 void lf_set_federation_id(const char* fid) { federation_metadata.federation_id = fid; }
 
 #ifdef FEDERATED_DECENTRALIZED
-void lf_spawn_staa_thread() { lf_thread_create(&_fed.staaSetter, update_ports_from_staa_offsets, NULL); }
+void lf_spawn_staa_thread() {}
 #endif // FEDERATED_DECENTRALIZED
 
+void lf_send_batched_messages_locked(environment_t* env) {
+#ifdef FEDERATED_P2P_BATCH_SIZE
+  // The writes may block on a slow peer, so they are done without the environment mutex, which
+  // the other workers and the threads receiving messages need. The lock on each outbound connection
+  // is still held while writing because it keeps the messages to the federate in order.
+  LF_MUTEX_UNLOCK(&env->mutex);
+  for (uint16_t i = 0; i < NUMBER_OF_FEDERATES; i++) {
+    LF_MUTEX_LOCK(&_fed.outbound_p2p_mutexes[i]);
+    flush_p2p_batch_locked(i);
+    LF_MUTEX_UNLOCK(&_fed.outbound_p2p_mutexes[i]);
+  }
+  LF_MUTEX_LOCK(&env->mutex);
+#else
+  (void)env;
+#endif // FEDERATED_P2P_BATCH_SIZE
+}
+
 void lf_stall_advance_level_federation_locked(size_t level) {
   LF_PRINT_DEBUG("Waiting for MLAA %d to exceed level %zu.", max_level_allowed_to_advance, level);
+  environment_t* env;
+  _lf_get_environments(&env);
+  if (((int)level) >= max_level_allowed_to_advance) {
+    // Messages that the federate being waited for may need in order to make progress must not stay batched.
+    lf_send_batched_messages_locked(env);
+  }
+#ifdef FEDERATED_DECENTRALIZED
+  // Wait for the ports to become known, but no longer than until the earliest STAA expires,
+  // at which point the ports whose STAA has expired are assumed absent.
+  instant_t now = lf_time_physical();
+  while (((int)level) >= max_level_allowed_to_advance) {
+    instant_t deadline = assume_absent_past_staa_locked(env, now);
+    if (((int)level) < max_level_allowed_to_advance) {
+      break;
+    }
+    if (deadline == FOREVER) {
+      lf_cond_wait(&lf_port_status_changed);
+      now = lf_time_physical();
+    } else {
+      now = wait_until(deadline, &lf_port_status_changed) ? deadline : lf_time_physical();
+    }
+  }
+#else
   while (((int)level) >= max_level_allowed_to_advance) {
     lf_cond_wait(&lf_port_status_changed);
   };
+#endif // FEDERATED_DECENTRALIZED
   LF_PRINT_DEBUG("Exiting wait with MLAA %d and level %zu.", max_level_allowed_to_advance, level);
 }
 
@@ -2621,9 +3492,15 @@ void lf_synchronize_with_other_federates(void) {
 
   LF_PRINT_DEBUG("Synchronizing with other federates.");
 
+  // Wait for the outbound connections to other federates, since their threads query the RTI
+  // on the connection on which the start time comes.
+  lf_wait_for_connections_to_federates();
+
   // Reset the start time to the coordinated start time for all federates.
   // Note that this does not grant execution to this federate.
-  start_time = get_start_time_from_rti(lf_time_physical());
+  instant_t phase_start = lf_time_physical();
+  start_time = get_start_time_from_rti(phase_start);
+  tracepoint_startup_phase(startup_start_time, _lf_my_fed_id, -1, phase_start);
   lf_tracing_set_start_time(start_time);
 
   // Start a thread to listen for incoming messages from the RTI.
@@ -2631,6 +3508,9 @@ void lf_synchronize_with_other_federates(void) {
   //  from the RTI in a sequential manner in the main thread. From now on, a
   //  separate thread is created to allow for asynchronous communication.
   lf_thread_create(&_fed.RTI_net_listener, listen_to_rti_net, NULL);
+  if (_fed.net_control_to_RTI != NULL) {
+    lf_thread_create(&_fed.RTI_control_listener, listen_to_rti_control_lane, NULL);
+  }
   lf_thread_t thread_id;
   if (create_clock_sync_thread(&thread_id)) {
     lf_print_warning("Failed to create thread to handle clock synchronization.");
@@ -2693,6 +3573,13 @@ bool lf_update_max_level(tag_t tag, bool is_provisional) {
   return (prev_max_level_allowed_to_advance != max_level_allowed_to_advance);
 }
 
+void lf_wait_for_connections_to_federates(void) {
+  for (size_t i = 0; i < _fed.number_of_outbound_p2p_connection_threads; i++) {
+    lf_thread_join(_fed.outbound_p2p_connection_threads[i], NULL);
+  }
+  _fed.number_of_outbound_p2p_connection_threads = 0;
+}
+
 #ifdef FEDERATED_DECENTRALIZED
 instant_t lf_wait_until_time(tag_t tag) {
   instant_t result = tag.time; // Default.
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * @brief Pools of preallocated buffers into which message payloads are received.
+ *
+ * See @ref payload_pool.h for docs.
+ */
+
+#ifdef FEDERATED
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "low_level_platform.h"
+#include "payload_pool.h"
+#include "util.h"
+
+/** Alignment of each buffer, which is also the space reserved for its header. */
+#define PAYLOAD_POOL_ALIGNMENT 64u
+
+/** Size of the huge pages requested with MAP_HUGETLB. */
+#define PAYLOAD_POOL_HUGEPAGE_SIZE (2u * 1024u * 1024u)
+
+/**
+ * Header stored immediately before each buffer, through which a buffer finds its way back to
+ * its pool when it is released.
+ */
+typedef union buffer_header_t {
+  struct {
+    /** The pool owning the buffer. */
+    lf_payload_pool_t* pool;
+    /** The next buffer not in use. */
+    union buffer_header_t* next;
+  };
+  /** Padding so that buffers are aligned. */
+  unsigned char padding[PAYLOAD_POOL_ALIGNMENT];
+} buffer_header_t;
+
+struct lf_payload_pool_t {
+  /** Mutex protecting the list of buffers not in use. */
+  lf_mutex_t mutex;
+  /** The mapping containing all buffers and their headers. */
+  void* memory;
+  /** The size of the mapping. */
+  size_t mapped_size;
+  /** The size of each buffer. */
+  size_t buffer_size;
+  /** The number of buffers. */
+  size_t count;
+  /** The number of buffers not in use. */
+  size_t available;
+  /** The buffers not in use. */
+  buffer_header_t* free_list;
+};
+
+/** Return the given size rounded up to a multiple of the given power of two. */
+static size_t round_up(size_t size, size_t multiple) { return (size + multiple - 1) & ~(multiple - 1); }
+
+/** Map anonymous memory for the buffers, using huge pages if requested and available. */
+static void* map_buffers(size_t* size, bool hugepages) {
+  void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (hugepages) {
+    size_t hugepage_size = round_up(*size, PAYLOAD_POOL_HUGEPAGE_SIZE);
+    memory = mmap(NULL, hugepage_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      *size = hugepage_size;
+      return memory;
+    }
+    LF_PRINT_LOG("No huge pages available for a payload pool. Using regular pages.");
+  }
+#endif
+  memory = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  if (hugepages) {
+    // Transparent huge pages are only a hint, so failure is harmless.
+    madvise(memory, *size, MADV_HUGEPAGE);
+  }
+#endif
+  (void)hugepages;
+  return memory;
+}
+
+lf_payload_pool_t* lf_payload_pool_create(size_t buffer_size, size_t count, bool hugepages) {
+  if (buffer_size == 0 || count == 0) {
+    return NULL;
+  }
+  size_t slot_size = sizeof(buffer_header_t) + round_up(buffer_size, PAYLOAD_POOL_ALIGNMENT);
+  if (count > SIZE_MAX / slot_size) {
+    return NULL;
+  }
+  lf_payload_pool_t* pool = (lf_payload_pool_t*)calloc(1, sizeof(lf_payload_pool_t));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->mapped_size = slot_size * count;
+  pool->memory = map_buffers(&pool->mapped_size, hugepages);
+  if (pool->memory == NULL) {
+    free(pool);
+    return NULL;
+  }
+  LF_MUTEX_INIT(&pool->mutex);
+  pool->buffer_size = buffer_size;
+  pool->count = count;
+  pool->available = count;
+  // Thread the buffers onto the free list in address order.
+  for (size_t i = count; i > 0; i--) {
+    buffer_header_t* header = (buffer_header_t*)((unsigned char*)pool->memory + (i - 1) * slot_size);
+    header->pool = pool;
+    header->next = pool->free_list;
+    pool->free_list = header;
+  }
+  return pool;
+}
+
+int lf_payload_pool_free(lf_payload_pool_t* pool) {
+  if (pool == NULL) {
+    return 0;
+  }
+  LF_MUTEX_LOCK(&pool->mutex);
+  bool in_use = pool->available != pool->count;
+  LF_MUTEX_UNLOCK(&pool->mutex);
+  if (in_use) {
+    return -1;
+  }
+  munmap(pool->memory, pool->mapped_size);
+  free(pool);
+  return 0;
+}
+
+void* lf_payload_pool_acquire(lf_payload_pool_t* pool, size_t size) {
+  if (size > pool->buffer_size) {
+    return NULL;
+  }
+  LF_MUTEX_LOCK(&pool->mutex);
+  buffer_header_t* header = pool->free_list;
+  if (header != NULL) {
+    pool->free_list = header->next;
+    pool->available--;
+  }
+  LF_MUTEX_UNLOCK(&pool->mutex);
+  return header == NULL ? NULL : header + 1;
+}
+
+void lf_payload_pool_release(void* buffer) {
+  if (buffer == NULL) {
+    return;
+  }
+  buffer_header_t* header = (buffer_header_t*)buffer - 1;
+  lf_payload_pool_t* pool = header->pool;
+  LF_MUTEX_LOCK(&pool->mutex);
+  header->next = pool->free_list;
+  pool->free_list = header;
+  pool->available++;
+  LF_MUTEX_UNLOCK(&pool->mutex);
+}
+
+size_t lf_payload_pool_available(lf_payload_pool_t* pool) {
+  LF_MUTEX_LOCK(&pool->mutex);
+  size_t available = pool->available;
+  LF_MUTEX_UNLOCK(&pool->mutex);
+  return available;
+}
+
+#endif // FEDERATED
@@ -23,6 +23,7 @@ int _lf_count_token_allocations;
 #include "environment.h"
 #include "lf_types.h"
 #include "hashset/hashset_itr.h"
+#include "metrics.h"
 #include "util.h"
 #include "platform.h" // Enter/exit critical sections
 #include "port.h"     // Defines lf_port_base_t.
@@ -188,10 +189,12 @@ token_freed _lf_free_token(lf_token_t* token) {
     if (!hashset_add(_lf_token_recycling_bin, token)) {
       lf_print_warning("Putting token %p on the recycling bin, but it is already there!", (void*)token);
     }
+    metrics_token_freed(true);
   } else {
     // Recycling bin is full.
     LF_PRINT_DEBUG("_lf_free_token: Freeing allocated memory for token: %p", (void*)token);
     free(token);
+    metrics_token_freed(false);
   }
 #if !defined NDEBUG
   _lf_count_token_allocations--;
@@ -222,6 +225,7 @@ static lf_token_t* _lf_new_token_locked(token_type_t* type, void* value, size_t
 #if !defined NDEBUG
   _lf_count_token_allocations++;
 #endif
+  metrics_token_allocated(result != NULL);
 
   if (result == NULL) {
     // Nothing found on the recycle bin.
@@ -249,6 +253,8 @@ lf_token_t* _lf_get_token(token_template_t* tmplt) {
     LF_PRINT_DEBUG("_lf_get_token: Reusing template token: %p with ref_count %zu", (void*)tmplt->token,
                    tmplt->token->ref_count);
     _lf_free_token_value(tmplt->token);
+    // The token may have been created with another type, such as one that returns its payload to a pool.
+    tmplt->token->type = (token_type_t*)tmplt;
     LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
     return tmplt->token;
   }
@@ -282,6 +288,7 @@ void _lf_initialize_template(token_template_t* tmplt, size_t element_size) {
       // Template token is already set.
       // If it has a value, free it.
       _lf_free_token_value(tmplt->token);
+      tmplt->token->type = (token_type_t*)tmplt;
       // Make sure its reference count is 1 (it should not be 0).
       tmplt->token->ref_count = 1;
       return;
@@ -35,6 +35,14 @@ if(DEFINED LF_TRACE)
             # Example: See https://github.com/lf-lang/lf-trace-xronos/blob/53e77a6b072f6b25d4fdfd53a4a3700fc199f938/tests/src/TracePluginCustomCmake.lf
             message(STATUS "Trace plugin package or library not found. Expecting user cmake-include to link the plugin.")
         endif()
+    elseif(LF_TRACE_BACKEND STREQUAL "shm")
+        # If LF_TRACE_BACKEND is "shm", publish trace records into shared memory instead of writing a file.
+        message(STATUS "Linking with shared-memory trace implementation")
+        include(${LF_ROOT}/trace/impl/CMakeLists.txt)
+        if(NOT TARGET lf::trace-shm-impl)
+            message(FATAL_ERROR "The shared-memory trace implementation is only supported on POSIX platforms.")
+        endif()
+        target_link_libraries(reactor-c PRIVATE lf::trace-shm-impl)
     else()
         # If LF_TRACE_PLUGIN not set, use the default trace plugin implementation.
         message(STATUS "Linking with default trace implementation")
@@ -0,0 +1,744 @@
+/**
+ * @file
+ * @brief Implementation of the operational counters of the runtime.
+ *
+ * Counters live in a table with one entry per environment, indexed by the position of the
+ * environment in the array returned by _lf_get_environments. They are updated with relaxed
+ * atomic operations by whichever thread observes the event, and read the same way when a
+ * snapshot is taken, so neither side takes a lock. On Linux and macOS, a thread started by
+ * _lf_metrics_init publishes snapshots to a file or a Unix domain socket. Elsewhere, and without
+ * the threaded runtime, the file is written only by _lf_metrics_shutdown.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The exporter thread uses poll, a pipe and Unix domain sockets, which only the POSIX platforms have.
+#if !defined(LF_SINGLE_THREADED) && (defined(PLATFORM_Linux) || defined(PLATFORM_Darwin))
+#define METRICS_EXPORTER
+#endif
+
+#if defined(METRICS_EXPORTER)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "metrics.h"
+#include "environment.h"
+#include "low_level_platform.h"
+#include "pqueue_tag.h"
+#include "util.h"
+
+// Counters need atomicity but no ordering with respect to other memory operations.
+#if defined(__GNUC__) || defined(__clang__)
+#define COUNTER_ADD(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+#define COUNTER_SET(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED)
+#define COUNTER_GET(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+// A table of counters allocated after the exporter thread has started is published with release semantics.
+#define TABLE_PUBLISH(table, value) __atomic_store_n(&(table), (value), __ATOMIC_RELEASE)
+#define TABLE_GET(table) __atomic_load_n(&(table), __ATOMIC_ACQUIRE)
+#else
+#define COUNTER_ADD(counter, value) lf_atomic_fetch_add64(&(counter), (value))
+#define COUNTER_SET(counter, value) ((counter) = (value))
+#define COUNTER_GET(counter) (counter)
+#define TABLE_PUBLISH(table, value) ((table) = (value))
+#define TABLE_GET(table) (table)
+#endif
+
+/** Default interval between snapshots written to a file. */
+#define METRICS_DEFAULT_INTERVAL SEC(1)
+
+/** Prefix of a destination that names a Unix domain socket. */
+#define METRICS_UNIX_PREFIX "unix:"
+
+/**
+ * The counters of one environment.
+ */
+typedef struct environment_counters_t {
+  int64_t tags;
+  int64_t reactions_queued;
+  int64_t reactions_done;
+  int64_t event_queue_size;
+  int64_t tag_lag;
+  int64_t idle_time;
+  int64_t stp_violations;
+  int64_t deadline_violations;
+  /** Number of entries in wait_starts. */
+  int num_workers;
+  /** For each worker, the time at which it started waiting or 0 if it is not waiting. */
+  int64_t* wait_starts;
+} environment_counters_t;
+
+/** The environments, as returned by _lf_get_environments. */
+static environment_t* environments = NULL;
+
+/** Number of environments. */
+static int num_environments = 0;
+
+/** The counters of each environment, or NULL before _lf_metrics_init. */
+static environment_counters_t* counters = NULL;
+
+/** Number of tokens allocated and not yet freed. */
+static int64_t tokens_live = 0;
+
+/** Number of tokens on the recycling bin. */
+static int64_t tokens_recycled = 0;
+
+/** Counters of the compression of tagged message payloads. */
+static int64_t messages_compressed = 0;
+static int64_t compression_input_bytes = 0;
+static int64_t compression_output_bytes = 0;
+static int64_t compression_cpu_time = 0;
+static int64_t messages_decompressed = 0;
+static int64_t decompression_cpu_time = 0;
+
+/**
+ * The counters of one network input port.
+ */
+typedef struct network_input_counters_t {
+  int64_t messages;
+  int64_t late_messages;
+  int64_t arrival_lag;
+  int64_t staa;
+} network_input_counters_t;
+
+/** Number of entries in network_inputs. */
+static size_t num_network_inputs = 0;
+
+/** The counters of each network input port, indexed by port ID, or NULL before _lf_metrics_network_inputs_init. */
+static network_input_counters_t* network_inputs = NULL;
+
+/** The STA offset of a federate that adapts it. */
+static int64_t sta = 0;
+
+/** Physical time at which the counters were initialized. */
+static instant_t metrics_start_time = 0;
+
+/** Where to publish snapshots or NULL to not publish them. */
+static const char* destination = NULL;
+
+/** Interval between snapshots written to a file. */
+static interval_t interval = METRICS_DEFAULT_INTERVAL;
+
+/** Value of the process label of published counters. */
+static const char* process = "main";
+
+/** The snapshot last published, from which rates are computed. */
+static lf_metrics_t previous;
+
+/** Whether `previous` holds a snapshot. */
+static bool have_previous = false;
+
+#if defined(METRICS_EXPORTER)
+/** Thread that publishes snapshots. */
+static lf_thread_t exporter;
+
+/** Whether the exporter thread was started. */
+static bool exporter_started = false;
+
+/** Pipe written to stop the exporter thread. */
+static int wakeup[2] = {-1, -1};
+
+/** Listening socket if publishing to a Unix domain socket. */
+static int listen_socket = -1;
+#endif
+
+/** Return the counters of the given environment or NULL if there are none. */
+static environment_counters_t* get_counters(environment_t* env) {
+  if (counters == NULL || env == NULL) {
+    return NULL;
+  }
+  int e = (int)(env - environments);
+  if (e < 0 || e >= num_environments) {
+    return NULL;
+  }
+  return &counters[e];
+}
+
+void _lf_metrics_tag_advanced(environment_t* env) {
+  environment_counters_t* c = get_counters(env);
+  if (c == NULL) {
+    return;
+  }
+  COUNTER_ADD(c->tags, 1);
+  COUNTER_SET(c->event_queue_size, (int64_t)pqueue_tag_size(env->event_q));
+  COUNTER_SET(c->tag_lag, lf_time_physical() - env->current_tag.time);
+}
+
+void _lf_metrics_reaction_queued(environment_t* env) {
+  environment_counters_t* c = get_counters(env);
+  if (c != NULL) {
+    COUNTER_ADD(c->reactions_queued, 1);
+  }
+}
+
+void _lf_metrics_reaction_done(environment_t* env) {
+  environment_counters_t* c = get_counters(env);
+  if (c != NULL) {
+    COUNTER_ADD(c->reactions_done, 1);
+  }
+}
+
+void _lf_metrics_worker_wait_starts(environment_t* env, int worker) {
+  environment_counters_t* c = get_counters(env);
+  if (c != NULL && worker >= 0 && worker < c->num_workers) {
+    COUNTER_SET(c->wait_starts[worker], lf_time_physical());
+  }
+}
+
+void _lf_metrics_worker_wait_ends(environment_t* env, int worker) {
+  environment_counters_t* c = get_counters(env);
+  if (c != NULL && worker >= 0 && worker < c->num_workers) {
+    int64_t started = COUNTER_GET(c->wait_starts[worker]);
+    if (started != 0) {
+      COUNTER_SET(c->wait_starts[worker], 0);
+      COUNTER_ADD(c->idle_time, lf_time_physical() - started);
+    }
+  }
+}
+
+void _lf_metrics_stp_violation(environment_t* env) {
+  environment_counters_t* c = get_counters(env);
+  if (c != NULL) {
+    COUNTER_ADD(c->stp_violations, 1);
+  }
+}
+
+void _lf_metrics_deadline_violation(environment_t* env) {
+  environment_counters_t* c = get_counters(env);
+  if (c != NULL) {
+    COUNTER_ADD(c->deadline_violations, 1);
+  }
+}
+
+void _lf_metrics_token_allocated(bool recycled) {
+  COUNTER_ADD(tokens_live, 1);
+  if (recycled) {
+    COUNTER_ADD(tokens_recycled, -1);
+  }
+}
+
+void _lf_metrics_token_freed(bool recycled) {
+  COUNTER_ADD(tokens_live, -1);
+  if (recycled) {
+    COUNTER_ADD(tokens_recycled, 1);
+  }
+}
+
+void _lf_metrics_message_compressed(size_t input_bytes, size_t output_bytes, interval_t cpu_time) {
+  COUNTER_ADD(messages_compressed, 1);
+  COUNTER_ADD(compression_input_bytes, (int64_t)input_bytes);
+  COUNTER_ADD(compression_output_bytes, (int64_t)output_bytes);
+  COUNTER_ADD(compression_cpu_time, cpu_time);
+}
+
+void _lf_metrics_message_decompressed(interval_t cpu_time) {
+  COUNTER_ADD(messages_decompressed, 1);
+  COUNTER_ADD(decompression_cpu_time, cpu_time);
+}
+
+void _lf_metrics_network_inputs_init(size_t count) {
+  if (network_inputs != NULL || count == 0) {
+    return;
+  }
+  network_input_counters_t* table = (network_input_counters_t*)calloc(count, sizeof(network_input_counters_t));
+  LF_ASSERT_NON_NULL(table);
+  num_network_inputs = count;
+  TABLE_PUBLISH(network_inputs, table);
+}
+
+void _lf_metrics_sta_set(interval_t value) { COUNTER_SET(sta, value); }
+
+void _lf_metrics_staa_set(int port, interval_t staa) {
+  network_input_counters_t* table = TABLE_GET(network_inputs);
+  if (table != NULL && port >= 0 && (size_t)port < num_network_inputs) {
+    COUNTER_SET(table[port].staa, staa);
+  }
+}
+
+void _lf_metrics_network_input_message(int port, interval_t arrival_lag, bool late) {
+  network_input_counters_t* table = TABLE_GET(network_inputs);
+  if (table != NULL && port >= 0 && (size_t)port < num_network_inputs) {
+    COUNTER_ADD(table[port].messages, 1);
+    COUNTER_SET(table[port].arrival_lag, arrival_lag);
+    if (late) {
+      COUNTER_ADD(table[port].late_messages, 1);
+    }
+  }
+}
+
+int lf_metrics_snapshot(lf_metrics_t* metrics) {
+  memset(metrics, 0, sizeof(lf_metrics_t));
+  if (counters == NULL) {
+    return -1;
+  }
+  metrics->time = lf_time_physical();
+  metrics->elapsed = metrics->time - metrics_start_time;
+  metrics->tokens_live = COUNTER_GET(tokens_live);
+  metrics->tokens_recycled = COUNTER_GET(tokens_recycled);
+  metrics->messages_compressed = COUNTER_GET(messages_compressed);
+  metrics->compression_input_bytes = COUNTER_GET(compression_input_bytes);
+  metrics->compression_output_bytes = COUNTER_GET(compression_output_bytes);
+  metrics->compression_cpu_time = COUNTER_GET(compression_cpu_time);
+  metrics->messages_decompressed = COUNTER_GET(messages_decompressed);
+  metrics->decompression_cpu_time = COUNTER_GET(decompression_cpu_time);
+  metrics->sta = COUNTER_GET(sta);
+  network_input_counters_t* table = TABLE_GET(network_inputs);
+  if (table != NULL) {
+    metrics->num_network_inputs = num_network_inputs;
+    metrics->network_inputs =
+        (lf_network_input_metrics_t*)calloc(num_network_inputs, sizeof(lf_network_input_metrics_t));
+    LF_ASSERT_NON_NULL(metrics->network_inputs);
+    for (size_t i = 0; i < num_network_inputs; i++) {
+      lf_network_input_metrics_t* m = &metrics->network_inputs[i];
+      m->port = (int)i;
+      m->messages = COUNTER_GET(table[i].messages);
+      m->late_messages = COUNTER_GET(table[i].late_messages);
+      m->arrival_lag = COUNTER_GET(table[i].arrival_lag);
+      m->staa = COUNTER_GET(table[i].staa);
+    }
+  }
+  metrics->num_environments = (size_t)num_environments;
+  metrics->environments = (lf_environment_metrics_t*)calloc(num_environments, sizeof(lf_environment_metrics_t));
+  LF_ASSERT_NON_NULL(metrics->environments);
+  for (int e = 0; e < num_environments; e++) {
+    environment_counters_t* c = &counters[e];
+    lf_environment_metrics_t* m = &metrics->environments[e];
+    m->environment = environments[e].id;
+    m->name = environments[e].name;
+    m->workers = c->num_workers;
+    m->tags = COUNTER_GET(c->tags);
+    m->reactions_queued = COUNTER_GET(c->reactions_queued);
+    m->reactions_done = COUNTER_GET(c->reactions_done);
+    m->event_queue_size = COUNTER_GET(c->event_queue_size);
+    m->tag_lag = COUNTER_GET(c->tag_lag);
+    m->idle_time = COUNTER_GET(c->idle_time);
+    m->stp_violations = COUNTER_GET(c->stp_violations);
+    m->deadline_violations = COUNTER_GET(c->deadline_violations);
+    // Include the waits that are in progress, so that a worker that waits for a long time counts as idle.
+    for (int w = 0; w < c->num_workers; w++) {
+      int64_t started = COUNTER_GET(c->wait_starts[w]);
+      if (started != 0 && started < metrics->time) {
+        m->idle_time += metrics->time - started;
+      }
+    }
+  }
+  return 0;
+}
+
+void lf_metrics_free(lf_metrics_t* metrics) {
+  free(metrics->environments);
+  metrics->environments = NULL;
+  metrics->num_environments = 0;
+  free(metrics->network_inputs);
+  metrics->network_inputs = NULL;
+  metrics->num_network_inputs = 0;
+}
+
+/** Write a label value, escaped as the exposition format requires. */
+static void write_label_value(FILE* file, const char* value) {
+  for (const char* c = value != NULL ? value : ""; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+      fputc(*c, file);
+    } else if (*c == '\n') {
+      fputs("\\n", file);
+    } else {
+      fputc(*c, file);
+    }
+  }
+}
+
+/** Write the HELP and TYPE lines of a metric. */
+static void write_header(FILE* file, const char* name, const char* type, const char* help) {
+  fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/** Write the name and labels of a sample, leaving the value to the caller. */
+static void write_sample_name(FILE* file, const char* name, const lf_environment_metrics_t* env) {
+  fprintf(file, "%s{process=\"", name);
+  write_label_value(file, process);
+  if (env != NULL) {
+    fprintf(file, "\",environment=\"");
+    write_label_value(file, env->name);
+  }
+  fprintf(file, "\"} ");
+}
+
+/** Write the name and labels of a sample of a network input port, leaving the value to the caller. */
+static void write_port_sample_name(FILE* file, const char* name, int port) {
+  fprintf(file, "%s{process=\"", name);
+  write_label_value(file, process);
+  fprintf(file, "\",port=\"%d\"} ", port);
+}
+
+/** Return the ratio of two numbers or 0 if the denominator is not positive. */
+static double ratio(double numerator, double denominator) { return denominator > 0.0 ? numerator / denominator : 0.0; }
+
+void lf_metrics_write_prometheus(FILE* file, const lf_metrics_t* metrics, const lf_metrics_t* previous) {
+  if (previous != NULL && previous->num_environments != metrics->num_environments) {
+    previous = NULL;
+  }
+  double window = (double)(previous != NULL ? metrics->time - previous->time : metrics->elapsed);
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_tags_total", "counter", "Number of tags the environment has advanced to.");
+    }
+    write_sample_name(file, "lf_tags_total", env);
+    fprintf(file, "%lld\n", (long long)env->tags);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    const lf_environment_metrics_t* before = previous != NULL ? &previous->environments[i] : NULL;
+    if (i == 0) {
+      write_header(file, "lf_tags_per_second", "gauge", "Rate at which the environment advances its tag.");
+    }
+    write_sample_name(file, "lf_tags_per_second", env);
+    fprintf(file, "%.6g\n", ratio((double)(env->tags - (before != NULL ? before->tags : 0)) * 1e9, window));
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_reactions_total", "counter", "Number of reactions taken off the reaction queue.");
+    }
+    write_sample_name(file, "lf_reactions_total", env);
+    fprintf(file, "%lld\n", (long long)env->reactions_done);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_reaction_queue_depth", "gauge", "Number of reactions queued or executing.");
+    }
+    write_sample_name(file, "lf_reaction_queue_depth", env);
+    fprintf(file, "%lld\n", (long long)(env->reactions_queued - env->reactions_done));
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_event_queue_size", "gauge", "Number of events on the event queue at the last tag.");
+    }
+    write_sample_name(file, "lf_event_queue_size", env);
+    fprintf(file, "%lld\n", (long long)env->event_queue_size);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_tag_lag_seconds", "gauge", "Physical time minus logical time at the last tag.");
+    }
+    write_sample_name(file, "lf_tag_lag_seconds", env);
+    fprintf(file, "%.9f\n", (double)env->tag_lag / 1e9);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_workers", "gauge", "Number of workers of the environment.");
+    }
+    write_sample_name(file, "lf_workers", env);
+    fprintf(file, "%d\n", env->workers);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_worker_idle_seconds_total", "counter", "Time the workers have spent waiting for work.");
+    }
+    write_sample_name(file, "lf_worker_idle_seconds_total", env);
+    fprintf(file, "%.9f\n", (double)env->idle_time / 1e9);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    const lf_environment_metrics_t* before = previous != NULL ? &previous->environments[i] : NULL;
+    if (i == 0) {
+      write_header(file, "lf_worker_idle_fraction", "gauge", "Fraction of the time the workers were waiting for work.");
+    }
+    write_sample_name(file, "lf_worker_idle_fraction", env);
+    double idle = (double)(env->idle_time - (before != NULL ? before->idle_time : 0));
+    fprintf(file, "%.6g\n", ratio(idle, window * env->workers));
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_stp_violations_total", "counter", "Number of triggers that arrived after their tag.");
+    }
+    write_sample_name(file, "lf_stp_violations_total", env);
+    fprintf(file, "%lld\n", (long long)env->stp_violations);
+  }
+  for (size_t i = 0; i < metrics->num_environments; i++) {
+    const lf_environment_metrics_t* env = &metrics->environments[i];
+    if (i == 0) {
+      write_header(file, "lf_deadline_violations_total", "counter", "Number of reactions that missed their deadline.");
+    }
+    write_sample_name(file, "lf_deadline_violations_total", env);
+    fprintf(file, "%lld\n", (long long)env->deadline_violations);
+  }
+  write_header(file, "lf_tokens_live", "gauge", "Number of tokens allocated and not yet freed.");
+  write_sample_name(file, "lf_tokens_live", NULL);
+  fprintf(file, "%lld\n", (long long)metrics->tokens_live);
+  write_header(file, "lf_tokens_recycled", "gauge", "Number of freed tokens on the recycling bin.");
+  write_sample_name(file, "lf_tokens_recycled", NULL);
+  fprintf(file, "%lld\n", (long long)metrics->tokens_recycled);
+#ifdef FEDERATED_COMPRESSION
+  write_header(file, "lf_compressed_messages_total", "counter", "Number of payloads offered to the codec.");
+  write_sample_name(file, "lf_compressed_messages_total", NULL);
+  fprintf(file, "%lld\n", (long long)metrics->messages_compressed);
+  write_header(file, "lf_compression_input_bytes_total", "counter", "Size of the payloads offered to the codec.");
+  write_sample_name(file, "lf_compression_input_bytes_total", NULL);
+  fprintf(file, "%lld\n", (long long)metrics->compression_input_bytes);
+  write_header(file, "lf_compression_output_bytes_total", "counter", "Size of these payloads as sent.");
+  write_sample_name(file, "lf_compression_output_bytes_total", NULL);
+  fprintf(file, "%lld\n", (long long)metrics->compression_output_bytes);
+  write_header(file, "lf_compression_ratio", "gauge",
+               "Size of the payloads offered to the codec over their size as sent.");
+  write_sample_name(file, "lf_compression_ratio", NULL);
+  fprintf(file, "%.6g\n", ratio((double)metrics->compression_input_bytes, (double)metrics->compression_output_bytes));
+  write_header(file, "lf_compression_cpu_seconds_total", "counter", "CPU time spent compressing payloads.");
+  write_sample_name(file, "lf_compression_cpu_seconds_total", NULL);
+  fprintf(file, "%.9f\n", (double)metrics->compression_cpu_time / 1e9);
+  write_header(file, "lf_decompressed_messages_total", "counter", "Number of payloads decompressed.");
+  write_sample_name(file, "lf_decompressed_messages_total", NULL);
+  fprintf(file, "%lld\n", (long long)metrics->messages_decompressed);
+  write_header(file, "lf_decompression_cpu_seconds_total", "counter", "CPU time spent decompressing payloads.");
+  write_sample_name(file, "lf_decompression_cpu_seconds_total", NULL);
+  fprintf(file, "%.9f\n", (double)metrics->decompression_cpu_time / 1e9);
+#endif // FEDERATED_COMPRESSION
+  if (metrics->num_network_inputs == 0) {
+    return;
+  }
+  write_header(file, "lf_sta_seconds", "gauge", "The safe-to-advance (STA) offset of the federate.");
+  write_sample_name(file, "lf_sta_seconds", NULL);
+  fprintf(file, "%.9f\n", (double)metrics->sta / 1e9);
+  const lf_network_input_metrics_t* inputs = metrics->network_inputs;
+  write_header(file, "lf_staa_seconds", "gauge", "The safe-to-assume-absent (STAA) offset of the network input port.");
+  for (size_t i = 0; i < metrics->num_network_inputs; i++) {
+    write_port_sample_name(file, "lf_staa_seconds", inputs[i].port);
+    fprintf(file, "%.9f\n", (double)inputs[i].staa / 1e9);
+  }
+  write_header(file, "lf_network_input_messages_total", "counter", "Number of messages that arrived on the port.");
+  for (size_t i = 0; i < metrics->num_network_inputs; i++) {
+    write_port_sample_name(file, "lf_network_input_messages_total", inputs[i].port);
+    fprintf(file, "%lld\n", (long long)inputs[i].messages);
+  }
+  write_header(file, "lf_network_input_late_messages_total", "counter",
+               "Number of messages that arrived later than the STA plus the STAA after their intended time.");
+  for (size_t i = 0; i < metrics->num_network_inputs; i++) {
+    write_port_sample_name(file, "lf_network_input_late_messages_total", inputs[i].port);
+    fprintf(file, "%lld\n", (long long)inputs[i].late_messages);
+  }
+  write_header(file, "lf_network_input_arrival_lag_seconds", "gauge",
+               "Physical time of arrival minus intended time of the last message on the port.");
+  for (size_t i = 0; i < metrics->num_network_inputs; i++) {
+    write_port_sample_name(file, "lf_network_input_arrival_lag_seconds", inputs[i].port);
+    fprintf(file, "%.9f\n", (double)inputs[i].arrival_lag / 1e9);
+  }
+}
+
+/**
+ * Take a snapshot and write it to the given file, computing rates since the last snapshot published.
+ */
+static void publish(FILE* file) {
+  lf_metrics_t current;
+  if (lf_metrics_snapshot(&current) != 0) {
+    return;
+  }
+  lf_metrics_write_prometheus(file, &current, have_previous ? &previous : NULL);
+  lf_metrics_free(&previous);
+  previous = current;
+  have_previous = true;
+}
+
+/**
+ * Replace the destination file with a fresh snapshot.
+ * The snapshot is written to a temporary file that is then renamed so that readers never see a partial snapshot.
+ */
+static void publish_to_file(void) {
+  size_t length = strlen(destination) + 5;
+  char* temporary = (char*)malloc(length);
+  LF_ASSERT_NON_NULL(temporary);
+  snprintf(temporary, length, "%s.tmp", destination);
+  FILE* file = fopen(temporary, "w");
+  if (file == NULL) {
+    lf_print_warning("Failed to open %s for writing metrics: %s", temporary, strerror(errno));
+  } else {
+    publish(file);
+    fclose(file);
+    if (rename(temporary, destination) != 0) {
+      lf_print_warning("Failed to replace %s with new metrics: %s", destination, strerror(errno));
+    }
+  }
+  free(temporary);
+}
+
+#if defined(METRICS_EXPORTER)
+/**
+ * Write a snapshot to a client of the Unix domain socket and close the connection.
+ */
+static void publish_to_client(int client) {
+  char* text = NULL;
+  size_t length = 0;
+  FILE* buffer = open_memstream(&text, &length);
+  if (buffer != NULL) {
+    publish(buffer);
+    fclose(buffer);
+    for (size_t written = 0; written < length;) {
+      ssize_t result = send(client, text + written, length - written, MSG_NOSIGNAL);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        break;
+      }
+      written += (size_t)result;
+    }
+    free(text);
+  }
+  close(client);
+}
+
+/**
+ * Thread that publishes a snapshot to each client of the socket or to the file every interval,
+ * until something is written to the wakeup pipe.
+ */
+static void* metrics_exporter(void* ignored) {
+  (void)ignored;
+  struct pollfd fds[2] = {{.fd = wakeup[0], .events = POLLIN}, {.fd = listen_socket, .events = POLLIN}};
+  nfds_t num_fds = listen_socket >= 0 ? 2 : 1;
+  int timeout = listen_socket >= 0 ? -1 : (int)(interval / MSEC(1));
+  while (true) {
+    int ready = poll(fds, num_fds, timeout);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      lf_print_warning("Stopped publishing metrics: %s", strerror(errno));
+      break;
+    }
+    if (fds[0].revents != 0) {
+      break;
+    }
+    if (listen_socket >= 0) {
+      if (fds[1].revents & POLLIN) {
+        int client = accept(listen_socket, NULL, NULL);
+        if (client >= 0) {
+          publish_to_client(client);
+        }
+      }
+    } else if (ready == 0) {
+      publish_to_file();
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Listen on the Unix domain socket at the given path.
+ * @return The listening socket or -1 on failure.
+ */
+static int listen_on_unix_socket(const char* path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    lf_print_warning("Metrics socket path is too long: %s", path);
+    return -1;
+  }
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  int result = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (result < 0) {
+    lf_print_warning("Failed to create metrics socket: %s", strerror(errno));
+    return -1;
+  }
+  // Remove a socket left behind by an earlier run.
+  unlink(path);
+  if (bind(result, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(result, 8) != 0) {
+    lf_print_warning("Failed to listen for metrics clients on %s: %s", path, strerror(errno));
+    close(result);
+    return -1;
+  }
+  return result;
+}
+#endif // METRICS_EXPORTER
+
+void _lf_metrics_set_destination(const char* value) { destination = value; }
+
+void _lf_metrics_set_interval(interval_t value) {
+  if (value >= MSEC(1)) {
+    interval = value;
+  } else {
+    lf_print_warning("Metrics interval must be at least one millisecond. Using the default.");
+  }
+}
+
+void _lf_metrics_init(const char* process_name) {
+  process = process_name;
+  num_environments = _lf_get_environments(&environments);
+  counters = (environment_counters_t*)calloc(num_environments, sizeof(environment_counters_t));
+  LF_ASSERT_NON_NULL(counters);
+  for (int i = 0; i < num_environments; i++) {
+#if defined(LF_SINGLE_THREADED)
+    counters[i].num_workers = 1;
+#else
+    counters[i].num_workers = environments[i].num_workers > 0 ? (int)environments[i].num_workers : 1;
+#endif
+    counters[i].wait_starts = (int64_t*)calloc(counters[i].num_workers, sizeof(int64_t));
+    LF_ASSERT_NON_NULL(counters[i].wait_starts);
+  }
+  metrics_start_time = lf_time_physical();
+  if (destination == NULL) {
+    return;
+  }
+  bool unix_socket = strncmp(destination, METRICS_UNIX_PREFIX, strlen(METRICS_UNIX_PREFIX)) == 0;
+#if !defined(METRICS_EXPORTER)
+  if (unix_socket) {
+    lf_print_warning("Publishing metrics to a socket requires the threaded runtime on Linux or macOS. "
+                     "Not publishing metrics.");
+    destination = NULL;
+  }
+#else
+  if (unix_socket) {
+    listen_socket = listen_on_unix_socket(destination + strlen(METRICS_UNIX_PREFIX));
+    if (listen_socket < 0) {
+      destination = NULL;
+      return;
+    }
+  }
+  if (pipe(wakeup) != 0 || lf_thread_create(&exporter, metrics_exporter, NULL) != 0) {
+    lf_print_warning("Failed to start publishing metrics.");
+    return;
+  }
+  exporter_started = true;
+#endif
+}
+
+void _lf_metrics_shutdown(void) {
+  if (counters == NULL || destination == NULL) {
+    return;
+  }
+#if defined(METRICS_EXPORTER)
+  if (exporter_started) {
+    if (write(wakeup[1], "", 1) != 1) {
+      lf_print_warning("Failed to stop publishing metrics.");
+    } else {
+      lf_thread_join(exporter, NULL);
+    }
+    exporter_started = false;
+    close(wakeup[0]);
+    close(wakeup[1]);
+  }
+  if (listen_socket >= 0) {
+    close(listen_socket);
+    listen_socket = -1;
+    unlink(destination + strlen(METRICS_UNIX_PREFIX));
+    destination = NULL;
+    lf_metrics_free(&previous);
+    have_previous = false;
+    return;
+  }
+#endif
+  publish_to_file();
+  destination = NULL;
+  lf_metrics_free(&previous);
+  have_previous = false;
+}
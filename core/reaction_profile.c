@@ -0,0 +1,455 @@
+/**
+ * @file
+ * @brief Implementation of always-on profiling of reaction execution times.
+ *
+ * Each worker of each environment owns a table of profiles, indexed by a hashmap from the
+ * reaction pointer that only the owning worker uses. The worker records into a profile without
+ * taking a lock, under a sequence lock that a snapshot checks to tell whether its copy of the
+ * profile is consistent. The mutex of a table is taken only to add a profile to it and by a
+ * snapshot to go through its profiles, so a worker takes it once for each of its reactions.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "reaction_profile.h"
+#include "environment.h"
+#include "low_level_platform.h"
+#include "reactor.h"
+#include "util.h"
+
+// Hashmap from a reaction to the index of its profile in a worker's table.
+#define HASHMAP(token) reaction_profile_map##_##token
+#define K void*
+#define V size_t
+#define HASH_OF(key) reaction_profile_hash(key)
+
+/** Spread the bits of a pointer, whose low bits are mostly zero, over the hash. */
+static inline size_t reaction_profile_hash(void* pointer) {
+  size_t hash = (size_t)pointer >> 3;
+  hash ^= hash >> 16;
+  return hash * 0x45d9f3b;
+}
+
+#include "core/utils/impl/hashmap.h"
+#undef HASHMAP
+#undef K
+#undef V
+#undef HASH_OF
+
+/** Initial capacity of the table of profiles of a worker. */
+#define REACTION_PROFILE_INITIAL_CAPACITY 16
+
+/**
+ * A profile that a worker records into.
+ */
+typedef struct recorded_profile_t {
+  /** Number of records started or completed, odd while the worker records into the profile. */
+  uint32_t sequence;
+  lf_reaction_profile_t profile;
+} recorded_profile_t;
+
+/**
+ * The profiles recorded by one worker.
+ */
+typedef struct profile_table_t {
+#if !defined(LF_SINGLE_THREADED)
+  /** Guards `profiles` and `size`, which the worker changes only to add a profile. */
+  lf_mutex_t mutex;
+#endif
+  /** Index of the profiles, used only by the worker. */
+  reaction_profile_map_t* index;
+  recorded_profile_t** profiles;
+  size_t size;
+  size_t capacity;
+} profile_table_t;
+
+/** The environments, as returned by _lf_get_environments. */
+static environment_t* environments = NULL;
+
+/** Number of environments. */
+static int num_environments = 0;
+
+/** For each environment, the first of its tables in `tables`. */
+static size_t* first_table = NULL;
+
+/** For each environment, the number of its tables. */
+static size_t* num_tables = NULL;
+
+/** The tables of all workers of all environments. */
+static profile_table_t* tables = NULL;
+
+/** Root of the names of the output files. */
+static char file_root[LF_REACTION_PROFILE_NAME_LENGTH];
+
+/**
+ * Return the table of the given worker of the given environment or NULL if there is none.
+ * Workers are numbered from 0 to the number of workers of their environment, so there is a table
+ * for each of them, and no two threads record into the same table.
+ */
+static profile_table_t* get_table(environment_t* env, int worker) {
+  int e = (int)(env - environments);
+  if (e < 0 || e >= num_environments || worker < 0 || (size_t)worker >= num_tables[e]) {
+    return NULL;
+  }
+  return &tables[first_table[e] + worker];
+}
+
+/**
+ * Create the profile of a reaction seen by a worker for the first time.
+ */
+static recorded_profile_t* new_profile(profile_table_t* table, environment_t* env, reaction_t* reaction) {
+  recorded_profile_t* recorded = (recorded_profile_t*)calloc(1, sizeof(recorded_profile_t));
+  LF_ASSERT_NON_NULL(recorded);
+  lf_reaction_profile_t* profile = &recorded->profile;
+  profile->reaction = reaction;
+  profile->environment = env->id;
+  profile->number = reaction->number;
+  profile->deadline = reaction->deadline;
+  // Reactions of a reactor are mutually exclusive, so this is as safe as calling it from the reaction.
+  const char* name = lf_reactor_full_name((self_base_t*)reaction->self);
+  strncpy(profile->reactor, name != NULL ? name : "", LF_REACTION_PROFILE_NAME_LENGTH - 1);
+#if !defined(LF_SINGLE_THREADED)
+  LF_MUTEX_LOCK(&table->mutex);
+#endif
+  if (table->size == table->capacity) {
+    size_t capacity = table->capacity == 0 ? REACTION_PROFILE_INITIAL_CAPACITY : 2 * table->capacity;
+    recorded_profile_t** profiles =
+        (recorded_profile_t**)realloc(table->profiles, capacity * sizeof(recorded_profile_t*));
+    LF_ASSERT_NON_NULL(profiles);
+    table->profiles = profiles;
+    table->capacity = capacity;
+  }
+  table->profiles[table->size] = recorded;
+  reaction_profile_map_put(table->index, reaction, table->size);
+  table->size++;
+#if !defined(LF_SINGLE_THREADED)
+  LF_MUTEX_UNLOCK(&table->mutex);
+#endif
+  return recorded;
+}
+
+void _lf_reaction_profile_init(const char* process_name, int process_id) {
+  num_environments = _lf_get_environments(&environments);
+  first_table = (size_t*)calloc(num_environments, sizeof(size_t));
+  num_tables = (size_t*)calloc(num_environments, sizeof(size_t));
+  LF_ASSERT_NON_NULL(first_table);
+  LF_ASSERT_NON_NULL(num_tables);
+  size_t total = 0;
+  for (int i = 0; i < num_environments; i++) {
+    first_table[i] = total;
+#if defined(LF_SINGLE_THREADED)
+    num_tables[i] = 1;
+#else
+    num_tables[i] = environments[i].num_workers > 0 ? (size_t)environments[i].num_workers : 1;
+#endif
+    total += num_tables[i];
+  }
+  tables = (profile_table_t*)calloc(total, sizeof(profile_table_t));
+  LF_ASSERT_NON_NULL(tables);
+  for (size_t i = 0; i < total; i++) {
+#if !defined(LF_SINGLE_THREADED)
+    LF_MUTEX_INIT(&tables[i].mutex);
+#endif
+    tables[i].index = reaction_profile_map_new(2 * REACTION_PROFILE_INITIAL_CAPACITY, NULL);
+  }
+  snprintf(file_root, sizeof(file_root), "%s_%d_profile", process_name, process_id);
+}
+
+void _lf_reaction_profile_record(environment_t* env, reaction_t* reaction, int worker, instant_t start,
+                                 instant_t end) {
+  profile_table_t* table = get_table(env, worker);
+  if (table == NULL) {
+    return;
+  }
+  size_t index;
+  recorded_profile_t* recorded;
+  if (reaction_profile_map_find(table->index, reaction, &index)) {
+    // Only this worker changes the table, so it reads it without the mutex.
+    recorded = table->profiles[index];
+  } else {
+    recorded = new_profile(table, env, reaction);
+  }
+  lf_reaction_profile_t* profile = &recorded->profile;
+  uint32_t sequence = recorded->sequence;
+  __atomic_store_n(&recorded->sequence, sequence + 1, __ATOMIC_RELAXED);
+  // Order the change of the sequence number before the changes of the histograms.
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  log_histogram_nonnegative_record(&profile->exec_time, end - start);
+  log_histogram_record(&profile->lag, start - env->current_tag.time);
+  if (reaction->deadline >= 0LL && reaction->deadline < FOREVER) {
+    log_histogram_record(&profile->slack, lf_time_add(env->current_tag.time, reaction->deadline) - start);
+  }
+  __atomic_store_n(&recorded->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Copy the buckets of a histogram from the first to the last one that a value between the
+ * recorded minimum and maximum can fall in. The other buckets of the destination are left alone.
+ */
+static void copy_buckets(uint64_t* destination, const uint64_t* source, int64_t smallest, int64_t largest) {
+  int first = log_histogram_bucket(smallest);
+  int last = log_histogram_bucket(largest);
+  if (first <= last) {
+    memcpy(&destination[first], &source[first], (size_t)(last - first + 1) * sizeof(uint64_t));
+  }
+}
+
+/** Copy the nonempty range of a histogram into a histogram that is empty. */
+static void copy_histogram(log_histogram_t* destination, const log_histogram_t* source) {
+  destination->count = source->count;
+  destination->total = source->total;
+  destination->min = source->min;
+  destination->max = source->max;
+  if (source->count == 0) {
+    return;
+  }
+  if (source->max >= 0) {
+    copy_buckets(destination->buckets, source->buckets, source->min < 0 ? 0 : source->min, source->max);
+  }
+  if (source->min < 0) {
+    copy_buckets(destination->negative_buckets, source->negative_buckets,
+                 source->max < 0 ? log_histogram_magnitude(source->max) : 1, log_histogram_magnitude(source->min));
+  }
+}
+
+/** Copy the nonempty range of a histogram into a histogram that is empty. */
+static void copy_nonnegative_histogram(log_histogram_nonnegative_t* destination,
+                                       const log_histogram_nonnegative_t* source) {
+  destination->count = source->count;
+  destination->total = source->total;
+  destination->min = source->min;
+  destination->max = source->max;
+  if (source->count > 0) {
+    copy_buckets(destination->buckets, source->buckets, source->min, source->max);
+  }
+}
+
+/**
+ * Copy a profile that its worker may be recording into, retrying until no record overlapped the copy.
+ * Only the buckets that can be nonempty are copied, so that a copy takes little longer than a record.
+ */
+static void copy_profile(lf_reaction_profile_t* destination, recorded_profile_t* recorded) {
+  while (true) {
+    uint32_t sequence = __atomic_load_n(&recorded->sequence, __ATOMIC_ACQUIRE);
+    if (sequence & 1u) {
+      continue;
+    }
+    memset(destination, 0, sizeof(lf_reaction_profile_t));
+    const lf_reaction_profile_t* source = &recorded->profile;
+    destination->reaction = source->reaction;
+    destination->environment = source->environment;
+    memcpy(destination->reactor, source->reactor, LF_REACTION_PROFILE_NAME_LENGTH);
+    destination->number = source->number;
+    destination->deadline = source->deadline;
+    copy_nonnegative_histogram(&destination->exec_time, &source->exec_time);
+    copy_histogram(&destination->lag, &source->lag);
+    copy_histogram(&destination->slack, &source->slack);
+    // Order the reads of the histograms before the check of the sequence number.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&recorded->sequence, __ATOMIC_RELAXED) == sequence) {
+      return;
+    }
+  }
+}
+
+/** Order profiles by environment, reactor name and reaction number. */
+static int compare_profiles(const void* a, const void* b) {
+  const lf_reaction_profile_t* x = (const lf_reaction_profile_t*)a;
+  const lf_reaction_profile_t* y = (const lf_reaction_profile_t*)b;
+  if (x->environment != y->environment) {
+    return x->environment < y->environment ? -1 : 1;
+  }
+  int result = strcmp(x->reactor, y->reactor);
+  if (result != 0) {
+    return result;
+  }
+  return (x->number > y->number) - (x->number < y->number);
+}
+
+size_t lf_reaction_profile_snapshot(lf_reaction_profile_t** profiles) {
+  *profiles = NULL;
+  if (tables == NULL) {
+    return 0;
+  }
+  size_t count = 0;
+  size_t capacity = 0;
+  lf_reaction_profile_t* result = NULL;
+  lf_reaction_profile_t* copy = (lf_reaction_profile_t*)malloc(sizeof(lf_reaction_profile_t));
+  LF_ASSERT_NON_NULL(copy);
+  for (int e = 0; e < num_environments; e++) {
+    // Profiles of the same reaction recorded by different workers of an environment are merged.
+    reaction_profile_map_t* merged = reaction_profile_map_new(2 * REACTION_PROFILE_INITIAL_CAPACITY, NULL);
+    for (size_t w = first_table[e]; w < first_table[e] + num_tables[e]; w++) {
+      profile_table_t* table = &tables[w];
+#if !defined(LF_SINGLE_THREADED)
+      LF_MUTEX_LOCK(&table->mutex);
+#endif
+      for (size_t i = 0; i < table->size; i++) {
+        copy_profile(copy, table->profiles[i]);
+        size_t index;
+        if (reaction_profile_map_find(merged, (void*)copy->reaction, &index)) {
+          log_histogram_nonnegative_merge(&result[index].exec_time, &copy->exec_time);
+          log_histogram_merge(&result[index].lag, &copy->lag);
+          log_histogram_merge(&result[index].slack, &copy->slack);
+          continue;
+        }
+        if (count == capacity) {
+          capacity = capacity == 0 ? REACTION_PROFILE_INITIAL_CAPACITY : 2 * capacity;
+          result = (lf_reaction_profile_t*)realloc(result, capacity * sizeof(lf_reaction_profile_t));
+          LF_ASSERT_NON_NULL(result);
+        }
+        result[count] = *copy;
+        reaction_profile_map_put(merged, (void*)copy->reaction, count);
+        count++;
+      }
+#if !defined(LF_SINGLE_THREADED)
+      LF_MUTEX_UNLOCK(&table->mutex);
+#endif
+    }
+    reaction_profile_map_free(merged);
+  }
+  free(copy);
+  qsort(result, count, sizeof(lf_reaction_profile_t), compare_profiles);
+  *profiles = result;
+  return count;
+}
+
+/** The statistics of a histogram that are written out. */
+typedef struct histogram_summary_t {
+  uint64_t count;
+  int64_t min;
+  int64_t max;
+  int64_t mean;
+  int64_t percentiles[4];
+} histogram_summary_t;
+
+/** The percentiles that are written out. */
+static const double summary_percentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+/** Summarize a histogram. */
+static histogram_summary_t summarize(const log_histogram_t* histogram) {
+  histogram_summary_t summary = {.count = histogram->count};
+  if (histogram->count > 0) {
+    summary.min = histogram->min;
+    summary.max = histogram->max;
+    summary.mean = histogram->total / (int64_t)histogram->count;
+  }
+  for (int i = 0; i < 4; i++) {
+    summary.percentiles[i] = log_histogram_percentile(histogram, summary_percentiles[i]);
+  }
+  return summary;
+}
+
+/** Summarize a histogram of nonnegative values. */
+static histogram_summary_t summarize_nonnegative(const log_histogram_nonnegative_t* histogram) {
+  histogram_summary_t summary = {.count = histogram->count};
+  if (histogram->count > 0) {
+    summary.min = histogram->min;
+    summary.max = histogram->max;
+    summary.mean = histogram->total / (int64_t)histogram->count;
+  }
+  for (int i = 0; i < 4; i++) {
+    summary.percentiles[i] = log_histogram_nonnegative_percentile(histogram, summary_percentiles[i]);
+  }
+  return summary;
+}
+
+/** Write the summary of a histogram as a JSON object. */
+static void write_histogram_json(FILE* file, const char* name, histogram_summary_t summary) {
+  fprintf(file,
+          "\"%s\": {\"count\": %llu, \"min\": %lld, \"max\": %lld, \"mean\": %lld, \"p50\": %lld, \"p90\": %lld, "
+          "\"p99\": %lld, \"p99.9\": %lld}",
+          name, (unsigned long long)summary.count, (long long)summary.min, (long long)summary.max,
+          (long long)summary.mean, (long long)summary.percentiles[0], (long long)summary.percentiles[1],
+          (long long)summary.percentiles[2], (long long)summary.percentiles[3]);
+}
+
+void lf_reaction_profile_write_json(FILE* file, const lf_reaction_profile_t* profiles, size_t count) {
+  fprintf(file, "{\"reactions\": [");
+  for (size_t i = 0; i < count; i++) {
+    const lf_reaction_profile_t* profile = &profiles[i];
+    fprintf(file, "%s\n  {\"environment\": %d, \"reactor\": \"", i == 0 ? "" : ",", profile->environment);
+    // Reactor names are identifiers separated by periods, but escape them anyway.
+    for (const char* c = profile->reactor; *c != '\0'; c++) {
+      if (*c == '"' || *c == '\\') {
+        fputc('\\', file);
+      }
+      fputc(*c, file);
+    }
+    fprintf(file, "\", \"reaction\": %d, \"deadline\": %lld, ", profile->number, (long long)profile->deadline);
+    write_histogram_json(file, "exec_time", summarize_nonnegative(&profile->exec_time));
+    fprintf(file, ", ");
+    write_histogram_json(file, "lag", summarize(&profile->lag));
+    fprintf(file, ", ");
+    write_histogram_json(file, "slack", summarize(&profile->slack));
+    fprintf(file, "}");
+  }
+  fprintf(file, "\n]}\n");
+}
+
+/** Write the summary of a histogram as a line of CSV if it is not empty. */
+static void write_histogram_csv(FILE* file, const lf_reaction_profile_t* profile, const char* metric,
+                                histogram_summary_t summary) {
+  if (summary.count == 0) {
+    return;
+  }
+  fprintf(file, "%d, %s, %d, %s, %llu, %lld, %lld, %lld, %lld, %lld, %lld, %lld\n", profile->environment,
+          profile->reactor, profile->number, metric, (unsigned long long)summary.count, (long long)summary.min,
+          (long long)summary.max, (long long)summary.mean, (long long)summary.percentiles[0],
+          (long long)summary.percentiles[1], (long long)summary.percentiles[2], (long long)summary.percentiles[3]);
+}
+
+void lf_reaction_profile_write_csv(FILE* file, const lf_reaction_profile_t* profiles, size_t count) {
+  fprintf(file, "Environment, Reactor, Reaction, Metric, Count, Min, Max, Mean, P50, P90, P99, P99.9\n");
+  for (size_t i = 0; i < count; i++) {
+    write_histogram_csv(file, &profiles[i], "exec_time", summarize_nonnegative(&profiles[i].exec_time));
+    write_histogram_csv(file, &profiles[i], "lag", summarize(&profiles[i].lag));
+    write_histogram_csv(file, &profiles[i], "slack", summarize(&profiles[i].slack));
+  }
+}
+
+void _lf_reaction_profile_shutdown(void) {
+  if (tables == NULL) {
+    return;
+  }
+  lf_reaction_profile_t* profiles;
+  size_t count = lf_reaction_profile_snapshot(&profiles);
+  char filename[LF_REACTION_PROFILE_NAME_LENGTH + 8];
+  snprintf(filename, sizeof(filename), "%s.json", file_root);
+  FILE* file = fopen(filename, "w");
+  if (file == NULL) {
+    lf_print_warning("Failed to open %s for writing the reaction profile.", filename);
+  } else {
+    lf_reaction_profile_write_json(file, profiles, count);
+    fclose(file);
+  }
+  snprintf(filename, sizeof(filename), "%s.csv", file_root);
+  file = fopen(filename, "w");
+  if (file == NULL) {
+    lf_print_warning("Failed to open %s for writing the reaction profile.", filename);
+  } else {
+    lf_reaction_profile_write_csv(file, profiles, count);
+    fclose(file);
+  }
+  LF_PRINT_LOG("Wrote profiles of %zu reactions to %s.json and %s.csv.", count, file_root, file_root);
+  free(profiles);
+}
+
+void _lf_reaction_profile_free(void) {
+  if (tables == NULL) {
+    return;
+  }
+  size_t total = first_table[num_environments - 1] + num_tables[num_environments - 1];
+  for (size_t i = 0; i < total; i++) {
+    for (size_t j = 0; j < tables[i].size; j++) {
+      free(tables[i].profiles[j]);
+    }
+    free(tables[i].profiles);
+    reaction_profile_map_free(tables[i].index);
+  }
+  free(tables);
+  tables = NULL;
+  free(first_table);
+  free(num_tables);
+}
@@ -17,6 +17,7 @@
 #include "low_level_platform.h"
 #include "reactor_common.h"
 #include "environment.h"
+#include "metrics.h"
 
 // Embedded platforms with no command line interface shouldnt have signals
 #if !defined(NO_CLI)
@@ -77,7 +78,10 @@ void lf_set_present(lf_port_base_t* port) {
 int wait_until(environment_t* env, instant_t wakeup_time) {
   if (!fast) {
     LF_PRINT_LOG("Waiting for elapsed logical time " PRINTF_TIME ".", wakeup_time - start_time);
-    return lf_clock_interruptable_sleep_until_locked(env, wakeup_time);
+    metrics_worker_wait_starts(env, 0);
+    int result = lf_clock_interruptable_sleep_until_locked(env, wakeup_time);
+    metrics_worker_wait_ends(env, 0);
+    return result;
   }
   return 0;
 }
@@ -117,6 +121,7 @@ void _lf_trigger_reaction(environment_t* env, reaction_t* reaction, int worker_n
     if (pqueue_insert(env->reaction_q, reaction) != 0) {
       lf_print_error_and_exit("Could not insert reaction into reaction_q");
     }
+    metrics_reaction_queued(env);
   }
 }
 
@@ -161,6 +166,7 @@ int _lf_do_step(environment_t* env) {
       if (reaction->deadline == 0 || physical_time > lf_time_add(env->current_tag.time, reaction->deadline)) {
         LF_PRINT_LOG("Deadline violation. Invoking deadline handler.");
         tracepoint_reaction_deadline_missed(env, reaction, 0);
+        metrics_deadline_violation(env);
         // Deadline violation has occurred.
         violation = true;
         // Invoke the local handler, if there is one.
@@ -187,6 +193,7 @@ int _lf_do_step(environment_t* env) {
     // There cannot be any subsequent events that trigger this reaction at the
     //  current tag, so it is safe to conclude that it is now inactive.
     reaction->status = inactive;
+    metrics_reaction_done(env);
   }
 
 #ifdef MODAL_REACTORS
@@ -27,6 +27,7 @@
 #include "pqueue.h"
 #include "reactor.h"
 #include "tracepoint.h"
+#include "metrics.h"
 #include "util.h"
 #include "vector.h"
 #include "lf_core_version.h"
@@ -43,6 +44,10 @@
 #include "rti_local.h"
 #endif
 
+#ifdef LF_REACTION_PROFILING
+#include "reaction_profile.h"
+#endif
+
 // Global variable defined in tag.c:
 extern instant_t start_time;
 
@@ -338,6 +343,7 @@ void _lf_pop_events(environment_t* env) {
           if (lf_tag_compare(event->intended_tag, env->current_tag) < 0) {
             // Mark the triggered reaction with a STP violation
             reaction->is_STP_violated = true;
+            metrics_stp_violation(env);
             LF_PRINT_LOG("Trigger %p has violated the reaction's STP offset. Intended tag: " PRINTF_TAG
                          ". Current tag: " PRINTF_TAG,
                          (void*)event->trigger, event->intended_tag.time - start_time, event->intended_tag.microstep,
@@ -698,6 +704,7 @@ trigger_handle_t _lf_insert_reactions_for_trigger(environment_t* env, trigger_t*
 #ifdef FEDERATED
   if (lf_tag_compare(trigger->intended_tag, env->current_tag) < 0) {
     is_STP_violated = true;
+    metrics_stp_violation(env);
   }
 #ifdef FEDERATED_CENTRALIZED
   // Check for STP violation in the centralized coordination, which is a
@@ -772,6 +779,7 @@ void _lf_advance_tag(environment_t* env, tag_t next_tag) {
 #endif
   if (lf_tag_compare(env->current_tag, next_tag) < 0) {
     env->current_tag = next_tag;
+    metrics_tag_advanced(env);
   } else {
     lf_print_error_and_exit("_lf_advance_tag(): Attempted to move (elapsed) tag to " PRINTF_TAG ", which is "
                             "earlier than or equal to the (elapsed) current tag, " PRINTF_TAG ".",
@@ -799,9 +807,15 @@ void _lf_invoke_reaction(environment_t* env, reaction_t* reaction, int worker) {
 #endif
 
   tracepoint_reaction_starts(env, reaction, worker);
+#ifdef LF_REACTION_PROFILING
+  instant_t profile_start = lf_time_physical();
+#endif
   ((self_base_t*)reaction->self)->executing_reaction = reaction;
   reaction->function(reaction->self);
   ((self_base_t*)reaction->self)->executing_reaction = NULL;
+#ifdef LF_REACTION_PROFILING
+  _lf_reaction_profile_record(env, reaction, worker, profile_start, lf_time_physical());
+#endif
   tracepoint_reaction_ends(env, reaction, worker);
 
 #if !defined(LF_SINGLE_THREADED)
@@ -945,6 +959,7 @@ void schedule_output_reactions(environment_t* env, reaction_t* reaction, int wor
           physical_time > lf_time_add(env->current_tag.time, downstream_to_execute_now->deadline)) {
         // Deadline violation has occurred.
         tracepoint_reaction_deadline_missed(env, downstream_to_execute_now, worker);
+        metrics_deadline_violation(env);
         violation = true;
         // Invoke the local handler, if there is one.
         reaction_function_t handler = downstream_to_execute_now->deadline_violation_handler;
@@ -1017,6 +1032,12 @@ void usage(int argc, const char* argv[]) {
   printf("      Whether to continue execution even when there are no events to process.\n\n");
   printf("  -w, --workers <n>\n");
   printf("      Execute in <n> threads if possible (optional feature).\n\n");
+#ifdef LF_METRICS
+  printf("  --metrics <file|unix:path>\n");
+  printf("      Publish runtime counters in Prometheus text format to a file or a Unix domain socket.\n\n");
+  printf("  --metrics-interval <duration> <units>\n");
+  printf("      How often to rewrite the metrics file, where units are as for --timeout.\n\n");
+#endif
   printf("  -h, --help\n");
   printf("      Display this help message.\n\n");
 #ifdef FEDERATED
@@ -1228,6 +1249,33 @@ int process_args(int argc, const char* argv[]) {
       }
       _lf_number_of_workers = (unsigned int)num_workers;
     }
+#ifdef LF_METRICS
+    else if (strcmp(arg, "--metrics") == 0) {
+      if (argc < i + 1) {
+        lf_print_error("--metrics needs a file name or unix:<path>.");
+        usage(argc, argv);
+        return 0;
+      }
+      _lf_metrics_set_destination(argv[i++]);
+    } else if (strcmp(arg, "--metrics-interval") == 0) {
+      if (argc < i + 2) {
+        lf_print_error("--metrics-interval needs time and units.");
+        usage(argc, argv);
+        return 0;
+      }
+      const char* time_spec = argv[i++];
+      const char* units = argv[i++];
+      interval_t metrics_interval;
+      int parse_result = lf_time_parse(time_spec, units, &metrics_interval);
+      if (parse_result != 0) {
+        lf_print_error(parse_result == -1 ? "Invalid time value: %s" : "Invalid time units: %s",
+                       parse_result == -1 ? time_spec : units);
+        usage(argc, argv);
+        return 0;
+      }
+      _lf_metrics_set_interval(metrics_interval);
+    }
+#endif
 #ifdef FEDERATED
     else if (strcmp(arg, "-i") == 0 || strcmp(arg, "--id") == 0) {
       if (argc < i + 1) {
@@ -1369,7 +1417,7 @@ void initialize_global(void) {
 #if defined(FEDERATED)
   // NUMBER_OF_FEDERATES is an upper bound on the number of upstream federates
   // -- threads are spawned to listen to upstream federates. Add 1 for the
-  // clock sync thread and add 1 for the staa thread
+  // clock sync thread and add 1 for the thread listening to the RTI
   max_threads_tracing += NUMBER_OF_FEDERATES + 2;
   lf_tracing_global_init(envs[0].name, _LF_FEDERATE_NAMES_COMMA_SEPARATED, FEDERATE_ID, max_threads_tracing);
 #else
@@ -1379,6 +1427,21 @@ void initialize_global(void) {
   // This is done for all environments/enclaves at the same time.
   _lf_initialize_trigger_objects();
 
+#ifdef LF_REACTION_PROFILING
+#if defined(FEDERATED)
+  _lf_reaction_profile_init(envs[0].name, FEDERATE_ID);
+#else
+  _lf_reaction_profile_init("main", 0);
+#endif
+#endif
+#ifdef LF_METRICS
+#if defined(FEDERATED)
+  _lf_metrics_init(envs[0].name);
+#else
+  _lf_metrics_init("main");
+#endif
+#endif
+
 #if !defined(LF_SINGLE_THREADED) && !defined(NDEBUG)
   // If we are testing, verify that environment with pointers is correctly set up.
   for (int i = 0; i < num_envs; i++) {
@@ -1467,9 +1530,18 @@ void termination(void) {
       }
     }
   }
+#ifdef LF_REACTION_PROFILING
+  _lf_reaction_profile_shutdown();
+#endif
+#ifdef LF_METRICS
+  _lf_metrics_shutdown();
+#endif
   lf_tracing_global_shutdown();
   // Skip most cleanup on abnormal termination.
   if (_lf_normal_termination) {
+#ifdef LF_REACTION_PROFILING
+    _lf_reaction_profile_free();
+#endif
     _lf_free_all_tokens(); // Must be done before freeing reactors.
 #if !defined NDEBUG
     // Issue a warning if a memory leak has been detected.
@@ -0,0 +1,235 @@
+/**
+ * @file
+ * @brief Zero-copy channels between scheduling enclaves.
+ *
+ * See @ref enclave_channel.h for docs.
+ *
+ * The sender only writes the tail of a channel and the receiver only writes its head, so
+ * each side reads the position of the other to know how many tokens are on the ring. A
+ * sender that has to wait for room does so on a condition variable whose mutex is private
+ * to the channel, so that the receiver never takes a mutex of the sender, which could
+ * deadlock when two enclaves send to each other.
+ *
+ * Both the sender and the receiver hold a reference to a channel, in their arrays of
+ * outbound and inbound channels, and the channel is freed when the second one releases it.
+ */
+
+#ifdef LF_ENCLAVES
+#include <assert.h>
+
+#include "enclave_channel.h"
+#include "lf_token.h"
+#include "reactor_common.h"
+#include "rti_local.h"
+#include "util.h"
+
+/** A token on a channel, with the tag at which it is to be delivered. */
+typedef struct channel_slot_t {
+  tag_t tag;
+  lf_token_t* token;
+} channel_slot_t;
+
+struct lf_enclave_channel_t {
+  environment_t* sender;
+  environment_t* receiver;
+  trigger_t* trigger;
+  interval_t delay;
+  /** Number of slots minus one, the number of slots being a power of two. */
+  uint64_t mask;
+  channel_slot_t* slots;
+  /** Number of tokens sent so far. Only written by the sender. */
+  uint64_t tail;
+  /** Whether the sender is waiting for room, or about to. Only written by the sender. */
+  int sender_waiting;
+  unsigned char sender_padding[64 - sizeof(uint64_t) - sizeof(int)];
+  /** Number of tokens delivered so far. Only written by the receiver. */
+  uint64_t head;
+  /** Whether the receiver has finished executing. Only written by the receiver. */
+  int closed;
+  unsigned char receiver_padding[64 - sizeof(uint64_t) - sizeof(int)];
+  /** Mutex and condition variable on which the sender waits for room. */
+  lf_mutex_t mutex;
+  lf_cond_t room_available;
+  /** Number of environments, of the sender and of the receiver, that have not released the channel. */
+  int references;
+};
+
+/** Append a channel to an array of channels of an environment. */
+static void append_channel(lf_enclave_channel_t*** channels, int* size, lf_enclave_channel_t* channel) {
+  lf_enclave_channel_t** result = (lf_enclave_channel_t**)realloc(*channels, (*size + 1) * sizeof(*result));
+  LF_ASSERT_NON_NULL(result);
+  result[(*size)++] = channel;
+  *channels = result;
+}
+
+lf_enclave_channel_t* lf_enclave_channel_new(environment_t* sender, environment_t* receiver, trigger_t* trigger,
+                                             interval_t delay, size_t capacity) {
+  assert(sender != GLOBAL_ENVIRONMENT && receiver != GLOBAL_ENVIRONMENT && sender != receiver);
+  lf_enclave_channel_t* channel = (lf_enclave_channel_t*)calloc(1, sizeof(lf_enclave_channel_t));
+  LF_ASSERT_NON_NULL(channel);
+  uint64_t slots = 1;
+  while (slots < capacity) {
+    slots <<= 1;
+  }
+  channel->slots = (channel_slot_t*)calloc(slots, sizeof(channel_slot_t));
+  LF_ASSERT_NON_NULL(channel->slots);
+  channel->mask = slots - 1;
+  channel->sender = sender;
+  channel->receiver = receiver;
+  channel->trigger = trigger;
+  channel->delay = delay;
+  LF_MUTEX_INIT(&channel->mutex);
+  LF_COND_INIT(&channel->room_available, &channel->mutex);
+  channel->references = 2;
+  append_channel(&sender->outbound_channels, &sender->outbound_channels_size, channel);
+  append_channel(&receiver->inbound_channels, &receiver->inbound_channels_size, channel);
+  return channel;
+}
+
+int lf_enclave_channel_send(lf_enclave_channel_t* channel, lf_token_t* token) {
+  if (token != NULL && token->ref_count != 0) {
+    lf_print_error("Cannot send a token referenced %zu times through an enclave channel.", token->ref_count);
+    return -1;
+  }
+  if (__atomic_load_n(&channel->closed, __ATOMIC_ACQUIRE)) {
+    LF_PRINT_DEBUG("Dropping a token sent to enclave %d, which has finished executing.", channel->receiver->id);
+    _lf_free_token(token);
+    return 0;
+  }
+  uint64_t tail = channel->tail;
+  if (tail - __atomic_load_n(&channel->head, __ATOMIC_ACQUIRE) > channel->mask) {
+    lf_print_error("Enclave channel to enclave %d is full. Send at most one token per tag.", channel->receiver->id);
+    return -1;
+  }
+  tag_t tag = lf_delay_tag(channel->sender->current_tag, channel->delay);
+  channel_slot_t* slot = &channel->slots[tail & channel->mask];
+  slot->tag = tag;
+  slot->token = token;
+  // Publish the slot to the receiver.
+  __atomic_store_n(&channel->tail, tail + 1, __ATOMIC_RELEASE);
+  // The enclaves downstream of the receiver must not advance past the effects of this token.
+  rti_update_other_net_locked(channel->sender->enclave_info, channel->receiver->enclave_info, tag);
+  return 0;
+}
+
+tag_t _lf_enclave_channels_next_tag_locked(environment_t* env, tag_t tag) {
+  for (int i = 0; i < env->inbound_channels_size; i++) {
+    lf_enclave_channel_t* channel = env->inbound_channels[i];
+    uint64_t head = channel->head;
+    if (head != __atomic_load_n(&channel->tail, __ATOMIC_ACQUIRE)) {
+      tag_t head_tag = channel->slots[head & channel->mask].tag;
+      if (lf_tag_compare(head_tag, tag) < 0) {
+        tag = head_tag;
+      }
+    }
+  }
+  return tag;
+}
+
+/** Put the token of a slot on the event queue of the receiver. The token has no other reference. */
+static void deliver(environment_t* env, trigger_t* trigger, channel_slot_t* slot) {
+  if (lf_tag_compare(slot->tag, env->current_tag) > 0) {
+    _lf_schedule_at_tag(env, trigger, slot->tag, slot->token);
+    return;
+  }
+  // The receiver is about to execute its start tag, which it has already entered, so the
+  // token is put directly on the event queue to be popped with the other events at that tag.
+  event_t* e = lf_get_new_event(env);
+  e->base.tag = slot->tag;
+  e->trigger = trigger;
+  e->token = slot->token;
+  if (e->token != NULL) {
+    e->token->ref_count++;
+  }
+  pqueue_tag_insert(env->event_q, (pqueue_tag_element_t*)e);
+}
+
+void _lf_enclave_channels_deliver_locked(environment_t* env, tag_t tag) {
+  for (int i = 0; i < env->inbound_channels_size; i++) {
+    lf_enclave_channel_t* channel = env->inbound_channels[i];
+    uint64_t head = channel->head;
+    uint64_t tail = __atomic_load_n(&channel->tail, __ATOMIC_ACQUIRE);
+    uint64_t first = head;
+    while (head != tail && lf_tag_compare(channel->slots[head & channel->mask].tag, tag) <= 0) {
+      deliver(env, channel->trigger, &channel->slots[head & channel->mask]);
+      head++;
+    }
+    if (head == first) {
+      continue;
+    }
+    // Sequentially consistent, so that either the sender sees the room or this sees the sender waiting.
+    __atomic_store_n(&channel->head, head, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&channel->sender_waiting, __ATOMIC_SEQ_CST)) {
+      LF_MUTEX_LOCK(&channel->mutex);
+      lf_cond_signal(&channel->room_available);
+      LF_MUTEX_UNLOCK(&channel->mutex);
+    }
+  }
+}
+
+/** Return true if the channel can take one more token or will not take any. */
+static bool has_room(lf_enclave_channel_t* channel) {
+  return channel->tail - __atomic_load_n(&channel->head, __ATOMIC_SEQ_CST) <= channel->mask ||
+         __atomic_load_n(&channel->closed, __ATOMIC_SEQ_CST);
+}
+
+void _lf_enclave_channels_wait_for_room_locked(environment_t* env) {
+  for (int i = 0; i < env->outbound_channels_size; i++) {
+    lf_enclave_channel_t* channel = env->outbound_channels[i];
+    if (has_room(channel)) {
+      continue;
+    }
+    LF_PRINT_LOG("Env %d: Waiting for enclave %d to take tokens off a full channel.", env->id, channel->receiver->id);
+    // Let other threads schedule events while waiting.
+    LF_MUTEX_UNLOCK(&env->mutex);
+    LF_MUTEX_LOCK(&channel->mutex);
+    __atomic_store_n(&channel->sender_waiting, 1, __ATOMIC_SEQ_CST);
+    while (!has_room(channel)) {
+      LF_COND_WAIT(&channel->room_available);
+    }
+    __atomic_store_n(&channel->sender_waiting, 0, __ATOMIC_RELAXED);
+    LF_MUTEX_UNLOCK(&channel->mutex);
+    LF_MUTEX_LOCK(&env->mutex);
+  }
+}
+
+void _lf_enclave_channels_close(environment_t* env) {
+  for (int i = 0; i < env->inbound_channels_size; i++) {
+    lf_enclave_channel_t* channel = env->inbound_channels[i];
+    LF_MUTEX_LOCK(&channel->mutex);
+    __atomic_store_n(&channel->closed, 1, __ATOMIC_SEQ_CST);
+    lf_cond_signal(&channel->room_available);
+    LF_MUTEX_UNLOCK(&channel->mutex);
+  }
+}
+
+/** Release the reference of an environment to a channel, freeing the channel if it was the last one. */
+static void release_channel(lf_enclave_channel_t* channel) {
+  if (__atomic_sub_fetch(&channel->references, 1, __ATOMIC_ACQ_REL) != 0) {
+    return;
+  }
+  for (uint64_t position = channel->head; position != channel->tail; position++) {
+    _lf_free_token(channel->slots[position & channel->mask].token);
+  }
+  lf_cond_destroy(&channel->room_available);
+  lf_mutex_destroy(&channel->mutex);
+  free(channel->slots);
+  free(channel);
+}
+
+void _lf_enclave_channels_free(environment_t* env) {
+  for (int i = 0; i < env->inbound_channels_size; i++) {
+    release_channel(env->inbound_channels[i]);
+  }
+  free(env->inbound_channels);
+  env->inbound_channels = NULL;
+  env->inbound_channels_size = 0;
+  for (int i = 0; i < env->outbound_channels_size; i++) {
+    release_channel(env->outbound_channels[i]);
+  }
+  free(env->outbound_channels);
+  env->outbound_channels = NULL;
+  env->outbound_channels_size = 0;
+}
+
+#endif // LF_ENCLAVES
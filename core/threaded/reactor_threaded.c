@@ -23,7 +23,9 @@
 #include "scheduler.h"
 #include "tag.h"
 #include "environment.h"
+#include "metrics.h"
 #include "rti_local.h"
+#include "enclave_channel.h"
 #include "reactor_common.h"
 #include "watchdog.h"
 
@@ -221,6 +223,11 @@ tag_t get_next_event_tag(environment_t* env) {
     next_tag = event->base.tag;
   }
 
+#ifdef LF_ENCLAVES
+  // Tokens sent by other enclaves wait on their channels until their tag is reached.
+  next_tag = _lf_enclave_channels_next_tag_locked(env, next_tag);
+#endif
+
   // If a timeout tag was given, adjust the next_tag from the
   // event tag to that timeout tag.
   if (lf_is_tag_after_stop_tag(env, next_tag)) {
@@ -247,6 +254,11 @@ tag_t send_next_event_tag(environment_t* env, tag_t tag, bool wait_for_reply) {
 void _lf_next_locked(environment_t* env) {
   assert(env != GLOBAL_ENVIRONMENT);
 
+#ifdef FEDERATED
+  // The current tag is complete, so messages to other federates batched at it are due.
+  lf_send_batched_messages_locked(env);
+#endif
+
 #ifdef MODAL_REACTORS
   // Perform mode transitions
   _lf_handle_mode_changes(env);
@@ -265,6 +277,9 @@ void _lf_next_locked(environment_t* env) {
   if (lf_tag_compare(grant_tag, next_tag) < 0)
     return;
 
+  // Apply backpressure from enclaves that have not yet taken the tokens sent to them.
+  _lf_enclave_channels_wait_for_room_locked(env);
+
   // Next event might have changed while waiting for the TAG
   next_tag = get_next_event_tag(env);
 
@@ -379,6 +394,11 @@ void _lf_next_locked(environment_t* env) {
   }
 
   // At this point, finally, we have an event to process.
+#ifdef LF_ENCLAVES
+  // Move the tokens sent by other enclaves for this tag onto the event queue.
+  _lf_enclave_channels_deliver_locked(env, next_tag);
+#endif
+
   // Do not advance the tag if we are at startup because events may have been
   // put on the event queue before this environment was initialized.
   tag_t start_tag = {.time = start_time, .microstep = 0};
@@ -578,7 +598,7 @@ static void _lf_initialize_start_tag(environment_t* env) {
   // ports' last_known_status_tag, so MLAA was left unblocked. Now that
   // current_tag is at the start tag, recompute MLAA so that any input ports
   // whose status is still unknown at the start tag block reactions until they
-  // become known (or the STAA thread marks them absent).
+  // become known (or their STAA expires and they are assumed absent).
   {
     extern federate_instance_t _fed;
     lf_update_max_level(_fed.last_TAG, _fed.is_last_TAG_provisional);
@@ -599,8 +619,6 @@ static void _lf_initialize_start_tag(environment_t* env) {
     }
   }
 
-  lf_spawn_staa_thread();
-
 #else  // NOT FEDERATED_DECENTRALIZED
   // Each federate executes the start tag (which is the current
   // tag). Inform the RTI of this if needed.
@@ -674,6 +692,7 @@ static bool _lf_worker_handle_deadline_violation_for_reaction(environment_t* env
     if (reaction->deadline == 0 || physical_time > lf_time_add(env->current_tag.time, reaction->deadline)) {
       // Deadline violation has occurred.
       tracepoint_reaction_deadline_missed(env, reaction, worker_number);
+      metrics_deadline_violation(env);
       violation_occurred = true;
       // Invoke the local handler, if there is one.
       tracepoint_reaction_starts(env, reaction, worker_number);
@@ -848,6 +867,7 @@ static void _lf_worker_do_work(environment_t* env, int worker_number) {
     LF_PRINT_DEBUG("Worker %d: Done with reaction %s.", worker_number, current_reaction_to_execute->name);
 
     lf_sched_done_with_reaction(worker_number, current_reaction_to_execute);
+    metrics_reaction_done(env);
   }
 }
 
@@ -882,6 +902,8 @@ static void* worker(void* arg) {
     // to grant other enclaves a TAG to FOREVER.
     // TODO: Can we unify this? Preferraby also have federates send NETs
     rti_logical_tag_complete_locked(env->enclave_info, FOREVER_TAG);
+    // Release enclaves waiting for room in channels to this one.
+    _lf_enclave_channels_close(env);
 #else
     // In federated execution we send a NET to the RTI. This will result in
     // giving the other federates a PTAG to FOREVER.
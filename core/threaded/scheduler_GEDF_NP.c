@@ -33,6 +33,7 @@
 #include "scheduler_sync_tag_advance.h"
 #include "scheduler.h"
 #include "tracepoint.h"
+#include "metrics.h"
 #include "util.h"
 
 #ifdef FEDERATED
@@ -57,7 +58,9 @@ typedef struct custom_scheduler_data_t {
 inline static void wait_for_reaction_queue_updates(lf_scheduler_t* scheduler, int worker_number) {
   scheduler->number_of_idle_workers++;
   tracepoint_worker_wait_starts(scheduler->env, worker_number);
+  metrics_worker_wait_starts(scheduler->env, worker_number);
   LF_COND_WAIT(&scheduler->custom_data->reaction_q_changed);
+  metrics_worker_wait_ends(scheduler->env, worker_number);
   tracepoint_worker_wait_ends(scheduler->env, worker_number);
   scheduler->number_of_idle_workers--;
 }
@@ -246,6 +249,7 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
     LF_PRINT_DEBUG("Scheduler: Locked mutex for environment.");
   }
   pqueue_insert(scheduler->custom_data->reaction_q, (void*)reaction);
+  metrics_reaction_queued(scheduler->env);
   if (!scheduler->custom_data->solo_holds_mutex) {
     // If this is called from a reaction execution, then the triggered reaction
     // has one level higher than the current level. No need to notify idle threads.
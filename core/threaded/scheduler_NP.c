@@ -23,6 +23,7 @@
 #include "scheduler.h"
 #include "lf_semaphore.h"
 #include "tracepoint.h"
+#include "metrics.h"
 #include "util.h"
 #include "reactor_threaded.h"
 
@@ -348,7 +349,9 @@ reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_nu
 
     // Ask the scheduler for more work and wait
     tracepoint_worker_wait_starts(scheduler->env, worker_number);
+    metrics_worker_wait_starts(scheduler->env, worker_number);
     _lf_sched_wait_for_work(scheduler, worker_number);
+    metrics_worker_wait_ends(scheduler->env, worker_number);
     tracepoint_worker_wait_ends(scheduler->env, worker_number);
   }
 
@@ -398,5 +401,6 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
   }
   LF_PRINT_DEBUG("Scheduler: Enqueueing reaction %s, which has level %lld.", reaction->name, LF_LEVEL(reaction->index));
   _lf_sched_insert_reaction(scheduler, reaction);
+  metrics_reaction_queued(scheduler->env);
 }
 #endif // SCHEDULER == SCHED_NP || !defined(SCHEDULER)
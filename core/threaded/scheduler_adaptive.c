@@ -18,6 +18,7 @@
 #include "scheduler_sync_tag_advance.h"
 #include "scheduler.h"
 #include "environment.h"
+#include "metrics.h"
 #include "util.h"
 
 #ifdef FEDERATED
@@ -407,9 +408,11 @@ static void worker_states_sleep_and_unlock(lf_scheduler_t* scheduler, size_t wor
   worker_states->mutex_held[worker] = false; // This will be true soon, upon call to lf_cond_wait.
   size_t cond = cond_of(worker);
   if (((level_counter_snapshot == scheduler->custom_data->level_counter) || worker >= worker_states->num_awakened)) {
+    metrics_worker_wait_starts(scheduler->env, (int)worker);
     do {
       lf_cond_wait(worker_states->worker_conds + cond);
     } while (level_counter_snapshot == scheduler->custom_data->level_counter || worker >= worker_states->num_awakened);
+    metrics_worker_wait_ends(scheduler->env, (int)worker);
   }
   LF_ASSERT(!worker_states->mutex_held[worker],
             "Sched: Worker doesnt hold the mutex"); // This thread holds the mutex, but it did not report that.
@@ -727,5 +730,6 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
   if (!lf_atomic_bool_compare_and_swap((int*)&reaction->status, inactive, queued))
     return;
   worker_assignments_put(scheduler, reaction);
+  metrics_reaction_queued(scheduler->env);
 }
 #endif // defined SCHEDULER && SCHEDULER == SCHED_ADAPTIVE
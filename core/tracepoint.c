@@ -261,4 +261,29 @@ void tracepoint_rti_from_federate(trace_event_t event_type, int fed_id, tag_t* t
 
 #endif // RTI_TRACE
 
+#if defined FEDERATED || defined RTI_TRACE
+
+/**
+ * Trace the end of a phase of the startup of a federate or the RTI.
+ * @param event_type The phase.
+ * @param self_id The federate ID, or -1 for the RTI.
+ * @param partner_id The ID of the federate with which the phase connects, or -1 if none.
+ * @param start The physical time at which the phase started.
+ */
+void tracepoint_startup_phase(trace_event_t event_type, int self_id, int partner_id, instant_t start) {
+  instant_t now = lf_time_physical();
+  call_tracepoint(event_type,
+                  NULL,       // void* pointer,
+                  NEVER_TAG,  // tag_t* tag,
+                  -1,         // int worker (startup phases may run in threads of their own)
+                  self_id,    // int src_id
+                  partner_id, // int dst_id
+                  &now,       // instant_t* physical_time
+                  NULL,       // trigger_t* trigger,
+                  now - start // interval_t extra_delay
+  );
+}
+
+#endif // FEDERATED || RTI_TRACE
+
 #endif // LF_TRACE
@@ -23,6 +23,7 @@
 typedef struct lf_scheduler_t lf_scheduler_t;
 typedef struct mode_environment_t mode_environment_t;
 typedef struct enclave_info_t enclave_info_t;
+typedef struct lf_enclave_channel_t lf_enclave_channel_t;
 typedef struct watchdog_t watchdog_t;
 
 /**
@@ -364,6 +365,34 @@ typedef struct environment_t {
    * @note Only used in enclave execution.
    */
   enclave_info_t* enclave_info;
+
+  /**
+   * @brief Array of channels through which other enclaves send tokens to this one.
+   *
+   * The size of this array is stored in inbound_channels_size.
+   * @note Only used in enclave execution.
+   */
+  lf_enclave_channel_t** inbound_channels;
+
+  /**
+   * @brief Number of inbound channels.
+   * @note Only used in enclave execution.
+   */
+  int inbound_channels_size;
+
+  /**
+   * @brief Array of channels through which this enclave sends tokens to others.
+   *
+   * The size of this array is stored in outbound_channels_size.
+   * @note Only used in enclave execution.
+   */
+  lf_enclave_channel_t** outbound_channels;
+
+  /**
+   * @brief Number of outbound channels.
+   * @note Only used in enclave execution.
+   */
+  int outbound_channels_size;
 #endif
 } environment_t;
 
@@ -0,0 +1,101 @@
+/**
+ * @file arrival_lag.h
+ * @brief Estimates of how late messages arrive, from which the STA and STAA offsets are adapted.
+ * @ingroup Federated
+ *
+ * The arrival lag of a message is its physical time of arrival minus its intended time. A federate
+ * compiled with `FEDERATED_ADAPTIVE_STAA` keeps an estimate of the lag that a given fraction of
+ * its messages exceeds, over all ports for the STA and over the ports of each group in `staa_lst`
+ * for the STA plus the STAA of the group (@see staa_t). Each estimate moves by one step per
+ * message, so it needs no memory of past messages and follows a lag that changes over time.
+ *
+ * All functions are static inline so that the estimates can be tested without a federation.
+ */
+
+#ifndef ARRIVAL_LAG_H
+#define ARRIVAL_LAG_H
+
+#include <stddef.h>
+
+#include "tag.h"
+
+/** The divisor of an estimate of the arrival lag that gives the step by which the estimate moves. */
+#define ARRIVAL_LAG_GAIN 16
+
+/** The smallest step by which an estimate of the arrival lag moves. */
+#define ARRIVAL_LAG_MIN_STEP USEC(10)
+
+/**
+ * @brief Estimates of the arrival lag over all ports and over the ports of each group.
+ * @ingroup Federated
+ */
+typedef struct arrival_lag_t {
+  /** The fraction of messages, strictly between 0 and 1, that should arrive later than the estimates. */
+  double late_fraction;
+  /** The smallest value of an estimate. */
+  interval_t min;
+  /** The largest value of an estimate. */
+  interval_t max;
+  /** The estimate over all ports, used as the STA. */
+  interval_t all_ports;
+  /** The number of groups. */
+  size_t num_groups;
+  /** For each group, the estimate over its ports, used as the STA plus the STAA of the group. */
+  interval_t* groups;
+} arrival_lag_t;
+
+/**
+ * @brief Return the given offset limited to the bounds of the estimates.
+ * @param lag The estimates.
+ * @param offset The offset.
+ */
+static inline interval_t arrival_lag_clamp(const arrival_lag_t* lag, interval_t offset) {
+  return offset < lag->min ? lag->min : (offset > lag->max ? lag->max : offset);
+}
+
+/**
+ * @brief Return an estimate moved according to the arrival lag of a message.
+ *
+ * The estimate moves up by a step if the sample exceeds it and down by r / (1 - r) of a step
+ * otherwise, where r is the late fraction, so that it settles where a fraction r of the samples
+ * exceeds it. The step is proportional to the estimate, so that it adapts at the same relative
+ * pace to lags of any magnitude.
+ * @param lag The estimates, which give the late fraction and the bounds.
+ * @param estimate The estimate to move.
+ * @param sample The arrival lag of the message.
+ */
+static inline interval_t arrival_lag_update(const arrival_lag_t* lag, interval_t estimate, interval_t sample) {
+  interval_t step = estimate / ARRIVAL_LAG_GAIN > ARRIVAL_LAG_MIN_STEP ? estimate / ARRIVAL_LAG_GAIN
+                                                                         : ARRIVAL_LAG_MIN_STEP;
+  if (sample > estimate) {
+    estimate = lf_time_add(estimate, step);
+  } else {
+    estimate -= (interval_t)((double)step * (lag->late_fraction / (1.0 - lag->late_fraction)));
+  }
+  return arrival_lag_clamp(lag, estimate);
+}
+
+/**
+ * @brief Move the estimates according to the arrival lag of a message.
+ * @param lag The estimates.
+ * @param group The group of the port on which the message arrived or -1 if the port is in none.
+ * @param sample The arrival lag of the message.
+ */
+static inline void arrival_lag_record(arrival_lag_t* lag, int group, interval_t sample) {
+  lag->all_ports = arrival_lag_update(lag, lag->all_ports, sample);
+  if (group >= 0 && (size_t)group < lag->num_groups) {
+    lag->groups[group] = arrival_lag_update(lag, lag->groups[group], sample);
+  }
+}
+
+/**
+ * @brief Return the STAA of a group, which is its estimate minus the STA, or zero if the STA is larger.
+ * @param lag The estimates.
+ * @param group The group.
+ */
+static inline size_t arrival_lag_staa(const arrival_lag_t* lag, size_t group) {
+  interval_t staa = lag->groups[group] - lag->all_ports;
+  return staa > 0 ? (size_t)staa : 0;
+}
+
+#endif // ARRIVAL_LAG_H
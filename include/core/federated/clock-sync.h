@@ -70,6 +70,24 @@
 #define _LF_CLOCK_SYNC_ATTENUATION 10
 #endif
 
+/**
+ * @brief Number of synchronization intervals over which the drift of the local clock is estimated.
+ * @ingroup Federated
+ *
+ * At the end of each synchronization interval, the average offset measured during the interval
+ * is recorded. A line fitted to the last this many of those gives the rate at which the clock
+ * sync offset changes continuously between intervals.
+ */
+#ifndef _LF_CLOCK_SYNC_DRIFT_WINDOW
+#define _LF_CLOCK_SYNC_DRIFT_WINDOW 8
+#endif
+
+/**
+ * @brief Bound on the estimated drift of the local clock relative to the clock of the RTI, in parts per million.
+ * @ingroup Federated
+ */
+#define CLOCK_SYNC_MAX_DRIFT_PPM 500
+
 /**
  * @brief By default, collect statistics on clock synchronization.
  * @ingroup Federated
@@ -105,6 +123,10 @@
  *
  * The round trip delay is estimated as: (T4 - T1) - (T3 - T2)
  * The clock offset can be estimated as: ((T2 - T1) + (T3 - T4)) / 2
+ *
+ * Where the kernel supports it (SO_TIMESTAMPING), T2 and T3 of runtime synchronization over UDP
+ * are the times at which the kernel received and sent the messages rather than the times at
+ * which the federate read and wrote them, which keeps scheduling delays out of the estimates.
  */
 typedef struct socket_stat_t {
   /**
@@ -149,7 +171,8 @@ typedef struct socket_stat_t {
    *
    * Maintains a history of clock synchronization measurements.
    * For the AVG strategy, this stores a partially computed average
-   * of the clock offset measurements.
+   * of the clock offset measurements, that is, of the offsets that the
+   * local clock should have had according to each exchange.
    */
   interval_t history;
 
@@ -195,6 +218,17 @@ typedef struct socket_stat_t {
   interval_t network_stat_samples[_LF_CLOCK_SYNC_EXCHANGES_PER_INTERVAL];
 } socket_stat_t;
 
+/**
+ * @brief The offset that the local clock should have had at a time, averaged over a synchronization interval.
+ * @ingroup Federated
+ */
+typedef struct offset_sample_t {
+  /** Time of the local clock, without offset. */
+  instant_t local_time;
+  /** The offset. */
+  interval_t offset;
+} offset_sample_t;
+
 /**
  * @brief Holds generic statistical data
  * @ingroup Federated
@@ -308,6 +342,39 @@ void clock_sync_add_offset(instant_t* t);
  */
 void clock_sync_subtract_offset(instant_t* t);
 
+/**
+ * @brief Return the clock synchronization offset at a time of the local clock.
+ * @ingroup Federated
+ *
+ * The offset changes continuously from the offset set by clock_sync_set_offset_model() at the rate
+ * of the drift set with it. This can be called from any thread.
+ * @param local_time The time of the local clock, without offset.
+ */
+interval_t clock_sync_offset_at(instant_t local_time);
+
+/**
+ * @brief Set the clock synchronization offset at a time of the local clock and the rate at which it changes from there.
+ * @ingroup Federated
+ *
+ * Only one thread at a time may call this, but clock_sync_offset_at() can be called concurrently.
+ * @param offset The offset.
+ * @param reference_time The time of the local clock, without offset.
+ * @param drift The rate of change of the offset relative to the local clock.
+ */
+void clock_sync_set_offset_model(interval_t offset, instant_t reference_time, double drift);
+
+/**
+ * @brief Return the drift of the local clock estimated from offset samples.
+ * @ingroup Federated
+ *
+ * This is the slope of the line fitted to the samples by least squares, which is the rate at which
+ * the offset changes relative to the local clock, limited to CLOCK_SYNC_MAX_DRIFT_PPM. It is 0 if
+ * there are fewer than two samples or all of them are at the same time.
+ * @param samples The samples, in any order.
+ * @param count The number of samples.
+ */
+double clock_sync_estimate_drift(const offset_sample_t* samples, int count);
+
 /**
  * @brief Set a fixed offset to the physical clock.
  * @ingroup Federated
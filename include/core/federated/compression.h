@@ -0,0 +1,112 @@
+/**
+ * @file compression.h
+ * @brief Compression of the payloads of tagged messages.
+ * @ingroup Federated
+ *
+ * When the runtime is compiled with `FEDERATED_COMPRESSION` set to `LZ4`, `ZSTD`, or `ZLIB`, a
+ * federate compresses the payload of each tagged message of at least
+ * `FEDERATED_COMPRESSION_THRESHOLD` bytes (4096 by default) that it sends to a federate compiled
+ * with the same codec, which it learns when it connects (@see MSG_TYPE_COMPRESSION). The fastest
+ * setting of each codec is used, because a payload is compressed on the thread sending it.
+ * A payload that does not get smaller is sent as is. The receiving federate decompresses the
+ * payload directly into the buffer of the token that carries it, which comes from the payload
+ * pool of the port, if any (@see payload_pool.h).
+ *
+ * With `LF_METRICS` defined, the bytes going into and out of the codec and the CPU time spent in
+ * it are counted (@see metrics.h).
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "net_common.h"
+
+#if defined(FEDERATED_COMPRESSION_LZ4)
+#define LF_COMPRESSION_CODEC COMPRESSION_CODEC_LZ4
+#elif defined(FEDERATED_COMPRESSION_ZSTD)
+#define LF_COMPRESSION_CODEC COMPRESSION_CODEC_ZSTD
+#elif defined(FEDERATED_COMPRESSION_ZLIB)
+#define LF_COMPRESSION_CODEC COMPRESSION_CODEC_ZLIB
+#else
+#define LF_COMPRESSION_CODEC COMPRESSION_CODEC_NONE
+#endif
+
+#ifndef FEDERATED_COMPRESSION_THRESHOLD
+/**
+ * @brief The size in bytes from which payloads are compressed.
+ * @ingroup Federated
+ */
+#define FEDERATED_COMPRESSION_THRESHOLD 4096
+#endif
+
+#ifndef FEDERATED_COMPRESSION_MAX_RATIO
+/**
+ * @brief The largest factor by which a payload may shrink when compressed.
+ * @ingroup Federated
+ *
+ * A payload that would shrink more is sent as is. A receiver rejects a compressed payload whose
+ * announced length exceeds this factor times its compressed length, so that a malformed message
+ * cannot make it allocate an arbitrary amount of memory.
+ */
+#define FEDERATED_COMPRESSION_MAX_RATIO 1024
+#endif
+
+/**
+ * @brief The size of the four-byte length that precedes a compressed payload.
+ * @ingroup Federated
+ */
+#define COMPRESSED_PAYLOAD_HEADER_SIZE sizeof(uint32_t)
+
+/**
+ * @brief Return whether a payload of the given length may be sent with the given compressed length.
+ * @ingroup Federated
+ *
+ * @param length The length of the uncompressed payload.
+ * @param compressed_length The length of the compressed payload.
+ * @see FEDERATED_COMPRESSION_MAX_RATIO
+ */
+static inline int lf_compression_ratio_allowed(size_t length, size_t compressed_length) {
+  return compressed_length > 0 && (length - 1) / FEDERATED_COMPRESSION_MAX_RATIO < compressed_length;
+}
+
+/**
+ * @brief Return the size of a buffer large enough for any compressed payload of the given length.
+ * @ingroup Federated
+ *
+ * @param length The length of the uncompressed payload.
+ */
+size_t lf_compression_bound(size_t length);
+
+/**
+ * @brief Compress a payload.
+ * @ingroup Federated
+ *
+ * This can be called from any thread.
+ * @param payload The payload.
+ * @param length The length of the payload.
+ * @param compressed The buffer to write the compressed payload to, which must hold lf_compression_bound(length) bytes.
+ * @param compressed_length Where to store the length of the compressed payload.
+ * @return 0 on success or -1 if the codec failed, the payload did not get smaller, or it got smaller
+ * by more than FEDERATED_COMPRESSION_MAX_RATIO.
+ */
+int lf_compress_payload(const unsigned char* payload, size_t length, unsigned char* compressed,
+                        size_t* compressed_length);
+
+/**
+ * @brief Decompress a payload.
+ * @ingroup Federated
+ *
+ * This can be called from any thread.
+ * @param compressed The compressed payload, as written by lf_compress_payload().
+ * @param compressed_length The length of the compressed payload.
+ * @param payload The buffer to write the payload to.
+ * @param length The length of the uncompressed payload.
+ * @return 0 on success or -1 if the compressed payload is malformed or does not have the given length.
+ */
+int lf_decompress_payload(const unsigned char* compressed, size_t compressed_length, unsigned char* payload,
+                          size_t length);
+
+#endif // COMPRESSION_H
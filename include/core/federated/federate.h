@@ -25,6 +25,7 @@
 #include "environment.h"
 #include "low_level_platform.h"
 #include "net_abstraction.h"
+#include "payload_pool.h"
 
 #ifndef ADVANCE_MESSAGE_INTERVAL
 #define ADVANCE_MESSAGE_INTERVAL MSEC(10)
@@ -50,6 +51,25 @@ typedef struct federate_instance_t {
    */
   lf_thread_t RTI_net_listener;
 
+  /**
+   * The control lane to the RTI, which carries the tag coordination messages under centralized
+   * coordination, or NULL if all messages to and from the RTI use net_to_RTI.
+   * @see MSG_TYPE_CONTROL_LANE
+   */
+  net_abstraction_t net_control_to_RTI;
+
+  /**
+   * Thread listening for incoming messages on the control lane to the RTI, if there is one.
+   */
+  lf_thread_t RTI_control_listener;
+
+  /**
+   * The number of tagged messages, port absent messages, and stop messages sent to the RTI, which a
+   * message on the control lane carries as its data fence. This is accessed only while holding the
+   * lf_outbound_net_mutex.
+   */
+  int64_t fenced_messages_to_RTI;
+
   /**
    * Number of inbound physical connections to the federate.
    * This can be either physical connections, or logical connections
@@ -101,6 +121,31 @@ typedef struct federate_instance_t {
    */
   net_abstraction_t net_for_outbound_p2p_connections[NUMBER_OF_FEDERATES];
 
+  /**
+   * An array of mutex locks, one for each entry of net_for_outbound_p2p_connections,
+   * held while writing to or closing that network abstraction. Messages to different
+   * federates therefore do not wait for each other. Writes to the RTI are instead
+   * protected by lf_outbound_net_mutex. These are initialized by lf_connect_to_rti().
+   */
+  lf_mutex_t outbound_p2p_mutexes[NUMBER_OF_FEDERATES];
+
+  /**
+   * The threads with which lf_connect_to_federate_async() establishes outbound connections concurrently,
+   * of which there are number_of_outbound_p2p_connection_threads. lf_wait_for_connections_to_federates()
+   * waits for them.
+   */
+  lf_thread_t outbound_p2p_connection_threads[NUMBER_OF_FEDERATES];
+  size_t number_of_outbound_p2p_connection_threads;
+
+#ifdef FEDERATED_COMPRESSION
+  /**
+   * For each remote federate, whether it decompresses payloads compressed with the codec of this
+   * federate, which is learned when connecting to the RTI under centralized coordination and
+   * when connecting to the federate under decentralized coordination (@see MSG_TYPE_COMPRESSION).
+   */
+  bool compress_payloads_to[NUMBER_OF_FEDERATES];
+#endif
+
   /**
    * Thread ID for a thread that accepts network abstractions and then supervises
    * listening to those network abstractions for incoming P2P (physical) connections.
@@ -164,6 +209,19 @@ typedef struct federate_instance_t {
    */
   tag_t last_sent_LTC;
 
+  /**
+   * An LTC that lf_latest_tag_confirmed() has left to be sent together with the next NET
+   * in a next message request (NMR), or NEVER_TAG if there is none. This is accessed
+   * only while holding the lf_outbound_net_mutex.
+   */
+  tag_t pending_LTC;
+
+  /**
+   * Whether the RTI accepted the MSG_TYPE_FED_IDS_NMR message of this federate, so that it can
+   * be sent next message requests (NMRs). If not, an LTC is sent as soon as it is confirmed.
+   */
+  bool RTI_accepts_NMR;
+
   /**
    * A record of the most recently sent NET (next event tag) signal.
    */
@@ -191,20 +249,20 @@ typedef struct federate_instance_t {
    * path from a physical action to any output.
    */
   instant_t min_delay_from_physical_action_to_federate_output;
-
-#ifdef FEDERATED_DECENTRALIZED
-  /**
-   * Thread responsible for setting ports to absent by an STAA offset if they
-   * aren't already known.
-   */
-  lf_thread_t staaSetter;
-#endif
 } federate_instance_t;
 
 #ifdef FEDERATED_DECENTRALIZED
 /**
  * @brief Structure for STAA (safe to assume absent).
  * @ingroup Federated
+ *
+ * The STAA of each group of ports is fixed by the code generator unless the runtime is compiled
+ * with `FEDERATED_ADAPTIVE_STAA` set to a target fraction of late messages, such as 0.01. A
+ * federate then tracks how long after their intended time messages arrive, on all ports for the
+ * STA and on the ports of each group for its STAA, and moves the STA and the STAA of each group
+ * so that about that fraction of messages arrives later than STA plus STAA. STA and STA plus
+ * STAA stay between `FEDERATED_ADAPTIVE_STAA_MIN` and `FEDERATED_ADAPTIVE_STAA_MAX` nanoseconds
+ * (0 and one second by default). The values the federate starts with are those it was given.
  */
 typedef struct staa_t {
   lf_action_base_t** actions;
@@ -234,8 +292,12 @@ typedef enum parse_rti_code_t { SUCCESS, INVALID_PORT, INVALID_HOST, INVALID_USE
 // Global variables
 
 /**
- * @brief Mutex lock held while performing outbound network abstraction write and close operations.
+ * @brief Mutex lock held while writing to the network abstraction connected to the RTI.
  * @ingroup Federated
+ *
+ * This also protects the state of the federate that is updated when sending messages,
+ * such as the last DNET. Writes to outbound P2P network abstractions are instead protected by
+ * the per-connection locks in `outbound_p2p_mutexes` of @ref federate_instance_t.
  */
 extern lf_mutex_t lf_outbound_net_mutex;
 
@@ -248,6 +310,21 @@ extern lf_cond_t lf_port_status_changed;
 //////////////////////////////////////////////////////////////////////////////////
 // Public functions (in alphabetical order)
 
+/**
+ * @brief Allocate memory into which to read a payload arriving on a network input port.
+ * @ingroup Federated
+ *
+ * The memory is a buffer taken from the payload pool registered for the port, if there is one with
+ * a buffer free, and is allocated with malloc() otherwise (@see lf_register_payload_pool()).
+ * This can be called from any thread.
+ * @param port_id The ID of the network input port.
+ * @param length The length of the payload in bytes.
+ * @param type Where to put the type of the token to carry the payload. Unless this is the type of
+ * the action of the port, its destructor returns the memory to the pool.
+ * @return The memory.
+ */
+void* lf_allocate_payload(unsigned short port_id, size_t length, token_type_t** type);
+
 /**
  * @brief Connect to the federate with the specified id.
  * @ingroup Federated
@@ -259,12 +336,28 @@ extern lf_cond_t lf_port_status_changed;
  * to establish a network abstraction connection to the specified federate.
  * If this fails, the program exits. If it succeeds, it sets element [id] of
  * the _fed.net_for_outbound_p2p_connections global array to
- * refer to the network abstraction for communicating directly with the federate.
+ * refer to the network abstraction for communicating directly with the federate
+ * before returning.
  *
  * @param remote_federate_id The ID of the remote federate.
  */
 void lf_connect_to_federate(uint16_t remote_federate_id);
 
+/**
+ * @brief Start connecting to the federate with the specified id in a thread of its own.
+ * @ingroup Federated
+ *
+ * This does what lf_connect_to_federate() does, but returns without waiting for the connection,
+ * so that the connections to several federates are established concurrently.
+ * The connection is established by the time lf_wait_for_connections_to_federates() returns,
+ * which lf_synchronize_with_other_federates() calls. Until then, the caller must neither
+ * send to the federate nor read from the connection to the RTI, on which the thread queries
+ * the address of the federate.
+ *
+ * @param remote_federate_id The ID of the remote federate.
+ */
+void lf_connect_to_federate_async(uint16_t remote_federate_id);
+
 /**
  * @brief Connect to the RTI at the specified host and port.
  * @ingroup Federated
@@ -276,6 +369,11 @@ void lf_connect_to_federate(uint16_t remote_federate_id);
  * If it succeeds, it sets the _fed.net_to_RTI global variable to refer to
  * the network abstraction for communicating with the RTI.
  *
+ * If the runtime is compiled with `FEDERATED_CONTROL_LANE` defined, it first opens a second
+ * connection to the RTI, the control lane, which carries the tag coordination messages so that
+ * large tagged messages do not hold up tag advance grants (@see MSG_TYPE_CONTROL_LANE). If the
+ * RTI does not support control lanes, all messages use a single connection.
+ *
  * @param hostname A hostname, such as "localhost".
  * @param port_number A port number or 0 to start with the default.
  */
@@ -329,6 +427,10 @@ void* lf_handle_p2p_connections_from_federates(void* ignored);
  *
  * This avoids the send if an equal or later LTC has previously been sent.
  *
+ * With centralized coordination and a tag earlier than the stop tag, the LTC is not sent
+ * right away but together with the NET that lf_send_next_event_tag() sends next, in a
+ * next message request (NMR). If that function does not send a NET, it sends the LTC alone.
+ *
  * This function assumes the caller holds the mutex lock
  * on the top-level environment.
  *
@@ -344,6 +446,23 @@ void lf_latest_tag_confirmed(tag_t tag_to_send);
  */
 parse_rti_code_t lf_parse_rti_addr(const char* rti_addr);
 
+/**
+ * @brief Register a pool into which the payloads of messages arriving on a network input port are read.
+ * @ingroup Federated
+ *
+ * Payloads that fit into a buffer of the pool are then read directly into a buffer taken from the
+ * pool, and the buffer is returned to the pool rather than freed when the last token referring to
+ * it is done with. The same pool can be registered for several ports. The pool must not be freed
+ * while the federate is running. This can be called at any time after the federate has connected
+ * to the RTI, for example in a reaction to startup, and takes effect for messages that arrive
+ * afterwards. It fails for ports whose type has a destructor or a copy constructor, whose payloads
+ * cannot be recycled as plain bytes.
+ * @param port_id The ID of the network input port.
+ * @param pool The pool or NULL to go back to allocating payloads with malloc().
+ * @return 0 on success or -1 if a pool cannot be registered for the port.
+ */
+int lf_register_payload_pool(unsigned short port_id, lf_payload_pool_t* pool);
+
 /**
  * @brief Reset the status fields on network input ports to unknown or absent.
  * @ingroup Federated
@@ -357,6 +476,22 @@ parse_rti_code_t lf_parse_rti_addr(const char* rti_addr);
  */
 void lf_reset_status_fields_on_input_port_triggers(void);
 
+/**
+ * @brief Send the tagged messages and port absent messages that are waiting to be sent in batches.
+ * @ingroup Federated
+ *
+ * If the runtime is compiled with `FEDERATED_P2P_BATCH_SIZE` defined, the tagged messages and port
+ * absent messages that this federate sends directly to another federate at a tag are collected into
+ * batches of type MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH, which are sent when they exceed the specified number
+ * of bytes and when this function is called. The runtime calls it when it completes a tag and before
+ * a worker blocks waiting for the status of a network input port. Otherwise, this does nothing.
+ *
+ * The caller must hold the mutex of the environment, which this function releases while it writes
+ * to the network and reacquires before returning.
+ * @param env The top-level environment.
+ */
+void lf_send_batched_messages_locked(environment_t* env);
+
 /**
  * @brief Send a message to another federate.
  * @ingroup Federated
@@ -365,8 +500,8 @@ void lf_reset_status_fields_on_input_port_triggers(void);
  * between federates. If the connection to the remote federate or the RTI has been broken,
  * then this returns -1 without sending. Otherwise, it returns 0.
  *
- * This method assumes that the caller does not hold the lf_outbound_net_mutex lock,
- * which it acquires to perform the send.
+ * This method assumes that the caller does not hold the lock on the outbound connection
+ * to the federate, which it acquires to perform the send.
  *
  * @param message_type The type of the message being sent (currently only MSG_TYPE_P2P_MESSAGE).
  * @param port The ID of the destination port.
@@ -494,8 +629,13 @@ int lf_send_stop_request_to_rti(tag_t stop_tag);
  * to believe that there were no messages forthcoming.  In this case, on failure to send
  * the message, this function returns -11.
  *
- * This method assumes that the caller does not hold the lf_outbound_net_mutex lock,
- * which it acquires to perform the send.
+ * This method assumes that the caller does not hold the lf_outbound_net_mutex lock or
+ * the lock on the outbound connection to the federate, which it acquires to perform the send.
+ * The header and the message are written with a single call to write_to_net_v.
+ *
+ * If the runtime is compiled with `FEDERATED_COMPRESSION` defined, a message of at least
+ * `FEDERATED_COMPRESSION_THRESHOLD` bytes to a federate that has the same codec is compressed
+ * before any lock is acquired (@see compression.h).
  *
  * @param env The environment from which to get the current tag.
  * @param additional_delay The after delay on the connection or NEVER is there is none.
@@ -524,11 +664,10 @@ void lf_set_federation_id(const char* fid);
 
 #ifdef FEDERATED_DECENTRALIZED
 /**
- * @brief Spawn a thread to iterate through STAA structs.
+ * @brief Do nothing.
  * @ingroup Federated
- *
- * This will set their associated ports absent
- * at an offset if the port is not present with a value by a certain physical time.
+ * @deprecated Ports are assumed absent by the worker that waits for them once their STAA
+ * expires (@see lf_stall_advance_level_federation_locked), so no thread needs to be spawned.
  */
 void lf_spawn_staa_thread(void);
 #endif
@@ -539,6 +678,8 @@ void lf_spawn_staa_thread(void);
  *
  * Specifically, wait until the specified level is less that the max level allowed to
  * advance (MLAA). This function does nothing if the environment is not the top-level environment.
+ * Under decentralized coordination, the wait lasts no longer than until the STAA of the unknown
+ * ports expires (@see staa_t), at which point the calling thread assumes them absent.
  * @param env The environment (which should always be the top-level environment).
  * @param level The level to which we would like to advance.
  */
@@ -581,6 +722,12 @@ void lf_synchronize_with_other_federates(void);
  */
 bool lf_update_max_level(tag_t tag, bool is_provisional);
 
+/**
+ * @brief Wait for the connections started by lf_connect_to_federate_async() to be established.
+ * @ingroup Federated
+ */
+void lf_wait_for_connections_to_federates(void);
+
 #ifdef FEDERATED_DECENTRALIZED
 /**
  * @brief Return the physical time that we should wait until before advancing to the specified tag.
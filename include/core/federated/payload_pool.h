@@ -0,0 +1,85 @@
+/**
+ * @file payload_pool.h
+ * @brief Pools of preallocated buffers into which message payloads are received.
+ * @ingroup Federated
+ *
+ * By default, the payload of each tagged message a federate receives is read into memory
+ * allocated with malloc() and freed when the last token referring to it is done. For large
+ * payloads, such as camera frames, the allocator traffic this causes is significant. A payload
+ * pool holds a fixed number of buffers of a fixed size, optionally backed by huge pages. Once a
+ * pool is registered with a network input port using lf_register_payload_pool(), payloads
+ * arriving on that port are read directly into a buffer taken from the pool, and the buffer
+ * is returned to the pool instead of being freed when the token carrying it is done with.
+ * Payloads larger than the buffers of the pool and payloads arriving while all buffers are in
+ * use are allocated with malloc() as before.
+ *
+ * A reaction that needs to modify a pooled payload can use lf_writable_copy(), which does not copy
+ * the payload if the reaction is its only reader.
+ */
+
+#ifndef PAYLOAD_POOL_H
+#define PAYLOAD_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Opaque type of a pool of payload buffers.
+ * @ingroup Federated
+ */
+typedef struct lf_payload_pool_t lf_payload_pool_t;
+
+/**
+ * @brief Create a pool of payload buffers.
+ * @ingroup Federated
+ *
+ * All buffers are allocated up front. If huge pages are requested but none are available, the
+ * buffers are allocated from regular pages instead and, on Linux, transparent huge pages are
+ * requested for them.
+ * @param buffer_size The size in bytes of each buffer, which is the largest payload the pool holds.
+ * @param count The number of buffers.
+ * @param hugepages Whether to back the buffers with huge pages.
+ * @return The pool or NULL if the memory could not be allocated.
+ */
+lf_payload_pool_t* lf_payload_pool_create(size_t buffer_size, size_t count, bool hugepages);
+
+/**
+ * @brief Free a pool of payload buffers.
+ * @ingroup Federated
+ *
+ * @param pool The pool.
+ * @return 0 on success or -1, without freeing anything, if some buffers are still in use.
+ */
+int lf_payload_pool_free(lf_payload_pool_t* pool);
+
+/**
+ * @brief Take a buffer from a pool.
+ * @ingroup Federated
+ *
+ * This can be called from any thread.
+ * @param pool The pool.
+ * @param size The number of bytes needed.
+ * @return A buffer of at least the given size or NULL if the size exceeds the size of the buffers
+ * of the pool or if all buffers are in use.
+ */
+void* lf_payload_pool_acquire(lf_payload_pool_t* pool, size_t size);
+
+/**
+ * @brief Return a buffer to the pool from which it was taken.
+ * @ingroup Federated
+ *
+ * This can be called from any thread. It has the signature of a token destructor, which is how
+ * pooled payloads are returned when their tokens are done with.
+ * @param buffer A buffer returned by lf_payload_pool_acquire().
+ */
+void lf_payload_pool_release(void* buffer);
+
+/**
+ * @brief Return the number of buffers of a pool that are not in use.
+ * @ingroup Federated
+ *
+ * @param pool The pool.
+ */
+size_t lf_payload_pool_available(lf_payload_pool_t* pool);
+
+#endif // PAYLOAD_POOL_H
@@ -0,0 +1,274 @@
+/**
+ * @file metrics.h
+ * @brief Operational counters of the runtime.
+ * @ingroup Tracing
+ *
+ * When the runtime is compiled with `LF_METRICS` defined, each environment maintains counters of
+ * the tags it has processed, the reactions it has queued and executed, the time its workers have
+ * spent waiting for work, and the STP and deadline violations it has seen, together with gauges
+ * of its event queue size and of how far physical time was ahead of logical time when it last
+ * advanced its tag. The runtime also counts the tokens that are live and the tokens waiting on
+ * the recycling bin and, in federates compiled with `FEDERATED_COMPRESSION`, the bytes going into
+ * and out of the codec that compresses message payloads and the CPU time spent in it. Federates
+ * compiled with `FEDERATED_ADAPTIVE_STAA` also export, per network input port, the messages that
+ * arrived, those that arrived late, the arrival lag of the last one, and the STAA, together with
+ * the STA that they adapt. Counters are updated with relaxed atomic operations, so keeping them
+ * costs no more than an uncontended increment, and they are consistent only individually.
+ *
+ * The counters are available through lf_metrics_snapshot(). In addition, if the program is
+ * started with `--metrics <destination>`, they are published in the Prometheus text exposition
+ * format. If the destination has the form `unix:<path>`, the runtime listens on a Unix domain
+ * socket at `<path>` and writes a snapshot to each client that connects, which suits a scraper
+ * or `socat`. Otherwise, the destination is a file that is replaced with a fresh snapshot every
+ * `--metrics-interval` (one second by default) and when the program terminates. Without the
+ * threaded runtime, or on platforms other than Linux and macOS, the file is written only when the
+ * program terminates and a Unix domain socket is not supported.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lf_types.h"
+
+/**
+ * @brief Snapshot of the counters of one environment.
+ * @ingroup Tracing
+ */
+typedef struct lf_environment_metrics_t {
+  /** The ID of the environment. */
+  int environment;
+  /** The name of the environment. */
+  const char* name;
+  /** The number of workers of the environment. */
+  int workers;
+  /** Number of tags the environment has advanced to. */
+  int64_t tags;
+  /** Number of reactions put on the reaction queue. */
+  int64_t reactions_queued;
+  /** Number of reactions taken off the reaction queue and completed. */
+  int64_t reactions_done;
+  /** Size of the event queue when the environment last advanced its tag. */
+  int64_t event_queue_size;
+  /** Physical time minus logical time when the environment last advanced its tag. */
+  interval_t tag_lag;
+  /** Total time the workers have spent waiting for work. */
+  interval_t idle_time;
+  /** Number of triggers that arrived after their intended tag. */
+  int64_t stp_violations;
+  /** Number of reactions that missed their deadline. */
+  int64_t deadline_violations;
+} lf_environment_metrics_t;
+
+/**
+ * @brief Snapshot of the counters of one network input port of a federate.
+ * @ingroup Tracing
+ *
+ * These are kept only by federates under decentralized coordination that adapt their STA and
+ * STAA offsets (@see FEDERATED_ADAPTIVE_STAA in federate.h).
+ */
+typedef struct lf_network_input_metrics_t {
+  /** The ID of the port. */
+  int port;
+  /** Number of tagged messages that arrived on the port. */
+  int64_t messages;
+  /** Number of these that arrived later than the STA plus the STAA of the port after their intended time. */
+  int64_t late_messages;
+  /** Physical time of arrival minus intended time of the last message that arrived on the port. */
+  interval_t arrival_lag;
+  /** The current STAA offset of the port. */
+  interval_t staa;
+} lf_network_input_metrics_t;
+
+/**
+ * @brief Snapshot of the counters of the runtime.
+ * @ingroup Tracing
+ */
+typedef struct lf_metrics_t {
+  /** Physical time at which the snapshot was taken. */
+  instant_t time;
+  /** Physical time elapsed since the counters were initialized. */
+  interval_t elapsed;
+  /** Number of tokens allocated and not yet freed. */
+  int64_t tokens_live;
+  /** Number of freed tokens waiting on the recycling bin to be reused. */
+  int64_t tokens_recycled;
+  /** Number of tagged message payloads that were offered to the codec (@see compression.h). */
+  int64_t messages_compressed;
+  /** Total size of the payloads offered to the codec. */
+  int64_t compression_input_bytes;
+  /** Total size of these payloads as sent, which is the uncompressed size of those that did not get smaller. */
+  int64_t compression_output_bytes;
+  /** CPU time spent compressing payloads. */
+  interval_t compression_cpu_time;
+  /** Number of tagged message payloads that were decompressed. */
+  int64_t messages_decompressed;
+  /** CPU time spent decompressing payloads. */
+  interval_t decompression_cpu_time;
+  /** The current STA offset of a federate that adapts it, or 0. */
+  interval_t sta;
+  /** Number of network input ports with counters, which is 0 unless the STAA offsets are adapted. */
+  size_t num_network_inputs;
+  /** The counters of each network input port. Free with lf_metrics_free(). */
+  lf_network_input_metrics_t* network_inputs;
+  /** Number of environments. */
+  size_t num_environments;
+  /** The counters of each environment. Free with lf_metrics_free(). */
+  lf_environment_metrics_t* environments;
+} lf_metrics_t;
+
+/**
+ * @brief Take a snapshot of the counters.
+ * @ingroup Tracing
+ *
+ * This can be called at any time from any thread, including from a reaction.
+ * @param metrics The snapshot to fill in. Its contents must be freed with lf_metrics_free().
+ * @return 0 on success or -1 if the counters have not been initialized yet.
+ */
+int lf_metrics_snapshot(lf_metrics_t* metrics);
+
+/**
+ * @brief Free the contents of a snapshot returned by lf_metrics_snapshot().
+ * @ingroup Tracing
+ */
+void lf_metrics_free(lf_metrics_t* metrics);
+
+/**
+ * @brief Write a snapshot in the Prometheus text exposition format.
+ * @ingroup Tracing
+ *
+ * Rates, such as tags per second and the idle fraction of the workers, are computed over the
+ * time since the previous snapshot if one is given and since the start of execution otherwise.
+ * @param file The file to write to.
+ * @param metrics The snapshot to write.
+ * @param previous An earlier snapshot or NULL.
+ */
+void lf_metrics_write_prometheus(FILE* file, const lf_metrics_t* metrics, const lf_metrics_t* previous);
+
+#ifdef LF_METRICS
+
+/// \cond INTERNAL  // Doxygen conditional.
+
+/**
+ * @brief Set the destination given with the `--metrics` command-line option.
+ */
+void _lf_metrics_set_destination(const char* destination);
+
+/**
+ * @brief Set the interval given with the `--metrics-interval` command-line option.
+ */
+void _lf_metrics_set_interval(interval_t interval);
+
+/**
+ * @brief Allocate the counters of all environments and start publishing them.
+ *
+ * This is called by the runtime once all environments have been initialized.
+ * @param process_name The name of the process, used to label the published counters.
+ */
+void _lf_metrics_init(const char* process_name);
+
+/**
+ * @brief Stop publishing the counters, writing a last snapshot if publishing to a file.
+ */
+void _lf_metrics_shutdown(void);
+
+void _lf_metrics_tag_advanced(environment_t* env);
+void _lf_metrics_reaction_queued(environment_t* env);
+void _lf_metrics_reaction_done(environment_t* env);
+void _lf_metrics_worker_wait_starts(environment_t* env, int worker);
+void _lf_metrics_worker_wait_ends(environment_t* env, int worker);
+void _lf_metrics_stp_violation(environment_t* env);
+void _lf_metrics_deadline_violation(environment_t* env);
+void _lf_metrics_token_allocated(bool recycled);
+void _lf_metrics_token_freed(bool recycled);
+void _lf_metrics_message_compressed(size_t input_bytes, size_t output_bytes, interval_t cpu_time);
+void _lf_metrics_message_decompressed(interval_t cpu_time);
+void _lf_metrics_network_inputs_init(size_t count);
+void _lf_metrics_sta_set(interval_t sta);
+void _lf_metrics_staa_set(int port, interval_t staa);
+void _lf_metrics_network_input_message(int port, interval_t arrival_lag, bool late);
+
+/// \endcond INTERNAL  // Doxygen conditional.
+
+#define metrics_tag_advanced(env) _lf_metrics_tag_advanced(env)
+#define metrics_reaction_queued(env) _lf_metrics_reaction_queued(env)
+#define metrics_reaction_done(env) _lf_metrics_reaction_done(env)
+#define metrics_worker_wait_starts(env, worker) _lf_metrics_worker_wait_starts(env, worker)
+#define metrics_worker_wait_ends(env, worker) _lf_metrics_worker_wait_ends(env, worker)
+#define metrics_stp_violation(env) _lf_metrics_stp_violation(env)
+#define metrics_deadline_violation(env) _lf_metrics_deadline_violation(env)
+#define metrics_token_allocated(recycled) _lf_metrics_token_allocated(recycled)
+#define metrics_token_freed(recycled) _lf_metrics_token_freed(recycled)
+#define metrics_network_inputs_init(count) _lf_metrics_network_inputs_init(count)
+#define metrics_sta_set(sta) _lf_metrics_sta_set(sta)
+#define metrics_staa_set(port, staa) _lf_metrics_staa_set(port, staa)
+#define metrics_network_input_message(port, arrival_lag, late)                                                         \
+  _lf_metrics_network_input_message(port, arrival_lag, late)
+
+#else
+
+#define metrics_tag_advanced(env)                                                                                      \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+  }
+#define metrics_reaction_queued(env)                                                                                   \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+  }
+#define metrics_reaction_done(env)                                                                                     \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+  }
+#define metrics_worker_wait_starts(env, worker)                                                                        \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+    (void)worker;                                                                                                      \
+  }
+#define metrics_worker_wait_ends(env, worker)                                                                          \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+    (void)worker;                                                                                                      \
+  }
+#define metrics_stp_violation(env)                                                                                     \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+  }
+#define metrics_deadline_violation(env)                                                                                \
+  while (0) {                                                                                                          \
+    (void)env;                                                                                                         \
+  }
+#define metrics_token_allocated(recycled)                                                                              \
+  while (0) {                                                                                                          \
+    (void)(recycled);                                                                                                  \
+  }
+#define metrics_token_freed(recycled)                                                                                  \
+  while (0) {                                                                                                          \
+    (void)(recycled);                                                                                                  \
+  }
+#define metrics_network_inputs_init(count)                                                                             \
+  while (0) {                                                                                                          \
+    (void)(count);                                                                                                     \
+  }
+#define metrics_sta_set(sta)                                                                                           \
+  while (0) {                                                                                                          \
+    (void)(sta);                                                                                                       \
+  }
+#define metrics_staa_set(port, staa)                                                                                   \
+  while (0) {                                                                                                          \
+    (void)(port);                                                                                                      \
+    (void)(staa);                                                                                                      \
+  }
+#define metrics_network_input_message(port, arrival_lag, late)                                                         \
+  while (0) {                                                                                                          \
+    (void)(port);                                                                                                      \
+    (void)(arrival_lag);                                                                                               \
+    (void)(late);                                                                                                      \
+  }
+
+#endif // LF_METRICS
+
+#endif // METRICS_H
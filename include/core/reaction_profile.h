@@ -0,0 +1,132 @@
+/**
+ * @file reaction_profile.h
+ * @brief Always-on profiling of reaction execution times.
+ * @ingroup Tracing
+ *
+ * When the runtime is compiled with `LF_REACTION_PROFILING` defined, every invocation of a reaction
+ * records three values into log-linear histograms (see @ref log_histogram.h):
+ * * the execution time of the reaction body,
+ * * the lag, which is the physical time at which the reaction starts minus the logical time, and
+ * * the deadline slack, which is the time left until the deadline when the reaction starts
+ *   (recorded only for reactions that have a deadline).
+ *
+ * Histograms are kept separately by each worker, which records into them without taking a lock.
+ * They are merged when a snapshot is taken with
+ * lf_reaction_profile_snapshot() and when the program terminates, at which point the merged
+ * profile is written to `<name>_<id>_profile.json` and `<name>_<id>_profile.csv` in the current
+ * directory, where `<name>` and `<id>` are the same as for the trace file.
+ */
+
+#ifndef REACTION_PROFILE_H
+#define REACTION_PROFILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "lf_types.h"
+#include "log_histogram.h"
+
+/**
+ * @brief Maximum length of the reactor name recorded in a reaction profile.
+ * @ingroup Tracing
+ */
+#define LF_REACTION_PROFILE_NAME_LENGTH 128
+
+/**
+ * @brief The execution profile of a reaction.
+ * @ingroup Tracing
+ */
+typedef struct lf_reaction_profile_t {
+  /** The reaction. This is not valid after the program terminates. */
+  const reaction_t* reaction;
+  /** The ID of the environment in which the reaction executes. */
+  int environment;
+  /** The full name of the reactor containing the reaction. */
+  char reactor[LF_REACTION_PROFILE_NAME_LENGTH];
+  /** The number of the reaction within its reactor. */
+  int number;
+  /** The deadline of the reaction or a negative number if it has none. */
+  interval_t deadline;
+  /** Execution times of the reaction body, which cannot be negative. */
+  log_histogram_nonnegative_t exec_time;
+  /** Physical time minus logical time when the reaction starts. */
+  log_histogram_t lag;
+  /** Time left until the deadline when the reaction starts. */
+  log_histogram_t slack;
+} lf_reaction_profile_t;
+
+/**
+ * @brief Return a snapshot of the profiles of all reactions that have executed so far.
+ * @ingroup Tracing
+ *
+ * This can be called at any time from any thread, including from a reaction. The histograms of
+ * each reaction are copied under a sequence lock, so taking a snapshot never delays a worker
+ * that records into them, and the copy is retried if the worker recorded while it was made.
+ *
+ * @param profiles Where to put a pointer to an array of profiles, ordered by environment,
+ * reactor name and reaction number. The array must be freed with free().
+ * @return The number of profiles in the array or 0 if profiling is not enabled.
+ */
+size_t lf_reaction_profile_snapshot(lf_reaction_profile_t** profiles);
+
+/**
+ * @brief Write reaction profiles in JSON format.
+ * @ingroup Tracing
+ *
+ * @param file The file to write to.
+ * @param profiles The profiles, for example as returned by lf_reaction_profile_snapshot().
+ * @param count The number of profiles.
+ */
+void lf_reaction_profile_write_json(FILE* file, const lf_reaction_profile_t* profiles, size_t count);
+
+/**
+ * @brief Write reaction profiles in CSV format, with one line for each reaction and metric.
+ * @ingroup Tracing
+ *
+ * @param file The file to write to.
+ * @param profiles The profiles, for example as returned by lf_reaction_profile_snapshot().
+ * @param count The number of profiles.
+ */
+void lf_reaction_profile_write_csv(FILE* file, const lf_reaction_profile_t* profiles, size_t count);
+
+/// \cond INTERNAL  // Doxygen conditional.
+
+/**
+ * @brief Allocate the per-worker profiles of all environments.
+ *
+ * This is called by the runtime once all environments have been initialized.
+ * @param process_name The name of the process, used to name the output files.
+ * @param process_id The ID of the process, used to name the output files.
+ */
+void _lf_reaction_profile_init(const char* process_name, int process_id);
+
+/**
+ * @brief Record an invocation of a reaction.
+ *
+ * This is called by the worker that invoked the reaction after the reaction body returns.
+ * @param env The environment in which the reaction executed.
+ * @param reaction The reaction.
+ * @param worker The number of the worker that executed the reaction.
+ * @param start The physical time at which the reaction body started.
+ * @param end The physical time at which the reaction body returned.
+ */
+void _lf_reaction_profile_record(environment_t* env, reaction_t* reaction, int worker, instant_t start,
+                                 instant_t end);
+
+/**
+ * @brief Write the merged profiles to the output files.
+ *
+ * This is called by the runtime when the program terminates.
+ */
+void _lf_reaction_profile_shutdown(void);
+
+/**
+ * @brief Free the per-worker profiles.
+ *
+ * This is called by the runtime on normal termination, once no worker is executing reactions.
+ */
+void _lf_reaction_profile_free(void);
+
+/// \endcond INTERNAL  // Doxygen conditional.
+
+#endif // REACTION_PROFILE_H
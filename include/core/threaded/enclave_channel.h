@@ -0,0 +1,127 @@
+/**
+ * @file enclave_channel.h
+ *
+ * @brief Zero-copy channels that pass tokens from one scheduling enclave to another.
+ * @ingroup Internal
+ *
+ * A channel connects an output of one enclave (the sender) to a trigger in another
+ * (the receiver). It is a bounded single-producer, single-consumer ring of token pointers
+ * with their tags. Sending a token puts the pointer on the ring, without copying the
+ * payload and without taking any mutex of the receiver; the token then belongs to the
+ * receiver. The receiver takes a token off the ring when it advances to the tag of the
+ * token, at which point the token is delivered to the trigger as if it had been scheduled
+ * at that tag.
+ *
+ * The ring applies backpressure: an enclave that has a full outbound channel waits, once
+ * it has been granted its next tag, until the receiver has advanced past at least one of
+ * the tokens in that channel. This bounds the number of tokens in flight by the capacity of
+ * the channel. Since the sender first sends its next event tag (NET), the receiver can
+ * always be granted the tags of the tokens that are in the channel.
+ */
+
+#ifndef ENCLAVE_CHANNEL_H
+#define ENCLAVE_CHANNEL_H
+
+#ifdef LF_ENCLAVES
+
+#include "lf_types.h"
+#include "environment.h"
+
+/**
+ * @brief Default number of tokens that a channel can hold.
+ * @ingroup Internal
+ */
+#ifndef LF_ENCLAVE_CHANNEL_CAPACITY
+#define LF_ENCLAVE_CHANNEL_CAPACITY 64
+#endif
+
+/**
+ * @brief Create a channel from one enclave to another.
+ * @ingroup Internal
+ *
+ * This is meant to be called while the environments are being set up, before any of
+ * them starts executing.
+ *
+ * @param sender The environment of the enclave that sends tokens.
+ * @param receiver The environment of the enclave that receives tokens. It must differ from the sender.
+ * @param trigger The trigger in the receiver to which tokens are delivered.
+ * @param delay The delay of the connection, or NEVER if the tag of a token is the tag at which it is sent.
+ * @param capacity The maximum number of tokens in flight, rounded up to a power of two.
+ * @return The channel, which lives until the receiver is freed.
+ */
+lf_enclave_channel_t* lf_enclave_channel_new(environment_t* sender, environment_t* receiver, trigger_t* trigger,
+                                             interval_t delay, size_t capacity);
+
+/**
+ * @brief Send a token through a channel at the current tag of the sender.
+ * @ingroup Internal
+ *
+ * The token must not be referenced by anything else, which is the case for a token
+ * returned by lf_new_token() that has not been set on a port nor scheduled. Its ownership
+ * passes to the channel, so the caller must not use it afterwards. A channel carries at
+ * most one token per tag, which is what guarantees that there is room for it.
+ *
+ * This is to be called from a reaction of the sender.
+ *
+ * @param channel The channel.
+ * @param token The token to send, or NULL for an event with no payload.
+ * @return 0 on success, -1 if the token is referenced elsewhere or the channel is full.
+ */
+int lf_enclave_channel_send(lf_enclave_channel_t* channel, lf_token_t* token);
+
+/**
+ * @brief Return the earlier of the given tag and the tags of the tokens waiting in the inbound channels.
+ * @ingroup Internal
+ *
+ * This assumes the caller holds the mutex of the environment.
+ *
+ * @param env The environment of the receiver.
+ * @param tag The tag of the earliest event on the event queue.
+ */
+tag_t _lf_enclave_channels_next_tag_locked(environment_t* env, tag_t tag);
+
+/**
+ * @brief Deliver to their triggers the tokens of the inbound channels with tags up to the given tag.
+ * @ingroup Internal
+ *
+ * This puts the tokens on the event queue and wakes any sender waiting for room in a channel.
+ * This assumes the caller holds the mutex of the environment.
+ *
+ * @param env The environment of the receiver.
+ * @param tag The tag to which the receiver is about to advance.
+ */
+void _lf_enclave_channels_deliver_locked(environment_t* env, tag_t tag);
+
+/**
+ * @brief Wait until every outbound channel has room for one more token.
+ * @ingroup Internal
+ *
+ * This assumes the caller holds the mutex of the environment, which is released while waiting.
+ *
+ * @param env The environment of the sender.
+ */
+void _lf_enclave_channels_wait_for_room_locked(environment_t* env);
+
+/**
+ * @brief Close the inbound channels of an enclave that has finished executing.
+ * @ingroup Internal
+ *
+ * Senders stop waiting for room in a closed channel, and tokens sent through it are dropped.
+ *
+ * @param env The environment of the receiver.
+ */
+void _lf_enclave_channels_close(environment_t* env);
+
+/**
+ * @brief Release the inbound and outbound channels of an environment.
+ * @ingroup Internal
+ *
+ * A channel is freed, with any tokens left in it, once both its sender and its receiver have
+ * released it, so the environments can be freed in any order.
+ *
+ * @param env The environment.
+ */
+void _lf_enclave_channels_free(environment_t* env);
+
+#endif // LF_ENCLAVES
+#endif // ENCLAVE_CHANNEL_H
@@ -364,6 +364,32 @@ static inline void tracepoint_rti_from_federate(trace_event_t event_type, int fe
 }
 #endif // RTI_TRACE
 
+#if defined(FEDERATED) || defined(RTI_TRACE)
+
+/**
+ * @brief Trace the end of a phase of the startup of a federate or the RTI.
+ * @ingroup Federated
+ *
+ * The physical time of the record is the end of the phase and its extra delay is the duration of the phase.
+ *
+ * @param event_type The phase. Possible values are startup_connect_to_rti, startup_clock_sync,
+ * startup_connect_to_federate, and startup_start_time for a federate and startup_federate_handshake
+ * and startup_accept_federates for the RTI.
+ * @param self_id The federate ID, or -1 for the RTI.
+ * @param partner_id The ID of the federate with which the phase connects, or -1 if none.
+ * @param start The physical time at which the phase started.
+ */
+void tracepoint_startup_phase(trace_event_t event_type, int self_id, int partner_id, instant_t start);
+
+#else
+static inline void tracepoint_startup_phase(trace_event_t event_type, int self_id, int partner_id, instant_t start) {
+  (void)event_type;
+  (void)self_id;
+  (void)partner_id;
+  (void)start;
+}
+#endif // FEDERATED || RTI_TRACE
+
 #else
 typedef struct trace_t trace_t;
 static inline int register_user_trace_event(void* self, char* description) {
@@ -417,6 +443,12 @@ static inline void tracepoint_federate_from_federate(trace_event_t event_type, i
   (void)partner_id;
   (void)tag;
 }
+static inline void tracepoint_startup_phase(trace_event_t event_type, int self_id, int partner_id, instant_t start) {
+  (void)event_type;
+  (void)self_id;
+  (void)partner_id;
+  (void)start;
+}
 
 /// \cond INTERNAL  // Doxygen conditional.
 // The following is defined in trace.h, so ask Doxygen to ignore this.
@@ -1,7 +1,7 @@
 /**
  * @file hashmap.h
  * @author Peter Donovan (peterdonovan@berkeley.edu)
- * @brief Defines a generic, non-resizing hashmap data type.
+ * @brief Defines a generic hashmap data type that grows as entries are added.
  * @ingroup Utilities
  *
  * Hashmaps are defined by redefining K, V, HASH_OF, and HASHMAP, and including this file. A default
@@ -28,6 +28,7 @@
 #endif
 
 #include <stddef.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <stdbool.h>
 
@@ -59,8 +60,10 @@ typedef struct HASHMAP(t) {
  * @brief Construct a new hashmap object.
  * @ingroup Utilities
  *
- * @param capacity A number that is much larger than the maximum number of items that this
- * hashmap will contain. Insufficient surplus capacity will cause poor performance.
+ * The capacity is doubled whenever the hashmap becomes more than half full, so the initial
+ * capacity only needs to be a reasonable guess of the number of items the hashmap will contain.
+ *
+ * @param capacity The initial capacity of the hashmap.
  * @param nothing A key that is guaranteed never to be used.
  */
 HASHMAP(t) * HASHMAP(new)(size_t capacity, K nothing);
@@ -85,6 +88,17 @@ void HASHMAP(put)(HASHMAP(t) * hashmap, K key, V value);
  */
 V HASHMAP(get)(HASHMAP(t) * hashmap, K key);
 
+/**
+ * @brief Get the value associated with the given key if there is one.
+ * @ingroup Utilities
+ *
+ * @param hashmap The hashmap to search.
+ * @param key The key to look up.
+ * @param value Pointer into which to write the value if the key is present.
+ * @return true if the key is present, false otherwise.
+ */
+bool HASHMAP(find)(HASHMAP(t) * hashmap, K key, V* value);
+
 /////////////////////////// Private helpers ///////////////////////////
 
 static HASHMAP(entry_t) * HASHMAP(get_ideal_address)(HASHMAP(t) * hashmap, K key) {
@@ -118,6 +132,32 @@ static HASHMAP(entry_t) * HASHMAP(get_actual_address)(HASHMAP(t) * hashmap, K ke
   return address;
 }
 
+/**
+ * @brief Double the capacity of the hashmap and reinsert all of its entries.
+ * @ingroup Utilities
+ *
+ * @param hashmap The hashmap to grow.
+ */
+static void HASHMAP(grow)(HASHMAP(t) * hashmap) {
+  HASHMAP(entry_t)* old_entries = hashmap->entries;
+  size_t old_capacity = hashmap->capacity;
+  size_t capacity = old_capacity ? old_capacity * 2 : 1;
+  HASHMAP(entry_t)* entries = (HASHMAP(entry_t)*)malloc((capacity + 1) * sizeof(HASHMAP(entry_t)));
+  if (!entries)
+    exit(1);
+  for (size_t i = 0; i < capacity + 1; i++) {
+    entries[i].key = hashmap->nothing;
+  }
+  hashmap->entries = entries;
+  hashmap->capacity = capacity;
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_entries[i].key != hashmap->nothing) {
+      *HASHMAP(get_actual_address)(hashmap, old_entries[i].key) = old_entries[i];
+    }
+  }
+  free(old_entries);
+}
+
 //////////////////////// Function definitions /////////////////////////
 
 HASHMAP(t) * HASHMAP(new)(size_t capacity, K nothing) {
@@ -148,6 +188,14 @@ void HASHMAP(free)(HASHMAP(t) * hashmap) {
 void HASHMAP(put)(HASHMAP(t) * hashmap, K key, V value) {
   assert(key != hashmap->nothing);
   HASHMAP(entry_t)* write_to = HASHMAP(get_actual_address)(hashmap, key);
+  if (write_to == NULL || write_to->key != key) {
+    // This is a new key. Keep the hashmap at most half full so that probe sequences stay short.
+    if (2 * (hashmap->num_entries + 1) > hashmap->capacity) {
+      HASHMAP(grow)(hashmap);
+      write_to = HASHMAP(get_actual_address)(hashmap, key);
+    }
+    hashmap->num_entries++;
+  }
   write_to->key = key;
   write_to->value = value;
 }
@@ -157,3 +205,12 @@ V HASHMAP(get)(HASHMAP(t) * hashmap, K key) {
   HASHMAP(entry_t)* read_from = HASHMAP(get_actual_address)(hashmap, key);
   return read_from->value; // Crash the program if the key cannot be found
 }
+
+bool HASHMAP(find)(HASHMAP(t) * hashmap, K key, V* value) {
+  assert(key != hashmap->nothing);
+  HASHMAP(entry_t)* read_from = HASHMAP(get_actual_address)(hashmap, key);
+  if (read_from == NULL || read_from->key != key)
+    return false;
+  *value = read_from->value;
+  return true;
+}
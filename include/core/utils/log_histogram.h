@@ -0,0 +1,322 @@
+/**
+ * @file log_histogram.h
+ * @brief Log-linear (HDR-style) histograms of signed 64-bit values.
+ * @ingroup Utilities
+ *
+ * Magnitudes below LOG_HISTOGRAM_SUB_BUCKETS are counted exactly. Larger magnitudes are counted in
+ * LOG_HISTOGRAM_SUB_BUCKETS equally sized buckets per power of two, so a value reported from
+ * the histogram differs from the recorded value by less than one part in LOG_HISTOGRAM_SUB_BUCKETS.
+ * Negative values, such as a missed deadline's slack, are counted by magnitude in buckets of their own.
+ * Quantities that cannot be negative, such as durations, are better kept in a log_histogram_nonnegative_t,
+ * which has no such buckets and is half the size.
+ * Recording a value is a handful of shifts and one increment, and a histogram has a fixed size,
+ * so histograms are suitable for accumulating statistics in a thread without locking.
+ * Two histograms are merged by adding their counts, so per-thread histograms can be merged
+ * into the same result regardless of the order in which they are merged.
+ *
+ * All functions are static inline so that this header can be used by the runtime as well as
+ * by standalone tools.
+ */
+
+#ifndef LOG_HISTOGRAM_H
+#define LOG_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** Number of bits of precision kept for each value. */
+#define LOG_HISTOGRAM_SUB_BUCKET_BITS 5
+
+/** Number of buckets per power of two. */
+#define LOG_HISTOGRAM_SUB_BUCKETS (1 << LOG_HISTOGRAM_SUB_BUCKET_BITS)
+
+/** Total number of buckets needed to cover all nonnegative int64_t values, and as many for negative values. */
+#define LOG_HISTOGRAM_NUM_BUCKETS ((64 - LOG_HISTOGRAM_SUB_BUCKET_BITS) * LOG_HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * @brief A log-linear histogram.
+ * @ingroup Utilities
+ *
+ * A histogram that is zero filled (e.g. allocated with calloc) is empty.
+ */
+typedef struct log_histogram_t {
+  /** Number of values recorded. */
+  uint64_t count;
+  /** Sum of the values recorded. */
+  int64_t total;
+  /** Smallest value recorded, meaningful only if count > 0. */
+  int64_t min;
+  /** Largest value recorded, meaningful only if count > 0. */
+  int64_t max;
+  /** Count of nonnegative values recorded in each bucket. */
+  uint64_t buckets[LOG_HISTOGRAM_NUM_BUCKETS];
+  /** Count of negative values recorded in each bucket, by the bucket of their magnitude. */
+  uint64_t negative_buckets[LOG_HISTOGRAM_NUM_BUCKETS];
+} log_histogram_t;
+
+/**
+ * @brief A log-linear histogram of values that cannot be negative.
+ * @ingroup Utilities
+ *
+ * This has the fields of a log_histogram_t other than the buckets of negative values.
+ * A histogram that is zero filled is empty.
+ */
+typedef struct log_histogram_nonnegative_t {
+  /** Number of values recorded. */
+  uint64_t count;
+  /** Sum of the values recorded. */
+  int64_t total;
+  /** Smallest value recorded, meaningful only if count > 0. */
+  int64_t min;
+  /** Largest value recorded, meaningful only if count > 0. */
+  int64_t max;
+  /** Count of values recorded in each bucket. */
+  uint64_t buckets[LOG_HISTOGRAM_NUM_BUCKETS];
+} log_histogram_nonnegative_t;
+
+/**
+ * @brief Return the position of the most significant set bit of a nonzero value.
+ * @ingroup Utilities
+ */
+static inline int log_histogram_msb(uint64_t value) {
+  int result = 0;
+  if (value >> 32) {
+    value >>= 32;
+    result += 32;
+  }
+  if (value >> 16) {
+    value >>= 16;
+    result += 16;
+  }
+  if (value >> 8) {
+    value >>= 8;
+    result += 8;
+  }
+  if (value >> 4) {
+    value >>= 4;
+    result += 4;
+  }
+  if (value >> 2) {
+    value >>= 2;
+    result += 2;
+  }
+  if (value >> 1) {
+    result += 1;
+  }
+  return result;
+}
+
+/**
+ * @brief Return the index of the bucket that counts the given nonnegative value or magnitude.
+ * @ingroup Utilities
+ *
+ * For a negative value, use log_histogram_magnitude() first.
+ */
+static inline int log_histogram_bucket(int64_t value) {
+  if (value < LOG_HISTOGRAM_SUB_BUCKETS) {
+    return value < 0 ? 0 : (int)value;
+  }
+  int exponent = log_histogram_msb((uint64_t)value);
+  int shift = exponent - LOG_HISTOGRAM_SUB_BUCKET_BITS;
+  return (shift + 1) * LOG_HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) & (LOG_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Return the magnitude of a negative value, with INT64_MIN taken as -INT64_MAX.
+ * @ingroup Utilities
+ */
+static inline int64_t log_histogram_magnitude(int64_t value) { return value == INT64_MIN ? INT64_MAX : -value; }
+
+/**
+ * @brief Return the smallest value that is counted in the given bucket.
+ * @ingroup Utilities
+ */
+static inline int64_t log_histogram_bucket_min(int bucket) {
+  if (bucket < LOG_HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / LOG_HISTOGRAM_SUB_BUCKETS - 1;
+  return (int64_t)((uint64_t)(LOG_HISTOGRAM_SUB_BUCKETS + bucket % LOG_HISTOGRAM_SUB_BUCKETS) << shift);
+}
+
+/**
+ * @brief Return the largest value that is counted in the given bucket.
+ * @ingroup Utilities
+ */
+static inline int64_t log_histogram_bucket_max(int bucket) {
+  if (bucket < LOG_HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / LOG_HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t lowest = (uint64_t)(LOG_HISTOGRAM_SUB_BUCKETS + bucket % LOG_HISTOGRAM_SUB_BUCKETS) << shift;
+  return (int64_t)(lowest + (((uint64_t)1 << shift) - 1));
+}
+
+/**
+ * @brief Record a value in the histogram.
+ * @ingroup Utilities
+ */
+static inline void log_histogram_record(log_histogram_t* histogram, int64_t value) {
+  if (histogram->count == 0 || value < histogram->min) {
+    histogram->min = value;
+  }
+  if (histogram->count == 0 || value > histogram->max) {
+    histogram->max = value;
+  }
+  histogram->count++;
+  histogram->total += value;
+  if (value < 0) {
+    histogram->negative_buckets[log_histogram_bucket(log_histogram_magnitude(value))]++;
+  } else {
+    histogram->buckets[log_histogram_bucket(value)]++;
+  }
+}
+
+/**
+ * @brief Add the counts of the histogram `source` to the histogram `destination`.
+ * @ingroup Utilities
+ */
+static inline void log_histogram_merge(log_histogram_t* destination, const log_histogram_t* source) {
+  if (source->count == 0) {
+    return;
+  }
+  if (destination->count == 0 || source->min < destination->min) {
+    destination->min = source->min;
+  }
+  if (destination->count == 0 || source->max > destination->max) {
+    destination->max = source->max;
+  }
+  destination->count += source->count;
+  destination->total += source->total;
+  for (int i = 0; i < LOG_HISTOGRAM_NUM_BUCKETS; i++) {
+    destination->buckets[i] += source->buckets[i];
+    destination->negative_buckets[i] += source->negative_buckets[i];
+  }
+}
+
+/**
+ * @brief Return the value at a percentile of the counts in the given buckets.
+ * @ingroup Utilities
+ *
+ * This is the implementation of log_histogram_percentile() and log_histogram_nonnegative_percentile().
+ * @param negative_buckets The buckets of negative values or NULL if there are none.
+ */
+static inline int64_t log_histogram_percentile_of_buckets(uint64_t count, int64_t min, int64_t max,
+                                                          const uint64_t* buckets, const uint64_t* negative_buckets,
+                                                          double percentile) {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(percentile / 100.0 * (double)count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  int64_t value = max;
+  // Negative values come first, from the largest magnitude down.
+  for (int i = LOG_HISTOGRAM_NUM_BUCKETS - 1; negative_buckets != NULL && i >= 0 && seen < rank; i--) {
+    seen += negative_buckets[i];
+    if (seen >= rank) {
+      value = -log_histogram_bucket_min(i);
+    }
+  }
+  for (int i = 0; i < LOG_HISTOGRAM_NUM_BUCKETS && seen < rank; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      value = log_histogram_bucket_max(i);
+    }
+  }
+  if (value > max) {
+    value = max;
+  }
+  if (value < min) {
+    value = min;
+  }
+  return value;
+}
+
+/**
+ * @brief Return the value below or at which the given percentage of the recorded values lie.
+ * @ingroup Utilities
+ *
+ * The result is the largest value of the bucket containing the percentile, clamped to the
+ * range of recorded values, so it is exact for the minimum and maximum.
+ * @param histogram The histogram.
+ * @param percentile The percentile, between 0 and 100.
+ * @return The value at the percentile or 0 if the histogram is empty.
+ */
+static inline int64_t log_histogram_percentile(const log_histogram_t* histogram, double percentile) {
+  return log_histogram_percentile_of_buckets(histogram->count, histogram->min, histogram->max, histogram->buckets,
+                                             histogram->negative_buckets, percentile);
+}
+
+/**
+ * @brief Record a value that cannot be negative in the histogram.
+ * @ingroup Utilities
+ *
+ * A negative value, such as the difference of two readings of a clock that was set back, is recorded as 0.
+ */
+static inline void log_histogram_nonnegative_record(log_histogram_nonnegative_t* histogram, int64_t value) {
+  if (value < 0) {
+    value = 0;
+  }
+  if (histogram->count == 0 || value < histogram->min) {
+    histogram->min = value;
+  }
+  if (histogram->count == 0 || value > histogram->max) {
+    histogram->max = value;
+  }
+  histogram->count++;
+  histogram->total += value;
+  histogram->buckets[log_histogram_bucket(value)]++;
+}
+
+/**
+ * @brief Add the counts of the histogram `source` to the histogram `destination`.
+ * @ingroup Utilities
+ */
+static inline void log_histogram_nonnegative_merge(log_histogram_nonnegative_t* destination,
+                                                   const log_histogram_nonnegative_t* source) {
+  if (source->count == 0) {
+    return;
+  }
+  if (destination->count == 0 || source->min < destination->min) {
+    destination->min = source->min;
+  }
+  if (destination->count == 0 || source->max > destination->max) {
+    destination->max = source->max;
+  }
+  destination->count += source->count;
+  destination->total += source->total;
+  for (int i = 0; i < LOG_HISTOGRAM_NUM_BUCKETS; i++) {
+    destination->buckets[i] += source->buckets[i];
+  }
+}
+
+/**
+ * @brief Return the value below or at which the given percentage of the recorded values lie.
+ * @ingroup Utilities
+ *
+ * @see log_histogram_percentile()
+ */
+static inline int64_t log_histogram_nonnegative_percentile(const log_histogram_nonnegative_t* histogram,
+                                                           double percentile) {
+  return log_histogram_percentile_of_buckets(histogram->count, histogram->min, histogram->max, histogram->buckets,
+                                             NULL, percentile);
+}
+
+/**
+ * @brief Reset the histogram to be empty.
+ * @ingroup Utilities
+ */
+static inline void log_histogram_clear(log_histogram_t* histogram) { memset(histogram, 0, sizeof(log_histogram_t)); }
+
+/**
+ * @brief Reset the histogram to be empty.
+ * @ingroup Utilities
+ */
+static inline void log_histogram_nonnegative_clear(log_histogram_nonnegative_t* histogram) {
+  memset(histogram, 0, sizeof(log_histogram_nonnegative_t));
+}
+
+#endif // LOG_HISTOGRAM_H
@@ -250,6 +250,15 @@ int lf_mutex_lock(lf_mutex_t* mutex);
  */
 int lf_mutex_unlock(lf_mutex_t* mutex);
 
+/**
+ * @brief Release the resources of a mutex that no thread holds.
+ * @ingroup Platform
+ *
+ * @param mutex The mutex
+ * @return 0 on success
+ */
+int lf_mutex_destroy(lf_mutex_t* mutex);
+
 /**
  * @brief Initialize a conditional variable.
  * @ingroup Platform
@@ -259,6 +268,14 @@ int lf_mutex_unlock(lf_mutex_t* mutex);
  */
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex);
 
+/**
+ * @brief Release the resources of a condition variable on which no thread waits.
+ * @ingroup Platform
+ * @param cond The condition variable.
+ * @return 0 on success, platform-specific error number otherwise.
+ */
+int lf_cond_destroy(lf_cond_t* cond);
+
 /**
  * @brief Wake up all threads waiting for condition variable cond.
  * @ingroup Platform
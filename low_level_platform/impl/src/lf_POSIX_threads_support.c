@@ -41,6 +41,8 @@ int lf_mutex_lock(lf_mutex_t* mutex) { return pthread_mutex_lock((pthread_mutex_
 
 int lf_mutex_unlock(lf_mutex_t* mutex) { return pthread_mutex_unlock((pthread_mutex_t*)mutex); }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) { return pthread_mutex_destroy((pthread_mutex_t*)mutex); }
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   cond->mutex = mutex;
   pthread_condattr_t cond_attr;
@@ -50,6 +52,8 @@ int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   return pthread_cond_init(&cond->condition, &cond_attr);
 }
 
+int lf_cond_destroy(lf_cond_t* cond) { return pthread_cond_destroy((pthread_cond_t*)&cond->condition); }
+
 int lf_cond_broadcast(lf_cond_t* cond) { return pthread_cond_broadcast((pthread_cond_t*)&cond->condition); }
 
 int lf_cond_signal(lf_cond_t* cond) { return pthread_cond_signal((pthread_cond_t*)&cond->condition); }
@@ -181,11 +181,21 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  mutex_delete(*mutex);
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   *cond = (lf_cond_t)condition_new(*mutex);
   return 0;
 }
 
+int lf_cond_destroy(lf_cond_t* cond) {
+  condition_delete(*cond);
+  return 0;
+}
+
 int lf_cond_broadcast(lf_cond_t* cond) {
   condition_notify_all(*cond);
   return 0;
@@ -186,11 +186,23 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  // A FlexPRET lock holds no resources.
+  (void)mutex;
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   *cond = (lf_cond_t)FP_COND_INITIALIZER(mutex);
   return 0;
 }
 
+int lf_cond_destroy(lf_cond_t* cond) {
+  // Nor does a FlexPRET condition variable.
+  (void)cond;
+  return 0;
+}
+
 int lf_cond_broadcast(lf_cond_t* cond) { return fp_cond_broadcast(cond); }
 
 int lf_cond_signal(lf_cond_t* cond) { return fp_cond_signal(cond); }
@@ -250,6 +250,12 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  // A pico-sdk mutex holds no resources.
+  (void)mutex;
+  return 0;
+}
+
 // condition variables "notify" threads using a semaphore per core.
 // although there are only two cores, may not use just a single semaphore
 // as a cond_broadcast may be called from within an interrupt
@@ -261,6 +267,12 @@ int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_cond_destroy(lf_cond_t* cond) {
+  // Nor does a pico-sdk semaphore.
+  (void)cond;
+  return 0;
+}
+
 int lf_cond_broadcast(lf_cond_t* cond) {
   for (int i = 0; i < NUM_CORES; i++) {
     sem_reset(&(cond->notifs[i]), 1);
@@ -207,11 +207,23 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return res;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  // A Zephyr kernel mutex holds no resources.
+  (void)mutex;
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   cond->mutex = mutex;
   return k_condvar_init(&cond->condition);
 }
 
+int lf_cond_destroy(lf_cond_t* cond) {
+  // Nor does a Zephyr kernel condition variable.
+  (void)cond;
+  return 0;
+}
+
 int lf_cond_broadcast(lf_cond_t* cond) {
   k_condvar_broadcast(&cond->condition);
   return 0;
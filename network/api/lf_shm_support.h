@@ -0,0 +1,114 @@
+/**
+ * @file lf_shm_support.h
+ * @brief Shared-memory network abstraction for federates and RTIs on the same host.
+ * @ingroup Network
+ *
+ * Connections are set up over TCP exactly as with the socket implementation. Right after the TCP
+ * connection is established, the accepting side creates a POSIX shared-memory segment holding one
+ * single-producer, single-consumer byte ring per direction and offers its name over TCP. If the
+ * connecting side can map the segment, which it can only if both run on the same host, all
+ * further bytes go through the rings, and a side that finds a ring empty, or full, sleeps on a
+ * futex in the segment until the other side wakes it. Otherwise, both sides keep using TCP.
+ *
+ * The TCP connection stays open while the rings are in use, so that either side notices when the
+ * other one exits, and so that the connection keeps its addresses and ports.
+ */
+
+#ifndef LF_SHM_SUPPORT_H
+#define LF_SHM_SUPPORT_H
+
+#include <stdint.h>
+
+#include "socket_common.h"
+
+/**
+ * @brief Capacity in bytes of the ring for each direction of a connection. Must be a power of two.
+ * @ingroup Network
+ */
+#ifndef LF_SHM_RING_SIZE
+#define LF_SHM_RING_SIZE (256u * 1024u)
+#endif
+
+/**
+ * @brief Interval at which a side waiting on a ring checks whether the other side still exists.
+ * @ingroup Network
+ */
+#define LF_SHM_LIVENESS_INTERVAL MSEC(100)
+
+/**
+ * @brief Length of the names of the shared-memory segments, including the terminating null character.
+ * @ingroup Network
+ */
+#define LF_SHM_NAME_LENGTH 64
+
+/**
+ * @brief One direction of a shared-memory connection.
+ * @ingroup Network
+ *
+ * The positions only grow. The writer owns `tail` and the reader owns `head`; each is on its own
+ * cache line so that the two sides do not contend for it.
+ */
+typedef struct shm_ring_t {
+  /** @brief Total number of bytes read. */
+  uint64_t head;
+  unsigned char head_padding[64 - sizeof(uint64_t)];
+  /** @brief Total number of bytes written. */
+  uint64_t tail;
+  unsigned char tail_padding[64 - sizeof(uint64_t)];
+  /** @brief Futex word that the writer changes to wake a sleeping reader. */
+  uint32_t data_futex;
+  /** @brief Whether the reader is, or is about to start, sleeping on data_futex. */
+  uint32_t reader_sleeping;
+  /** @brief Futex word that the reader changes to wake a sleeping writer. */
+  uint32_t space_futex;
+  /** @brief Whether the writer is, or is about to start, sleeping on space_futex. */
+  uint32_t writer_sleeping;
+  /** @brief Set by either side once no more bytes will be written or read. */
+  uint32_t closed;
+  unsigned char closed_padding[64 - 5 * sizeof(uint32_t)];
+  /** @brief The bytes, at their positions modulo LF_SHM_RING_SIZE. */
+  unsigned char data[LF_SHM_RING_SIZE];
+} shm_ring_t;
+
+/**
+ * @brief Layout of the shared-memory segment of a connection.
+ * @ingroup Network
+ */
+typedef struct shm_segment_t {
+  /** @brief Random value offered with the name of the segment, so that a segment of the same name on another
+   * host is never taken for it. */
+  uint64_t nonce;
+  unsigned char nonce_padding[64 - sizeof(uint64_t)];
+  /** @brief Bytes from the accepting side to the connecting side. */
+  shm_ring_t to_client;
+  /** @brief Bytes from the connecting side to the accepting side. */
+  shm_ring_t to_server;
+} shm_segment_t;
+
+/**
+ * @brief Structure holding information about a shared-memory network abstraction.
+ * @ingroup Network
+ */
+typedef struct shm_priv_t {
+  /** @brief The TCP connection over which the segment was offered. */
+  socket_priv_t* socket_priv;
+  /** @brief The mapped segment, or NULL if the connection uses TCP. */
+  shm_segment_t* segment;
+  /** @brief The ring from which this side reads. */
+  shm_ring_t* in;
+  /** @brief The ring to which this side writes. */
+  shm_ring_t* out;
+  /** @brief Serializes writers, as the ring has a single producer. */
+  lf_mutex_t write_mutex;
+} shm_priv_t;
+
+/**
+ * @brief Structure for shared-memory connection parameters.
+ * @ingroup Network
+ */
+typedef struct shm_connection_params_t {
+  /** @brief Parameters of the TCP connection over which the segment is offered. */
+  socket_connection_params_t socket_params;
+} shm_connection_params_t;
+
+#endif /* LF_SHM_SUPPORT_H */
@@ -0,0 +1,91 @@
+/**
+ * @file lf_uring_support.h
+ * @brief TCP network abstraction whose receive path is driven by io_uring completions.
+ * @ingroup Network
+ *
+ * Connections are set up exactly as with the socket implementation. Each connection then gets its
+ * own io_uring instance with a ring of receive buffers registered with the kernel, and a single
+ * multishot receive request. As bytes arrive, the kernel places them in a free buffer and posts a
+ * completion, without any system call by the reader. A reader that finds a completion waiting
+ * consumes the buffer in place and hands it back to the kernel by updating the ring; it only
+ * enters the kernel when no completion is waiting. Writes use writev() on the socket, which
+ * already sends each message with one system call.
+ *
+ * If the kernel does not support io_uring, or the multishot receive of Linux 6.0, the connection
+ * reads from the socket as the socket implementation does.
+ */
+
+#ifndef LF_URING_SUPPORT_H
+#define LF_URING_SUPPORT_H
+
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+#include "socket_common.h"
+
+/**
+ * @brief Number of receive buffers of each connection. Must be a power of two.
+ * @ingroup Network
+ */
+#ifndef LF_URING_BUFFER_COUNT
+#define LF_URING_BUFFER_COUNT 16u
+#endif
+
+/**
+ * @brief Size in bytes of each receive buffer.
+ * @ingroup Network
+ */
+#define LF_URING_BUFFER_SIZE NET_RECEIVE_BUFFER_SIZE
+
+/**
+ * @brief Structure holding information about an io_uring network abstraction.
+ * @ingroup Network
+ */
+typedef struct uring_priv_t {
+  /** @brief The TCP connection. */
+  socket_priv_t* socket_priv;
+  /** @brief The file descriptor of the io_uring instance, or -1 if the connection reads from the socket. */
+  int ring_descriptor;
+  /** @brief The submission and completion queues, mapped together. */
+  void* rings;
+  /** @brief Size of the mapping of the queues. */
+  size_t rings_size;
+  /** @brief The submission queue entries. */
+  struct io_uring_sqe* sqes;
+  /** @brief Size of the mapping of the submission queue entries. */
+  size_t sqes_size;
+  /** @brief Position of the next submission queue entry to be taken by the kernel. */
+  uint32_t* sq_head;
+  /** @brief Position of the next submission queue entry to be filled. */
+  uint32_t* sq_tail;
+  /** @brief Mask that gives the index of the submission queue entry at a position. */
+  uint32_t sq_mask;
+  /** @brief Indirection array of the submission queue. */
+  uint32_t* sq_array;
+  /** @brief Position of the next completion to be consumed. */
+  uint32_t* cq_head;
+  /** @brief Position one past the last completion posted by the kernel. */
+  uint32_t* cq_tail;
+  /** @brief Mask that gives the index of the completion at a position. */
+  uint32_t cq_mask;
+  /** @brief The completion queue entries. */
+  struct io_uring_cqe* cqes;
+  /** @brief The ring through which free receive buffers are handed to the kernel. */
+  struct io_uring_buf_ring* buffer_ring;
+  /** @brief Number of buffers handed to the kernel so far. */
+  uint16_t buffer_ring_tail;
+  /** @brief Storage of the LF_URING_BUFFER_COUNT receive buffers, one after the other. */
+  unsigned char* buffers;
+  /** @brief The buffer from which bytes are being read, or -1 if none. */
+  int current;
+  /** @brief Position of the first unread byte of the current buffer. */
+  size_t start;
+  /** @brief Position one past the last byte of the current buffer. */
+  size_t end;
+  /** @brief Whether the multishot receive request is in the kernel. */
+  bool receiving;
+  /** @brief Whether any bytes have been received, after which the multishot receive is known to be supported. */
+  bool received;
+} uring_priv_t;
+
+#endif /* LF_URING_SUPPORT_H */
@@ -22,6 +22,12 @@
 #ifdef COMM_TYPE_TLS
 #include "lf_tls_support.h"
 #endif
+#ifdef COMM_TYPE_SHM
+#include "lf_shm_support.h"
+#endif
+#ifdef COMM_TYPE_URING
+#include "lf_uring_support.h"
+#endif
 
 /**
  * @brief Pointer to whatever data structure is used to maintain the state of a network connection or service.
@@ -107,6 +113,12 @@ net_abstraction_t connect_to_net(net_params_t params);
  * If the read succeeds in reading the specified number of bytes, return 0.
  * If an EOF occurs before reading the specified number of bytes, return 1.
  *
+ * Reads are buffered per connection: a read that cannot be served from bytes already received
+ * receives as many bytes as are available, up to @ref NET_RECEIVE_BUFFER_SIZE, so that reading the
+ * type, header and payload of a message, and of the messages that follow it, usually costs a single
+ * system call. Hence, only one thread at a time may read from a network abstraction, and bytes
+ * read through any other means, such as the underlying socket, may not be interleaved with these.
+ *
  * @param net_abs The network abstraction.
  * @param num_bytes The number of bytes to read.
  * @param buffer The buffer into which to put the bytes.
@@ -175,6 +187,36 @@ int write_to_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buf
  */
 int write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer);
 
+/**
+ * @brief Write the contents of several buffers, in order, to a network abstraction.
+ * @ingroup Network
+ *
+ * This is equivalent to calling write_to_net on each buffer in turn, but lets the implementation
+ * send the buffers together, for example a message header and its payload.
+ * The socket implementation uses a single writev() call, and the TLS implementation encrypts
+ * buffers that together fit in one TLS record into a single record.
+ * Writes to a network abstraction from different threads must be serialized by the caller.
+ *
+ * @param net_abs The network abstraction.
+ * @param vectors The buffers from which to get the bytes.
+ * @param count The number of buffers.
+ * @return 0 for success, -1 for failure.
+ */
+int write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count);
+
+/**
+ * @brief Write several buffers to a network abstraction and close on error.
+ * @ingroup Network
+ *
+ * Uses write_to_net_v and closes the channel if an error occurs.
+ *
+ * @param net_abs The network abstraction.
+ * @param vectors The buffers from which to get the bytes.
+ * @param count The number of buffers.
+ * @return 0 for success, -1 for failure.
+ */
+int write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count);
+
 /**
  * @brief Write bytes to a network abstraction and fail (exit) on error.
  * @ingroup Network
@@ -209,6 +251,45 @@ void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
  */
 bool is_net_open(net_abstraction_t net_abs);
 
+/**
+ * @brief Check whether bytes received on a network connection are waiting to be read.
+ * @ingroup Network
+ *
+ * Reads are buffered, so a connection may have messages to be read even though its descriptor
+ * is not readable. A thread that waits for the descriptor to become readable before reading,
+ * such as an epoll event loop, has to keep reading while this returns true.
+ *
+ * @param net_abs Network abstraction.
+ * @return true if reading at least one byte does not have to wait for the network.
+ */
+bool has_buffered_input(net_abstraction_t net_abs);
+
+/**
+ * @brief Get the number of bytes that can be read from a network connection without blocking.
+ * @ingroup Network
+ *
+ * The result may be smaller than the number of bytes that have arrived, for example if some of them
+ * are still encrypted, but reading no more than this never has to wait for the network. A thread
+ * that must not block on a slow peer, such as an epoll event loop, can use this to decide whether to
+ * read a large payload itself.
+ *
+ * @param net_abs Network abstraction.
+ * @return The number of bytes.
+ */
+size_t get_available_input(net_abstraction_t net_abs);
+
+/**
+ * @brief Get the descriptor of the underlying connection of a network abstraction.
+ * @ingroup Network
+ *
+ * The descriptor becomes readable when bytes arrive on the connection, so it can be waited on with
+ * poll() or epoll. It must not be read from directly; use read_from_net().
+ *
+ * @param net_abs Network abstraction.
+ * @return The descriptor, or -1 if the connection is closed.
+ */
+int get_net_descriptor(net_abstraction_t net_abs);
+
 /**
  * @brief Close the underlying connection of a network abstraction without freeing its memory.
  * @ingroup Network
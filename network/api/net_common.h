@@ -41,6 +41,9 @@
  * When the federation IDs match, the RTI will respond with an
  * MSG_TYPE_ACK.
  *
+ * A federate that uses a control lane for its tag coordination messages opens it the same way
+ * just before, with a @ref MSG_TYPE_CONTROL_LANE message in place of the @ref MSG_TYPE_FED_IDS message.
+ *
  * ### Conveying the neighbor structure
  *
  * The next message to the RTI will be a @ref MSG_TYPE_NEIGHBOR_STRUCTURE message
@@ -736,6 +739,160 @@
  */
 #define MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG 26
 
+/**
+ * @brief Byte identifying a batch of tagged messages and port absent messages with the same tag
+ * sent directly to another federate.
+ * @ingroup Network
+ *
+ * A federate compiled with `FEDERATED_P2P_BATCH_SIZE` defined sends the @ref MSG_TYPE_P2P_TAGGED_MESSAGE
+ * and @ref MSG_TYPE_PORT_ABSENT messages it produces for one federate at one tag in batches of this type,
+ * which it sends when it completes the tag or when the batch exceeds the specified number of bytes.
+ *
+ * The next two bytes are the destination federate ID.
+ * The next four bytes are the length of the entries that follow the header.
+ * The next eight bytes will be the timestamp shared by all entries.
+ * The next four bytes will be the microstep shared by all entries.
+ * Each entry then starts with one byte, which is MSG_TYPE_P2P_TAGGED_MESSAGE or MSG_TYPE_PORT_ABSENT,
+ * followed by the two-byte ID of the destination port. For a tagged message, these are followed
+ * by the four-byte length of the message and the message.
+ */
+#define MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH 27
+
+/**
+ * @brief The size of the header of a batch of messages, including the message type.
+ * @ingroup Network
+ */
+#define MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE 19
+
+/**
+ * @brief Byte identifying a next message request (NMR) sent by a federate to the RTI in
+ * centralized coordination.
+ * @ingroup Network
+ *
+ * This combines a @ref MSG_TYPE_LATEST_TAG_CONFIRMED message with the @ref MSG_TYPE_NEXT_EVENT_TAG
+ * message that follows it, which is what a federate sends after completing a tag. The RTI handles
+ * both tags at once, so that it evaluates the resulting grants only once.
+ *
+ * A federate sends this message only to an RTI that has accepted its @ref MSG_TYPE_FED_IDS_NMR
+ * message. Otherwise, it sends the two messages separately.
+ *
+ * The next eight bytes will be the timestep of the completed tag.
+ * The next four bytes will be the microsteps of the completed tag.
+ * The next eight bytes will be the timestep of the next event tag.
+ * The next four bytes will be the microsteps of the next event tag.
+ */
+#define MSG_TYPE_NEXT_MESSAGE_REQUEST 28
+
+/**
+ * @brief The size of a next message request, including the message type.
+ * @ingroup Network
+ */
+#define MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH (1 + 2 * (sizeof(instant_t) + sizeof(microstep_t)))
+
+/**
+ * @brief Byte identifying a @ref MSG_TYPE_FED_IDS message from a federate that sends
+ * @ref MSG_TYPE_NEXT_MESSAGE_REQUEST messages.
+ * @ingroup Network
+ *
+ * A federate under centralized coordination sends this message, which has the same payload as a
+ * @ref MSG_TYPE_FED_IDS message, in place of its first @ref MSG_TYPE_FED_IDS message. An RTI that
+ * handles next message requests replies as to a @ref MSG_TYPE_FED_IDS message. An RTI that
+ * predates them rejects the message with UNEXPECTED_MESSAGE and closes the connection, in which
+ * case the federate connects again, sends a @ref MSG_TYPE_FED_IDS message, and then sends its
+ * @ref MSG_TYPE_LATEST_TAG_CONFIRMED and @ref MSG_TYPE_NEXT_EVENT_TAG messages separately.
+ */
+#define MSG_TYPE_FED_IDS_NMR 31
+
+/**
+ * @brief Byte identifying the first message on a control lane, a second connection from a federate
+ * to the RTI that carries only tag coordination messages under centralized coordination.
+ * @ingroup Network
+ *
+ * On the connection to the RTI, a large tagged message queued ahead of a tag advance grant holds up
+ * the grant until it has been written. A federate compiled with `FEDERATED_CONTROL_LANE` defined
+ * therefore opens a control lane before it connects to the RTI as usual. After the HMAC
+ * authentication, if any, it sends this message, which has the same payload as a
+ * @ref MSG_TYPE_FED_IDS message. The RTI replies with @ref MSG_TYPE_ACK or @ref MSG_TYPE_REJECT.
+ * An RTI that does not support control lanes rejects the message with UNEXPECTED_MESSAGE, in which
+ * case the federate closes the connection and uses a single connection to the RTI.
+ *
+ * Once accepted, the federate sends its @ref MSG_TYPE_NEXT_EVENT_TAG, @ref MSG_TYPE_LATEST_TAG_CONFIRMED,
+ * and @ref MSG_TYPE_NEXT_MESSAGE_REQUEST messages on the control lane, and the RTI sends its
+ * @ref MSG_TYPE_TAG_ADVANCE_GRANT, @ref MSG_TYPE_PROVISIONAL_TAG_ADVANCE_GRANT, and
+ * @ref MSG_TYPE_DOWNSTREAM_NEXT_EVENT_TAG messages there. All other messages stay on the first
+ * connection.
+ *
+ * A control message must not overtake the tagged messages, port absent messages, and stop messages
+ * (stop requests, replies, and grants) on the first connection that it depends on, called fenced
+ * messages here. Each control message other than a DNET is therefore followed by an eight-byte data fence:
+ *  - After a message from the federate, the fence is the number of fenced messages that the federate
+ *    had sent to the RTI before the message. The RTI defers the message until it has handled as many
+ *    fenced messages from the federate.
+ *  - After a TAG or PTAG from the RTI, the fence is the number of fenced messages that the RTI had
+ *    sent to the federate before the grant and that are stop messages or carry a tag no later than
+ *    the greatest tag granted so far. The federate defers the grant until it has received as many
+ *    such messages, so the grant waits only for the messages at tags that it allows the federate to process.
+ */
+#define MSG_TYPE_CONTROL_LANE 29
+
+/**
+ * @brief The size of the data fence that follows a message on a control lane.
+ * @ingroup Network
+ */
+#define CONTROL_LANE_FENCE_LENGTH sizeof(int64_t)
+
+/**
+ * @brief Byte identifying the negotiation of the compression of tagged message payloads.
+ * @ingroup Network
+ *
+ * A federate compiled with `FEDERATED_COMPRESSION` defined compresses the payloads of large tagged
+ * messages to federates that can decompress them with the same codec. It learns which federates these are as follows:
+ *  - Under centralized coordination, it sends this message to the RTI just before its
+ *    @ref MSG_TYPE_TIMESTAMP message. The next byte is its codec (e.g., @ref COMPRESSION_CODEC_LZ4).
+ *    Right after the start time, the RTI sends this message back to each federate that sent it. The next
+ *    two bytes are a count, followed by, for each federate that announced a codec, its two-byte ID and its codec.
+ *    The RTI forwards compressed payloads without looking at them.
+ *  - Under decentralized coordination, after a federate has been accepted by a federate to which it sends
+ *    messages (@see MSG_TYPE_P2P_SENDING_FED_ID), it sends this message with its codec in the next byte.
+ *    The receiving federate replies with this message carrying the same codec if it has it and
+ *    @ref COMPRESSION_CODEC_NONE otherwise.
+ *
+ * A compressed payload is marked with @ref COMPRESSED_PAYLOAD_PORT_FLAG in the port ID of the tagged message.
+ * Its first four bytes are the length of the uncompressed payload, and the rest is the output of the codec.
+ * The length in the header of the message is that of the compressed payload including these four bytes.
+ */
+#define MSG_TYPE_COMPRESSION 30
+
+/**
+ * @brief Codec of a federate that does not compress payloads.
+ * @ingroup Network
+ */
+#define COMPRESSION_CODEC_NONE 0
+
+/**
+ * @brief Codec of a federate that compresses payloads with LZ4.
+ * @ingroup Network
+ */
+#define COMPRESSION_CODEC_LZ4 1
+
+/**
+ * @brief Codec of a federate that compresses payloads with Zstandard at level 1.
+ * @ingroup Network
+ */
+#define COMPRESSION_CODEC_ZSTD 2
+
+/**
+ * @brief Codec of a federate that compresses payloads with zlib at level 1.
+ * @ingroup Network
+ */
+#define COMPRESSION_CODEC_ZLIB 3
+
+/**
+ * @brief Bit set in the port ID of a tagged message whose payload is compressed (@see MSG_TYPE_COMPRESSION).
+ * @ingroup Network
+ */
+#define COMPRESSED_PAYLOAD_PORT_FLAG 0x8000u
+
 /////////////////////////////////////////////
 //// Rejection codes
 
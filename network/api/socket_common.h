@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <sys/time.h>
+#include <sys/uio.h> // struct iovec
 
 /**
  * @brief The number of federates.
@@ -32,14 +33,6 @@
 #define NUMBER_OF_FEDERATES 1
 #endif
 
-/**
- * @brief The amount of time to wait after a failed socket read or write before trying again.
- * @ingroup Network
- *
- * This defaults to 100 ms.
- */
-#define DELAY_BETWEEN_SOCKET_RETRIES MSEC(100)
-
 /**
  * @brief The timeout time in ns for TCP operations.
  * @ingroup Network
@@ -112,18 +105,69 @@
  */
 #define DEFAULT_UDP_PORT 15061u
 
+/**
+ * @brief Format of the abstract address of the server listening on a port with the UDS communication type.
+ * @ingroup Network
+ *
+ * With the UDS communication type, connections use Unix domain sockets in the abstract namespace
+ * of Linux, and port numbers only serve to name the servers.
+ */
+#define UDS_ADDRESS_FORMAT "lf-%u"
+
+/**
+ * @brief First port number that the UDS communication type assigns when a server asks for port 0.
+ * @ingroup Network
+ */
+#define UDS_FIRST_AUTOMATIC_PORT 49152u
+
 /**
  * @brief Byte identifying that the federate or the RTI has failed.
  * @ingroup Network
  */
 #define MSG_TYPE_FAILED 25
 
+/**
+ * @brief Size of the buffer from which reads from a network abstraction are served.
+ * @ingroup Network
+ *
+ * Reads of fewer bytes than this are served from a per-connection buffer that is refilled
+ * with a single read of up to this many bytes, so that the type, header and payload of a
+ * small message, and usually several messages, cost one system call. Larger reads bypass
+ * the buffer.
+ */
+#define NET_RECEIVE_BUFFER_SIZE 16384u
+
 /**
  * @brief Type of socket.
  * @ingroup Network
  */
 typedef enum socket_type_t { TCP, UDP } socket_type_t;
 
+/**
+ * @brief Bytes received on a connection that have not yet been consumed.
+ * @ingroup Network
+ *
+ * The bytes at positions `start` up to `end` of `data` are unread. The buffer is only
+ * refilled once it is empty, so both positions are reset to 0 at that time.
+ */
+typedef struct net_receive_buffer_t {
+  /** @brief Storage of NET_RECEIVE_BUFFER_SIZE bytes, allocated on first use. */
+  unsigned char* data;
+  /** @brief Position of the first unread byte. */
+  size_t start;
+  /** @brief Position one past the last unread byte. */
+  size_t end;
+} net_receive_buffer_t;
+
+/**
+ * @brief Function that receives at least one and at most `max_bytes` bytes from a connection.
+ * @ingroup Network
+ *
+ * It should block until at least one byte is available and return the number of bytes received,
+ * 0 on EOF, or a negative number on error.
+ */
+typedef ssize_t (*net_receive_function_t)(void* connection, unsigned char* buffer, size_t max_bytes);
+
 typedef struct socket_connection_params_t {
   /** @brief Socket type (TCP or UDP). */
   socket_type_t type;
@@ -159,6 +203,8 @@ typedef struct socket_priv_t {
   struct in_addr server_ip_addr;
   /** @brief The UDP address for the federate. */
   struct sockaddr_in UDP_addr;
+  /** @brief Bytes received on the TCP connection but not yet read. */
+  net_receive_buffer_t receive_buffer;
 } socket_priv_t;
 
 /**
@@ -232,6 +278,47 @@ int accept_socket(int socket);
  */
 int connect_to_socket(int sock, const char* hostname, const struct in_addr* ip_addr, int port);
 
+/**
+ * @brief Create a server listening for Unix domain socket connections on the specified port.
+ * @ingroup Network
+ *
+ * The server is bound to the abstract address given by UDS_ADDRESS_FORMAT for the port. If the port
+ * number is zero, the first port from UDS_FIRST_AUTOMATIC_PORT on, in an order that depends on the
+ * process, that no other server uses is taken.
+ *
+ * @param port The port number to use or 0 to pick one.
+ * @param final_socket Pointer to the returned socket descriptor on which accepting connections will occur.
+ * @param final_port Pointer to the final port the server will use.
+ * @return 0 for success, -1 for failure.
+ */
+int create_unix_socket_server(uint16_t port, int* final_socket, uint16_t* final_port);
+
+/**
+ * @brief Connect a Unix domain socket to the server listening on the specified port of this host.
+ * @ingroup Network
+ *
+ * Like @ref connect_to_socket, this retries every CONNECT_RETRY_INTERVAL until CONNECT_TIMEOUT expires.
+ *
+ * @param sock The socket file descriptor, created with the AF_UNIX domain.
+ * @param port The port number to connect to. If 0 is specified, DEFAULT_PORT is used.
+ * @return 0 on success, -1 on failure, and `errno` is set to indicate the specific error.
+ */
+int connect_to_unix_socket(int sock, int port);
+
+/**
+ * @brief Block until the specified socket is ready for the specified poll() events.
+ * @ingroup Network
+ *
+ * This also returns when an error or a hang-up is pending on the socket, so that the
+ * operation that is retried next reports it. It is what the read and write functions
+ * do when the socket reports EAGAIN or EWOULDBLOCK, instead of sleeping.
+ *
+ * @param socket The socket ID.
+ * @param events POLLIN to wait for bytes to read, POLLOUT to wait for room to write.
+ * @return 0 when the operation should be attempted again, -1 if polling failed.
+ */
+int wait_for_socket(int socket, short events);
+
 /**
  * @brief Read the specified number of bytes from the specified socket into the specified buffer.
  * @ingroup Network
@@ -242,7 +329,7 @@ int connect_to_socket(int sock, const char* hostname, const struct in_addr* ip_a
  * This function repeats the read attempt until the specified number of bytes
  * have been read, an EOF is read, or an error occurs. Specifically, errors EAGAIN,
  * EWOULDBLOCK, and EINTR are not considered errors and instead trigger
- * another attempt. A delay between attempts is given by DELAY_BETWEEN_SOCKET_RETRIES.
+ * another attempt once the socket is readable, as reported by @ref wait_for_socket.
  * @param socket The socket ID.
  * @param num_bytes The number of bytes to read.
  * @param buffer The buffer into which to put the bytes.
@@ -282,6 +369,55 @@ int read_from_socket_close_on_error(int* socket, size_t num_bytes, unsigned char
  */
 void read_from_socket_fail_on_error(int* socket, size_t num_bytes, unsigned char* buffer, char* format, ...);
 
+/**
+ * @brief Receive at least one and at most the specified number of bytes from the specified socket.
+ * @ingroup Network
+ *
+ * This blocks until some bytes are available and, unlike @ref read_from_socket, returns as soon
+ * as a single read succeeds. Errors EAGAIN, EWOULDBLOCK and EINTR trigger another attempt.
+ * @param socket The socket ID.
+ * @param buffer The buffer into which to put the bytes.
+ * @param max_bytes The maximum number of bytes to receive.
+ * @return The number of bytes received, 0 for EOF, and -1 for an error.
+ */
+ssize_t receive_from_socket(int socket, unsigned char* buffer, size_t max_bytes);
+
+/**
+ * @brief Read a fixed number of bytes from a connection through its receive buffer.
+ * @ingroup Network
+ *
+ * Bytes already in the buffer are consumed first. If more are needed, the buffer is refilled
+ * with as many bytes as one call to `receive` provides, unless the bytes still needed do not
+ * fit in the buffer, in which case they are received directly into the destination.
+ * Only one thread at a time may read from a connection.
+ * @param receive_buffer The receive buffer of the connection.
+ * @param num_bytes The number of bytes to read.
+ * @param buffer The buffer into which to put the bytes.
+ * @param receive The function that receives bytes from the connection.
+ * @param connection The argument to pass to `receive`.
+ * @return 0 for success, 1 for EOF, and -1 for an error.
+ */
+int read_from_receive_buffer(net_receive_buffer_t* receive_buffer, size_t num_bytes, unsigned char* buffer,
+                             net_receive_function_t receive, void* connection);
+
+/**
+ * @brief Get the number of bytes that can be read from a TCP connection without blocking.
+ * @ingroup Network
+ *
+ * These are the bytes in its receive buffer and those that the socket has received.
+ * @param priv The socket connection.
+ * @return The number of bytes.
+ */
+size_t get_available_socket_input(socket_priv_t* priv);
+
+/**
+ * @brief Free the storage of a receive buffer, discarding any unread bytes.
+ * @ingroup Network
+ *
+ * @param receive_buffer The receive buffer.
+ */
+void free_receive_buffer(net_receive_buffer_t* receive_buffer);
+
 /**
  * @brief Without blocking, peek at the specified socket.
  * @ingroup Network
@@ -324,8 +460,7 @@ int get_peer_address(socket_priv_t* priv);
  * This function repeats the attempt until the specified number of bytes
  * have been written or an error occurs. Specifically, errors EAGAIN,
  * EWOULDBLOCK, and EINTR are not considered errors and instead trigger
- * another attempt. A delay between attempts is given by
- * DELAY_BETWEEN_SOCKET_RETRIES.
+ * another attempt once the socket is writable, as reported by @ref wait_for_socket.
  * @param socket The socket ID.
  * @param num_bytes The number of bytes to write.
  * @param buffer The buffer from which to get the bytes.
@@ -333,6 +468,19 @@ int get_peer_address(socket_priv_t* priv);
  */
 int write_to_socket(int socket, size_t num_bytes, unsigned char* buffer);
 
+/**
+ * @brief Write the contents of the specified buffers, in order, to the specified socket.
+ * @ingroup Network
+ *
+ * This behaves like @ref write_to_socket applied to each buffer in turn, but uses writev(),
+ * so that all the buffers usually go out in one system call and one packet.
+ * @param socket The socket ID.
+ * @param vectors The buffers from which to get the bytes.
+ * @param count The number of buffers.
+ * @return 0 for success, -1 for failure.
+ */
+int write_to_socket_v(int socket, const struct iovec* vectors, int count);
+
 /**
  * @brief Write the specified number of bytes to the specified socket.
  * @ingroup Network
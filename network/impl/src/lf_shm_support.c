@@ -0,0 +1,596 @@
+/**
+ * @file
+ * @brief Implementation of the network abstraction over shared memory for co-located federates.
+ *
+ * See lf_shm_support.h. Connections are made over TCP, and the accepting side then offers a
+ * shared-memory segment. Until the offer has been accepted, and for good if it is declined,
+ * the socket implementation's functions are used on the TCP connection.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "net_abstraction.h"
+#include "lf_shm_support.h"
+#include "util.h"
+#include "logging.h"
+
+#if (LF_SHM_RING_SIZE & (LF_SHM_RING_SIZE - 1)) != 0
+#error "LF_SHM_RING_SIZE must be a power of two."
+#endif
+
+/** Number of times a side checks a ring again before sleeping on it. */
+#define LF_SHM_SPIN_COUNT 64
+
+/** Reply of the connecting side to an offer of a segment. */
+#define LF_SHM_ACCEPTED 1u
+#define LF_SHM_DECLINED 0u
+
+/** Number of segments created by this process, used to give each a unique name. */
+static uint32_t segments_created = 0;
+
+// PRIVATE HELPERS ***********************************************************
+
+static void futex_wait(uint32_t* word, uint32_t expected, interval_t timeout) {
+  struct timespec duration = {.tv_sec = (time_t)(timeout / BILLION), .tv_nsec = (long)(timeout % BILLION)};
+  // The segment is shared between processes, so the futex must not be private.
+  syscall(SYS_futex, word, FUTEX_WAIT, expected, &duration, NULL, 0);
+}
+
+static void futex_wake(uint32_t* word) { syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0); }
+
+/** Wake the side sleeping on a futex of a ring, if it is sleeping. The caller has just changed the ring. */
+static void wake_if_sleeping(uint32_t* sleeping, uint32_t* futex) {
+  // Pairs with the fence in wait_on_ring(), so that either this side sees the flag or the other
+  // side sees the change.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(sleeping, __ATOMIC_RELAXED) && __atomic_exchange_n(sleeping, 0u, __ATOMIC_SEQ_CST)) {
+    __atomic_add_fetch(futex, 1u, __ATOMIC_SEQ_CST);
+    futex_wake(futex);
+  }
+}
+
+/** Return whether the other side of a connection still exists, which the TCP connection tells. */
+static bool peer_alive(shm_priv_t* priv) {
+  int socket = priv->socket_priv->socket_descriptor;
+  if (socket < 0) {
+    return false;
+  }
+  unsigned char byte;
+  ssize_t bytes = recv(socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return bytes > 0 || (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+}
+
+/**
+ * Wait for a position of a ring to move on from the given value, or for the ring to be closed.
+ * @param priv The connection.
+ * @param ring The ring.
+ * @param futex The futex on which to sleep.
+ * @param sleeping The flag telling the other side to wake this one.
+ * @param position The position that the other side moves.
+ * @param seen The value of the position that this side has seen.
+ * @return 0 when it is worth looking at the ring again, -1 if the other side no longer exists.
+ */
+static int wait_on_ring(shm_priv_t* priv, shm_ring_t* ring, uint32_t* futex, uint32_t* sleeping,
+                        const uint64_t* position, uint64_t seen) {
+  for (int i = 0; i < LF_SHM_SPIN_COUNT; i++) {
+    if (__atomic_load_n(position, __ATOMIC_ACQUIRE) != seen || __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+      return 0;
+    }
+  }
+  uint32_t value = __atomic_load_n(futex, __ATOMIC_ACQUIRE);
+  __atomic_store_n(sleeping, 1u, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(position, __ATOMIC_ACQUIRE) == seen && !__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+    futex_wait(futex, value, LF_SHM_LIVENESS_INTERVAL);
+  }
+  __atomic_store_n(sleeping, 0u, __ATOMIC_RELAXED);
+  if (__atomic_load_n(position, __ATOMIC_ACQUIRE) == seen && __atomic_load_n(futex, __ATOMIC_ACQUIRE) == value &&
+      !peer_alive(priv)) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Read bytes from the ring of a connection, waiting for them as needed.
+ * @return 0 for success, 1 for EOF, and -1 for an error.
+ */
+static int read_from_ring(shm_priv_t* priv, size_t num_bytes, unsigned char* buffer) {
+  shm_ring_t* ring = priv->in;
+  uint64_t head = ring->head;
+  while (num_bytes > 0) {
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (tail == head) {
+      if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+        // The writer publishes its last bytes before closing the ring.
+        if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head) {
+          return 1;
+        }
+        continue;
+      }
+      if (wait_on_ring(priv, ring, &ring->data_futex, &ring->reader_sleeping, &ring->tail, tail)) {
+        errno = ECONNRESET;
+        return -1;
+      }
+      continue;
+    }
+    size_t count = (size_t)(tail - head) < num_bytes ? (size_t)(tail - head) : num_bytes;
+    size_t offset = (size_t)(head & (LF_SHM_RING_SIZE - 1));
+    size_t first = LF_SHM_RING_SIZE - offset < count ? LF_SHM_RING_SIZE - offset : count;
+    memcpy(buffer, &ring->data[offset], first);
+    memcpy(buffer + first, ring->data, count - first);
+    buffer += count;
+    num_bytes -= count;
+    head += count;
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    wake_if_sleeping(&ring->writer_sleeping, &ring->space_futex);
+  }
+  return 0;
+}
+
+/** Make the bytes written to a ring up to the given position visible to the reader. */
+static void publish(shm_ring_t* ring, uint64_t tail) {
+  __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  wake_if_sleeping(&ring->reader_sleeping, &ring->data_futex);
+}
+
+/**
+ * Write the contents of several buffers to the ring of a connection, waiting for room as needed.
+ * The bytes are published, and the reader woken, once at the end unless the ring fills up first.
+ * The caller holds the write mutex.
+ * @return 0 for success, -1 for failure.
+ */
+static int write_to_ring(shm_priv_t* priv, const struct iovec* vectors, int count) {
+  shm_ring_t* ring = priv->out;
+  uint64_t tail = ring->tail;
+  for (int i = 0; i < count; i++) {
+    const unsigned char* bytes = (const unsigned char*)vectors[i].iov_base;
+    size_t remaining = vectors[i].iov_len;
+    while (remaining > 0) {
+      if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+        errno = EPIPE;
+        return -1;
+      }
+      uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+      size_t space = LF_SHM_RING_SIZE - (size_t)(tail - head);
+      if (space == 0) {
+        // Let the reader make room.
+        publish(ring, tail);
+        if (wait_on_ring(priv, ring, &ring->space_futex, &ring->writer_sleeping, &ring->head, head)) {
+          errno = EPIPE;
+          return -1;
+        }
+        continue;
+      }
+      size_t length = space < remaining ? space : remaining;
+      size_t offset = (size_t)(tail & (LF_SHM_RING_SIZE - 1));
+      size_t first = LF_SHM_RING_SIZE - offset < length ? LF_SHM_RING_SIZE - offset : length;
+      memcpy(&ring->data[offset], bytes, first);
+      memcpy(ring->data, bytes + first, length - first);
+      bytes += length;
+      remaining -= length;
+      tail += length;
+    }
+  }
+  publish(ring, tail);
+  return 0;
+}
+
+/** Close a ring, after which its writer fails and its reader gets EOF, and wake both sides. */
+static void close_ring(shm_ring_t* ring) {
+  __atomic_store_n(&ring->closed, 1u, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&ring->data_futex, 1u, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&ring->space_futex, 1u, __ATOMIC_SEQ_CST);
+  futex_wake(&ring->data_futex);
+  futex_wake(&ring->space_futex);
+}
+
+/**
+ * On the accepting side of a new connection, offer the connecting side a shared-memory segment,
+ * and map it if the connecting side accepts.
+ * @return 0 if the connection is usable, whether or not it uses the segment, -1 on a socket error.
+ */
+static int offer_segment(shm_priv_t* priv) {
+  int socket = priv->socket_priv->socket_descriptor;
+  char name[LF_SHM_NAME_LENGTH];
+  snprintf(name, sizeof(name), "/lf-net-%d-%u", (int)getpid(),
+           __atomic_fetch_add(&segments_created, 1u, __ATOMIC_RELAXED));
+  shm_segment_t* segment = NULL;
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd >= 0) {
+    if (ftruncate(fd, (off_t)sizeof(shm_segment_t)) == 0) {
+      void* memory = mmap(NULL, sizeof(shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      segment = memory == MAP_FAILED ? NULL : (shm_segment_t*)memory;
+    }
+    // The mapping remains valid after the file descriptor is closed.
+    close(fd);
+  }
+  if (segment != NULL && getrandom(&segment->nonce, sizeof(segment->nonce), 0) != (ssize_t)sizeof(segment->nonce)) {
+    segment->nonce = (uint64_t)lf_time_physical() ^ ((uint64_t)getpid() << 32);
+  }
+  if (segment == NULL) {
+    LF_PRINT_LOG("Failed to create shared-memory segment %s: %s. Using TCP.", name, strerror(errno));
+  }
+
+  // The offer is the length of the name, the name, and the nonce. A length of zero offers nothing.
+  unsigned char offer[1 + LF_SHM_NAME_LENGTH + sizeof(uint64_t)];
+  size_t name_length = segment == NULL ? 0 : strlen(name);
+  offer[0] = (unsigned char)name_length;
+  memcpy(&offer[1], name, name_length);
+  if (segment != NULL) {
+    memcpy(&offer[1 + name_length], &segment->nonce, sizeof(uint64_t));
+  }
+  unsigned char reply = LF_SHM_DECLINED;
+  int result = write_to_socket(socket, 1 + name_length + (segment == NULL ? 0 : sizeof(uint64_t)), offer);
+  if (result == 0) {
+    result = read_from_socket(socket, 1, &reply) == 0 ? 0 : -1;
+  }
+  if (segment != NULL) {
+    // Both sides have the segment mapped, or will not map it, so its name is no longer needed.
+    shm_unlink(name);
+    if (reply != LF_SHM_ACCEPTED) {
+      munmap(segment, sizeof(shm_segment_t));
+      segment = NULL;
+    }
+  }
+  if (segment != NULL) {
+    priv->segment = segment;
+    priv->in = &segment->to_server;
+    priv->out = &segment->to_client;
+    LF_PRINT_LOG("Connection uses shared-memory segment %s.", name);
+  }
+  return result;
+}
+
+/**
+ * On the connecting side of a new connection, map the shared-memory segment offered by the
+ * accepting side if it exists on this host, and reply whether it does.
+ * @return 0 if the connection is usable, whether or not it uses the segment, -1 on a socket error.
+ */
+static int accept_segment(shm_priv_t* priv) {
+  int socket = priv->socket_priv->socket_descriptor;
+  unsigned char name_length;
+  if (read_from_socket(socket, 1, &name_length) != 0 || name_length >= LF_SHM_NAME_LENGTH) {
+    return -1;
+  }
+  if (name_length == 0) {
+    return 0;
+  }
+  char name[LF_SHM_NAME_LENGTH];
+  uint64_t nonce;
+  if (read_from_socket(socket, name_length, (unsigned char*)name) != 0 ||
+      read_from_socket(socket, sizeof(nonce), (unsigned char*)&nonce) != 0) {
+    return -1;
+  }
+  name[name_length] = '\0';
+  shm_segment_t* segment = NULL;
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd >= 0) {
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size == (off_t)sizeof(shm_segment_t)) {
+      void* memory = mmap(NULL, sizeof(shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      segment = memory == MAP_FAILED ? NULL : (shm_segment_t*)memory;
+    }
+    close(fd);
+  }
+  if (segment != NULL && segment->nonce != nonce) {
+    // A segment of the same name on this host, so the accepting side is on another host.
+    munmap(segment, sizeof(shm_segment_t));
+    segment = NULL;
+  }
+  unsigned char reply = segment == NULL ? LF_SHM_DECLINED : LF_SHM_ACCEPTED;
+  if (write_to_socket(socket, 1, &reply) != 0) {
+    if (segment != NULL) {
+      munmap(segment, sizeof(shm_segment_t));
+    }
+    return -1;
+  }
+  if (segment != NULL) {
+    priv->segment = segment;
+    priv->in = &segment->to_client;
+    priv->out = &segment->to_server;
+    LF_PRINT_LOG("Connection uses shared-memory segment %s.", name);
+  } else {
+    LF_PRINT_LOG("Shared-memory segment %s is not available. Using TCP.", name);
+  }
+  return 0;
+}
+
+// IMPLEMENTATION OF NETWORK ABSTRACTION API *********************************
+
+net_abstraction_t initialize_net() {
+  shm_priv_t* priv = (shm_priv_t*)malloc(sizeof(shm_priv_t));
+  if (priv == NULL) {
+    lf_print_error_and_exit("Failed to allocate memory for shm_priv_t.");
+  }
+  priv->socket_priv = (socket_priv_t*)malloc(sizeof(socket_priv_t));
+  if (priv->socket_priv == NULL) {
+    lf_print_error_and_exit("Failed to allocate memory for socket_priv_t.");
+  }
+  lf_initialize_socket_priv(priv->socket_priv);
+  priv->segment = NULL;
+  priv->in = NULL;
+  priv->out = NULL;
+  LF_MUTEX_INIT(&priv->write_mutex);
+  return (net_abstraction_t)priv;
+}
+
+void free_net(net_abstraction_t net_abs) {
+  if (net_abs == NULL) {
+    LF_PRINT_LOG("Network abstraction already freed.");
+    return;
+  }
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment != NULL) {
+    munmap(priv->segment, sizeof(shm_segment_t));
+  }
+  free_receive_buffer(&priv->socket_priv->receive_buffer);
+  free(priv->socket_priv);
+  free(priv);
+}
+
+int create_server(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  return create_socket_server(priv->socket_priv->user_specified_port, &priv->socket_priv->socket_descriptor,
+                              &priv->socket_priv->port, TCP);
+}
+
+net_abstraction_t accept_net(net_abstraction_t server_chan) {
+  LF_ASSERT_NON_NULL(server_chan);
+  shm_priv_t* server_priv = (shm_priv_t*)server_chan;
+  int sock = accept_socket(server_priv->socket_priv->socket_descriptor);
+  if (sock < 0) {
+    return NULL;
+  }
+  net_abstraction_t client_net = initialize_net();
+  shm_priv_t* client_priv = (shm_priv_t*)client_net;
+  client_priv->socket_priv->socket_descriptor = sock;
+  // Get the peer address from the connected socket_id. Saving this for the address query.
+  if (get_peer_address(client_priv->socket_priv) != 0) {
+    lf_print_error("Failed to save peer address.");
+  }
+  if (offer_segment(client_priv) != 0) {
+    lf_print_error("Failed to offer a shared-memory segment to the peer.");
+    shutdown_net(client_net, false);
+    return NULL;
+  }
+  return client_net;
+}
+
+void create_client(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  priv->socket_priv->socket_descriptor = create_real_time_tcp_socket_errexit();
+}
+
+net_abstraction_t connect_to_net(net_params_t params) {
+  shm_connection_params_t* shm_params = (shm_connection_params_t*)params;
+  net_abstraction_t net = initialize_net();
+  shm_priv_t* priv = (shm_priv_t*)net;
+  priv->socket_priv->server_port = shm_params->socket_params.port;
+  create_client(net);
+  if (connect_to_socket(priv->socket_priv->socket_descriptor, shm_params->socket_params.server_hostname,
+                        shm_params->socket_params.server_ip_addr, priv->socket_priv->server_port) != 0) {
+    lf_print_error("Failed to connect to socket.");
+    free_net(net);
+    return NULL;
+  }
+  if (accept_segment(priv) != 0) {
+    lf_print_error("Failed to receive the shared-memory segment offered by the server.");
+    shutdown_net(net, false);
+    return NULL;
+  }
+  return net;
+}
+
+/** Receive function of the socket's receive buffer. */
+static ssize_t receive_from_priv(void* connection, unsigned char* buffer, size_t max_bytes) {
+  return receive_from_socket(((socket_priv_t*)connection)->socket_descriptor, buffer, max_bytes);
+}
+
+int read_from_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment != NULL) {
+    return read_from_ring(priv, num_bytes, buffer);
+  }
+  return read_from_receive_buffer(&priv->socket_priv->receive_buffer, num_bytes, buffer, receive_from_priv,
+                                  priv->socket_priv);
+}
+
+int read_from_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  int read_failed = read_from_net(net_abs, num_bytes, buffer);
+  if (read_failed) {
+    // The connection has probably been closed from the other side. Close it from this side.
+    close_net(net_abs, false);
+    return -1;
+  }
+  return 0;
+}
+
+void read_from_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, char* format,
+                                 ...) {
+  LF_ASSERT_NON_NULL(net_abs);
+  va_list args;
+  int read_failed = read_from_net_close_on_error(net_abs, num_bytes, buffer);
+  if (read_failed) {
+    if (format != NULL) {
+      va_start(args, format);
+      lf_print_error_system_failure(format, args);
+      va_end(args);
+    } else {
+      lf_print_error_system_failure("Failed to read from the network.");
+    }
+  }
+}
+
+int write_to_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  struct iovec vector = {.iov_base = buffer, .iov_len = num_bytes};
+  return write_to_net_v(net_abs, &vector, 1);
+}
+
+int write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  int result = write_to_net(net_abs, num_bytes, buffer);
+  if (result) {
+    // The connection has probably been closed from the other side. Close it from this side.
+    close_net(net_abs, false);
+  }
+  return result;
+}
+
+int write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment == NULL) {
+    return write_to_socket_v(priv->socket_priv->socket_descriptor, vectors, count);
+  }
+  LF_MUTEX_LOCK(&priv->write_mutex);
+  int result = write_to_ring(priv, vectors, count);
+  LF_MUTEX_UNLOCK(&priv->write_mutex);
+  return result;
+}
+
+int write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  int result = write_to_net_v(net_abs, vectors, count);
+  if (result) {
+    // The connection has probably been closed from the other side. Close it from this side.
+    close_net(net_abs, false);
+  }
+  return result;
+}
+
+void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, lf_mutex_t* mutex,
+                                char* format, ...) {
+  LF_ASSERT_NON_NULL(net_abs);
+  va_list args;
+  int result = write_to_net_close_on_error(net_abs, num_bytes, buffer);
+  if (result) {
+    if (mutex != NULL) {
+      LF_MUTEX_UNLOCK(mutex);
+    }
+    if (format != NULL) {
+      va_start(args, format);
+      lf_print_error_system_failure(format, args);
+      va_end(args);
+    } else {
+      lf_print_error_and_exit("Failed to write to the network. Shutting down.");
+    }
+  }
+}
+
+bool is_net_open(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment == NULL) {
+    net_receive_buffer_t* receive_buffer = &priv->socket_priv->receive_buffer;
+    if (priv->socket_priv->socket_descriptor >= 0 && receive_buffer->start < receive_buffer->end) {
+      // Bytes that have been received are still to be read, so the socket may be ahead of the reader.
+      return true;
+    }
+    return is_socket_open(priv->socket_priv->socket_descriptor);
+  }
+  shm_ring_t* ring = priv->in;
+  // This may be called by a thread other than the reader.
+  uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != head) {
+    // As for a socket, a peer that has reported its failure is no longer considered open.
+    return ring->data[head & (LF_SHM_RING_SIZE - 1)] != MSG_TYPE_FAILED;
+  }
+  return !__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) && peer_alive(priv);
+}
+
+bool has_buffered_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment != NULL) {
+    return __atomic_load_n(&priv->in->tail, __ATOMIC_ACQUIRE) != priv->in->head;
+  }
+  return priv->socket_priv->receive_buffer.start < priv->socket_priv->receive_buffer.end;
+}
+
+size_t get_available_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment != NULL) {
+    return (size_t)(__atomic_load_n(&priv->in->tail, __ATOMIC_ACQUIRE) - priv->in->head);
+  }
+  return get_available_socket_input(priv->socket_priv);
+}
+
+int get_net_descriptor(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  // With a segment, the socket becomes readable only when the connection is closed.
+  return ((shm_priv_t*)net_abs)->socket_priv->socket_descriptor;
+}
+
+int close_net(net_abstraction_t net_abs, bool read_before_closing) {
+  if (net_abs == NULL) {
+    return 0;
+  }
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  if (priv->segment != NULL) {
+    close_ring(priv->out);
+    if (read_before_closing) {
+      // Discard bytes until the other side closes its ring too.
+      unsigned char discarded[64];
+      while (read_from_ring(priv, 1, discarded) == 0) {
+      }
+    }
+    // Wake any thread of this side that is waiting on the ring. The memory stays mapped until free_net().
+    close_ring(priv->in);
+  }
+  return shutdown_socket(&priv->socket_priv->socket_descriptor, read_before_closing);
+}
+
+int shutdown_net(net_abstraction_t net_abs, bool read_before_closing) {
+  int ret = close_net(net_abs, read_before_closing);
+  free_net(net_abs);
+  return ret;
+}
+
+int32_t get_my_port(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  return priv->socket_priv->port;
+}
+
+int32_t get_server_port(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  return priv->socket_priv->server_port;
+}
+
+struct in_addr* get_ip_addr(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  return &priv->socket_priv->server_ip_addr;
+}
+
+void set_my_port(net_abstraction_t net_abs, int32_t port) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  priv->socket_priv->user_specified_port = port;
+}
+
+void set_server_port(net_abstraction_t net_abs, int32_t port) {
+  LF_ASSERT_NON_NULL(net_abs);
+  shm_priv_t* priv = (shm_priv_t*)net_abs;
+  priv->socket_priv->server_port = port;
+}
@@ -4,6 +4,9 @@
  * @author Dongha Kim
  *
  * @brief Implementation of socket interface for federated Lingua Franca programs.
+ *
+ * This serves both the TCP communication type and the UDS one, which uses Unix domain sockets
+ * for federates and RTIs that all run on the same host.
  */
 
 #include <stdlib.h>    // malloc()
@@ -35,13 +38,18 @@ void free_net(net_abstraction_t net_abs) {
     return;
   }
   socket_priv_t* priv = (socket_priv_t*)net_abs;
+  free_receive_buffer(&priv->receive_buffer);
   free(priv);
 }
 
 int create_server(net_abstraction_t net_abs) {
   LF_ASSERT_NON_NULL(net_abs);
   socket_priv_t* priv = (socket_priv_t*)net_abs;
+#ifdef COMM_TYPE_UDS
+  return create_unix_socket_server(priv->user_specified_port, &priv->socket_descriptor, &priv->port);
+#else
   return create_socket_server(priv->user_specified_port, &priv->socket_descriptor, &priv->port, TCP);
+#endif
 }
 
 net_abstraction_t accept_net(net_abstraction_t server_chan) {
@@ -53,10 +61,15 @@ net_abstraction_t accept_net(net_abstraction_t server_chan) {
     net_abstraction_t client_net = initialize_net();
     socket_priv_t* client_priv = (socket_priv_t*)client_net;
     client_priv->socket_descriptor = sock;
+#ifdef COMM_TYPE_UDS
+    // The peer is on this host, which is where its servers, if any, are also reached.
+    client_priv->server_ip_addr.s_addr = htonl(INADDR_LOOPBACK);
+#else
     // Get the peer address from the connected socket_id. Saving this for the address query.
     if (get_peer_address(client_priv) != 0) {
       lf_print_error("Failed to save peer address.");
     }
+#endif
     return client_net;
   } else {
     return NULL;
@@ -66,7 +79,14 @@ net_abstraction_t accept_net(net_abstraction_t server_chan) {
 void create_client(net_abstraction_t net_abs) {
   LF_ASSERT_NON_NULL(net_abs);
   socket_priv_t* priv = (socket_priv_t*)net_abs;
+#ifdef COMM_TYPE_UDS
+  priv->socket_descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (priv->socket_descriptor < 0) {
+    lf_print_error_system_failure("Could not open Unix domain socket.");
+  }
+#else
   priv->socket_descriptor = create_real_time_tcp_socket_errexit();
+#endif
 }
 
 net_abstraction_t connect_to_net(net_params_t params) {
@@ -78,8 +98,13 @@ net_abstraction_t connect_to_net(net_params_t params) {
   // Create the client network abstraction.
   create_client(net);
   // Connect to the target server.
+#ifdef COMM_TYPE_UDS
+  // Servers are named by their port alone, as they all run on this host.
+  if (connect_to_unix_socket(priv->socket_descriptor, priv->server_port) != 0) {
+#else
   if (connect_to_socket(priv->socket_descriptor, sock_params->server_hostname, sock_params->server_ip_addr,
                         priv->server_port) != 0) {
+#endif
     lf_print_error("Failed to connect to socket.");
     free_net(net);
     return NULL;
@@ -87,10 +112,15 @@ net_abstraction_t connect_to_net(net_params_t params) {
   return net;
 }
 
+/** Receive function of the socket's receive buffer. */
+static ssize_t receive_from_priv(void* connection, unsigned char* buffer, size_t max_bytes) {
+  return receive_from_socket(((socket_priv_t*)connection)->socket_descriptor, buffer, max_bytes);
+}
+
 int read_from_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
   LF_ASSERT_NON_NULL(net_abs);
   socket_priv_t* priv = (socket_priv_t*)net_abs;
-  return read_from_socket(priv->socket_descriptor, num_bytes, buffer);
+  return read_from_receive_buffer(&priv->receive_buffer, num_bytes, buffer, receive_from_priv, priv);
 }
 
 int read_from_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
@@ -143,6 +173,25 @@ int write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
   return result;
 }
 
+int write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  socket_priv_t* priv = (socket_priv_t*)net_abs;
+  return write_to_socket_v(priv->socket_descriptor, vectors, count);
+}
+
+int write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  socket_priv_t* priv = (socket_priv_t*)net_abs;
+  int result = write_to_net_v(net_abs, vectors, count);
+  if (result) {
+    // Write failed.
+    // Socket has probably been closed from the other side.
+    // Shut down and close the socket from this side.
+    shutdown_socket(&priv->socket_descriptor, false);
+  }
+  return result;
+}
+
 void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, lf_mutex_t* mutex,
                                 char* format, ...) {
   LF_ASSERT_NON_NULL(net_abs);
@@ -166,9 +215,30 @@ void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
 bool is_net_open(net_abstraction_t net_abs) {
   LF_ASSERT_NON_NULL(net_abs);
   socket_priv_t* priv = (socket_priv_t*)net_abs;
+  net_receive_buffer_t* receive_buffer = &priv->receive_buffer;
+  if (priv->socket_descriptor >= 0 && receive_buffer->start < receive_buffer->end) {
+    // Bytes that have been received are still to be read, so the socket may be ahead of the reader.
+    return true;
+  }
   return is_socket_open(priv->socket_descriptor);
 }
 
+bool has_buffered_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  socket_priv_t* priv = (socket_priv_t*)net_abs;
+  return priv->receive_buffer.start < priv->receive_buffer.end;
+}
+
+size_t get_available_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  return get_available_socket_input((socket_priv_t*)net_abs);
+}
+
+int get_net_descriptor(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  return ((socket_priv_t*)net_abs)->socket_descriptor;
+}
+
 int close_net(net_abstraction_t net_abs, bool read_before_closing) {
   if (net_abs == NULL) {
     return 0;
@@ -247,6 +247,46 @@ int write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
   return result;
 }
 
+int write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  size_t total = 0;
+  for (int i = 0; i < count; i++) {
+    total += vectors[i].iov_len;
+  }
+  if (count > 1 && total <= MAX_SECURE_COMM_MSG_LENGTH) {
+    // Gather the buffers so that they are encrypted and sent as a single secure message.
+    unsigned char* combined = (unsigned char*)malloc(total);
+    if (combined != NULL) {
+      size_t offset = 0;
+      for (int i = 0; i < count; i++) {
+        memcpy(combined + offset, vectors[i].iov_base, vectors[i].iov_len);
+        offset += vectors[i].iov_len;
+      }
+      int result = write_to_net(net_abs, total, combined);
+      free(combined);
+      return result;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    if (write_to_net(net_abs, vectors[i].iov_len, (unsigned char*)vectors[i].iov_base)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  sst_priv_t* priv = (sst_priv_t*)net_abs;
+  int result = write_to_net_v(net_abs, vectors, count);
+  if (result) {
+    // Write failed.
+    // Socket has probably been closed from the other side.
+    // Shut down and close the socket from this side.
+    shutdown_socket(&priv->socket_priv->socket_descriptor, false);
+  }
+  return result;
+}
+
 void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, lf_mutex_t* mutex,
                                 char* format, ...) {
   LF_ASSERT_NON_NULL(net_abs);
@@ -270,9 +310,31 @@ void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
 bool is_net_open(net_abstraction_t net_abs) {
   LF_ASSERT_NON_NULL(net_abs);
   sst_priv_t* priv = (sst_priv_t*)net_abs;
+  if (priv->socket_priv->socket_descriptor >= 0 && priv->buf_off < priv->buf_filled) {
+    // A decrypted message is still being consumed.
+    return true;
+  }
   return is_socket_open(priv->socket_priv->socket_descriptor);
 }
 
+bool has_buffered_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  sst_priv_t* priv = (sst_priv_t*)net_abs;
+  return priv->buf_off < priv->buf_filled;
+}
+
+size_t get_available_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  sst_priv_t* priv = (sst_priv_t*)net_abs;
+  // Bytes that the socket has received may not yet form a whole secure message, so only decrypted ones count.
+  return priv->buf_filled - priv->buf_off;
+}
+
+int get_net_descriptor(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  return ((sst_priv_t*)net_abs)->socket_priv->socket_descriptor;
+}
+
 int close_net(net_abstraction_t net_abs, bool read_before_closing) {
   if (net_abs == NULL) {
     return 0;
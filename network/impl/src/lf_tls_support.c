@@ -5,6 +5,8 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
 
 #include "net_abstraction.h"
 #include "lf_tls_support.h"
@@ -87,6 +89,7 @@ void free_net(net_abstraction_t net_abs) {
   // Assuming global context is managed separately or lives until exit.
 
   if (priv->socket_priv) {
+    free_receive_buffer(&priv->socket_priv->receive_buffer);
     free(priv->socket_priv);
   }
   free(priv);
@@ -211,33 +214,36 @@ static int is_disconnect_syscall(int err, int ret) {
   return 0;
 }
 
-int read_from_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
-  LF_ASSERT_NON_NULL(net_abs);
-  tls_priv_t* priv = (tls_priv_t*)net_abs;
-
-  size_t bytes_read = 0;
-  while (bytes_read < num_bytes) {
-    int ret = SSL_read(priv->ssl, buffer + bytes_read, num_bytes - bytes_read);
+/**
+ * Receive function of the connection's receive buffer. This performs a single SSL_read,
+ * which returns at most one TLS record, so a record carrying several messages is decrypted once.
+ */
+static ssize_t receive_from_tls(void* connection, unsigned char* buffer, size_t max_bytes) {
+  tls_priv_t* priv = (tls_priv_t*)connection;
+  int max = max_bytes > INT_MAX ? INT_MAX : (int)max_bytes;
+  while (true) {
+    int ret = SSL_read(priv->ssl, buffer, max);
     if (ret > 0) {
-      bytes_read += (size_t)ret;
-      continue;
+      return ret;
     }
 
     int err = SSL_get_error(priv->ssl, ret);
 
     if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
-      lf_sleep(DELAY_BETWEEN_SOCKET_RETRIES);
+      if (wait_for_socket(priv->socket_priv->socket_descriptor, err == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT)) {
+        return -1;
+      }
       continue;
     }
 
     if (err == SSL_ERROR_ZERO_RETURN) {
       // close_notify received
-      return 1; // EOF
+      return 0; // EOF
     }
 
     if (is_disconnect_syscall(err, ret)) {
       // peer disconnected without close_notify (or reset)
-      return 1; // treat as EOF
+      return 0; // treat as EOF
     }
 
     // Real TLS/protocol error
@@ -245,7 +251,12 @@ int read_from_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* bu
     ERR_print_errors_fp(stderr);
     return -1;
   }
-  return 0;
+}
+
+int read_from_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  tls_priv_t* priv = (tls_priv_t*)net_abs;
+  return read_from_receive_buffer(&priv->socket_priv->receive_buffer, num_bytes, buffer, receive_from_tls, priv);
 }
 int read_from_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
   int ret = read_from_net(net_abs, num_bytes, buffer);
@@ -284,8 +295,10 @@ int write_to_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buf
     } else {
       int err = SSL_get_error(priv->ssl, ret);
       if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
-        // Sleep briefly to avoid spinning at 100% CPU while the socket is busy
-        lf_sleep(DELAY_BETWEEN_SOCKET_RETRIES);
+        // Wait for the socket rather than spinning at 100% CPU while it is busy.
+        if (wait_for_socket(priv->socket_priv->socket_descriptor, err == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT)) {
+          return -1;
+        }
         continue;
       }
       lf_print_error("SSL_write failed with error %d", err);
@@ -305,6 +318,46 @@ int write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
   return 0;
 }
 
+/** The largest plaintext that fits in one TLS record. */
+#define TLS_MAX_RECORD_LENGTH 16384
+
+int write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  size_t total = 0;
+  for (int i = 0; i < count; i++) {
+    total += vectors[i].iov_len;
+  }
+  if (count > 1 && total <= TLS_MAX_RECORD_LENGTH) {
+    // Gather the buffers so that they are encrypted and sent as a single record.
+    unsigned char* combined = (unsigned char*)malloc(total);
+    if (combined != NULL) {
+      size_t offset = 0;
+      for (int i = 0; i < count; i++) {
+        memcpy(combined + offset, vectors[i].iov_base, vectors[i].iov_len);
+        offset += vectors[i].iov_len;
+      }
+      int ret = write_to_net(net_abs, total, combined);
+      free(combined);
+      return ret;
+    }
+  }
+  // Each buffer fills at least one record of its own anyway.
+  for (int i = 0; i < count; i++) {
+    if (write_to_net(net_abs, vectors[i].iov_len, (unsigned char*)vectors[i].iov_base)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  int ret = write_to_net_v(net_abs, vectors, count);
+  if (ret < 0) {
+    shutdown_net(net_abs, false);
+    return -1;
+  }
+  return 0;
+}
+
 void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, lf_mutex_t* mutex,
                                 char* format, ...) {
   va_list args;
@@ -326,9 +379,38 @@ void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, uns
 bool is_net_open(net_abstraction_t net_abs) {
   LF_ASSERT_NON_NULL(net_abs);
   tls_priv_t* priv = (tls_priv_t*)net_abs;
+  net_receive_buffer_t* receive_buffer = &priv->socket_priv->receive_buffer;
+  if (priv->socket_priv->socket_descriptor >= 0 && receive_buffer->start < receive_buffer->end) {
+    return true;
+  }
   return is_socket_open(priv->socket_priv->socket_descriptor);
 }
 
+bool has_buffered_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  tls_priv_t* priv = (tls_priv_t*)net_abs;
+  net_receive_buffer_t* receive_buffer = &priv->socket_priv->receive_buffer;
+  // OpenSSL may also hold decrypted bytes that have not yet been moved into the receive buffer.
+  return receive_buffer->start < receive_buffer->end || (priv->ssl != NULL && SSL_pending(priv->ssl) > 0);
+}
+
+size_t get_available_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  tls_priv_t* priv = (tls_priv_t*)net_abs;
+  net_receive_buffer_t* receive_buffer = &priv->socket_priv->receive_buffer;
+  // Bytes that the socket has received may not yet form a whole record, so only decrypted ones count.
+  size_t available = receive_buffer->end - receive_buffer->start;
+  if (priv->ssl != NULL && SSL_pending(priv->ssl) > 0) {
+    available += (size_t)SSL_pending(priv->ssl);
+  }
+  return available;
+}
+
+int get_net_descriptor(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  return ((tls_priv_t*)net_abs)->socket_priv->socket_descriptor;
+}
+
 int close_net(net_abstraction_t net_abs, bool read_before_closing) {
   if (net_abs == NULL)
     return 0;
@@ -0,0 +1,563 @@
+/**
+ * @file
+ * @brief Implementation of the network abstraction over TCP with io_uring receive completions.
+ *
+ * See lf_uring_support.h. Connections are made with the socket implementation's functions, and
+ * writes use them too. Reads are served from the receive buffers filled by the kernel, or, if no
+ * io_uring instance could be set up, from the socket.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "net_abstraction.h"
+#include "lf_uring_support.h"
+#include "util.h"
+#include "logging.h"
+
+#if (LF_URING_BUFFER_COUNT & (LF_URING_BUFFER_COUNT - 1)) != 0
+#error "LF_URING_BUFFER_COUNT must be a power of two."
+#endif
+
+/** Number of submission queue entries. At most the receive request and its cancellation are submitted at once. */
+#define LF_URING_ENTRIES 4u
+
+/** Identifier of the group of the receive buffers, unique within the io_uring instance of a connection. */
+#define LF_URING_BUFFER_GROUP 0u
+
+/** User data identifying the completions of the receive request and of its cancellation. */
+#define LF_URING_RECEIVE 1u
+#define LF_URING_CANCEL 2u
+
+/** Result of next_completion() when the kernel does not support the multishot receive. */
+#define LF_URING_UNSUPPORTED 2
+
+// PRIVATE HELPERS ***********************************************************
+
+/** Submit the given number of requests and wait for the given number of completions, retrying if interrupted. */
+static int enter(uring_priv_t* priv, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+  while (true) {
+    long result = syscall(__NR_io_uring_enter, priv->ring_descriptor, to_submit, min_complete, flags, NULL, 0);
+    if (result >= 0 || errno != EINTR) {
+      return (int)result;
+    }
+  }
+}
+
+/** Fill the next submission queue entry with the given request and submit it. */
+static int submit(uring_priv_t* priv, const struct io_uring_sqe* request) {
+  // Only the reader submits, so the tail is not written concurrently.
+  uint32_t tail = *priv->sq_tail;
+  uint32_t index = tail & priv->sq_mask;
+  priv->sqes[index] = *request;
+  priv->sq_array[index] = index;
+  __atomic_store_n(priv->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  if (enter(priv, 1, 0, 0) < 0) {
+    lf_print_error("Failed to submit an io_uring request: %s.", strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/** Submit the multishot receive request, which keeps receiving until it fails or runs out of buffers. */
+static int arm_receive(uring_priv_t* priv) {
+  if (priv->socket_priv->socket_descriptor < 0) {
+    errno = EBADF;
+    return -1;
+  }
+  struct io_uring_sqe request = {0};
+  request.opcode = IORING_OP_RECV;
+  request.fd = priv->socket_priv->socket_descriptor;
+  request.ioprio = IORING_RECV_MULTISHOT;
+  request.flags = IOSQE_BUFFER_SELECT;
+  request.buf_group = LF_URING_BUFFER_GROUP;
+  request.user_data = LF_URING_RECEIVE;
+  if (submit(priv, &request) != 0) {
+    return -1;
+  }
+  priv->receiving = true;
+  return 0;
+}
+
+/** Hand a receive buffer that has been consumed back to the kernel. */
+static void provide_buffer(uring_priv_t* priv, uint16_t id) {
+  // The tail of the ring overlays the last field of its first entry, which is thus left alone.
+  struct io_uring_buf* entry = &priv->buffer_ring->bufs[priv->buffer_ring_tail & (LF_URING_BUFFER_COUNT - 1)];
+  entry->addr = (uint64_t)(uintptr_t)(priv->buffers + (size_t)id * LF_URING_BUFFER_SIZE);
+  entry->len = LF_URING_BUFFER_SIZE;
+  entry->bid = id;
+  priv->buffer_ring_tail++;
+  __atomic_store_n(&priv->buffer_ring->tail, priv->buffer_ring_tail, __ATOMIC_RELEASE);
+}
+
+/** Whether a completion is waiting to be consumed. This may be called by a thread other than the reader. */
+static bool has_completion(uring_priv_t* priv) {
+  return __atomic_load_n(priv->cq_head, __ATOMIC_RELAXED) != __atomic_load_n(priv->cq_tail, __ATOMIC_ACQUIRE);
+}
+
+/** Consume the next completion, waiting for one if there is none. */
+static int take_completion(uring_priv_t* priv, struct io_uring_cqe* completion) {
+  while (!has_completion(priv)) {
+    if (enter(priv, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+      lf_print_error("Failed to wait for an io_uring completion: %s.", strerror(errno));
+      return -1;
+    }
+  }
+  uint32_t head = *priv->cq_head;
+  *completion = priv->cqes[head & priv->cq_mask];
+  __atomic_store_n(priv->cq_head, head + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/**
+ * Make the next buffer filled by the receive request the current one.
+ * @return 0 for success, 1 for EOF, -1 for an error, and LF_URING_UNSUPPORTED if the kernel lacks the multishot
+ * receive.
+ */
+static int next_completion(uring_priv_t* priv) {
+  while (true) {
+    if (!priv->receiving && arm_receive(priv) != 0) {
+      return -1;
+    }
+    struct io_uring_cqe completion;
+    if (take_completion(priv, &completion) != 0) {
+      return -1;
+    }
+    if (completion.user_data != LF_URING_RECEIVE) {
+      continue;
+    }
+    if (!(completion.flags & IORING_CQE_F_MORE)) {
+      // The request is over and must be submitted again for more bytes.
+      priv->receiving = false;
+    }
+    if (completion.res > 0) {
+      priv->current = (int)(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+      priv->start = 0;
+      priv->end = (size_t)completion.res;
+      priv->received = true;
+      return 0;
+    } else if (completion.res == 0) {
+      return 1;
+    } else if (completion.res == -ENOBUFS || completion.res == -EINTR || completion.res == -EAGAIN) {
+      // All the buffers were taken when more bytes arrived. They have all been consumed since, as
+      // completions are consumed in order.
+      continue;
+    } else if (completion.res == -EINVAL && !priv->received) {
+      return LF_URING_UNSUPPORTED;
+    }
+    errno = -completion.res;
+    lf_print_error("Receiving from socket %d failed. With error: `%s`", priv->socket_priv->socket_descriptor,
+                   strerror(errno));
+    return -1;
+  }
+}
+
+/** Stop the receive request, if any, and release the io_uring instance, after which the socket is read directly. */
+static void release_ring(uring_priv_t* priv) {
+  if (priv->ring_descriptor < 0) {
+    return;
+  }
+  if (priv->receiving) {
+    // Wait for the request to be over, so that the kernel no longer writes to the buffers.
+    struct io_uring_sqe request = {0};
+    request.opcode = IORING_OP_ASYNC_CANCEL;
+    request.fd = -1;
+    request.addr = LF_URING_RECEIVE;
+    request.user_data = LF_URING_CANCEL;
+    if (submit(priv, &request) == 0) {
+      struct io_uring_cqe completion;
+      while (priv->receiving && take_completion(priv, &completion) == 0) {
+        if (completion.user_data == LF_URING_RECEIVE && !(completion.flags & IORING_CQE_F_MORE)) {
+          priv->receiving = false;
+        }
+      }
+    }
+  }
+  close(priv->ring_descriptor);
+  priv->ring_descriptor = -1;
+  if (priv->rings != NULL) {
+    munmap(priv->rings, priv->rings_size);
+    priv->rings = NULL;
+  }
+  if (priv->sqes != NULL) {
+    munmap(priv->sqes, priv->sqes_size);
+    priv->sqes = NULL;
+  }
+  if (priv->buffer_ring != NULL) {
+    munmap(priv->buffer_ring, LF_URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+    priv->buffer_ring = NULL;
+  }
+  free(priv->buffers);
+  priv->buffers = NULL;
+  priv->current = -1;
+  priv->receiving = false;
+}
+
+/** Set up the io_uring instance of a connected socket and submit the receive request. */
+static int setup_ring(uring_priv_t* priv) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  // Room for a completion per buffer, plus those that end the receive request and its cancellation.
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 2 * LF_URING_BUFFER_COUNT;
+  priv->ring_descriptor = (int)syscall(__NR_io_uring_setup, LF_URING_ENTRIES, &params);
+  if (priv->ring_descriptor < 0) {
+    LF_PRINT_LOG("io_uring is not available: %s.", strerror(errno));
+    return -1;
+  }
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    LF_PRINT_LOG("io_uring is too old: the queues cannot be mapped together.");
+    release_ring(priv);
+    return -1;
+  }
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  priv->rings_size = sq_size > cq_size ? sq_size : cq_size;
+  priv->rings = mmap(NULL, priv->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     priv->ring_descriptor, IORING_OFF_SQ_RING);
+  priv->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  priv->sqes = (struct io_uring_sqe*)mmap(NULL, priv->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                          priv->ring_descriptor, IORING_OFF_SQES);
+  priv->buffer_ring = (struct io_uring_buf_ring*)mmap(NULL, LF_URING_BUFFER_COUNT * sizeof(struct io_uring_buf),
+                                                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (priv->rings == MAP_FAILED || priv->sqes == MAP_FAILED || priv->buffer_ring == MAP_FAILED) {
+    priv->rings = priv->rings == MAP_FAILED ? NULL : priv->rings;
+    priv->sqes = priv->sqes == MAP_FAILED ? NULL : priv->sqes;
+    priv->buffer_ring = priv->buffer_ring == MAP_FAILED ? NULL : priv->buffer_ring;
+    lf_print_warning("Failed to map the io_uring queues: %s.", strerror(errno));
+    release_ring(priv);
+    return -1;
+  }
+  unsigned char* rings = (unsigned char*)priv->rings;
+  priv->sq_head = (uint32_t*)(rings + params.sq_off.head);
+  priv->sq_tail = (uint32_t*)(rings + params.sq_off.tail);
+  priv->sq_mask = *(uint32_t*)(rings + params.sq_off.ring_mask);
+  priv->sq_array = (uint32_t*)(rings + params.sq_off.array);
+  priv->cq_head = (uint32_t*)(rings + params.cq_off.head);
+  priv->cq_tail = (uint32_t*)(rings + params.cq_off.tail);
+  priv->cq_mask = *(uint32_t*)(rings + params.cq_off.ring_mask);
+  priv->cqes = (struct io_uring_cqe*)(rings + params.cq_off.cqes);
+
+  struct io_uring_buf_reg registration;
+  memset(&registration, 0, sizeof(registration));
+  registration.ring_addr = (uint64_t)(uintptr_t)priv->buffer_ring;
+  registration.ring_entries = LF_URING_BUFFER_COUNT;
+  registration.bgid = LF_URING_BUFFER_GROUP;
+  if (syscall(__NR_io_uring_register, priv->ring_descriptor, IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+    LF_PRINT_LOG("io_uring does not support registered buffer rings: %s.", strerror(errno));
+    release_ring(priv);
+    return -1;
+  }
+  priv->buffers = (unsigned char*)malloc((size_t)LF_URING_BUFFER_COUNT * LF_URING_BUFFER_SIZE);
+  if (priv->buffers == NULL) {
+    lf_print_warning("Failed to allocate the io_uring receive buffers.");
+    release_ring(priv);
+    return -1;
+  }
+  priv->buffer_ring_tail = 0;
+  for (uint16_t id = 0; id < LF_URING_BUFFER_COUNT; id++) {
+    provide_buffer(priv, id);
+  }
+  // Start receiving right away, so that the descriptor of the connection signals arriving bytes.
+  if (arm_receive(priv) != 0) {
+    release_ring(priv);
+    return -1;
+  }
+  return 0;
+}
+
+/** Set up the io_uring instance of a new connection, or leave it to read from the socket if that fails. */
+static void setup_receive(uring_priv_t* priv) {
+  if (setup_ring(priv) != 0) {
+    lf_print_warning("Could not set up io_uring for socket %d. Reading from the socket instead.",
+                     priv->socket_priv->socket_descriptor);
+  }
+}
+
+/** Read the specified number of bytes from the receive buffers filled by the kernel. */
+static int read_from_ring(uring_priv_t* priv, size_t num_bytes, unsigned char* buffer) {
+  size_t copied = 0;
+  while (copied < num_bytes) {
+    if (priv->current >= 0) {
+      size_t available = priv->end - priv->start;
+      size_t to_copy = available < num_bytes - copied ? available : num_bytes - copied;
+      memcpy(buffer + copied, priv->buffers + (size_t)priv->current * LF_URING_BUFFER_SIZE + priv->start, to_copy);
+      priv->start += to_copy;
+      copied += to_copy;
+      if (priv->start == priv->end) {
+        provide_buffer(priv, (uint16_t)priv->current);
+        priv->current = -1;
+      }
+      continue;
+    }
+    int result = next_completion(priv);
+    if (result != 0) {
+      return result;
+    }
+  }
+  return 0;
+}
+
+// IMPLEMENTATION OF NETWORK ABSTRACTION API *********************************
+
+net_abstraction_t initialize_net() {
+  uring_priv_t* priv = (uring_priv_t*)calloc(1, sizeof(uring_priv_t));
+  if (priv == NULL) {
+    lf_print_error_and_exit("Failed to allocate memory for uring_priv_t.");
+  }
+  priv->socket_priv = (socket_priv_t*)malloc(sizeof(socket_priv_t));
+  if (priv->socket_priv == NULL) {
+    lf_print_error_and_exit("Failed to allocate memory for socket_priv_t.");
+  }
+  lf_initialize_socket_priv(priv->socket_priv);
+  priv->ring_descriptor = -1;
+  priv->current = -1;
+  return (net_abstraction_t)priv;
+}
+
+void free_net(net_abstraction_t net_abs) {
+  if (net_abs == NULL) {
+    LF_PRINT_LOG("Network abstraction already freed.");
+    return;
+  }
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  release_ring(priv);
+  free_receive_buffer(&priv->socket_priv->receive_buffer);
+  free(priv->socket_priv);
+  free(priv);
+}
+
+int create_server(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  return create_socket_server(priv->socket_priv->user_specified_port, &priv->socket_priv->socket_descriptor,
+                              &priv->socket_priv->port, TCP);
+}
+
+net_abstraction_t accept_net(net_abstraction_t server_chan) {
+  LF_ASSERT_NON_NULL(server_chan);
+  uring_priv_t* server_priv = (uring_priv_t*)server_chan;
+  int sock = accept_socket(server_priv->socket_priv->socket_descriptor);
+  if (sock < 0) {
+    return NULL;
+  }
+  net_abstraction_t client_net = initialize_net();
+  uring_priv_t* client_priv = (uring_priv_t*)client_net;
+  client_priv->socket_priv->socket_descriptor = sock;
+  // Get the peer address from the connected socket_id. Saving this for the address query.
+  if (get_peer_address(client_priv->socket_priv) != 0) {
+    lf_print_error("Failed to save peer address.");
+  }
+  setup_receive(client_priv);
+  return client_net;
+}
+
+void create_client(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  priv->socket_priv->socket_descriptor = create_real_time_tcp_socket_errexit();
+}
+
+net_abstraction_t connect_to_net(net_params_t params) {
+  socket_connection_params_t* sock_params = (socket_connection_params_t*)params;
+  net_abstraction_t net = initialize_net();
+  uring_priv_t* priv = (uring_priv_t*)net;
+  priv->socket_priv->server_port = sock_params->port;
+  create_client(net);
+  if (connect_to_socket(priv->socket_priv->socket_descriptor, sock_params->server_hostname,
+                        sock_params->server_ip_addr, priv->socket_priv->server_port) != 0) {
+    lf_print_error("Failed to connect to socket.");
+    free_net(net);
+    return NULL;
+  }
+  setup_receive(priv);
+  return net;
+}
+
+/** Receive function of the socket's receive buffer. */
+static ssize_t receive_from_priv(void* connection, unsigned char* buffer, size_t max_bytes) {
+  return receive_from_socket(((socket_priv_t*)connection)->socket_descriptor, buffer, max_bytes);
+}
+
+int read_from_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  if (priv->ring_descriptor >= 0) {
+    int result = read_from_ring(priv, num_bytes, buffer);
+    if (result != LF_URING_UNSUPPORTED) {
+      return result;
+    }
+    // Nothing has been received through the ring, so reading from the socket loses no bytes.
+    lf_print_warning("The kernel does not support multishot receives. Reading from socket %d instead.",
+                     priv->socket_priv->socket_descriptor);
+    release_ring(priv);
+  }
+  return read_from_receive_buffer(&priv->socket_priv->receive_buffer, num_bytes, buffer, receive_from_priv,
+                                  priv->socket_priv);
+}
+
+int read_from_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  int read_failed = read_from_net(net_abs, num_bytes, buffer);
+  if (read_failed) {
+    // The connection has probably been closed from the other side. Close it from this side.
+    close_net(net_abs, false);
+    return -1;
+  }
+  return 0;
+}
+
+void read_from_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, char* format,
+                                 ...) {
+  LF_ASSERT_NON_NULL(net_abs);
+  va_list args;
+  int read_failed = read_from_net_close_on_error(net_abs, num_bytes, buffer);
+  if (read_failed) {
+    if (format != NULL) {
+      va_start(args, format);
+      lf_print_error_system_failure(format, args);
+      va_end(args);
+    } else {
+      lf_print_error_system_failure("Failed to read from the network.");
+    }
+  }
+}
+
+int write_to_net(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  return write_to_socket(priv->socket_priv->socket_descriptor, num_bytes, buffer);
+}
+
+int write_to_net_close_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer) {
+  LF_ASSERT_NON_NULL(net_abs);
+  int result = write_to_net(net_abs, num_bytes, buffer);
+  if (result) {
+    // The connection has probably been closed from the other side. Close it from this side.
+    close_net(net_abs, false);
+  }
+  return result;
+}
+
+int write_to_net_v(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  return write_to_socket_v(priv->socket_priv->socket_descriptor, vectors, count);
+}
+
+int write_to_net_v_close_on_error(net_abstraction_t net_abs, const struct iovec* vectors, int count) {
+  LF_ASSERT_NON_NULL(net_abs);
+  int result = write_to_net_v(net_abs, vectors, count);
+  if (result) {
+    // The connection has probably been closed from the other side. Close it from this side.
+    close_net(net_abs, false);
+  }
+  return result;
+}
+
+void write_to_net_fail_on_error(net_abstraction_t net_abs, size_t num_bytes, unsigned char* buffer, lf_mutex_t* mutex,
+                                char* format, ...) {
+  LF_ASSERT_NON_NULL(net_abs);
+  va_list args;
+  int result = write_to_net_close_on_error(net_abs, num_bytes, buffer);
+  if (result) {
+    if (mutex != NULL) {
+      LF_MUTEX_UNLOCK(mutex);
+    }
+    if (format != NULL) {
+      va_start(args, format);
+      lf_print_error_system_failure(format, args);
+      va_end(args);
+    } else {
+      lf_print_error_and_exit("Failed to write to the network. Shutting down.");
+    }
+  }
+}
+
+bool is_net_open(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  if (priv->socket_priv->socket_descriptor >= 0 && has_buffered_input(net_abs)) {
+    // Bytes that have been received are still to be read, so the socket may be ahead of the reader.
+    return true;
+  }
+  return is_socket_open(priv->socket_priv->socket_descriptor);
+}
+
+bool has_buffered_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  if (priv->ring_descriptor >= 0) {
+    return priv->current >= 0 || has_completion(priv);
+  }
+  return priv->socket_priv->receive_buffer.start < priv->socket_priv->receive_buffer.end;
+}
+
+size_t get_available_input(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  if (priv->ring_descriptor >= 0) {
+    // Buffers filled after the current one are not counted.
+    return priv->current >= 0 ? priv->end - priv->start : 0;
+  }
+  return get_available_socket_input(priv->socket_priv);
+}
+
+int get_net_descriptor(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  // Bytes are taken from the socket by the receive request, and the io_uring instance becomes
+  // readable once they are in a buffer.
+  return priv->ring_descriptor >= 0 ? priv->ring_descriptor : priv->socket_priv->socket_descriptor;
+}
+
+int close_net(net_abstraction_t net_abs, bool read_before_closing) {
+  if (net_abs == NULL) {
+    return 0;
+  }
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  // Shutting the socket down ends the receive request with an EOF, which wakes a waiting reader.
+  return shutdown_socket(&priv->socket_priv->socket_descriptor, read_before_closing);
+}
+
+int shutdown_net(net_abstraction_t net_abs, bool read_before_closing) {
+  int ret = close_net(net_abs, read_before_closing);
+  free_net(net_abs);
+  return ret;
+}
+
+int32_t get_my_port(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  return priv->socket_priv->port;
+}
+
+int32_t get_server_port(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  return priv->socket_priv->server_port;
+}
+
+struct in_addr* get_ip_addr(net_abstraction_t net_abs) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  return &priv->socket_priv->server_ip_addr;
+}
+
+void set_my_port(net_abstraction_t net_abs, int32_t port) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  priv->socket_priv->user_specified_port = port;
+}
+
+void set_server_port(net_abstraction_t net_abs, int32_t port) {
+  LF_ASSERT_NON_NULL(net_abs);
+  uring_priv_t* priv = (uring_priv_t*)net_abs;
+  priv->socket_priv->server_port = port;
+}
@@ -14,12 +14,17 @@
 #include <arpa/inet.h>   // inet_ntop
 #include <errno.h>
 #include <stdio.h>
+#include <sys/ioctl.h> // FIONREAD
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
+#include <sys/un.h> // sockaddr_un
 #include <stdarg.h> //va_list
-#include <string.h> // strerror
+#include <stddef.h> // offsetof()
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strerror, memcpy
 
 #include "util.h" // LF_MUTEX_UNLOCK()
 #include "logging.h"
@@ -185,6 +190,72 @@ int get_peer_address(socket_priv_t* priv) {
   return 0;
 }
 
+#ifdef COMM_TYPE_UDS
+/**
+ * Set the abstract address of the Unix domain socket server listening on the specified port.
+ * @return The length of the address.
+ */
+static socklen_t set_unix_socket_address(struct sockaddr_un* address, uint16_t port) {
+  memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  // A leading null character puts the name in the abstract namespace, which needs no file
+  // and is cleaned up by the kernel once the socket is closed.
+  int length = snprintf(address->sun_path + 1, sizeof(address->sun_path) - 1, UDS_ADDRESS_FORMAT, port);
+  return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + (size_t)length);
+}
+
+int create_unix_socket_server(uint16_t port, int* final_socket, uint16_t* final_port) {
+  int socket_descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket_descriptor < 0) {
+    lf_print_error("Failed to create Unix domain socket: %s.", strerror(errno));
+    return -1;
+  }
+  uint32_t range = UINT16_MAX + 1u - UDS_FIRST_AUTOMATIC_PORT;
+  // Start from a port that depends on the process so that servers created at the same time
+  // by several federates seldom probe the same ports.
+  uint32_t offset = (uint32_t)getpid() % range;
+  uint32_t attempts = (port == 0) ? range : 1;
+  for (uint32_t i = 0; i < attempts; i++) {
+    uint16_t used_port = (port == 0) ? (uint16_t)(UDS_FIRST_AUTOMATIC_PORT + (offset + i) % range) : port;
+    struct sockaddr_un address;
+    socklen_t length = set_unix_socket_address(&address, used_port);
+    if (bind(socket_descriptor, (struct sockaddr*)&address, length) == 0) {
+      if (listen(socket_descriptor, 128)) {
+        lf_print_error("Failed to listen on %d socket: %s.", socket_descriptor, strerror(errno));
+        break;
+      }
+      lf_print_debug("Unix domain socket is bound to port %d.", used_port);
+      *final_socket = socket_descriptor;
+      *final_port = used_port;
+      return 0;
+    } else if (errno != EADDRINUSE) {
+      break;
+    }
+  }
+  lf_print_error("Failed to bind the Unix domain socket for port %d: %s.", port, strerror(errno));
+  close(socket_descriptor);
+  return -1;
+}
+
+int connect_to_unix_socket(int sock, int port) {
+  uint16_t used_port = (port == 0) ? DEFAULT_PORT : (uint16_t)port;
+  struct sockaddr_un address;
+  socklen_t length = set_unix_socket_address(&address, used_port);
+  instant_t start_connect = lf_time_physical();
+  while (connect(sock, (struct sockaddr*)&address, length) < 0) {
+    if (CHECK_TIMEOUT(start_connect, CONNECT_TIMEOUT)) {
+      lf_print_error("Failed to connect with timeout: " PRINTF_TIME ". Giving up.", CONNECT_TIMEOUT);
+      return -1;
+    }
+    lf_sleep(CONNECT_RETRY_INTERVAL);
+    lf_print_warning("Could not connect. Will try again every " PRINTF_TIME " nanoseconds. Connecting to port %d.\n",
+                     CONNECT_RETRY_INTERVAL, used_port);
+  }
+  lf_print_info("Connected to local port %d.", used_port);
+  return 0;
+}
+#endif // COMM_TYPE_UDS
+
 int accept_socket(int socket) {
   struct sockaddr client_fd;
   // Wait for an incoming connection request.
@@ -197,6 +268,9 @@ int accept_socket(int socket) {
     if (socket_id >= 0) {
       // Got a socket
       break;
+    } else if (errno == EINTR) {
+      // A signal, such as the completion of a request on an io_uring that this thread submitted, interrupted the wait.
+      continue;
     } else if (socket_id < 0 && (errno != EAGAIN || errno != EWOULDBLOCK || errno != EINTR)) {
       if (errno != ECONNABORTED) {
         lf_print_warning("Failed to accept the socket. %s.", strerror(errno));
@@ -284,6 +358,18 @@ int connect_to_socket(int sock, const char* hostname, const struct in_addr* ip_a
   return ret;
 }
 
+int wait_for_socket(int socket, short events) {
+  struct pollfd descriptor = {.fd = socket, .events = events};
+  while (poll(&descriptor, 1, -1) < 0) {
+    if (errno != EINTR) {
+      lf_print_error("Polling socket %d failed. With error: `%s`", socket, strerror(errno));
+      return -1;
+    }
+  }
+  // Readiness, an error or a hang-up: in all cases, the next attempt tells.
+  return 0;
+}
+
 int read_from_socket(int socket, size_t num_bytes, unsigned char* buffer) {
   if (socket < 0) {
     // Socket is not open.
@@ -297,7 +383,9 @@ int read_from_socket(int socket, size_t num_bytes, unsigned char* buffer) {
       // Those error codes set by the socket indicates
       // that we should try again (@see man errno).
       LF_PRINT_DEBUG("Reading from socket %d failed with error: `%s`. Will try again.", socket, strerror(errno));
-      lf_sleep(DELAY_BETWEEN_SOCKET_RETRIES);
+      if (errno != EINTR && wait_for_socket(socket, POLLIN)) {
+        return -1;
+      }
       continue;
     } else if (more < 0) {
       // A more serious error occurred.
@@ -312,6 +400,88 @@ int read_from_socket(int socket, size_t num_bytes, unsigned char* buffer) {
   return 0;
 }
 
+ssize_t receive_from_socket(int socket, unsigned char* buffer, size_t max_bytes) {
+  if (socket < 0) {
+    // Socket is not open.
+    errno = EBADF;
+    return -1;
+  }
+  while (true) {
+    ssize_t result = read(socket, buffer, max_bytes);
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      // Those error codes set by the socket indicates
+      // that we should try again (@see man errno).
+      LF_PRINT_DEBUG("Reading from socket %d failed with error: `%s`. Will try again.", socket, strerror(errno));
+      if (errno != EINTR && wait_for_socket(socket, POLLIN)) {
+        return -1;
+      }
+      continue;
+    } else if (result < 0) {
+      lf_print_error("Reading from socket %d failed. With error: `%s`", socket, strerror(errno));
+    }
+    return result;
+  }
+}
+
+int read_from_receive_buffer(net_receive_buffer_t* receive_buffer, size_t num_bytes, unsigned char* buffer,
+                             net_receive_function_t receive, void* connection) {
+  size_t copied = 0;
+  while (copied < num_bytes) {
+    size_t available = receive_buffer->end - receive_buffer->start;
+    if (available > 0) {
+      size_t to_copy = available < num_bytes - copied ? available : num_bytes - copied;
+      memcpy(buffer + copied, receive_buffer->data + receive_buffer->start, to_copy);
+      receive_buffer->start += to_copy;
+      copied += to_copy;
+      if (receive_buffer->start == receive_buffer->end) {
+        receive_buffer->start = receive_buffer->end = 0;
+      }
+      continue;
+    }
+    ssize_t received;
+    if (num_bytes - copied >= NET_RECEIVE_BUFFER_SIZE) {
+      // Large payloads gain nothing from the extra copy.
+      received = receive(connection, buffer + copied, num_bytes - copied);
+      if (received > 0) {
+        copied += (size_t)received;
+      }
+    } else {
+      if (receive_buffer->data == NULL) {
+        receive_buffer->data = (unsigned char*)malloc(NET_RECEIVE_BUFFER_SIZE);
+        if (receive_buffer->data == NULL) {
+          lf_print_error("Failed to allocate a receive buffer.");
+          return -1;
+        }
+      }
+      received = receive(connection, receive_buffer->data, NET_RECEIVE_BUFFER_SIZE);
+      if (received > 0) {
+        receive_buffer->end = (size_t)received;
+      }
+    }
+    if (received == 0) {
+      return 1;
+    } else if (received < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+size_t get_available_socket_input(socket_priv_t* priv) {
+  size_t available = priv->receive_buffer.end - priv->receive_buffer.start;
+  int received = 0;
+  if (priv->socket_descriptor >= 0 && ioctl(priv->socket_descriptor, FIONREAD, &received) == 0 && received > 0) {
+    available += (size_t)received;
+  }
+  return available;
+}
+
+void free_receive_buffer(net_receive_buffer_t* receive_buffer) {
+  free(receive_buffer->data);
+  receive_buffer->data = NULL;
+  receive_buffer->start = receive_buffer->end = 0;
+}
+
 ssize_t peek_from_socket(int socket, unsigned char* result) {
   ssize_t bytes_read = recv(socket, result, 1, MSG_DONTWAIT | MSG_PEEK);
   if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
@@ -329,23 +499,77 @@ int write_to_socket(int socket, size_t num_bytes, unsigned char* buffer) {
   ssize_t bytes_written = 0;
   while (bytes_written < (ssize_t)num_bytes) {
     ssize_t more = write(socket, buffer + bytes_written, num_bytes - (size_t)bytes_written);
-    if (more <= 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
-      // The error codes EAGAIN or EWOULDBLOCK indicate
-      // that we should try again (@see man errno).
-      // The error code EINTR means the system call was interrupted before completing.
-      LF_PRINT_DEBUG("Writing to socket %d was blocked. Will try again.", socket);
-      lf_sleep(DELAY_BETWEEN_SOCKET_RETRIES);
-      continue;
-    } else if (more < 0) {
+    if (more < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        // The error codes EAGAIN or EWOULDBLOCK indicate
+        // that we should try again (@see man errno).
+        // The error code EINTR means the system call was interrupted before completing.
+        LF_PRINT_DEBUG("Writing to socket %d was blocked. Will try again.", socket);
+        if (errno != EINTR && wait_for_socket(socket, POLLOUT)) {
+          return -1;
+        }
+        continue;
+      }
       // A more serious error occurred.
       lf_print_error("Writing to socket %d failed. With error: `%s`", socket, strerror(errno));
       return -1;
+    } else if (more == 0) {
+      // Nothing was written and no error was reported, so errno is stale and trying again could loop forever.
+      lf_print_error("Writing to socket %d made no progress.", socket);
+      errno = EIO;
+      return -1;
     }
     bytes_written += more;
   }
   return 0;
 }
 
+int write_to_socket_v(int socket, const struct iovec* vectors, int count) {
+  if (socket < 0) {
+    // Socket is not open.
+    errno = EBADF;
+    return -1;
+  }
+  // Copy the vectors so that those partially written can be advanced.
+  struct iovec remaining[count];
+  memcpy(remaining, vectors, sizeof(struct iovec) * (size_t)count);
+  int first = 0;
+  while (first < count) {
+    if (remaining[first].iov_len == 0) {
+      // Skip empty buffers, so that writing nothing below means that no progress was made.
+      first++;
+      continue;
+    }
+    ssize_t more = writev(socket, &remaining[first], count - first);
+    if (more < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        LF_PRINT_DEBUG("Writing to socket %d was blocked. Will try again.", socket);
+        if (errno != EINTR && wait_for_socket(socket, POLLOUT)) {
+          return -1;
+        }
+        continue;
+      }
+      lf_print_error("Writing to socket %d failed. With error: `%s`", socket, strerror(errno));
+      return -1;
+    } else if (more == 0) {
+      // As in write_to_socket(), errno is stale, so do not try again.
+      lf_print_error("Writing to socket %d made no progress.", socket);
+      errno = EIO;
+      return -1;
+    }
+    // Skip the buffers that have been written completely, which include empty ones.
+    while (first < count && (size_t)more >= remaining[first].iov_len) {
+      more -= (ssize_t)remaining[first].iov_len;
+      first++;
+    }
+    if (first < count) {
+      remaining[first].iov_base = (char*)remaining[first].iov_base + more;
+      remaining[first].iov_len -= (size_t)more;
+    }
+  }
+  return 0;
+}
+
 void init_shutdown_mutex(void) { LF_MUTEX_INIT(&shutdown_mutex); }
 
 int shutdown_socket(int* socket, bool read_before_closing) {
@@ -407,4 +631,8 @@ void lf_initialize_socket_priv(socket_priv_t* priv) {
   // Federate initialization
   priv->server_ip_addr.s_addr = 0;
   priv->server_port = -1;
+
+  priv->receive_buffer.data = NULL;
+  priv->receive_buffer.start = 0;
+  priv->receive_buffer.end = 0;
 }
@@ -22,11 +22,27 @@ endfunction()
 
 # Add the appropriate directories for the provided build parameters.
 add_test_dir(${TEST_DIR}/general)
+if(NOT DEFINED LF_REACTION_PROFILING)
+    # Reaction profiles are compiled into the runtime only when profiling is enabled.
+    list(REMOVE_ITEM TEST_FILES general/reaction_profile_test.c)
+endif()
+if(NOT DEFINED LF_METRICS)
+    list(REMOVE_ITEM TEST_FILES general/metrics_test.c)
+endif()
 if(NUMBER_OF_WORKERS)
     if (${CMAKE_SYSTEM_NAME} STREQUAL "Linux")
       add_test_dir(${TEST_DIR}/scheduling)
     endif()
 endif(NUMBER_OF_WORKERS)
+if(DEFINED FEDERATED)
+    add_test_dir(${TEST_DIR}/federated)
+    if(NOT DEFINED FEDERATED_COMPRESSION)
+        list(REMOVE_ITEM TEST_FILES federated/compression_test.c)
+    endif()
+endif()
+if(DEFINED LF_ENCLAVES AND NOT DEFINED FEDERATED AND NOT DEFINED LF_SINGLE_THREADED)
+    add_test_dir(${TEST_DIR}/enclaves)
+endif()
 
 # Create executables for each test.
 foreach(FILE ${TEST_FILES})
@@ -44,3 +60,17 @@ foreach(FILE ${TEST_FILES})
     # Warnings as errors
     lf_enable_compiler_warnings(${NAME})
 endforeach(FILE ${TEST_FILES})
+
+# Build benchmarks. These are not run as tests.
+if(DEFINED LF_ENCLAVES AND NOT DEFINED FEDERATED AND NOT DEFINED LF_SINGLE_THREADED)
+    add_executable(enclave_channel_bench ${TEST_DIR}/bench/enclave_channel_bench.c)
+    target_link_libraries(enclave_channel_bench PRIVATE lf::low-level-platform-impl ${CoreLib} ${Lib})
+    lf_enable_compiler_warnings(enclave_channel_bench)
+endif()
+if(DEFINED FEDERATED AND NOT DEFINED LF_ENCLAVES AND NOT DEFINED LF_SINGLE_THREADED AND CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    include(${LF_ROOT}/core/federated/RTI/bench/net_emulation.cmake)
+    add_executable(federation_bench ${TEST_DIR}/bench/federation_bench.c)
+    target_link_libraries(federation_bench PRIVATE lf::low-level-platform-impl ${CoreLib} ${Lib})
+    lf_enable_net_emulation(federation_bench)
+    lf_enable_compiler_warnings(federation_bench)
+endif()
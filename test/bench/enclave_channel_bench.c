@@ -0,0 +1,252 @@
+/**
+ * @file enclave_channel_bench.c
+ * @brief Benchmark of the throughput of messages from one scheduling enclave to another.
+ *
+ * Two enclaves each run the tag loop of the threaded runtime in their own thread, pinned to
+ * separate cores when there are enough of them. The first enclave has an event at every
+ * nanosecond after the start time and, at each of these tags, sends a message with a payload
+ * of the given size to the second, which checks that it receives each message at the tag at
+ * which it was sent, plus the delay.
+ *
+ * The messages are sent in two ways in turn:
+ * - copy: the payload is copied into a new token, which is scheduled on the event queue of the
+ *   receiver under the mutex of the receiver, as when scheduling an action of another enclave;
+ * - channel: the payload is passed without copying through an enclave channel.
+ *
+ * Usage: enclave_channel_bench [-n <messages>] [-s <payload size>] [-d <delay>] [-c <channel capacity>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "enclave_channel.h"
+#include "environment.h"
+#include "lf_token.h"
+#include "low_level_platform.h"
+#include "reactor_common.h"
+#include "rti_local.h"
+#include "util.h"
+
+// Global variables of the runtime.
+extern instant_t start_time;
+extern bool fast;
+
+// Forward declaration of function defined in reactor_threaded.c.
+void _lf_next_locked(environment_t* env);
+
+static size_t num_messages = 1000000;
+static size_t payload_size = 64;
+static interval_t delay = NEVER;
+static size_t capacity = LF_ENCLAVE_CHANNEL_CAPACITY;
+
+/** The two environments. The first sends to the second. */
+static environment_t envs[2];
+
+/** Trigger of the sender with an event at every tag. */
+static trigger_t tick;
+
+/** Trigger of the receiver to which the messages are delivered. */
+static trigger_t input;
+
+/** The channel, or NULL if messages are copied. */
+static lf_enclave_channel_t* channel;
+
+/** Type of the payloads, freed with free(). */
+static token_type_t payload_type = {.element_size = 1};
+
+/** Buffer in which the sender produces the payload when messages are copied. */
+static unsigned char* output;
+
+/** Number of messages received so far. */
+static size_t received;
+
+////////////////////////////////////////////////////////////////////
+//// Code-generated functions.
+
+void lf_create_environments(void) {}
+void _lf_initialize_trigger_objects(void) {}
+void lf_terminate_execution(environment_t* env) { (void)env; }
+void lf_set_default_command_line_options(void) {}
+void logical_tag_complete(tag_t tag_to_send) { (void)tag_to_send; }
+int _lf_get_environments(environment_t** environments) {
+  *environments = envs;
+  return 2;
+}
+
+static uint16_t upstream_of_receiver[] = {0};
+static uint16_t downstream_of_sender[] = {1};
+
+int lf_get_upstream_of(int enclave_id, uint16_t** result) {
+  *result = upstream_of_receiver;
+  return enclave_id == 1 ? 1 : 0;
+}
+
+int lf_get_downstream_of(int enclave_id, uint16_t** result) {
+  *result = downstream_of_sender;
+  return enclave_id == 0 ? 1 : 0;
+}
+
+int lf_get_upstream_delay_of(int enclave_id, interval_t** result) {
+  *result = &delay;
+  return enclave_id == 1 ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////
+//// The reactions of the two enclaves.
+
+/** Send the message of the current tag. */
+static void send_message(environment_t* env) {
+  size_t index = (size_t)(env->current_tag.time - start_time - 1);
+  if (channel != NULL) {
+    unsigned char* payload = (unsigned char*)malloc(payload_size);
+    LF_ASSERT_NON_NULL(payload);
+    memcpy(payload, &index, sizeof(index));
+    if (lf_enclave_channel_send(channel, lf_new_token(&payload_type, payload, payload_size)) != 0) {
+      lf_print_error_and_exit("Failed to send message %zu.", index);
+    }
+    return;
+  }
+  memcpy(output, &index, sizeof(index));
+  unsigned char* copy = (unsigned char*)malloc(payload_size);
+  LF_ASSERT_NON_NULL(copy);
+  memcpy(copy, output, payload_size);
+  lf_token_t* token = lf_new_token(&payload_type, copy, payload_size);
+  tag_t tag = lf_delay_tag(env->current_tag, delay);
+  environment_t* receiver = &envs[1];
+  LF_MUTEX_LOCK(&receiver->mutex);
+  _lf_schedule_at_tag(receiver, &input, tag, token);
+  rti_update_other_net_locked(env->enclave_info, receiver->enclave_info, tag);
+  lf_notify_of_event(receiver);
+  LF_MUTEX_UNLOCK(&receiver->mutex);
+}
+
+/** Check the message received at the current tag. */
+static void receive_message(environment_t* env) {
+  if (input.status != present) {
+    return;
+  }
+  size_t index;
+  memcpy(&index, input.tmplt.token->value, sizeof(index));
+  tag_t expected = lf_delay_tag((tag_t){.time = start_time + 1 + (instant_t)index, .microstep = 0}, delay);
+  if (index != received || lf_tag_compare(expected, env->current_tag) != 0) {
+    lf_print_error_and_exit("Message %zu received as message %zu at " PRINTF_TAG ".", index, received,
+                            env->current_tag.time - start_time, env->current_tag.microstep);
+  }
+  received++;
+}
+
+/** Run the tag loop of an enclave as its worker threads do, with the reactions above. */
+static void* run_enclave(void* arg) {
+  environment_t* env = (environment_t*)arg;
+  initialize_lf_thread_id();
+  int cores = lf_available_cores();
+  if (cores > 1) {
+    lf_thread_set_cpu(lf_thread_self(), (size_t)(env->id % cores));
+  }
+  LF_MUTEX_LOCK(&env->mutex);
+  rti_next_event_tag_locked(env->enclave_info, env->current_tag);
+  env->execution_started = true;
+  tag_t completed = NEVER_TAG;
+  _lf_next_locked(env);
+  while (true) {
+    if (lf_tag_compare(env->current_tag, completed) > 0 && lf_tag_compare(env->current_tag, env->stop_tag) <= 0) {
+      if (env->id == 0 && lf_tag_compare(env->current_tag, env->stop_tag) < 0) {
+        _lf_schedule_at_tag(env, &tick, lf_delay_tag(env->current_tag, 1), NULL);
+      }
+      LF_MUTEX_UNLOCK(&env->mutex);
+      if (env->id == 0) {
+        send_message(env);
+      } else {
+        receive_message(env);
+      }
+      LF_MUTEX_LOCK(&env->mutex);
+    }
+    completed = env->current_tag;
+    rti_logical_tag_complete_locked(env->enclave_info, completed);
+    if (lf_tag_compare(completed, env->stop_tag) >= 0) {
+      break;
+    }
+    _lf_next_locked(env);
+  }
+  rti_logical_tag_complete_locked(env->enclave_info, FOREVER_TAG);
+  _lf_enclave_channels_close(env);
+  LF_MUTEX_UNLOCK(&env->mutex);
+  return NULL;
+}
+
+/** Send all messages, with a channel if use_channel is true, and return the time it took. */
+static interval_t run(bool use_channel) {
+  start_time = lf_time_physical();
+  for (int i = 0; i < 2; i++) {
+    environment_init(&envs[i], i == 0 ? "sender" : "receiver", i, 1, 0, 0, 0, 0, 1, 0, 0, 0, NULL);
+    environment_init_tags(&envs[i], start_time, (interval_t)num_messages);
+  }
+  // The receiver stops at the tag of the last message.
+  envs[1].stop_tag = lf_delay_tag(envs[0].stop_tag, delay);
+  tick = (trigger_t){.tmplt.type.element_size = 0};
+  input = (trigger_t){.tmplt.type.element_size = 1};
+  received = 0;
+  channel = use_channel ? lf_enclave_channel_new(&envs[0], &envs[1], &input, delay, capacity) : NULL;
+  _lf_schedule_at_tag(&envs[0], &tick, lf_delay_tag(envs[0].start_tag, 1), NULL);
+  initialize_local_rti(envs, 2);
+
+  lf_thread_t threads[2];
+  instant_t start = lf_time_physical();
+  for (int i = 0; i < 2; i++) {
+    if (lf_thread_create(&threads[i], run_enclave, &envs[i]) != 0) {
+      lf_print_error_and_exit("Failed to create the thread of enclave %d.", i);
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    lf_thread_join(threads[i], NULL);
+  }
+  interval_t elapsed = lf_time_physical() - start;
+  if (received != num_messages) {
+    lf_print_error_and_exit("Received %zu of %zu messages.", received, num_messages);
+  }
+
+  free_local_rti();
+  // environment_free() would also free the scheduler, which is not used here.
+  _lf_enclave_channels_free(&envs[0]);
+  _lf_enclave_channels_free(&envs[1]);
+  _lf_replace_template_token(&input.tmplt, NULL);
+  return elapsed;
+}
+
+static void report(const char* mode, interval_t elapsed) {
+  double seconds = (double)elapsed / BILLION;
+  printf("%s: %zu messages of %zu bytes in %.3f s: %.0f messages/s, %.1f MB/s\n", mode, num_messages, payload_size,
+         seconds, (double)num_messages / seconds, (double)(num_messages * payload_size) / seconds / 1e6);
+}
+
+int main(int argc, const char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      num_messages = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      payload_size = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      delay = (interval_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      capacity = (size_t)atoll(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [-n <messages>] [-s <payload size>] [-d <delay>] [-c <channel capacity>]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (num_messages == 0 || payload_size < sizeof(size_t) || capacity == 0) {
+    fprintf(stderr, "The number of messages and the capacity must be positive and payloads at least %zu bytes.\n",
+            sizeof(size_t));
+    return 1;
+  }
+  initialize_lf_thread_id();
+  fast = true;
+  output = (unsigned char*)calloc(1, payload_size);
+  LF_ASSERT_NON_NULL(output);
+
+  report("copy", run(false));
+  report("channel", run(true));
+  free(output);
+  return 0;
+}
@@ -0,0 +1,723 @@
+/**
+ * @file federation_bench.c
+ * @brief Benchmark of a federation of synthetic federates run as local processes with the RTI program.
+ *
+ * This program starts the RTI program and then itself once for each federate. A federate process runs
+ * the threaded runtime with federate.c, as a program generated from Lingua Franca would, except that its
+ * reactions and network ports are defined here rather than generated. The federates are connected,
+ * without after delays, in one of these topologies:
+ * - pipeline: each federate sends to the next one;
+ * - fanout: federate 0 sends to each of the others;
+ * - fanin: each of the others sends to federate 0;
+ * - cycle: each federate sends to the next one and the last one sends to federate 0, which forms a
+ *   zero-delay cycle (ZDC).
+ *
+ * The federates that have no upstream federates, and federate 0 of the cycle, have a timer with the
+ * given period. At each tick, they send a message with a payload of the given size, which starts with
+ * the physical time at which it is sent, to their downstream federates. A federate that has both upstream
+ * and downstream federates forwards each message it receives. The others, and federate 0 of the cycle,
+ * record the latency from the time in the payload to the time at which their reaction to the message
+ * starts. Under centralized coordination, the messages go through the RTI. Under decentralized
+ * coordination, they go from federate to federate, and each federate has the given safe-to-advance (STA)
+ * offset.
+ *
+ * Every connection of a federate goes through net_emulation.c, which delays each write by the given
+ * delay plus up to the given jitter and emulates the loss of the given fraction of writes. When the RTI
+ * program is rti_net_emulation, built with the RTI, the same holds for the connections of the RTI.
+ *
+ * The benchmark reports the rate at which the federates complete tags, percentiles of the latency, and
+ * the CPU time used by the RTI.
+ *
+ * Usage: federation_bench -b <RTI program> [-t pipeline|fanout|fanin|cycle] [-f <federates>] [-n <messages>]
+ *                         [-p <period>] [-s <payload size>] [-F] [-a <STA>] [-d <delay>] [-j <jitter>]
+ *                         [-l <loss>]
+ *
+ * Times are in nanoseconds and the loss is a fraction. With -F, the federates execute in fast mode, so
+ * that the period does not bound the rate of tags. There can be at most NUMBER_OF_FEDERATES federates,
+ * as given when building the runtime.
+ */
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "environment.h"
+#include "federate.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "reactor.h"
+#include "reactor_common.h"
+#include "scheduler.h"
+#include "util.h"
+
+extern char** environ;
+extern federate_instance_t _fed;
+
+int lf_reactor_c_main(int argc, const char* argv[]);
+
+/** The file descriptor on which a federate process writes its results. */
+#define RESULTS_FD 3
+
+typedef enum { PIPELINE, FANOUT, FANIN, CYCLE } topology_t;
+
+static const char* topology_names[] = {"pipeline", "fanout", "fanin", "cycle"};
+
+static const char* rti_program = NULL;
+static topology_t topology = PIPELINE;
+static int num_federates = 2;
+static int64_t num_messages = 1000;
+static interval_t period = MSEC(1);
+static size_t payload_size = 64;
+static bool fast_mode = false;
+static interval_t sta = MSEC(10);
+static interval_t emulated_delay = 0;
+static interval_t emulated_jitter = 0;
+static double emulated_loss = 0.0;
+
+/** What a federate process writes to the launcher, followed by the latencies that it recorded. */
+typedef struct federate_result_t {
+  /** The number of tags that the federate completed. */
+  int64_t tags;
+  /** The physical time from the start time to the completion of the last tag. */
+  interval_t elapsed;
+  /** The number of messages whose latency the federate recorded. */
+  int64_t received;
+  /** The number of messages that arrived after the start of their tag. */
+  int64_t tardy;
+} federate_result_t;
+
+////////////////////////////////////////////////////////////////////
+//// The topology.
+
+/** Put the IDs of the upstream federates of a federate in `result` and return how many there are. */
+static int upstreams_of(int id, uint16_t* result) {
+  switch (topology) {
+  case PIPELINE:
+    result[0] = (uint16_t)(id - 1);
+    return id == 0 ? 0 : 1;
+  case FANOUT:
+    result[0] = 0;
+    return id == 0 ? 0 : 1;
+  case FANIN:
+    for (int i = 1; id == 0 && i < num_federates; i++) {
+      result[i - 1] = (uint16_t)i;
+    }
+    return id == 0 ? num_federates - 1 : 0;
+  default:
+    result[0] = (uint16_t)((id + num_federates - 1) % num_federates);
+    return 1;
+  }
+}
+
+/** Put the IDs of the downstream federates of a federate in `result` and return how many there are. */
+static int downstreams_of(int id, uint16_t* result) {
+  switch (topology) {
+  case PIPELINE:
+    result[0] = (uint16_t)(id + 1);
+    return id == num_federates - 1 ? 0 : 1;
+  case FANOUT:
+    for (int i = 1; id == 0 && i < num_federates; i++) {
+      result[i - 1] = (uint16_t)i;
+    }
+    return id == 0 ? num_federates - 1 : 0;
+  case FANIN:
+    result[0] = 0;
+    return id == 0 ? 0 : 1;
+  default:
+    result[0] = (uint16_t)((id + 1) % num_federates);
+    return 1;
+  }
+}
+
+/** Return the ID of the input port on which the downstream federates of a federate receive from it. */
+static uint16_t port_from(int id) { return topology == FANIN ? (uint16_t)(id - 1) : 0; }
+
+/** Return whether a federate has a timer at whose ticks it sends messages. */
+static bool sends_on_timer(int id, int num_upstreams) { return num_upstreams == 0 || (topology == CYCLE && id == 0); }
+
+/** Return whether a federate records the latency of the messages it receives rather than forwarding them. */
+static bool records_latency(int id, int num_downstreams) {
+  return num_downstreams == 0 || (topology == CYCLE && id == 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//// The federate.
+
+static int federate_id;
+static uint16_t rti_port;
+static uint16_t upstreams[NUMBER_OF_FEDERATES];
+static uint16_t downstreams[NUMBER_OF_FEDERATES];
+static int num_upstreams;
+static int num_downstreams;
+static bool recording;
+
+static environment_t env;
+/** The reactor of the timer and of the port absent reaction. */
+static self_base_t self;
+/** The network receiver reactor of each input port. */
+static self_base_t receivers[NUMBER_OF_FEDERATES];
+static trigger_t timer;
+static reaction_t tick_reaction;
+static reaction_t* timer_reactions[] = {&tick_reaction};
+static trigger_t input_triggers[NUMBER_OF_FEDERATES];
+static lf_action_base_t inputs[NUMBER_OF_FEDERATES];
+/** The fields of the input ports that the runtime resets at each tag, which are not otherwise used here. */
+static bool inputs_present[NUMBER_OF_FEDERATES];
+#ifdef FEDERATED_DECENTRALIZED
+static tag_t inputs_intended_tag[NUMBER_OF_FEDERATES];
+#endif
+static reaction_t receive_reactions[NUMBER_OF_FEDERATES];
+static reaction_t absent_reaction;
+
+/** The payload of the messages sent at the ticks of the timer. */
+static unsigned char* payload;
+
+/** The tag at which the federate last sent messages. */
+static tag_t last_sent_tag;
+
+/** The latencies recorded so far, of which there is room for latencies_capacity. */
+static interval_t* latencies;
+static int64_t latencies_capacity;
+static int64_t received = 0;
+static int64_t tardy = 0;
+static int64_t tags_completed = 0;
+static instant_t last_completion;
+
+////////////////////////////////////////////////////////////////////
+//// Code-generated variables and functions.
+
+lf_action_base_t* _lf_action_table[NUMBER_OF_FEDERATES];
+interval_t _lf_action_delay_table[NUMBER_OF_FEDERATES];
+size_t _lf_action_table_size = 0;
+lf_action_base_t* _lf_zero_delay_cycle_action_table[NUMBER_OF_FEDERATES];
+size_t _lf_zero_delay_cycle_action_table_size = 0;
+reaction_t* network_input_reactions[NUMBER_OF_FEDERATES];
+size_t num_network_input_reactions = 0;
+reaction_t* port_absent_reaction[1];
+size_t num_port_absent_reactions = 0;
+#ifdef FEDERATED_DECENTRALIZED
+static staa_t staa;
+staa_t* staa_lst[1];
+size_t staa_lst_size = 0;
+#endif
+
+void lf_set_default_command_line_options(void) {}
+
+void lf_create_environments(void) {
+  static char name[32];
+  snprintf(name, sizeof(name), "federate__%d", federate_id);
+  environment_init(&env, name, 0, (int)_lf_number_of_workers, sends_on_timer(federate_id, num_upstreams) ? 1 : 0,
+                   num_downstreams > 0 ? 1 : 0, 0, 0, num_upstreams, 0, 0, 0, NULL);
+}
+
+int _lf_get_environments(environment_t** environments) {
+  *environments = &env;
+  return 1;
+}
+
+void logical_tag_complete(tag_t tag_to_send) {
+  lf_latest_tag_confirmed(tag_to_send);
+  tags_completed++;
+  last_completion = lf_time_physical();
+}
+
+void lf_send_neighbor_structure_to_RTI(net_abstraction_t net) {
+  size_t length = MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE + num_upstreams * (sizeof(uint16_t) + sizeof(int64_t)) +
+                  num_downstreams * sizeof(uint16_t);
+  unsigned char* buffer = (unsigned char*)malloc(length);
+  LF_ASSERT_NON_NULL(buffer);
+  buffer[0] = MSG_TYPE_NEIGHBOR_STRUCTURE;
+  encode_int32(num_upstreams, &buffer[1]);
+  encode_int32(num_downstreams, &buffer[1 + sizeof(int32_t)]);
+  size_t head = MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE;
+  for (int i = 0; i < num_upstreams; i++) {
+    encode_uint16(upstreams[i], &buffer[head]);
+    head += sizeof(uint16_t);
+    encode_int64(NEVER, &buffer[head]);
+    head += sizeof(int64_t);
+  }
+  for (int i = 0; i < num_downstreams; i++) {
+    encode_uint16(downstreams[i], &buffer[head]);
+    head += sizeof(uint16_t);
+  }
+  write_to_net_fail_on_error(net, length, buffer, NULL, "Failed to send the neighbor structure to the RTI.");
+  free(buffer);
+}
+
+////////////////////////////////////////////////////////////////////
+//// The reactions.
+
+/** Send a message to each downstream federate at the current tag. */
+static void send_to_downstreams(size_t length, unsigned char* message) {
+#ifdef FEDERATED_DECENTRALIZED
+  int message_type = MSG_TYPE_P2P_TAGGED_MESSAGE;
+#else
+  int message_type = MSG_TYPE_TAGGED_MESSAGE;
+#endif
+  for (int i = 0; i < num_downstreams; i++) {
+    lf_send_tagged_message(&env, NEVER, message_type, port_from(federate_id), downstreams[i], "a downstream federate",
+                           length, message);
+  }
+  last_sent_tag = env.current_tag;
+}
+
+/** Send a message stamped with the current physical time. */
+static void tick(void* ignored) {
+  (void)ignored;
+  instant_t now = lf_time_physical();
+  memcpy(payload, &now, sizeof(now));
+  send_to_downstreams(payload_size, payload);
+}
+
+/** Record the latency of the message on the input port of a receiver or forward the message. */
+static void receive(void* receiver) {
+  instant_t now = lf_time_physical();
+  trigger_t* trigger = &input_triggers[(self_base_t*)receiver - receivers];
+  lf_token_t* token = trigger->tmplt.token;
+  if (lf_tag_compare(trigger->intended_tag, env.current_tag) < 0) {
+    __atomic_fetch_add(&tardy, 1, __ATOMIC_RELAXED);
+  }
+  if (!recording) {
+    send_to_downstreams(token->length, (unsigned char*)token->value);
+    return;
+  }
+  instant_t sent;
+  memcpy(&sent, token->value, sizeof(sent));
+  int64_t index = __atomic_fetch_add(&received, 1, __ATOMIC_RELAXED);
+  if (index < latencies_capacity) {
+    latencies[index] = now - sent;
+  }
+}
+
+/** Tell the downstream federates that there is no message at the current tag if none was sent. */
+static void send_absent(void* ignored) {
+  (void)ignored;
+  if (lf_tag_compare(last_sent_tag, env.current_tag) == 0) {
+    return;
+  }
+  for (int i = 0; i < num_downstreams; i++) {
+    lf_send_port_absent_to_federate(&env, NEVER, port_from(federate_id), downstreams[i]);
+  }
+}
+
+static void initialize_reaction(reaction_t* reaction, reaction_function_t function, void* reactor, int number,
+                                size_t level, const char* name) {
+  reaction->function = function;
+  reaction->self = reactor;
+  reaction->number = number;
+  reaction->index = (index_t)level;
+  reaction->status = inactive;
+  reaction->deadline = NEVER;
+  reaction->name = name;
+}
+
+static void initialize_trigger(trigger_t* trigger, reaction_t** reactions) {
+  trigger->reactions = reactions;
+  trigger->number_of_reactions = 1;
+  trigger->last_tag = NEVER_TAG;
+  trigger->last_known_status_tag = NEVER_TAG;
+  trigger->intended_tag = NEVER_TAG;
+  trigger->physical_time_of_arrival = NEVER;
+}
+
+void _lf_initialize_trigger_objects(void) {
+  // The timer reaction is at level 0. The port absent reaction follows the reactions that may send messages,
+  // which are the network receiver reactions of a federate that forwards messages and the timer reaction
+  // otherwise. In the cycle, this makes federate 0 send port absent messages before it blocks on its input.
+  size_t receive_level = recording && num_downstreams > 0 ? 2 : 1;
+  size_t absent_level = 3 - receive_level;
+  self.environment = &env;
+  if (sends_on_timer(federate_id, num_upstreams)) {
+    initialize_reaction(&tick_reaction, tick, &self, 0, 0, "tick");
+    initialize_trigger(&timer, timer_reactions);
+    timer.is_timer = true;
+    timer.offset = period;
+    timer.period = period;
+    env.timer_triggers[0] = &timer;
+  }
+  for (int i = 0; i < num_upstreams; i++) {
+    receivers[i].environment = &env;
+    initialize_reaction(&receive_reactions[i], receive, &receivers[i], 0, receive_level, "receive");
+    receive_reactions[i].is_an_input_reaction = true;
+    network_input_reactions[i] = &receive_reactions[i];
+    initialize_trigger(&input_triggers[i], &network_input_reactions[i]);
+    input_triggers[i].tmplt.type.element_size = 1;
+    inputs[i].tmplt.type.element_size = 1;
+    inputs[i].trigger = &input_triggers[i];
+    inputs[i].parent = &receivers[i];
+    inputs[i].source_id = upstreams[i];
+    _lf_action_table[i] = &inputs[i];
+    _lf_action_delay_table[i] = NEVER;
+    env.is_present_fields[i] = &inputs_present[i];
+#ifdef FEDERATED_DECENTRALIZED
+    env._lf_intended_tag_fields[i] = &inputs_intended_tag[i];
+#endif
+  }
+  _lf_action_table_size = (size_t)num_upstreams;
+  num_network_input_reactions = (size_t)num_upstreams;
+  if (topology == CYCLE) {
+    _lf_zero_delay_cycle_action_table[0] = _lf_action_table[0];
+    _lf_zero_delay_cycle_action_table_size = 1;
+  }
+  if (num_downstreams > 0) {
+    initialize_reaction(&absent_reaction, send_absent, &self, 1, absent_level, "send_absent");
+    port_absent_reaction[0] = &absent_reaction;
+    num_port_absent_reactions = 1;
+    // The runtime triggers the port absent reactions at each tag but the start tag.
+    env.startup_reactions[0] = &absent_reaction;
+  }
+#ifdef FEDERATED_DECENTRALIZED
+  staa.actions = _lf_action_table;
+  staa.num_actions = (size_t)num_upstreams;
+  staa.STAA = 0;
+  staa_lst[0] = &staa;
+  staa_lst_size = num_upstreams > 0 ? 1 : 0;
+#endif
+
+  static size_t num_reactions_per_level[3];
+  num_reactions_per_level[0] = 1;
+  num_reactions_per_level[receive_level] = (size_t)LF_MAX(num_upstreams, 1);
+  num_reactions_per_level[absent_level] = 1;
+  static sched_params_t sched_params = {.num_reactions_per_level = num_reactions_per_level,
+                                        .num_reactions_per_level_size = 3};
+  lf_sched_init(&env, env.num_workers, &sched_params);
+
+  // Join the federation.
+  _lf_my_fed_id = (uint16_t)federate_id;
+  _fed.has_upstream = num_upstreams > 0;
+  _fed.has_downstream = num_downstreams > 0;
+#ifdef FEDERATED_DECENTRALIZED
+  lf_set_fed_maxwait(sta);
+  _fed.number_of_inbound_p2p_connections = (size_t)num_upstreams;
+  _fed.number_of_outbound_p2p_connections = (size_t)num_downstreams;
+#endif
+  lf_connect_to_rti("localhost", rti_port);
+#ifdef FEDERATED_DECENTRALIZED
+  if (num_upstreams > 0) {
+    lf_create_server(0);
+    lf_thread_create(&_fed.inbound_p2p_handling_thread_id, lf_handle_p2p_connections_from_federates, &env);
+  }
+  for (int i = 0; i < num_downstreams; i++) {
+    lf_connect_to_federate_async(downstreams[i]);
+  }
+#endif
+}
+
+/** Write a buffer in full to a file descriptor, exiting on failure. */
+static void write_fully(int fd, const void* buffer, size_t length) {
+  const char* bytes = (const char*)buffer;
+  while (length > 0) {
+    ssize_t written = write(fd, bytes, length);
+    if (written <= 0) {
+      lf_print_error_and_exit("Failed to write the results of the federate.");
+    }
+    bytes += written;
+    length -= (size_t)written;
+  }
+}
+
+/** Run the federate and write its results on RESULTS_FD. */
+static int run_federate(const char* federation_id) {
+  num_upstreams = upstreams_of(federate_id, upstreams);
+  num_downstreams = downstreams_of(federate_id, downstreams);
+  recording = records_latency(federate_id, num_downstreams);
+  payload = (unsigned char*)calloc(1, payload_size);
+  LF_ASSERT_NON_NULL(payload);
+  latencies_capacity = recording ? num_messages * num_upstreams : 0;
+  latencies = (interval_t*)calloc(LF_MAX(latencies_capacity, 1), sizeof(interval_t));
+  LF_ASSERT_NON_NULL(latencies);
+  last_sent_tag = NEVER_TAG;
+
+  lf_set_federation_id(federation_id);
+  duration = period * num_messages;
+  fast = fast_mode;
+  // As in federates generated from Lingua Franca, wait for messages when the event queue is empty.
+  keepalive_specified = true;
+  const char* arguments[] = {"federation_bench"};
+  int result = lf_reactor_c_main(1, arguments);
+  if (result != 0) {
+    return result;
+  }
+
+  federate_result_t results = {.tags = tags_completed,
+                               .elapsed = last_completion - lf_time_start(),
+                               .received = LF_MIN(received, latencies_capacity),
+                               .tardy = tardy};
+  write_fully(RESULTS_FD, &results, sizeof(results));
+  write_fully(RESULTS_FD, latencies, (size_t)results.received * sizeof(interval_t));
+  close(RESULTS_FD);
+  free(latencies);
+  free(payload);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////
+//// The launcher.
+
+/** Return a port on which nothing listens on this host. */
+static uint16_t free_port(void) {
+  struct sockaddr_in address = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK), .sin_port = 0};
+  socklen_t length = sizeof(address);
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0 || bind(sock, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      getsockname(sock, (struct sockaddr*)&address, &length) != 0) {
+    lf_print_error_and_exit("Failed to find a free port.");
+  }
+  close(sock);
+  return ntohs(address.sin_port);
+}
+
+/** Start a program, discarding its standard output and, unless `results` is -1, passing it as RESULTS_FD. */
+static pid_t spawn(const char* program, const char* arguments[], int results) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  if (results >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, results, RESULTS_FD);
+  }
+  pid_t pid;
+  int result = posix_spawn(&pid, program, &actions, NULL, (char* const*)arguments, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (result != 0) {
+    lf_print_error_and_exit("Failed to start %s: %s.", program, strerror(result));
+  }
+  return pid;
+}
+
+/** Read a buffer in full from a file descriptor and return whether it could. */
+static bool read_fully(int fd, void* buffer, size_t length) {
+  char* bytes = (char*)buffer;
+  while (length > 0) {
+    ssize_t bytes_read = read(fd, bytes, length);
+    if (bytes_read <= 0) {
+      return false;
+    }
+    bytes += bytes_read;
+    length -= (size_t)bytes_read;
+  }
+  return true;
+}
+
+/** Set an environment variable of the processes to start to a number. */
+static void set_variable(const char* name, const char* format, ...) ATTRIBUTE_FORMAT_PRINTF(2, 3);
+static void set_variable(const char* name, const char* format, ...) {
+  char value[32];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(value, sizeof(value), format, args);
+  va_end(args);
+  setenv(name, value, 1);
+}
+
+static int compare_intervals(const void* a, const void* b) {
+  interval_t x = *(const interval_t*)a;
+  interval_t y = *(const interval_t*)b;
+  return (x > y) - (x < y);
+}
+
+/** Run the federation, with the arguments given to this program passed on to each federate process. */
+static int launch(int argc, const char* argv[]) {
+  uint16_t port = free_port();
+  char port_argument[16];
+  char federates_argument[16];
+  char federation_id[64];
+  snprintf(port_argument, sizeof(port_argument), "%u", port);
+  snprintf(federates_argument, sizeof(federates_argument), "%d", num_federates);
+  snprintf(federation_id, sizeof(federation_id), "federation_bench_%d", (int)getpid());
+  set_variable("LF_NET_DELAY", "%lld", (long long)emulated_delay);
+  set_variable("LF_NET_JITTER", "%lld", (long long)emulated_jitter);
+  set_variable("LF_NET_LOSS", "%g", emulated_loss);
+
+  const char* rti_arguments[] = {rti_program, "-n", federates_argument, "-p", port_argument, "-i", federation_id,
+                                 "-c",        "off", NULL};
+  instant_t start = lf_time_physical();
+  pid_t rti = spawn(rti_program, rti_arguments, -1);
+
+  // Each federate process gets its ID, the port of the RTI and the federation ID, followed by the arguments.
+  const char** arguments = (const char**)calloc((size_t)argc + 5, sizeof(char*));
+  pid_t* pids = (pid_t*)calloc(num_federates, sizeof(pid_t));
+  int* results = (int*)calloc(num_federates, sizeof(int));
+  LF_ASSERT_NON_NULL(arguments);
+  LF_ASSERT_NON_NULL(pids);
+  LF_ASSERT_NON_NULL(results);
+  arguments[0] = argv[0];
+  arguments[1] = "--federate";
+  arguments[3] = port_argument;
+  arguments[4] = federation_id;
+  memcpy(&arguments[5], &argv[1], (size_t)(argc - 1) * sizeof(char*));
+  for (int i = 0; i < num_federates; i++) {
+    char id_argument[16];
+    snprintf(id_argument, sizeof(id_argument), "%d", i);
+    arguments[2] = id_argument;
+    int fds[2];
+    if (pipe(fds) != 0) {
+      lf_print_error_and_exit("Failed to create a pipe.");
+    }
+    // Only the federate should have the writing end, so that the reading end sees its end.
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    pids[i] = spawn("/proc/self/exe", arguments, fds[1]);
+    close(fds[1]);
+    results[i] = fds[0];
+  }
+
+  // Collect the results of the federates.
+  double total_rate = 0.0;
+  double min_rate = 0.0;
+  int64_t total_tardy = 0;
+  int64_t count = 0;
+  int64_t expected = 0;
+  interval_t* all_latencies = NULL;
+  bool failed = false;
+  for (int i = 0; i < num_federates; i++) {
+    uint16_t neighbors[NUMBER_OF_FEDERATES];
+    if (records_latency(i, downstreams_of(i, neighbors))) {
+      expected += num_messages * upstreams_of(i, neighbors);
+    }
+    federate_result_t result;
+    if (!read_fully(results[i], &result, sizeof(result))) {
+      lf_print_error("Federate %d failed.", i);
+      failed = true;
+      close(results[i]);
+      continue;
+    }
+    all_latencies = (interval_t*)realloc(all_latencies, (size_t)LF_MAX(count + result.received, 1) * sizeof(interval_t));
+    LF_ASSERT_NON_NULL(all_latencies);
+    if (!read_fully(results[i], &all_latencies[count], (size_t)result.received * sizeof(interval_t))) {
+      lf_print_error_and_exit("Failed to read the latencies of federate %d.", i);
+    }
+    close(results[i]);
+    count += result.received;
+    total_tardy += result.tardy;
+    double rate = result.elapsed > 0 ? (double)result.tags * BILLION / (double)result.elapsed : 0.0;
+    total_rate += rate;
+    min_rate = i == 0 || rate < min_rate ? rate : min_rate;
+  }
+  for (int i = 0; i < num_federates; i++) {
+    int status;
+    if (waitpid(pids[i], &status, 0) != pids[i] || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      failed = true;
+    }
+  }
+  if (failed) {
+    kill(rti, SIGTERM);
+  }
+  int status;
+  struct rusage usage;
+  if (wait4(rti, &status, 0, &usage) != rti || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    failed = true;
+  }
+  interval_t elapsed = lf_time_physical() - start;
+  interval_t rti_cpu =
+      SEC(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + USEC(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+  if (failed) {
+    lf_print_error_and_exit("The federation failed.");
+  }
+
+#ifdef FEDERATED_DECENTRALIZED
+  const char* coordination = "decentralized";
+#else
+  const char* coordination = "centralized";
+#endif
+  printf("%s of %d federates, %s coordination: %lld messages of %zu bytes every %.3f ms%s\n",
+         topology_names[topology], num_federates, coordination, (long long)num_messages, payload_size,
+         (double)period / MSEC(1), fast_mode ? " in fast mode" : "");
+  printf("  Network: delay %.3f ms, jitter %.3f ms, loss %.2f%%\n", (double)emulated_delay / MSEC(1),
+         (double)emulated_jitter / MSEC(1), emulated_loss * 100.0);
+  printf("  Tags completed per second: %.0f per federate on average, %.0f in the slowest\n",
+         total_rate / num_federates, min_rate);
+  if (count > 0) {
+    qsort(all_latencies, (size_t)count, sizeof(interval_t), compare_intervals);
+    printf("  Latency of %lld of %lld messages: median %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+           (long long)count, (long long)expected, (double)all_latencies[count / 2] / 1e3,
+           (double)all_latencies[count * 90 / 100] / 1e3, (double)all_latencies[count * 99 / 100] / 1e3,
+           (double)all_latencies[count - 1] / 1e3);
+  }
+#ifdef FEDERATED_DECENTRALIZED
+  printf("  Tardy messages: %lld\n", (long long)total_tardy);
+#else
+  (void)total_tardy;
+#endif
+  printf("  RTI CPU time: %.1f ms, %.1f%% of %.3f s\n", (double)rti_cpu / MSEC(1),
+         100.0 * (double)rti_cpu / (double)elapsed, (double)elapsed / BILLION);
+
+  free(all_latencies);
+  free(results);
+  free(pids);
+  free(arguments);
+  return 0;
+}
+
+static int print_usage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s -b <RTI program> [-t pipeline|fanout|fanin|cycle] [-f <federates>] [-n <messages>]\n"
+          "       [-p <period>] [-s <payload size>] [-F] [-a <STA>] [-d <delay>] [-j <jitter>] [-l <loss>]\n",
+          program);
+  return 1;
+}
+
+int main(int argc, const char* argv[]) {
+  // A federate process gets its ID, the port of the RTI and the federation ID before the other arguments.
+  bool is_federate = argc > 4 && strcmp(argv[1], "--federate") == 0;
+  int first = is_federate ? 5 : 1;
+  for (int i = first; i < argc; i++) {
+    if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      rti_program = argv[++i];
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      i++;
+      int t = 0;
+      while (t <= CYCLE && strcmp(argv[i], topology_names[t]) != 0) {
+        t++;
+      }
+      if (t > CYCLE) {
+        return print_usage(argv[0]);
+      }
+      topology = (topology_t)t;
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      num_federates = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      num_messages = atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      period = (interval_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      payload_size = (size_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-F") == 0) {
+      fast_mode = true;
+    } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      sta = (interval_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      emulated_delay = (interval_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      emulated_jitter = (interval_t)atoll(argv[++i]);
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      emulated_loss = atof(argv[++i]);
+    } else {
+      return print_usage(argv[0]);
+    }
+  }
+  if (rti_program == NULL || num_federates < 2 || num_federates > NUMBER_OF_FEDERATES || num_messages <= 0 ||
+      period <= 0 || payload_size < sizeof(instant_t) || sta < 0 || emulated_delay < 0 || emulated_jitter < 0 ||
+      emulated_loss < 0.0 || emulated_loss > 1.0) {
+    fprintf(stderr,
+            "There must be an RTI program, from 2 to %d federates, at least one message, a positive period, payloads "
+            "of at least %zu bytes and a loss between 0 and 1.\n",
+            NUMBER_OF_FEDERATES, sizeof(instant_t));
+    return 1;
+  }
+  if (is_federate) {
+    federate_id = atoi(argv[2]);
+    rti_port = (uint16_t)atoi(argv[3]);
+    return run_federate(argv[4]);
+  }
+  initialize_lf_thread_id();
+  return launch(argc, argv);
+}
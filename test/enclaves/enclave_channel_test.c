@@ -0,0 +1,189 @@
+/**
+ * @file enclave_channel_test.c
+ * @brief Test of the order and timing of tokens sent through an enclave channel.
+ *
+ * Two enclaves run the tag loop of the threaded runtime, each in its own thread. The first
+ * has an event at every nanosecond after the start time and, at each of these tags, sends the
+ * index of the tag through a channel to the second, which has no events of its own and checks
+ * that it receives the indices in order, each at the tag at which it was sent plus the delay.
+ * A small channel makes the sender wait for room, so the test only completes if the receiver
+ * wakes the sender when it takes tokens off the channel, and if it wakes it when it stops
+ * before the sender does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "enclave_channel.h"
+#include "environment.h"
+#include "lf_token.h"
+#include "low_level_platform.h"
+#include "reactor_common.h"
+#include "rti_local.h"
+#include "util.h"
+
+#define NUM_MESSAGES 20000
+
+// Global variables of the runtime.
+extern instant_t start_time;
+extern bool fast;
+
+// Forward declaration of function defined in reactor_threaded.c.
+void _lf_next_locked(environment_t* env);
+
+static interval_t delay;
+
+/** The two environments. The first sends to the second. */
+static environment_t envs[2];
+
+/** Trigger of the sender with an event at every tag. */
+static trigger_t tick;
+
+/** Trigger of the receiver to which the tokens are delivered. */
+static trigger_t input;
+
+static lf_enclave_channel_t* channel;
+
+/** Type of the payloads, freed with free(). */
+static token_type_t payload_type = {.element_size = 1};
+
+/** Number of tokens received so far. */
+static size_t received;
+
+////////////////////////////////////////////////////////////////////
+//// Code-generated functions that the stub does not define.
+
+static uint16_t upstream_of_receiver[] = {0};
+static uint16_t downstream_of_sender[] = {1};
+
+int lf_get_upstream_of(int enclave_id, uint16_t** result) {
+  *result = upstream_of_receiver;
+  return enclave_id == 1 ? 1 : 0;
+}
+
+int lf_get_downstream_of(int enclave_id, uint16_t** result) {
+  *result = downstream_of_sender;
+  return enclave_id == 0 ? 1 : 0;
+}
+
+int lf_get_upstream_delay_of(int enclave_id, interval_t** result) {
+  *result = &delay;
+  return enclave_id == 1 ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////
+//// The reactions of the two enclaves.
+
+static void send_index(environment_t* env) {
+  size_t* payload = (size_t*)malloc(sizeof(size_t));
+  LF_ASSERT_NON_NULL(payload);
+  *payload = (size_t)(env->current_tag.time - start_time - 1);
+  if (lf_enclave_channel_send(channel, lf_new_token(&payload_type, payload, sizeof(size_t))) != 0) {
+    lf_print_error_and_exit("Failed to send token %zu.", *payload);
+  }
+}
+
+static void receive_index(environment_t* env) {
+  if (input.status != present) {
+    return;
+  }
+  size_t index = *(size_t*)input.tmplt.token->value;
+  tag_t expected = lf_delay_tag((tag_t){.time = start_time + 1 + (instant_t)index, .microstep = 0}, delay);
+  if (index != received || lf_tag_compare(expected, env->current_tag) != 0) {
+    lf_print_error_and_exit("Token %zu received as token %zu at " PRINTF_TAG ".", index, received,
+                            env->current_tag.time - start_time, env->current_tag.microstep);
+  }
+  received++;
+}
+
+/** Run the tag loop of an enclave as its worker threads do, with the reactions above. */
+static void* run_enclave(void* arg) {
+  environment_t* env = (environment_t*)arg;
+  initialize_lf_thread_id();
+  LF_MUTEX_LOCK(&env->mutex);
+  rti_next_event_tag_locked(env->enclave_info, env->current_tag);
+  env->execution_started = true;
+  tag_t completed = NEVER_TAG;
+  _lf_next_locked(env);
+  while (true) {
+    if (lf_tag_compare(env->current_tag, completed) > 0 && lf_tag_compare(env->current_tag, env->stop_tag) <= 0) {
+      if (env->id == 0 && lf_tag_compare(env->current_tag, env->stop_tag) < 0) {
+        _lf_schedule_at_tag(env, &tick, lf_delay_tag(env->current_tag, 1), NULL);
+      }
+      LF_MUTEX_UNLOCK(&env->mutex);
+      if (env->id == 0) {
+        send_index(env);
+      } else {
+        receive_index(env);
+      }
+      LF_MUTEX_LOCK(&env->mutex);
+    }
+    completed = env->current_tag;
+    rti_logical_tag_complete_locked(env->enclave_info, completed);
+    if (lf_tag_compare(completed, env->stop_tag) >= 0) {
+      break;
+    }
+    _lf_next_locked(env);
+  }
+  rti_logical_tag_complete_locked(env->enclave_info, FOREVER_TAG);
+  _lf_enclave_channels_close(env);
+  LF_MUTEX_UNLOCK(&env->mutex);
+  return NULL;
+}
+
+/**
+ * @brief Send NUM_MESSAGES tokens through a channel and check that the receiver gets the expected ones.
+ * @param capacity The capacity of the channel.
+ * @param receiver_messages The number of tokens after which the receiver stops.
+ * @param free_sender_first Whether the sender releases the channel before the receiver.
+ */
+static void run(size_t capacity, size_t receiver_messages, bool free_sender_first) {
+  start_time = lf_time_physical();
+  for (int i = 0; i < 2; i++) {
+    environment_init(&envs[i], i == 0 ? "sender" : "receiver", i, 1, 0, 0, 0, 0, 1, 0, 0, 0, NULL);
+    environment_init_tags(&envs[i], start_time, (interval_t)NUM_MESSAGES);
+  }
+  envs[1].stop_tag = lf_delay_tag((tag_t){.time = start_time + (instant_t)receiver_messages, .microstep = 0}, delay);
+  tick = (trigger_t){.tmplt.type.element_size = 0};
+  input = (trigger_t){.tmplt.type.element_size = 1};
+  received = 0;
+  channel = lf_enclave_channel_new(&envs[0], &envs[1], &input, delay, capacity);
+  _lf_schedule_at_tag(&envs[0], &tick, lf_delay_tag(envs[0].start_tag, 1), NULL);
+  initialize_local_rti(envs, 2);
+
+  lf_thread_t threads[2];
+  for (int i = 0; i < 2; i++) {
+    if (lf_thread_create(&threads[i], run_enclave, &envs[i]) != 0) {
+      lf_print_error_and_exit("Failed to create the thread of enclave %d.", i);
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    lf_thread_join(threads[i], NULL);
+  }
+  if (received != receiver_messages) {
+    lf_print_error_and_exit("Received %zu of %zu tokens through a channel of capacity %zu.", received,
+                            receiver_messages, capacity);
+  }
+
+  free_local_rti();
+  // environment_free() would also free the scheduler, which is not used here.
+  _lf_enclave_channels_free(&envs[free_sender_first ? 0 : 1]);
+  _lf_enclave_channels_free(&envs[free_sender_first ? 1 : 0]);
+  _lf_replace_template_token(&input.tmplt, NULL);
+}
+
+int main() {
+  initialize_lf_thread_id();
+  fast = true;
+  interval_t delays[] = {NEVER, 0, 3};
+  for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+    delay = delays[i];
+    run(1, NUM_MESSAGES, true);
+    run(4, NUM_MESSAGES, false);
+    // The receiver stops first, leaving tokens on the channel, and the sender must not wait for room forever.
+    run(1, NUM_MESSAGES / 2, false);
+    run(4, NUM_MESSAGES / 2, true);
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file published_tags_test.c
+ * @brief Test of the sequence lock that guards the tags an enclave publishes in the lock-free local RTI.
+ *
+ * Writer threads publish tags as the local RTI does, some of them incrementing the NET, as an
+ * enclave that advances or one that sends it an event would, and one incrementing the LTC, while
+ * reader threads read the tags without locking. Every published tag has a microstep derived from
+ * its time, so a reader that got the time and the microstep from different writes sees a
+ * mismatch. The writers exclude each other, so no increment is lost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "low_level_platform.h"
+#include "published_tags.h"
+#include "util.h"
+
+#define NUM_NET_WRITERS 2
+#define NUM_READERS 2
+#define NUM_WRITES 2000000
+
+static published_tags_t published;
+
+/** Number of writers that have not finished. */
+static int writers_running;
+
+/** Return the microstep that goes with a time, which differs for consecutive times in most bits. */
+static microstep_t microstep_of(instant_t time) {
+  return (microstep_t)(((uint64_t)time * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static void* write_next_event(void* arg) {
+  (void)arg;
+  for (int i = 0; i < NUM_WRITES; i++) {
+    uint32_t sequence = begin_publishing(&published);
+    instant_t time = load_tag(&published.next_event_time, &published.next_event_microstep).time + 1;
+    store_tag(&published.next_event_time, &published.next_event_microstep,
+              (tag_t){.time = time, .microstep = microstep_of(time)});
+    end_publishing(&published, sequence);
+  }
+  __atomic_sub_fetch(&writers_running, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void* write_completed(void* arg) {
+  (void)arg;
+  for (int i = 0; i < NUM_WRITES; i++) {
+    uint32_t sequence = begin_publishing(&published);
+    instant_t time = load_tag(&published.completed_time, &published.completed_microstep).time + 1;
+    store_tag(&published.completed_time, &published.completed_microstep,
+              (tag_t){.time = time, .microstep = microstep_of(time)});
+    end_publishing(&published, sequence);
+  }
+  __atomic_sub_fetch(&writers_running, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void* read_tags(void* arg) {
+  size_t* reads = (size_t*)arg;
+  uint32_t last_sequence = 0;
+  tag_t last_next_event = {.time = 0, .microstep = 0};
+  tag_t last_completed = {.time = 0, .microstep = 0};
+  bool running = true;
+  while (running) {
+    // Read once more after the writers have finished, so that the final tags are checked too.
+    running = __atomic_load_n(&writers_running, __ATOMIC_ACQUIRE) > 0;
+    tag_t next_event;
+    tag_t completed;
+    uint32_t sequence = read_published(&published, &next_event, &completed);
+    if (next_event.microstep != microstep_of(next_event.time) || completed.microstep != microstep_of(completed.time)) {
+      lf_print_error_and_exit("Read a torn tag: NET (%lld, %u), LTC (%lld, %u).", (long long)next_event.time,
+                              next_event.microstep, (long long)completed.time, completed.microstep);
+    }
+    if ((sequence & 1u) || sequence < last_sequence || next_event.time < last_next_event.time ||
+        completed.time < last_completed.time) {
+      lf_print_error_and_exit("Read tags older than those read before, or while they were being written.");
+    }
+    last_sequence = sequence;
+    last_next_event = next_event;
+    last_completed = completed;
+    (*reads)++;
+  }
+  return NULL;
+}
+
+int main() {
+  writers_running = NUM_NET_WRITERS + 1;
+  lf_thread_t writers[NUM_NET_WRITERS + 1];
+  lf_thread_t readers[NUM_READERS];
+  size_t reads[NUM_READERS] = {0};
+  for (int i = 0; i < NUM_READERS; i++) {
+    LF_ASSERTN(lf_thread_create(&readers[i], read_tags, &reads[i]), "Could not create a reader thread.");
+  }
+  for (int i = 0; i < NUM_NET_WRITERS; i++) {
+    LF_ASSERTN(lf_thread_create(&writers[i], write_next_event, NULL), "Could not create a writer thread.");
+  }
+  LF_ASSERTN(lf_thread_create(&writers[NUM_NET_WRITERS], write_completed, NULL), "Could not create a writer thread.");
+  for (int i = 0; i < NUM_NET_WRITERS + 1; i++) {
+    lf_thread_join(writers[i], NULL);
+  }
+  for (int i = 0; i < NUM_READERS; i++) {
+    lf_thread_join(readers[i], NULL);
+  }
+
+  tag_t next_event = load_tag(&published.next_event_time, &published.next_event_microstep);
+  tag_t completed = load_tag(&published.completed_time, &published.completed_microstep);
+  if (next_event.time != (instant_t)NUM_NET_WRITERS * NUM_WRITES || completed.time != NUM_WRITES) {
+    lf_print_error_and_exit("Writers lost increments: NET %lld, LTC %lld.", (long long)next_event.time,
+                            (long long)completed.time);
+  }
+  if (published.sequence != 2u * (NUM_NET_WRITERS + 1) * NUM_WRITES) {
+    lf_print_error_and_exit("The sequence number is %u after %d writes.", published.sequence,
+                            (NUM_NET_WRITERS + 1) * NUM_WRITES);
+  }
+  for (int i = 0; i < NUM_READERS; i++) {
+    if (reads[i] == 0) {
+      lf_print_error_and_exit("A reader did not read the tags.");
+    }
+  }
+  return 0;
+}
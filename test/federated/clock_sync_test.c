@@ -0,0 +1,132 @@
+/**
+ * @file clock_sync_test.c
+ * @brief Test the model of the clock synchronization offset and the estimation of the drift of the local clock.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clock-sync.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+/** Number of times the offset is read while the model is being updated. */
+#define READS 1000000
+
+/** A time of the local clock far from 0, as that of a clock counting from the epoch. */
+#define EPOCH SEC(1700000000LL)
+
+/** Return the sample of an offset on a line with the given drift, plus an error. */
+static offset_sample_t on_line(interval_t time, double drift, interval_t error) {
+  return (offset_sample_t){.local_time = EPOCH + time, .offset = MSEC(3) + (interval_t)(drift * time) + error};
+}
+
+/** Fail if the estimated drift is not the expected one. */
+static void expect_drift(const offset_sample_t* samples, int count, double expected) {
+  double drift = clock_sync_estimate_drift(samples, count);
+  if (fabs(drift - expected) > 1e-12) {
+    lf_print_error_and_exit("Estimated a drift of %.6f ppm from %d samples instead of %.6f ppm.", drift * 1e6, count,
+                            expected * 1e6);
+  }
+}
+
+/** Check the least-squares estimation of the drift and its bound. */
+static void test_estimate_drift(void) {
+  offset_sample_t samples[8];
+  // Samples in the order of a ring buffer that has wrapped around.
+  for (int i = 0; i < 8; i++) {
+    samples[i] = on_line(SEC((i + 5) % 8), 50e-6, 0);
+  }
+  expect_drift(samples, 8, 50e-6);
+  expect_drift(samples, 1, 0.0);
+  expect_drift(samples, 0, 0.0);
+  // Samples all at the same time have no slope.
+  offset_sample_t same_time[] = {on_line(0, 0.0, 0), on_line(0, 0.0, USEC(5))};
+  expect_drift(same_time, 2, 0.0);
+
+  // Errors in the inner samples move the fitted line, although a line through the outer ones would not.
+  // The times relative to their mean are -1.5, -0.5, 0.5 and 1.5 seconds, so the slope moves by
+  // (-0.5 * 5000 - 0.5 * 5000) / 5 ns per second, which is -1 ppm.
+  offset_sample_t noisy[] = {on_line(0, 50e-6, 0), on_line(SEC(1), 50e-6, USEC(5)), on_line(SEC(2), 50e-6, -USEC(5)),
+                             on_line(SEC(3), 50e-6, 0)};
+  expect_drift(noisy, 4, 49e-6);
+
+  // The estimate is limited to CLOCK_SYNC_MAX_DRIFT_PPM.
+  double max_drift = CLOCK_SYNC_MAX_DRIFT_PPM / 1e6;
+  for (int i = 0; i < 8; i++) {
+    samples[i] = on_line(SEC(i), 2 * max_drift, 0);
+  }
+  expect_drift(samples, 8, max_drift);
+  for (int i = 0; i < 8; i++) {
+    samples[i] = on_line(SEC(i), -2 * max_drift, 0);
+  }
+  expect_drift(samples, 8, -max_drift);
+}
+
+/** Fail if the offset at the given time is not the expected one. */
+static void expect_offset(instant_t local_time, interval_t expected) {
+  interval_t offset = clock_sync_offset_at(local_time);
+  if (offset != expected) {
+    lf_print_error_and_exit("Offset at " PRINTF_TIME " is " PRINTF_TIME " instead of " PRINTF_TIME ".", local_time,
+                            offset, expected);
+  }
+}
+
+/** Check that the offset follows the model, and that the offsets added to and subtracted from times do too. */
+static void test_offset_model(void) {
+  clock_sync_set_offset_model(MSEC(1), EPOCH, 0.0);
+  expect_offset(EPOCH, MSEC(1));
+  expect_offset(EPOCH + SEC(100), MSEC(1));
+  clock_sync_set_offset_model(MSEC(1), EPOCH, 50e-6);
+  expect_offset(EPOCH, MSEC(1));
+  expect_offset(EPOCH + SEC(1), MSEC(1) + USEC(50));
+  expect_offset(EPOCH - SEC(2), MSEC(1) - USEC(100));
+
+  instant_t time = EPOCH + SEC(1);
+  clock_sync_add_offset(&time);
+  if (time != EPOCH + SEC(1) + MSEC(1) + USEC(50)) {
+    lf_print_error_and_exit("Added an offset of " PRINTF_TIME ".", time - EPOCH - SEC(1));
+  }
+  time = EPOCH + SEC(1);
+  clock_sync_subtract_offset(&time);
+  if (time != EPOCH + SEC(1) - MSEC(1) - USEC(50)) {
+    lf_print_error_and_exit("Subtracted an offset of " PRINTF_TIME ".", EPOCH + SEC(1) - time);
+  }
+}
+
+/** Whether the thread updating the model is done. */
+static volatile bool updates_done = false;
+
+/** Alternate between two models, which give different offsets at EPOCH + SEC(2) from any mix of their fields. */
+static void* update(void* ignored) {
+  (void)ignored;
+  while (!updates_done) {
+    clock_sync_set_offset_model(0, EPOCH, 1e-3);
+    clock_sync_set_offset_model(MSEC(10), EPOCH + SEC(1), 3e-3);
+  }
+  return NULL;
+}
+
+/** Check that the offset read while the model is being updated is that of one of the two models. */
+static void test_concurrent_reads(void) {
+  clock_sync_set_offset_model(0, EPOCH, 1e-3);
+  lf_thread_t updater;
+  lf_thread_create(&updater, update, NULL);
+  for (int i = 0; i < READS; i++) {
+    interval_t offset = clock_sync_offset_at(EPOCH + SEC(2));
+    if (offset != MSEC(2) && offset != MSEC(13)) {
+      lf_print_error_and_exit("Read an offset of " PRINTF_TIME " from a model being updated.", offset);
+    }
+  }
+  updates_done = true;
+  lf_thread_join(updater, NULL);
+  clock_sync_set_offset_model(0, 0, 0.0);
+}
+
+int main() {
+  test_estimate_drift();
+  test_offset_model();
+  test_concurrent_reads();
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "compression.h"
+#include "util.h"
+
+#define LENGTH 65536
+#define RANDOM_SEED 3301
+
+static unsigned char payload[LENGTH];
+static unsigned char decompressed[LENGTH];
+
+/**
+ * @brief Compress and decompress a payload, checking that it round trips.
+ * @return The compressed length, or 0 if the payload was not compressed.
+ */
+static size_t round_trip(size_t length) {
+  unsigned char* compressed = (unsigned char*)malloc(lf_compression_bound(length));
+  size_t compressed_length = 0;
+  if (lf_compress_payload(payload, length, compressed, &compressed_length) != 0) {
+    free(compressed);
+    return 0;
+  }
+  if (compressed_length >= length || !lf_compression_ratio_allowed(length, compressed_length)) {
+    lf_print_error_and_exit("Compressed %zu bytes to %zu bytes.", length, compressed_length);
+  }
+  memset(decompressed, 0, length);
+  if (lf_decompress_payload(compressed, compressed_length, decompressed, length) != 0 ||
+      memcmp(payload, decompressed, length) != 0) {
+    lf_print_error_and_exit("A payload of %zu bytes did not round trip.", length);
+  }
+  // A truncated payload or a wrong length is rejected rather than producing a short payload.
+  if (lf_decompress_payload(compressed, compressed_length / 2, decompressed, length) == 0 ||
+      lf_decompress_payload(compressed, compressed_length, decompressed, length - 1) == 0) {
+    lf_print_error_and_exit("A malformed compressed payload was accepted.");
+  }
+  free(compressed);
+  return compressed_length;
+}
+
+/**
+ * @brief Check that compressible payloads round trip and that incompressible ones are not compressed.
+ */
+void test_round_trip() {
+  // Text-like payload with a small alphabet and repeated words.
+  for (size_t i = 0; i < LENGTH; i++) {
+    payload[i] = (unsigned char)("lingua franca "[rand() % 14]);
+  }
+  if (round_trip(LENGTH) == 0) {
+    lf_print_error_and_exit("A compressible payload was not compressed.");
+  }
+  for (size_t i = 0; i < LENGTH; i++) {
+    payload[i] = (unsigned char)rand();
+  }
+  if (round_trip(LENGTH) != 0) {
+    lf_print_error_and_exit("An incompressible payload was compressed.");
+  }
+}
+
+/**
+ * @brief Check the bound on the ratio, which limits what a receiver allocates for a compressed payload.
+ */
+void test_ratio() {
+  if (!lf_compression_ratio_allowed(FEDERATED_COMPRESSION_MAX_RATIO * 100, 100) ||
+      lf_compression_ratio_allowed(FEDERATED_COMPRESSION_MAX_RATIO * 100 + 1, 100) ||
+      lf_compression_ratio_allowed(UINT32_MAX, 16) || lf_compression_ratio_allowed(100, 0)) {
+    lf_print_error_and_exit("The compression ratio is not bounded by FEDERATED_COMPRESSION_MAX_RATIO.");
+  }
+  // A payload that would shrink more than the bound allows is sent as is.
+  memset(payload, 'x', LENGTH);
+  size_t compressed_length = round_trip(LENGTH);
+  if (compressed_length != 0 && !lf_compression_ratio_allowed(LENGTH, compressed_length)) {
+    lf_print_error_and_exit("A payload was compressed beyond the bound on the ratio.");
+  }
+}
+
+int main() {
+  srand(RANDOM_SEED);
+  test_round_trip();
+  test_ratio();
+  return 0;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file connect_to_federate_test.c
+ * @brief Test the connections of a federate to other federates, one at a time and concurrently.
+ *
+ * The test plays the RTI, which answers the address queries of the federate, and two peer
+ * federates, each with a server of its own. lf_connect_to_federate() must return with the
+ * connection established. lf_connect_to_federate_async() must connect to both peers at once:
+ * peer 0 withholds its acknowledgment until peer 1 has been reached, which happens only if the
+ * connection to peer 1 does not wait for the connection to peer 0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+#if !defined(FEDERATED) || defined(LF_ENCLAVES) || NUMBER_OF_FEDERATES < 2
+int main() {
+  // The test plays the RTI and two peers for a federate with a single enclave.
+  return 0;
+}
+#else
+#include <arpa/inet.h>
+
+#include "federate.h"
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+
+/** Number of peer federates, which are federates 0 and 1. */
+#define PEERS 2
+
+/** How long peer 0 waits for peer 1 to be reached before acknowledging anyway. */
+#define REACH_TIMEOUT SEC(5)
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+extern federate_instance_t _fed;
+extern federation_metadata_t federation_metadata;
+
+/** The server on which the test plays the RTI. */
+static net_abstraction_t server;
+
+/** The connection of the RTI to the federate. */
+static net_abstraction_t rti_side;
+
+/** The servers of the peers, indexed by federate ID. */
+static net_abstraction_t peer_servers[PEERS];
+
+/** The connections of the federate to the peers, as accepted by the peers. */
+static net_abstraction_t peer_sides[PEERS];
+
+static lf_mutex_t mutex;
+static lf_cond_t changed;
+
+/** Whether the federate has identified itself to peer 1. */
+static bool reached_peer_1 = false;
+
+/** Whether peer 0 waits for peer 1 to be reached before acknowledging the federate. */
+static bool peer_0_waits = false;
+
+/** Accept the federate and complete its handshake. */
+static void* play_rti(void* ignored) {
+  (void)ignored;
+  net_abstraction_t net = accept_net(server);
+  LF_ASSERT_NON_NULL(net);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  read_from_net_fail_on_error(net, 2 + sizeof(uint16_t), buffer, "The RTI failed to read the federate IDs.");
+  read_from_net_fail_on_error(net, buffer[1 + sizeof(uint16_t)], &buffer[2 + sizeof(uint16_t)],
+                              "The RTI failed to read the federation ID.");
+  unsigned char ack = MSG_TYPE_ACK;
+  write_to_net_fail_on_error(net, 1, &ack, NULL, "The RTI failed to accept the federate.");
+  read_from_net_fail_on_error(net, MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE + 1 + sizeof(uint16_t), buffer,
+                              "The RTI failed to read the neighbors and UDP port.");
+  rti_side = net;
+  return NULL;
+}
+
+/** Answer the given number of address queries with the ports of the servers of the peers. */
+static void* answer_queries(void* count) {
+  for (intptr_t i = 0; i < (intptr_t)count; i++) {
+    unsigned char query[1 + sizeof(uint16_t)];
+    read_from_net_fail_on_error(rti_side, sizeof(query), query, "The RTI failed to read an address query.");
+    uint16_t id = extract_uint16(&query[1]);
+    if (query[0] != MSG_TYPE_ADDRESS_QUERY || id >= PEERS) {
+      lf_print_error_and_exit("Unexpected address query of type %u for federate %u.", query[0], id);
+    }
+    unsigned char reply[1 + sizeof(int32_t) + sizeof(struct in_addr)];
+    reply[0] = MSG_TYPE_ADDRESS_QUERY_REPLY;
+    encode_int32(get_my_port(peer_servers[id]), &reply[1]);
+    struct in_addr address = {.s_addr = htonl(INADDR_LOOPBACK)};
+    memcpy(&reply[1 + sizeof(int32_t)], &address, sizeof(address));
+    write_to_net_fail_on_error(rti_side, sizeof(reply), reply, NULL, "The RTI failed to answer an address query.");
+  }
+  return NULL;
+}
+
+/** Accept the connection of the federate to the peer with the given ID and acknowledge it. */
+static void* play_peer(void* id_arg) {
+  uint16_t id = (uint16_t)(uintptr_t)id_arg;
+  net_abstraction_t net = accept_net(peer_servers[id]);
+  LF_ASSERT_NON_NULL(net);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  read_from_net_fail_on_error(net, 2 + sizeof(uint16_t), buffer, "Peer %u failed to read the federate ID.", id);
+  read_from_net_fail_on_error(net, buffer[1 + sizeof(uint16_t)], &buffer[2 + sizeof(uint16_t)],
+                              "Peer %u failed to read the federation ID.", id);
+  if (buffer[0] != MSG_TYPE_P2P_SENDING_FED_ID || extract_uint16(&buffer[1]) != _lf_my_fed_id) {
+    lf_print_error_and_exit("Peer %u received an unexpected identification.", id);
+  }
+
+  bool concurrent = true;
+  LF_MUTEX_LOCK(&mutex);
+  if (id == 1) {
+    reached_peer_1 = true;
+    lf_cond_broadcast(&changed);
+  } else if (peer_0_waits) {
+    instant_t give_up = lf_time_physical() + REACH_TIMEOUT;
+    while (!reached_peer_1 && lf_time_physical() < give_up) {
+      _lf_cond_timedwait(&changed, give_up);
+    }
+    concurrent = reached_peer_1;
+  }
+  LF_MUTEX_UNLOCK(&mutex);
+
+  unsigned char ack = MSG_TYPE_ACK;
+  write_to_net_fail_on_error(net, 1, &ack, NULL, "Peer %u failed to acknowledge the federate.", id);
+#if defined(FEDERATED_COMPRESSION) && defined(FEDERATED_DECENTRALIZED)
+  // Decline the codec that the federate offers.
+  read_from_net_fail_on_error(net, 2, buffer, "Peer %u failed to read the codec of the federate.", id);
+  buffer[1] = COMPRESSION_CODEC_NONE;
+  write_to_net_fail_on_error(net, 2, buffer, NULL, "Peer %u failed to decline the codec.", id);
+#endif
+  peer_sides[id] = net;
+  return (void*)(intptr_t)concurrent;
+}
+
+/** Connect the federate to the RTI played by the test. */
+static void connect_federate(void) {
+  server = initialize_net();
+  set_my_port(server, 0);
+  if (create_server(server) != 0) {
+    lf_print_error_and_exit("Failed to create the server of the RTI.");
+  }
+  lf_thread_t rti_thread;
+  lf_thread_create(&rti_thread, play_rti, NULL);
+  lf_connect_to_rti("localhost", get_my_port(server));
+  lf_thread_join(rti_thread, NULL);
+}
+
+/** Close the connections of the federate to the peers. */
+static void disconnect_peers(void) {
+  for (int i = 0; i < PEERS; i++) {
+    shutdown_net(_fed.net_for_outbound_p2p_connections[i], false);
+    _fed.net_for_outbound_p2p_connections[i] = NULL;
+    shutdown_net(peer_sides[i], false);
+    peer_sides[i] = NULL;
+  }
+}
+
+/** Check that lf_connect_to_federate() returns once the connection is established. */
+static void test_connect(void) {
+  lf_thread_t rti_thread, peer_thread;
+  lf_thread_create(&rti_thread, answer_queries, (void*)1);
+  lf_thread_create(&peer_thread, play_peer, (void*)1);
+  lf_connect_to_federate(1);
+  if (_fed.net_for_outbound_p2p_connections[1] == NULL || _fed.number_of_outbound_p2p_connection_threads != 0) {
+    lf_print_error_and_exit("lf_connect_to_federate() returned before connecting.");
+  }
+  lf_thread_join(peer_thread, NULL);
+  lf_thread_join(rti_thread, NULL);
+  disconnect_peers();
+}
+
+/** Check that lf_connect_to_federate_async() connects to several federates at once. */
+static void test_connect_async(void) {
+  peer_0_waits = true;
+  reached_peer_1 = false;
+  lf_thread_t rti_thread, peer_threads[PEERS];
+  lf_thread_create(&rti_thread, answer_queries, (void*)PEERS);
+  for (int i = 0; i < PEERS; i++) {
+    lf_thread_create(&peer_threads[i], play_peer, (void*)(uintptr_t)i);
+  }
+  // Peer 0 holds up the first connection until the second one reaches peer 1.
+  lf_connect_to_federate_async(0);
+  lf_connect_to_federate_async(1);
+  lf_wait_for_connections_to_federates();
+  for (int i = 0; i < PEERS; i++) {
+    void* concurrent;
+    lf_thread_join(peer_threads[i], &concurrent);
+    if (!(intptr_t)concurrent) {
+      lf_print_error_and_exit("The federate connected to federate 1 only after federate 0.");
+    }
+    if (_fed.net_for_outbound_p2p_connections[i] == NULL) {
+      lf_print_error_and_exit("The federate is not connected to federate %d after waiting for its connections.", i);
+    }
+  }
+  if (_fed.number_of_outbound_p2p_connection_threads != 0) {
+    lf_print_error_and_exit("The threads of the connections were not all joined.");
+  }
+  lf_thread_join(rti_thread, NULL);
+  disconnect_peers();
+}
+
+int main() {
+  initialize_lf_thread_id();
+  _lf_my_fed_id = 0;
+  _env.name = "federate__test";
+  // Each connection started by lf_connect_to_federate_async() has a thread with an ID of its own.
+  lf_tracing_global_init(_env.name, NULL, 0, 16);
+  LF_MUTEX_INIT(&lf_outbound_net_mutex);
+  LF_MUTEX_INIT(&mutex);
+  LF_COND_INIT(&changed, &mutex);
+  federation_metadata.federation_id = "connect_to_federate_test";
+  for (int i = 0; i < PEERS; i++) {
+    peer_servers[i] = initialize_net();
+    set_my_port(peer_servers[i], 0);
+    if (create_server(peer_servers[i]) != 0) {
+      lf_print_error_and_exit("Failed to create the server of peer %d.", i);
+    }
+  }
+
+  connect_federate();
+  test_connect();
+  test_connect_async();
+
+  shutdown_net(_fed.net_to_RTI, false);
+  shutdown_net(rti_side, false);
+  shutdown_net(server, false);
+  for (int i = 0; i < PEERS; i++) {
+    shutdown_net(peer_servers[i], false);
+  }
+  lf_tracing_global_shutdown();
+  return 0;
+}
+#endif // FEDERATED && !LF_ENCLAVES && NUMBER_OF_FEDERATES >= 2
@@ -0,0 +1,203 @@
+/**
+ * @file next_message_request_test.c
+ * @brief Test the next message requests (NMRs) of a federate and their negotiation with the RTI.
+ *
+ * The test plays the RTI on a connection from the federate. It checks that a latest tag confirmed
+ * (LTC) waits for the next event tag (NET) and goes out with it in an NMR, that it goes out by itself
+ * when no NET follows, that a later LTC replaces a pending one, and that an LTC sent while stopping
+ * is not followed by an earlier one. If the RTI rejects the offer of NMRs, the federate connects
+ * again and sends its LTCs and NETs separately.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+#include "federate.h"
+#include "low_level_platform.h"
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "util.h"
+
+#if !defined(FEDERATED_CENTRALIZED) || defined(LF_ENCLAVES)
+int main() {
+  // A federate defers its LTCs only under centralized coordination without enclaves.
+  return 0;
+}
+#else
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+extern federate_instance_t _fed;
+extern federation_metadata_t federation_metadata;
+
+/** The server on which the test plays the RTI. */
+static net_abstraction_t server;
+
+/** The connection of the RTI to the federate. */
+static net_abstraction_t rti_side;
+
+/** Whether the RTI rejects the offer of NMRs as an RTI that predates them would. */
+static bool reject_offer;
+
+/** Read the identification of the federate, returning its message type. */
+static unsigned char read_ids(net_abstraction_t net) {
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  read_from_net_fail_on_error(net, 2 + sizeof(uint16_t), buffer, "The RTI failed to read the federate IDs.");
+  read_from_net_fail_on_error(net, buffer[1 + sizeof(uint16_t)], &buffer[2 + sizeof(uint16_t)],
+                              "The RTI failed to read the federation ID.");
+  return buffer[0];
+}
+
+/** Accept the federate and read the rest of its handshake. */
+static void* play_rti(void* ignored) {
+  (void)ignored;
+  net_abstraction_t net = accept_net(server);
+  LF_ASSERT_NON_NULL(net);
+  unsigned char type = read_ids(net);
+  if (type != MSG_TYPE_FED_IDS_NMR) {
+    lf_print_error_and_exit("The federate did not offer NMRs. Got message type %u.", type);
+  }
+  if (reject_offer) {
+    unsigned char reject[] = {MSG_TYPE_REJECT, UNEXPECTED_MESSAGE};
+    write_to_net_fail_on_error(net, sizeof(reject), reject, NULL, "The RTI failed to reject the federate.");
+    shutdown_net(net, false);
+    net = accept_net(server);
+    LF_ASSERT_NON_NULL(net);
+    type = read_ids(net);
+    if (type != MSG_TYPE_FED_IDS) {
+      lf_print_error_and_exit("The federate offered NMRs again. Got message type %u.", type);
+    }
+  }
+  unsigned char ack = MSG_TYPE_ACK;
+  write_to_net_fail_on_error(net, 1, &ack, NULL, "The RTI failed to accept the federate.");
+  unsigned char buffer[MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE + 1 + sizeof(uint16_t)];
+  read_from_net_fail_on_error(net, sizeof(buffer), buffer, "The RTI failed to read the neighbors and UDP port.");
+  if (buffer[0] != MSG_TYPE_NEIGHBOR_STRUCTURE ||
+      buffer[MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE] != MSG_TYPE_UDP_PORT) {
+    lf_print_error_and_exit("Unexpected handshake from the federate.");
+  }
+  rti_side = net;
+  return NULL;
+}
+
+/** Connect the federate to the RTI played by the test. */
+static void connect_federate(uint16_t port, bool reject) {
+  reject_offer = reject;
+  lf_thread_t rti_thread;
+  lf_thread_create(&rti_thread, play_rti, NULL);
+  lf_connect_to_rti("localhost", port);
+  lf_thread_join(rti_thread, NULL);
+  if (_fed.RTI_accepts_NMR == reject) {
+    lf_print_error_and_exit("The federate %s NMRs.", reject ? "sends" : "does not send");
+  }
+}
+
+/** Return the tag at the given time. */
+static tag_t at(instant_t time) { return (tag_t){.time = time, .microstep = 0}; }
+
+/** Read the next message from the federate and check that it is of the given type and carries the given tags. */
+static void expect(unsigned char type, tag_t first, tag_t second) {
+  unsigned char buffer[MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH];
+  size_t length = type == MSG_TYPE_NEXT_MESSAGE_REQUEST ? MSG_TYPE_NEXT_MESSAGE_REQUEST_LENGTH
+                                                        : 1 + sizeof(instant_t) + sizeof(microstep_t);
+  read_from_net_fail_on_error(rti_side, length, buffer, "The RTI failed to read a message of type %u.", type);
+  tag_t tag = extract_tag(&buffer[1]);
+  if (buffer[0] != type || lf_tag_compare(tag, first) != 0) {
+    lf_print_error_and_exit("Expected message type %u with time " PRINTF_TIME ". Got %u with time " PRINTF_TIME ".",
+                            type, first.time, buffer[0], tag.time);
+  }
+  if (type == MSG_TYPE_NEXT_MESSAGE_REQUEST &&
+      lf_tag_compare(extract_tag(&buffer[1 + sizeof(instant_t) + sizeof(microstep_t)]), second) != 0) {
+    lf_print_error_and_exit("NMR with LTC time " PRINTF_TIME " has the wrong NET.", first.time);
+  }
+}
+
+/** Send a NET without waiting for a grant, as _lf_next_locked() does before waiting. */
+static void advance_to(instant_t time) { lf_send_next_event_tag(&_env, at(time), false); }
+
+/** Check the LTCs and NETs sent to an RTI that accepts NMRs. */
+static void test_deferred_LTC(void) {
+  _fed.has_downstream = true;
+  // An LTC waits for the NET that follows it.
+  lf_latest_tag_confirmed(at(10));
+  advance_to(20);
+  expect(MSG_TYPE_NEXT_MESSAGE_REQUEST, at(10), at(20));
+
+  // A later LTC replaces a pending one, which it confirms too.
+  lf_latest_tag_confirmed(at(20));
+  lf_latest_tag_confirmed(at(30));
+  advance_to(40);
+  expect(MSG_TYPE_NEXT_MESSAGE_REQUEST, at(30), at(40));
+
+  // Without a pending LTC, a NET goes out by itself.
+  advance_to(50);
+  expect(MSG_TYPE_NEXT_EVENT_TAG, at(50), NEVER_TAG);
+
+  // If no downstream federate needs the NET, the LTC goes out by itself.
+  _fed.received_any_DNET = true;
+  _fed.last_DNET = at(100);
+  lf_latest_tag_confirmed(at(60));
+  advance_to(70);
+  expect(MSG_TYPE_LATEST_TAG_CONFIRMED, at(60), NEVER_TAG);
+  _fed.received_any_DNET = false;
+  _fed.last_DNET = NEVER_TAG;
+
+  // An LTC at the stop tag goes out at once, and the pending LTC that it confirms never follows it.
+  lf_latest_tag_confirmed(at(80));
+  _env.stop_tag = at(90);
+  lf_latest_tag_confirmed(at(90));
+  expect(MSG_TYPE_LATEST_TAG_CONFIRMED, at(90), NEVER_TAG);
+  _env.stop_tag = FOREVER_TAG;
+  advance_to(100);
+  expect(MSG_TYPE_NEXT_EVENT_TAG, at(100), NEVER_TAG);
+
+  // A federate without neighbors sends no NET, so its LTC goes out by itself.
+  _fed.has_downstream = false;
+  lf_latest_tag_confirmed(at(110));
+  advance_to(120);
+  expect(MSG_TYPE_LATEST_TAG_CONFIRMED, at(110), NEVER_TAG);
+}
+
+/** Check the LTCs and NETs sent to an RTI that rejected the offer of NMRs. */
+static void test_fallback(void) {
+  _fed.has_downstream = true;
+  lf_latest_tag_confirmed(at(210));
+  advance_to(220);
+  expect(MSG_TYPE_LATEST_TAG_CONFIRMED, at(210), NEVER_TAG);
+  expect(MSG_TYPE_NEXT_EVENT_TAG, at(220), NEVER_TAG);
+  _fed.has_downstream = false;
+}
+
+int main() {
+  initialize_lf_thread_id();
+  _lf_my_fed_id = 0;
+  _env.name = "federate__test";
+  lf_tracing_global_init(_env.name, NULL, 0, 2);
+  LF_MUTEX_INIT(&_env.mutex);
+  _env.need_to_send_LTC = true;
+  _env.stop_tag = FOREVER_TAG;
+  federation_metadata.federation_id = "next_message_request_test";
+  server = initialize_net();
+  set_my_port(server, 0);
+  if (create_server(server) != 0) {
+    lf_print_error_and_exit("Failed to create the server of the RTI.");
+  }
+  uint16_t port = (uint16_t)get_my_port(server);
+
+  connect_federate(port, false);
+  test_deferred_LTC();
+  shutdown_net(_fed.net_to_RTI, false);
+  shutdown_net(rti_side, false);
+
+  connect_federate(port, true);
+  test_fallback();
+  shutdown_net(_fed.net_to_RTI, false);
+  shutdown_net(rti_side, false);
+  shutdown_net(server, false);
+  lf_tracing_global_shutdown();
+  return 0;
+}
+#endif // FEDERATED_CENTRALIZED && !LF_ENCLAVES
@@ -0,0 +1,329 @@
+/**
+ * @file p2p_batch_test.c
+ * @brief Test batches of tagged messages and port absent messages sent directly to a federate.
+ *
+ * The federate sends to itself: the test connects to the server of the federate as a peer and
+ * uses that connection as the outbound connection of the federate. Messages and port absent
+ * messages for several ports at several tags go through the send path, which batches them,
+ * and come back through the listener of the federate, which schedules the messages and updates
+ * the status of the ports. Batches whose lengths do not match their entries or whose entries are
+ * of an unknown type are then written by hand, and the listener must close the connection
+ * without scheduling anything. A federate connects to other federates only after it has
+ * connected to the RTI, so the test plays the RTI for the handshake.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+#if !defined(FEDERATED_DECENTRALIZED) || !defined(FEDERATED_P2P_BATCH_SIZE) || defined(LF_ENCLAVES)
+int main() {
+  // Only federates under decentralized coordination batch the messages they send to other federates.
+  return 0;
+}
+#else
+#include "federate.h"
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "socket_common.h"
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+extern federate_instance_t _fed;
+extern federation_metadata_t federation_metadata;
+extern lf_action_base_t* _lf_action_table[];
+extern size_t _lf_action_table_size;
+
+/** Number of network input ports of the federate. */
+#define PORTS 3
+
+/** The network input ports of the federate, each of which receives from the federate itself. */
+static lf_action_base_t ports[PORTS];
+static trigger_t triggers[PORTS];
+static reaction_t reaction;
+static reaction_t* reactions[] = {&reaction};
+
+/** The server on which the test plays the RTI. */
+static net_abstraction_t server;
+
+/** The connection of the RTI to the federate. */
+static net_abstraction_t rti_side;
+
+/** Accept the federate and complete its handshake. */
+static void* play_rti(void* ignored) {
+  (void)ignored;
+  net_abstraction_t net = accept_net(server);
+  LF_ASSERT_NON_NULL(net);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  read_from_net_fail_on_error(net, 2 + sizeof(uint16_t), buffer, "The RTI failed to read the federate IDs.");
+  read_from_net_fail_on_error(net, buffer[1 + sizeof(uint16_t)], &buffer[2 + sizeof(uint16_t)],
+                              "The RTI failed to read the federation ID.");
+  unsigned char ack = MSG_TYPE_ACK;
+  write_to_net_fail_on_error(net, 1, &ack, NULL, "The RTI failed to accept the federate.");
+  read_from_net_fail_on_error(net, MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE + 1 + sizeof(uint16_t), buffer,
+                              "The RTI failed to read the neighbors and UDP port.");
+  rti_side = net;
+  return NULL;
+}
+
+/** Connect the federate to the RTI played by the test and start its server for other federates. */
+static void connect_federate(void) {
+  server = initialize_net();
+  set_my_port(server, 0);
+  if (create_server(server) != 0) {
+    lf_print_error_and_exit("Failed to create the server of the RTI.");
+  }
+  lf_thread_t rti_thread;
+  lf_thread_create(&rti_thread, play_rti, NULL);
+  lf_connect_to_rti("localhost", get_my_port(server));
+  lf_thread_join(rti_thread, NULL);
+  lf_create_server(0);
+  unsigned char advertisement[1 + sizeof(int32_t)];
+  read_from_net_fail_on_error(rti_side, sizeof(advertisement), advertisement,
+                              "The RTI failed to read the address advertisement.");
+}
+
+/**
+ * Connect to the federate as federate 0 and wait for the federate to start listening to the
+ * connection. Return the connection.
+ */
+static net_abstraction_t connect_peer(void) {
+  _fed.number_of_inbound_p2p_connections = 1;
+  lf_thread_t accept_thread;
+  lf_thread_create(&accept_thread, lf_handle_p2p_connections_from_federates, &_env);
+  socket_connection_params_t params = {
+      .type = TCP, .port = (uint16_t)get_my_port(_fed.server_net), .server_hostname = "localhost"};
+  net_abstraction_t net = connect_to_net((net_params_t)&params);
+  LF_ASSERT_NON_NULL(net);
+  size_t federation_id_length = strlen(federation_metadata.federation_id);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  buffer[0] = MSG_TYPE_P2P_SENDING_FED_ID;
+  encode_uint16(0, &buffer[1]);
+  buffer[1 + sizeof(uint16_t)] = (unsigned char)federation_id_length;
+  memcpy(&buffer[2 + sizeof(uint16_t)], federation_metadata.federation_id, federation_id_length);
+  write_to_net_fail_on_error(net, 2 + sizeof(uint16_t) + federation_id_length, buffer, NULL,
+                             "Failed to send the federate ID.");
+  read_from_net_fail_on_error(net, 1, buffer, "Failed to read the response of the federate.");
+  if (buffer[0] != MSG_TYPE_ACK) {
+    lf_print_error_and_exit("The federate rejected the connection.");
+  }
+  lf_thread_join(accept_thread, NULL);
+  return net;
+}
+
+/** Return the last known status tag of the given port, reading it under the lock of the environment. */
+static tag_t status_of(int port) {
+  LF_MUTEX_LOCK(&_env.mutex);
+  tag_t tag = triggers[port].last_known_status_tag;
+  LF_MUTEX_UNLOCK(&_env.mutex);
+  return tag;
+}
+
+/** Wait for the listener of the federate to close its connection, failing if it does not within a second. */
+static void expect_closed(const char* description) {
+  for (int i = 0; is_net_open(_fed.net_for_inbound_p2p_connections[0]); i++) {
+    if (i == 1000) {
+      lf_print_error_and_exit("The federate accepted %s.", description);
+    }
+    lf_sleep(MSEC(1));
+  }
+  lf_thread_join(_fed.inbound_net_listeners[0], NULL);
+  free(_fed.inbound_net_listeners);
+}
+
+/** A message or port absent message expected at a port. */
+typedef struct expected_t {
+  int port;
+  /** The delay after the current tag with which the message is sent. */
+  interval_t delay;
+  tag_t tag;
+  /** The payload of a message, or NULL for a port absent message. */
+  const char* payload;
+  size_t length;
+  bool found;
+} expected_t;
+
+/** Check that the event queue holds exactly an event for each of the expected messages. */
+static void expect_events(expected_t* expected, size_t count) {
+  size_t messages = 0;
+  for (size_t i = 0; i < count; i++) {
+    messages += expected[i].payload != NULL;
+  }
+  LF_MUTEX_LOCK(&_env.mutex);
+  if (pqueue_tag_size(_env.event_q) != messages) {
+    lf_print_error_and_exit("Scheduled %zu events for %zu messages.", pqueue_tag_size(_env.event_q), messages);
+  }
+  for (event_t* event = (event_t*)pqueue_tag_pop(_env.event_q); event != NULL;
+       event = (event_t*)pqueue_tag_pop(_env.event_q)) {
+    expected_t* match = NULL;
+    for (size_t i = 0; i < count && match == NULL; i++) {
+      if (expected[i].payload != NULL && !expected[i].found && event->trigger == &triggers[expected[i].port] &&
+          lf_tag_compare(event->base.tag, expected[i].tag) == 0) {
+        match = &expected[i];
+      }
+    }
+    if (match == NULL) {
+      lf_print_error_and_exit("Scheduled an unexpected event at " PRINTF_TAG ".", event->base.tag.time,
+                              event->base.tag.microstep);
+    }
+    if (event->token->length != match->length || memcmp(event->token->value, match->payload, match->length) != 0) {
+      lf_print_error_and_exit("The message to port %d at " PRINTF_TAG " has the wrong payload.", match->port,
+                              match->tag.time, match->tag.microstep);
+    }
+    match->found = true;
+  }
+  LF_MUTEX_UNLOCK(&_env.mutex);
+}
+
+/**
+ * Check that messages and port absent messages for several ports at several tags, sent in
+ * batches and in a message too large for a batch, arrive with their payloads and tags.
+ */
+static void test_round_trip(void) {
+  net_abstraction_t net = connect_peer();
+  _fed.net_for_outbound_p2p_connections[0] = net;
+
+  char large[FEDERATED_P2P_BATCH_SIZE];
+  memset(large, 'x', sizeof(large));
+  expected_t expected[] = {
+      // A batch with a message, a port absent message, and a message to another port.
+      {0, 0, lf_delay_tag(_env.current_tag, 0), "a", 1, false},
+      {1, 0, lf_delay_strict(_env.current_tag, 0), NULL, 0, false},
+      {2, 0, lf_delay_tag(_env.current_tag, 0), "bc", 2, false},
+      // A batch for a later tag.
+      {0, MSEC(1), lf_delay_tag(_env.current_tag, MSEC(1)), "def", 3, false},
+      // A message too large for a batch, which is sent after the batches before it.
+      {1, MSEC(3), lf_delay_tag(_env.current_tag, MSEC(3)), large, sizeof(large), false},
+      // A batch with only a port absent message.
+      {2, MSEC(5), lf_delay_strict(_env.current_tag, MSEC(5)), NULL, 0, false},
+  };
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    unsigned short port = (unsigned short)expected[i].port;
+    if (expected[i].payload == NULL) {
+      lf_send_port_absent_to_federate(&_env, expected[i].delay, port, 0);
+    } else if (lf_send_tagged_message(&_env, expected[i].delay, MSG_TYPE_P2P_TAGGED_MESSAGE, port, 0, "federate 0",
+                                      expected[i].length, (unsigned char*)expected[i].payload) != 0) {
+      lf_print_error_and_exit("Failed to send the message to port %d.", expected[i].port);
+    }
+  }
+  LF_MUTEX_LOCK(&_env.mutex);
+  lf_send_batched_messages_locked(&_env);
+  LF_MUTEX_UNLOCK(&_env.mutex);
+
+  // The last port absent message arrives last.
+  tag_t last = expected[5].tag;
+  for (int i = 0; lf_tag_compare(status_of(2), last) != 0; i++) {
+    if (i == 1000) {
+      lf_print_error_and_exit("The port absent message sent last did not arrive.");
+    }
+    lf_sleep(MSEC(1));
+  }
+  if (lf_tag_compare(status_of(0), expected[3].tag) != 0 || lf_tag_compare(status_of(1), expected[4].tag) != 0) {
+    lf_print_error_and_exit("The status of the ports does not follow the messages sent to them.");
+  }
+  expect_events(expected, sizeof(expected) / sizeof(expected[0]));
+
+  shutdown_net(net, false);
+  _fed.net_for_outbound_p2p_connections[0] = NULL;
+  expect_closed("a closed connection");
+}
+
+/** Check that the listener of the federate rejects the given batch, closing the connection. */
+static void expect_rejected(unsigned char* batch, size_t length, const char* description) {
+  for (int i = 0; i < PORTS; i++) {
+    triggers[i].last_known_status_tag = NEVER_TAG;
+  }
+  net_abstraction_t net = connect_peer();
+  write_to_net_fail_on_error(net, length, batch, NULL, "Failed to send %s.", description);
+  expect_closed(description);
+  shutdown_net(net, false);
+  // Once the connection is closed, the ports that it feeds are known to be absent.
+  for (int i = 0; i < PORTS; i++) {
+    if (lf_tag_compare(status_of(i), FOREVER_TAG) != 0) {
+      lf_print_error_and_exit("Port %d is not known to be absent after the federate rejected %s.", i, description);
+    }
+  }
+  expect_events(NULL, 0);
+}
+
+/** Write the header of a batch at the given tag whose entries take the given number of bytes. */
+static void encode_batch_header(unsigned char* buffer, uint32_t length, tag_t tag) {
+  buffer[0] = MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH;
+  encode_uint16(0, &buffer[1]);
+  encode_uint32(length, &buffer[1 + sizeof(uint16_t)]);
+  encode_tag(&buffer[1 + sizeof(uint16_t) + sizeof(uint32_t)], tag);
+}
+
+/** Check that batches whose entries do not fit their length or have an unknown type are rejected. */
+static void test_malformed(void) {
+  const size_t header = MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE;
+  tag_t tag = lf_delay_tag(_env.current_tag, MSEC(10));
+  unsigned char batch[MSG_TYPE_P2P_TAGGED_MESSAGE_BATCH_HEADER_SIZE + 32];
+
+  // A batch too short for the port of its entry.
+  encode_batch_header(batch, 2, tag);
+  batch[header] = MSG_TYPE_PORT_ABSENT;
+  encode_uint16(1, &batch[header + 1]);
+  expect_rejected(batch, header + 3, "a batch too short for its entry");
+
+  // A batch too short for the length of the message in its entry.
+  encode_batch_header(batch, 5, tag);
+  batch[header] = MSG_TYPE_P2P_TAGGED_MESSAGE;
+  encode_uint16(0, &batch[header + 1]);
+  encode_uint32(1, &batch[header + 3]);
+  expect_rejected(batch, header + 7, "a batch too short for the length of its message");
+
+  // A message longer than the rest of the batch, after a port absent message that fits.
+  encode_batch_header(batch, 3 + 7 + 4, tag);
+  batch[header] = MSG_TYPE_PORT_ABSENT;
+  encode_uint16(1, &batch[header + 1]);
+  batch[header + 3] = MSG_TYPE_P2P_TAGGED_MESSAGE;
+  encode_uint16(0, &batch[header + 4]);
+  encode_uint32(16, &batch[header + 6]);
+  memset(&batch[header + 10], 'y', 16);
+  expect_rejected(batch, header + 26, "a message longer than its batch");
+
+  // An entry of a type that batches do not carry.
+  encode_batch_header(batch, 3, tag);
+  batch[header] = MSG_TYPE_P2P_MESSAGE;
+  encode_uint16(0, &batch[header + 1]);
+  expect_rejected(batch, header + 3, "an entry of an unknown type");
+}
+
+int main() {
+  initialize_lf_thread_id();
+  _lf_my_fed_id = 0;
+  environment_init(&_env, "federate__test", 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, NULL);
+  // Each connection from the peer gets a listener thread with an ID of its own.
+  lf_tracing_global_init(_env.name, NULL, 0, 16);
+  LF_MUTEX_INIT(&lf_outbound_net_mutex);
+  LF_COND_INIT(&lf_port_status_changed, &_env.mutex);
+  federation_metadata.federation_id = "p2p_batch_test";
+  for (int i = 0; i < PORTS; i++) {
+    triggers[i].reactions = reactions;
+    triggers[i].number_of_reactions = 1;
+    triggers[i].last_known_status_tag = NEVER_TAG;
+    ports[i].trigger = &triggers[i];
+    ports[i].source_id = 0;
+    ports[i].tmplt.type.element_size = 1;
+    _lf_action_table[i] = &ports[i];
+  }
+  _lf_action_table_size = PORTS;
+
+  connect_federate();
+  test_round_trip();
+  test_malformed();
+
+  shutdown_net(_fed.server_net, false);
+  shutdown_net(_fed.net_to_RTI, false);
+  shutdown_net(rti_side, false);
+  shutdown_net(server, false);
+  lf_tracing_global_shutdown();
+  return 0;
+}
+#endif // FEDERATED_DECENTRALIZED && FEDERATED_P2P_BATCH_SIZE && !LF_ENCLAVES
@@ -0,0 +1,132 @@
+/**
+ * @file staa_absent_test.c
+ * @brief Test that a worker waiting for an input port assumes it absent once its STAA expires.
+ *
+ * Two network input ports are in STAA groups of their own: a near one, whose reaction is at level 1,
+ * and a far one, whose reaction is at level 2. No message arrives on either. A worker that stalls at
+ * level 1 must return once physical time reaches the current time plus the STA plus the STAA of the
+ * near group, with the near port absent and the far port still unknown. A stall at the stop tag
+ * requested at run time assumes the ports absent at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+#if !defined(FEDERATED_DECENTRALIZED) || defined(LF_ENCLAVES)
+int main() {
+  // Only decentralized coordination assumes ports absent after their STAA. The test stands in for
+  // the generated code of a federate with a single enclave.
+  return 0;
+}
+#else
+#include "federate.h"
+#include "reactor.h"
+
+/** The STA of the federate. */
+#define STA MSEC(20)
+
+/** The STAA of the near group. */
+#define NEAR_STAA MSEC(50)
+
+/** The STAA of the far group, which the test never waits for. */
+#define FAR_STAA SEC(3600)
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+extern lf_action_base_t* _lf_action_table[];
+extern interval_t _lf_action_delay_table[];
+extern size_t _lf_action_table_size;
+extern staa_t* staa_lst[];
+extern size_t staa_lst_size;
+extern federate_instance_t _fed;
+extern instant_t start_time;
+
+static reaction_t near_reaction = {.index = 1};
+static reaction_t far_reaction = {.index = 2};
+static reaction_t* near_reactions[] = {&near_reaction};
+static reaction_t* far_reactions[] = {&far_reaction};
+static trigger_t near_trigger = {.reactions = near_reactions, .number_of_reactions = 1};
+static trigger_t far_trigger = {.reactions = far_reactions, .number_of_reactions = 1};
+static lf_action_base_t near_action = {.trigger = &near_trigger};
+static lf_action_base_t far_action = {.trigger = &far_trigger};
+static lf_action_base_t* near_actions[] = {&near_action};
+static lf_action_base_t* far_actions[] = {&far_action};
+static staa_t near_staa = {.actions = near_actions, .STAA = NEAR_STAA, .num_actions = 1};
+static staa_t far_staa = {.actions = far_actions, .STAA = FAR_STAA, .num_actions = 1};
+
+/** Start a tag at the current physical time with the status of both ports unknown. */
+static void start_tag(void) {
+  _env.current_tag = (tag_t){.time = lf_time_physical(), .microstep = 0};
+  near_trigger.status = unknown;
+  far_trigger.status = unknown;
+  near_trigger.last_known_status_tag = NEVER_TAG;
+  far_trigger.last_known_status_tag = NEVER_TAG;
+  lf_update_max_level(NEVER_TAG, false);
+}
+
+/** Check that a stall at level 1 returns once the STAA of the near group expires. */
+static void test_absent_after_staa(void) {
+  LF_MUTEX_LOCK(&_env.mutex);
+  start_tag();
+  instant_t deadline = _env.current_tag.time + STA + NEAR_STAA;
+  lf_stall_advance_level_federation_locked(1);
+  instant_t returned = lf_time_physical();
+  if (returned < deadline) {
+    lf_print_error_and_exit("Assumed the port absent " PRINTF_TIME " ns before its STAA expired.", deadline - returned);
+  }
+  if (near_trigger.status != absent || lf_tag_compare(near_trigger.last_known_status_tag, _env.current_tag) < 0) {
+    lf_print_error_and_exit("The port whose STAA expired is not known to be absent.");
+  }
+  if (far_trigger.status != unknown) {
+    lf_print_error_and_exit("The port whose STAA has not expired was assumed absent.");
+  }
+  LF_MUTEX_UNLOCK(&_env.mutex);
+}
+
+/** Check that a stall at the stop tag requested at run time does not wait for the STAA. */
+static void test_absent_at_stop(void) {
+  LF_MUTEX_LOCK(&_env.mutex);
+  start_tag();
+  _env.stop_tag = (tag_t){.time = _env.current_tag.time, .microstep = 1};
+  _env.current_tag = _env.stop_tag;
+  lf_stall_advance_level_federation_locked(2);
+  if (near_trigger.status != absent || far_trigger.status != absent) {
+    lf_print_error_and_exit("The ports were not assumed absent at the stop tag.");
+  }
+  _env.stop_tag = FOREVER_TAG;
+  LF_MUTEX_UNLOCK(&_env.mutex);
+}
+
+int main() {
+  initialize_lf_thread_id();
+  _lf_my_fed_id = 0;
+  _env.name = "federate__test";
+  lf_tracing_global_init(_env.name, NULL, 0, 2);
+  LF_MUTEX_INIT(&_env.mutex);
+  LF_COND_INIT(&lf_port_status_changed, &_env.mutex);
+  for (int i = 0; i < NUMBER_OF_FEDERATES; i++) {
+    LF_MUTEX_INIT(&_fed.outbound_p2p_mutexes[i]);
+  }
+  _env.stop_tag = FOREVER_TAG;
+  start_time = lf_time_physical();
+  lf_set_fed_maxwait(STA);
+  _lf_action_table[0] = &near_action;
+  _lf_action_table[1] = &far_action;
+  _lf_action_delay_table[0] = 0;
+  _lf_action_delay_table[1] = 0;
+  _lf_action_table_size = 2;
+  staa_lst[0] = &far_staa;
+  staa_lst[1] = &near_staa;
+  staa_lst_size = 2;
+
+  test_absent_after_staa();
+  test_absent_at_stop();
+
+  lf_tracing_global_shutdown();
+  return 0;
+}
+#endif // FEDERATED_DECENTRALIZED && !LF_ENCLAVES
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "arrival_lag.h"
+#include "util.h"
+
+#define N 20000
+#define RANDOM_SEED 4117
+#define NUM_GROUPS 2
+
+static interval_t groups[NUM_GROUPS];
+
+/** Return a lag drawn uniformly from [offset, offset + range). */
+static interval_t uniform_lag(interval_t offset, interval_t range) {
+  return offset + (interval_t)(((double)rand() / ((double)RAND_MAX + 1.0)) * (double)range);
+}
+
+static void initialize(arrival_lag_t* lag, double late_fraction) {
+  lag->late_fraction = late_fraction;
+  lag->min = 0;
+  lag->max = SEC(1);
+  lag->all_ports = 0;
+  lag->num_groups = NUM_GROUPS;
+  lag->groups = groups;
+  for (size_t i = 0; i < NUM_GROUPS; i++) {
+    groups[i] = 0;
+  }
+}
+
+/**
+ * @brief Check that an estimate settles where the given fraction of uniformly distributed lags exceeds it.
+ */
+static void test_quantile(double late_fraction) {
+  arrival_lag_t lag;
+  initialize(&lag, late_fraction);
+  for (int i = 0; i < N; i++) {
+    arrival_lag_record(&lag, -1, uniform_lag(0, MSEC(10)));
+  }
+  int late = 0;
+  for (int i = 0; i < N; i++) {
+    interval_t sample = uniform_lag(0, MSEC(10));
+    if (sample > lag.all_ports) {
+      late++;
+    }
+    arrival_lag_record(&lag, -1, sample);
+  }
+  double fraction = (double)late / N;
+  if (fraction < late_fraction * 0.6 || fraction > late_fraction * 1.4 + 0.01) {
+    lf_print_error_and_exit("%f of the messages arrived later than the estimate instead of %f.", fraction,
+                            late_fraction);
+  }
+  if (groups[0] != 0 || groups[1] != 0) {
+    lf_print_error_and_exit("A message on a port in no group moved the estimate of a group.");
+  }
+}
+
+/**
+ * @brief Check that the STAA of a group whose messages arrive later than the others grows to cover them.
+ */
+static void test_offsets() {
+  arrival_lag_t lag;
+  initialize(&lag, 0.05);
+  // Group 0 gets nine messages with a lag below 1 ms for each message of group 1, whose lag is between 5 and 6 ms.
+  int late[NUM_GROUPS] = {0, 0};
+  for (int i = 0; i < 2 * N; i++) {
+    int group = i % 10 == 0 ? 1 : 0;
+    interval_t sample = group == 1 ? uniform_lag(MSEC(5), MSEC(1)) : uniform_lag(0, MSEC(1));
+    if (i >= N && sample > lf_time_add(lag.all_ports, (interval_t)arrival_lag_staa(&lag, (size_t)group))) {
+      late[group]++;
+    }
+    arrival_lag_record(&lag, group, sample);
+    if (lf_time_add(lag.all_ports, (interval_t)arrival_lag_staa(&lag, 1)) != LF_MAX(lag.groups[1], lag.all_ports)) {
+      lf_print_error_and_exit("The STA plus the STAA of a group is not the larger of the STA and its estimate.");
+    }
+  }
+  // The slowest half of the messages of group 1 are the slowest 5% of all messages.
+  if (lag.all_ports < MSEC(5) || lag.all_ports > MSEC(6)) {
+    lf_print_error_and_exit("The STA is %lld ns instead of about 5.5 ms.", (long long)lag.all_ports);
+  }
+  if (arrival_lag_staa(&lag, 0) != 0) {
+    lf_print_error_and_exit("The STAA of a group whose messages arrive before the STA is not zero.");
+  }
+  if (arrival_lag_staa(&lag, 1) < (size_t)USEC(200) || arrival_lag_staa(&lag, 1) > (size_t)USEC(800)) {
+    lf_print_error_and_exit("The STAA of the late group is %zu instead of about 0.45 ms.", arrival_lag_staa(&lag, 1));
+  }
+  if (late[0] != 0 || late[1] < N / 10 / 100 || late[1] > N / 10 / 10) {
+    lf_print_error_and_exit("%d and %d messages of the groups arrived after the STA plus the STAA.", late[0], late[1]);
+  }
+}
+
+/**
+ * @brief Check that an estimate follows a lag that grows and stays within the bounds.
+ */
+static void test_tracking() {
+  arrival_lag_t lag;
+  initialize(&lag, 0.01);
+  lag.max = MSEC(100);
+  for (int i = 0; i < N; i++) {
+    arrival_lag_record(&lag, 0, uniform_lag(MSEC(1), USEC(10)));
+  }
+  for (int i = 0; i < 200; i++) {
+    arrival_lag_record(&lag, 0, MSEC(50));
+  }
+  if (lag.groups[0] < MSEC(45) || lag.groups[0] > MSEC(60)) {
+    lf_print_error_and_exit("The estimate is %lld ns after the lag grew to 50 ms.", (long long)lag.groups[0]);
+  }
+  for (int i = 0; i < 200; i++) {
+    arrival_lag_record(&lag, 0, SEC(10));
+  }
+  if (lag.groups[0] != MSEC(100) || lag.all_ports != MSEC(100)) {
+    lf_print_error_and_exit("An estimate exceeds its bound.");
+  }
+  for (int i = 0; i < N; i++) {
+    arrival_lag_record(&lag, 0, -MSEC(1));
+  }
+  if (lag.groups[0] != 0 || lag.all_ports != 0) {
+    lf_print_error_and_exit("An estimate is below its bound.");
+  }
+}
+
+int main() {
+  srand(RANDOM_SEED);
+  test_quantile(0.01);
+  test_quantile(0.05);
+  test_quantile(0.5);
+  test_offsets();
+  test_tracking();
+  return 0;
+}
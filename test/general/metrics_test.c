@@ -0,0 +1,199 @@
+/**
+ * @file metrics_test.c
+ * @brief Test the snapshot of the operational counters and its Prometheus text format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "metrics.h"
+#include "pqueue_tag.h"
+#include "util.h"
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+
+/** Record the counters whose values are checked. */
+static void record(void) {
+  for (int i = 0; i < 3; i++) {
+    _lf_metrics_tag_advanced(&_env);
+  }
+  for (int i = 0; i < 5; i++) {
+    _lf_metrics_reaction_queued(&_env);
+  }
+  for (int i = 0; i < 3; i++) {
+    _lf_metrics_reaction_done(&_env);
+  }
+  _lf_metrics_stp_violation(&_env);
+  _lf_metrics_deadline_violation(&_env);
+  _lf_metrics_deadline_violation(&_env);
+  _lf_metrics_token_allocated(false);
+  _lf_metrics_token_allocated(false);
+  _lf_metrics_token_freed(true);
+  _lf_metrics_network_inputs_init(2);
+  _lf_metrics_sta_set(MSEC(2));
+  _lf_metrics_staa_set(1, MSEC(5));
+  _lf_metrics_network_input_message(1, MSEC(1), false);
+  _lf_metrics_network_input_message(1, MSEC(7), true);
+  // Counters of environments and ports that do not exist are ignored.
+  _lf_metrics_reaction_done(NULL);
+  _lf_metrics_network_input_message(2, MSEC(1), true);
+  _lf_metrics_worker_wait_starts(&_env, 7);
+}
+
+/** Check the snapshot of the counters recorded by record(). */
+static void test_snapshot(const lf_metrics_t* metrics) {
+  if (metrics->num_environments != 1) {
+    lf_print_error_and_exit("Snapshot has %zu environments.", metrics->num_environments);
+  }
+  const lf_environment_metrics_t* env = &metrics->environments[0];
+  if (env->tags != 3 || env->reactions_queued != 5 || env->reactions_done != 3 || env->stp_violations != 1 ||
+      env->deadline_violations != 2 || env->event_queue_size != 0 || strcmp(env->name, _env.name) != 0) {
+    lf_print_error_and_exit("Unexpected counters of the environment: %lld tags, %lld reactions done.",
+                            (long long)env->tags, (long long)env->reactions_done);
+  }
+  // The tag was advanced after the start of the logical time of the environment.
+  if (env->tag_lag <= 0 || env->tag_lag > metrics->time - _env.current_tag.time) {
+    lf_print_error_and_exit("Unexpected tag lag %lld.", (long long)env->tag_lag);
+  }
+  // Worker 0 waited for at least 2 ms and worker 1 has been waiting since before the snapshot.
+  if (env->idle_time < MSEC(2) || env->idle_time > metrics->elapsed * env->workers) {
+    lf_print_error_and_exit("Unexpected idle time %lld.", (long long)env->idle_time);
+  }
+  if (metrics->tokens_live != 1 || metrics->tokens_recycled != 1 || metrics->sta != MSEC(2)) {
+    lf_print_error_and_exit("Unexpected global counters: %lld tokens live.", (long long)metrics->tokens_live);
+  }
+  const lf_network_input_metrics_t* port = &metrics->network_inputs[1];
+  if (metrics->num_network_inputs != 2 || port->port != 1 || port->messages != 2 || port->late_messages != 1 ||
+      port->arrival_lag != MSEC(7) || port->staa != MSEC(5) || metrics->network_inputs[0].messages != 0) {
+    lf_print_error_and_exit("Unexpected counters of the network input ports.");
+  }
+}
+
+/** Return the contents of the Prometheus text format of the given snapshots. */
+static char* write_to_string(const lf_metrics_t* metrics, const lf_metrics_t* previous) {
+  FILE* file = tmpfile();
+  LF_ASSERT_NON_NULL(file);
+  lf_metrics_write_prometheus(file, metrics, previous);
+  long length = ftell(file);
+  rewind(file);
+  char* contents = (char*)calloc((size_t)length + 1, 1);
+  LF_ASSERT_NON_NULL(contents);
+  if (fread(contents, 1, (size_t)length, file) != (size_t)length) {
+    lf_print_error_and_exit("Failed to read back the metrics.");
+  }
+  fclose(file);
+  return contents;
+}
+
+/**
+ * Check that each line is a HELP or TYPE comment or a sample of a metric whose TYPE came just before
+ * its first sample, with labels and a value.
+ */
+static void check_exposition_format(char* text) {
+  char type[128] = "";
+  for (char* line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+    if (strncmp(line, "# HELP ", 7) == 0) {
+      continue;
+    }
+    if (strncmp(line, "# TYPE ", 7) == 0) {
+      char kind[16];
+      if (sscanf(line + 7, "%127s %15s", type, kind) != 2 ||
+          (strcmp(kind, "counter") != 0 && strcmp(kind, "gauge") != 0)) {
+        lf_print_error_and_exit("Malformed TYPE line: %s", line);
+      }
+      continue;
+    }
+    char* labels = strchr(line, '{');
+    char* value = strstr(line, "} ");
+    if (labels == NULL || value == NULL || strncmp(line, type, (size_t)(labels - line)) != 0 ||
+        strlen(type) != (size_t)(labels - line) || strncmp(labels, "{process=\"metrics_test\"", 23) != 0) {
+      lf_print_error_and_exit("Sample does not follow the TYPE of its metric %s: %s", type, line);
+    }
+    char* end;
+    strtod(value + 2, &end);
+    if (end == value + 2 || *end != '\0') {
+      lf_print_error_and_exit("Sample has no numeric value: %s", line);
+    }
+  }
+}
+
+/** Check the Prometheus text format of a snapshot, including the rates computed from an earlier one. */
+static void test_prometheus(const lf_metrics_t* metrics) {
+  lf_metrics_t previous = *metrics;
+  lf_environment_metrics_t earlier = metrics->environments[0];
+  earlier.tags = 1;
+  earlier.idle_time = metrics->environments[0].idle_time - MSEC(500) * earlier.workers;
+  previous.environments = &earlier;
+  previous.time = metrics->time - SEC(1);
+
+  char* text = write_to_string(metrics, &previous);
+  const char* expected[] = {
+      "# HELP lf_tags_total Number of tags the environment has advanced to.\n# TYPE lf_tags_total counter\n"
+      "lf_tags_total{process=\"metrics_test\",environment=\"main\\\"\\\\\\n\"} 3\n",
+      // Two tags in the second since the previous snapshot.
+      "lf_tags_per_second{process=\"metrics_test\",environment=\"main\\\"\\\\\\n\"} 2\n",
+      "lf_reaction_queue_depth{process=\"metrics_test\",environment=\"main\\\"\\\\\\n\"} 2\n",
+      // Half a second of waiting by each worker in one second.
+      "lf_worker_idle_fraction{process=\"metrics_test\",environment=\"main\\\"\\\\\\n\"} 0.5\n",
+      "lf_deadline_violations_total{process=\"metrics_test\",environment=\"main\\\"\\\\\\n\"} 2\n",
+      "# TYPE lf_tokens_live gauge\nlf_tokens_live{process=\"metrics_test\"} 1\n",
+      "lf_sta_seconds{process=\"metrics_test\"} 0.002000000\n",
+      "lf_staa_seconds{process=\"metrics_test\",port=\"1\"} 0.005000000\n",
+      "lf_network_input_late_messages_total{process=\"metrics_test\",port=\"1\"} 1\n",
+      "lf_network_input_arrival_lag_seconds{process=\"metrics_test\",port=\"0\"} 0.000000000\n",
+  };
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    if (strstr(text, expected[i]) == NULL) {
+      lf_print_error_and_exit("Metrics lack\n%s\nin\n%s", expected[i], text);
+    }
+  }
+  check_exposition_format(text);
+  free(text);
+
+  // Without an earlier snapshot, rates are computed since the counters were initialized.
+  text = write_to_string(metrics, NULL);
+  if (strstr(text, "lf_tags_per_second{") == NULL) {
+    lf_print_error_and_exit("Metrics without an earlier snapshot lack the tag rate:\n%s", text);
+  }
+  check_exposition_format(text);
+  free(text);
+}
+
+int main() {
+  lf_metrics_t metrics;
+  if (lf_metrics_snapshot(&metrics) != -1) {
+    lf_print_error_and_exit("Took a snapshot before the counters were initialized.");
+  }
+  // The name needs each of the characters that label values escape.
+  _env.name = "main\"\\\n";
+  _env.event_q = pqueue_tag_init(8);
+  _env.current_tag = (tag_t){.time = lf_time_physical(), .microstep = 0};
+#if !defined(LF_SINGLE_THREADED)
+  _env.num_workers = 2;
+#endif
+  _lf_metrics_init("metrics_test");
+  lf_sleep(MSEC(1));
+  record();
+  _lf_metrics_worker_wait_starts(&_env, 0);
+  lf_sleep(MSEC(2));
+  _lf_metrics_worker_wait_ends(&_env, 0);
+#if !defined(LF_SINGLE_THREADED)
+  _lf_metrics_worker_wait_starts(&_env, 1);
+#endif
+  if (lf_metrics_snapshot(&metrics) != 0) {
+    lf_print_error_and_exit("Failed to take a snapshot.");
+  }
+  test_snapshot(&metrics);
+  test_prometheus(&metrics);
+  lf_metrics_free(&metrics);
+  if (metrics.environments != NULL || metrics.network_inputs != NULL) {
+    lf_print_error_and_exit("lf_metrics_free did not clear the snapshot.");
+  }
+  _lf_metrics_shutdown();
+  pqueue_tag_free(_env.event_q);
+  return 0;
+}
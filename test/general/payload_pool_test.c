@@ -0,0 +1,239 @@
+/**
+ * @file payload_pool_test.c
+ * @brief Test pools of payload buffers and their registration with network input ports.
+ *
+ * The test takes buffers from a pool until it is exhausted and returns them. It then registers a
+ * pool with a network input port and checks that payloads arriving on the port are taken from the
+ * pool, that they are allocated with malloc() once the pool is empty, and that _lf_done_using()
+ * returns pooled payloads to the pool. A federate registers pools only after it has connected to
+ * the RTI, so the test plays the RTI for the handshake.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "util.h"
+
+#if !defined(FEDERATED)
+int main() {
+  // Payload pools are part of the federated runtime.
+  return 0;
+}
+#else
+#include "federate.h"
+#include "lf_token.h"
+#include "net_abstraction.h"
+#include "net_common.h"
+#include "net_util.h"
+#include "payload_pool.h"
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+extern federate_instance_t _fed;
+extern federation_metadata_t federation_metadata;
+extern lf_action_base_t* _lf_action_table[];
+extern size_t _lf_action_table_size;
+
+#if defined(LF_ENCLAVES)
+//// Code-generated functions that the stub does not define. The federate has a single enclave.
+
+int lf_get_upstream_of(int enclave_id, uint16_t** result) {
+  (void)enclave_id;
+  *result = NULL;
+  return 0;
+}
+
+int lf_get_downstream_of(int enclave_id, uint16_t** result) {
+  (void)enclave_id;
+  *result = NULL;
+  return 0;
+}
+
+int lf_get_upstream_delay_of(int enclave_id, interval_t** result) {
+  (void)enclave_id;
+  *result = NULL;
+  return 0;
+}
+#endif // LF_ENCLAVES
+
+/** The action of a network input port whose payloads are plain bytes. */
+static lf_action_base_t bytes_action = {.tmplt.type = {.element_size = 1}};
+
+/** The action of a network input port whose payloads have a destructor. */
+static lf_action_base_t destructed_action = {.tmplt.type = {.element_size = 8, .destructor = free}};
+
+/** The server on which the test plays the RTI. */
+static net_abstraction_t server;
+
+/** The connection of the RTI to the federate. */
+static net_abstraction_t rti_side;
+
+/** Accept the federate and complete its handshake. */
+static void* play_rti(void* ignored) {
+  (void)ignored;
+  net_abstraction_t net = accept_net(server);
+  LF_ASSERT_NON_NULL(net);
+  unsigned char buffer[2 + sizeof(uint16_t) + 255];
+  read_from_net_fail_on_error(net, 2 + sizeof(uint16_t), buffer, "The RTI failed to read the federate IDs.");
+  read_from_net_fail_on_error(net, buffer[1 + sizeof(uint16_t)], &buffer[2 + sizeof(uint16_t)],
+                              "The RTI failed to read the federation ID.");
+  unsigned char ack = MSG_TYPE_ACK;
+  write_to_net_fail_on_error(net, 1, &ack, NULL, "The RTI failed to accept the federate.");
+  read_from_net_fail_on_error(net, MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE + 1 + sizeof(uint16_t), buffer,
+                              "The RTI failed to read the neighbors and UDP port.");
+  rti_side = net;
+  return NULL;
+}
+
+/** Connect the federate to the RTI played by the test. */
+static void connect_federate(void) {
+  server = initialize_net();
+  set_my_port(server, 0);
+  if (create_server(server) != 0) {
+    lf_print_error_and_exit("Failed to create the server of the RTI.");
+  }
+  lf_thread_t rti_thread;
+  lf_thread_create(&rti_thread, play_rti, NULL);
+  lf_connect_to_rti("localhost", get_my_port(server));
+  lf_thread_join(rti_thread, NULL);
+}
+
+/** Check that a pool hands out distinct aligned buffers until it is exhausted and takes them back. */
+static void test_acquire_release(void) {
+  if (lf_payload_pool_create(0, 2, false) != NULL || lf_payload_pool_create(100, 0, false) != NULL) {
+    lf_print_error_and_exit("Created an empty pool.");
+  }
+  lf_payload_pool_t* pool = lf_payload_pool_create(100, 2, false);
+  LF_ASSERT_NON_NULL(pool);
+  if (lf_payload_pool_acquire(pool, 101) != NULL || lf_payload_pool_available(pool) != 2) {
+    lf_print_error_and_exit("Took a buffer too small for the payload.");
+  }
+  unsigned char* first = (unsigned char*)lf_payload_pool_acquire(pool, 100);
+  unsigned char* second = (unsigned char*)lf_payload_pool_acquire(pool, 1);
+  if (first == NULL || second == NULL || first == second || ((uintptr_t)first) % 64 != 0 ||
+      ((uintptr_t)second) % 64 != 0) {
+    lf_print_error_and_exit("The buffers of the pool are not distinct and aligned.");
+  }
+  // Each buffer holds a payload of the full size without overlapping the other.
+  memset(first, 1, 100);
+  memset(second, 2, 100);
+  if (first[99] != 1 || lf_payload_pool_available(pool) != 0) {
+    lf_print_error_and_exit("The buffers of the pool overlap.");
+  }
+  if (lf_payload_pool_acquire(pool, 1) != NULL) {
+    lf_print_error_and_exit("An exhausted pool handed out a buffer.");
+  }
+  if (lf_payload_pool_free(pool) != -1) {
+    lf_print_error_and_exit("Freed a pool whose buffers are in use.");
+  }
+  lf_payload_pool_release(first);
+  if (lf_payload_pool_available(pool) != 1 || lf_payload_pool_acquire(pool, 100) != first) {
+    lf_print_error_and_exit("A released buffer was not handed out again.");
+  }
+  lf_payload_pool_release(first);
+  lf_payload_pool_release(second);
+  lf_payload_pool_release(NULL);
+  if (lf_payload_pool_available(pool) != 2 || lf_payload_pool_free(pool) != 0) {
+    lf_print_error_and_exit("Failed to free a pool with all its buffers returned.");
+  }
+
+  // Without huge pages, the pool falls back to regular pages.
+  pool = lf_payload_pool_create(4096, 4, true);
+  LF_ASSERT_NON_NULL(pool);
+  lf_payload_pool_release(lf_payload_pool_acquire(pool, 4096));
+  if (lf_payload_pool_free(pool) != 0) {
+    lf_print_error_and_exit("Failed to free a pool asking for huge pages.");
+  }
+}
+
+/** Check that only ports that exist and carry plain bytes accept a pool. */
+static void test_register(lf_payload_pool_t* pool) {
+  if (lf_register_payload_pool((unsigned short)_lf_action_table_size, pool) != -1) {
+    lf_print_error_and_exit("Registered a pool for a port that does not exist.");
+  }
+  if (lf_register_payload_pool(1, pool) != -1) {
+    lf_print_error_and_exit("Registered a pool for a port whose type has a destructor.");
+  }
+  if (lf_register_payload_pool(0, pool) != 0) {
+    lf_print_error_and_exit("Failed to register a pool.");
+  }
+}
+
+/** Allocate a payload on port 0, checking whether it comes from the pool, and return a token carrying it. */
+static lf_token_t* receive(lf_payload_pool_t* pool, size_t length, bool pooled) {
+  size_t available = lf_payload_pool_available(pool);
+  token_type_t* type;
+  void* payload = lf_allocate_payload(0, length, &type);
+  LF_ASSERT_NON_NULL(payload);
+  if ((type != &bytes_action.tmplt.type) != pooled ||
+      lf_payload_pool_available(pool) != (pooled ? available - 1 : available)) {
+    lf_print_error_and_exit("A payload of %zu bytes was %s from the pool.", length, pooled ? "not taken" : "taken");
+  }
+  memset(payload, 3, length);
+  lf_token_t* token = _lf_new_token(type, payload, length);
+  // The token is referred to by the event that carries it.
+  token->ref_count = 1;
+  return token;
+}
+
+/** Check that payloads come from the pool while it has buffers and that _lf_done_using() returns them. */
+static void test_allocate(lf_payload_pool_t* pool) {
+  lf_token_t* first = receive(pool, 64, true);
+  // A payload too large for the buffers of the pool is allocated with malloc().
+  lf_token_t* large = receive(pool, 65, false);
+  lf_token_t* second = receive(pool, 1, true);
+  // So is a payload arriving while all buffers are in use.
+  lf_token_t* fallback = receive(pool, 64, false);
+  _lf_done_using(first);
+  if (lf_payload_pool_available(pool) != 1) {
+    lf_print_error_and_exit("The payload was not returned to the pool when its token was done with.");
+  }
+  _lf_done_using(large);
+  _lf_done_using(fallback);
+  _lf_done_using(second);
+  if (lf_payload_pool_available(pool) != 2) {
+    lf_print_error_and_exit("Payloads allocated with malloc() were returned to the pool.");
+  }
+  // A port without a pool allocates payloads with malloc().
+  token_type_t* type;
+  void* payload = lf_allocate_payload(1, 8, &type);
+  if (type != &destructed_action.tmplt.type) {
+    lf_print_error_and_exit("A port without a pool used a pool.");
+  }
+  free(payload);
+}
+
+int main() {
+  initialize_lf_thread_id();
+  _lf_my_fed_id = 0;
+  _env.name = "federate__test";
+  lf_tracing_global_init(_env.name, NULL, 0, 2);
+  federation_metadata.federation_id = "payload_pool_test";
+  _lf_action_table[0] = &bytes_action;
+  _lf_action_table[1] = &destructed_action;
+  _lf_action_table_size = 2;
+
+  test_acquire_release();
+  connect_federate();
+  lf_payload_pool_t* pool = lf_payload_pool_create(64, 2, false);
+  LF_ASSERT_NON_NULL(pool);
+  test_register(pool);
+  test_allocate(pool);
+  // Unregistering the pool goes back to malloc().
+  lf_register_payload_pool(0, NULL);
+  _lf_done_using(receive(pool, 64, false));
+  if (lf_payload_pool_free(pool) != 0) {
+    lf_print_error_and_exit("Failed to free the pool once all its payloads were returned.");
+  }
+
+  shutdown_net(_fed.net_to_RTI, false);
+  shutdown_net(rti_side, false);
+  shutdown_net(server, false);
+  lf_tracing_global_shutdown();
+  return 0;
+}
+#endif // FEDERATED
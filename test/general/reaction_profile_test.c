@@ -0,0 +1,201 @@
+/**
+ * @file reaction_profile_test.c
+ * @brief Test the recording, snapshots, merging and output of reaction profiles.
+ *
+ * Workers record invocations of two reactions, one of them from two workers, while the main
+ * thread takes snapshots. Each snapshot must be consistent and no count may decrease from one
+ * snapshot to the next. The final snapshot must merge the records of both workers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "reaction_profile.h"
+#include "util.h"
+
+#define N 20000
+#define DEADLINE MSEC(10)
+
+/** The environment of the stub of the generated code. */
+extern environment_t _env;
+
+static self_base_t reactor_a = {.name = "a", .full_name = "main.a"};
+static self_base_t reactor_b = {.name = "b", .full_name = "main.b"};
+static reaction_t reaction_a = {.self = &reactor_a, .number = 1, .deadline = DEADLINE};
+static reaction_t reaction_b = {.self = &reactor_b, .number = 2, .deadline = NEVER};
+
+/** The lag of the i-th invocation, between -50 and 49. */
+static interval_t lag_of(int i) { return (interval_t)(i % 100) - 50; }
+
+/** The execution time of the i-th invocation, between 1000 and 7000. */
+static interval_t exec_time_of(int i) { return (interval_t)(i % 7 + 1) * 1000; }
+
+/** Record N invocations of reaction a and, if the worker is 1, of reaction b. */
+static void* record(void* worker) {
+  int w = (int)(intptr_t)worker;
+  for (int i = 0; i < N; i++) {
+    instant_t start = _env.current_tag.time + lag_of(i);
+    _lf_reaction_profile_record(&_env, &reaction_a, w, start, start + exec_time_of(i));
+    if (w == 1) {
+      _lf_reaction_profile_record(&_env, &reaction_b, w, start, start + exec_time_of(i));
+    }
+  }
+  return NULL;
+}
+
+/** Return the sum of the given buckets. */
+static uint64_t sum(const uint64_t* buckets) {
+  uint64_t total = 0;
+  for (int i = 0; i < LOG_HISTOGRAM_NUM_BUCKETS; i++) {
+    total += buckets[i];
+  }
+  return total;
+}
+
+/** Check that the histograms of each profile agree with each other and with their counts. */
+static void check_consistent(const lf_reaction_profile_t* profiles, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    const lf_reaction_profile_t* p = &profiles[i];
+    if (sum(p->exec_time.buckets) != p->exec_time.count ||
+        sum(p->lag.buckets) + sum(p->lag.negative_buckets) != p->lag.count || p->exec_time.count != p->lag.count) {
+      lf_print_error_and_exit("Snapshot of %s has %llu execution times and %llu lags.", p->reactor,
+                              (unsigned long long)p->exec_time.count, (unsigned long long)p->lag.count);
+    }
+    uint64_t slack = p->reaction == &reaction_a ? p->exec_time.count : 0;
+    if (p->slack.count != slack || sum(p->slack.buckets) + sum(p->slack.negative_buckets) != slack) {
+      lf_print_error_and_exit("Snapshot of %s has %llu slacks.", p->reactor, (unsigned long long)p->slack.count);
+    }
+  }
+}
+
+#if !defined(LF_SINGLE_THREADED)
+/** Return the count of the execution times of the given reaction in a snapshot. */
+static uint64_t count_of(const lf_reaction_profile_t* profiles, size_t count, const reaction_t* reaction) {
+  for (size_t i = 0; i < count; i++) {
+    if (profiles[i].reaction == reaction) {
+      return profiles[i].exec_time.count;
+    }
+  }
+  return 0;
+}
+#endif // LF_SINGLE_THREADED
+
+/** Check the merged profiles once all invocations have been recorded. */
+static void check_final(const lf_reaction_profile_t* profiles, size_t count, int workers) {
+  if (count != 2 || profiles[0].reaction != &reaction_a || profiles[1].reaction != &reaction_b) {
+    lf_print_error_and_exit("Expected the profiles of main.a and main.b in order, got %zu profiles.", count);
+  }
+  const lf_reaction_profile_t* a = &profiles[0];
+  if (a->exec_time.count != (uint64_t)workers * N || a->exec_time.min != 1000 || a->exec_time.max != 7000 ||
+      a->lag.min != -50 || a->lag.max != 49 || a->slack.min != DEADLINE - 49 || a->slack.max != DEADLINE + 50) {
+    lf_print_error_and_exit("Merged profile of main.a is wrong: %llu records.", (unsigned long long)a->exec_time.count);
+  }
+  if (strcmp(a->reactor, "main.a") != 0 || a->number != 1 || a->deadline != DEADLINE || a->environment != 0) {
+    lf_print_error_and_exit("Profile of main.a does not identify its reaction.");
+  }
+  if (profiles[1].exec_time.count != N || profiles[1].slack.count != 0) {
+    lf_print_error_and_exit("Profile of main.b has %llu records.", (unsigned long long)profiles[1].exec_time.count);
+  }
+}
+
+/** Return the contents written to a temporary file by the given writer. */
+static char* write_to_string(void (*writer)(FILE*, const lf_reaction_profile_t*, size_t),
+                             const lf_reaction_profile_t* profiles, size_t count) {
+  FILE* file = tmpfile();
+  LF_ASSERT_NON_NULL(file);
+  writer(file, profiles, count);
+  long length = ftell(file);
+  rewind(file);
+  char* contents = (char*)calloc((size_t)length + 1, 1);
+  LF_ASSERT_NON_NULL(contents);
+  if (fread(contents, 1, (size_t)length, file) != (size_t)length) {
+    lf_print_error_and_exit("Failed to read back the reaction profile.");
+  }
+  fclose(file);
+  return contents;
+}
+
+/** Check the JSON and CSV output of the merged profiles. */
+static void test_output(const lf_reaction_profile_t* profiles, size_t count, int workers) {
+  char expected[256];
+  char* json = write_to_string(lf_reaction_profile_write_json, profiles, count);
+  snprintf(expected, sizeof(expected),
+           "{\"environment\": 0, \"reactor\": \"main.a\", \"reaction\": 1, \"deadline\": %lld, "
+           "\"exec_time\": {\"count\": %d, \"min\": 1000, \"max\": 7000, ",
+           (long long)DEADLINE, workers * N);
+  if (strncmp(json, "{\"reactions\": [", 15) != 0 || strstr(json, expected) == NULL ||
+      strstr(json, "\"reactor\": \"main.b\", \"reaction\": 2") == NULL ||
+      strstr(json, "\"slack\": {\"count\": 0, \"min\": 0, \"max\": 0, \"mean\": 0") == NULL) {
+    lf_print_error_and_exit("Unexpected JSON reaction profile:\n%s", json);
+  }
+  free(json);
+
+  char* csv = write_to_string(lf_reaction_profile_write_csv, profiles, count);
+  int lines = 0;
+  for (char* c = csv; *c != '\0'; c++) {
+    lines += *c == '\n';
+  }
+  snprintf(expected, sizeof(expected), "\n0, main.a, 1, lag, %d, -50, 49, ", workers * N);
+  // A header, three metrics of main.a, and two of main.b, which has no deadline.
+  if (lines != 6 || strncmp(csv, "Environment, Reactor, Reaction, Metric, Count,", 46) != 0 ||
+      strstr(csv, expected) == NULL || strstr(csv, "\n0, main.b, 2, exec_time, 20000, 1000, 7000, ") == NULL ||
+      strstr(csv, "main.b, 2, slack") != NULL) {
+    lf_print_error_and_exit("Unexpected CSV reaction profile:\n%s", csv);
+  }
+  free(csv);
+}
+
+int main() {
+  _env.id = 0;
+  _env.current_tag = (tag_t){.time = SEC(1), .microstep = 0};
+  lf_reaction_profile_t* profiles;
+#if defined(LF_SINGLE_THREADED)
+  int workers = 1;
+  _lf_reaction_profile_init("reaction_profile_test", 0);
+  record((void*)(intptr_t)0);
+  // With one worker, that worker also records the invocations of reaction b.
+  for (int i = 0; i < N; i++) {
+    instant_t start = _env.current_tag.time + lag_of(i);
+    _lf_reaction_profile_record(&_env, &reaction_b, 0, start, start + exec_time_of(i));
+  }
+#else
+  int workers = 2;
+  _env.num_workers = workers;
+  _lf_reaction_profile_init("reaction_profile_test", 0);
+  // Records from a worker that does not exist are dropped.
+  _lf_reaction_profile_record(&_env, &reaction_a, workers, 0, 1);
+
+  lf_thread_t threads[2];
+  for (int w = 0; w < workers; w++) {
+    lf_thread_create(&threads[w], record, (void*)(intptr_t)w);
+  }
+  uint64_t last_a = 0;
+  uint64_t last_b = 0;
+  while (last_a < (uint64_t)workers * N || last_b < N) {
+    size_t count = lf_reaction_profile_snapshot(&profiles);
+    check_consistent(profiles, count);
+    uint64_t a = count_of(profiles, count, &reaction_a);
+    uint64_t b = count_of(profiles, count, &reaction_b);
+    if (a < last_a || b < last_b) {
+      lf_print_error_and_exit("Counts went down from %llu and %llu to %llu and %llu.", (unsigned long long)last_a,
+                              (unsigned long long)last_b, (unsigned long long)a, (unsigned long long)b);
+    }
+    last_a = a;
+    last_b = b;
+    free(profiles);
+  }
+  for (int w = 0; w < workers; w++) {
+    lf_thread_join(threads[w], NULL);
+  }
+#endif
+  size_t count = lf_reaction_profile_snapshot(&profiles);
+  check_consistent(profiles, count);
+  check_final(profiles, count, workers);
+  test_output(profiles, count, workers);
+  free(profiles);
+  _lf_reaction_profile_free();
+  return 0;
+}
@@ -63,7 +63,34 @@ void run_test(hashmap_object2int_t* h, int* distribution) {
   }
 }
 
+/**
+ * @brief Check that a hashmap created with a small capacity grows to hold many entries
+ * and that absent keys are reported as such.
+ */
+void test_growth() {
+  hashmap_object2int_t* h = hashmap_object2int_new(4, NULL);
+  int* base = NULL;
+  for (int i = 1; i <= N; i++) {
+    hashmap_object2int_put(h, base + i, i);
+  }
+  if (h->num_entries != N) {
+    lf_print_error_and_exit("Expected %d entries but got %zu.\n", N, h->num_entries);
+  }
+  for (int i = 1; i <= N; i++) {
+    int found;
+    if (hashmap_object2int_get(h, base + i) != i || !hashmap_object2int_find(h, base + i, &found) || found != i) {
+      lf_print_error_and_exit("Failed to find entry %d after growing the hashmap.\n", i);
+    }
+  }
+  int found;
+  if (hashmap_object2int_find(h, base + N + 1, &found)) {
+    lf_print_error_and_exit("Found a key that was never put into the hashmap.\n");
+  }
+  hashmap_object2int_free(h);
+}
+
 int main() {
+  test_growth();
   srand(RANDOM_SEED);
   for (int i = 0; i < N; i++) {
     int perturbed[2];
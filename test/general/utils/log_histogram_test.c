@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "log_histogram.h"
+#include "util.h"
+
+#define N 5000
+#define RANDOM_SEED 2748
+
+static int64_t values[N];
+
+static int compare(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static int64_t random_value() {
+  // Spread the values over many powers of two, keeping their sum within range.
+  int64_t value = ((int64_t)rand() << 31) ^ rand();
+  return value >> (20 + rand() % 42);
+}
+
+/**
+ * @brief Check that every value falls in a bucket whose largest value is within the promised error.
+ */
+void test_buckets() {
+  int64_t previous_bucket = 0;
+  for (int64_t value = 0; value < 100000; value++) {
+    int bucket = log_histogram_bucket(value);
+    if (bucket < previous_bucket) {
+      lf_print_error_and_exit("Buckets are not monotonic at %lld.", (long long)value);
+    }
+    previous_bucket = bucket;
+    int64_t max = log_histogram_bucket_max(bucket);
+    if (max < value || (max - value) * LOG_HISTOGRAM_SUB_BUCKETS > value) {
+      lf_print_error_and_exit("Value %lld is in bucket %d with largest value %lld.", (long long)value, bucket,
+                              (long long)max);
+    }
+  }
+  if (log_histogram_bucket(INT64_MAX) != LOG_HISTOGRAM_NUM_BUCKETS - 1 ||
+      log_histogram_bucket_max(LOG_HISTOGRAM_NUM_BUCKETS - 1) != INT64_MAX) {
+    lf_print_error_and_exit("The largest value is not in the last bucket.");
+  }
+}
+
+/**
+ * @brief Check percentiles against the exact percentiles of sorted values,
+ * and check that merging histograms is the same as recording into one histogram.
+ */
+void test_percentiles() {
+  log_histogram_t* all = (log_histogram_t*)calloc(1, sizeof(log_histogram_t));
+  log_histogram_t* first = (log_histogram_t*)calloc(1, sizeof(log_histogram_t));
+  log_histogram_t* second = (log_histogram_t*)calloc(1, sizeof(log_histogram_t));
+  for (int i = 0; i < N; i++) {
+    values[i] = random_value();
+    log_histogram_record(all, values[i]);
+    log_histogram_record(i % 2 ? first : second, values[i]);
+  }
+  log_histogram_merge(first, second);
+  qsort(values, N, sizeof(int64_t), compare);
+  double percentiles[] = {0.0, 50.0, 90.0, 99.0, 100.0};
+  for (size_t i = 0; i < sizeof(percentiles) / sizeof(double); i++) {
+    int64_t expected = values[percentiles[i] == 0.0 ? 0 : (int)(percentiles[i] / 100.0 * N + 0.5) - 1];
+    int64_t found = log_histogram_percentile(all, percentiles[i]);
+    if (found < expected || (found - expected) / LOG_HISTOGRAM_SUB_BUCKETS > expected / LOG_HISTOGRAM_SUB_BUCKETS) {
+      lf_print_error_and_exit("Expected percentile %f to be about %lld but got %lld.", percentiles[i],
+                              (long long)expected, (long long)found);
+    }
+    if (log_histogram_percentile(first, percentiles[i]) != found) {
+      lf_print_error_and_exit("Merged histogram differs at percentile %f.", percentiles[i]);
+    }
+  }
+  if (all->count != N || all->min != values[0] || all->max != values[N - 1] || first->total != all->total) {
+    lf_print_error_and_exit("Histogram totals are wrong.");
+  }
+  log_histogram_clear(all);
+  if (all->count != 0 || log_histogram_percentile(all, 50.0) != 0) {
+    lf_print_error_and_exit("Cleared histogram is not empty.");
+  }
+  free(all);
+  free(first);
+  free(second);
+}
+
+/**
+ * @brief Check that negative values keep their own distribution instead of being counted with the smallest values.
+ */
+void test_negative_values() {
+  for (int bucket = 1; bucket < LOG_HISTOGRAM_NUM_BUCKETS; bucket++) {
+    if (log_histogram_bucket_min(bucket) != log_histogram_bucket_max(bucket - 1) + 1) {
+      lf_print_error_and_exit("Bucket %d does not start after the bucket before it.", bucket);
+    }
+  }
+  log_histogram_t* histogram = (log_histogram_t*)calloc(1, sizeof(log_histogram_t));
+  for (int i = 0; i < N; i++) {
+    values[i] = random_value();
+    if (i % 3 == 0) {
+      values[i] = -values[i];
+    }
+    log_histogram_record(histogram, values[i]);
+  }
+  log_histogram_record(histogram, INT64_MIN);
+  log_histogram_record(histogram, INT64_MAX);
+  qsort(values, N, sizeof(int64_t), compare);
+  double percentiles[] = {1.0, 10.0, 25.0, 50.0, 90.0, 99.0};
+  for (size_t i = 0; i < sizeof(percentiles) / sizeof(double); i++) {
+    // The extreme values recorded above shift the ranks of the others by one.
+    int64_t expected = values[(int)(percentiles[i] / 100.0 * (N + 2) + 0.5) - 2];
+    int64_t found = log_histogram_percentile(histogram, percentiles[i]);
+    int64_t magnitude = expected < 0 ? -expected : expected;
+    if (found < expected || (found - expected) / LOG_HISTOGRAM_SUB_BUCKETS > magnitude / LOG_HISTOGRAM_SUB_BUCKETS) {
+      lf_print_error_and_exit("Expected percentile %f to be about %lld but got %lld.", percentiles[i],
+                              (long long)expected, (long long)found);
+    }
+  }
+  if (log_histogram_percentile(histogram, 0.0) > INT64_MIN / 2 ||
+      log_histogram_percentile(histogram, 100.0) != INT64_MAX) {
+    lf_print_error_and_exit("The extreme percentiles are not about the extreme values.");
+  }
+  log_histogram_clear(histogram);
+  log_histogram_record(histogram, -5);
+  log_histogram_record(histogram, 3);
+  if (log_histogram_percentile(histogram, 50.0) != -5 || histogram->buckets[0] != 0) {
+    lf_print_error_and_exit("A negative value was counted with the smallest nonnegative values.");
+  }
+  free(histogram);
+}
+
+/**
+ * @brief Check that a histogram of nonnegative values reports the same percentiles as a full histogram.
+ */
+void test_nonnegative_values() {
+  log_histogram_t* all = (log_histogram_t*)calloc(1, sizeof(log_histogram_t));
+  log_histogram_nonnegative_t* first = (log_histogram_nonnegative_t*)calloc(1, sizeof(log_histogram_nonnegative_t));
+  log_histogram_nonnegative_t* second = (log_histogram_nonnegative_t*)calloc(1, sizeof(log_histogram_nonnegative_t));
+  for (int i = 0; i < N; i++) {
+    int64_t value = random_value();
+    value = value < 0 ? -value : value;
+    log_histogram_record(all, value);
+    log_histogram_nonnegative_record(i % 2 ? first : second, value);
+  }
+  log_histogram_nonnegative_merge(first, second);
+  double percentiles[] = {0.0, 1.0, 50.0, 99.0, 100.0};
+  for (size_t i = 0; i < sizeof(percentiles) / sizeof(double); i++) {
+    if (log_histogram_nonnegative_percentile(first, percentiles[i]) != log_histogram_percentile(all, percentiles[i])) {
+      lf_print_error_and_exit("Percentile %f of the nonnegative histogram differs from that of the full histogram.",
+                              percentiles[i]);
+    }
+  }
+  if (first->count != all->count || first->total != all->total || first->min != all->min || first->max != all->max) {
+    lf_print_error_and_exit("The merged nonnegative histogram does not have the statistics of all values.");
+  }
+  log_histogram_nonnegative_clear(first);
+  log_histogram_nonnegative_record(first, -7);
+  if (first->count != 1 || first->min != 0 || first->buckets[0] != 1) {
+    lf_print_error_and_exit("A negative value was not recorded as 0 in a nonnegative histogram.");
+  }
+  free(all);
+  free(first);
+  free(second);
+}
+
+int main() {
+  srand(RANDOM_SEED);
+  test_buckets();
+  test_percentiles();
+  test_negative_values();
+  test_nonnegative_values();
+  return 0;
+}
@@ -11,12 +11,46 @@
 
 environment_t _env;
 
+void lf_create_environments(void) {}
 void _lf_initialize_trigger_objects(void) {}
+#ifndef FEDERATED
+// The federate defines its own.
 void lf_terminate_execution(void) {}
+#endif
 void lf_set_default_command_line_options(void) {}
-void _lf_initialize_watchdogs(environment_t** envs) { (void)envs; }
 void logical_tag_complete(tag_t tag_to_send) { (void)tag_to_send; }
 int _lf_get_environments(environment_t** envs) {
   *envs = &_env;
   return 1;
 }
+
+#ifdef FEDERATED
+#include "federate.h"
+#include "net_util.h"
+
+/** Number of entries in the tables of network ports, which tests fill in and size as they need. */
+#define STUB_NETWORK_PORTS 8
+
+lf_action_base_t* _lf_action_table[STUB_NETWORK_PORTS];
+interval_t _lf_action_delay_table[STUB_NETWORK_PORTS];
+size_t _lf_action_table_size = 0;
+lf_action_base_t* _lf_zero_delay_cycle_action_table[STUB_NETWORK_PORTS];
+size_t _lf_zero_delay_cycle_action_table_size = 0;
+reaction_t* network_input_reactions[STUB_NETWORK_PORTS];
+size_t num_network_input_reactions = 0;
+reaction_t* port_absent_reaction[STUB_NETWORK_PORTS];
+size_t num_port_absent_reactions = 0;
+#ifdef FEDERATED_DECENTRALIZED
+staa_t* staa_lst[STUB_NETWORK_PORTS];
+size_t staa_lst_size = 0;
+#endif
+
+/** Declare no connections to other federates. */
+void lf_send_neighbor_structure_to_RTI(net_abstraction_t net) {
+  unsigned char buffer[MSG_TYPE_NEIGHBOR_STRUCTURE_HEADER_SIZE];
+  buffer[0] = MSG_TYPE_NEIGHBOR_STRUCTURE;
+  encode_int32(0, &buffer[1]);
+  encode_int32(0, &buffer[1 + sizeof(int32_t)]);
+  write_to_net_fail_on_error(net, sizeof(buffer), buffer, NULL, "Failed to send the neighbor structure to the RTI.");
+}
+#endif // FEDERATED
@@ -78,6 +78,13 @@ typedef enum {
   receive_ADR_QR_REP,
   receive_DNET,
   receive_UNIDENTIFIED,
+  // Phases of startup, recorded at their end with their duration as the extra delay
+  startup_connect_to_rti,
+  startup_clock_sync,
+  startup_connect_to_federate,
+  startup_start_time,
+  startup_federate_handshake,
+  startup_accept_federates,
   NUM_EVENT_TYPES
 } trace_event_t;
 
@@ -146,6 +153,13 @@ static const char* trace_event_names[] = {
     "Receiving ADR_QR_REP",
     "Receiving DNET",
     "Receiving UNIDENTIFIED",
+    // Phases of startup
+    "Startup connecting to RTI",
+    "Startup clock synchronization",
+    "Startup connecting to federate",
+    "Startup getting start time",
+    "Startup federate handshake",
+    "Startup accepting federates",
 };
 
 static inline void _suppress_unused_variable_warning_for_static_variable() { (void)trace_event_names; }
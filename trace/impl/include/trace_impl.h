@@ -1,14 +1,31 @@
+#include <stddef.h>
+
 #include "trace.h"
 
 // FIXME: Target property should specify the capacity of the trace buffer.
 #define TRACE_BUFFER_CAPACITY 2048
 
-/** Size of the table of trace objects. */
+/** Initial size of the table of trace objects. The table grows as needed. */
 #define TRACE_OBJECT_TABLE_SIZE 1024
 
 /** Max length of trace file name*/
 #define TRACE_MAX_FILENAME_LENGTH 128
 
+/**
+ * @brief Hash a pointer that identifies a trace object.
+ *
+ * Trace objects are identified by the addresses of self structs, triggers, and strings, whose
+ * low-order bits are mostly zero because of alignment. This mixes the higher-order bits into the
+ * low-order bits, which select the bucket in a hashmap.
+ */
+static inline size_t trace_object_hash(void* pointer) {
+  size_t hash = (size_t)pointer >> 3;
+  hash ^= hash >> 16;
+  hash *= 0x45d9f3bu;
+  hash ^= hash >> 16;
+  return hash;
+}
+
 // TYPE DEFINITIONS **********************************************************
 
 /**
@@ -38,9 +55,12 @@ typedef struct trace_t {
   char filename[TRACE_MAX_FILENAME_LENGTH];
 
   /** Table of pointers to a description of the object. */
-  object_description_t _lf_trace_object_descriptions[TRACE_OBJECT_TABLE_SIZE];
+  object_description_t* _lf_trace_object_descriptions;
   size_t _lf_trace_object_descriptions_size;
 
+  /** Number of entries allocated for the table of descriptions. */
+  size_t _lf_trace_object_descriptions_capacity;
+
   /** Indicator that the trace header information has been written to the file. */
   bool _lf_trace_header_written;
 
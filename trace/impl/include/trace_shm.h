@@ -0,0 +1,157 @@
+/**
+ * @file trace_shm.h
+ * @brief Layout of the shared-memory segment written by the shared-memory trace backend.
+ * @ingroup Tracing
+ *
+ * The shared-memory trace backend (`trace_shm_impl.c`) is an alternative implementation of `trace.h`
+ * that, instead of writing a `.lft` file, publishes every trace record into a ring buffer in a POSIX
+ * shared-memory segment so that other processes can consume the trace while the program is running.
+ * This header is shared between that backend and its consumers (see `util/tracing/trace_shm_to_influxdb.c`).
+ *
+ * The segment consists of a @ref trace_shm_header_t, followed by a table of
+ * @ref trace_shm_object_t entries, followed by a ring of @ref trace_shm_slot_t records.
+ * Producers never block on consumers. When the ring wraps around, the oldest records are overwritten,
+ * and a consumer that falls behind detects this by the sequence number stored in each slot.
+ */
+
+#ifndef TRACE_SHM_H
+#define TRACE_SHM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+/** Magic number identifying a live trace segment ("LFTS"). */
+#define TRACE_SHM_MAGIC 0x4C465453
+
+/** Version of the segment layout. Increment this if any of the structs below change. */
+#define TRACE_SHM_VERSION 1
+
+/** Number of records in the ring. This must be a power of two. */
+#ifndef TRACE_SHM_CAPACITY
+#define TRACE_SHM_CAPACITY 65536
+#endif
+
+/** Number of entries in the table of trace object descriptions. */
+#ifndef TRACE_SHM_OBJECT_TABLE_SIZE
+#define TRACE_SHM_OBJECT_TABLE_SIZE 4096
+#endif
+
+/** Maximum length of a description in the object table, including the null terminator. */
+#define TRACE_SHM_DESCRIPTION_LENGTH 128
+
+/** Max length of the name of a shared-memory segment. */
+#define TRACE_SHM_MAX_NAME_LENGTH 128
+
+/**
+ * @brief Header at the start of the shared-memory segment.
+ * @ingroup Tracing
+ *
+ * The fields that change while the program runs are accessed only with atomic operations.
+ */
+typedef struct trace_shm_header_t {
+  /** Set to TRACE_SHM_MAGIC (with release semantics) once the rest of the header is valid. */
+  uint32_t magic;
+
+  /** Layout version. Must equal TRACE_SHM_VERSION. */
+  uint32_t version;
+
+  /** Number of slots in the ring. */
+  uint64_t capacity;
+
+  /** Number of entries available in the object table. */
+  uint64_t object_table_capacity;
+
+  /** The start time of the program, or 0 if it has not been set yet. */
+  int64_t start_time;
+
+  /** The ID of the process (federate ID, -1 for the RTI, 0 if unfederated). */
+  int32_t process_id;
+
+  /** Nonzero once the traced program has shut down tracing. */
+  int32_t stopped;
+
+  /** Number of valid entries in the object table. */
+  uint64_t object_table_size;
+
+  /**
+   * Total number of records claimed by producers since the start.
+   * The record with sequence number i is stored in slot i % capacity.
+   */
+  uint64_t write_index;
+
+  /** The name of the process, null terminated. */
+  char process_name[TRACE_SHM_MAX_NAME_LENGTH];
+} trace_shm_header_t;
+
+/**
+ * @brief Entry of the object table in the shared-memory segment.
+ * @ingroup Tracing
+ */
+typedef struct trace_shm_object_t {
+  void* pointer;
+  void* trigger;
+  _lf_trace_object_t type;
+  /** Null-terminated description, truncated to fit. */
+  char description[TRACE_SHM_DESCRIPTION_LENGTH];
+} trace_shm_object_t;
+
+/**
+ * @brief A slot in the ring of trace records.
+ * @ingroup Tracing
+ *
+ * A slot holding record i has `sequence == i + 1`. A producer writing into the slot first sets
+ * `sequence` to 0, so a consumer that reads the same sequence number before and after copying the
+ * record knows that the copy is not torn.
+ */
+typedef struct trace_shm_slot_t {
+  uint64_t sequence;
+  trace_record_nodeps_t record;
+} trace_shm_slot_t;
+
+/**
+ * @brief Return a pointer to the object table of the given segment.
+ * @ingroup Tracing
+ */
+static inline trace_shm_object_t* trace_shm_objects(trace_shm_header_t* header) {
+  return (trace_shm_object_t*)(header + 1);
+}
+
+/**
+ * @brief Return a pointer to the first slot of the ring of the given segment.
+ * @ingroup Tracing
+ */
+static inline trace_shm_slot_t* trace_shm_slots(trace_shm_header_t* header) {
+  return (trace_shm_slot_t*)(trace_shm_objects(header) + header->object_table_capacity);
+}
+
+/**
+ * @brief Return the total size in bytes of a segment with the given dimensions.
+ * @ingroup Tracing
+ */
+static inline size_t trace_shm_segment_size(uint64_t capacity, uint64_t object_table_capacity) {
+  return sizeof(trace_shm_header_t) + object_table_capacity * sizeof(trace_shm_object_t) +
+         capacity * sizeof(trace_shm_slot_t);
+}
+
+/**
+ * @brief Write into `name` the name of the shared-memory segment used by the given process.
+ * @ingroup Tracing
+ *
+ * The name mirrors the name of the trace file written by the default implementation,
+ * e.g. `/lf_trace_Foo_0` for federate 0 of program `Foo`, and `/lf_trace_rti` for the RTI.
+ * @param name The buffer into which to write the name, of length TRACE_SHM_MAX_NAME_LENGTH.
+ * @param process_name The name of the process as given to lf_tracing_global_init.
+ * @param process_id The ID of the process as given to lf_tracing_global_init.
+ */
+static inline void trace_shm_name(char* name, const char* process_name, int process_id) {
+  if (strcmp(process_name, "rti") == 0) {
+    snprintf(name, TRACE_SHM_MAX_NAME_LENGTH, "/lf_trace_%s", process_name);
+  } else {
+    snprintf(name, TRACE_SHM_MAX_NAME_LENGTH, "/lf_trace_%s_%d", process_name, process_id);
+  }
+}
+
+#endif // TRACE_SHM_H
@@ -9,6 +9,17 @@
 #include "logging_macros.h"
 #include "trace_impl.h"
 
+// Hashmap from the pointer identifying a trace object to its index in the object table.
+#define HASHMAP(token) trace_object_map##_##token
+#define K void*
+#define V size_t
+#define HASH_OF(key) trace_object_hash(key)
+#include "impl/hashmap.h"
+#undef HASHMAP
+#undef K
+#undef V
+#undef HASH_OF
+
 /** Macro to use when access to trace file fails. */
 #define _LF_TRACE_FAILURE(trace)                                                                                       \
   do {                                                                                                                 \
@@ -22,6 +33,10 @@
 
 static lf_platform_mutex_ptr_t trace_mutex = NULL;
 static trace_t trace;
+/** Index in the object table of each registered reactor and user-defined trace object. */
+static trace_object_map_t* object_indices = NULL;
+/** Index in the object table of each registered trigger. */
+static trace_object_map_t* trigger_indices = NULL;
 static int process_id;
 static int64_t start_time;
 static version_t version = {.build_config =
@@ -156,6 +171,14 @@ static void start_trace(trace_t* t, int max_num_local_threads) {
   t->_lf_trace_buffer_size = (size_t*)calloc(t->_lf_number_of_trace_buffers + 1, sizeof(size_t));
   t->_lf_trace_buffer_size++;
 
+  // Allocate the table of object descriptions, which grows as objects are registered.
+  t->_lf_trace_object_descriptions =
+      (object_description_t*)malloc(sizeof(object_description_t) * TRACE_OBJECT_TABLE_SIZE);
+  t->_lf_trace_object_descriptions_capacity = TRACE_OBJECT_TABLE_SIZE;
+  t->_lf_trace_object_descriptions_size = 0;
+  object_indices = trace_object_map_new(2 * TRACE_OBJECT_TABLE_SIZE, NULL);
+  trigger_indices = trace_object_map_new(2 * TRACE_OBJECT_TABLE_SIZE, NULL);
+
   t->_lf_trace_stop = 0;
   LF_PRINT_DEBUG("Started tracing.");
 }
@@ -210,12 +233,34 @@ const version_t* lf_version_tracing() { return &version; }
 
 void lf_tracing_register_trace_event(object_description_t description) {
   lf_platform_mutex_lock(trace_mutex);
-  if (trace._lf_trace_object_descriptions_size >= TRACE_OBJECT_TABLE_SIZE) {
+  // Triggers share the pointer of their reactor, so they are identified by the trigger pointer.
+  trace_object_map_t* indices = (description.type == trace_trigger) ? trigger_indices : object_indices;
+  void* key = (description.type == trace_trigger) ? description.trigger : description.pointer;
+  size_t index;
+  if (key != NULL && trace_object_map_find(indices, key, &index)) {
+    // The object is already registered (e.g., a user-defined trace event registered by
+    // every member of a bank). Replace its description rather than adding a duplicate.
+    trace._lf_trace_object_descriptions[index] = description;
     lf_platform_mutex_unlock(trace_mutex);
-    fprintf(stderr, "WARNING: Exceeded trace object table size. Trace file will be incomplete.\n");
     return;
   }
-  trace._lf_trace_object_descriptions[trace._lf_trace_object_descriptions_size++] = description;
+  if (trace._lf_trace_object_descriptions_size >= trace._lf_trace_object_descriptions_capacity) {
+    size_t capacity = trace._lf_trace_object_descriptions_capacity * 2;
+    object_description_t* descriptions = (object_description_t*)realloc(trace._lf_trace_object_descriptions,
+                                                                        sizeof(object_description_t) * capacity);
+    if (descriptions == NULL) {
+      lf_platform_mutex_unlock(trace_mutex);
+      fprintf(stderr, "WARNING: Failed to grow trace object table. Trace file will be incomplete.\n");
+      return;
+    }
+    trace._lf_trace_object_descriptions = descriptions;
+    trace._lf_trace_object_descriptions_capacity = capacity;
+  }
+  index = trace._lf_trace_object_descriptions_size++;
+  trace._lf_trace_object_descriptions[index] = description;
+  if (key != NULL) {
+    trace_object_map_put(indices, key, index);
+  }
   lf_platform_mutex_unlock(trace_mutex);
 }
 
@@ -274,5 +319,9 @@ void lf_tracing_global_shutdown() {
     stop_trace(&trace);
     lf_platform_mutex_free(trace_mutex);
     trace_mutex = NULL;
+    free(trace._lf_trace_object_descriptions);
+    trace._lf_trace_object_descriptions = NULL;
+    trace_object_map_free(object_indices);
+    trace_object_map_free(trigger_indices);
   }
 }
@@ -0,0 +1,204 @@
+/**
+ * @file
+ * @brief Implementation of the trace API that publishes trace records into shared memory.
+ *
+ * This is an alternative to the default file-based implementation in `trace_impl.c`.
+ * Rather than buffering records per worker and flushing them to a `.lft` file, every tracepoint
+ * is written directly into a ring buffer in a POSIX shared-memory segment whose layout is given
+ * in `trace_shm.h`. A consumer such as `trace_shm_to_influxdb` can attach to the segment and
+ * export the records while the program is running.
+ *
+ * Producers never wait for consumers. If no consumer keeps up, the oldest records are overwritten.
+ * Shutdown unmaps the segment only once no thread is still writing through its mapping.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "platform.h"
+#include "logging_macros.h"
+#include "trace_shm.h"
+
+// PRIVATE DATA STRUCTURES ***************************************************
+
+static lf_platform_mutex_ptr_t trace_mutex = NULL;
+static trace_shm_header_t* header = NULL;
+static trace_shm_object_t* objects = NULL;
+static trace_shm_slot_t* slots = NULL;
+static size_t segment_size = 0;
+/** Number of threads between acquire_header() and release_header(). */
+static int writers_in_flight = 0;
+static char segment_name[TRACE_SHM_MAX_NAME_LENGTH];
+static version_t version = {.build_config =
+                                {
+                                    .single_threaded = TRIBOOL_DOES_NOT_MATTER,
+#ifdef NDEBUG
+                                    .build_type_is_debug = TRIBOOL_FALSE,
+#else
+                                    .build_type_is_debug = TRIBOOL_TRUE,
+#endif
+                                    .log_level = LOG_LEVEL,
+                                },
+                            .core_version_name = NULL};
+
+#if (TRACE_SHM_CAPACITY & (TRACE_SHM_CAPACITY - 1)) != 0
+#error "TRACE_SHM_CAPACITY must be a power of two."
+#endif
+
+// PRIVATE HELPERS ***********************************************************
+
+/**
+ * @brief Create the shared-memory segment and initialize its header.
+ * @return 0 on success, -1 on failure.
+ */
+static int create_segment(char* process_name, int process_id) {
+  trace_shm_name(segment_name, process_name, process_id);
+  // Remove a stale segment left behind by a previous run that did not shut down cleanly.
+  shm_unlink(segment_name);
+  int fd = shm_open(segment_name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "WARNING: Failed to create shared-memory segment %s with error code %d. No trace will be written.\n",
+            segment_name, errno);
+    return -1;
+  }
+  segment_size = trace_shm_segment_size(TRACE_SHM_CAPACITY, TRACE_SHM_OBJECT_TABLE_SIZE);
+  if (ftruncate(fd, (off_t)segment_size) != 0) {
+    fprintf(stderr, "WARNING: Failed to size shared-memory segment %s with error code %d. No trace will be written.\n",
+            segment_name, errno);
+    close(fd);
+    shm_unlink(segment_name);
+    return -1;
+  }
+  void* memory = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping remains valid after the file descriptor is closed.
+  close(fd);
+  if (memory == MAP_FAILED) {
+    fprintf(stderr, "WARNING: Failed to map shared-memory segment %s with error code %d. No trace will be written.\n",
+            segment_name, errno);
+    shm_unlink(segment_name);
+    return -1;
+  }
+  // ftruncate zero fills the segment, so only the nonzero fields need to be set.
+  header = (trace_shm_header_t*)memory;
+  header->version = TRACE_SHM_VERSION;
+  header->capacity = TRACE_SHM_CAPACITY;
+  header->object_table_capacity = TRACE_SHM_OBJECT_TABLE_SIZE;
+  header->process_id = process_id;
+  strncpy(header->process_name, process_name, TRACE_SHM_MAX_NAME_LENGTH - 1);
+  objects = trace_shm_objects(header);
+  slots = trace_shm_slots(header);
+  // Publish the header last so that consumers never see a partially initialized segment.
+  __atomic_store_n(&header->magic, TRACE_SHM_MAGIC, __ATOMIC_RELEASE);
+  LF_PRINT_DEBUG("Publishing trace records to shared-memory segment %s.", segment_name);
+  return 0;
+}
+
+/** @brief Release the header returned by acquire_header(). */
+static void release_header() { __atomic_fetch_sub(&writers_in_flight, 1, __ATOMIC_RELEASE); }
+
+/**
+ * @brief Return the header of the segment, which stays mapped until release_header() is called,
+ * or NULL if tracing is not running. If the result is not NULL, release_header() must be called.
+ */
+static trace_shm_header_t* acquire_header() {
+  // Sequentially consistent, so that either shutdown sees this thread in flight or this thread sees
+  // that shutdown has cleared the header.
+  __atomic_fetch_add(&writers_in_flight, 1, __ATOMIC_SEQ_CST);
+  trace_shm_header_t* result = __atomic_load_n(&header, __ATOMIC_SEQ_CST);
+  if (result == NULL) {
+    release_header();
+  }
+  return result;
+}
+
+// IMPLEMENTATION OF VERSION API *********************************************
+
+const version_t* lf_version_tracing() { return &version; }
+
+// IMPLEMENTATION OF TRACE API ***********************************************
+
+void lf_tracing_register_trace_event(object_description_t description) {
+  trace_shm_header_t* h = acquire_header();
+  if (h == NULL)
+    return;
+  lf_platform_mutex_lock(trace_mutex);
+  uint64_t size = h->object_table_size;
+  if (size >= h->object_table_capacity) {
+    lf_platform_mutex_unlock(trace_mutex);
+    release_header();
+    fprintf(stderr, "WARNING: Exceeded trace object table size. Trace will be incomplete.\n");
+    return;
+  }
+  trace_shm_object_t* entry = &objects[size];
+  entry->pointer = description.pointer;
+  entry->trigger = description.trigger;
+  entry->type = description.type;
+  strncpy(entry->description, description.description, TRACE_SHM_DESCRIPTION_LENGTH - 1);
+  entry->description[TRACE_SHM_DESCRIPTION_LENGTH - 1] = '\0';
+  // Consumers read only entries below object_table_size, so publish the entry after it is written.
+  __atomic_store_n(&h->object_table_size, size + 1, __ATOMIC_RELEASE);
+  lf_platform_mutex_unlock(trace_mutex);
+  release_header();
+}
+
+void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
+  (void)worker;
+  trace_shm_header_t* h = acquire_header();
+  if (h == NULL)
+    return;
+  // Claiming a sequence number is the only synchronization between producers,
+  // so threads created by the user need no special treatment here.
+  uint64_t index = __atomic_fetch_add(&h->write_index, 1, __ATOMIC_RELAXED);
+  trace_shm_slot_t* slot = &slots[index & (TRACE_SHM_CAPACITY - 1)];
+  // Mark the slot as being written before overwriting the record it holds.
+  __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->record = *tr;
+  __atomic_store_n(&slot->sequence, index + 1, __ATOMIC_RELEASE);
+  release_header();
+}
+
+void lf_tracing_global_init(char* process_name, char* process_names, int process_id, int max_num_local_threads) {
+  (void)process_names;
+  (void)max_num_local_threads;
+  trace_mutex = lf_platform_mutex_new();
+  if (!trace_mutex) {
+    fprintf(stderr, "WARNING: Failed to initialize trace mutex.\n");
+    exit(1);
+  }
+  create_segment(process_name, process_id);
+}
+
+void lf_tracing_set_start_time(int64_t time) {
+  trace_shm_header_t* h = acquire_header();
+  if (h != NULL) {
+    __atomic_store_n(&h->start_time, time, __ATOMIC_RELEASE);
+    release_header();
+  }
+}
+
+void lf_tracing_global_shutdown() {
+  if (trace_mutex == NULL)
+    return;
+  trace_shm_header_t* h = __atomic_exchange_n(&header, NULL, __ATOMIC_SEQ_CST);
+  if (h != NULL) {
+    // Threads still tracing hold the header. No thread acquires it any more, so this wait is short.
+    while (__atomic_load_n(&writers_in_flight, __ATOMIC_SEQ_CST) != 0) {
+      sched_yield();
+    }
+    __atomic_store_n(&h->stopped, 1, __ATOMIC_RELEASE);
+    munmap(h, segment_size);
+    // Consumers that are attached keep their mapping and can drain the remaining records.
+    shm_unlink(segment_name);
+    LF_PRINT_DEBUG("Stopped tracing.");
+  }
+  lf_platform_mutex_free(trace_mutex);
+  trace_mutex = NULL;
+}
@@ -71,16 +71,21 @@ typedef struct influx_v2_client_t {
 } influx_v2_client_t;
 
 /**
- * @brief Format a line for InfluxDB.
+ * @brief Format a line for InfluxDB and append it to a buffer.
  * @ingroup Tracing
  *
- * @param buf Returned pointer to the formatted line.
- * @param len Returned length of the formatted line.
- * @param used Number of bytes used in the formatted line.
+ * If `*buf` is NULL, a new buffer is allocated. Otherwise, the line is appended
+ * after the first `used` bytes of `*buf`, which is reallocated as needed.
+ * This allows many lines to be accumulated into one batch.
+ *
+ * @param buf Pointer to the buffer, which may be reallocated.
+ * @param len Pointer to the allocated size of the buffer, which is updated.
+ * @param used Number of bytes already used in the buffer.
  * @param ... Formatting arguments.
- * @return int 0 on success, -1 on failure.
+ * @return The number of bytes used in the buffer on success, a negative number on failure
+ * (in which case the buffer has been freed and set to NULL).
  */
-int format_line(char** buf, int* len, size_t used, ...);
+int format_line(char** buf, size_t* len, size_t used, ...);
 
 /**
  * @brief Post a line to InfluxDB via HTTP.
@@ -112,6 +117,16 @@ int send_udp(influx_client_t* c, ...);
  */
 int post_curl(influx_v2_client_t* c, ...);
 
+/**
+ * @brief Post one or more already formatted lines to InfluxDB v2 via HTTP.
+ * @ingroup Tracing
+ *
+ * @param c InfluxDB v2 client.
+ * @param data The lines to post, in line protocol, null terminated.
+ * @return int 0 (CURLE_OK) on success, a curl error code on failure.
+ */
+int post_curl_send_lines(influx_v2_client_t* c, const char* data);
+
 #define IF_TYPE_ARG_END 0
 #define IF_TYPE_MEAS 1
 #define IF_TYPE_TAG 2
@@ -337,7 +352,15 @@ int post_curl(influx_v2_client_t* c, ...) {
   va_start(ap, c);
   len = _format_line((char**)&data, ap);
   va_end(ap);
+  if (len < 0)
+    return -1;
+
+  int res = post_curl_send_lines(c, data);
+  free(data);
+  return res;
+}
 
+int post_curl_send_lines(influx_v2_client_t* c, const char* data) {
   CURL* curl;
 
   /* In windows, this will init the winsock stuff */
@@ -350,12 +373,12 @@ int post_curl(influx_v2_client_t* c, ...) {
     return CURLE_FAILED_INIT;
   }
 
-  char* url_string = (char*)malloc(len);
-  snprintf(url_string, len, "http://%s:%d/api/v2/write?org=%s&bucket=%s&precision=%s", c->host ? c->host : "localhost",
-           c->port ? c->port : 8086, c->org, c->bucket, c->precision ? c->precision : "ns");
+  char url_string[512];
+  snprintf(url_string, sizeof(url_string), "http://%s:%d/api/v2/write?org=%s&bucket=%s&precision=%s",
+           c->host ? c->host : "localhost", c->port ? c->port : 8086, c->org, c->bucket,
+           c->precision ? c->precision : "ns");
 
   curl_easy_setopt(curl, CURLOPT_URL, url_string);
-  free(url_string);
 
   char token_string[120];
   snprintf(token_string, sizeof(token_string), "Authorization: Token %s", c->token);
@@ -374,21 +397,18 @@ int post_curl(influx_v2_client_t* c, ...) {
     fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
   }
 
-  free(data);
+  curl_slist_free_all(list);
   curl_easy_cleanup(curl);
   curl_global_cleanup();
   return res;
 }
 
-int format_line(char** buf, int* len, size_t used, ...) {
+int format_line(char** buf, size_t* len, size_t used, ...) {
   va_list ap;
   va_start(ap, used);
-  used = _format_line2(buf, ap, (size_t*)len, used);
+  int result = _format_line2(buf, ap, len, used);
   va_end(ap);
-  if (*len < 0)
-    return -1;
-  else
-    return used;
+  return result;
 }
 
 int _begin_line(char** buf) {
@@ -409,12 +429,14 @@ int _format_line2(char** buf, va_list ap, size_t* _len, size_t used) {
   for (;;) {                                                                                                           \
     if ((written = snprintf(*buf + used, len - used, ##fmter)) < 0)                                                    \
       goto FAIL;                                                                                                       \
-    if (used + written >= len && !(*buf = (char*)realloc(*buf, len *= 2)))                                             \
-      return -1;                                                                                                       \
-    else {                                                                                                             \
-      used += written;                                                                                                 \
-      break;                                                                                                           \
+    if (used + written >= len) {                                                                                       \
+      /* The output was truncated. Grow the buffer and format again. */                                                \
+      if (!(*buf = (char*)realloc(*buf, len *= 2)))                                                                    \
+        return -1;                                                                                                     \
+      continue;                                                                                                        \
     }                                                                                                                  \
+    used += written;                                                                                                   \
+    break;                                                                                                             \
   }
 
   size_t len = *_len;
@@ -498,15 +520,17 @@ int _escaped_append(char** dest, size_t* len, size_t* used, const char* src, con
 
   for (;;) {
     if ((i = strcspn(src, escape_seq)) > 0) {
-      if (*used + i > *len && !(*dest = (char*)realloc(*dest, (*len) *= 2)))
-        return -1;
+      while (*used + i > *len)
+        if (!(*dest = (char*)realloc(*dest, (*len) *= 2)))
+          return -1;
       strncpy(*dest + *used, src, i);
       *used += i;
       src += i;
     }
     if (*src) {
-      if (*used + 2 > *len && !(*dest = (char*)realloc(*dest, (*len) *= 2)))
-        return -2;
+      while (*used + 2 > *len)
+        if (!(*dest = (char*)realloc(*dest, (*len) *= 2)))
+          return -2;
       (*dest)[(*used)++] = '\\';
       (*dest)[(*used)++] = *src++;
     } else
@@ -0,0 +1,391 @@
+/**
+ * @file
+ *
+ * @brief Standalone program that tails the trace of a running Lingua Franca program and sends it to InfluxDB.
+ *
+ * Unlike `trace_to_influxdb`, which converts a `.lft` file after the program has exited,
+ * this program attaches to the shared-memory segment published by the shared-memory trace
+ * backend (`trace/impl/src/trace_shm_impl.c`) and continuously exports trace records while
+ * the program runs. It exits when the traced program shuts down tracing.
+ *
+ * ## Compiling this Program
+ *
+ * To compile this program, simply do this in this source directory:
+ * ```
+ *    make trace_shm_to_influxdb
+ * ```
+ *
+ * ## Producing a Live Trace
+ *
+ * Build the Lingua Franca program with tracing enabled and the shared-memory trace backend selected,
+ * e.g. by passing `-DLF_TRACE_BACKEND=shm` to CMake (for the RTI, pass the same option when building it).
+ * While the program runs, it publishes its trace in a shared-memory segment named
+ * `/lf_trace_<name>_<federate ID>` (or `/lf_trace_rti` for the RTI), where `<name>` is the
+ * name that would otherwise be used for the `.lft` file.
+ *
+ * ## Exporting the Trace
+ *
+ * ```shell
+ *     trace_shm_to_influxdb /lf_trace_Foo_0 --token TOKEN
+ * ```
+ * See `trace_to_influxdb.c` for how to set up InfluxDB and obtain a token. Records are batched
+ * and posted at most once per flush interval. Use `--stdout` to print the InfluxDB line protocol
+ * instead, for example to pipe it into another collector.
+ *
+ * If the program produces records faster than they can be exported, the oldest records in the
+ * ring are overwritten. The number of records lost this way is reported on exit.
+ */
+#define LF_TRACE
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "reactor.h"
+#include "trace.h"
+#include "trace_util.h"
+#include "trace_shm.h"
+#include "influxdb.h"
+
+/** Interval between polls of the ring buffer when it is empty. */
+#define POLL_INTERVAL_MSEC 10
+
+/** File containing the trace binary data. Unused, but required by trace_util.c. */
+FILE* trace_file = NULL;
+
+/** Struct identifying the influx client. */
+influx_v2_client_t influx_v2_client;
+
+/** Indicator to print line protocol to stdout rather than posting to InfluxDB. */
+bool print_only = false;
+
+/** Maximum time between posts to InfluxDB, in milliseconds. */
+long flush_interval_msec = 1000;
+
+/** Maximum number of lines posted to InfluxDB at once. */
+size_t max_batch_lines = 5000;
+
+/**
+ * Print a usage message.
+ */
+void usage() {
+  printf("\nUsage: trace_shm_to_influxdb [options] segment_name [options]\n\n");
+  printf("\nOptions: \n\n");
+  printf("   -t, --token TOKEN\n");
+  printf("   The token for access to InfluxDB (required unless --stdout is given).\n\n");
+  printf("   -h, --host HOSTNAME\n");
+  printf("   The host name for access to InfluxDB (default is 'localhost').\n\n");
+  printf("   -p, --port PORT\n");
+  printf("   The port for access to InfluxDB (default is 8086).\n\n");
+  printf("   -o, --ort ORGANIZATION\n");
+  printf("   The organization for access to InfluxDB (default is 'iCyPhy').\n\n");
+  printf("   -b, --bucket BUCKET\n");
+  printf("   The bucket into which to put the data (default is 'test').\n\n");
+  printf("   -i, --interval MSEC\n");
+  printf("   The maximum time between posts to InfluxDB in milliseconds (default is 1000).\n\n");
+  printf("   -n, --stdout\n");
+  printf("   Print InfluxDB line protocol to standard output instead of posting it.\n\n");
+  printf("\n\n");
+}
+
+/**
+ * Return the current time of the monotonic clock in milliseconds.
+ */
+static long now_msec() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long)now.tv_sec * 1000L + now.tv_nsec / 1000000L;
+}
+
+/**
+ * Sleep for the given number of milliseconds.
+ */
+static void sleep_msec(long msec) {
+  struct timespec duration = {.tv_sec = msec / 1000, .tv_nsec = (msec % 1000) * 1000000L};
+  nanosleep(&duration, NULL);
+}
+
+/**
+ * Attach to the named shared-memory segment, waiting until it exists and is initialized.
+ * @return The header of the mapped segment.
+ */
+static trace_shm_header_t* attach(const char* name) {
+  bool reported = false;
+  int fd;
+  while ((fd = shm_open(name, O_RDONLY, 0)) < 0) {
+    if (errno != ENOENT) {
+      fprintf(stderr, "ERROR: Failed to open shared-memory segment %s: %s.\n", name, strerror(errno));
+      exit(1);
+    }
+    if (!reported) {
+      fprintf(stderr, "Waiting for shared-memory segment %s.\n", name);
+      reported = true;
+    }
+    sleep_msec(100);
+  }
+  // Map the header first to find the size of the whole segment.
+  struct stat info;
+  while (fstat(fd, &info) == 0 && (size_t)info.st_size < sizeof(trace_shm_header_t)) {
+    sleep_msec(POLL_INTERVAL_MSEC);
+  }
+  trace_shm_header_t* header = mmap(NULL, sizeof(trace_shm_header_t), PROT_READ, MAP_SHARED, fd, 0);
+  if (header == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Failed to map shared-memory segment %s: %s.\n", name, strerror(errno));
+    exit(1);
+  }
+  while (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != TRACE_SHM_MAGIC) {
+    sleep_msec(POLL_INTERVAL_MSEC);
+  }
+  if (header->version != TRACE_SHM_VERSION) {
+    fprintf(stderr, "ERROR: Shared-memory segment %s has version %u, but version %d is expected.\n", name,
+            header->version, TRACE_SHM_VERSION);
+    exit(1);
+  }
+  size_t size = trace_shm_segment_size(header->capacity, header->object_table_capacity);
+  munmap(header, sizeof(trace_shm_header_t));
+  header = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (header == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Failed to map shared-memory segment %s: %s.\n", name, strerror(errno));
+    exit(1);
+  }
+  fprintf(stderr, "Attached to trace of %s (ID %d) with %llu slots.\n", header->process_name, header->process_id,
+          (unsigned long long)header->capacity);
+  return header;
+}
+
+/**
+ * Copy newly registered entries of the object table in shared memory into object_table.
+ */
+static void update_object_table(trace_shm_header_t* header) {
+  int size = (int)__atomic_load_n(&header->object_table_size, __ATOMIC_ACQUIRE);
+  if (size <= object_table_size)
+    return;
+  object_table = realloc(object_table, size * sizeof(object_description_t));
+  if (object_table == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  trace_shm_object_t* objects = trace_shm_objects(header);
+  for (int i = object_table_size; i < size; i++) {
+    object_table[i].pointer = objects[i].pointer;
+    object_table[i].trigger = objects[i].trigger;
+    object_table[i].type = objects[i].type;
+    object_table[i].description = strdup(objects[i].description);
+    if (top_level == NULL) {
+      top_level = object_table[i].description;
+    }
+  }
+  object_table_size = size;
+  index_object_table();
+}
+
+/**
+ * Append the given record to the batch in InfluxDB line protocol.
+ * @return The number of bytes used in the batch or a negative number on failure.
+ */
+static int append_record(char** batch, size_t* batch_size, size_t used, trace_record_nodeps_t* record) {
+  char reaction_name[12] = "none";
+  if (record->dst_id >= 0) {
+    snprintf(reaction_name, sizeof(reaction_name), "%d", record->dst_id);
+  }
+  char* reactor_name = get_object_description(record->pointer, NULL);
+  if (reactor_name == NULL) {
+    reactor_name = "NO REACTOR";
+  }
+  char* trigger_name = get_trigger_name(record->trigger, NULL);
+  if (trigger_name == NULL) {
+    trigger_name = "NO TRIGGER";
+  }
+  return format_line(batch, batch_size, used, INFLUX_MEAS(trace_event_names[record->event_type]),
+                     INFLUX_TAG("Reactor", reactor_name), INFLUX_TAG("Reaction", reaction_name),
+                     INFLUX_F_INT("Worker", record->src_id), INFLUX_F_INT("Logical Time", record->logical_time),
+                     INFLUX_F_INT("Microstep", record->microstep), INFLUX_F_STR("Trigger Name", trigger_name),
+                     INFLUX_F_INT("Extra Delay", record->extra_delay),
+                     INFLUX_F_INT("Lag", record->physical_time - record->logical_time),
+                     INFLUX_TS(record->physical_time), INFLUX_END);
+}
+
+/**
+ * Post or print the batch.
+ * @return 0 on success, nonzero on failure.
+ */
+static int flush_batch(const char* batch, size_t used) {
+  if (used == 0)
+    return 0;
+  if (print_only) {
+    fwrite(batch, 1, used, stdout);
+    fflush(stdout);
+    return 0;
+  }
+  int response_code = post_curl_send_lines(&influx_v2_client, batch);
+  if (response_code != 0) {
+    fprintf(stderr, "****** response code: %d\n", response_code);
+  }
+  return response_code;
+}
+
+/**
+ * Tail the ring buffer of the given segment until the traced program stops.
+ */
+static void tail(trace_shm_header_t* header) {
+  trace_shm_slot_t* slots = trace_shm_slots(header);
+  uint64_t capacity = header->capacity;
+  // Start with the oldest record that is still in the ring.
+  uint64_t next = __atomic_load_n(&header->write_index, __ATOMIC_ACQUIRE);
+  next = next > capacity ? next - capacity : 0;
+  uint64_t exported = 0, dropped = 0;
+
+  char* batch = NULL;
+  size_t batch_size = 0;
+  int used = 0;
+  size_t batch_lines = 0;
+  long last_flush = now_msec();
+
+  while (true) {
+    update_object_table(header);
+    bool stopped = __atomic_load_n(&header->stopped, __ATOMIC_ACQUIRE) != 0;
+    uint64_t claimed = __atomic_load_n(&header->write_index, __ATOMIC_ACQUIRE);
+    if (claimed - next > capacity) {
+      // Producers have overwritten records that were not yet exported.
+      dropped += claimed - capacity - next;
+      next = claimed - capacity;
+    }
+    bool progress = false;
+    while (next < claimed && batch_lines < max_batch_lines) {
+      trace_shm_slot_t* slot = &slots[next & (capacity - 1)];
+      uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+      if (sequence != next + 1) {
+        // Either the record is still being written or it has already been overwritten.
+        // Reading write_index again on the next iteration tells which.
+        break;
+      }
+      trace_record_nodeps_t record = slot->record;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence) {
+        // Overwritten while copying.
+        break;
+      }
+      next++;
+      progress = true;
+      // Ignore federated traces.
+      if (record.event_type > federated)
+        continue;
+      used = append_record(&batch, &batch_size, used, &record);
+      if (used < 0) {
+        fprintf(stderr, "ERROR: Failed to format trace record.\n");
+        exit(4);
+      }
+      batch_lines++;
+    }
+    bool drained = next >= claimed;
+    if (batch_lines >= max_batch_lines || (batch_lines > 0 && (now_msec() - last_flush >= flush_interval_msec ||
+                                                               (stopped && drained)))) {
+      if (flush_batch(batch, used) != 0) {
+        exit(5);
+      }
+      exported += batch_lines;
+      batch_lines = 0;
+      used = 0;
+      last_flush = now_msec();
+    }
+    if (stopped && (drained || !progress)) {
+      // A record that was claimed but never completed before shutdown is lost.
+      dropped += claimed - next;
+      break;
+    }
+    if (!progress) {
+      sleep_msec(POLL_INTERVAL_MSEC);
+    }
+  }
+  free(batch);
+  // Report on stderr so that the report does not mix with line protocol printed with --stdout.
+  fprintf(stderr, "***** %llu records exported, %llu records lost.\n", (unsigned long long)exported,
+          (unsigned long long)dropped);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    usage();
+    exit(0);
+  }
+  // Defaults.
+  influx_v2_client.token = NULL;
+  influx_v2_client.host = "localhost";
+  influx_v2_client.port = 8086;
+  influx_v2_client.org = "iCyPhy";
+  influx_v2_client.bucket = "test";
+
+  char* segment = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp("-t", argv[i]) == 0 || strcmp("--token", argv[i]) == 0) {
+      if (i++ == argc - 1) {
+        usage();
+        fprintf(stderr, "No token specified.\n");
+        exit(1);
+      }
+      influx_v2_client.token = argv[i];
+    } else if (strcmp("-h", argv[i]) == 0 || strcmp("--host", argv[i]) == 0) {
+      if (i++ == argc - 1) {
+        usage();
+        fprintf(stderr, "No host specified.\n");
+        exit(1);
+      }
+      influx_v2_client.host = argv[i];
+    } else if (strcmp("-p", argv[i]) == 0 || strcmp("--port", argv[i]) == 0) {
+      if (i++ == argc - 1) {
+        usage();
+        fprintf(stderr, "No port specified.\n");
+        exit(1);
+      }
+      influx_v2_client.port = atoi(argv[i]);
+      if (influx_v2_client.port == 0) {
+        fprintf(stderr, "Invalid port: %s.\n", argv[i]);
+      }
+    } else if (strcmp("-o", argv[i]) == 0 || strcmp("--org", argv[i]) == 0) {
+      if (i++ == argc - 1) {
+        usage();
+        fprintf(stderr, "No organization specified.\n");
+        exit(1);
+      }
+      influx_v2_client.org = argv[i];
+    } else if (strcmp("-b", argv[i]) == 0 || strcmp("--bucket", argv[i]) == 0) {
+      if (i++ == argc - 1) {
+        usage();
+        fprintf(stderr, "No bucket specified.\n");
+        exit(1);
+      }
+      influx_v2_client.bucket = argv[i];
+    } else if (strcmp("-i", argv[i]) == 0 || strcmp("--interval", argv[i]) == 0) {
+      if (i++ == argc - 1) {
+        usage();
+        fprintf(stderr, "No interval specified.\n");
+        exit(1);
+      }
+      flush_interval_msec = atol(argv[i]);
+      if (flush_interval_msec <= 0) {
+        fprintf(stderr, "Invalid interval: %s.\n", argv[i]);
+        exit(1);
+      }
+    } else if (strcmp("-n", argv[i]) == 0 || strcmp("--stdout", argv[i]) == 0) {
+      print_only = true;
+    } else {
+      // Must be the segment name.
+      segment = argv[i];
+    }
+  }
+  if (influx_v2_client.token == NULL && !print_only) {
+    fprintf(stderr, "No token specified.\n");
+    exit(1);
+  }
+  if (segment == NULL) {
+    fprintf(stderr, "No shared-memory segment specified.\n");
+    exit(1);
+  }
+
+  trace_shm_header_t* header = attach(segment);
+  tail(header);
+}
@@ -20,9 +20,6 @@
 #define PID_FOR_WORKER_ADVANCING_TIME 0 // Use 1000002 to show in separate trace.
 #define PID_FOR_UNKNOWN_EVENT 2000000
 
-/** Maximum thread ID seen. */
-int max_thread_id = 0;
-
 /** File containing the trace binary data. */
 FILE* trace_file = NULL;
 
@@ -37,9 +34,14 @@ void usage() {
   printf("Options: \n");
   printf("  -p, --physical\n");
   printf("   Use only physical time, not logical time, for all horizontal axes.\n");
+  printf("  -j, --threads NUMBER\n");
+  printf("   The number of threads to use (default is the number of processors).\n");
   printf("\n");
 }
 
+/** Maximum thread ID seen. */
+int max_thread_id = 0;
+
 /** Maximum reaction number encountered. */
 int max_reaction_number = 0;
 
@@ -47,24 +49,30 @@ int max_reaction_number = 0;
 bool physical_time_only = false;
 
 /**
- * Read a trace in the trace_file and write it to the output_file in json.
- * @return The number of records read or 0 upon seeing an EOF.
+ * State of a thread that converts a segment of the trace.
  */
-size_t read_and_write_trace() {
-  int trace_length = read_trace();
-  if (trace_length == 0)
-    return 0;
+typedef struct chrome_state_t {
+  int max_thread_id;       // Maximum thread ID seen by the thread.
+  int max_reaction_number; // Maximum reaction number seen by the thread.
+} chrome_state_t;
+
+/**
+ * Convert the given trace records to json.
+ */
+void convert_records(trace_record_t* trace, int trace_length, FILE* output_file, void* arg) {
+  chrome_state_t* state = (chrome_state_t*)arg;
   // Write each line.
   for (int i = 0; i < trace_length; i++) {
     char* reaction_name = "\"UNKNOWN\"";
+    char reaction_number[12];
 
     // Ignore federated trace events.
     if (trace[i].event_type > federated)
       continue;
 
     if (trace[i].dst_id >= 0) {
-      reaction_name = (char*)malloc(4);
-      snprintf(reaction_name, 4, "%d", trace[i].dst_id);
+      snprintf(reaction_number, sizeof(reaction_number), "%d", trace[i].dst_id);
+      reaction_name = reaction_number;
     }
     // printf("DEBUG: Reactor's self struct pointer: %p\n", trace[i].pointer);
     int reactor_index;
@@ -191,8 +199,8 @@ size_t read_and_write_trace() {
             name, trace_event_names[trace[i].event_type], phase, thread_id, pid, (long long int)timestamp, args);
     free(args);
 
-    if (trace[i].src_id > max_thread_id) {
-      max_thread_id = trace[i].src_id;
+    if (trace[i].src_id > state->max_thread_id) {
+      state->max_thread_id = trace[i].src_id;
     }
     // If the event is reaction_starts and physical_time_only is not set,
     // then also generate an instantaneous
@@ -200,15 +208,14 @@ size_t read_and_write_trace() {
     if (trace[i].event_type == reaction_starts && !physical_time_only) {
       phase = "i";
       pid = reactor_index + 1;
-      reaction_name = (char*)malloc(4);
       char name[13];
       snprintf(name, 13, "reaction %d", trace[i].dst_id);
 
       // NOTE: If the reactor has more than 1024 timers and actions, then
       // there will be a collision of thread IDs here.
       thread_id = 1024 + trace[i].dst_id;
-      if (trace[i].dst_id > max_reaction_number) {
-        max_reaction_number = trace[i].dst_id;
+      if (trace[i].dst_id > state->max_reaction_number) {
+        state->max_reaction_number = trace[i].dst_id;
       }
 
       fprintf(output_file,
@@ -227,7 +234,15 @@ size_t read_and_write_trace() {
               (long long int)elapsed_physical_time);
     }
   }
-  return trace_length;
+}
+
+/**
+ * Write the json of a segment to the output file.
+ */
+int merge_segment(void* arg, const char* output, size_t size) {
+  (void)arg;
+  fwrite(output, 1, size, output_file);
+  return 0;
 }
 
 /**
@@ -387,9 +402,16 @@ void write_metadata_events(FILE* output_file) {
 
 int main(int argc, char* argv[]) {
   char* filename = NULL;
+  int num_threads = trace_num_threads();
   for (int i = 1; i < argc; i++) {
     if (strncmp(argv[i], "-p", 2) == 0 || strncmp(argv[i], "--physical", 10) == 0) {
       physical_time_only = true;
+    } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--threads") == 0) {
+      if (i++ == argc - 1 || atoi(argv[i]) <= 0) {
+        usage();
+        return (1);
+      }
+      num_threads = atoi(argv[i]);
     } else if (argv[i][0] == '-') {
       usage();
       return (1);
@@ -415,8 +437,26 @@ int main(int argc, char* argv[]) {
   if (read_header() >= 0) {
     // Write the opening bracket into the json file.
     fprintf(output_file, "{ \"traceEvents\": [\n");
-    while (read_and_write_trace() != 0) {
-    };
+    chrome_state_t* states = (chrome_state_t*)calloc(num_threads, sizeof(chrome_state_t));
+    void** state_pointers = (void**)calloc(num_threads, sizeof(void*));
+    if (states == NULL || state_pointers == NULL) {
+      fprintf(stderr, "Out of memory.\n");
+      exit(3);
+    }
+    for (int i = 0; i < num_threads; i++) {
+      state_pointers[i] = &states[i];
+    }
+    convert_trace(convert_records, merge_segment, state_pointers, num_threads);
+    for (int i = 0; i < num_threads; i++) {
+      if (states[i].max_thread_id > max_thread_id) {
+        max_thread_id = states[i].max_thread_id;
+      }
+      if (states[i].max_reaction_number > max_reaction_number) {
+        max_reaction_number = states[i].max_reaction_number;
+      }
+    }
+    free(states);
+    free(state_pointers);
     write_metadata_events(output_file);
     fprintf(output_file, "]}\n");
   }
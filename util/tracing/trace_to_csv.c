@@ -11,6 +11,7 @@
 #include "trace.h"
 #include "trace_util.h"
 #include "trace_impl.h"
+#include "log_histogram.h"
 
 #define MAX_NUM_REACTIONS 64 // Maximum number of reactions reported in summary stats.
 #define MAX_NUM_WORKERS 64
@@ -24,7 +25,10 @@ FILE* output_file = NULL;
 /** File for writing summary statistics. */
 FILE* summary_file = NULL;
 
-/** Size of the stats table is object_table_size plus twice MAX_NUM_WORKERS. */
+/**
+ * Size of the stats table, which has an entry per event type, an entry per object for reactions and
+ * calls to schedule, twice MAX_NUM_WORKERS entries for waits, and an entry per object for user events.
+ */
 int table_size;
 
 /**
@@ -37,6 +41,8 @@ void usage() {
   printf("   The target time to begin tracing.\n\n");
   printf("  -e, --end [time_spec] [units]\n");
   printf("   The target time to stop tracing.\n\n");
+  printf("  -j, --threads [number]\n");
+  printf("   The number of threads to use (default is the number of processors).\n\n");
   printf("\n\n");
 }
 
@@ -45,10 +51,10 @@ void usage() {
  */
 typedef struct reaction_stats_t {
   int occurrences;
-  instant_t latest_start_time;
   interval_t total_exec_time;
   interval_t max_exec_time;
   interval_t min_exec_time;
+  log_histogram_t* histogram; // Distribution of execution times, allocated when first needed.
 } reaction_stats_t;
 
 /**
@@ -62,6 +68,42 @@ typedef struct summary_stats_t {
   reaction_stats_t reactions[MAX_NUM_REACTIONS];
 } summary_stats_t;
 
+/**
+ * Kinds of intervals that are delimited by a start and an end event on the same worker.
+ */
+typedef enum { REACTION_INTERVAL, WAIT_INTERVAL, ADVANCING_TIME_INTERVAL, NUM_INTERVAL_KINDS } interval_kind_t;
+
+/**
+ * A start or end event of an interval.
+ * A worker executes one reaction at a time, so a reaction_ends event matches the most recent
+ * reaction_starts event of the same worker, and likewise for waits.
+ */
+typedef struct interval_event_t {
+  bool valid;
+  int stats_index;    // Index in the summary stats table to which the interval is attributed.
+  int reaction_index; // Index in the reactions array of those stats.
+  instant_t time;     // Physical time of the event.
+} interval_event_t;
+
+/**
+ * State of a thread that converts a segment of the trace.
+ * Intervals whose start and end lie in different segments are completed by merge_segment.
+ */
+typedef struct csv_state_t {
+  /** Summary stats table, accumulated over all segments converted by the thread. */
+  summary_stats_t** summary_stats;
+  /** Largest timestamp seen. */
+  instant_t latest_time;
+  /** First end event of each worker in the current segment that has no start in the segment. */
+  interval_event_t first_ends[MAX_NUM_WORKERS][NUM_INTERVAL_KINDS];
+  /** Last start event of each worker in the current segment that has not ended. */
+  interval_event_t open_starts[MAX_NUM_WORKERS][NUM_INTERVAL_KINDS];
+  /** Whether too many workers have been seen. */
+  bool too_many_workers;
+  /** Whether too many reactions have been seen. */
+  bool too_many_reactions;
+} csv_state_t;
+
 /**
  * Summary stats array. This array has the same size as the
  * object table. Pointer in the array will be void if there
@@ -72,14 +114,99 @@ summary_stats_t** summary_stats;
 /** Largest timestamp seen. */
 instant_t latest_time = 0LL;
 
+/** Last start event of each worker that has not ended, carried across segments. */
+interval_event_t open_starts[MAX_NUM_WORKERS][NUM_INTERVAL_KINDS];
+
+/** Start of the time range to convert, relative to the start time. */
+instant_t trace_start_time = NEVER;
+
+/** End of the time range to convert, relative to the start time. */
+instant_t trace_end_time = FOREVER;
+
+/**
+ * Return the index in the summary stats table of the user events and values of the given object.
+ * These are kept apart from the reaction executions of the object, which a reactor may also have.
+ */
+int user_stats_index(int object_instance) {
+  return NUM_EVENT_TYPES + object_table_size + MAX_NUM_WORKERS * 2 + object_instance;
+}
+
+/**
+ * Return the entry of the given summary stats table, allocating it if necessary.
+ */
+summary_stats_t* get_stats(summary_stats_t** table, int index) {
+  if (table[index] == NULL) {
+    table[index] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+    if (table[index] == NULL) {
+      fprintf(stderr, "ERROR: Out of memory.\n");
+      exit(3);
+    }
+  }
+  return table[index];
+}
+
 /**
- * Read a trace in the trace_file and write it to the output_file as CSV.
- * @return The number of records read or 0 upon seeing an EOF.
+ * Record the duration of an interval, an execution time or a user value.
  */
-size_t read_and_write_trace(instant_t trace_start_time, instant_t trace_end_time) {
-  int trace_length = read_trace();
-  if (trace_length == 0)
-    return 0;
+void record_exec_time(reaction_stats_t* rstats, interval_t exec_time) {
+  rstats->occurrences++;
+  rstats->total_exec_time += exec_time;
+  if (exec_time > rstats->max_exec_time) {
+    rstats->max_exec_time = exec_time;
+  }
+  if (exec_time < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
+    rstats->min_exec_time = exec_time;
+  }
+  if (rstats->histogram == NULL) {
+    rstats->histogram = (log_histogram_t*)calloc(1, sizeof(log_histogram_t));
+    if (rstats->histogram == NULL) {
+      fprintf(stderr, "ERROR: Out of memory.\n");
+      exit(3);
+    }
+  }
+  log_histogram_record(rstats->histogram, exec_time);
+}
+
+/**
+ * Record the start of an interval on a worker in the current segment.
+ */
+void start_interval(csv_state_t* state, int worker, interval_kind_t kind, int stats_index, int reaction_index,
+                    instant_t time) {
+  interval_event_t* start = &state->open_starts[worker][kind];
+  start->valid = true;
+  start->stats_index = stats_index;
+  start->reaction_index = reaction_index;
+  start->time = time;
+}
+
+/**
+ * Record the end of an interval on a worker in the current segment.
+ * If the interval started in the current segment, record its duration.
+ * Otherwise, remember the end so that merge_segment can match it to a start in an earlier segment.
+ */
+void end_interval(csv_state_t* state, int worker, interval_kind_t kind, int stats_index, int reaction_index,
+                  instant_t time) {
+  interval_event_t* start = &state->open_starts[worker][kind];
+  if (start->valid) {
+    start->valid = false;
+    summary_stats_t* stats = get_stats(state->summary_stats, stats_index);
+    record_exec_time(&stats->reactions[reaction_index], time - start->time);
+  } else if (!state->first_ends[worker][kind].valid) {
+    interval_event_t* end = &state->first_ends[worker][kind];
+    end->valid = true;
+    end->stats_index = stats_index;
+    end->reaction_index = reaction_index;
+    end->time = time;
+  }
+  // An end with neither a start in this segment nor a start in an earlier segment
+  // is from before the trace started and is ignored.
+}
+
+/**
+ * Convert the given trace records to CSV and update the summary statistics of the thread.
+ */
+void convert_records(trace_record_t* trace, int trace_length, FILE* output, void* arg) {
+  csv_state_t* state = (csv_state_t*)arg;
   // Write each line.
   for (int i = 0; i < trace_length; i++) {
     // printf("DEBUG: reactor self struct pointer: %p\n", trace[i].pointer);
@@ -95,62 +222,55 @@ size_t read_and_write_trace(instant_t trace_start_time, instant_t trace_end_time
     }
     if ((trace[i].logical_time - start_time) >= trace_start_time &&
         (trace[i].logical_time - start_time) < trace_end_time) {
-      fprintf(output_file, "%s, %s, %d, %d, " PRINTF_TIME ", %d, " PRINTF_TIME ", %s, " PRINTF_TIME "\n",
+      fprintf(output, "%s, %s, %d, %d, " PRINTF_TIME ", %d, " PRINTF_TIME ", %s, " PRINTF_TIME "\n",
               trace_event_names[trace[i].event_type], reactor_name, trace[i].src_id, trace[i].dst_id,
               trace[i].logical_time - start_time, trace[i].microstep, trace[i].physical_time - start_time, trigger_name,
               trace[i].extra_delay);
       // Update summary statistics.
-      if (trace[i].physical_time > latest_time) {
-        latest_time = trace[i].physical_time;
+      if (trace[i].physical_time > state->latest_time) {
+        state->latest_time = trace[i].physical_time;
       }
-      if (object_instance >= 0 && summary_stats[NUM_EVENT_TYPES + object_instance] == NULL) {
-        summary_stats[NUM_EVENT_TYPES + object_instance] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+      if (object_instance >= 0) {
+        get_stats(state->summary_stats, NUM_EVENT_TYPES + object_instance);
       }
-      if (trigger_instance >= 0 && summary_stats[NUM_EVENT_TYPES + trigger_instance] == NULL) {
-        summary_stats[NUM_EVENT_TYPES + trigger_instance] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+      if (trigger_instance >= 0) {
+        get_stats(state->summary_stats, NUM_EVENT_TYPES + trigger_instance);
       }
 
       summary_stats_t* stats = NULL;
-      interval_t exec_time;
-      reaction_stats_t* rstats;
       int index;
+      interval_kind_t kind;
 
       // Count of event type.
-      if (summary_stats[trace[i].event_type] == NULL) {
-        summary_stats[trace[i].event_type] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
-      }
-      summary_stats[trace[i].event_type]->event_type = trace[i].event_type;
-      summary_stats[trace[i].event_type]->description = trace_event_names[trace[i].event_type];
-      summary_stats[trace[i].event_type]->occurrences++;
+      summary_stats_t* event_stats = get_stats(state->summary_stats, trace[i].event_type);
+      event_stats->event_type = trace[i].event_type;
+      event_stats->description = trace_event_names[trace[i].event_type];
+      event_stats->occurrences++;
 
       switch (trace[i].event_type) {
       case reaction_starts:
       case reaction_ends:
-        // This code relies on the mutual exclusion of reactions in a reactor
-        // and the ordering of reaction_starts and reaction_ends events.
+        // This code relies on each worker executing one reaction at a time.
         if (trace[i].dst_id >= MAX_NUM_REACTIONS) {
-          fprintf(stderr, "WARNING: Too many reactions. Not all will be shown in summary file.\n");
+          state->too_many_reactions = true;
           continue;
         }
-        stats = summary_stats[NUM_EVENT_TYPES + object_instance];
+        if (trace[i].src_id < 0 || trace[i].src_id >= MAX_NUM_WORKERS) {
+          state->too_many_workers = true;
+          continue;
+        }
+        stats = state->summary_stats[NUM_EVENT_TYPES + object_instance];
         stats->description = reactor_name;
+        stats->event_type = reaction_ends;
         if (trace[i].dst_id >= stats->num_reactions_seen) {
           stats->num_reactions_seen = trace[i].dst_id + 1;
         }
-        rstats = &stats->reactions[trace[i].dst_id];
         if (trace[i].event_type == reaction_starts) {
-          rstats->latest_start_time = trace[i].physical_time;
+          start_interval(state, trace[i].src_id, REACTION_INTERVAL, NUM_EVENT_TYPES + object_instance,
+                         trace[i].dst_id, trace[i].physical_time);
         } else {
-          rstats->occurrences++;
-          exec_time = trace[i].physical_time - rstats->latest_start_time;
-          rstats->latest_start_time = 0LL;
-          rstats->total_exec_time += exec_time;
-          if (exec_time > rstats->max_exec_time) {
-            rstats->max_exec_time = exec_time;
-          }
-          if (exec_time < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
-            rstats->min_exec_time = exec_time;
-          }
+          end_interval(state, trace[i].src_id, REACTION_INTERVAL, NUM_EVENT_TYPES + object_instance, trace[i].dst_id,
+                       trace[i].physical_time);
         }
         break;
       case schedule_called:
@@ -158,31 +278,33 @@ size_t read_and_write_trace(instant_t trace_start_time, instant_t trace_end_time
           // No trigger. Do not report.
           continue;
         }
-        stats = summary_stats[NUM_EVENT_TYPES + trigger_instance];
+        stats = state->summary_stats[NUM_EVENT_TYPES + trigger_instance];
         stats->description = trigger_name;
+        stats->event_type = schedule_called;
         break;
       case user_event:
-        // Although these are not exec times and not reactions,
-        // commandeer the first entry in the reactions array to track values.
-        stats = summary_stats[NUM_EVENT_TYPES + object_instance];
+        if (object_instance < 0) {
+          // No reactor. Do not report.
+          continue;
+        }
+        stats = get_stats(state->summary_stats, user_stats_index(object_instance));
         stats->description = reactor_name;
+        if (stats->event_type != user_value) {
+          stats->event_type = user_event;
+        }
         break;
       case user_value:
+        if (object_instance < 0) {
+          // No reactor. Do not report.
+          continue;
+        }
         // Although these are not exec times and not reactions,
         // commandeer the first entry in the reactions array to track values.
-        stats = summary_stats[NUM_EVENT_TYPES + object_instance];
+        stats = get_stats(state->summary_stats, user_stats_index(object_instance));
         stats->description = reactor_name;
-        rstats = &stats->reactions[0];
-        rstats->occurrences++;
+        stats->event_type = user_value;
         // User values are stored in the "extra_delay" field, which is an interval_t.
-        interval_t value = trace[i].extra_delay;
-        rstats->total_exec_time += value;
-        if (value > rstats->max_exec_time) {
-          rstats->max_exec_time = value;
-        }
-        if (value < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
-          rstats->min_exec_time = value;
-        }
+        record_exec_time(&stats->reactions[0], trace[i].extra_delay);
         break;
       case worker_wait_starts:
       case worker_wait_ends:
@@ -192,40 +314,31 @@ size_t read_and_write_trace(instant_t trace_start_time, instant_t trace_end_time
         // There will be two entries per worker, one for waits on the
         // reaction queue and one for waits while advancing time.
         index = trace[i].src_id * 2;
+        kind = WAIT_INTERVAL;
         // Even numbered indices are used for waits on reaction queue.
         // Odd numbered indices for waits for time advancement.
         if (trace[i].event_type == scheduler_advancing_time_starts ||
             trace[i].event_type == scheduler_advancing_time_ends) {
           index++;
+          kind = ADVANCING_TIME_INTERVAL;
         }
-        if (object_table_size + index >= table_size) {
-          fprintf(stderr, "WARNING: Too many workers. Not all will be shown in summary file.\n");
+        if (trace[i].src_id < 0 || trace[i].src_id >= MAX_NUM_WORKERS || index >= MAX_NUM_REACTIONS) {
+          state->too_many_workers = true;
           continue;
         }
-        stats = summary_stats[NUM_EVENT_TYPES + object_table_size + index];
-        if (stats == NULL) {
-          stats = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
-          summary_stats[NUM_EVENT_TYPES + object_table_size + index] = stats;
-        }
+        stats = get_stats(state->summary_stats, NUM_EVENT_TYPES + object_table_size + index);
+        stats->event_type = kind == WAIT_INTERVAL ? worker_wait_ends : scheduler_advancing_time_ends;
         // num_reactions_seen here will be used to store the number of
         // entries in the reactions array, which is twice the number of workers.
         if (index >= stats->num_reactions_seen) {
           stats->num_reactions_seen = index;
         }
-        rstats = &stats->reactions[index];
         if (trace[i].event_type == worker_wait_starts || trace[i].event_type == scheduler_advancing_time_starts) {
-          rstats->latest_start_time = trace[i].physical_time;
+          start_interval(state, trace[i].src_id, kind, NUM_EVENT_TYPES + object_table_size + index, index,
+                         trace[i].physical_time);
         } else {
-          rstats->occurrences++;
-          exec_time = trace[i].physical_time - rstats->latest_start_time;
-          rstats->latest_start_time = 0LL;
-          rstats->total_exec_time += exec_time;
-          if (exec_time > rstats->max_exec_time) {
-            rstats->max_exec_time = exec_time;
-          }
-          if (exec_time < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
-            rstats->min_exec_time = exec_time;
-          }
+          end_interval(state, trace[i].src_id, kind, NUM_EVENT_TYPES + object_table_size + index, index,
+                       trace[i].physical_time);
         }
         break;
       default:
@@ -235,13 +348,102 @@ size_t read_and_write_trace(instant_t trace_start_time, instant_t trace_end_time
       // Common stats across event types.
       if (stats != NULL) {
         stats->occurrences++;
-        stats->event_type = trace[i].event_type;
       }
     } else {
       // Out of scope.
     }
   }
-  return trace_length;
+}
+
+/**
+ * Write the CSV text of a segment to the output file and match the intervals that
+ * end in the segment to the intervals started in earlier segments.
+ * This is called in the order of the segments in the trace file.
+ */
+int merge_segment(void* arg, const char* output, size_t size) {
+  csv_state_t* state = (csv_state_t*)arg;
+  fwrite(output, 1, size, output_file);
+  for (int worker = 0; worker < MAX_NUM_WORKERS; worker++) {
+    for (int kind = 0; kind < NUM_INTERVAL_KINDS; kind++) {
+      interval_event_t* start = &open_starts[worker][kind];
+      interval_event_t* end = &state->first_ends[worker][kind];
+      if (end->valid && start->valid) {
+        summary_stats_t* stats = get_stats(summary_stats, end->stats_index);
+        record_exec_time(&stats->reactions[end->reaction_index], end->time - start->time);
+        start->valid = false;
+      }
+      // A start in this segment supersedes any unmatched start in earlier segments.
+      if (state->open_starts[worker][kind].valid) {
+        *start = state->open_starts[worker][kind];
+      }
+      end->valid = false;
+      state->open_starts[worker][kind].valid = false;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Merge the execution time statistics of `source` into `destination`.
+ */
+void merge_reaction_stats(reaction_stats_t* destination, reaction_stats_t* source) {
+  if (source->occurrences == 0) {
+    return;
+  }
+  destination->occurrences += source->occurrences;
+  destination->total_exec_time += source->total_exec_time;
+  if (source->max_exec_time > destination->max_exec_time) {
+    destination->max_exec_time = source->max_exec_time;
+  }
+  if (destination->min_exec_time == 0LL ||
+      (source->min_exec_time != 0LL && source->min_exec_time < destination->min_exec_time)) {
+    destination->min_exec_time = source->min_exec_time;
+  }
+  if (destination->histogram == NULL) {
+    destination->histogram = source->histogram;
+    source->histogram = NULL;
+  } else {
+    log_histogram_merge(destination->histogram, source->histogram);
+  }
+}
+
+/**
+ * Merge the summary statistics of a thread into the global summary statistics.
+ */
+void merge_state(csv_state_t* state) {
+  if (state->latest_time > latest_time) {
+    latest_time = state->latest_time;
+  }
+  if (state->too_many_reactions) {
+    fprintf(stderr, "WARNING: Too many reactions. Not all will be shown in summary file.\n");
+  }
+  if (state->too_many_workers) {
+    fprintf(stderr, "WARNING: Too many workers. Not all will be shown in summary file.\n");
+  }
+  for (int i = 0; i < table_size; i++) {
+    summary_stats_t* source = state->summary_stats[i];
+    if (source == NULL) {
+      continue;
+    }
+    summary_stats_t* stats = get_stats(summary_stats, i);
+    if (source->description != NULL) {
+      stats->description = source->description;
+    }
+    // A reactor that has both user events and user values is reported as having values.
+    if (stats->event_type != user_value) {
+      stats->event_type = source->event_type;
+    }
+    stats->occurrences += source->occurrences;
+    if (source->num_reactions_seen > stats->num_reactions_seen) {
+      stats->num_reactions_seen = source->num_reactions_seen;
+    }
+    for (int j = 0; j < MAX_NUM_REACTIONS; j++) {
+      merge_reaction_stats(&stats->reactions[j], &source->reactions[j]);
+      free(source->reactions[j].histogram);
+    }
+    free(source);
+  }
+  free(state->summary_stats);
 }
 
 /**
@@ -264,19 +466,24 @@ void write_summary_file() {
   // First pass looks for reaction invocations.
   // First print a header.
   fprintf(summary_file, "\nReaction Executions\n");
-  fprintf(summary_file, "Reactor, Reaction, Occurrences, Total Time, Pct Total Time, Avg Time, Max Time, Min Time\n");
+  fprintf(summary_file, "Reactor, Reaction, Occurrences, Total Time, Pct Total Time, Avg Time, Max Time, Min Time, "
+                        "P50 Time, P90 Time, P99 Time\n");
   for (int i = NUM_EVENT_TYPES; i < table_size; i++) {
     summary_stats_t* stats = summary_stats[i];
-    if (stats != NULL && stats->num_reactions_seen > 0) {
+    if (stats != NULL && stats->event_type == reaction_ends && stats->num_reactions_seen > 0) {
       for (int j = 0; j < stats->num_reactions_seen; j++) {
         reaction_stats_t* rstats = &stats->reactions[j];
         if (rstats->occurrences > 0) {
-          fprintf(summary_file, "%s, %d, %d, " PRINTF_TIME ", %f, " PRINTF_TIME ", " PRINTF_TIME ", " PRINTF_TIME "\n",
+          fprintf(summary_file,
+                  "%s, %d, %d, " PRINTF_TIME ", %f, " PRINTF_TIME ", " PRINTF_TIME ", " PRINTF_TIME ", " PRINTF_TIME
+                  ", " PRINTF_TIME ", " PRINTF_TIME "\n",
                   stats->description,
                   j, // Reaction number.
                   rstats->occurrences, rstats->total_exec_time,
                   rstats->total_exec_time * 100.0 / (latest_time - start_time),
-                  rstats->total_exec_time / rstats->occurrences, rstats->max_exec_time, rstats->min_exec_time);
+                  rstats->total_exec_time / rstats->occurrences, rstats->max_exec_time, rstats->min_exec_time,
+                  log_histogram_percentile(rstats->histogram, 50.0), log_histogram_percentile(rstats->histogram, 90.0),
+                  log_histogram_percentile(rstats->histogram, 99.0));
         }
       }
     }
@@ -386,11 +593,12 @@ instant_t string_to_instant(const char* time_spec, const char* units) {
   return duration;
 }
 
-int process_args(int argc, const char* argv[], char** root, instant_t* start_time, instant_t* end_time) {
+int process_args(int argc, const char* argv[], char** root, instant_t* start_time, instant_t* end_time,
+                 int* num_threads) {
   int i = 1;
   while (i < argc) {
     const char* arg = argv[i++];
-    if (strcmp(strrchr(arg, '\0') - 4, ".lft") == 0) {
+    if (strlen(arg) >= 4 && strcmp(strrchr(arg, '\0') - 4, ".lft") == 0) {
       // Open the trace file.
       trace_file = open_file(arg, "r");
       if (trace_file == NULL)
@@ -423,6 +631,13 @@ int process_args(int argc, const char* argv[], char** root, instant_t* start_tim
         usage();
         return -1;
       }
+    } else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0) {
+      if (argc < i + 1 || atoi(argv[i]) <= 0) {
+        printf("-j needs a positive number of threads.");
+        usage();
+        return -1;
+      }
+      *num_threads = atoi(argv[i++]);
     } else {
       usage();
       exit(0);
@@ -432,11 +647,10 @@ int process_args(int argc, const char* argv[], char** root, instant_t* start_tim
 }
 
 int main(int argc, const char* argv[]) {
-  instant_t trace_start_time = NEVER;
-  instant_t trace_end_time = FOREVER;
   char* root;
+  int num_threads = trace_num_threads();
 
-  if (process_args(argc, argv, &root, &trace_start_time, &trace_end_time) != 0) {
+  if (process_args(argc, argv, &root, &trace_start_time, &trace_end_time, &num_threads) != 0) {
     return -1;
   }
 
@@ -460,14 +674,34 @@ int main(int argc, const char* argv[]) {
 
   if (read_header() >= 0) {
     // Allocate an array for summary statistics.
-    table_size = NUM_EVENT_TYPES + object_table_size + (MAX_NUM_WORKERS * 2);
+    table_size = user_stats_index(object_table_size);
     summary_stats = (summary_stats_t**)calloc(table_size, sizeof(summary_stats_t*));
 
     // Write a header line into the CSV file.
     fprintf(output_file, "Event, Reactor, Source, Destination, Elapsed Logical Time, Microstep, Elapsed Physical Time, "
                          "Trigger, Extra Delay\n");
-    while (read_and_write_trace(trace_start_time, trace_end_time) != 0) {
-    };
+
+    // Each thread collects its own statistics, which are merged once the whole trace is converted.
+    csv_state_t* states = (csv_state_t*)calloc(num_threads, sizeof(csv_state_t));
+    void** state_pointers = (void**)calloc(num_threads, sizeof(void*));
+    if (summary_stats == NULL || states == NULL || state_pointers == NULL) {
+      fprintf(stderr, "ERROR: Out of memory.\n");
+      exit(3);
+    }
+    for (int i = 0; i < num_threads; i++) {
+      states[i].summary_stats = (summary_stats_t**)calloc(table_size, sizeof(summary_stats_t*));
+      if (states[i].summary_stats == NULL) {
+        fprintf(stderr, "ERROR: Out of memory.\n");
+        exit(3);
+      }
+      state_pointers[i] = &states[i];
+    }
+    convert_trace(convert_records, merge_segment, state_pointers, num_threads);
+    for (int i = 0; i < num_threads; i++) {
+      merge_state(&states[i]);
+    }
+    free(states);
+    free(state_pointers);
 
     write_summary_file();
 
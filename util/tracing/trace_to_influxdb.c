@@ -115,20 +115,25 @@ void usage() {
   printf("   The organization for access to InfluxDB (default is 'iCyPhy').\n\n");
   printf("   -b, --bucket BUCKET\n");
   printf("   The bucket into which to put the data (default is 'test').\n\n");
+  printf("   -j, --threads NUMBER\n");
+  printf("   The number of threads formatting data (default is the number of processors).\n\n");
   printf("\n\n");
 }
 
-/** Largest timestamp seen. */
-instant_t latest_time = 0LL;
+/**
+ * State of a thread that converts a segment of the trace.
+ */
+typedef struct influxdb_state_t {
+  char* line;         // Buffer for formatting one line of the line protocol.
+  size_t line_size;   // Size of the buffer.
+  int response_code;  // Nonzero if formatting failed.
+} influxdb_state_t;
 
 /**
- * Read a trace in the trace_file and write it to InfluxDB.
- * @return The number of records read or 0 upon seeing an EOF.
+ * Convert the given trace records to the InfluxDB line protocol.
  */
-size_t read_and_write_trace() {
-  int trace_length = read_trace();
-  if (trace_length == 0)
-    return 0;
+void convert_records(trace_record_t* trace, int trace_length, FILE* output, void* arg) {
+  influxdb_state_t* state = (influxdb_state_t*)arg;
   // Write each line.
   for (int i = 0; i < trace_length; i++) {
 
@@ -137,9 +142,10 @@ size_t read_and_write_trace() {
       continue;
 
     char* reaction_name = "none";
+    char reaction_number[12];
     if (trace[i].dst_id >= 0) {
-      reaction_name = (char*)malloc(4);
-      snprintf(reaction_name, 4, "%d", trace[i].dst_id);
+      snprintf(reaction_number, sizeof(reaction_number), "%d", trace[i].dst_id);
+      reaction_name = reaction_number;
     }
     // printf("DEBUG: reactor self struct pointer: %p\n", trace[i].pointer);
     int object_instance = -1;
@@ -157,18 +163,34 @@ size_t read_and_write_trace() {
     // FIXME: What is the difference between a TAG and F_STR (presumably, Field String)?
     // Presumably, the HTTP post is formatted as a "line protocol" command. See:
     // https://docs.influxdata.com/influxdb/v2.0/reference/syntax/line-protocol/
-    int response_code =
-        post_curl(&influx_v2_client, INFLUX_MEAS(trace_event_names[trace[i].event_type]),
-                  INFLUX_TAG("Reactor", reactor_name), INFLUX_TAG("Reaction", reaction_name),
-                  INFLUX_F_INT("Worker", trace[i].src_id), INFLUX_F_INT("Logical Time", trace[i].logical_time),
-                  INFLUX_F_INT("Microstep", trace[i].microstep), INFLUX_F_STR("Trigger Name", trigger_name),
-                  INFLUX_F_INT("Extra Delay", trace[i].extra_delay), INFLUX_TS(trace[i].physical_time), INFLUX_END);
-    if (response_code != 0) {
-      fprintf(stderr, "****** response code: %d\n", response_code);
-      return 0;
+    int length =
+        format_line(&state->line, &state->line_size, 0, INFLUX_MEAS(trace_event_names[trace[i].event_type]),
+                    INFLUX_TAG("Reactor", reactor_name), INFLUX_TAG("Reaction", reaction_name),
+                    INFLUX_F_INT("Worker", trace[i].src_id), INFLUX_F_INT("Logical Time", trace[i].logical_time),
+                    INFLUX_F_INT("Microstep", trace[i].microstep), INFLUX_F_STR("Trigger Name", trigger_name),
+                    INFLUX_F_INT("Extra Delay", trace[i].extra_delay), INFLUX_TS(trace[i].physical_time), INFLUX_END);
+    if (length < 0) {
+      state->response_code = length;
+      return;
     }
+    fwrite(state->line, 1, length, output);
+  }
+}
+
+/**
+ * Post the lines of a segment to InfluxDB in a single request.
+ * Segments are posted one at a time, in the order in which they appear in the trace file.
+ */
+int merge_segment(void* arg, const char* output, size_t size) {
+  influxdb_state_t* state = (influxdb_state_t*)arg;
+  int response_code = state->response_code;
+  if (response_code == 0 && size > 0) {
+    response_code = post_curl_send_lines(&influx_v2_client, output);
   }
-  return trace_length;
+  if (response_code != 0) {
+    fprintf(stderr, "****** response code: %d\n", response_code);
+  }
+  return response_code;
 }
 
 int main(int argc, char* argv[]) {
@@ -184,6 +206,7 @@ int main(int argc, char* argv[]) {
   influx_v2_client.bucket = "test";
 
   char* filename = NULL;
+  int num_threads = trace_num_threads();
 
   for (int i = 1; i < argc; i++) {
     if (strcmp("-t", argv[i]) == 0 || strcmp("--token", argv[i]) == 0) {
@@ -224,6 +247,13 @@ int main(int argc, char* argv[]) {
         exit(1);
       }
       influx_v2_client.bucket = argv[i];
+    } else if (strcmp("-j", argv[i]) == 0 || strcmp("--threads", argv[i]) == 0) {
+      if (i++ == argc - 1 || atoi(argv[i]) <= 0) {
+        usage();
+        fprintf(stderr, "No number of threads specified.\n");
+        exit(1);
+      }
+      num_threads = atoi(argv[i]);
     } else {
       // Must be the filename.
       filename = argv[i];
@@ -242,11 +272,22 @@ int main(int argc, char* argv[]) {
   trace_file = open_file(filename, "r");
 
   if (read_header() >= 0) {
-    size_t num_records = 0, result;
-    while ((result = read_and_write_trace()) != 0) {
-      num_records = result;
-    };
+    influxdb_state_t* states = (influxdb_state_t*)calloc(num_threads, sizeof(influxdb_state_t));
+    void** state_pointers = (void**)calloc(num_threads, sizeof(void*));
+    if (states == NULL || state_pointers == NULL) {
+      fprintf(stderr, "Out of memory.\n");
+      exit(3);
+    }
+    for (int i = 0; i < num_threads; i++) {
+      state_pointers[i] = &states[i];
+    }
+    size_t num_records = convert_trace(convert_records, merge_segment, state_pointers, num_threads);
     printf("***** %zu records written to InfluxDB.\n", num_records);
+    for (int i = 0; i < num_threads; i++) {
+      free(states[i].line);
+    }
+    free(states);
+    free(state_pointers);
     // File closing is handled by termination function.
   }
 }
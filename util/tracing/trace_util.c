@@ -8,11 +8,28 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "reactor.h"
 #include "trace.h"
 #include "trace_util.h"
 #include "trace_impl.h"
 
+// Hashmap from a pointer in a trace record to the index of its entry in the object table.
+#define HASHMAP(token) trace_object_map##_##token
+#define K void*
+#define V int
+#define HASH_OF(key) trace_object_hash(key)
+#include "impl/hashmap.h"
+#undef HASHMAP
+#undef K
+#undef V
+#undef HASH_OF
+
 /** Buffer for reading object descriptions. Size limit is BUFFER_SIZE bytes. */
 char buffer[BUFFER_SIZE];
 
@@ -26,10 +43,27 @@ instant_t start_time;
 char* top_level = NULL;
 
 /** Table of pointers to the self struct of a reactor. */
-// FIXME: Replace with hash table implementation.
 object_description_t* object_table;
 int object_table_size = 0;
 
+/** Index of the first entry in object_table with a given pointer. */
+static trace_object_map_t* object_index = NULL;
+
+/** Index of the first trigger entry in object_table with a given trigger pointer. */
+static trace_object_map_t* trigger_index = NULL;
+
+/** Number of entries of object_table that have been indexed. */
+static int object_table_indexed_size = 0;
+
+/** Contents of the trace file, mapped into memory by read_header. */
+static const char* trace_data = NULL;
+
+/** Size of the trace file. */
+static size_t trace_data_size = 0;
+
+/** Offset in trace_data of the next item to read. */
+static size_t trace_position = 0;
+
 typedef struct open_file_t open_file_t;
 typedef struct open_file_t {
   FILE* file;
@@ -100,6 +134,25 @@ FILE* open_file(const char* path, const char* mode) {
   return result;
 }
 
+void index_object_table() {
+  if (object_index == NULL) {
+    object_index = trace_object_map_new(2 * object_table_size + 1, NULL);
+    trigger_index = trace_object_map_new(2 * object_table_size + 1, NULL);
+  }
+  for (int i = object_table_indexed_size; i < object_table_size; i++) {
+    int existing;
+    // Only the first entry for each pointer is indexed, matching a linear search of the table.
+    if (object_table[i].pointer != NULL && !trace_object_map_find(object_index, object_table[i].pointer, &existing)) {
+      trace_object_map_put(object_index, object_table[i].pointer, i);
+    }
+    if (object_table[i].type == trace_trigger && object_table[i].trigger != NULL &&
+        !trace_object_map_find(trigger_index, object_table[i].trigger, &existing)) {
+      trace_object_map_put(trigger_index, object_table[i].trigger, i);
+    }
+  }
+  object_table_indexed_size = object_table_size;
+}
+
 /**
  * Get the description of the object pointed to by the specified pointer.
  * For example, this can be the name of a reactor (pointer points to
@@ -112,14 +165,12 @@ FILE* open_file(const char* path, const char* mode) {
  * @param index An optional pointer into which to write the index.
  */
 char* get_object_description(void* pointer, int* index) {
-  // FIXME: Replace with a hash table implementation.
-  for (int i = 0; i < object_table_size; i++) {
-    if (object_table[i].pointer == pointer) {
-      if (index != NULL) {
-        *index = i;
-      }
-      return object_table[i].description;
+  int i;
+  if (pointer != NULL && object_index != NULL && trace_object_map_find(object_index, pointer, &i)) {
+    if (index != NULL) {
+      *index = i;
     }
+    return object_table[i].description;
   }
   if (index != NULL) {
     *index = 0;
@@ -137,14 +188,12 @@ char* get_object_description(void* pointer, int* index) {
  * @param index An optional pointer into which to write the index.
  */
 char* get_trigger_name(void* trigger, int* index) {
-  // FIXME: Replace with a hash table implementation.
-  for (int i = 0; i < object_table_size; i++) {
-    if (object_table[i].trigger == trigger && object_table[i].type == trace_trigger) {
-      if (index != NULL) {
-        *index = i;
-      }
-      return object_table[i].description;
+  int i;
+  if (trigger != NULL && trigger_index != NULL && trace_object_map_find(trigger_index, trigger, &i)) {
+    if (index != NULL) {
+      *index = i;
     }
+    return object_table[i].description;
   }
   if (index != NULL) {
     *index = 0;
@@ -174,19 +223,59 @@ void print_table() {
   printf("-------\n");
 }
 
+/**
+ * Map the trace file into memory so that it can be read without copying and
+ * split between threads.
+ */
+static void map_trace_file() {
+  if (fseek(trace_file, 0, SEEK_END) != 0)
+    _LF_TRACE_FAILURE(trace_file);
+  long size = ftell(trace_file);
+  if (size <= 0)
+    _LF_TRACE_FAILURE(trace_file);
+  trace_data_size = (size_t)size;
+#ifdef _WIN32
+  // There is no mmap, so read the whole file instead.
+  char* data = (char*)malloc(trace_data_size);
+  if (data == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  rewind(trace_file);
+  if (fread(data, 1, trace_data_size, trace_file) != trace_data_size)
+    _LF_TRACE_FAILURE(trace_file);
+  trace_data = data;
+#else
+  void* data = mmap(NULL, trace_data_size, PROT_READ, MAP_PRIVATE, fileno(trace_file), 0);
+  if (data == MAP_FAILED)
+    _LF_TRACE_FAILURE(trace_file);
+  trace_data = (const char*)data;
+#endif
+  trace_position = 0;
+}
+
+/**
+ * Copy the given number of bytes from the current position in the trace file
+ * and advance the position, exiting if the file is too short.
+ */
+static void read_bytes(void* destination, size_t size) {
+  if (trace_position + size > trace_data_size)
+    _LF_TRACE_FAILURE(trace_file);
+  memcpy(destination, trace_data + trace_position, size);
+  trace_position += size;
+}
+
 size_t read_header() {
+  map_trace_file();
+
   // Read the start time.
-  int items_read = fread(&start_time, sizeof(instant_t), 1, trace_file);
-  if (items_read != 1)
-    _LF_TRACE_FAILURE(trace_file);
+  read_bytes(&start_time, sizeof(instant_t));
 
   printf("Start time is %lld.\n", (long long int)start_time);
 
   // Read the table mapping pointers to descriptions.
   // First read its length.
-  items_read = fread(&object_table_size, sizeof(int), 1, trace_file);
-  if (items_read != 1)
-    _LF_TRACE_FAILURE(trace_file);
+  read_bytes(&object_table_size, sizeof(int));
 
   printf("There are %d objects traced.\n", object_table_size);
 
@@ -199,35 +288,25 @@ size_t read_header() {
   // Next, read each table entry.
   for (int i = 0; i < object_table_size; i++) {
     void* reactor;
-    items_read = fread(&reactor, sizeof(void*), 1, trace_file);
-    if (items_read != 1)
-      _LF_TRACE_FAILURE(trace_file);
+    read_bytes(&reactor, sizeof(void*));
     object_table[i].pointer = reactor;
 
     void* trigger;
-    items_read = fread(&trigger, sizeof(trigger_t*), 1, trace_file);
-    if (items_read != 1)
-      _LF_TRACE_FAILURE(trace_file);
+    read_bytes(&trigger, sizeof(trigger_t*));
     object_table[i].trigger = trigger;
 
     // Next, read the type.
     _lf_trace_object_t trace_type;
-    items_read = fread(&trace_type, sizeof(_lf_trace_object_t), 1, trace_file);
-    if (items_read != 1)
-      _LF_TRACE_FAILURE(trace_file);
+    read_bytes(&trace_type, sizeof(_lf_trace_object_t));
     object_table[i].type = trace_type;
 
     // Next, read the string description into the buffer.
     int description_length = 0;
     char character;
-    items_read = fread(&character, sizeof(char), 1, trace_file);
-    if (items_read != 1)
-      _LF_TRACE_FAILURE(trace_file);
+    read_bytes(&character, sizeof(char));
     while (character != 0 && description_length < BUFFER_SIZE - 1) {
       buffer[description_length++] = character;
-      items_read = fread(&character, sizeof(char), 1, trace_file);
-      if (items_read != 1)
-        _LF_TRACE_FAILURE(trace_file);
+      read_bytes(&character, sizeof(char));
     }
     // Terminate with null.
     buffer[description_length++] = 0;
@@ -240,30 +319,225 @@ size_t read_header() {
       top_level = object_table[i].description;
     }
   }
+  index_object_table();
   print_table();
   return object_table_size;
 }
 
-int read_trace() {
-  // Read first the int giving the length of the trace.
+/**
+ * Read the length of the trace buffer at the given position in the trace file and check
+ * that the whole buffer is present.
+ * @return The number of records in the buffer.
+ */
+static int read_trace_length(size_t position) {
   int trace_length;
-  int items_read = fread(&trace_length, sizeof(int), 1, trace_file);
-  if (items_read != 1) {
-    if (feof(trace_file))
-      return 0;
+  if (position + sizeof(int) > trace_data_size) {
     fprintf(stderr, "Failed to read trace length.\n");
     exit(3);
   }
-  if (trace_length > TRACE_BUFFER_CAPACITY) {
+  memcpy(&trace_length, trace_data + position, sizeof(int));
+  if (trace_length < 0 || trace_length > TRACE_BUFFER_CAPACITY) {
     fprintf(stderr, "ERROR: Trace length %d exceeds capacity. File is garbled.\n", trace_length);
     exit(4);
   }
-  // printf("DEBUG: Trace of length %d being converted.\n", trace_length);
-
-  items_read = fread(&trace, sizeof(trace_record_t), trace_length, trace_file);
-  if (items_read != trace_length) {
+  if (position + sizeof(int) + trace_length * sizeof(trace_record_t) > trace_data_size) {
     fprintf(stderr, "Failed to read trace of length %d.\n", trace_length);
     exit(5);
   }
   return trace_length;
 }
+
+int read_trace() {
+  if (trace_position == trace_data_size)
+    return 0;
+  // Read first the int giving the length of the trace.
+  int trace_length = read_trace_length(trace_position);
+  trace_position += sizeof(int);
+  // printf("DEBUG: Trace of length %d being converted.\n", trace_length);
+
+  read_bytes(&trace, trace_length * sizeof(trace_record_t));
+  return trace_length;
+}
+
+/**
+ * A trace buffer in the trace file.
+ */
+typedef struct trace_chunk_t {
+  size_t offset; // Offset of the first record in the trace file.
+  int length;    // Number of records.
+} trace_chunk_t;
+
+/**
+ * Work of one thread in convert_trace.
+ */
+typedef struct segment_task_t {
+  trace_chunk_t* chunks;     // Trace buffers to convert.
+  size_t num_chunks;         // Number of trace buffers to convert.
+  trace_record_t* records;   // Aligned copy of the trace buffer being converted.
+  trace_segment_converter_t convert;
+  void* state;
+  FILE* output;
+  char* text;                // Text written to output.
+  size_t text_size;
+} segment_task_t;
+
+/**
+ * Find the trace buffers that follow the header.
+ * Only the length of each buffer is read, so this takes little time even for large files.
+ */
+static trace_chunk_t* index_trace_chunks(size_t* num_chunks) {
+  size_t capacity = 1024;
+  size_t count = 0;
+  trace_chunk_t* chunks = (trace_chunk_t*)malloc(capacity * sizeof(trace_chunk_t));
+  size_t position = trace_position;
+  while (chunks != NULL && position < trace_data_size) {
+    int trace_length = read_trace_length(position);
+    if (count == capacity) {
+      capacity *= 2;
+      chunks = (trace_chunk_t*)realloc(chunks, capacity * sizeof(trace_chunk_t));
+      if (chunks == NULL)
+        break;
+    }
+    chunks[count].offset = position + sizeof(int);
+    chunks[count].length = trace_length;
+    count++;
+    position += sizeof(int) + trace_length * sizeof(trace_record_t);
+  }
+  if (chunks == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  *num_chunks = count;
+  return chunks;
+}
+
+/**
+ * Open a file in memory for the output of a segment.
+ */
+static FILE* open_segment_output(segment_task_t* task) {
+  task->text = NULL;
+  task->text_size = 0;
+#ifdef _WIN32
+  return tmpfile();
+#else
+  return open_memstream(&task->text, &task->text_size);
+#endif
+}
+
+/**
+ * Close the output of a segment, leaving its null-terminated contents in task->text.
+ */
+static void close_segment_output(segment_task_t* task) {
+#ifdef _WIN32
+  long size = ftell(task->output);
+  rewind(task->output);
+  task->text = (char*)malloc(size + 1);
+  if (task->text == NULL || fread(task->text, 1, size, task->output) != (size_t)size) {
+    fprintf(stderr, "ERROR: Failed to read converted trace.\n");
+    exit(3);
+  }
+  task->text[size] = '\0';
+  task->text_size = size;
+#endif
+  fclose(task->output);
+}
+
+/**
+ * Convert the trace buffers of one segment. This is the body of each conversion thread.
+ */
+static void* convert_segment(void* arg) {
+  segment_task_t* task = (segment_task_t*)arg;
+  for (size_t i = 0; i < task->num_chunks; i++) {
+    // Records in the file are not necessarily aligned, so convert a copy.
+    memcpy(task->records, trace_data + task->chunks[i].offset, task->chunks[i].length * sizeof(trace_record_t));
+    task->convert(task->records, task->chunks[i].length, task->output, task->state);
+  }
+  return NULL;
+}
+
+int trace_num_threads() {
+  const char* setting = getenv("LF_TRACE_THREADS");
+  if (setting != NULL && atoi(setting) > 0) {
+    return atoi(setting);
+  }
+#ifdef _WIN32
+  return 1;
+#else
+  long result = sysconf(_SC_NPROCESSORS_ONLN);
+  return result > 0 ? (int)result : 1;
+#endif
+}
+
+size_t convert_trace(trace_segment_converter_t convert, trace_segment_merger_t merge, void** states, int num_threads) {
+  size_t num_chunks;
+  trace_chunk_t* chunks = index_trace_chunks(&num_chunks);
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+  segment_task_t* tasks = (segment_task_t*)calloc(num_threads, sizeof(segment_task_t));
+  pthread_t* threads = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+  if (tasks == NULL || threads == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  for (int i = 0; i < num_threads; i++) {
+    tasks[i].records = (trace_record_t*)malloc(TRACE_BUFFER_CAPACITY * sizeof(trace_record_t));
+    if (tasks[i].records == NULL) {
+      fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+      exit(3);
+    }
+    tasks[i].convert = convert;
+    tasks[i].state = states[i];
+  }
+
+  size_t num_records = 0;
+  size_t next_chunk = 0;
+  bool stopped = false;
+  while (next_chunk < num_chunks && !stopped) {
+    // Hand out consecutive segments to the threads.
+    int num_active = 0;
+    for (; num_active < num_threads && next_chunk < num_chunks; num_active++) {
+      segment_task_t* task = &tasks[num_active];
+      task->chunks = &chunks[next_chunk];
+      task->num_chunks = num_chunks - next_chunk;
+      if (task->num_chunks > TRACE_CHUNKS_PER_SEGMENT) {
+        task->num_chunks = TRACE_CHUNKS_PER_SEGMENT;
+      }
+      next_chunk += task->num_chunks;
+      task->output = open_segment_output(task);
+      if (task->output == NULL) {
+        fprintf(stderr, "ERROR: Failed to create buffer for converted trace.\n");
+        exit(3);
+      }
+      if (num_threads > 1 && pthread_create(&threads[num_active], NULL, convert_segment, task) != 0) {
+        fprintf(stderr, "ERROR: Failed to create thread to convert trace.\n");
+        exit(3);
+      }
+    }
+    // Collect the results in file order.
+    for (int i = 0; i < num_active; i++) {
+      segment_task_t* task = &tasks[i];
+      if (num_threads > 1) {
+        pthread_join(threads[i], NULL);
+      } else {
+        convert_segment(task);
+      }
+      close_segment_output(task);
+      for (size_t j = 0; j < task->num_chunks; j++) {
+        num_records += task->chunks[j].length;
+      }
+      if (!stopped && merge(task->state, task->text, task->text_size) != 0) {
+        stopped = true;
+      }
+      free(task->text);
+    }
+  }
+
+  for (int i = 0; i < num_threads; i++) {
+    free(tasks[i].records);
+  }
+  free(tasks);
+  free(threads);
+  free(chunks);
+  return num_records;
+}
@@ -84,6 +84,16 @@ char* root_name(const char* path);
  */
 FILE* open_file(const char* path, const char* mode);
 
+/**
+ * @brief Index the entries of object_table that were added since the last call.
+ * @ingroup Tracing
+ *
+ * This builds the hashmaps used by get_object_description and get_trigger_name, so that
+ * each lookup takes constant time. It is called by read_header and must be called again
+ * by any program that appends to object_table afterwards.
+ */
+void index_object_table();
+
 /**
  * @brief Get the description of the object pointed to by the specified pointer.
  * @ingroup Tracing
@@ -137,3 +147,63 @@ size_t read_header();
  * @return The number of trace records read or 0 upon seeing an EOF.
  */
 int read_trace();
+
+/**
+ * @brief Number of trace buffers that a thread converts in one go by convert_trace.
+ * @ingroup Tracing
+ */
+#define TRACE_CHUNKS_PER_SEGMENT 8
+
+/**
+ * @brief Function that converts trace records, called concurrently by convert_trace.
+ * @ingroup Tracing
+ *
+ * Each thread calls this function with its own state and its own output, so the function must
+ * not modify any global variables. Looking up objects with get_object_description and
+ * get_trigger_name is safe.
+ * @param records The trace records to convert.
+ * @param num_records The number of trace records.
+ * @param output The file to which to write the converted records.
+ * @param state The state of the thread calling the function.
+ */
+typedef void (*trace_segment_converter_t)(trace_record_t* records, int num_records, FILE* output, void* state);
+
+/**
+ * @brief Function that collects the result of converting a segment of a trace.
+ * @ingroup Tracing
+ *
+ * This is called by the thread that called convert_trace, once for each segment, in the order in
+ * which the segments appear in the trace file.
+ * @param state The state with which the segment was converted.
+ * @param output The null-terminated text written by the converter for the segment.
+ * @param size The length of the text.
+ * @return 0 to continue the conversion or nonzero to stop it.
+ */
+typedef int (*trace_segment_merger_t)(void* state, const char* output, size_t size);
+
+/**
+ * @brief Return the number of threads to use for converting the trace.
+ * @ingroup Tracing
+ *
+ * This is the number of online processors unless the LF_TRACE_THREADS environment variable
+ * gives a positive number.
+ */
+int trace_num_threads();
+
+/**
+ * @brief Convert the trace records following the header in parallel.
+ * @ingroup Tracing
+ *
+ * The trace file, which read_header maps into memory, is split at the boundaries between
+ * trace buffers into segments of TRACE_CHUNKS_PER_SEGMENT buffers. Up to `num_threads` segments
+ * are converted at a time, each by its own thread, and the results are then passed to `merge`
+ * in the order of the segments in the file, so the output does not depend on the number of threads.
+ * Thread `i` always converts with `states[i]`.
+ * This must be called after read_header and does not use or modify the trace global variable.
+ * @param convert The function that converts the records of a segment.
+ * @param merge The function that collects the result for a segment.
+ * @param states An array of `num_threads` states, one for each thread.
+ * @param num_threads The number of threads to use.
+ * @return The number of trace records converted.
+ */
+size_t convert_trace(trace_segment_converter_t convert, trace_segment_merger_t merge, void** states, int num_threads);